@@ -27,7 +27,6 @@
 #endif
 
 #define RPC_MAX_THREADS 1024
-#define RPC_MAX_POLLERS 1024
 #define RPC_MAX_CORES 1024
 #define MAX_THREAD_NAME 128
 #define MAX_POLLER_NAME 128
@@ -108,6 +107,7 @@ enum column_pollers_type {
 	COL_POLLERS_THREAD_NAME,
 	COL_POLLERS_RUN_COUNTER,
 	COL_POLLERS_PERIOD,
+	COL_POLLERS_CYCLES,
 	COL_POLLERS_BUSY_COUNT,
 	COL_POLLERS_NONE = 255,
 };
@@ -132,6 +132,7 @@ enum spdk_poller_type {
 	SPDK_ACTIVE_POLLER,
 	SPDK_TIMED_POLLER,
 	SPDK_PAUSED_POLLER,
+	SPDK_MSG_FUNCTION,
 	SPDK_POLLER_TYPES_COUNT,
 };
 
@@ -147,6 +148,7 @@ struct run_counter_history {
 	uint64_t thread_id;
 	uint64_t last_run_counter;
 	uint64_t last_busy_counter;
+	uint64_t last_tsc;
 	TAILQ_ENTRY(run_counter_history) link;
 };
 
@@ -154,7 +156,7 @@ uint8_t g_sleep_time = 1;
 uint16_t g_selected_row;
 uint16_t g_max_selected_row;
 uint64_t g_tick_rate;
-const char *poller_type_str[SPDK_POLLER_TYPES_COUNT] = {"Active", "Timed", "Paused"};
+const char *poller_type_str[SPDK_POLLER_TYPES_COUNT] = {"Active", "Timed", "Paused", "Message"};
 const char *g_tab_title[NUMBER_OF_TABS] = {"[1] THREADS", "[2] POLLERS", "[3] CORES"};
 struct spdk_jsonrpc_client *g_rpc_client;
 static TAILQ_HEAD(, run_counter_history) g_run_counter_history = TAILQ_HEAD_INITIALIZER(
@@ -186,6 +188,7 @@ static struct col_desc g_col_desc[NUMBER_OF_TABS][TABS_COL_COUNT] = {
 		{.name = "On thread", .max_data_string = MAX_THREAD_NAME_LEN},
 		{.name = "Run count", .max_data_string = MAX_POLLER_RUN_COUNT},
 		{.name = "Period [us]", .max_data_string = MAX_PERIOD_STR_LEN},
+		{.name = "Cycles %", .max_data_string = MAX_FLOAT_STR_LEN},
 		{.name = "Status (busy count)", .max_data_string = MAX_POLLER_IND_STR_LEN},
 		{.name = (char *)NULL}
 	},
@@ -227,6 +230,9 @@ struct rpc_poller_info {
 	uint64_t run_count;
 	uint64_t busy_count;
 	uint64_t period_ticks;
+	uint64_t tsc;
+	/* Share of the cycles spent in the pollers and messages of the thread */
+	double cycles_pct;
 	enum spdk_poller_type type;
 	char thread_name[MAX_THREAD_NAME];
 	uint64_t thread_id;
@@ -270,7 +276,7 @@ struct rpc_scheduler {
 };
 
 struct rpc_thread_info g_threads_info[RPC_MAX_THREADS];
-struct rpc_poller_info g_pollers_info[RPC_MAX_POLLERS];
+struct rpc_poller_info *g_pollers_info;
 struct rpc_core_info g_cores_info[RPC_MAX_CORES];
 struct rpc_scheduler g_scheduler_info;
 
@@ -372,6 +378,14 @@ static const struct spdk_json_object_decoder rpc_pollers_decoders[] = {
 	{"run_count", offsetof(struct rpc_poller_info, run_count), spdk_json_decode_uint64},
 	{"busy_count", offsetof(struct rpc_poller_info, busy_count), spdk_json_decode_uint64},
 	{"period_ticks", offsetof(struct rpc_poller_info, period_ticks), spdk_json_decode_uint64, true},
+	{"tsc", offsetof(struct rpc_poller_info, tsc), spdk_json_decode_uint64, true},
+};
+
+static const struct spdk_json_object_decoder rpc_msg_functions_decoders[] = {
+	{"name", offsetof(struct rpc_poller_info, name), spdk_json_decode_string},
+	{"id", offsetof(struct rpc_poller_info, id), spdk_json_decode_uint64},
+	{"run_count", offsetof(struct rpc_poller_info, run_count), spdk_json_decode_uint64},
+	{"tsc", offsetof(struct rpc_poller_info, tsc), spdk_json_decode_uint64},
 };
 
 static int
@@ -380,24 +394,27 @@ rpc_decode_pollers_array(struct spdk_json_val *poller, struct rpc_poller_info *o
 			 const char *thread_name, uint64_t thread_name_length, uint64_t thread_id,
 			 enum spdk_poller_type poller_type)
 {
+	const struct spdk_json_object_decoder *decoders = rpc_pollers_decoders;
+	size_t num_decoders = SPDK_COUNTOF(rpc_pollers_decoders);
 	int rc;
 
+	if (poller_type == SPDK_MSG_FUNCTION) {
+		decoders = rpc_msg_functions_decoders;
+		num_decoders = SPDK_COUNTOF(rpc_msg_functions_decoders);
+	}
+
 	for (poller = spdk_json_array_first(poller); poller != NULL; poller = spdk_json_next(poller)) {
 		out[*poller_count].thread_id = thread_id;
 		memcpy(out[*poller_count].thread_name, thread_name, sizeof(char) * thread_name_length);
 		out[*poller_count].type = poller_type;
 
-		rc = spdk_json_decode_object(poller, rpc_pollers_decoders,
-					     SPDK_COUNTOF(rpc_pollers_decoders), &out[*poller_count]);
+		rc = spdk_json_decode_object(poller, decoders, num_decoders, &out[*poller_count]);
 		if (rc) {
 			printf("Could not decode poller object from JSON.\n");
 			return rc;
 		}
 
 		(*poller_count)++;
-		if (*poller_count == RPC_MAX_POLLERS) {
-			return -1;
-		}
 	}
 
 	return 0;
@@ -409,18 +426,23 @@ static const struct spdk_json_object_decoder rpc_thread_pollers_decoders[] = {
 };
 
 static int
-rpc_decode_pollers_threads_array(struct spdk_json_val *val, struct rpc_poller_info *out,
+rpc_decode_pollers_threads_array(struct spdk_json_val *val, struct rpc_poller_info **pollers,
 				 uint32_t *num_pollers)
 {
-	struct spdk_json_val *thread = val, *poller;
+	struct spdk_json_val *thread = val, *poller, *entry;
+	struct rpc_poller_info *out = NULL;
 	/* This is a temporary poller structure to hold thread name and id.
 	 * It is filled with data only once per thread change and then
 	 * that memory is copied to each poller running on that thread. */
 	struct rpc_thread_info thread_info = {};
 	uint64_t poller_count = 0, i, thread_name_length;
 	int rc;
-	const char *poller_typenames[] = { "active_pollers", "timed_pollers", "paused_pollers" };
-	enum spdk_poller_type poller_types[] = { SPDK_ACTIVE_POLLER, SPDK_TIMED_POLLER, SPDK_PAUSED_POLLER };
+	const char *poller_typenames[] = { "active_pollers", "timed_pollers", "paused_pollers",
+					   "msg_functions"
+					 };
+	enum spdk_poller_type poller_types[] = { SPDK_ACTIVE_POLLER, SPDK_TIMED_POLLER, SPDK_PAUSED_POLLER,
+						 SPDK_MSG_FUNCTION
+					       };
 
 	/* Fetch the beginning of threads array */
 	rc = spdk_json_find_array(thread, "threads", NULL, &thread);
@@ -429,6 +451,29 @@ rpc_decode_pollers_threads_array(struct spdk_json_val *val, struct rpc_poller_in
 		goto end;
 	}
 
+	/* Each thread reports up to SPDK_THREAD_MSG_STATS_SIZE message functions in addition to
+	 * its pollers, so size the array from the response instead of using a fixed limit. */
+	for (entry = spdk_json_array_first(thread); entry != NULL; entry = spdk_json_next(entry)) {
+		for (i = 0; i < SPDK_COUNTOF(poller_types); i++) {
+			if (spdk_json_find(entry, poller_typenames[i], NULL, &poller,
+					   SPDK_JSON_VAL_ARRAY_BEGIN) != 0) {
+				continue;
+			}
+			for (poller = spdk_json_array_first(poller); poller != NULL;
+			     poller = spdk_json_next(poller)) {
+				poller_count++;
+			}
+		}
+	}
+
+	out = calloc(spdk_max(poller_count, 1), sizeof(*out));
+	if (out == NULL) {
+		printf("Could not allocate pollers array.\n");
+		rc = -ENOMEM;
+		goto end;
+	}
+	poller_count = 0;
+
 	for (thread = spdk_json_array_first(thread); thread != NULL; thread = spdk_json_next(thread)) {
 		rc = spdk_json_decode_object_relaxed(thread, rpc_thread_pollers_decoders,
 						     SPDK_COUNTOF(rpc_thread_pollers_decoders), &thread_info);
@@ -443,6 +488,11 @@ rpc_decode_pollers_threads_array(struct spdk_json_val *val, struct rpc_poller_in
 			/* Find poller array */
 			rc = spdk_json_find(thread, poller_typenames[i], NULL, &poller,
 					    SPDK_JSON_VAL_ARRAY_BEGIN);
+			if (rc && poller_types[i] == SPDK_MSG_FUNCTION) {
+				/* Not reported by older applications */
+				rc = 0;
+				continue;
+			}
 			if (rc) {
 				printf("Could not fetch pollers array from JSON.\n");
 				goto end;
@@ -458,6 +508,7 @@ rpc_decode_pollers_threads_array(struct spdk_json_val *val, struct rpc_poller_in
 		}
 	}
 
+	*pollers = out;
 	*num_pollers = poller_count;
 
 end:
@@ -468,9 +519,10 @@ end:
 
 	if (rc) {
 		*num_pollers = 0;
-		for (i = 0; i < poller_count; i++) {
+		for (i = 0; i < poller_count && out != NULL; i++) {
 			free_rpc_poller(&out[i]);
 		}
+		free(out);
 	}
 
 	return rc;
@@ -702,7 +754,7 @@ sort_threads(const void *p1, const void *p2)
 
 static void
 store_last_counters(uint64_t poller_id, uint64_t thread_id, uint64_t last_run_counter,
-		    uint64_t last_busy_counter)
+		    uint64_t last_busy_counter, uint64_t last_tsc)
 {
 	struct run_counter_history *history;
 
@@ -710,6 +762,7 @@ store_last_counters(uint64_t poller_id, uint64_t thread_id, uint64_t last_run_co
 		if ((history->poller_id == poller_id) && (history->thread_id == thread_id)) {
 			history->last_run_counter = last_run_counter;
 			history->last_busy_counter = last_busy_counter;
+			history->last_tsc = last_tsc;
 			return;
 		}
 	}
@@ -723,6 +776,7 @@ store_last_counters(uint64_t poller_id, uint64_t thread_id, uint64_t last_run_co
 	history->thread_id = thread_id;
 	history->last_run_counter = last_run_counter;
 	history->last_busy_counter = last_busy_counter;
+	history->last_tsc = last_tsc;
 
 	TAILQ_INSERT_TAIL(&g_run_counter_history, history, link);
 }
@@ -830,6 +884,54 @@ get_last_busy_counter(uint64_t poller_id, uint64_t thread_id)
 	return 0;
 }
 
+static uint64_t
+get_last_tsc(uint64_t poller_id, uint64_t thread_id)
+{
+	struct run_counter_history *history;
+
+	TAILQ_FOREACH(history, &g_run_counter_history, link) {
+		if ((history->poller_id == poller_id) && (history->thread_id == thread_id)) {
+			return history->last_tsc;
+		}
+	}
+
+	return 0;
+}
+
+static void
+calc_cycles_share(struct rpc_poller_info *pollers, uint32_t count)
+{
+	uint64_t *tsc, last_tsc, total;
+	uint32_t i, j;
+
+	tsc = calloc(spdk_max(count, 1), sizeof(*tsc));
+	if (tsc == NULL) {
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		tsc[i] = pollers[i].tsc;
+		if (g_interval_data) {
+			last_tsc = get_last_tsc(pollers[i].id, pollers[i].thread_id);
+			if (tsc[i] >= last_tsc) {
+				tsc[i] -= last_tsc;
+			}
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		total = 0;
+		for (j = 0; j < count; j++) {
+			if (pollers[j].thread_id == pollers[i].thread_id) {
+				total += tsc[j];
+			}
+		}
+		pollers[i].cycles_pct = total != 0 ? (double)tsc[i] * 100 / total : 0;
+	}
+
+	free(tsc);
+}
+
 static int
 subsort_pollers(enum column_pollers_type sort_column, const void *p1, const void *p2)
 {
@@ -858,6 +960,10 @@ subsort_pollers(enum column_pollers_type sort_column, const void *p1, const void
 		count1 = poller1->period_ticks;
 		count2 = poller2->period_ticks;
 		break;
+	case COL_POLLERS_CYCLES:
+		count1 = poller1->cycles_pct * 100;
+		count2 = poller2->cycles_pct * 100;
+		break;
 	case COL_POLLERS_BUSY_COUNT:
 		count1 = poller1->busy_count;
 		count2 = poller2->busy_count;
@@ -905,7 +1011,7 @@ get_pollers_data(void)
 	int rc = 0;
 	uint64_t i = 0;
 	uint32_t current_pollers_count;
-	struct rpc_poller_info pollers_info[RPC_MAX_POLLERS];
+	struct rpc_poller_info *pollers_info = NULL;
 
 	rc = rpc_send_req("thread_get_pollers", &json_resp);
 	if (rc) {
@@ -913,12 +1019,8 @@ get_pollers_data(void)
 	}
 
 	/* Decode json */
-	memset(&pollers_info, 0, sizeof(pollers_info));
-	if (rpc_decode_pollers_threads_array(json_resp->result, pollers_info, &current_pollers_count)) {
+	if (rpc_decode_pollers_threads_array(json_resp->result, &pollers_info, &current_pollers_count)) {
 		rc = -EINVAL;
-		for (i = 0; i < current_pollers_count; i++) {
-			free_rpc_poller(&pollers_info[i]);
-		}
 		goto end;
 	}
 
@@ -927,19 +1029,23 @@ get_pollers_data(void)
 	/* Save last run counter of each poller before updating g_pollers_stats. */
 	for (i = 0; i < g_last_pollers_count; i++) {
 		store_last_counters(g_pollers_info[i].id, g_pollers_info[i].thread_id,
-				    g_pollers_info[i].run_count, g_pollers_info[i].busy_count);
+				    g_pollers_info[i].run_count, g_pollers_info[i].busy_count,
+				    g_pollers_info[i].tsc);
 	}
 
 	/* Free old pollers values before allocating memory for new ones */
 	for (i = 0; i < g_last_pollers_count; i++) {
 		free_rpc_poller(&g_pollers_info[i]);
 	}
+	free(g_pollers_info);
 
 	g_last_pollers_count = current_pollers_count;
 
-	qsort(&pollers_info, g_last_pollers_count, sizeof(struct rpc_poller_info), sort_pollers);
+	calc_cycles_share(pollers_info, g_last_pollers_count);
 
-	memcpy(&g_pollers_info, &pollers_info, sizeof(struct rpc_poller_info) * g_last_pollers_count);
+	qsort(pollers_info, g_last_pollers_count, sizeof(struct rpc_poller_info), sort_pollers);
+
+	g_pollers_info = pollers_info;
 
 	pthread_mutex_unlock(&g_thread_lock);
 
@@ -1490,7 +1596,7 @@ draw_poller_tab_row(uint64_t current_row, uint8_t item_index)
 	uint64_t last_run_counter, last_busy_counter;
 	uint16_t col = TABS_DATA_START_COL;
 	char run_count[MAX_POLLER_RUN_COUNT], period_ticks[MAX_PERIOD_STR_LEN],
-	     status[MAX_POLLER_IND_STR_LEN];
+	     status[MAX_POLLER_IND_STR_LEN], cycles[MAX_FLOAT_STR_LEN];
 
 	last_busy_counter = get_last_busy_counter(g_pollers_info[current_row].id,
 			    g_pollers_info[current_row].thread_id);
@@ -1535,10 +1641,21 @@ draw_poller_tab_row(uint64_t current_row, uint8_t item_index)
 			print_max_len(g_tabs[POLLERS_TAB], TABS_DATA_START_ROW + item_index, col,
 				      col_desc[COL_POLLERS_PERIOD].max_data_string, ALIGN_RIGHT, period_ticks);
 		}
-		col += col_desc[COL_POLLERS_PERIOD].max_data_string + 7;
+		col += col_desc[COL_POLLERS_PERIOD].max_data_string + 3;
+	}
+
+	if (!col_desc[COL_POLLERS_CYCLES].disabled) {
+		snprintf(cycles, sizeof(cycles), "%.2f", g_pollers_info[current_row].cycles_pct);
+		print_max_len(g_tabs[POLLERS_TAB], TABS_DATA_START_ROW + item_index, col,
+			      col_desc[COL_POLLERS_CYCLES].max_data_string, ALIGN_RIGHT, cycles);
+		col += col_desc[COL_POLLERS_CYCLES].max_data_string + 1;
 	}
 
-	if (!col_desc[COL_POLLERS_BUSY_COUNT].disabled) {
+	col += 4;
+
+	/* Messages have no busy status */
+	if (!col_desc[COL_POLLERS_BUSY_COUNT].disabled &&
+	    g_pollers_info[current_row].type != SPDK_MSG_FUNCTION) {
 		if (g_pollers_info[current_row].busy_count > last_busy_counter) {
 			if (g_interval_data == true) {
 				snprintf(status, MAX_POLLER_IND_STR_LEN, "Busy (%" PRIu64 ")",
@@ -2437,15 +2554,11 @@ draw_thread_win_content(WINDOW *thread_win, struct rpc_thread_info *thread_info)
 	current_row = 8;
 
 	for (i = 0; i < g_last_pollers_count; i++) {
-		if (g_pollers_info[i].thread_id == thread_info->id) {
+		if (g_pollers_info[i].thread_id == thread_info->id &&
+		    g_pollers_info[i].type != SPDK_MSG_FUNCTION) {
 			mvwprintw(thread_win, current_row, THREAD_WIN_FIRST_COL, "%s", g_pollers_info[i].name);
-			if (g_pollers_info[i].type == SPDK_ACTIVE_POLLER) {
-				mvwprintw(thread_win, current_row, THREAD_WIN_FIRST_COL + 33, "Active");
-			} else if (g_pollers_info[i].type == SPDK_TIMED_POLLER) {
-				mvwprintw(thread_win, current_row, THREAD_WIN_FIRST_COL + 33, "Timed");
-			} else {
-				mvwprintw(thread_win, current_row, THREAD_WIN_FIRST_COL + 33, "Paused");
-			}
+			mvwprintw(thread_win, current_row, THREAD_WIN_FIRST_COL + 33, "%s",
+				  poller_type_str[g_pollers_info[i].type]);
 			mvwprintw(thread_win, current_row, THREAD_WIN_FIRST_COL + 41, "%" PRIu64,
 				  g_pollers_info[i].run_count);
 			if (g_pollers_info[i].period_ticks) {
@@ -3356,6 +3469,7 @@ show_stats(pthread_t *data_thread)
 	for (i = 0; i < g_last_pollers_count; i++) {
 		free_rpc_poller(&g_pollers_info[i]);
 	}
+	free(g_pollers_info);
 	for (i = 0; i < g_last_threads_count; i++) {
 		free_rpc_threads_stats(&g_threads_info[i]);
 	}
@@ -19,9 +19,20 @@ extern "C" {
 
 enum print_format_type {
 	PRINT_FMT_JSON,
+	PRINT_FMT_CHROME,
 	PRINT_FMT_DEFAULT,
 };
 
+/* Object shown as an async slice spanning from its creation to its last tracepoint */
+struct chrome_object {
+	const char	*name;
+	uint64_t	index;
+	uint64_t	last_tsc;
+	uint16_t	lcore;
+};
+
+typedef std::map<std::pair<uint8_t, uint64_t>, chrome_object> chrome_object_map;
+
 static struct spdk_trace_parser *g_parser;
 static const struct spdk_trace_file *g_file;
 static struct spdk_json_write_ctx *g_json;
@@ -384,6 +395,181 @@ trace_print_json(void)
 	return 0;
 }
 
+static double
+get_chrome_ts(uint64_t tsc, uint64_t tsc_rate, uint64_t tsc_offset)
+{
+	return (double)(tsc - tsc_offset) * SPDK_SEC_TO_USEC / tsc_rate;
+}
+
+static void
+print_chrome_event_begin(const char *name, const char *phase, uint16_t lcore, double ts)
+{
+	spdk_json_write_object_begin(g_json);
+	spdk_json_write_named_string(g_json, "name", name);
+	spdk_json_write_named_string(g_json, "ph", phase);
+	spdk_json_write_named_uint32(g_json, "pid", 0);
+	spdk_json_write_named_uint32(g_json, "tid", lcore);
+	spdk_json_write_named_double(g_json, "ts", ts);
+}
+
+static void
+print_chrome_object_id(uint8_t object_type, uint64_t index)
+{
+	char prefix = g_file->object[object_type].id_prefix;
+
+	spdk_json_write_named_string_fmt(g_json, "cat", "%c", prefix);
+	spdk_json_write_named_string_fmt(g_json, "id", "%c%" PRIu64, prefix, index);
+}
+
+static void
+print_chrome_object_end(uint8_t object_type, const chrome_object &object, uint64_t tsc_rate,
+			uint64_t tsc_offset)
+{
+	print_chrome_event_begin(object.name, "e", object.lcore,
+				 get_chrome_ts(object.last_tsc, tsc_rate, tsc_offset));
+	print_chrome_object_id(object_type, object.index);
+	spdk_json_write_object_end(g_json);
+}
+
+static void
+print_chrome_event(struct spdk_trace_parser_entry *entry, chrome_object_map &objects,
+		   uint64_t tsc_rate, uint64_t tsc_offset)
+{
+	struct spdk_trace_entry *e = entry->entry;
+	struct spdk_trace_owner *owner;
+	const struct spdk_trace_tpoint *d;
+	chrome_object_map::iterator it;
+	const char *phase;
+	size_t i;
+
+	d = &g_file->tpoint[e->tpoint_id];
+	std::pair<uint8_t, uint64_t> key(d->object_type, e->object_id);
+
+	if (d->new_object) {
+		/* The object's address got reused, so the previous one must be gone by now */
+		it = objects.find(key);
+		if (it != objects.end()) {
+			print_chrome_object_end(d->object_type, it->second, tsc_rate, tsc_offset);
+		}
+		objects[key] = { d->name, entry->object_index, e->tsc, entry->lcore };
+		phase = "b";
+	} else if (d->object_type != OBJECT_NONE && entry->object_index != UINT64_MAX) {
+		it = objects.find(key);
+		if (it != objects.end() && it->second.index == entry->object_index) {
+			it->second.last_tsc = e->tsc;
+			it->second.lcore = entry->lcore;
+		}
+		phase = "n";
+	} else {
+		phase = "i";
+	}
+
+	print_chrome_event_begin(d->name, phase, entry->lcore,
+				 get_chrome_ts(e->tsc, tsc_rate, tsc_offset));
+	if (phase[0] == 'i') {
+		spdk_json_write_named_string(g_json, "s", "t");
+	} else {
+		print_chrome_object_id(d->object_type, entry->object_index);
+	}
+
+	spdk_json_write_named_object_begin(g_json, "args");
+	owner = spdk_get_trace_owner(g_file, e->owner_id);
+	if (e->owner_id > 0 && owner != NULL && owner->tsc < e->tsc) {
+		spdk_json_write_named_string_fmt(g_json, "owner", "%.*s", g_file->owner_description_size,
+						 owner->description);
+	}
+	if (e->size != 0) {
+		spdk_json_write_named_uint32(g_json, "size", e->size);
+	}
+	if (e->object_id != 0) {
+		spdk_json_write_named_string_fmt(g_json, "object", "0x%" PRIx64, e->object_id);
+	}
+	if (entry->related_index != UINT64_MAX) {
+		spdk_json_write_named_string_fmt(g_json, "related", "%c%" PRIu64,
+						 g_file->object[entry->related_type].id_prefix,
+						 entry->related_index);
+	}
+	for (i = 0; i < d->num_args; ++i) {
+		switch (d->args[i].type) {
+		case SPDK_TRACE_ARG_TYPE_PTR:
+			spdk_json_write_named_string_fmt(g_json, d->args[i].name, "0x%" PRIx64,
+							 (uint64_t)entry->args[i].u.pointer);
+			break;
+		case SPDK_TRACE_ARG_TYPE_INT:
+			spdk_json_write_named_uint64(g_json, d->args[i].name, entry->args[i].u.integer);
+			break;
+		case SPDK_TRACE_ARG_TYPE_STR:
+			spdk_json_write_named_string(g_json, d->args[i].name, entry->args[i].u.string);
+			break;
+		}
+	}
+	spdk_json_write_object_end(g_json);
+
+	spdk_json_write_object_end(g_json);
+}
+
+static int
+trace_print_chrome(int lcore)
+{
+	struct spdk_trace_parser_entry	entry;
+	chrome_object_map		objects;
+	uint64_t	tsc_offset;
+	uint64_t	tsc_rate = g_file->tsc_rate;
+	int		i;
+
+	g_json = spdk_json_write_begin(print_json, NULL, 0);
+	if (g_json == NULL) {
+		fprintf(stderr, "Failed to allocate JSON write context\n");
+		return -1;
+	}
+
+	spdk_json_write_object_begin(g_json);
+	spdk_json_write_named_string(g_json, "displayTimeUnit", "ns");
+	spdk_json_write_named_array_begin(g_json, "traceEvents");
+
+	/* Each lcore is shown as a thread of a single process */
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE; ++i) {
+		if ((lcore != SPDK_TRACE_MAX_LCORE && i != lcore) ||
+		    spdk_trace_parser_get_entry_count(g_parser, i) == 0) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(g_json);
+		spdk_json_write_named_string(g_json, "name", "thread_name");
+		spdk_json_write_named_string(g_json, "ph", "M");
+		spdk_json_write_named_uint32(g_json, "pid", 0);
+		spdk_json_write_named_uint32(g_json, "tid", i);
+		spdk_json_write_named_object_begin(g_json, "args");
+		if (g_file->tname[i][0] != '\0') {
+			spdk_json_write_named_string_fmt(g_json, "name", "%.*s",
+							 (int)sizeof(g_file->tname[i]), g_file->tname[i]);
+		} else {
+			spdk_json_write_named_string_fmt(g_json, "name", "lcore %d", i);
+		}
+		spdk_json_write_object_end(g_json);
+		spdk_json_write_object_end(g_json);
+	}
+
+	tsc_offset = spdk_trace_parser_get_tsc_offset(g_parser);
+	while (spdk_trace_parser_next_entry(g_parser, &entry)) {
+		if (entry.entry->tsc < tsc_offset) {
+			continue;
+		}
+		print_chrome_event(&entry, objects, tsc_rate, tsc_offset);
+	}
+
+	/* Close the objects that were still around when the trace ended */
+	for (auto &kv : objects) {
+		print_chrome_object_end(kv.first.first, kv.second, tsc_rate, tsc_offset);
+	}
+
+	spdk_json_write_array_end(g_json);
+	spdk_json_write_object_end(g_json);
+	spdk_json_write_end(g_json);
+
+	return 0;
+}
+
 static void
 usage(void)
 {
@@ -404,6 +590,8 @@ usage(void)
 	fprintf(stderr, "                      newest trace file in /dev/shm\n");
 #endif
 	fprintf(stderr, "                 '-j' to use JSON to format the output\n");
+	fprintf(stderr, "                 '-e' to export the events in Chrome trace event format,\n");
+	fprintf(stderr, "                      which can be loaded into Perfetto or chrome://tracing\n");
 }
 
 #if defined(__linux__)
@@ -436,7 +624,7 @@ main(int argc, char **argv)
 	int				shm_id = -1, shm_pid = -1;
 
 	g_exe_name = argv[0];
-	while ((op = getopt(argc, argv, "c:f:i:jp:s:t")) != -1) {
+	while ((op = getopt(argc, argv, "c:ef:i:jp:s:t")) != -1) {
 		switch (op) {
 		case 'c':
 			lcore = atoi(optarg);
@@ -465,6 +653,9 @@ main(int argc, char **argv)
 		case 'j':
 			print_format = PRINT_FMT_JSON;
 			break;
+		case 'e':
+			print_format = PRINT_FMT_CHROME;
+			break;
 		default:
 			usage();
 			exit(1);
@@ -518,6 +709,9 @@ main(int argc, char **argv)
 	case PRINT_FMT_JSON:
 		rc = trace_print_json();
 		break;
+	case PRINT_FMT_CHROME:
+		rc = trace_print_chrome(lcore);
+		break;
 	case PRINT_FMT_DEFAULT:
 	default:
 		rc = trace_print(lcore);
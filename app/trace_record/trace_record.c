@@ -5,6 +5,7 @@
 
 #include "spdk/stdinc.h"
 
+#include "spdk/endian.h"
 #include "spdk/env.h"
 #include "spdk/string.h"
 #include "spdk/trace.h"
@@ -13,12 +14,17 @@
 
 #define TRACE_FILE_COPY_SIZE	(32 * 1024)
 #define TRACE_PATH_MAX		2048
+/* Upper bound of entries taken by a single tracepoint, including the buffers with its arguments */
+#define TRACE_MAX_RECORD_ENTRIES	64
+#define TRACE_ENTRY_WORDS		(sizeof(struct spdk_trace_entry) / sizeof(uint64_t))
+#define TRACE_ENTRY_LENGTHS_SIZE	(TRACE_ENTRY_WORDS / 2)
 
 static char *g_exe_name;
 static int g_verbose = 1;
 static uint64_t g_tsc_rate;
 static uint64_t g_utsc_rate;
 static bool g_shutdown = false;
+static bool g_stream = false;
 static uint64_t g_file_size;
 
 struct lcore_trace_record_ctx {
@@ -37,6 +43,13 @@ struct lcore_trace_record_ctx {
 
 	/* Total number of entries in lcore trace file */
 	uint64_t num_entries;
+
+	/* Number of entries overwritten in shared memory before they could be recorded */
+	uint64_t lost_entries;
+
+	/* Entries copied out of shared memory and their encoded form, used when streaming */
+	struct spdk_trace_entry *stream_entries;
+	uint8_t *stream_buf;
 };
 
 struct aggr_trace_record_ctx {
@@ -556,6 +569,272 @@ out:
 	return rc;
 }
 
+static size_t
+stream_encoded_size_max(uint64_t num_entries)
+{
+	/* The last word is always stored as a whole, even if only some of its bytes are kept */
+	return num_entries * (TRACE_ENTRY_LENGTHS_SIZE + sizeof(struct spdk_trace_entry)) +
+	       sizeof(uint64_t);
+}
+
+static size_t
+stream_encode(const struct spdk_trace_entry *entries, uint64_t num_entries, uint8_t *out)
+{
+	uint64_t words[TRACE_ENTRY_WORDS];
+	uint8_t *lengths;
+	size_t o = 0, len;
+	uint64_t i, j;
+
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_trace_entry) % (2 * sizeof(uint64_t)) == 0,
+			   "trace entry must be made of an even number of words");
+
+	for (i = 0; i < num_entries; i++) {
+		memcpy(words, &entries[i], sizeof(words));
+		lengths = &out[o];
+		memset(lengths, 0, TRACE_ENTRY_LENGTHS_SIZE);
+		o += TRACE_ENTRY_LENGTHS_SIZE;
+
+		/* Small integers and pointers leave most of the upper bytes zeroed */
+		for (j = 0; j < TRACE_ENTRY_WORDS; j++) {
+			len = words[j] == 0 ? 0 : sizeof(uint64_t) - __builtin_clzll(words[j]) / 8;
+			lengths[j / 2] |= len << (j % 2 * 4);
+			/* Storing the whole word is cheaper than copying a variable number of bytes */
+			to_le64(&out[o], words[j]);
+			o += len;
+		}
+	}
+
+	return o;
+}
+
+static void
+stream_copy_entries(struct spdk_trace_history *in_history, uint64_t start, uint64_t end,
+		    struct spdk_trace_entry *entries)
+{
+	uint64_t num_cir_entries = in_history->num_entries;
+	uint64_t cir_start = start & (num_cir_entries - 1);
+	uint64_t count = spdk_min(end - start, num_cir_entries - cir_start);
+
+	memcpy(entries, &in_history->entries[cir_start], count * sizeof(*entries));
+	if (count < end - start) {
+		memcpy(&entries[count], &in_history->entries[0], (end - start - count) * sizeof(*entries));
+	}
+}
+
+static int
+lcore_trace_stream(struct aggr_trace_record_ctx *ctx, struct lcore_trace_record_ctx *lcore_port)
+{
+	struct spdk_trace_history	*in_history = lcore_port->in_history;
+	struct spdk_trace_entry		*entries = lcore_port->stream_entries;
+	struct spdk_trace_stream_chunk	chunk = {};
+	uint64_t			num_cir_entries = in_history->num_entries;
+	uint64_t			shm_next_entry, start, end, num_entries, lost, i;
+	uint64_t			tsc, prev_tsc;
+	/* Entries overwritten before we started polling don't count as lost */
+	bool				first_poll = lcore_port->rec_next_entry == 0;
+	int				rc;
+
+	shm_next_entry = in_history->next_entry;
+
+	/* Ensure all entries of spdk_trace_history are latest to next_entry */
+	spdk_smp_rmb();
+
+	start = lcore_port->rec_next_entry;
+	if (shm_next_entry == start) {
+		return 0;
+	} else if (shm_next_entry < start) {
+		fprintf(stderr, "Trace porting error in lcore %d, trace rollback occurs.\n", in_history->lcore);
+		fprintf(stderr, "shm_next_entry is %ju, record_next_entry is %ju.\n", shm_next_entry,
+			start);
+		return -1;
+	}
+
+	if (shm_next_entry - start > num_cir_entries) {
+		if (!first_poll) {
+			lcore_port->lost_entries += shm_next_entry - start - num_cir_entries;
+		}
+		start = shm_next_entry - num_cir_entries;
+	}
+
+	stream_copy_entries(in_history, start, shm_next_entry, entries);
+
+	/* The writer never waits for us, so the entries it wrapped around to while they were being
+	 * copied may be torn.  It might also be in the middle of filling a tracepoint past the
+	 * next_entry we just read, so leave some margin for that.
+	 */
+	spdk_smp_rmb();
+	end = in_history->next_entry + TRACE_MAX_RECORD_ENTRIES;
+	if (end - start > num_cir_entries) {
+		lost = spdk_min(end - start - num_cir_entries, shm_next_entry - start);
+		if (!first_poll) {
+			lcore_port->lost_entries += lost;
+		}
+		entries += lost;
+		start += lost;
+	}
+
+	lcore_port->rec_next_entry = shm_next_entry;
+	num_entries = shm_next_entry - start;
+	if (num_entries == 0) {
+		return 0;
+	}
+
+	if (lcore_port->first_entry_tsc == 0) {
+		lcore_port->first_entry_tsc = entries[0].tsc;
+	}
+	lcore_port->last_entry_tsc = entries[num_entries - 1].tsc;
+	lcore_port->num_entries += num_entries;
+
+	/* Store the tsc of each entry as a difference to the previous one, which leaves mostly zero
+	 * bytes for the encoding to squeeze out.
+	 */
+	prev_tsc = 0;
+	for (i = 0; i < num_entries; i++) {
+		tsc = entries[i].tsc;
+		entries[i].tsc -= prev_tsc;
+		prev_tsc = tsc;
+	}
+
+	chunk.type = SPDK_TRACE_STREAM_CHUNK_ENTRIES;
+	chunk.lcore = in_history->lcore;
+	chunk.num_entries = num_entries;
+	chunk.size = stream_encode(entries, num_entries, lcore_port->stream_buf);
+
+	rc = cont_write(ctx->out_fd, &chunk, sizeof(chunk));
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write chunk header into trace file\n");
+		return rc;
+	}
+
+	rc = cont_write(ctx->out_fd, lcore_port->stream_buf, chunk.size);
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write trace entries into trace file\n");
+		return rc;
+	}
+
+	return 0;
+}
+
+static int
+stream_write_chunk(struct aggr_trace_record_ctx *ctx, uint8_t type, uint16_t lcore,
+		   const void *payload, uint32_t size)
+{
+	struct spdk_trace_stream_chunk chunk = {};
+	int rc;
+
+	chunk.type = type;
+	chunk.lcore = lcore;
+	chunk.size = size;
+
+	rc = cont_write(ctx->out_fd, &chunk, sizeof(chunk));
+	if (rc < 0) {
+		return rc;
+	}
+
+	rc = cont_write(ctx->out_fd, payload, size);
+
+	return rc < 0 ? rc : 0;
+}
+
+static int
+stream_prepare(struct aggr_trace_record_ctx *ctx, const char *path)
+{
+	struct lcore_trace_record_ctx *lcore_port;
+	uint64_t magic = SPDK_TRACE_STREAM_MAGIC;
+	int i, rc;
+
+	ctx->out_file = path;
+	if (access(ctx->out_file, F_OK) == 0) {
+		rc = unlink(ctx->out_file);
+		if (rc) {
+			return -1;
+		}
+	}
+
+	ctx->out_fd = open(ctx->out_file, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (ctx->out_fd < 0) {
+		fprintf(stderr, "Could not open trace file %s.\n", ctx->out_file);
+		return -1;
+	}
+
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE; i++) {
+		lcore_port = &ctx->lcore_ports[i];
+		if (!lcore_port->valid) {
+			continue;
+		}
+
+		lcore_port->stream_entries = calloc(lcore_port->in_history->num_entries,
+						    sizeof(struct spdk_trace_entry));
+		lcore_port->stream_buf = malloc(stream_encoded_size_max(
+							lcore_port->in_history->num_entries));
+		if (lcore_port->stream_entries == NULL || lcore_port->stream_buf == NULL) {
+			fprintf(stderr, "Failed to allocate memory for lcore %d.\n", i);
+			return -1;
+		}
+	}
+
+	rc = cont_write(ctx->out_fd, &magic, sizeof(magic));
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write magic into trace file\n");
+		return rc;
+	}
+
+	/* Tracepoint definitions, thread names, etc. */
+	rc = cont_write(ctx->out_fd, ctx->trace_file, sizeof(struct spdk_trace_file));
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write metadata into trace file\n");
+		return rc;
+	}
+
+	if (g_verbose) {
+		printf("Stream trace entries into %s\n", ctx->out_file);
+	}
+
+	return 0;
+}
+
+static int
+stream_finish(struct aggr_trace_record_ctx *ctx)
+{
+	struct lcore_trace_record_ctx *lcore_port;
+	uint64_t owner_size;
+	int i, rc = 0;
+
+	/* The tracepoint counters and owners are only known once we're done */
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE && rc == 0; i++) {
+		lcore_port = &ctx->lcore_ports[i];
+		if (!lcore_port->valid) {
+			continue;
+		}
+
+		rc = stream_write_chunk(ctx, SPDK_TRACE_STREAM_CHUNK_HISTORY, i, lcore_port->in_history,
+					sizeof(struct spdk_trace_history));
+	}
+
+	if (rc == 0) {
+		owner_size = (uint64_t)ctx->trace_file->num_owners *
+			     (sizeof(struct spdk_trace_owner) + ctx->trace_file->owner_description_size);
+		rc = stream_write_chunk(ctx, SPDK_TRACE_STREAM_CHUNK_OWNERS, 0,
+					(uint8_t *)ctx->trace_file + ctx->trace_file->owner_offset,
+					owner_size);
+	}
+
+	if (rc != 0) {
+		fprintf(stderr, "Failed to write trailer into trace file\n");
+	} else {
+		printf("All lcores trace entries are streamed into trace file %s\n", ctx->out_file);
+	}
+
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE; i++) {
+		lcore_port = &ctx->lcore_ports[i];
+		free(lcore_port->stream_entries);
+		free(lcore_port->stream_buf);
+	}
+	close(ctx->out_fd);
+
+	return rc;
+}
+
 static void
 __shutdown_signal(int signo)
 {
@@ -603,6 +882,8 @@ usage(void)
 	printf("                      (one of -i or -p must be specified)\n");
 	printf("                 '-f' to specify output trace file name\n");
 	printf("                 '-t' to specify the duration of the trace record in seconds\n");
+	printf("                 '-z' to stream compressed trace entries into the output file\n");
+	printf("                      while recording instead of aggregating them at exit\n");
 	printf("                 '-h' to print usage information\n");
 }
 
@@ -622,7 +903,7 @@ main(int argc, char **argv)
 	struct lcore_trace_record_ctx	*lcore_port;
 
 	g_exe_name = argv[0];
-	while ((op = getopt(argc, argv, "f:i:p:qs:t:h")) != -1) {
+	while ((op = getopt(argc, argv, "f:i:p:qs:t:zh")) != -1) {
 		switch (op) {
 		case 'i':
 			shm_id = spdk_strtol(optarg, 10);
@@ -642,6 +923,9 @@ main(int argc, char **argv)
 		case 't':
 			record_duration_in_sec = spdk_strtol(optarg, 10);
 			break;
+		case 'z':
+			g_stream = true;
+			break;
 		case 'h':
 			usage();
 			exit(EXIT_SUCCESS);
@@ -691,7 +975,11 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
-	rc = output_trace_files_prepare(&ctx, file_name);
+	if (g_stream) {
+		rc = stream_prepare(&ctx, file_name);
+	} else {
+		rc = output_trace_files_prepare(&ctx, file_name);
+	}
 	if (rc) {
 		exit(1);
 	}
@@ -708,7 +996,11 @@ main(int argc, char **argv)
 			if (!lcore_port->valid) {
 				continue;
 			}
-			rc = lcore_trace_record(lcore_port);
+			if (g_stream) {
+				rc = lcore_trace_stream(&ctx, lcore_port);
+			} else {
+				rc = lcore_trace_record(lcore_port);
+			}
 			if (rc) {
 				break;
 			}
@@ -719,8 +1011,12 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
-	printf("Start to aggregate lcore trace files\n");
-	rc = trace_files_aggregate(&ctx);
+	if (g_stream) {
+		rc = stream_finish(&ctx);
+	} else {
+		printf("Start to aggregate lcore trace files\n");
+		rc = trace_files_aggregate(&ctx);
+	}
 	if (rc) {
 		exit(1);
 	}
@@ -737,13 +1033,18 @@ main(int argc, char **argv)
 		printf("Port %ju trace entries for lcore (%d) in %ju usec\n",
 		       lcore_port->num_entries, i,
 		       (lcore_port->last_entry_tsc - lcore_port->first_entry_tsc) / g_utsc_rate);
-
+		if (lcore_port->lost_entries > 0) {
+			printf("Lcore (%d) overwrote %ju entries before they were recorded\n", i,
+			       lcore_port->lost_entries);
+		}
 	}
 
 	munmap(ctx.trace_file, g_file_size);
 	close(ctx.shm_fd);
 
-	output_trace_files_finish(&ctx);
+	if (!g_stream) {
+		output_trace_files_finish(&ctx);
+	}
 
 	return 0;
 }
@@ -0,0 +1,657 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Metadata storm against an fsdev: each of the queue depth slots loops creating, stating,
+ * closing and unlinking its own file in the root directory.  At the same time, a timed poller
+ * on the same thread measures how late it's run, i.e. how long the reactor was stalled by the
+ * fsdev, which is what the other I/Os handled by the thread would be waiting for.
+ *
+ * The lookup workload creates a set of files first, then each slot loops looking up a random
+ * one of them (or of a set of missing names), stating and forgetting it.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/thread.h"
+#include "spdk/fsdev.h"
+#include "spdk/env.h"
+#include "spdk/event.h"
+#include "spdk/log.h"
+#include "spdk/string.h"
+
+#define MAX_QUEUE_DEPTH 1024
+
+enum md_perf_op {
+	MD_PERF_CREATE,
+	MD_PERF_GETATTR,
+	MD_PERF_RELEASE,
+	MD_PERF_UNLINK,
+	MD_PERF_FORGET,
+	MD_PERF_LOOKUP,
+	MD_PERF_NUM_OPS,
+};
+
+static const char *g_op_names[] = {
+	[MD_PERF_CREATE] = "create",
+	[MD_PERF_GETATTR] = "getattr",
+	[MD_PERF_RELEASE] = "release",
+	[MD_PERF_UNLINK] = "unlink",
+	[MD_PERF_FORGET] = "forget",
+	[MD_PERF_LOOKUP] = "lookup",
+};
+
+struct md_perf_stats {
+	uint64_t count;
+	uint64_t total_tsc;
+	uint64_t max_tsc;
+};
+
+struct md_perf_slot {
+	struct md_perf_context *ctx;
+	char name[32];
+	struct spdk_fsdev_file_object *fobject;
+	struct spdk_fsdev_file_handle *fhandle;
+	uint64_t submit_tsc;
+	unsigned int seed;
+	bool missing;
+};
+
+struct md_perf_context {
+	struct spdk_fsdev_desc *desc;
+	struct spdk_io_channel *ch;
+	struct spdk_fsdev_file_object *root;
+	struct spdk_poller *probe;
+	struct spdk_poller *timer;
+	struct md_perf_slot slots[MAX_QUEUE_DEPTH];
+	struct md_perf_stats ops[MD_PERF_NUM_OPS];
+	struct md_perf_stats probe_delay;
+	uint64_t probe_next_tsc;
+	uint64_t unique;
+	uint64_t start_tsc;
+	uint32_t outstanding;
+	uint32_t num_files;
+	bool stopping;
+	int rc;
+};
+
+static const char *g_fsdev_name = "Fs0";
+static uint32_t g_queue_depth = 32;
+static uint32_t g_time_in_sec = 10;
+static uint32_t g_probe_period_us = 100;
+static bool g_lookup_workload;
+static uint32_t g_num_files = 1024;
+static uint32_t g_miss_percent;
+static struct md_perf_context g_ctx;
+
+static void md_perf_slot_start(struct md_perf_slot *slot);
+
+static void
+md_perf_usage(void)
+{
+	printf(" -f <fs>                 name of the fsdev to use (default: %s)\n", g_fsdev_name);
+	printf(" -Q <depth>              number of files created in parallel, up to %d (default: %u)\n",
+	       MAX_QUEUE_DEPTH, g_queue_depth);
+	printf(" -T <sec>                time of the run in seconds (default: %u)\n", g_time_in_sec);
+	printf(" -P <us>                 period of the reactor latency probe (default: %u)\n",
+	       g_probe_period_us);
+	printf(" -w <workload>           create or lookup (default: create)\n");
+	printf(" -N <files>              number of files of the lookup workload (default: %u)\n",
+	       g_num_files);
+	printf(" -M <percent>            share of lookups of missing names (default: %u)\n",
+	       g_miss_percent);
+}
+
+static int
+md_perf_parse_arg(int ch, char *arg)
+{
+	long val;
+
+	switch (ch) {
+	case 'f':
+		g_fsdev_name = arg;
+		return 0;
+	case 'w':
+		if (!strcmp(arg, "lookup")) {
+			g_lookup_workload = true;
+		} else if (strcmp(arg, "create")) {
+			fprintf(stderr, "Unknown workload: %s\n", arg);
+			return -EINVAL;
+		}
+		return 0;
+	case 'M':
+		val = spdk_strtol(arg, 10);
+		if (val < 0 || val > 100) {
+			fprintf(stderr, "Invalid value for -%c: %s\n", ch, arg);
+			return -EINVAL;
+		}
+		g_miss_percent = val;
+		return 0;
+	case 'Q':
+	case 'T':
+	case 'P':
+	case 'N':
+		val = spdk_strtol(arg, 10);
+		if (val <= 0) {
+			fprintf(stderr, "Invalid value for -%c: %s\n", ch, arg);
+			return -EINVAL;
+		}
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	switch (ch) {
+	case 'Q':
+		if (val > MAX_QUEUE_DEPTH) {
+			fprintf(stderr, "Queue depth is limited to %d\n", MAX_QUEUE_DEPTH);
+			return -EINVAL;
+		}
+		g_queue_depth = val;
+		break;
+	case 'T':
+		g_time_in_sec = val;
+		break;
+	case 'N':
+		g_num_files = val;
+		break;
+	default:
+		g_probe_period_us = val;
+		break;
+	}
+
+	return 0;
+}
+
+static void
+md_perf_stats_add(struct md_perf_stats *stats, uint64_t tsc)
+{
+	stats->count++;
+	stats->total_tsc += tsc;
+	stats->max_tsc = spdk_max(stats->max_tsc, tsc);
+}
+
+static void
+md_perf_print_stats(const char *name, const struct md_perf_stats *stats, uint64_t ticks_hz)
+{
+	double avg_us = 0;
+
+	if (stats->count != 0) {
+		avg_us = (double)stats->total_tsc * SPDK_SEC_TO_USEC / stats->count / ticks_hz;
+	}
+
+	printf("%-14s %12" PRIu64 " %12.1f %12.1f\n", name, stats->count, avg_us,
+	       (double)stats->max_tsc * SPDK_SEC_TO_USEC / ticks_hz);
+}
+
+static void
+md_perf_root_forget_cb(void *cb_arg, struct spdk_io_channel *ch, int status)
+{
+	struct md_perf_context *ctx = cb_arg;
+
+	spdk_put_io_channel(ctx->ch);
+	spdk_fsdev_close(ctx->desc);
+	spdk_app_stop(ctx->rc);
+}
+
+static void
+md_perf_release_root(struct md_perf_context *ctx)
+{
+	int rc;
+
+	rc = spdk_fsdev_forget(ctx->desc, ctx->ch, ctx->unique++, ctx->root, 1,
+			       md_perf_root_forget_cb, ctx);
+	if (rc != 0) {
+		md_perf_root_forget_cb(ctx, ctx->ch, rc);
+	}
+}
+
+static void md_perf_cleanup(struct md_perf_context *ctx);
+
+static void
+md_perf_cleanup_cb(void *cb_arg, struct spdk_io_channel *ch, int status)
+{
+	struct md_perf_context *ctx = cb_arg;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Unlink of md_perf_file_%" PRIu32 " failed with %d\n", ctx->num_files, status);
+	}
+
+	md_perf_cleanup(ctx);
+}
+
+/* Removes the files of the lookup workload, from the last one down */
+static void
+md_perf_cleanup(struct md_perf_context *ctx)
+{
+	char name[32];
+	int rc;
+
+	if (ctx->num_files == 0) {
+		md_perf_release_root(ctx);
+		return;
+	}
+
+	ctx->num_files--;
+	snprintf(name, sizeof(name), "md_perf_file_%" PRIu32, ctx->num_files);
+	rc = spdk_fsdev_unlink(ctx->desc, ctx->ch, ctx->unique++, ctx->root, name,
+			       md_perf_cleanup_cb, ctx);
+	if (rc != 0) {
+		md_perf_cleanup_cb(ctx, ctx->ch, rc);
+	}
+}
+
+static void
+md_perf_finish(struct md_perf_context *ctx)
+{
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+	uint64_t elapsed = spdk_get_ticks() - ctx->start_tsc;
+	int i;
+
+	spdk_poller_unregister(&ctx->probe);
+	spdk_poller_unregister(&ctx->timer);
+
+	printf("%-14s %12s %12s %12s\n", "Operation", "Count", "Avg us", "Max us");
+	for (i = 0; i < MD_PERF_NUM_OPS; i++) {
+		if (ctx->ops[i].count != 0) {
+			md_perf_print_stats(g_op_names[i], &ctx->ops[i], ticks_hz);
+		}
+	}
+	md_perf_print_stats("reactor delay", &ctx->probe_delay, ticks_hz);
+
+	if (g_lookup_workload) {
+		printf("Lookups per second: %.1f\n",
+		       (double)ctx->ops[MD_PERF_LOOKUP].count * ticks_hz / spdk_max(elapsed, 1));
+		md_perf_cleanup(ctx);
+	} else {
+		printf("Files per second: %.1f\n",
+		       (double)ctx->ops[MD_PERF_FORGET].count * ticks_hz / spdk_max(elapsed, 1));
+		md_perf_release_root(ctx);
+	}
+}
+
+static void
+md_perf_slot_done(struct md_perf_slot *slot, enum md_perf_op op, int status)
+{
+	struct md_perf_context *ctx = slot->ctx;
+
+	md_perf_stats_add(&ctx->ops[op], spdk_get_ticks() - slot->submit_tsc);
+
+	if (status != 0) {
+		SPDK_ERRLOG("%s of %s failed with %d\n", g_op_names[op], slot->name, status);
+		ctx->rc = status;
+		ctx->stopping = true;
+	}
+}
+
+static void
+md_perf_slot_stop(struct md_perf_slot *slot)
+{
+	struct md_perf_context *ctx = slot->ctx;
+
+	assert(ctx->outstanding > 0);
+	if (--ctx->outstanding == 0) {
+		md_perf_finish(ctx);
+	}
+}
+
+static void
+md_perf_forget_cb(void *cb_arg, struct spdk_io_channel *ch, int status)
+{
+	struct md_perf_slot *slot = cb_arg;
+
+	md_perf_slot_done(slot, MD_PERF_FORGET, status);
+	slot->fobject = NULL;
+	md_perf_slot_start(slot);
+}
+
+static void
+md_perf_unlink_cb(void *cb_arg, struct spdk_io_channel *ch, int status)
+{
+	struct md_perf_slot *slot = cb_arg;
+	struct md_perf_context *ctx = slot->ctx;
+	int rc;
+
+	md_perf_slot_done(slot, MD_PERF_UNLINK, status);
+
+	slot->submit_tsc = spdk_get_ticks();
+	rc = spdk_fsdev_forget(ctx->desc, ctx->ch, ctx->unique++, slot->fobject, 1,
+			       md_perf_forget_cb, slot);
+	if (rc != 0) {
+		md_perf_forget_cb(slot, ctx->ch, rc);
+	}
+}
+
+static void
+md_perf_release_cb(void *cb_arg, struct spdk_io_channel *ch, int status)
+{
+	struct md_perf_slot *slot = cb_arg;
+	struct md_perf_context *ctx = slot->ctx;
+	int rc;
+
+	md_perf_slot_done(slot, MD_PERF_RELEASE, status);
+	slot->fhandle = NULL;
+
+	slot->submit_tsc = spdk_get_ticks();
+	rc = spdk_fsdev_unlink(ctx->desc, ctx->ch, ctx->unique++, ctx->root, slot->name,
+			       md_perf_unlink_cb, slot);
+	if (rc != 0) {
+		md_perf_unlink_cb(slot, ctx->ch, rc);
+	}
+}
+
+static void
+md_perf_getattr_cb(void *cb_arg, struct spdk_io_channel *ch, int status,
+		   const struct spdk_fsdev_file_attr *attr)
+{
+	struct md_perf_slot *slot = cb_arg;
+	struct md_perf_context *ctx = slot->ctx;
+	int rc;
+
+	md_perf_slot_done(slot, MD_PERF_GETATTR, status);
+
+	slot->submit_tsc = spdk_get_ticks();
+	rc = spdk_fsdev_release(ctx->desc, ctx->ch, ctx->unique++, slot->fobject, slot->fhandle,
+				md_perf_release_cb, slot);
+	if (rc != 0) {
+		md_perf_release_cb(slot, ctx->ch, rc);
+	}
+}
+
+static void
+md_perf_create_cb(void *cb_arg, struct spdk_io_channel *ch, int status,
+		  struct spdk_fsdev_file_object *fobject, const struct spdk_fsdev_file_attr *attr,
+		  struct spdk_fsdev_file_handle *fhandle)
+{
+	struct md_perf_slot *slot = cb_arg;
+	struct md_perf_context *ctx = slot->ctx;
+	int rc;
+
+	md_perf_slot_done(slot, MD_PERF_CREATE, status);
+	if (status != 0) {
+		md_perf_slot_stop(slot);
+		return;
+	}
+
+	slot->fobject = fobject;
+	slot->fhandle = fhandle;
+
+	slot->submit_tsc = spdk_get_ticks();
+	rc = spdk_fsdev_getattr(ctx->desc, ctx->ch, ctx->unique++, slot->fobject, slot->fhandle,
+				md_perf_getattr_cb, slot);
+	if (rc != 0) {
+		md_perf_getattr_cb(slot, ctx->ch, rc, NULL);
+	}
+}
+
+static void
+md_perf_lookup_getattr_cb(void *cb_arg, struct spdk_io_channel *ch, int status,
+			  const struct spdk_fsdev_file_attr *attr)
+{
+	struct md_perf_slot *slot = cb_arg;
+	struct md_perf_context *ctx = slot->ctx;
+	int rc;
+
+	md_perf_slot_done(slot, MD_PERF_GETATTR, status);
+
+	slot->submit_tsc = spdk_get_ticks();
+	rc = spdk_fsdev_forget(ctx->desc, ctx->ch, ctx->unique++, slot->fobject, 1,
+			       md_perf_forget_cb, slot);
+	if (rc != 0) {
+		md_perf_forget_cb(slot, ctx->ch, rc);
+	}
+}
+
+static void
+md_perf_lookup_cb(void *cb_arg, struct spdk_io_channel *ch, int status,
+		  struct spdk_fsdev_file_object *fobject, const struct spdk_fsdev_file_attr *attr)
+{
+	struct md_perf_slot *slot = cb_arg;
+	struct md_perf_context *ctx = slot->ctx;
+	int rc;
+
+	if (slot->missing && status == -ENOENT) {
+		status = 0;
+		fobject = NULL;
+	}
+
+	md_perf_slot_done(slot, MD_PERF_LOOKUP, status);
+	if (status != 0 || fobject == NULL) {
+		md_perf_slot_start(slot);
+		return;
+	}
+
+	slot->fobject = fobject;
+
+	slot->submit_tsc = spdk_get_ticks();
+	rc = spdk_fsdev_getattr(ctx->desc, ctx->ch, ctx->unique++, slot->fobject, NULL,
+				md_perf_lookup_getattr_cb, slot);
+	if (rc != 0) {
+		md_perf_lookup_getattr_cb(slot, ctx->ch, rc, NULL);
+	}
+}
+
+static void
+md_perf_lookup_start(struct md_perf_slot *slot)
+{
+	struct md_perf_context *ctx = slot->ctx;
+	uint32_t idx = rand_r(&slot->seed) % g_num_files;
+	int rc;
+
+	slot->missing = (uint32_t)rand_r(&slot->seed) % 100 < g_miss_percent;
+	snprintf(slot->name, sizeof(slot->name), "md_perf_%s_%" PRIu32,
+		 slot->missing ? "missing" : "file", idx);
+
+	slot->submit_tsc = spdk_get_ticks();
+	rc = spdk_fsdev_lookup(ctx->desc, ctx->ch, ctx->unique++, ctx->root, slot->name,
+			       md_perf_lookup_cb, slot);
+	if (rc != 0) {
+		md_perf_lookup_cb(slot, ctx->ch, rc, NULL, NULL);
+	}
+}
+
+static void
+md_perf_slot_start(struct md_perf_slot *slot)
+{
+	struct md_perf_context *ctx = slot->ctx;
+	int rc;
+
+	if (ctx->stopping) {
+		md_perf_slot_stop(slot);
+		return;
+	}
+
+	if (g_lookup_workload) {
+		md_perf_lookup_start(slot);
+		return;
+	}
+
+	slot->submit_tsc = spdk_get_ticks();
+	rc = spdk_fsdev_create(ctx->desc, ctx->ch, ctx->unique++, ctx->root, slot->name,
+			       S_IFREG | S_IRUSR | S_IWUSR, O_RDWR | O_CREAT, 0, geteuid(), getegid(),
+			       md_perf_create_cb, slot);
+	if (rc != 0) {
+		md_perf_create_cb(slot, ctx->ch, rc, NULL, NULL, NULL);
+	}
+}
+
+static int
+md_perf_probe(void *arg)
+{
+	struct md_perf_context *ctx = arg;
+	uint64_t now = spdk_get_ticks();
+
+	if (now > ctx->probe_next_tsc) {
+		md_perf_stats_add(&ctx->probe_delay, now - ctx->probe_next_tsc);
+	} else {
+		md_perf_stats_add(&ctx->probe_delay, 0);
+	}
+
+	ctx->probe_next_tsc = now + g_probe_period_us * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+
+	return SPDK_POLLER_BUSY;
+}
+
+static int
+md_perf_timer(void *arg)
+{
+	struct md_perf_context *ctx = arg;
+
+	spdk_poller_unregister(&ctx->timer);
+	ctx->stopping = true;
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+md_perf_run(struct md_perf_context *ctx)
+{
+	uint32_t i;
+
+	ctx->start_tsc = spdk_get_ticks();
+	ctx->probe_next_tsc = ctx->start_tsc + g_probe_period_us * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	ctx->probe = SPDK_POLLER_REGISTER(md_perf_probe, ctx, g_probe_period_us);
+	ctx->timer = SPDK_POLLER_REGISTER(md_perf_timer, ctx, g_time_in_sec * SPDK_SEC_TO_USEC);
+
+	ctx->outstanding = g_queue_depth;
+	for (i = 0; i < g_queue_depth; i++) {
+		ctx->slots[i].ctx = ctx;
+		ctx->slots[i].seed = i + 1;
+		snprintf(ctx->slots[i].name, sizeof(ctx->slots[i].name), "md_perf_%" PRIu32, i);
+		md_perf_slot_start(&ctx->slots[i]);
+	}
+}
+
+static void md_perf_populate(struct md_perf_context *ctx);
+
+static void
+md_perf_populate_forget_cb(void *cb_arg, struct spdk_io_channel *ch, int status)
+{
+	struct md_perf_context *ctx = cb_arg;
+
+	ctx->num_files++;
+	md_perf_populate(ctx);
+}
+
+static void
+md_perf_populate_cb(void *cb_arg, struct spdk_io_channel *ch, int status,
+		    struct spdk_fsdev_file_object *fobject, const struct spdk_fsdev_file_attr *attr)
+{
+	struct md_perf_context *ctx = cb_arg;
+	int rc;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Creation of md_perf_file_%" PRIu32 " failed with %d\n", ctx->num_files,
+			    status);
+		ctx->rc = status;
+		md_perf_cleanup(ctx);
+		return;
+	}
+
+	rc = spdk_fsdev_forget(ctx->desc, ctx->ch, ctx->unique++, fobject, 1,
+			       md_perf_populate_forget_cb, ctx);
+	if (rc != 0) {
+		md_perf_populate_forget_cb(ctx, ctx->ch, rc);
+	}
+}
+
+/* Creates the files of the lookup workload one by one, then starts the run */
+static void
+md_perf_populate(struct md_perf_context *ctx)
+{
+	char name[32];
+	int rc;
+
+	if (ctx->num_files == g_num_files) {
+		md_perf_run(ctx);
+		return;
+	}
+
+	snprintf(name, sizeof(name), "md_perf_file_%" PRIu32, ctx->num_files);
+	rc = spdk_fsdev_mknod(ctx->desc, ctx->ch, ctx->unique++, ctx->root, name,
+			      S_IFREG | S_IRUSR | S_IWUSR, 0, geteuid(), getegid(),
+			      md_perf_populate_cb, ctx);
+	if (rc != 0) {
+		md_perf_populate_cb(ctx, ctx->ch, rc, NULL, NULL);
+	}
+}
+
+static void
+md_perf_root_lookup_cb(void *cb_arg, struct spdk_io_channel *ch, int status,
+		       struct spdk_fsdev_file_object *fobject, const struct spdk_fsdev_file_attr *attr)
+{
+	struct md_perf_context *ctx = cb_arg;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Root lookup failed with %d\n", status);
+		spdk_put_io_channel(ctx->ch);
+		spdk_fsdev_close(ctx->desc);
+		spdk_app_stop(status);
+		return;
+	}
+
+	ctx->root = fobject;
+	if (g_lookup_workload) {
+		md_perf_populate(ctx);
+	} else {
+		md_perf_run(ctx);
+	}
+}
+
+static void
+md_perf_event_cb(enum spdk_fsdev_event_type type, struct spdk_fsdev *fsdev, void *event_ctx)
+{
+	SPDK_NOTICELOG("Unsupported fsdev event: type %d\n", type);
+}
+
+static void
+md_perf_start(void *arg)
+{
+	struct md_perf_context *ctx = arg;
+	int rc;
+
+	rc = spdk_fsdev_open(g_fsdev_name, md_perf_event_cb, NULL, &ctx->desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Could not open fsdev %s: %d\n", g_fsdev_name, rc);
+		spdk_app_stop(rc);
+		return;
+	}
+
+	ctx->ch = spdk_fsdev_get_io_channel(ctx->desc);
+	if (ctx->ch == NULL) {
+		SPDK_ERRLOG("Could not get an I/O channel\n");
+		spdk_fsdev_close(ctx->desc);
+		spdk_app_stop(-ENOMEM);
+		return;
+	}
+
+	rc = spdk_fsdev_lookup(ctx->desc, ctx->ch, ctx->unique++, NULL, "", md_perf_root_lookup_cb,
+			       ctx);
+	if (rc != 0) {
+		md_perf_root_lookup_cb(ctx, ctx->ch, rc, NULL, NULL);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	struct spdk_app_opts opts = {};
+	int rc;
+
+	spdk_app_opts_init(&opts, sizeof(opts));
+	opts.name = "fsdev_md_perf";
+
+	rc = spdk_app_parse_args(argc, argv, &opts, "f:M:N:P:Q:T:w:", NULL, md_perf_parse_arg,
+				 md_perf_usage);
+	if (rc != SPDK_APP_PARSE_ARGS_SUCCESS) {
+		exit(rc);
+	}
+
+	rc = spdk_app_start(&opts, md_perf_start, &g_ctx);
+	if (rc != 0) {
+		SPDK_ERRLOG("ERROR running the application\n");
+	}
+
+	spdk_app_fini();
+
+	return rc;
+}
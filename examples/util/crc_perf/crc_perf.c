@@ -0,0 +1,199 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/crc16.h"
+#include "spdk/crc32.h"
+#include "spdk/crc64.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+
+#define MAX_BUF_SIZE	(1024 * 1024)
+/* Number of bytes checksummed between two checks of the elapsed time */
+#define BYTES_PER_BATCH	(256 * 1024)
+
+struct crc_algo {
+	const char	*name;
+	uint64_t	(*update)(const void *buf, size_t len, uint64_t crc);
+};
+
+static uint64_t
+crc_perf_crc32c(const void *buf, size_t len, uint64_t crc)
+{
+	return spdk_crc32c_update(buf, len, crc);
+}
+
+static uint64_t
+crc_perf_crc32_ieee(const void *buf, size_t len, uint64_t crc)
+{
+	return spdk_crc32_ieee_update(buf, len, crc);
+}
+
+static uint64_t
+crc_perf_crc16_t10dif(const void *buf, size_t len, uint64_t crc)
+{
+	return spdk_crc16_t10dif(crc, buf, len);
+}
+
+static uint64_t
+crc_perf_crc64_nvme(const void *buf, size_t len, uint64_t crc)
+{
+	return spdk_crc64_nvme(buf, len, crc);
+}
+
+static const struct crc_algo g_algos[] = {
+	{ "crc32c", crc_perf_crc32c },
+	{ "crc32_ieee", crc_perf_crc32_ieee },
+	{ "crc16_t10dif", crc_perf_crc16_t10dif },
+	{ "crc64_nvme", crc_perf_crc64_nvme },
+};
+
+static const size_t g_default_sizes[] = { 64, 256, 512, 4096, 65536, MAX_BUF_SIZE };
+
+static const char *g_algo_name;
+static size_t g_size;
+static size_t g_offset;
+static int g_time_in_msec = 250;
+
+static double
+crc_perf_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+crc_perf_run(const struct crc_algo *algo, const uint8_t *buf, size_t size)
+{
+	uint64_t crc = 0, iters = 0, batch;
+	double start, elapsed;
+	uint64_t i;
+
+	batch = spdk_max(BYTES_PER_BATCH / size, 1);
+
+	/* Warm up the caches and the tables */
+	crc = algo->update(buf, size, crc);
+
+	start = crc_perf_now();
+	do {
+		for (i = 0; i < batch; i++) {
+			crc = algo->update(buf, size, crc);
+		}
+		iters += batch;
+		elapsed = crc_perf_now() - start;
+	} while (elapsed * 1000 < g_time_in_msec);
+
+	printf("%-14s %10zu %12.3f %12.1f   (crc 0x%" PRIx64 ")\n", algo->name, size,
+	       iters * size / elapsed / (1024 * 1024 * 1024), elapsed * 1e9 / iters, crc);
+}
+
+static void
+usage(const char *prog)
+{
+	printf("usage: %s [options]\n", prog);
+	printf("options:\n");
+	printf("\t[-a algorithm: crc32c, crc32_ieee, crc16_t10dif or crc64_nvme (default: all)]\n");
+	printf("\t[-s buffer size in bytes, up to %d (default: 64 to %d)]\n", MAX_BUF_SIZE,
+	       MAX_BUF_SIZE);
+	printf("\t[-o offset of the buffer from a 64-byte boundary (default: 0)]\n");
+	printf("\t[-t time in milliseconds per algorithm and size (default: %d)]\n",
+	       g_time_in_msec);
+}
+
+static int
+parse_args(int argc, char **argv)
+{
+	long val;
+	int op;
+
+	while ((op = getopt(argc, argv, "a:ho:s:t:")) != -1) {
+		switch (op) {
+		case 'a':
+			g_algo_name = optarg;
+			break;
+		case 'o':
+			val = spdk_strtol(optarg, 10);
+			if (val < 0 || val >= 64) {
+				fprintf(stderr, "Invalid offset: %s\n", optarg);
+				return -EINVAL;
+			}
+			g_offset = val;
+			break;
+		case 's':
+			val = spdk_strtol(optarg, 10);
+			if (val <= 0 || val > MAX_BUF_SIZE) {
+				fprintf(stderr, "Invalid buffer size: %s\n", optarg);
+				return -EINVAL;
+			}
+			g_size = val;
+			break;
+		case 't':
+			g_time_in_msec = spdk_strtol(optarg, 10);
+			if (g_time_in_msec <= 0) {
+				fprintf(stderr, "Invalid time: %s\n", optarg);
+				return -EINVAL;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	uint8_t *buf;
+	size_t i, j;
+	bool found = false;
+
+	if (parse_args(argc, argv) != 0) {
+		return 1;
+	}
+
+	if (posix_memalign((void **)&buf, 64, MAX_BUF_SIZE + 64) != 0) {
+		fprintf(stderr, "Failed to allocate the data buffer\n");
+		return 1;
+	}
+
+	for (i = 0; i < MAX_BUF_SIZE + 64; i++) {
+		buf[i] = rand();
+	}
+
+	printf("%-14s %10s %12s %12s\n", "Algorithm", "Size", "GiB/s", "ns/call");
+	for (i = 0; i < SPDK_COUNTOF(g_algos); i++) {
+		if (g_algo_name != NULL && strcmp(g_algo_name, g_algos[i].name) != 0) {
+			continue;
+		}
+
+		found = true;
+		if (g_size != 0) {
+			crc_perf_run(&g_algos[i], buf + g_offset, g_size);
+			continue;
+		}
+
+		for (j = 0; j < SPDK_COUNTOF(g_default_sizes); j++) {
+			crc_perf_run(&g_algos[i], buf + g_offset, g_default_sizes[j]);
+		}
+	}
+
+	free(buf);
+
+	if (!found) {
+		fprintf(stderr, "Unknown algorithm: %s\n", g_algo_name);
+		usage(argv[0]);
+		return 1;
+	}
+
+	return 0;
+}
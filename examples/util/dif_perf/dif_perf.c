@@ -0,0 +1,297 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/dif.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+
+#define MAX_NUM_BLOCKS	1024
+/* Number of bytes processed between two checks of the elapsed time */
+#define BYTES_PER_BATCH	(1024 * 1024)
+
+struct dif_format {
+	enum spdk_dif_pi_format	pi_format;
+	const char		*name;
+	uint32_t		data_size;
+	uint32_t		md_size;
+};
+
+static const struct dif_format g_formats[] = {
+	{ SPDK_DIF_PI_FORMAT_16, "pi16", 512, 8 },
+	{ SPDK_DIF_PI_FORMAT_32, "pi32", 4096, 16 },
+	{ SPDK_DIF_PI_FORMAT_64, "pi64", 4096, 16 },
+};
+
+static const char *g_format_name;
+static uint32_t g_data_size;
+static uint32_t g_md_size;
+static uint32_t g_num_blocks = 32;
+static bool g_dix;
+static bool g_split;
+static int g_time_in_msec = 250;
+
+static uint8_t *g_buf;
+static uint8_t *g_md_buf;
+static struct iovec g_iovs[2 * MAX_NUM_BLOCKS];
+static int g_iovcnt;
+static struct iovec g_md_iov;
+
+static double
+dif_perf_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Describe the buffer either with a single iovec, or, in split mode, with two iovecs per
+ * block to exercise the paths handling blocks that are not contiguous in memory.
+ */
+static void
+dif_perf_setup_iovs(uint32_t block_size)
+{
+	uint32_t i, half = block_size / 2;
+
+	if (!g_split) {
+		g_iovs[0].iov_base = g_buf;
+		g_iovs[0].iov_len = block_size * g_num_blocks;
+		g_iovcnt = 1;
+		return;
+	}
+
+	for (i = 0; i < g_num_blocks; i++) {
+		g_iovs[2 * i].iov_base = g_buf + i * block_size;
+		g_iovs[2 * i].iov_len = half;
+		g_iovs[2 * i + 1].iov_base = g_buf + i * block_size + half;
+		g_iovs[2 * i + 1].iov_len = block_size - half;
+	}
+	g_iovcnt = 2 * g_num_blocks;
+}
+
+static int
+dif_perf_generate(const struct spdk_dif_ctx *ctx)
+{
+	if (g_dix) {
+		return spdk_dix_generate(g_iovs, g_iovcnt, &g_md_iov, g_num_blocks, ctx);
+	}
+
+	return spdk_dif_generate(g_iovs, g_iovcnt, g_num_blocks, ctx);
+}
+
+static int
+dif_perf_verify(const struct spdk_dif_ctx *ctx)
+{
+	struct spdk_dif_error err_blk;
+
+	if (g_dix) {
+		return spdk_dix_verify(g_iovs, g_iovcnt, &g_md_iov, g_num_blocks, ctx, &err_blk);
+	}
+
+	return spdk_dif_verify(g_iovs, g_iovcnt, g_num_blocks, ctx, &err_blk);
+}
+
+static int
+dif_perf_measure(int (*fn)(const struct spdk_dif_ctx *ctx), const struct spdk_dif_ctx *ctx,
+		 uint32_t data_size, double *gib_per_sec, double *mblocks_per_sec)
+{
+	uint64_t iters = 0, batch, i;
+	double start, elapsed;
+	int rc;
+
+	batch = spdk_max(BYTES_PER_BATCH / ((uint64_t)data_size * g_num_blocks), 1);
+
+	start = dif_perf_now();
+	do {
+		for (i = 0; i < batch; i++) {
+			rc = fn(ctx);
+			if (rc != 0) {
+				return rc;
+			}
+		}
+		iters += batch;
+		elapsed = dif_perf_now() - start;
+	} while (elapsed * 1000 < g_time_in_msec);
+
+	*gib_per_sec = iters * g_num_blocks * data_size / elapsed / (1024 * 1024 * 1024);
+	*mblocks_per_sec = iters * g_num_blocks / elapsed / 1e6;
+
+	return 0;
+}
+
+static int
+dif_perf_run(const struct dif_format *format)
+{
+	struct spdk_dif_ctx ctx;
+	struct spdk_dif_ctx_init_ext_opts dif_opts;
+	uint32_t data_size, md_size, block_size;
+	double gen_gib, gen_mblocks, ver_gib, ver_mblocks;
+	int rc;
+
+	data_size = g_data_size != 0 ? g_data_size : format->data_size;
+	md_size = g_md_size != 0 ? g_md_size : format->md_size;
+	block_size = g_dix ? data_size : data_size + md_size;
+
+	dif_opts.size = SPDK_SIZEOF(&dif_opts, dif_pi_format);
+	dif_opts.dif_pi_format = format->pi_format;
+	rc = spdk_dif_ctx_init(&ctx, block_size, md_size, !g_dix, false, SPDK_DIF_TYPE1,
+			       SPDK_DIF_FLAGS_GUARD_CHECK | SPDK_DIF_FLAGS_APPTAG_CHECK |
+			       SPDK_DIF_FLAGS_REFTAG_CHECK, 0, 0xFFFF, 0x1234, 0, 0, &dif_opts);
+	if (rc != 0) {
+		fprintf(stderr, "Invalid format for %s: %u+%u\n", format->name, data_size, md_size);
+		return rc;
+	}
+
+	dif_perf_setup_iovs(block_size);
+	g_md_iov.iov_base = g_md_buf;
+	g_md_iov.iov_len = md_size * g_num_blocks;
+
+	rc = dif_perf_measure(dif_perf_generate, &ctx, data_size, &gen_gib, &gen_mblocks);
+	if (rc != 0) {
+		fprintf(stderr, "Failed to generate protection information: %d\n", rc);
+		return rc;
+	}
+
+	rc = dif_perf_measure(dif_perf_verify, &ctx, data_size, &ver_gib, &ver_mblocks);
+	if (rc != 0) {
+		fprintf(stderr, "Failed to verify protection information: %d\n", rc);
+		return rc;
+	}
+
+	printf("%-6s %-4s %9u %5u %8u %10.3f %10.3f %10.3f %10.3f\n", format->name,
+	       g_dix ? "dix" : "dif", data_size, md_size, g_num_blocks,
+	       gen_gib, gen_mblocks, ver_gib, ver_mblocks);
+
+	return 0;
+}
+
+static void
+usage(const char *prog)
+{
+	printf("usage: %s [options]\n", prog);
+	printf("options:\n");
+	printf("\t[-f PI format: pi16, pi32 or pi64 (default: all)]\n");
+	printf("\t[-b data block size in bytes (default: 512 for pi16, 4096 otherwise)]\n");
+	printf("\t[-m metadata size in bytes (default: 8 for pi16, 16 otherwise)]\n");
+	printf("\t[-n number of blocks per call, up to %d (default: %u)]\n", MAX_NUM_BLOCKS,
+	       g_num_blocks);
+	printf("\t[-x use a separate metadata buffer (DIX)]\n");
+	printf("\t[-S split each block between two iovecs]\n");
+	printf("\t[-t time in milliseconds per format and operation (default: %d)]\n",
+	       g_time_in_msec);
+}
+
+static int
+parse_args(int argc, char **argv)
+{
+	long val;
+	int op;
+
+	while ((op = getopt(argc, argv, "b:f:hm:n:St:x")) != -1) {
+		switch (op) {
+		case 'b':
+			val = spdk_strtol(optarg, 10);
+			if (val <= 0 || val > 65536) {
+				fprintf(stderr, "Invalid data block size: %s\n", optarg);
+				return -EINVAL;
+			}
+			g_data_size = val;
+			break;
+		case 'f':
+			g_format_name = optarg;
+			break;
+		case 'm':
+			val = spdk_strtol(optarg, 10);
+			if (val <= 0 || val > 4096) {
+				fprintf(stderr, "Invalid metadata size: %s\n", optarg);
+				return -EINVAL;
+			}
+			g_md_size = val;
+			break;
+		case 'n':
+			val = spdk_strtol(optarg, 10);
+			if (val <= 0 || val > MAX_NUM_BLOCKS) {
+				fprintf(stderr, "Invalid number of blocks: %s\n", optarg);
+				return -EINVAL;
+			}
+			g_num_blocks = val;
+			break;
+		case 'S':
+			g_split = true;
+			break;
+		case 't':
+			g_time_in_msec = spdk_strtol(optarg, 10);
+			if (g_time_in_msec <= 0) {
+				fprintf(stderr, "Invalid time: %s\n", optarg);
+				return -EINVAL;
+			}
+			break;
+		case 'x':
+			g_dix = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			usage(argv[0]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t buf_size, md_buf_size, i;
+	bool found = false;
+	int rc = 0;
+
+	if (parse_args(argc, argv) != 0) {
+		return 1;
+	}
+
+	buf_size = (size_t)(spdk_max(g_data_size, 4096) + spdk_max(g_md_size, 16)) * g_num_blocks;
+	md_buf_size = (size_t)spdk_max(g_md_size, 16) * g_num_blocks;
+
+	if (posix_memalign((void **)&g_buf, 64, buf_size) != 0 ||
+	    posix_memalign((void **)&g_md_buf, 64, md_buf_size) != 0) {
+		fprintf(stderr, "Failed to allocate the data buffers\n");
+		return 1;
+	}
+
+	for (i = 0; i < buf_size; i++) {
+		g_buf[i] = rand();
+	}
+	memset(g_md_buf, 0, md_buf_size);
+
+	printf("%-6s %-4s %9s %5s %8s %10s %10s %10s %10s\n", "Format", "Mode", "Data", "MD",
+	       "Blocks", "Gen GiB/s", "Gen Mblk/s", "Ver GiB/s", "Ver Mblk/s");
+	for (i = 0; i < SPDK_COUNTOF(g_formats); i++) {
+		if (g_format_name != NULL && strcmp(g_format_name, g_formats[i].name) != 0) {
+			continue;
+		}
+
+		found = true;
+		rc = dif_perf_run(&g_formats[i]);
+		if (rc != 0) {
+			break;
+		}
+	}
+
+	free(g_buf);
+	free(g_md_buf);
+
+	if (!found) {
+		fprintf(stderr, "Unknown PI format: %s\n", g_format_name);
+		usage(argv[0]);
+		return 1;
+	}
+
+	return rc == 0 ? 0 : 1;
+}
@@ -357,6 +357,23 @@ int spdk_accel_submit_decompress_ext(struct spdk_io_channel *ch, struct iovec *d
 				     enum spdk_accel_comp_algo decomp_algo, uint32_t *output_size,
 				     spdk_accel_completion_cb cb_fn, void *cb_arg);
 
+/**
+ * Check whether data is likely incompressible.  The Shannon entropy of a sample of the data is
+ * compared against a threshold (see `compress_sample_size` and `compress_entropy_threshold` in
+ * `spdk_accel_opts`), which takes a fraction of the time a compression operation would.  This
+ * allows users to store incompressible data as is, without spending a full compression pass on
+ * it only to discard its output.
+ *
+ * \param ch I/O channel, the result is accounted in its statistics.
+ * \param iovs The io vector array which stores the data.
+ * \param iovcnt The size of the io vectors.
+ *
+ * \return true if the data is likely incompressible, false otherwise or if the check is
+ * disabled.
+ */
+bool spdk_accel_compress_is_incompressible(struct spdk_io_channel *ch, struct iovec *iovs,
+		size_t iovcnt);
+
 /**
  * Gets the level range of the specified algorithm.
  *
@@ -1090,6 +1107,54 @@ int spdk_accel_get_opc_module_name(enum spdk_accel_opcode opcode, const char **m
  */
 int spdk_accel_assign_opc(enum spdk_accel_opcode opcode, const char *name);
 
+/** Maximum number of modules an opcode can be balanced across */
+#define SPDK_ACCEL_BALANCE_MAX_MODULES 4
+
+enum spdk_accel_balance_policy {
+	/**
+	 * Use the modules in the order they were specified, moving on to the next one once
+	 * there are `queue_depth` operations outstanding on a module.
+	 */
+	SPDK_ACCEL_BALANCE_SPILLOVER,
+	/**
+	 * Use the module with the lowest expected completion time, based on the number of
+	 * outstanding operations and the latency observed on each module.
+	 */
+	SPDK_ACCEL_BALANCE_LATENCY,
+};
+
+/**
+ * Balance the execution of an opcode across several modules.  Each IO channel routes the
+ * operations to the modules according to the policy.  An operation rejected by a module due to
+ * a lack of resources (-EBUSY or -ENOMEM) is resubmitted to the other modules.  The first
+ * module is the one reported as assigned to the opcode.  Encrypt and decrypt operations can't be
+ * balanced, as the crypto keys are bound to a single module.
+ *
+ * Calling `spdk_accel_assign_opc()` for the same opcode disables the balancing.
+ *
+ * \param opcode Accel Framework Opcode enum value.
+ * \param names Names of the modules to balance the opcode across.
+ * \param num_modules Number of modules, between 2 and SPDK_ACCEL_BALANCE_MAX_MODULES.
+ * \param policy Policy used to select the module executing an operation.
+ * \param queue_depth Maximum number of operations outstanding on a module on a single IO
+ * channel before the operations are routed to the other modules.
+ *
+ * \return 0 on success, -EINVAL if the parameters are invalid or if the framework has started,
+ * -ENOMEM if memory couldn't be allocated.
+ */
+int spdk_accel_assign_opc_modules(enum spdk_accel_opcode opcode, const char **names,
+				  uint32_t num_modules, enum spdk_accel_balance_policy policy,
+				  uint32_t queue_depth);
+
+/**
+ * Get the name of a balancing policy.
+ *
+ * \param policy Balancing policy.
+ *
+ * \return Name of the policy or NULL if the policy is invalid.
+ */
+const char *spdk_accel_get_balance_policy_name(enum spdk_accel_balance_policy policy);
+
 struct spdk_json_write_ctx;
 
 /**
@@ -1136,13 +1201,34 @@ struct spdk_accel_opts {
 	uint32_t	small_cache_size;
 	/** Size of the large iobuf cache */
 	uint32_t	large_cache_size;
-	/** Maximum number of tasks per IO channel */
+	/** Number of tasks allocated with each IO channel */
 	uint32_t	task_count;
-	/** Maximum number of sequences per IO channel */
+	/** Number of sequences allocated with each IO channel */
 	uint32_t	sequence_count;
-	/** Maximum number of accel buffers per IO channel */
+	/** Number of accel buffers allocated with each IO channel */
 	uint32_t	buf_count;
-
+	/**
+	 * Number of bytes sampled by `spdk_accel_compress_is_incompressible()` to estimate whether
+	 * data is compressible.  The value of 0 disables the check.
+	 */
+	uint32_t	compress_sample_size;
+	/**
+	 * Entropy of the sample, in hundredths of a bit per byte, above which the data is
+	 * considered incompressible.
+	 */
+	uint32_t	compress_entropy_threshold;
+	/**
+	 * Number of tasks, sequences, or accel buffers moved at once between an IO channel and the
+	 * depot of its NUMA node.
+	 */
+	uint32_t	magazine_size;
+	/**
+	 * Maximum number of tasks, sequences, and accel buffers (each) allocated per NUMA node on
+	 * top of the ones allocated with the IO channels, once the channels run out of them.  They
+	 * are allocated magazine_size at a time, the last allocation being smaller if depot_count
+	 * isn't a multiple of magazine_size.  The value of 0 disables the depots.
+	 */
+	uint32_t	depot_count;
 } __attribute__((packed));
 
 /**
@@ -95,7 +95,9 @@ struct spdk_accel_task {
 	uint8_t				op_code;
 	bool				has_aux;
 	int16_t				status;
-	uint8_t				reserved[4];
+	/* Index (plus one) of the module the task was routed to, if its opcode is balanced */
+	uint8_t				balance_idx;
+	uint8_t				reserved[3];
 	struct accel_io_channel		*accel_ch;
 	struct spdk_accel_sequence	*seq;
 	union {
@@ -990,6 +990,9 @@ struct spdk_bdev_io_internal_fields {
 	/** Current tsc at submit time. Used to calculate latency at completion. */
 	uint64_t submit_tsc;
 
+	/** Trace id of the sampled I/O this bdev_io was submitted for, 0 if not sampled. */
+	uint64_t trace_io_id;
+
 	/** Entry to the list io_submitted of struct spdk_bdev_channel */
 	TAILQ_ENTRY(spdk_bdev_io) ch_link;
 
@@ -1116,7 +1119,7 @@ struct spdk_bdev_io {
 		struct spdk_bdev_io_zone_mgmt_params zone_mgmt;
 	} u;
 
-	uint8_t reserved3[40];
+	uint8_t reserved3[16];
 
 	/**
 	 *  Fields that are used internally by the bdev subsystem.  Bdev modules
@@ -198,8 +198,14 @@ struct spdk_app_opts {
 	 * If set, disable CPU claiming.
 	 */
 	bool disable_cpumask_locks;
+
+	/**
+	 * If set, threads schedule their timed pollers on a hierarchical timing wheel
+	 * instead of a red-black tree.  See spdk_thread_lib_set_timer_type().
+	 */
+	bool timer_wheel;
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_app_opts) == 253, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_app_opts) == 254, "Incorrect size");
 
 /**
  * Initialize the default value of opts
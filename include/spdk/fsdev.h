@@ -69,8 +69,18 @@ struct spdk_fsdev_opts {
 	 * Size of fsdev IO objects cache per thread
 	 */
 	uint32_t fsdev_io_cache_size;
+	/**
+	 * Maximum number of directory entries in the lookup cache of each fsdev, 0 to disable the
+	 * cache.  Applies to the fsdevs registered afterwards.
+	 */
+	uint32_t lookup_cache_size;
+	/**
+	 * Time in milliseconds the cached directory entries and attributes remain valid for,
+	 * unless changed through the fsdev earlier.
+	 */
+	uint32_t lookup_cache_lease_ms;
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_fsdev_opts) == 12, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_fsdev_opts) == 20, "Incorrect size");
 
 /** fsdev mount options */
 struct spdk_fsdev_mount_opts {
@@ -128,6 +128,7 @@ typedef STAILQ_HEAD(, spdk_fsdev_io) fsdev_io_stailq_t;
 
 struct spdk_fsdev_file_handle;
 struct spdk_fsdev_file_object;
+struct spdk_fsdev_cache;
 
 
 /** The node ID of the root inode */
@@ -171,6 +172,9 @@ struct spdk_fsdev {
 
 		/** Fsdev name used for quick lookup */
 		struct spdk_fsdev_name fsdev_name;
+
+		/** Dentry and attribute cache, NULL if disabled */
+		struct spdk_fsdev_cache *cache;
 	} internal;
 };
 
@@ -527,6 +531,12 @@ struct spdk_fsdev_io {
 
 		/** Entry to the list io_submitted of struct spdk_fsdev_channel */
 		TAILQ_ENTRY(spdk_fsdev_io) ch_link;
+
+		/** Cache epoch the I/O was submitted in */
+		uint64_t cache_epoch;
+
+		/** Set if the I/O was completed from the cache, without reaching the module */
+		bool cache_hit;
 	} internal;
 
 	/**
@@ -610,6 +620,33 @@ void spdk_fsdev_module_init_done(struct spdk_fsdev_module *module);
  */
 void spdk_fsdev_io_complete(struct spdk_fsdev_io *fsdev_io, int status);
 
+/**
+ * Invalidate what the fsdev layer has cached about a directory entry.
+ *
+ * Modules call it when they learn the entry has been changed by something else than this fsdev
+ * (e.g. another client of the backing filesystem).  The changes made through this fsdev are
+ * accounted for by the layer itself.  Does nothing if the fsdev has no cache.
+ * May be called from any thread.
+ *
+ * \param fsdev Filesystem device.
+ * \param parent_fobject Directory containing the entry.
+ * \param name Name of the entry.
+ */
+void spdk_fsdev_invalidate_entry(struct spdk_fsdev *fsdev,
+				 struct spdk_fsdev_file_object *parent_fobject, const char *name);
+
+/**
+ * Invalidate what the fsdev layer has cached about a file object: its attributes, the entries
+ * resolving to it and, for a directory, its entries.
+ *
+ * Same as spdk_fsdev_invalidate_entry(), for changes made outside of this fsdev.
+ * May be called from any thread.
+ *
+ * \param fsdev Filesystem device.
+ * \param fobject File object.
+ */
+void spdk_fsdev_invalidate_fobject(struct spdk_fsdev *fsdev, struct spdk_fsdev_file_object *fobject);
+
 
 /**
  * Get I/O type
@@ -128,8 +128,11 @@ struct spdk_nvmf_request {
 	/* Timeout tracked for connect and abort flows. */
 	uint64_t timeout_tsc;
 	uint32_t			orig_nsid;
+
+	/* Trace id of the request if it was sampled by spdk_trace_io_sample(), 0 otherwise */
+	uint64_t			trace_io_id;
 };
-SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_request) == 816, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_request) == 840, "Incorrect size");
 
 enum spdk_nvmf_qpair_state {
 	SPDK_NVMF_QPAIR_UNINITIALIZED = 0,
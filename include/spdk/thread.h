@@ -210,6 +210,47 @@ int spdk_thread_lib_init_ext(spdk_thread_op_fn thread_op_fn,
 			     spdk_thread_op_supported_fn thread_op_supported_fn,
 			     size_t ctx_sz, size_t msg_mempool_size);
 
+/**
+ * Data structures used by SPDK threads to schedule their timed pollers.
+ */
+enum spdk_thread_timer_type {
+	/**
+	 * Red-black tree ordered by the next expiration.  Insertion costs O(log n), while the
+	 * expiration is exact to a tick.
+	 */
+	SPDK_THREAD_TIMER_RBTREE = 0,
+
+	/**
+	 * Hierarchical timing wheel.  Insertion and expiration cost O(1), while pollers may
+	 * run up to a microsecond after their period elapsed.  Suited to threads with many
+	 * timed pollers.
+	 */
+	SPDK_THREAD_TIMER_WHEEL,
+};
+
+/**
+ * Select the data structure used by SPDK threads to schedule their timed pollers.
+ *
+ * Must be called before any threads are created, i.e. before spdk_thread_lib_init().
+ * The selection is reset to SPDK_THREAD_TIMER_RBTREE by spdk_thread_lib_fini().
+ *
+ * \param type Type of the timer data structure.
+ *
+ * \return 0 on success, -EINVAL if the type is unknown, or -EBUSY if threads were
+ * already created.
+ */
+int spdk_thread_lib_set_timer_type(enum spdk_thread_timer_type type);
+
+/**
+ * Set how often the cycles spent in pollers and messages are measured.
+ *
+ * One out of every `rate` runs of each poller, and of the messages executed by each thread,
+ * is timed and accounted for the `rate` runs.  The default rate is 16.
+ *
+ * \param rate Sampling rate, 1 to time every run, or 0 to disable the accounting.
+ */
+void spdk_thread_lib_set_cycle_sample_rate(uint32_t rate);
+
 /**
  * Release all resources associated with this library.
  */
@@ -511,6 +552,58 @@ uint64_t spdk_thread_get_last_tsc(struct spdk_thread *thread);
  */
 int spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx);
 
+/**
+ * Maximum number of messages sent at once by spdk_thread_send_msg_bulk().
+ */
+#define SPDK_THREAD_MAX_BULK_MSGS 64
+
+/**
+ * Send several messages to the given thread at once.
+ *
+ * The messages are enqueued with a single operation on the message queue of the thread
+ * and are executed in the order of the ctx array, each one calling `fn` with its own
+ * context.  Either all of the messages are sent, or none of them are.
+ *
+ * \param thread The target thread.
+ * \param fn This function will be called on the given thread for each message.
+ * \param ctx Array of contexts passed to fn, one for each message.
+ * \param count Number of messages to send, up to SPDK_THREAD_MAX_BULK_MSGS.
+ *
+ * \return 0 on success
+ * \return -EINVAL if count is larger than SPDK_THREAD_MAX_BULK_MSGS
+ * \return -ENOMEM if the messages could not be allocated
+ * \return -EIO if the messages could not be sent to the destination thread
+ */
+int spdk_thread_send_msg_bulk(const struct spdk_thread *thread, spdk_msg_fn fn, void **ctx,
+			      uint32_t count);
+
+/**
+ * Post a message to the given thread.
+ *
+ * Unlike spdk_thread_send_msg(), the message is held in the outbox of the calling thread
+ * and the messages posted to the same thread are enqueued together, once the outbox is
+ * full or at the end of the current spdk_thread_poll() of the calling thread.  Messages
+ * sent by the calling thread to the same thread with spdk_thread_send_msg() still run
+ * after the ones posted before them.
+ *
+ * A posted message is never dropped: if the message queue of the destination thread is
+ * full, the outbox keeps its messages and enqueues them at a later flush.  In that case,
+ * messages sent to the same thread fail until the outbox is flushed.
+ *
+ * If the calling thread isn't an SPDK thread, or runs in interrupt mode, the message is
+ * sent immediately, like with spdk_thread_send_msg().
+ *
+ * \param thread The target thread.
+ * \param fn This function will be called on the given thread.
+ * \param ctx This context will be passed to fn when called.
+ *
+ * \return 0 on success
+ * \return -ENOMEM if the message could not be allocated
+ * \return -EIO if the message could not be held or sent, because the message queue of the
+ * destination thread is full
+ */
+int spdk_thread_post_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx);
+
 /**
  * Send a message to the given thread. Only one critical message can be outstanding at the same
  * time. It's intended to use this function in any cases that might interrupt the execution of the
@@ -1068,6 +1161,16 @@ void spdk_spin_unlock(struct spdk_spinlock *sspin);
  */
 bool spdk_spin_held(struct spdk_spinlock *sspin);
 
+/** Maximum number of additional iobuf pools between the small and the large one */
+#define SPDK_IOBUF_MAX_MID_CLASSES	6
+
+/**
+ * Number of buckets of the iobuf wait time histograms.  Bucket 0 counts the requests that waited
+ * less than a microsecond for a buffer, bucket i the ones that waited between 2^(i-1) and 2^i
+ * microseconds, and the last bucket all the longer waits.
+ */
+#define SPDK_IOBUF_WAIT_HIST_BUCKETS	24
+
 struct spdk_iobuf_opts {
 	/** Maximum number of small buffers */
 	uint64_t small_pool_count;
@@ -1088,6 +1191,21 @@ struct spdk_iobuf_opts {
 
 	/** Enable per-NUMA node buffer pools */
 	uint8_t	enable_numa;
+
+	/** Maximum number of buffers of each of the additional pools */
+	uint64_t mid_pool_count[SPDK_IOBUF_MAX_MID_CLASSES];
+	/**
+	 * Size of a single buffer of each of the additional pools, sitting between the small and
+	 * the large pool.  The sizes must be increasing, unused entries are set to 0.  A buffer is
+	 * taken from the pool with the smallest buffers able to hold the requested length.
+	 */
+	uint32_t mid_bufsize[SPDK_IOBUF_MAX_MID_CLASSES];
+	/**
+	 * Size of the slabs the pools are allocated in.  If 0, the pools are allocated in full by
+	 * `spdk_iobuf_initialize()`.  Otherwise, each pool starts with a single slab and grows by
+	 * one slab whenever it runs out of buffers, until it reaches its maximum number of buffers.
+	 */
+	uint32_t slab_size;
 };
 
 struct spdk_iobuf_pool_stats {
@@ -1103,6 +1221,10 @@ struct spdk_iobuf_module_stats {
 	struct spdk_iobuf_pool_stats	small_pool;
 	struct spdk_iobuf_pool_stats	large_pool;
 	const char			*module;
+	/** Statistics of the additional pools, in the order of spdk_iobuf_opts.mid_bufsize */
+	struct spdk_iobuf_pool_stats	mid_pool[SPDK_IOBUF_MAX_MID_CLASSES];
+	/** Histogram of the time the requests of the module waited for a buffer */
+	uint64_t			wait_hist[SPDK_IOBUF_WAIT_HIST_BUCKETS];
 };
 
 struct spdk_iobuf_entry;
@@ -1114,6 +1236,10 @@ struct spdk_iobuf_entry {
 	spdk_iobuf_get_cb		cb_fn;
 	const void			*module;
 	STAILQ_ENTRY(spdk_iobuf_entry)	stailq;
+	/** Channel the entry is waiting on */
+	struct spdk_iobuf_channel	*ch;
+	/** Tick at which the entry started waiting */
+	uint64_t			wait_tsc;
 };
 
 struct spdk_iobuf_buffer {
@@ -1138,6 +1264,8 @@ struct spdk_iobuf_pool_cache {
 	uint32_t			bufsize;
 	/** Pool usage statistics */
 	struct spdk_iobuf_pool_stats	stats;
+	/** Number of threads waiting for a buffer of the shared pool */
+	uint32_t			*waiting_threads;
 };
 
 struct spdk_iobuf_node_cache {
@@ -1145,6 +1273,8 @@ struct spdk_iobuf_node_cache {
 	struct spdk_iobuf_pool_cache	small;
 	/** Large buffer memory pool cache */
 	struct spdk_iobuf_pool_cache	large;
+	/** Memory pool caches of the additional buffer sizes */
+	struct spdk_iobuf_pool_cache	mid[SPDK_IOBUF_MAX_MID_CLASSES];
 };
 
 #ifndef SPDK_CONFIG_MAX_NUMA_NODES
@@ -1162,6 +1292,8 @@ struct spdk_iobuf_channel {
 	struct spdk_io_channel		*parent;
 	/* Buffer cache */
 	struct spdk_iobuf_node_cache	cache[SPDK_CONFIG_MAX_NUMA_NODES];
+	/** Histogram of the time the requests made on this channel waited for a buffer */
+	uint64_t			wait_hist[SPDK_IOBUF_WAIT_HIST_BUCKETS];
 };
 
 /**
@@ -1223,7 +1355,9 @@ int spdk_iobuf_unregister_module(const char *name);
  * \param ch iobuf channel to initialize.
  * \param name Name of the module registered via `spdk_iobuf_register_module()`.
  * \param small_cache_size Number of small buffers to be cached by this channel.
- * \param large_cache_size Number of large buffers to be cached by this channel.
+ * \param large_cache_size Number of large buffers to be cached by this channel.  The caches of the
+ * additional pools hold up to the same number of buffers, but are only filled as the buffers are
+ * released to them.
  *
  * \return 0 on success, negative errno otherwise.
  */
@@ -1266,7 +1400,8 @@ void spdk_iobuf_entry_abort(struct spdk_iobuf_channel *ch, struct spdk_iobuf_ent
 
 /**
  * Get a buffer from the iobuf pool. If no buffers are available and entry with cb_fn provided
- * then the request is queued until a buffer becomes available.
+ * then the request is queued until a buffer becomes available, either released on the same thread
+ * or returned to the shared pool by another thread.
  *
  * \param ch iobuf channel.
  * \param len Length of the buffer to retrieve. The user is responsible for making sure the length
@@ -1282,7 +1417,8 @@ void *spdk_iobuf_get(struct spdk_iobuf_channel *ch, uint64_t len, struct spdk_io
 
 /**
  * Release a buffer back to the iobuf pool.  If there are outstanding requests waiting for a buffer,
- * this buffer will be passed to one of them.
+ * this buffer will be passed to one of them.  Otherwise, if requests are waiting on other threads,
+ * the buffers cached by the channel beyond its cache size are returned to the shared pool.
  *
  * \param ch iobuf channel.
  * \param buf Buffer to release
@@ -191,6 +191,40 @@ spdk_get_trace_owner(const struct spdk_trace_file *trace_file, uint16_t owner_id
 	       (((char *)trace_file) + trace_file->owner_offset + owner_id * owner_size);
 }
 
+/**
+ * Trace stream written by spdk_trace_record -z.  The stream begins with the magic number followed
+ * by a copy of struct spdk_trace_file (without its variable sized data), after which any number
+ * of chunks follow, each made of a struct spdk_trace_stream_chunk and its payload.
+ */
+#define SPDK_TRACE_STREAM_MAGIC		0x314d525453545053ULL	/* "SPTSTRM1" */
+
+enum spdk_trace_stream_chunk_type {
+	/**
+	 * Encoded trace entries of a single lcore.  Before encoding, the tsc of each entry is
+	 * replaced by its difference to the tsc of the previous entry in the chunk.  Each entry is
+	 * then split into 64-bit words and stored as the number of significant bytes of each word
+	 * (4 bits per word, the first word in the low bits), followed by these bytes of each word.
+	 */
+	SPDK_TRACE_STREAM_CHUNK_ENTRIES = 0,
+	/** struct spdk_trace_history (without the entries) of a single lcore */
+	SPDK_TRACE_STREAM_CHUNK_HISTORY,
+	/** Owner data, as referenced by spdk_trace_file.owner_offset */
+	SPDK_TRACE_STREAM_CHUNK_OWNERS,
+};
+
+struct spdk_trace_stream_chunk {
+	/** Type of the chunk, one of enum spdk_trace_stream_chunk_type */
+	uint8_t		type;
+	uint8_t		reserved;
+	/** Logical core the chunk describes (unused for owner data) */
+	uint16_t	lcore;
+	/** Size of the payload following this header */
+	uint32_t	size;
+	/** Number of trace entries encoded in the payload (entries chunks only) */
+	uint64_t	num_entries;
+};
+SPDK_STATIC_ASSERT(sizeof(struct spdk_trace_stream_chunk) == 16, "incorrect size");
+
 void _spdk_trace_record(uint64_t tsc, uint16_t tpoint_id, uint16_t owner_id,
 			uint32_t size, uint64_t object_id, int num_args, ...);
 
@@ -472,6 +506,57 @@ void spdk_trace_mask_usage(FILE *f, const char *tmask_arg);
  */
 uint64_t spdk_trace_create_tpoint_group_mask(const char *group_name);
 
+/**
+ * Default value of spdk_trace_get_io_sample_rate().
+ */
+#define SPDK_TRACE_IO_SAMPLE_RATE_DEFAULT 64
+
+/**
+ * Decide whether to trace an I/O through all the layers it goes through (e.g. an NVMe-oF
+ * command, the bdevs it's submitted to, and the NVMe commands sent to the device).
+ *
+ * One out of every spdk_trace_get_io_sample_rate() I/Os is sampled on each thread, as
+ * long as any tracepoint of the "io" tpoint group is enabled.
+ *
+ * \return unique, nonzero trace id if the I/O is sampled, or 0 otherwise.
+ */
+uint64_t spdk_trace_io_sample(void);
+
+/**
+ * Set the rate at which I/Os are sampled by spdk_trace_io_sample().
+ *
+ * \param rate One out of every \b rate I/Os is sampled.  0 disables sampling.
+ */
+void spdk_trace_set_io_sample_rate(uint32_t rate);
+
+/**
+ * Get the rate at which I/Os are sampled by spdk_trace_io_sample().
+ *
+ * \return the sample rate.
+ */
+uint32_t spdk_trace_get_io_sample_rate(void);
+
+/**
+ * Get the trace id of the I/O processed by the calling thread.
+ *
+ * Layers which allocate a request on behalf of another one (e.g. a bdev_io submitted by a
+ * vbdev, or an NVMe command sent by the NVMe bdev) inherit its trace id this way.
+ *
+ * \return trace id of the current I/O, or 0 if it's not sampled.
+ */
+uint64_t spdk_trace_io_get_ctx(void);
+
+/**
+ * Set the trace id of the I/O processed by the calling thread.
+ *
+ * Callers are expected to restore the previous trace id once done processing the I/O.
+ *
+ * \param io_id Trace id of the I/O, 0 if it's not sampled.
+ *
+ * \return the previous trace id.
+ */
+uint64_t spdk_trace_io_set_ctx(uint64_t io_id);
+
 struct spdk_trace_register_fn {
 	const char *name;
 	uint8_t tgroup_id;
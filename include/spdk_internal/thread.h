@@ -14,8 +14,19 @@ struct spdk_poller;
 struct spdk_poller_stats {
 	uint64_t	run_count;
 	uint64_t	busy_count;
+	/* Cycles spent in the poller, estimated from the sampled runs */
+	uint64_t	tsc;
 };
 
+/* Runs of a message function on a thread, estimated from the sampled runs */
+struct spdk_thread_msg_stats {
+	spdk_msg_fn	fn;
+	uint64_t	count;
+	uint64_t	tsc;
+};
+
+typedef void (*spdk_thread_msg_stats_cb)(void *ctx, const struct spdk_thread_msg_stats *stats);
+
 struct io_device;
 struct spdk_thread;
 
@@ -25,6 +36,9 @@ const char *spdk_poller_get_state_str(struct spdk_poller *poller);
 uint64_t spdk_poller_get_period_ticks(struct spdk_poller *poller);
 void spdk_poller_get_stats(struct spdk_poller *poller, struct spdk_poller_stats *stats);
 
+void spdk_thread_get_msg_stats(struct spdk_thread *thread, spdk_thread_msg_stats_cb cb_fn,
+			       void *ctx);
+
 const char *spdk_io_channel_get_io_device_name(struct spdk_io_channel *ch);
 int spdk_io_channel_get_ref_count(struct spdk_io_channel *ch);
 
@@ -52,6 +52,7 @@
 #define TRACE_GROUP_BLOB	0x10
 #define TRACE_GROUP_BDEV_RAID	0x11
 #define TRACE_GROUP_SCHEDULER	0x12
+#define TRACE_GROUP_IO		0x13
 
 /* Bdev tracepoint definitions */
 #define TRACE_BDEV_IO_START		SPDK_TPOINT_ID(TRACE_GROUP_BDEV, 0x0)
@@ -183,4 +184,18 @@
 #define TRACE_SCHEDULER_THREAD_STATS	SPDK_TPOINT_ID(TRACE_GROUP_SCHEDULER, 0x2)
 #define TRACE_SCHEDULER_MOVE_THREAD	SPDK_TPOINT_ID(TRACE_GROUP_SCHEDULER, 0x3)
 
+/* Sampled I/O tracepoint definitions, the object is the I/O's trace id */
+#define TRACE_IO_NVMF_RECV		SPDK_TPOINT_ID(TRACE_GROUP_IO, 0x0)
+#define TRACE_IO_NVMF_EXEC		SPDK_TPOINT_ID(TRACE_GROUP_IO, 0x1)
+#define TRACE_IO_NVMF_COMPLETE		SPDK_TPOINT_ID(TRACE_GROUP_IO, 0x2)
+#define TRACE_IO_NVMF_SENT		SPDK_TPOINT_ID(TRACE_GROUP_IO, 0x3)
+#define TRACE_IO_BDEV_SUBMIT		SPDK_TPOINT_ID(TRACE_GROUP_IO, 0x4)
+#define TRACE_IO_BDEV_COMPLETE		SPDK_TPOINT_ID(TRACE_GROUP_IO, 0x5)
+#define TRACE_IO_NVME_SUBMIT		SPDK_TPOINT_ID(TRACE_GROUP_IO, 0x6)
+#define TRACE_IO_NVME_COMPLETE		SPDK_TPOINT_ID(TRACE_GROUP_IO, 0x7)
+
+/* Whether the trace id of sampled I/Os needs to be passed down the stack */
+#define spdk_trace_io_enabled()	\
+	spdk_unlikely(g_trace_file != NULL && g_trace_file->tpoint_mask[TRACE_GROUP_IO] != 0)
+
 #endif /* SPDK_INTERNAL_TRACE_DEFS */
@@ -8,4 +8,206 @@
 
 #include <liburing.h>
 
+#include "spdk/stdinc.h"
+#include "spdk/env.h"
+#include "spdk/log.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+#include "spdk_internal/assert.h"
+
+/* Size of the sparse tables of registered buffers of the rings */
+#define SPDK_URING_MAX_FIXED_BUFS	1024
+/* io_uring limits the size of a registered buffer to 1GiB */
+#define SPDK_URING_MAX_FIXED_BUF_SIZE	(1ULL << 30)
+
+/*
+ * Memory registered with the env (iobuf pools, guest memory of vhost devices, etc.) is tracked
+ * by a mem map whose translations point to the slots of the buffer tables of the rings.  The
+ * rings are updated lazily by their pollers with spdk_uring_fixed_bufs_sync(), so the
+ * notifications, which may come from any thread, only need to update the table below.
+ */
+struct spdk_uring_buf_table {
+	pthread_mutex_t	mutex;
+	struct iovec	iovs[SPDK_URING_MAX_FIXED_BUFS];
+	/* Incremented on each change of iovs */
+	uint64_t	gen;
+};
+
+#define SPDK_URING_BUF_TABLE_INITIALIZER { .mutex = PTHREAD_MUTEX_INITIALIZER }
+
+/* Buffers registered in a ring, synced with a buffer table */
+struct spdk_uring_fixed_bufs {
+	/* NULL if the ring doesn't use fixed buffers */
+	struct iovec	*iovs;
+	uint64_t	gen;
+};
+
+static inline int
+spdk_uring_buf_table_mem_notify(void *cb_ctx, struct spdk_mem_map *map,
+				enum spdk_mem_map_notify_action action, void *vaddr, size_t size)
+{
+	struct spdk_uring_buf_table *table = cb_ctx;
+	uint64_t len, translation;
+	uint32_t slot = 0;
+	int rc = 0;
+
+	pthread_mutex_lock(&table->mutex);
+	while (size > 0) {
+		len = spdk_min(size, SPDK_URING_MAX_FIXED_BUF_SIZE);
+
+		switch (action) {
+		case SPDK_MEM_MAP_NOTIFY_REGISTER:
+			for (; slot < SPDK_URING_MAX_FIXED_BUFS; slot++) {
+				if (table->iovs[slot].iov_base == NULL) {
+					break;
+				}
+			}
+			if (slot == SPDK_URING_MAX_FIXED_BUFS) {
+				/* Not fatal, the I/Os to this region just don't use fixed buffers */
+				break;
+			}
+			table->iovs[slot].iov_base = vaddr;
+			table->iovs[slot].iov_len = len;
+			rc = spdk_mem_map_set_translation(map, (uint64_t)vaddr, len, slot + 1);
+			break;
+		case SPDK_MEM_MAP_NOTIFY_UNREGISTER:
+			translation = spdk_mem_map_translate(map, (uint64_t)vaddr, NULL);
+			if (translation != 0) {
+				table->iovs[translation - 1].iov_base = NULL;
+				table->iovs[translation - 1].iov_len = 0;
+			}
+			rc = spdk_mem_map_clear_translation(map, (uint64_t)vaddr, len);
+			break;
+		default:
+			SPDK_UNREACHABLE();
+		}
+
+		if (rc != 0) {
+			break;
+		}
+
+		vaddr = (char *)vaddr + len;
+		size -= len;
+	}
+
+	__atomic_fetch_add(&table->gen, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&table->mutex);
+
+	return rc;
+}
+
+static inline int
+spdk_uring_buf_table_mem_contiguous(uint64_t addr_1, uint64_t addr_2)
+{
+	/* Contiguous pages belong to the same registered buffer */
+	return addr_1 == addr_2;
+}
+
+/* Allocates the mem map filling the given buffer table */
+static inline struct spdk_mem_map *
+spdk_uring_buf_table_map_alloc(struct spdk_uring_buf_table *table)
+{
+	const struct spdk_mem_map_ops ops = {
+		.notify_cb = spdk_uring_buf_table_mem_notify,
+		.are_contiguous = spdk_uring_buf_table_mem_contiguous,
+	};
+
+	return spdk_mem_map_alloc(0, &ops, table);
+}
+
+static inline void
+spdk_uring_fixed_bufs_sync(struct spdk_uring_fixed_bufs *bufs, struct io_uring *ring,
+			   struct spdk_uring_buf_table *table)
+{
+	uint32_t i;
+	int rc;
+
+	pthread_mutex_lock(&table->mutex);
+	for (i = 0; i < SPDK_URING_MAX_FIXED_BUFS; i++) {
+		if (bufs->iovs[i].iov_base == table->iovs[i].iov_base &&
+		    bufs->iovs[i].iov_len == table->iovs[i].iov_len) {
+			continue;
+		}
+
+		rc = io_uring_register_buffers_update_tag(ring, i, &table->iovs[i], NULL, 1);
+		if (rc < 0) {
+			/* Most likely RLIMIT_MEMLOCK, stop trying */
+			SPDK_WARNLOG("cannot register buffer %p (len=%zu): %s, fixed buffers disabled\n",
+				     table->iovs[i].iov_base, table->iovs[i].iov_len, spdk_strerror(-rc));
+			io_uring_unregister_buffers(ring);
+			free(bufs->iovs);
+			bufs->iovs = NULL;
+			break;
+		}
+		bufs->iovs[i] = table->iovs[i];
+	}
+	bufs->gen = table->gen;
+	pthread_mutex_unlock(&table->mutex);
+}
+
+static inline bool
+spdk_uring_fixed_bufs_need_sync(struct spdk_uring_fixed_bufs *bufs,
+				struct spdk_uring_buf_table *table)
+{
+	return bufs->iovs != NULL && bufs->gen != __atomic_load_n(&table->gen, __ATOMIC_RELAXED);
+}
+
+/* Registers a sparse buffer table with the ring, to be synced with the given table */
+static inline int
+spdk_uring_fixed_bufs_init(struct spdk_uring_fixed_bufs *bufs, struct io_uring *ring,
+			   struct spdk_uring_buf_table *table)
+{
+	int rc;
+
+	/* Sparse tables require Linux 5.19 */
+	rc = io_uring_register_buffers_sparse(ring, SPDK_URING_MAX_FIXED_BUFS);
+	if (rc != 0) {
+		return rc;
+	}
+
+	bufs->iovs = calloc(SPDK_URING_MAX_FIXED_BUFS, sizeof(*bufs->iovs));
+	if (bufs->iovs == NULL) {
+		io_uring_unregister_buffers(ring);
+		return -ENOMEM;
+	}
+
+	spdk_uring_fixed_bufs_sync(bufs, ring, table);
+
+	return 0;
+}
+
+static inline void
+spdk_uring_fixed_bufs_fini(struct spdk_uring_fixed_bufs *bufs)
+{
+	free(bufs->iovs);
+	bufs->iovs = NULL;
+}
+
+/* Returns the index of the registered buffer containing [addr, addr + len) or -1 */
+static inline int
+spdk_uring_fixed_bufs_get_index(struct spdk_uring_fixed_bufs *bufs, struct spdk_mem_map *map,
+				void *addr, uint64_t len)
+{
+	uint64_t translation, size = len;
+	struct iovec *buf;
+
+	if (bufs->iovs == NULL) {
+		return -1;
+	}
+
+	translation = spdk_mem_map_translate(map, (uint64_t)addr, &size);
+	if (translation == 0 || size < len) {
+		return -1;
+	}
+
+	/* The ring may not be synced with the mem map yet */
+	buf = &bufs->iovs[translation - 1];
+	if ((char *)addr < (char *)buf->iov_base ||
+	    (char *)addr + len > (char *)buf->iov_base + buf->iov_len) {
+		return -1;
+	}
+
+	return translation - 1;
+}
+
 #endif /* SPDK_INTERNAL_URING_H */
@@ -38,10 +38,78 @@
 
 #define ACCEL_CRYPTO_TWEAK_MODE_DEFAULT	SPDK_ACCEL_CRYPTO_TWEAK_MODE_SIMPLE_LBA
 #define ACCEL_TASKS_IN_SEQUENCE_LIMIT	8
+#define ACCEL_COMPRESS_SAMPLE_SIZE	1024
+/* Uniformly distributed bytes sampled this way have an entropy of ~7.8 bits per byte, while
+ * compressible data is usually well below 7 */
+#define ACCEL_COMPRESS_ENTROPY_THRESHOLD	750
+/* Sample a few windows spread over the buffer rather than only its beginning */
+#define ACCEL_COMPRESS_SAMPLE_WINDOWS	4
+#define ACCEL_MAGAZINE_SIZE		32
+#define ACCEL_DEPOT_COUNT		4096
 
 struct accel_module {
 	struct spdk_accel_module_if	*module;
 	bool				supports_memory_domains;
+	bool				supports_fusion;
+};
+
+/* Modules an opcode is balanced across */
+struct accel_balance {
+	char				*names[SPDK_ACCEL_BALANCE_MAX_MODULES];
+	struct spdk_accel_module_if	*modules[SPDK_ACCEL_BALANCE_MAX_MODULES];
+	uint32_t			num_modules;
+	uint32_t			queue_depth;
+	enum spdk_accel_balance_policy	policy;
+};
+
+struct accel_balance_module_channel {
+	struct spdk_io_channel		*ch;
+	uint32_t			outstanding;
+	/* Moving average of the sampled latency (in ticks), 0 until the first sample */
+	uint64_t			latency;
+	/* Only a single task at a time is used to sample the latency */
+	struct spdk_accel_task		*probe;
+	uint64_t			probe_tsc;
+};
+
+struct accel_balance_channel {
+	struct accel_balance_module_channel	modules[SPDK_ACCEL_BALANCE_MAX_MODULES];
+};
+
+enum accel_depot_type {
+	ACCEL_DEPOT_TASK,
+	ACCEL_DEPOT_TASK_AUX,
+	ACCEL_DEPOT_SEQUENCE,
+	ACCEL_DEPOT_BUF,
+	ACCEL_DEPOT_TYPE_COUNT,
+};
+
+struct accel_depot_slab {
+	SLIST_ENTRY(accel_depot_slab)	link;
+};
+
+/* Objects shared by the IO channels of a NUMA node, allocated on demand once the channels run
+ * out of the objects allocated along with them */
+struct accel_depot {
+	struct spdk_ring		*ring;
+	size_t				obj_size;
+	int32_t				numa_id;
+	uint32_t			num_objs;
+	struct spdk_spinlock		lock;
+	SLIST_HEAD(, accel_depot_slab)	slabs;
+};
+
+/* Objects borrowed by an IO channel from its NUMA node's depot */
+struct accel_magazine {
+	struct accel_depot		*depot;
+	/* Free objects, up to two magazines */
+	void				**objs;
+	uint32_t			count;
+	/* Number of objects borrowed from the depot, both free and in use */
+	uint32_t			borrowed;
+	/* Objects allocated along with the channel, these are never returned to the depot */
+	uintptr_t			base;
+	size_t				base_len;
 };
 
 /* Largest context size for all accel modules */
@@ -64,6 +132,10 @@ static struct spdk_spinlock g_keyring_spin;
 /* Global array mapping capabilities to modules */
 static struct accel_module g_modules_opc[SPDK_ACCEL_OPC_LAST] = {};
 static char *g_modules_opc_override[SPDK_ACCEL_OPC_LAST] = {};
+static struct accel_balance g_balance[SPDK_ACCEL_OPC_LAST] = {};
+/* Depots of each NUMA node, indexed by NUMA ID and object type */
+static struct accel_depot *g_depots;
+static uint32_t g_num_depot_numa_ids;
 TAILQ_HEAD(, spdk_accel_driver) g_accel_drivers = TAILQ_HEAD_INITIALIZER(g_accel_drivers);
 static struct spdk_accel_driver *g_accel_driver;
 static struct spdk_accel_opts g_opts = {
@@ -72,6 +144,10 @@ static struct spdk_accel_opts g_opts = {
 	.task_count = ACCEL_TASKS_PER_CHANNEL,
 	.sequence_count = ACCEL_TASKS_PER_CHANNEL,
 	.buf_count = ACCEL_TASKS_PER_CHANNEL,
+	.compress_sample_size = ACCEL_COMPRESS_SAMPLE_SIZE,
+	.compress_entropy_threshold = ACCEL_COMPRESS_ENTROPY_THRESHOLD,
+	.magazine_size = ACCEL_MAGAZINE_SIZE,
+	.depot_count = ACCEL_DEPOT_COUNT,
 };
 static struct accel_stats g_stats;
 static struct spdk_spinlock g_stats_lock;
@@ -83,6 +159,11 @@ static const char *g_opcode_strings[SPDK_ACCEL_OPC_LAST] = {
 	"dix_generate", "dix_verify"
 };
 
+static const char *g_balance_policy_strings[] = {
+	[SPDK_ACCEL_BALANCE_SPILLOVER] = "spillover",
+	[SPDK_ACCEL_BALANCE_LATENCY] = "latency",
+};
+
 enum accel_sequence_state {
 	ACCEL_SEQUENCE_STATE_INIT,
 	ACCEL_SEQUENCE_STATE_CHECK_VIRTBUF,
@@ -143,6 +224,8 @@ struct accel_buffer {
 
 struct accel_io_channel {
 	struct spdk_io_channel			*module_ch[SPDK_ACCEL_OPC_LAST];
+	/* Only allocated for the opcodes balanced across several modules */
+	struct accel_balance_channel		*balance[SPDK_ACCEL_OPC_LAST];
 	struct spdk_io_channel			*driver_channel;
 	void					*task_pool_base;
 	struct spdk_accel_sequence		*seq_pool_base;
@@ -152,6 +235,7 @@ struct accel_io_channel {
 	SLIST_HEAD(, spdk_accel_task_aux_data)	task_aux_data_pool;
 	SLIST_HEAD(, spdk_accel_sequence)	seq_pool;
 	SLIST_HEAD(, accel_buffer)		buf_pool;
+	struct accel_magazine			magazines[ACCEL_DEPOT_TYPE_COUNT];
 	struct spdk_iobuf_channel		iobuf;
 	struct accel_stats			stats;
 };
@@ -166,6 +250,8 @@ struct spdk_accel_sequence {
 	/* state uses enum accel_sequence_state */
 	uint8_t					state;
 	bool					in_process_sequence;
+	/* Number of the following tasks already executed by a fused pass */
+	uint8_t					fused_tasks;
 	spdk_accel_completion_cb		cb_fn;
 	void					*cb_arg;
 	SLIST_ENTRY(spdk_accel_sequence)	link;
@@ -248,6 +334,19 @@ spdk_accel_get_opcode_name(enum spdk_accel_opcode opcode)
 	return NULL;
 }
 
+static void
+accel_balance_clear(enum spdk_accel_opcode opcode)
+{
+	struct accel_balance *balance = &g_balance[opcode];
+	uint32_t i;
+
+	for (i = 0; i < balance->num_modules; i++) {
+		free(balance->names[i]);
+	}
+
+	memset(balance, 0, sizeof(*balance));
+}
+
 int
 spdk_accel_assign_opc(enum spdk_accel_opcode opcode, const char *name)
 {
@@ -271,28 +370,214 @@ spdk_accel_assign_opc(enum spdk_accel_opcode opcode, const char *name)
 	/* module selection will be validated after the framework starts. */
 	free(g_modules_opc_override[opcode]);
 	g_modules_opc_override[opcode] = copy;
+	accel_balance_clear(opcode);
 
 	return 0;
 }
 
+const char *
+spdk_accel_get_balance_policy_name(enum spdk_accel_balance_policy policy)
+{
+	if ((size_t)policy < SPDK_COUNTOF(g_balance_policy_strings)) {
+		return g_balance_policy_strings[policy];
+	}
+
+	return NULL;
+}
+
+int
+spdk_accel_assign_opc_modules(enum spdk_accel_opcode opcode, const char **names,
+			      uint32_t num_modules, enum spdk_accel_balance_policy policy,
+			      uint32_t queue_depth)
+{
+	struct accel_balance balance = {};
+	uint32_t i, j;
+	int rc;
+
+	if (g_modules_started == true) {
+		/* we don't allow re-assignment once things have started */
+		return -EINVAL;
+	}
+
+	/* Crypto keys are bound to the module assigned to encrypt/decrypt operations */
+	if (opcode >= SPDK_ACCEL_OPC_LAST || opcode == SPDK_ACCEL_OPC_ENCRYPT ||
+	    opcode == SPDK_ACCEL_OPC_DECRYPT) {
+		return -EINVAL;
+	}
+
+	if (num_modules < 2 || num_modules > SPDK_ACCEL_BALANCE_MAX_MODULES || queue_depth == 0 ||
+	    spdk_accel_get_balance_policy_name(policy) == NULL) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < num_modules; i++) {
+		for (j = 0; j < i; j++) {
+			if (strcmp(names[i], names[j]) == 0) {
+				rc = -EINVAL;
+				goto error;
+			}
+		}
+		balance.names[i] = strdup(names[i]);
+		if (balance.names[i] == NULL) {
+			rc = -ENOMEM;
+			goto error;
+		}
+		balance.num_modules++;
+	}
+
+	/* The first module is reported as the one assigned to the opcode */
+	rc = spdk_accel_assign_opc(opcode, names[0]);
+	if (rc != 0) {
+		goto error;
+	}
+
+	balance.policy = policy;
+	balance.queue_depth = queue_depth;
+	g_balance[opcode] = balance;
+
+	return 0;
+error:
+	for (i = 0; i < balance.num_modules; i++) {
+		free(balance.names[i]);
+	}
+
+	return rc;
+}
+
+int
+accel_get_balance_modules(enum spdk_accel_opcode opcode, const char **names,
+			  enum spdk_accel_balance_policy *policy)
+{
+	struct accel_balance *balance = &g_balance[opcode];
+	uint32_t i;
+
+	for (i = 0; i < balance->num_modules; i++) {
+		names[i] = balance->names[i];
+	}
+	*policy = balance->policy;
+
+	return balance->num_modules;
+}
+
+static uint32_t
+accel_depot_grow(struct accel_depot *depot, void **objs)
+{
+	struct accel_depot_slab *slab;
+	uint32_t i, count;
+
+	spdk_spin_lock(&depot->lock);
+	if (depot->num_objs >= g_opts.depot_count) {
+		spdk_spin_unlock(&depot->lock);
+		return 0;
+	}
+	/* The last slab is smaller if depot_count isn't a multiple of magazine_size */
+	count = spdk_min(g_opts.magazine_size, g_opts.depot_count - depot->num_objs);
+	depot->num_objs += count;
+	spdk_spin_unlock(&depot->lock);
+
+	/* The objects start at the next cache line after the slab's header */
+	slab = spdk_zmalloc(SPDK_CACHE_LINE_SIZE + count * depot->obj_size, SPDK_CACHE_LINE_SIZE,
+			    NULL, depot->numa_id, SPDK_MALLOC_DMA);
+	spdk_spin_lock(&depot->lock);
+	if (slab == NULL) {
+		depot->num_objs -= count;
+		spdk_spin_unlock(&depot->lock);
+		return 0;
+	}
+	SLIST_INSERT_HEAD(&depot->slabs, slab, link);
+	spdk_spin_unlock(&depot->lock);
+
+	for (i = 0; i < count; i++) {
+		objs[i] = (uint8_t *)slab + SPDK_CACHE_LINE_SIZE + i * depot->obj_size;
+	}
+
+	return count;
+}
+
+static int
+accel_magazine_refill(struct accel_io_channel *ch, struct accel_magazine *mag)
+{
+	size_t count;
+
+	if (mag->depot == NULL) {
+		return -ENOMEM;
+	}
+
+	assert(mag->count <= g_opts.magazine_size);
+	count = spdk_ring_dequeue(mag->depot->ring, &mag->objs[mag->count], g_opts.magazine_size);
+	if (count == 0) {
+		count = accel_depot_grow(mag->depot, &mag->objs[mag->count]);
+		if (count == 0) {
+			accel_update_stats(ch, depot.exhausted, 1);
+			return -ENOMEM;
+		}
+	}
+
+	mag->count += count;
+	mag->borrowed += count;
+	accel_update_stats(ch, depot.refill, 1);
+
+	return 0;
+}
+
+static inline void *
+accel_magazine_get(struct accel_io_channel *ch, struct accel_magazine *mag)
+{
+	if (mag->count == 0 && accel_magazine_refill(ch, mag) != 0) {
+		return NULL;
+	}
+
+	return mag->objs[--mag->count];
+}
+
+static inline bool
+accel_magazine_is_borrowed(struct accel_magazine *mag, void *obj)
+{
+	return mag->depot != NULL && (uintptr_t)obj - mag->base >= mag->base_len;
+}
+
+static inline void
+accel_magazine_put(struct accel_io_channel *ch, struct accel_magazine *mag, void *obj)
+{
+	size_t count __attribute__((unused));
+
+	if (spdk_unlikely(mag->count == 2 * g_opts.magazine_size)) {
+		/* Return the least recently used half of the objects to the depot */
+		count = spdk_ring_enqueue(mag->depot->ring, mag->objs, g_opts.magazine_size, NULL);
+		assert(count == g_opts.magazine_size);
+		memmove(mag->objs, &mag->objs[g_opts.magazine_size],
+			g_opts.magazine_size * sizeof(*mag->objs));
+		mag->count -= g_opts.magazine_size;
+		mag->borrowed -= g_opts.magazine_size;
+		accel_update_stats(ch, depot.release, 1);
+	}
+
+	mag->objs[mag->count++] = obj;
+}
+
 inline static struct spdk_accel_task *
 _get_task(struct accel_io_channel *accel_ch, spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
 	struct spdk_accel_task *accel_task;
 
 	accel_task = STAILQ_FIRST(&accel_ch->task_pool);
-	if (spdk_unlikely(accel_task == NULL)) {
-		accel_update_stats(accel_ch, retry.task, 1);
-		return NULL;
+	if (spdk_likely(accel_task != NULL)) {
+		STAILQ_REMOVE_HEAD(&accel_ch->task_pool, link);
+	} else {
+		accel_task = accel_magazine_get(accel_ch, &accel_ch->magazines[ACCEL_DEPOT_TASK]);
+		if (spdk_unlikely(accel_task == NULL)) {
+			accel_update_stats(accel_ch, retry.task, 1);
+			return NULL;
+		}
 	}
 
 	accel_update_stats(accel_ch, task_outstanding, 1);
-	STAILQ_REMOVE_HEAD(&accel_ch->task_pool, link);
 	accel_task->link.stqe_next = NULL;
 
 	accel_task->cb_fn = cb_fn;
 	accel_task->cb_arg = cb_arg;
 	accel_task->accel_ch = accel_ch;
+	accel_task->balance_idx = 0;
 	accel_task->s.iovs = NULL;
 	accel_task->d.iovs = NULL;
 
@@ -302,10 +587,105 @@ _get_task(struct accel_io_channel *accel_ch, spdk_accel_completion_cb cb_fn, voi
 static void
 _put_task(struct accel_io_channel *ch, struct spdk_accel_task *task)
 {
-	STAILQ_INSERT_HEAD(&ch->task_pool, task, link);
+	struct accel_magazine *mag = &ch->magazines[ACCEL_DEPOT_TASK];
+
+	if (spdk_unlikely(accel_magazine_is_borrowed(mag, task))) {
+		accel_magazine_put(ch, mag, task);
+	} else {
+		STAILQ_INSERT_HEAD(&ch->task_pool, task, link);
+	}
 	accel_update_stats(ch, task_outstanding, -1);
 }
 
+static inline struct spdk_accel_task_aux_data *
+accel_get_task_aux(struct accel_io_channel *ch)
+{
+	struct spdk_accel_task_aux_data *aux;
+
+	aux = SLIST_FIRST(&ch->task_aux_data_pool);
+	if (spdk_likely(aux != NULL)) {
+		SLIST_REMOVE_HEAD(&ch->task_aux_data_pool, link);
+		return aux;
+	}
+
+	return accel_magazine_get(ch, &ch->magazines[ACCEL_DEPOT_TASK_AUX]);
+}
+
+static inline void
+accel_put_task_aux(struct accel_io_channel *ch, struct spdk_accel_task_aux_data *aux)
+{
+	struct accel_magazine *mag = &ch->magazines[ACCEL_DEPOT_TASK_AUX];
+
+	if (spdk_unlikely(accel_magazine_is_borrowed(mag, aux))) {
+		accel_magazine_put(ch, mag, aux);
+	} else {
+		SLIST_INSERT_HEAD(&ch->task_aux_data_pool, aux, link);
+	}
+}
+
+static void
+accel_balance_put_task(struct accel_balance_module_channel *mch, struct spdk_accel_task *task)
+{
+	uint64_t latency;
+
+	assert(mch->outstanding > 0);
+	mch->outstanding--;
+	if (mch->probe != task) {
+		return;
+	}
+
+	latency = spdk_get_ticks() - mch->probe_tsc;
+	mch->latency = mch->latency == 0 ? latency : (mch->latency * 7 + latency) / 8;
+	mch->probe = NULL;
+}
+
+static void
+accel_balance_complete_task(struct accel_io_channel *accel_ch, struct spdk_accel_task *task)
+{
+	struct accel_balance_channel *bch = accel_ch->balance[task->op_code];
+	uint32_t idx = task->balance_idx - 1;
+
+	assert(bch != NULL);
+	assert(idx < g_balance[task->op_code].num_modules);
+
+	accel_update_task_stats(accel_ch, task, routed[idx], 1);
+	accel_balance_put_task(&bch->modules[idx], task);
+	task->balance_idx = 0;
+}
+
+static inline uint64_t
+accel_get_iovlen(struct iovec *iovs, uint32_t iovcnt)
+{
+	uint64_t result = 0;
+	uint32_t i;
+
+	for (i = 0; i < iovcnt; ++i) {
+		result += iovs[i].iov_len;
+	}
+
+	return result;
+}
+
+static void
+accel_update_compress_ratio(struct accel_io_channel *accel_ch, struct spdk_accel_task *task)
+{
+	uint64_t input_size;
+	uint32_t bucket;
+
+	if (task->output_size == NULL) {
+		return;
+	}
+
+	input_size = accel_get_iovlen(task->s.iovs, task->s.iovcnt);
+	if (spdk_unlikely(input_size == 0)) {
+		return;
+	}
+
+	bucket = spdk_min((uint64_t)*task->output_size * ACCEL_COMPRESS_RATIO_BUCKETS / input_size,
+			  ACCEL_COMPRESS_RATIO_BUCKETS - 1);
+	accel_update_stats(accel_ch, compress.ratio[bucket], 1);
+}
+
 void
 spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 {
@@ -313,12 +693,20 @@ spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 	spdk_accel_completion_cb	cb_fn;
 	void				*cb_arg;
 
+	if (spdk_unlikely(accel_task->balance_idx != 0)) {
+		accel_balance_complete_task(accel_ch, accel_task);
+	}
+
 	accel_update_task_stats(accel_ch, accel_task, executed, 1);
 	accel_update_task_stats(accel_ch, accel_task, num_bytes, accel_task->nbytes);
 	if (spdk_unlikely(status != 0)) {
 		accel_update_task_stats(accel_ch, accel_task, failed, 1);
 	}
 
+	if (accel_task->op_code == SPDK_ACCEL_OPC_COMPRESS && spdk_likely(status == 0)) {
+		accel_update_compress_ratio(accel_ch, accel_task);
+	}
+
 	if (accel_task->seq) {
 		accel_sequence_task_cb(accel_task->seq, accel_task, status);
 		return;
@@ -328,7 +716,7 @@ spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 	cb_arg = accel_task->cb_arg;
 
 	if (accel_task->has_aux) {
-		SLIST_INSERT_HEAD(&accel_ch->task_aux_data_pool, accel_task->aux, link);
+		accel_put_task_aux(accel_ch, accel_task->aux);
 		accel_task->aux = NULL;
 		accel_task->has_aux = false;
 	}
@@ -342,6 +730,84 @@ spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 	cb_fn(cb_arg, status);
 }
 
+static uint32_t
+accel_balance_select(struct accel_balance *balance, struct accel_balance_channel *bch)
+{
+	struct accel_balance_module_channel *mch;
+	uint64_t score, best_score = UINT64_MAX;
+	uint32_t i, best = 0, least = 0;
+	bool found = false;
+
+	for (i = 0; i < balance->num_modules; i++) {
+		mch = &bch->modules[i];
+		if (mch->outstanding < bch->modules[least].outstanding) {
+			least = i;
+		}
+		if (mch->outstanding >= balance->queue_depth) {
+			continue;
+		}
+		if (balance->policy == SPDK_ACCEL_BALANCE_SPILLOVER) {
+			return i;
+		}
+		/* Modules without a latency sample score 0, so they're tried first */
+		score = (mch->outstanding + 1) * mch->latency;
+		if (!found || score < best_score) {
+			best_score = score;
+			best = i;
+			found = true;
+		}
+	}
+
+	/* If all modules are full, use the least loaded one */
+	return found ? best : least;
+}
+
+static int
+accel_balance_submit_task(struct accel_io_channel *accel_ch, struct spdk_accel_task *task)
+{
+	enum spdk_accel_opcode opcode = task->op_code;
+	struct accel_balance *balance = &g_balance[opcode];
+	struct accel_balance_channel *bch = accel_ch->balance[opcode];
+	struct accel_balance_module_channel *mch;
+	uint32_t i, idx, first;
+	int rc = 0;
+
+	first = accel_balance_select(balance, bch);
+	for (i = 0; i < balance->num_modules; i++) {
+		idx = (first + i) % balance->num_modules;
+		mch = &bch->modules[idx];
+		if (i > 0) {
+			accel_update_stats(accel_ch, operations[opcode].rerouted, 1);
+		}
+
+		mch->outstanding++;
+		if (mch->probe == NULL) {
+			mch->probe = task;
+			mch->probe_tsc = spdk_get_ticks();
+		}
+		task->balance_idx = idx + 1;
+
+		rc = balance->modules[idx]->submit_tasks(mch->ch, task);
+		if (spdk_likely(rc == 0)) {
+			return 0;
+		}
+
+		/* The task wasn't executed, so don't use it as a latency sample */
+		task->balance_idx = 0;
+		mch->outstanding--;
+		if (mch->probe == task) {
+			mch->probe = NULL;
+		}
+
+		/* Only retry if the module was out of resources */
+		if (rc != -EBUSY && rc != -ENOMEM) {
+			break;
+		}
+	}
+
+	return rc;
+}
+
 static inline int
 accel_submit_task(struct accel_io_channel *accel_ch, struct spdk_accel_task *task)
 {
@@ -349,6 +815,15 @@ accel_submit_task(struct accel_io_channel *accel_ch, struct spdk_accel_task *tas
 	struct spdk_accel_module_if *module = g_modules_opc[task->op_code].module;
 	int rc;
 
+	if (spdk_unlikely(accel_ch->balance[task->op_code] != NULL)) {
+		rc = accel_balance_submit_task(accel_ch, task);
+		if (spdk_unlikely(rc != 0)) {
+			accel_update_task_stats(accel_ch, task, failed, 1);
+		}
+
+		return rc;
+	}
+
 	rc = module->submit_tasks(module_ch, task);
 	if (spdk_unlikely(rc != 0)) {
 		accel_update_task_stats(accel_ch, task, failed, 1);
@@ -357,29 +832,15 @@ accel_submit_task(struct accel_io_channel *accel_ch, struct spdk_accel_task *tas
 	return rc;
 }
 
-static inline uint64_t
-accel_get_iovlen(struct iovec *iovs, uint32_t iovcnt)
-{
-	uint64_t result = 0;
-	uint32_t i;
-
-	for (i = 0; i < iovcnt; ++i) {
-		result += iovs[i].iov_len;
-	}
-
-	return result;
-}
-
 #define ACCEL_TASK_ALLOC_AUX_BUF(task)						\
 do {										\
-        (task)->aux = SLIST_FIRST(&(task)->accel_ch->task_aux_data_pool);	\
+        (task)->aux = accel_get_task_aux((task)->accel_ch);			\
         if (spdk_unlikely(!(task)->aux)) {					\
                 SPDK_ERRLOG("Fatal problem, aux data was not allocated\n");	\
                 _put_task(task->accel_ch, task);				\
                 assert(0);							\
                 return -ENOMEM;							\
         }									\
-        SLIST_REMOVE_HEAD(&(task)->accel_ch->task_aux_data_pool, link);		\
         (task)->has_aux = true;							\
 } while (0)
 
@@ -785,6 +1246,73 @@ spdk_accel_submit_decompress(struct spdk_io_channel *ch, struct iovec *dst_iovs,
 						SPDK_ACCEL_COMP_ALGO_DEFLATE, output_size, cb_fn, cb_arg);
 }
 
+/* Returns the entropy of the sampled bytes in hundredths of a bit per byte */
+static uint32_t
+accel_compress_sample_entropy(struct iovec *iovs, size_t iovcnt, uint32_t sample_size)
+{
+	uint32_t counts[256] = {};
+	uint64_t total, offset = 0, start, end, window_len, stride;
+	uint32_t i, num_windows, num_samples = 0;
+	const uint8_t *buf;
+	double entropy = 0.0, p;
+	size_t j;
+
+	total = accel_get_iovlen(iovs, iovcnt);
+	sample_size = spdk_min(sample_size, total);
+	num_windows = sample_size >= ACCEL_COMPRESS_SAMPLE_WINDOWS * 64 ?
+		      ACCEL_COMPRESS_SAMPLE_WINDOWS : 1;
+	window_len = sample_size / num_windows;
+	stride = total / num_windows;
+	if (window_len == 0) {
+		return 0;
+	}
+
+	for (j = 0; j < iovcnt; j++) {
+		buf = iovs[j].iov_base;
+		for (i = 0; i < num_windows; i++) {
+			start = spdk_max(i * stride, offset);
+			end = spdk_min(i * stride + window_len, offset + iovs[j].iov_len);
+			for (; start < end; start++) {
+				counts[buf[start - offset]]++;
+				num_samples++;
+			}
+		}
+		offset += iovs[j].iov_len;
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(counts); i++) {
+		if (counts[i] == 0) {
+			continue;
+		}
+		p = (double)counts[i] / num_samples;
+		entropy -= p * log2(p);
+	}
+
+	return (uint32_t)(entropy * 100);
+}
+
+bool
+spdk_accel_compress_is_incompressible(struct spdk_io_channel *ch, struct iovec *iovs,
+				      size_t iovcnt)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	uint32_t entropy;
+
+	if (g_opts.compress_sample_size == 0) {
+		return false;
+	}
+
+	entropy = accel_compress_sample_entropy(iovs, iovcnt, g_opts.compress_sample_size);
+	accel_update_stats(accel_ch, compress.sampled, 1);
+	if (entropy < g_opts.compress_entropy_threshold) {
+		return false;
+	}
+
+	accel_update_stats(accel_ch, compress.incompressible, 1);
+
+	return true;
+}
+
 int
 spdk_accel_submit_encrypt(struct spdk_io_channel *ch, struct spdk_accel_crypto_key *key,
 			  struct iovec *dst_iovs, uint32_t dst_iovcnt,
@@ -1055,12 +1583,16 @@ accel_get_buf(struct accel_io_channel *ch, uint64_t len)
 	struct accel_buffer *buf;
 
 	buf = SLIST_FIRST(&ch->buf_pool);
-	if (spdk_unlikely(buf == NULL)) {
-		accel_update_stats(ch, retry.bufdesc, 1);
-		return NULL;
+	if (spdk_likely(buf != NULL)) {
+		SLIST_REMOVE_HEAD(&ch->buf_pool, link);
+	} else {
+		buf = accel_magazine_get(ch, &ch->magazines[ACCEL_DEPOT_BUF]);
+		if (spdk_unlikely(buf == NULL)) {
+			accel_update_stats(ch, retry.bufdesc, 1);
+			return NULL;
+		}
 	}
 
-	SLIST_REMOVE_HEAD(&ch->buf_pool, link);
 	buf->len = len;
 	buf->buf = NULL;
 	buf->seq = NULL;
@@ -1072,37 +1604,52 @@ accel_get_buf(struct accel_io_channel *ch, uint64_t len)
 static inline void
 accel_put_buf(struct accel_io_channel *ch, struct accel_buffer *buf)
 {
+	struct accel_magazine *mag = &ch->magazines[ACCEL_DEPOT_BUF];
+
 	if (buf->buf != NULL) {
 		spdk_iobuf_put(&ch->iobuf, buf->buf, buf->len);
 	}
 
-	SLIST_INSERT_HEAD(&ch->buf_pool, buf, link);
+	if (spdk_unlikely(accel_magazine_is_borrowed(mag, buf))) {
+		accel_magazine_put(ch, mag, buf);
+	} else {
+		SLIST_INSERT_HEAD(&ch->buf_pool, buf, link);
+	}
 }
 
 static inline struct spdk_accel_sequence *
 accel_sequence_get(struct accel_io_channel *ch)
 {
+	struct accel_magazine *task_mag = &ch->magazines[ACCEL_DEPOT_TASK];
 	struct spdk_accel_sequence *seq;
 
-	assert(g_opts.task_count >= ch->stats.task_outstanding);
+	assert(g_opts.task_count + task_mag->borrowed >= ch->stats.task_outstanding);
 
 	/* Sequence cannot be allocated if number of available task objects cannot satisfy required limit.
 	 * This is to prevent potential dead lock when few requests are pending task resource and none can
 	 * advance the processing. This solution should work only if there is single async operation after
 	 * sequence obj obtained, so assume that is possible to happen with io buffer allocation now, if
-	 * there are more async operations then solution should be improved. */
-	if (spdk_unlikely(g_opts.task_count - ch->stats.task_outstanding < ACCEL_TASKS_IN_SEQUENCE_LIMIT)) {
-		return NULL;
+	 * there are more async operations then solution should be improved.  Tasks borrowed from
+	 * the depot count towards the limit too. */
+	while (spdk_unlikely(g_opts.task_count + task_mag->borrowed - ch->stats.task_outstanding <
+			     ACCEL_TASKS_IN_SEQUENCE_LIMIT)) {
+		if (accel_magazine_refill(ch, task_mag) != 0) {
+			return NULL;
+		}
 	}
 
 	seq = SLIST_FIRST(&ch->seq_pool);
-	if (spdk_unlikely(seq == NULL)) {
-		accel_update_stats(ch, retry.sequence, 1);
-		return NULL;
+	if (spdk_likely(seq != NULL)) {
+		SLIST_REMOVE_HEAD(&ch->seq_pool, link);
+	} else {
+		seq = accel_magazine_get(ch, &ch->magazines[ACCEL_DEPOT_SEQUENCE]);
+		if (spdk_unlikely(seq == NULL)) {
+			accel_update_stats(ch, retry.sequence, 1);
+			return NULL;
+		}
 	}
 
 	accel_update_stats(ch, sequence_outstanding, 1);
-	SLIST_REMOVE_HEAD(&ch->seq_pool, link);
 
 	TAILQ_INIT(&seq->tasks);
 	SLIST_INIT(&seq->bounce_bufs);
@@ -1111,6 +1658,7 @@ accel_sequence_get(struct accel_io_channel *ch)
 	seq->status = 0;
 	seq->state = ACCEL_SEQUENCE_STATE_INIT;
 	seq->in_process_sequence = false;
+	seq->fused_tasks = 0;
 
 	return seq;
 }
@@ -1119,6 +1667,7 @@ static inline void
 accel_sequence_put(struct spdk_accel_sequence *seq)
 {
 	struct accel_io_channel *ch = seq->ch;
+	struct accel_magazine *mag = &ch->magazines[ACCEL_DEPOT_SEQUENCE];
 	struct accel_buffer *buf;
 
 	while (!SLIST_EMPTY(&seq->bounce_bufs)) {
@@ -1130,7 +1679,11 @@ accel_sequence_put(struct spdk_accel_sequence *seq)
 	assert(TAILQ_EMPTY(&seq->tasks));
 	seq->ch = NULL;
 
-	SLIST_INSERT_HEAD(&ch->seq_pool, seq, link);
+	if (spdk_unlikely(accel_magazine_is_borrowed(mag, seq))) {
+		accel_magazine_put(ch, mag, seq);
+	} else {
+		SLIST_INSERT_HEAD(&ch->seq_pool, seq, link);
+	}
 	accel_update_stats(ch, sequence_outstanding, -1);
 }
 
@@ -1227,7 +1780,7 @@ spdk_accel_append_fill(struct spdk_accel_sequence **pseq, struct spdk_io_channel
 
 	memset(&task->fill_pattern, pattern, sizeof(uint64_t));
 
-	task->aux = SLIST_FIRST(&task->accel_ch->task_aux_data_pool);
+	task->aux = accel_get_task_aux(task->accel_ch);
 	if (spdk_unlikely(!task->aux)) {
 		SPDK_ERRLOG("Fatal problem, aux data was not allocated\n");
 		if (*pseq == NULL) {
@@ -1239,7 +1792,6 @@ spdk_accel_append_fill(struct spdk_accel_sequence **pseq, struct spdk_io_channel
 		assert(0);
 		return -ENOMEM;
 	}
-	SLIST_REMOVE_HEAD(&task->accel_ch->task_aux_data_pool, link);
 	task->has_aux = true;
 
 	task->d.iovs = &task->aux->iovs[SPDK_ACCEL_AUX_IOV_DST];
@@ -1811,7 +2363,7 @@ accel_sequence_complete_task(struct spdk_accel_sequence *seq, struct spdk_accel_
 	cb_arg = task->cb_arg;
 	task->seq = NULL;
 	if (task->has_aux) {
-		SLIST_INSERT_HEAD(&ch->task_aux_data_pool, task->aux, link);
+		accel_put_task_aux(ch, task->aux);
 		task->aux = NULL;
 		task->has_aux = false;
 	}
@@ -1880,10 +2432,9 @@ accel_sequence_set_virtbuf(struct spdk_accel_sequence *seq, struct accel_buffer
 	TAILQ_FOREACH(task, &seq->tasks, seq_link) {
 		if (task->src_domain == g_accel_domain && task->src_domain_ctx == buf) {
 			if (!task->has_aux) {
-				task->aux = SLIST_FIRST(&task->accel_ch->task_aux_data_pool);
+				task->aux = accel_get_task_aux(task->accel_ch);
 				assert(task->aux && "Can't allocate aux data structure");
 				task->has_aux = true;
-				SLIST_REMOVE_HEAD(&task->accel_ch->task_aux_data_pool, link);
 			}
 
 			iov = &task->aux->iovs[SPDK_ACCEL_AXU_IOV_VIRT_SRC];
@@ -1894,10 +2445,9 @@ accel_sequence_set_virtbuf(struct spdk_accel_sequence *seq, struct accel_buffer
 		}
 		if (task->dst_domain == g_accel_domain && task->dst_domain_ctx == buf) {
 			if (!task->has_aux) {
-				task->aux = SLIST_FIRST(&task->accel_ch->task_aux_data_pool);
+				task->aux = accel_get_task_aux(task->accel_ch);
 				assert(task->aux && "Can't allocate aux data structure");
 				task->has_aux = true;
-				SLIST_REMOVE_HEAD(&task->accel_ch->task_aux_data_pool, link);
 			}
 
 			iov = &task->aux->iovs[SPDK_ACCEL_AXU_IOV_VIRT_DST];
@@ -2096,14 +2646,13 @@ accel_sequence_check_bouncebuf(struct spdk_accel_sequence *seq, struct spdk_acce
 		assert(task->src_domain != g_accel_domain);
 
 		if (!task->has_aux) {
-			task->aux = SLIST_FIRST(&task->accel_ch->task_aux_data_pool);
+			task->aux = accel_get_task_aux(task->accel_ch);
 			if (spdk_unlikely(!task->aux)) {
 				SPDK_ERRLOG("Can't allocate aux data structure\n");
 				assert(0);
 				return -EAGAIN;
 			}
 			task->has_aux = true;
-			SLIST_REMOVE_HEAD(&task->accel_ch->task_aux_data_pool, link);
 		}
 		buf = accel_get_buf(seq->ch, accel_get_iovlen(task->s.iovs, task->s.iovcnt));
 		if (buf == NULL) {
@@ -2125,14 +2674,13 @@ accel_sequence_check_bouncebuf(struct spdk_accel_sequence *seq, struct spdk_acce
 		assert(task->dst_domain != g_accel_domain);
 
 		if (!task->has_aux) {
-			task->aux = SLIST_FIRST(&task->accel_ch->task_aux_data_pool);
+			task->aux = accel_get_task_aux(task->accel_ch);
 			if (spdk_unlikely(!task->aux)) {
 				SPDK_ERRLOG("Can't allocate aux data structure\n");
 				assert(0);
 				return -EAGAIN;
 			}
 			task->has_aux = true;
-			SLIST_REMOVE_HEAD(&task->accel_ch->task_aux_data_pool, link);
 		}
 		buf = accel_get_buf(seq->ch, accel_get_iovlen(task->d.iovs, task->d.iovcnt));
 		if (buf == NULL) {
@@ -2231,6 +2779,60 @@ accel_task_push_data(struct spdk_accel_sequence *seq, struct spdk_accel_task *ta
 	}
 }
 
+/*
+ * Executes the task along with the following ones in a single pass over the data, if they are
+ * all handled by the software module and each one consumes the output of the previous one (e.g.
+ * copy -> crc32c -> encrypt).  Returns false if there's nothing to fuse.
+ */
+static bool
+accel_sequence_exec_fused(struct spdk_accel_sequence *seq, struct spdk_accel_task *task)
+{
+	struct accel_io_channel *accel_ch = seq->ch;
+	struct spdk_accel_task *tasks[ACCEL_SW_FUSED_MAX_TASKS], *next;
+	uint32_t count = 1, i;
+	int rc;
+
+	if (!g_modules_opc[task->op_code].supports_fusion) {
+		return false;
+	}
+
+	tasks[0] = task;
+	next = TAILQ_NEXT(task, seq_link);
+	while (next != NULL && count < ACCEL_SW_FUSED_MAX_TASKS) {
+		if (!g_modules_opc[next->op_code].supports_fusion ||
+		    !accel_sw_can_fuse(tasks, count, next)) {
+			break;
+		}
+		tasks[count++] = next;
+		next = TAILQ_NEXT(next, seq_link);
+	}
+
+	if (count == 1) {
+		return false;
+	}
+
+	SPDK_DEBUGLOG(accel, "Executing %"PRIu32" fused operations, sequence: %p\n", count, seq);
+
+	rc = accel_sw_execute_fused(tasks, count);
+	for (i = 0; i < count; i++) {
+		accel_update_task_stats(accel_ch, tasks[i], executed, 1);
+		accel_update_task_stats(accel_ch, tasks[i], num_bytes, tasks[i]->nbytes);
+		if (spdk_unlikely(rc != 0)) {
+			accel_update_task_stats(accel_ch, tasks[i], failed, 1);
+		}
+	}
+	accel_update_stats(accel_ch, fused.executed, 1);
+	accel_update_stats(accel_ch, fused.tasks, count);
+	accel_update_stats(accel_ch, fused.num_bytes, task->nbytes);
+
+	/* The remaining tasks are completed in order, without being executed again */
+	seq->fused_tasks = count - 1;
+	accel_sequence_set_state(seq, ACCEL_SEQUENCE_STATE_AWAIT_TASK);
+	accel_sequence_task_cb(seq, task, rc);
+
+	return true;
+}
+
 static void
 accel_process_sequence(struct spdk_accel_sequence *seq)
 {
@@ -2250,6 +2852,12 @@ accel_process_sequence(struct spdk_accel_sequence *seq)
 		state = seq->state;
 		switch (state) {
 		case ACCEL_SEQUENCE_STATE_INIT:
+			if (seq->fused_tasks > 0) {
+				/* Already executed as a part of a fused pass */
+				seq->fused_tasks--;
+				accel_sequence_set_state(seq, ACCEL_SEQUENCE_STATE_NEXT_TASK);
+				break;
+			}
 			if (g_accel_driver != NULL) {
 				accel_sequence_set_state(seq, ACCEL_SEQUENCE_STATE_DRIVER_EXEC_TASKS);
 				break;
@@ -2288,6 +2896,10 @@ accel_process_sequence(struct spdk_accel_sequence *seq)
 			accel_sequence_set_state(seq, ACCEL_SEQUENCE_STATE_EXEC_TASK);
 		/* Fall through */
 		case ACCEL_SEQUENCE_STATE_EXEC_TASK:
+			if (accel_sequence_exec_fused(seq, task)) {
+				break;
+			}
+
 			SPDK_DEBUGLOG(accel, "Executing %s operation, sequence: %p\n",
 				      g_opcode_strings[task->op_code], seq);
 
@@ -2973,6 +3585,120 @@ spdk_accel_module_list_add(struct spdk_accel_module_if *accel_module)
 	}
 }
 
+static void
+accel_balance_destroy_channel(struct accel_io_channel *accel_ch)
+{
+	struct accel_balance_channel *bch;
+	uint32_t op, i;
+
+	for (op = 0; op < SPDK_ACCEL_OPC_LAST; op++) {
+		bch = accel_ch->balance[op];
+		if (bch == NULL) {
+			continue;
+		}
+		for (i = 0; i < SPDK_ACCEL_BALANCE_MAX_MODULES; i++) {
+			if (bch->modules[i].ch != NULL) {
+				spdk_put_io_channel(bch->modules[i].ch);
+			}
+		}
+		free(bch);
+		accel_ch->balance[op] = NULL;
+	}
+}
+
+static int
+accel_balance_create_channel(struct accel_io_channel *accel_ch)
+{
+	struct accel_balance *balance;
+	struct accel_balance_channel *bch;
+	uint32_t op, i;
+
+	for (op = 0; op < SPDK_ACCEL_OPC_LAST; op++) {
+		balance = &g_balance[op];
+		if (balance->num_modules == 0) {
+			continue;
+		}
+		bch = calloc(1, sizeof(*bch));
+		if (bch == NULL) {
+			return -ENOMEM;
+		}
+		accel_ch->balance[op] = bch;
+		for (i = 0; i < balance->num_modules; i++) {
+			bch->modules[i].ch = balance->modules[i]->get_io_channel();
+			if (bch->modules[i].ch == NULL) {
+				SPDK_ERRLOG("Module %s failed to get io channel\n", balance->modules[i]->name);
+				return -ENOMEM;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void
+accel_destroy_magazines(struct accel_io_channel *accel_ch)
+{
+	struct accel_magazine *mag;
+	size_t count __attribute__((unused));
+	int i;
+
+	for (i = 0; i < ACCEL_DEPOT_TYPE_COUNT; i++) {
+		mag = &accel_ch->magazines[i];
+		if (mag->count > 0) {
+			count = spdk_ring_enqueue(mag->depot->ring, mag->objs, mag->count, NULL);
+			assert(count == mag->count);
+			mag->borrowed -= mag->count;
+			mag->count = 0;
+		}
+		assert(mag->borrowed == 0);
+		free(mag->objs);
+		mag->objs = NULL;
+		mag->depot = NULL;
+	}
+}
+
+static int
+accel_create_magazines(struct accel_io_channel *accel_ch, size_t task_size)
+{
+	struct accel_magazine *mag;
+	int32_t numa_id;
+	int i;
+
+	if (g_depots == NULL) {
+		return 0;
+	}
+
+	numa_id = spdk_env_get_numa_id(spdk_env_get_current_core());
+	if (numa_id < 0 || (uint32_t)numa_id >= g_num_depot_numa_ids) {
+		numa_id = 0;
+	}
+
+	for (i = 0; i < ACCEL_DEPOT_TYPE_COUNT; i++) {
+		mag = &accel_ch->magazines[i];
+		mag->objs = calloc(2 * g_opts.magazine_size, sizeof(*mag->objs));
+		if (mag->objs == NULL) {
+			accel_destroy_magazines(accel_ch);
+			return -ENOMEM;
+		}
+		mag->depot = &g_depots[numa_id * ACCEL_DEPOT_TYPE_COUNT + i];
+	}
+
+	mag = &accel_ch->magazines[ACCEL_DEPOT_TASK];
+	mag->base = (uintptr_t)accel_ch->task_pool_base;
+	mag->base_len = g_opts.task_count * task_size;
+	mag = &accel_ch->magazines[ACCEL_DEPOT_TASK_AUX];
+	mag->base = (uintptr_t)accel_ch->task_aux_data_base;
+	mag->base_len = g_opts.task_count * sizeof(struct spdk_accel_task_aux_data);
+	mag = &accel_ch->magazines[ACCEL_DEPOT_SEQUENCE];
+	mag->base = (uintptr_t)accel_ch->seq_pool_base;
+	mag->base_len = g_opts.sequence_count * sizeof(struct spdk_accel_sequence);
+	mag = &accel_ch->magazines[ACCEL_DEPOT_BUF];
+	mag->base = (uintptr_t)accel_ch->buf_pool_base;
+	mag->base_len = g_opts.buf_count * sizeof(struct accel_buffer);
+
+	return 0;
+}
+
 /* Framework level channel create callback. */
 static int
 accel_create_channel(void *io_device, void *ctx_buf)
@@ -2984,7 +3710,7 @@ accel_create_channel(void *io_device, void *ctx_buf)
 	struct accel_buffer *buf;
 	size_t task_size_aligned;
 	uint8_t *task_mem;
-	uint32_t i = 0, j;
+	uint32_t i, j, num_module_chs = 0;
 	int rc;
 
 	task_size_aligned = SPDK_ALIGN_CEIL(g_max_accel_module_size, SPDK_CACHE_LINE_SIZE);
@@ -3035,6 +3761,10 @@ accel_create_channel(void *io_device, void *ctx_buf)
 		SLIST_INSERT_HEAD(&accel_ch->buf_pool, buf, link);
 	}
 
+	if (accel_create_magazines(accel_ch, task_size_aligned) != 0) {
+		goto err;
+	}
+
 	/* Assign modules and get IO channels for each */
 	for (i = 0; i < SPDK_ACCEL_OPC_LAST; i++) {
 		accel_ch->module_ch[i] = g_modules_opc[i].module->get_io_channel();
@@ -3043,6 +3773,11 @@ accel_create_channel(void *io_device, void *ctx_buf)
 			SPDK_ERRLOG("Module %s failed to get io channel\n", g_modules_opc[i].module->name);
 			goto err;
 		}
+		num_module_chs++;
+	}
+
+	if (accel_balance_create_channel(accel_ch) != 0) {
+		goto err;
 	}
 
 	if (g_accel_driver != NULL) {
@@ -3065,9 +3800,11 @@ err:
 	if (accel_ch->driver_channel != NULL) {
 		spdk_put_io_channel(accel_ch->driver_channel);
 	}
-	for (j = 0; j < i; j++) {
+	accel_balance_destroy_channel(accel_ch);
+	for (j = 0; j < num_module_chs; j++) {
 		spdk_put_io_channel(accel_ch->module_ch[j]);
 	}
+	accel_destroy_magazines(accel_ch);
 	free(accel_ch->task_pool_base);
 	free(accel_ch->task_aux_data_base);
 	free(accel_ch->seq_pool_base);
@@ -3079,7 +3816,7 @@ err:
 static void
 accel_add_stats(struct accel_stats *total, struct accel_stats *stats)
 {
-	int i;
+	int i, j;
 
 	total->sequence_executed += stats->sequence_executed;
 	total->sequence_failed += stats->sequence_failed;
@@ -3089,10 +3826,25 @@ accel_add_stats(struct accel_stats *total, struct accel_stats *stats)
 	total->retry.sequence += stats->retry.sequence;
 	total->retry.iobuf += stats->retry.iobuf;
 	total->retry.bufdesc += stats->retry.bufdesc;
+	total->depot.refill += stats->depot.refill;
+	total->depot.release += stats->depot.release;
+	total->depot.exhausted += stats->depot.exhausted;
+	total->fused.executed += stats->fused.executed;
+	total->fused.tasks += stats->fused.tasks;
+	total->fused.num_bytes += stats->fused.num_bytes;
+	total->compress.sampled += stats->compress.sampled;
+	total->compress.incompressible += stats->compress.incompressible;
+	for (i = 0; i < ACCEL_COMPRESS_RATIO_BUCKETS; ++i) {
+		total->compress.ratio[i] += stats->compress.ratio[i];
+	}
 	for (i = 0; i < SPDK_ACCEL_OPC_LAST; ++i) {
 		total->operations[i].executed += stats->operations[i].executed;
 		total->operations[i].failed += stats->operations[i].failed;
 		total->operations[i].num_bytes += stats->operations[i].num_bytes;
+		total->operations[i].rerouted += stats->operations[i].rerouted;
+		for (j = 0; j < SPDK_ACCEL_BALANCE_MAX_MODULES; ++j) {
+			total->operations[i].routed[j] += stats->operations[i].routed[j];
+		}
 	}
 }
 
@@ -3115,11 +3867,14 @@ accel_destroy_channel(void *io_device, void *ctx_buf)
 		accel_ch->module_ch[i] = NULL;
 	}
 
+	accel_balance_destroy_channel(accel_ch);
+
 	/* Update global stats to make sure channel's stats aren't lost after a channel is gone */
 	spdk_spin_lock(&g_stats_lock);
 	accel_add_stats(&g_stats, &accel_ch->stats);
 	spdk_spin_unlock(&g_stats_lock);
 
+	accel_destroy_magazines(accel_ch);
 	free(accel_ch->task_pool_base);
 	free(accel_ch->task_aux_data_base);
 	free(accel_ch->seq_pool_base);
@@ -3166,6 +3921,38 @@ accel_module_init_opcode(enum spdk_accel_opcode opcode)
 	if (module_if->get_memory_domains != NULL) {
 		module->supports_memory_domains = module_if->get_memory_domains(NULL, 0) > 0;
 	}
+
+	module->supports_fusion = accel_sw_supports_fusion(module_if, opcode);
+
+	/* Balanced operations can be executed by any of the modules, so always use bounce buffers
+	 * and execute them one by one */
+	if (g_balance[opcode].num_modules > 0) {
+		module->supports_memory_domains = false;
+		module->supports_fusion = false;
+	}
+}
+
+static int
+accel_balance_init(enum spdk_accel_opcode opcode)
+{
+	struct accel_balance *balance = &g_balance[opcode];
+	struct spdk_accel_module_if *module;
+	uint32_t i;
+
+	for (i = 0; i < balance->num_modules; i++) {
+		module = _module_find_by_name(balance->names[i]);
+		if (module == NULL) {
+			SPDK_ERRLOG("Invalid module name of %s\n", balance->names[i]);
+			return -EINVAL;
+		}
+		if (module->supports_opcode(opcode) == false) {
+			SPDK_ERRLOG("Module %s does not support op code %d\n", module->name, opcode);
+			return -EINVAL;
+		}
+		balance->modules[i] = module;
+	}
+
+	return 0;
 }
 
 static int
@@ -3213,6 +4000,75 @@ accel_memory_domain_invalidate(struct spdk_memory_domain *domain, void *domain_c
 	buf->buf = NULL;
 }
 
+static void
+accel_depots_fini(void)
+{
+	struct accel_depot *depot;
+	struct accel_depot_slab *slab;
+	uint32_t i;
+
+	for (i = 0; g_depots != NULL && i < g_num_depot_numa_ids * ACCEL_DEPOT_TYPE_COUNT; i++) {
+		depot = &g_depots[i];
+		if (depot->ring == NULL) {
+			continue;
+		}
+		while ((slab = SLIST_FIRST(&depot->slabs)) != NULL) {
+			SLIST_REMOVE_HEAD(&depot->slabs, link);
+			spdk_free(slab);
+		}
+		spdk_ring_free(depot->ring);
+		spdk_spin_destroy(&depot->lock);
+	}
+
+	free(g_depots);
+	g_depots = NULL;
+	g_num_depot_numa_ids = 0;
+}
+
+static int
+accel_depots_init(void)
+{
+	size_t obj_size[ACCEL_DEPOT_TYPE_COUNT] = {
+		[ACCEL_DEPOT_TASK] = g_max_accel_module_size,
+		[ACCEL_DEPOT_TASK_AUX] = sizeof(struct spdk_accel_task_aux_data),
+		[ACCEL_DEPOT_SEQUENCE] = sizeof(struct spdk_accel_sequence),
+		[ACCEL_DEPOT_BUF] = sizeof(struct accel_buffer),
+	};
+	struct accel_depot *depot;
+	uint32_t numa_id;
+	int i;
+
+	if (g_opts.depot_count == 0) {
+		return 0;
+	}
+
+	g_num_depot_numa_ids = spdk_max(spdk_env_get_last_numa_id() + 1, 1);
+	g_depots = calloc(g_num_depot_numa_ids * ACCEL_DEPOT_TYPE_COUNT, sizeof(*g_depots));
+	if (g_depots == NULL) {
+		return -ENOMEM;
+	}
+
+	for (numa_id = 0; numa_id < g_num_depot_numa_ids; numa_id++) {
+		for (i = 0; i < ACCEL_DEPOT_TYPE_COUNT; i++) {
+			depot = &g_depots[numa_id * ACCEL_DEPOT_TYPE_COUNT + i];
+			depot->ring = spdk_ring_create(SPDK_RING_TYPE_MP_MC,
+						       spdk_align32pow2(g_opts.depot_count + 1), numa_id);
+			if (depot->ring == NULL) {
+				SPDK_ERRLOG("Failed to create accel depot on NUMA node %u\n", numa_id);
+				accel_depots_fini();
+				return -ENOMEM;
+			}
+
+			depot->obj_size = SPDK_ALIGN_CEIL(obj_size[i], SPDK_CACHE_LINE_SIZE);
+			depot->numa_id = numa_id;
+			SLIST_INIT(&depot->slabs);
+			spdk_spin_init(&depot->lock);
+		}
+	}
+
+	return 0;
+}
+
 int
 spdk_accel_initialize(void)
 {
@@ -3289,6 +4145,11 @@ spdk_accel_initialize(void)
 			}
 			g_modules_opc[op].module = accel_module;
 		}
+
+		rc = accel_balance_init(op);
+		if (rc != 0) {
+			return rc;
+		}
 	}
 
 	if (g_modules_opc[SPDK_ACCEL_OPC_ENCRYPT].module != g_modules_opc[SPDK_ACCEL_OPC_DECRYPT].module) {
@@ -3306,6 +4167,11 @@ spdk_accel_initialize(void)
 		accel_module_init_opcode(op);
 	}
 
+	rc = accel_depots_init();
+	if (rc != 0) {
+		return rc;
+	}
+
 	rc = spdk_iobuf_register_module("accel");
 	if (rc != 0) {
 		SPDK_ERRLOG("Failed to register accel iobuf module\n");
@@ -3338,6 +4204,27 @@ accel_write_overridden_opc(struct spdk_json_write_ctx *w, const char *opc_str,
 	spdk_json_write_object_end(w);
 }
 
+static void
+accel_write_balanced_opc(struct spdk_json_write_ctx *w, enum spdk_accel_opcode opcode)
+{
+	struct accel_balance *balance = &g_balance[opcode];
+	uint32_t i;
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "accel_assign_opc_modules");
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "opname", g_opcode_strings[opcode]);
+	spdk_json_write_named_array_begin(w, "modules");
+	for (i = 0; i < balance->num_modules; i++) {
+		spdk_json_write_string(w, balance->names[i]);
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_named_string(w, "policy", g_balance_policy_strings[balance->policy]);
+	spdk_json_write_named_uint32(w, "queue_depth", balance->queue_depth);
+	spdk_json_write_object_end(w);
+	spdk_json_write_object_end(w);
+}
+
 static void
 __accel_crypto_key_dump_param(struct spdk_json_write_ctx *w, struct spdk_accel_crypto_key *key)
 {
@@ -3384,6 +4271,10 @@ accel_write_options(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "task_count", g_opts.task_count);
 	spdk_json_write_named_uint32(w, "sequence_count", g_opts.sequence_count);
 	spdk_json_write_named_uint32(w, "buf_count", g_opts.buf_count);
+	spdk_json_write_named_uint32(w, "compress_sample_size", g_opts.compress_sample_size);
+	spdk_json_write_named_uint32(w, "compress_entropy_threshold", g_opts.compress_entropy_threshold);
+	spdk_json_write_named_uint32(w, "magazine_size", g_opts.magazine_size);
+	spdk_json_write_named_uint32(w, "depot_count", g_opts.depot_count);
 	spdk_json_write_object_end(w);
 	spdk_json_write_object_end(w);
 }
@@ -3434,7 +4325,9 @@ spdk_accel_write_config_json(struct spdk_json_write_ctx *w)
 		}
 	}
 	for (i = 0; i < SPDK_ACCEL_OPC_LAST; i++) {
-		if (g_modules_opc_override[i]) {
+		if (g_balance[i].num_modules > 0) {
+			accel_write_balanced_opc(w, i);
+		} else if (g_modules_opc_override[i]) {
 			accel_write_overridden_opc(w, g_opcode_strings[i], g_modules_opc_override[i]);
 		}
 	}
@@ -3492,9 +4385,11 @@ accel_io_device_unregister_cb(void *io_device)
 			free(g_modules_opc_override[op]);
 			g_modules_opc_override[op] = NULL;
 		}
+		accel_balance_clear(op);
 		g_modules_opc[op].module = NULL;
 	}
 
+	accel_depots_fini();
 	spdk_accel_module_finish();
 }
 
@@ -3581,6 +4476,13 @@ spdk_accel_set_opts(const struct spdk_accel_opts *opts)
 		return -EINVAL;
 	}
 
+	/* A single magazine must be enough to satisfy a sequence's task reservation */
+	if (SPDK_GET_FIELD(opts, depot_count, g_opts.depot_count, opts->opts_size) != 0 &&
+	    SPDK_GET_FIELD(opts, magazine_size, g_opts.magazine_size,
+			   opts->opts_size) < ACCEL_TASKS_IN_SEQUENCE_LIMIT) {
+		return -EINVAL;
+	}
+
 #define SET_FIELD(field) \
         if (offsetof(struct spdk_accel_opts, field) + sizeof(opts->field) <= opts->opts_size) { \
                 g_opts.field = opts->field; \
@@ -3591,6 +4493,10 @@ spdk_accel_set_opts(const struct spdk_accel_opts *opts)
 	SET_FIELD(task_count);
 	SET_FIELD(sequence_count);
 	SET_FIELD(buf_count);
+	SET_FIELD(compress_sample_size);
+	SET_FIELD(compress_entropy_threshold);
+	SET_FIELD(magazine_size);
+	SET_FIELD(depot_count);
 
 	g_opts.opts_size = opts->opts_size;
 
@@ -3624,12 +4530,16 @@ spdk_accel_get_opts(struct spdk_accel_opts *opts, size_t opts_size)
 	SET_FIELD(task_count);
 	SET_FIELD(sequence_count);
 	SET_FIELD(buf_count);
+	SET_FIELD(compress_sample_size);
+	SET_FIELD(compress_entropy_threshold);
+	SET_FIELD(magazine_size);
+	SET_FIELD(depot_count);
 
 #undef SET_FIELD
 
 	/* Do not remove this statement, you should always update this statement when you adding a new field,
 	 * and do not forget to add the SET_FIELD statement for your added field. */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_accel_opts) == 28, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_accel_opts) == 44, "Incorrect size");
 }
 
 struct accel_get_stats_ctx {
@@ -3746,6 +4656,11 @@ spdk_accel_get_opc_memory_domains(enum spdk_accel_opcode opcode,
 {
 	assert(opcode < SPDK_ACCEL_OPC_LAST);
 
+	/* Balanced operations are always executed using bounce buffers */
+	if (g_balance[opcode].num_modules > 0) {
+		return 0;
+	}
+
 	if (g_modules_opc[opcode].module->get_memory_domains) {
 		return g_modules_opc[opcode].module->get_memory_domains(domains, array_size);
 	}
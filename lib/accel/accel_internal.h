@@ -15,6 +15,9 @@
 
 #define ACCEL_AES_XTS "AES_XTS"
 
+/* Compression ratio histogram buckets, each covering 10% of the input size */
+#define ACCEL_COMPRESS_RATIO_BUCKETS 10
+
 struct module_info {
 	struct spdk_json_write_ctx *w;
 	const char *name;
@@ -26,6 +29,10 @@ struct accel_operation_stats {
 	uint64_t executed;
 	uint64_t failed;
 	uint64_t num_bytes;
+	/* Operations routed to each of the modules the opcode is balanced across */
+	uint64_t routed[SPDK_ACCEL_BALANCE_MAX_MODULES];
+	/* Operations resubmitted to another module after being rejected by the selected one */
+	uint64_t rerouted;
 };
 
 struct accel_stats {
@@ -41,6 +48,27 @@ struct accel_stats {
 		uint64_t iobuf;
 		uint64_t bufdesc;
 	} retry;
+
+	/* Magazines of objects moved between the channel and its NUMA node's depot */
+	struct {
+		uint64_t refill;
+		uint64_t release;
+		uint64_t exhausted;
+	} depot;
+
+	/* Compressibility checks and compressed size as a percentage of the input size */
+	struct {
+		uint64_t sampled;
+		uint64_t incompressible;
+		uint64_t ratio[ACCEL_COMPRESS_RATIO_BUCKETS];
+	} compress;
+
+	/* Tasks executed in a single pass over the data */
+	struct {
+		uint64_t executed;
+		uint64_t tasks;
+		uint64_t num_bytes;
+	} fused;
 };
 
 typedef void (*_accel_for_each_module_fn)(struct module_info *info);
@@ -49,5 +77,17 @@ void _accel_crypto_key_dump_param(struct spdk_json_write_ctx *w, struct spdk_acc
 void _accel_crypto_keys_dump_param(struct spdk_json_write_ctx *w);
 typedef void (*accel_get_stats_cb)(struct accel_stats *stats, void *cb_arg);
 int accel_get_stats(accel_get_stats_cb cb_fn, void *cb_arg);
+int accel_get_balance_modules(enum spdk_accel_opcode opcode, const char **names,
+			      enum spdk_accel_balance_policy *policy);
+int accel_sw_set_offload_opts(const char *cpumask, uint32_t queue_depth);
+
+/* Maximum number of sequence tasks executed in a single fused pass by the software module */
+#define ACCEL_SW_FUSED_MAX_TASKS 4
+
+struct spdk_accel_module_if;
+struct spdk_accel_task;
+bool accel_sw_supports_fusion(struct spdk_accel_module_if *module, enum spdk_accel_opcode opcode);
+bool accel_sw_can_fuse(struct spdk_accel_task **tasks, uint32_t count, struct spdk_accel_task *next);
+int accel_sw_execute_fused(struct spdk_accel_task **tasks, uint32_t count);
 
 #endif
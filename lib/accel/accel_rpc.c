@@ -173,6 +173,117 @@ cleanup:
 }
 SPDK_RPC_REGISTER("accel_assign_opc", rpc_accel_assign_opc, SPDK_RPC_STARTUP)
 
+struct rpc_accel_assign_opc_modules {
+	char *opname;
+	struct {
+		size_t num_modules;
+		char *names[SPDK_ACCEL_BALANCE_MAX_MODULES];
+	} modules;
+	enum spdk_accel_balance_policy policy;
+	uint32_t queue_depth;
+};
+
+static int
+rpc_decode_balance_modules(const struct spdk_json_val *val, void *out)
+{
+	struct rpc_accel_assign_opc_modules *req = SPDK_CONTAINEROF(out, struct
+			rpc_accel_assign_opc_modules, modules);
+
+	return spdk_json_decode_array(val, spdk_json_decode_string, req->modules.names,
+				      SPDK_ACCEL_BALANCE_MAX_MODULES, &req->modules.num_modules,
+				      sizeof(char *));
+}
+
+static int
+rpc_decode_balance_policy(const struct spdk_json_val *val, void *out)
+{
+	enum spdk_accel_balance_policy *policy = out;
+
+	if (spdk_json_strequal(val, "spillover")) {
+		*policy = SPDK_ACCEL_BALANCE_SPILLOVER;
+	} else if (spdk_json_strequal(val, "latency")) {
+		*policy = SPDK_ACCEL_BALANCE_LATENCY;
+	} else {
+		SPDK_NOTICELOG("Invalid parameter value: policy\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct spdk_json_object_decoder rpc_accel_assign_opc_modules_decoders[] = {
+	{"opname", offsetof(struct rpc_accel_assign_opc_modules, opname), spdk_json_decode_string},
+	{"modules", offsetof(struct rpc_accel_assign_opc_modules, modules), rpc_decode_balance_modules},
+	{"policy", offsetof(struct rpc_accel_assign_opc_modules, policy), rpc_decode_balance_policy, true},
+	{"queue_depth", offsetof(struct rpc_accel_assign_opc_modules, queue_depth), spdk_json_decode_uint32, true},
+};
+
+static void
+free_accel_assign_opc_modules(struct rpc_accel_assign_opc_modules *r)
+{
+	size_t i;
+
+	free(r->opname);
+	for (i = 0; i < r->modules.num_modules; i++) {
+		free(r->modules.names[i]);
+	}
+}
+
+static void
+rpc_accel_assign_opc_modules(struct spdk_jsonrpc_request *request,
+			     const struct spdk_json_val *params)
+{
+	struct rpc_accel_assign_opc_modules req = {
+		.policy = SPDK_ACCEL_BALANCE_SPILLOVER,
+		.queue_depth = 128,
+	};
+	const char *opcode_str;
+	enum spdk_accel_opcode opcode;
+	bool found = false;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_accel_assign_opc_modules_decoders,
+				    SPDK_COUNTOF(rpc_accel_assign_opc_modules_decoders),
+				    &req)) {
+		SPDK_DEBUGLOG(accel, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	for (opcode = 0; opcode < SPDK_ACCEL_OPC_LAST; opcode++) {
+		opcode_str = spdk_accel_get_opcode_name(opcode);
+		assert(opcode_str != NULL);
+		if (strcmp(opcode_str, req.opname) == 0) {
+			found = true;
+			break;
+		}
+	}
+
+	if (found == false) {
+		SPDK_DEBUGLOG(accel, "Invalid operation name\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid operation name");
+		goto cleanup;
+	}
+
+	rc = spdk_accel_assign_opc_modules(opcode, (const char **)req.modules.names,
+					   req.modules.num_modules, req.policy, req.queue_depth);
+	if (rc) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "error assigning opcode");
+		goto cleanup;
+	}
+
+	SPDK_NOTICELOG("Operation %s will be balanced across %zu modules\n", req.opname,
+		       req.modules.num_modules);
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_accel_assign_opc_modules(&req);
+}
+SPDK_RPC_REGISTER("accel_assign_opc_modules", rpc_accel_assign_opc_modules, SPDK_RPC_STARTUP)
+
 struct rpc_accel_crypto_key_create {
 	struct spdk_accel_crypto_key_create_param param;
 };
@@ -361,6 +472,10 @@ struct rpc_accel_opts {
 	uint32_t	task_count;
 	uint32_t	sequence_count;
 	uint32_t	buf_count;
+	uint32_t	compress_sample_size;
+	uint32_t	compress_entropy_threshold;
+	uint32_t	magazine_size;
+	uint32_t	depot_count;
 };
 
 static const struct spdk_json_object_decoder rpc_accel_set_options_decoders[] = {
@@ -369,6 +484,10 @@ static const struct spdk_json_object_decoder rpc_accel_set_options_decoders[] =
 	{"task_count", offsetof(struct rpc_accel_opts, task_count), spdk_json_decode_uint32, true},
 	{"sequence_count", offsetof(struct rpc_accel_opts, sequence_count), spdk_json_decode_uint32, true},
 	{"buf_count", offsetof(struct rpc_accel_opts, buf_count), spdk_json_decode_uint32, true},
+	{"compress_sample_size", offsetof(struct rpc_accel_opts, compress_sample_size), spdk_json_decode_uint32, true},
+	{"compress_entropy_threshold", offsetof(struct rpc_accel_opts, compress_entropy_threshold), spdk_json_decode_uint32, true},
+	{"magazine_size", offsetof(struct rpc_accel_opts, magazine_size), spdk_json_decode_uint32, true},
+	{"depot_count", offsetof(struct rpc_accel_opts, depot_count), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -386,6 +505,10 @@ rpc_accel_set_options(struct spdk_jsonrpc_request *request, const struct spdk_js
 	rpc_opts.task_count = opts.task_count;
 	rpc_opts.sequence_count = opts.sequence_count;
 	rpc_opts.buf_count = opts.buf_count;
+	rpc_opts.compress_sample_size = opts.compress_sample_size;
+	rpc_opts.compress_entropy_threshold = opts.compress_entropy_threshold;
+	rpc_opts.magazine_size = opts.magazine_size;
+	rpc_opts.depot_count = opts.depot_count;
 
 	if (spdk_json_decode_object(params, rpc_accel_set_options_decoders,
 				    SPDK_COUNTOF(rpc_accel_set_options_decoders), &rpc_opts)) {
@@ -399,6 +522,10 @@ rpc_accel_set_options(struct spdk_jsonrpc_request *request, const struct spdk_js
 	opts.task_count = rpc_opts.task_count;
 	opts.sequence_count = rpc_opts.sequence_count;
 	opts.buf_count = rpc_opts.buf_count;
+	opts.compress_sample_size = rpc_opts.compress_sample_size;
+	opts.compress_entropy_threshold = rpc_opts.compress_entropy_threshold;
+	opts.magazine_size = rpc_opts.magazine_size;
+	opts.depot_count = rpc_opts.depot_count;
 
 	rc = spdk_accel_set_opts(&opts);
 	if (rc != 0) {
@@ -410,13 +537,52 @@ rpc_accel_set_options(struct spdk_jsonrpc_request *request, const struct spdk_js
 }
 SPDK_RPC_REGISTER("accel_set_options", rpc_accel_set_options, SPDK_RPC_STARTUP)
 
+struct rpc_accel_sw_opts {
+	char		*offload_cpumask;
+	uint32_t	offload_queue_depth;
+};
+
+static const struct spdk_json_object_decoder rpc_accel_sw_set_options_decoders[] = {
+	{"offload_cpumask", offsetof(struct rpc_accel_sw_opts, offload_cpumask), spdk_json_decode_string, true},
+	{"offload_queue_depth", offsetof(struct rpc_accel_sw_opts, offload_queue_depth), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_accel_sw_set_options(struct spdk_jsonrpc_request *request, const struct spdk_json_val *params)
+{
+	struct rpc_accel_sw_opts rpc_opts = {
+		.offload_queue_depth = 4096,
+	};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_accel_sw_set_options_decoders,
+				    SPDK_COUNTOF(rpc_accel_sw_set_options_decoders), &rpc_opts)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = accel_sw_set_offload_opts(rpc_opts.offload_cpumask, rpc_opts.offload_queue_depth);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+cleanup:
+	free(rpc_opts.offload_cpumask);
+}
+SPDK_RPC_REGISTER("accel_sw_set_options", rpc_accel_sw_set_options, SPDK_RPC_STARTUP)
+
 static void
 rpc_accel_get_stats_done(struct accel_stats *stats, void *cb_arg)
 {
 	struct spdk_jsonrpc_request *request = cb_arg;
 	struct spdk_json_write_ctx *w;
 	const char *module_name;
-	int i, rc;
+	const char *balance_names[SPDK_ACCEL_BALANCE_MAX_MODULES];
+	enum spdk_accel_balance_policy policy;
+	int i, j, num_modules, rc;
 
 	w = spdk_jsonrpc_begin_result(request);
 	spdk_json_write_object_begin(w);
@@ -440,6 +606,19 @@ rpc_accel_get_stats_done(struct accel_stats *stats, void *cb_arg)
 		spdk_json_write_named_uint64(w, "executed", stats->operations[i].executed);
 		spdk_json_write_named_uint64(w, "failed", stats->operations[i].failed);
 		spdk_json_write_named_uint64(w, "num_bytes", stats->operations[i].num_bytes);
+		num_modules = accel_get_balance_modules(i, balance_names, &policy);
+		if (num_modules > 0) {
+			spdk_json_write_named_string(w, "policy", spdk_accel_get_balance_policy_name(policy));
+			spdk_json_write_named_uint64(w, "rerouted", stats->operations[i].rerouted);
+			spdk_json_write_named_array_begin(w, "modules");
+			for (j = 0; j < num_modules; j++) {
+				spdk_json_write_object_begin(w);
+				spdk_json_write_named_string(w, "module_name", balance_names[j]);
+				spdk_json_write_named_uint64(w, "executed", stats->operations[i].routed[j]);
+				spdk_json_write_object_end(w);
+			}
+			spdk_json_write_array_end(w);
+		}
 		spdk_json_write_object_end(w);
 	}
 	spdk_json_write_array_end(w);
@@ -448,6 +627,19 @@ rpc_accel_get_stats_done(struct accel_stats *stats, void *cb_arg)
 	spdk_json_write_named_uint64(w, "retry_sequence", stats->retry.sequence);
 	spdk_json_write_named_uint64(w, "retry_iobuf", stats->retry.iobuf);
 	spdk_json_write_named_uint64(w, "retry_bufdesc", stats->retry.bufdesc);
+	spdk_json_write_named_uint64(w, "depot_refill", stats->depot.refill);
+	spdk_json_write_named_uint64(w, "depot_release", stats->depot.release);
+	spdk_json_write_named_uint64(w, "depot_exhausted", stats->depot.exhausted);
+	spdk_json_write_named_uint64(w, "fused_executed", stats->fused.executed);
+	spdk_json_write_named_uint64(w, "fused_tasks", stats->fused.tasks);
+	spdk_json_write_named_uint64(w, "fused_bytes", stats->fused.num_bytes);
+	spdk_json_write_named_uint64(w, "compress_sampled", stats->compress.sampled);
+	spdk_json_write_named_uint64(w, "compress_incompressible", stats->compress.incompressible);
+	spdk_json_write_named_array_begin(w, "compress_ratio");
+	for (i = 0; i < ACCEL_COMPRESS_RATIO_BUCKETS; ++i) {
+		spdk_json_write_uint64(w, stats->compress.ratio[i]);
+	}
+	spdk_json_write_array_end(w);
 
 	spdk_json_write_object_end(w);
 	spdk_jsonrpc_end_result(request, w);
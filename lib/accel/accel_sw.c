@@ -18,6 +18,8 @@
 #include "spdk/util.h"
 #include "spdk/xor.h"
 #include "spdk/dif.h"
+#include "spdk/cpuset.h"
+#include "spdk/string.h"
 
 #ifdef SPDK_CONFIG_HAVE_LZ4
 #include <lz4.h>
@@ -44,6 +46,9 @@
 
 #define COMP_DEFLATE_LEVEL_NUM (COMP_DEFLATE_MAX_LEVEL + 1)
 
+#define SW_ACCEL_OFFLOAD_DEFAULT_QUEUE_DEPTH	4096
+#define SW_ACCEL_OFFLOAD_BATCH			32
+
 struct comp_deflate_level_buf {
 	uint32_t size;
 	uint8_t  *buf;
@@ -66,6 +71,39 @@ struct sw_accel_io_channel {
 #endif
 	struct spdk_poller		*completion_poller;
 	STAILQ_HEAD(, spdk_accel_task)	tasks_to_complete;
+	/* Tasks executed by the offload helpers, filled by the helpers and drained by the completion poller */
+	struct spdk_ring		*offload_comp_ring;
+	uint32_t			offload_outstanding;
+};
+
+struct sw_accel_task {
+	struct spdk_accel_task		task;
+	/* Channel the task has been submitted on, used to route completions of offloaded tasks */
+	struct sw_accel_io_channel	*sw_ch;
+};
+
+/*
+ * Helper thread executing offloaded tasks. Each one has its own set of compression streams, as
+ * those of the submitting channel can't be shared across threads.
+ */
+struct sw_accel_helper {
+	struct spdk_thread		*thread;
+	struct spdk_poller		*poller;
+	struct sw_accel_io_channel	ch;
+};
+
+static struct {
+	/* Cores to run the helpers on, offload is disabled if empty */
+	struct spdk_cpuset		cpumask;
+	uint32_t			queue_depth;
+	/* Tasks submitted by all channels, consumed by any of the helpers */
+	struct spdk_ring		*submit_ring;
+	struct sw_accel_helper		*helpers;
+	uint32_t			num_helpers;
+	uint32_t			num_running;
+	struct spdk_thread		*fini_thread;
+} g_sw_offload = {
+	.queue_depth = SW_ACCEL_OFFLOAD_DEFAULT_QUEUE_DEPTH,
 };
 
 typedef int (*sw_accel_crypto_op)(const uint8_t *k2, const uint8_t *k1,
@@ -678,20 +716,250 @@ _sw_accel_dix_verify(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *
 			       accel_task->dif.err);
 }
 
+/*
+ * Fused execution of sequence tasks. A chain of tasks, each consuming the output of the previous
+ * one, is executed tile by tile, so that the data is read from memory once and stays in cache
+ * for the remaining operations.
+ */
+#define SW_ACCEL_FUSED_TILE_SIZE	(16 * 1024)
+#define SW_ACCEL_FUSED_MAX_IOVS		32
+
+struct sw_accel_fused_buf {
+	struct iovec	*iovs;
+	uint32_t	iovcnt;
+	uint32_t	idx;
+	size_t		offset;
+	struct iovec	tile[SW_ACCEL_FUSED_MAX_IOVS];
+	uint32_t	tilecnt;
+};
+
+static bool
+sw_accel_fused_opcode(enum spdk_accel_opcode opcode)
+{
+	switch (opcode) {
+	case SPDK_ACCEL_OPC_COPY:
+	case SPDK_ACCEL_OPC_CRC32C:
+	case SPDK_ACCEL_OPC_ENCRYPT:
+	case SPDK_ACCEL_OPC_DECRYPT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline bool
+sw_accel_fused_crypto(struct spdk_accel_task *task)
+{
+	return task->op_code == SPDK_ACCEL_OPC_ENCRYPT || task->op_code == SPDK_ACCEL_OPC_DECRYPT;
+}
+
+/* Buffer holding the result of a task, i.e. the input of the next one */
+static inline void
+sw_accel_fused_output(struct spdk_accel_task *task, struct iovec **iovs, uint32_t *iovcnt)
+{
+	if (task->op_code == SPDK_ACCEL_OPC_CRC32C || task->d.iovcnt == 0) {
+		*iovs = task->s.iovs;
+		*iovcnt = task->s.iovcnt;
+	} else {
+		*iovs = task->d.iovs;
+		*iovcnt = task->d.iovcnt;
+	}
+}
+
+bool
+accel_sw_supports_fusion(struct spdk_accel_module_if *module, enum spdk_accel_opcode opcode)
+{
+	return module == &g_sw_module && sw_accel_fused_opcode(opcode);
+}
+
+bool
+accel_sw_can_fuse(struct spdk_accel_task **tasks, uint32_t count, struct spdk_accel_task *next)
+{
+	struct spdk_accel_task *prev = tasks[count - 1];
+	struct iovec *iovs;
+	uint32_t i, iovcnt;
+
+	if (!sw_accel_fused_opcode(prev->op_code) || !sw_accel_fused_opcode(next->op_code)) {
+		return false;
+	}
+	if (prev->nbytes != next->nbytes || prev->src_domain || prev->dst_domain ||
+	    next->src_domain || next->dst_domain) {
+		return false;
+	}
+	if (prev->s.iovcnt > SW_ACCEL_FUSED_MAX_IOVS || prev->d.iovcnt > SW_ACCEL_FUSED_MAX_IOVS ||
+	    next->s.iovcnt > SW_ACCEL_FUSED_MAX_IOVS || next->d.iovcnt > SW_ACCEL_FUSED_MAX_IOVS) {
+		return false;
+	}
+
+	/* Tiles are aligned to the crypto data unit, so only one of them is allowed in a chain */
+	if (sw_accel_fused_crypto(next)) {
+		for (i = 0; i < count; i++) {
+			if (sw_accel_fused_crypto(tasks[i])) {
+				return false;
+			}
+		}
+	}
+
+	sw_accel_fused_output(prev, &iovs, &iovcnt);
+
+	return iovcnt == next->s.iovcnt && memcmp(iovs, next->s.iovs, sizeof(*iovs) * iovcnt) == 0;
+}
+
+static void
+sw_accel_fused_buf_init(struct sw_accel_fused_buf *buf, struct iovec *iovs, uint32_t iovcnt)
+{
+	buf->iovs = iovs;
+	buf->iovcnt = iovcnt;
+	buf->idx = 0;
+	buf->offset = 0;
+	buf->tilecnt = 0;
+}
+
+/* Describes the next len bytes of the buffer in buf->tile */
+static void
+sw_accel_fused_buf_next(struct sw_accel_fused_buf *buf, size_t len)
+{
+	size_t seglen;
+
+	buf->tilecnt = 0;
+	while (len > 0 && buf->idx < buf->iovcnt) {
+		assert(buf->tilecnt < SW_ACCEL_FUSED_MAX_IOVS);
+		seglen = spdk_min(len, buf->iovs[buf->idx].iov_len - buf->offset);
+		buf->tile[buf->tilecnt].iov_base = (uint8_t *)buf->iovs[buf->idx].iov_base + buf->offset;
+		buf->tile[buf->tilecnt].iov_len = seglen;
+		buf->tilecnt++;
+
+		len -= seglen;
+		buf->offset += seglen;
+		if (buf->offset == buf->iovs[buf->idx].iov_len) {
+			buf->idx++;
+			buf->offset = 0;
+		}
+	}
+}
+
+static int
+sw_accel_fused_crypto_tile(struct spdk_accel_task *task, struct sw_accel_fused_buf *src,
+			   struct sw_accel_fused_buf *dst, uint64_t offset, size_t len)
+{
+	struct iovec *s_iovs = task->s.iovs, *d_iovs = task->d.iovs;
+	uint32_t s_iovcnt = task->s.iovcnt, d_iovcnt = task->d.iovcnt;
+	uint64_t iv = task->iv, nbytes = task->nbytes;
+	int rc;
+
+	task->s.iovs = src->tile;
+	task->s.iovcnt = src->tilecnt;
+	task->d.iovs = dst->tile;
+	task->d.iovcnt = dst->tilecnt;
+	task->iv = iv + offset / task->block_size;
+	task->nbytes = len;
+
+	if (task->op_code == SPDK_ACCEL_OPC_ENCRYPT) {
+		rc = _sw_accel_encrypt(NULL, task);
+	} else {
+		rc = _sw_accel_decrypt(NULL, task);
+	}
+
+	task->s.iovs = s_iovs;
+	task->s.iovcnt = s_iovcnt;
+	task->d.iovs = d_iovs;
+	task->d.iovcnt = d_iovcnt;
+	task->iv = iv;
+	task->nbytes = nbytes;
+
+	return rc;
+}
+
+int
+accel_sw_execute_fused(struct spdk_accel_task **tasks, uint32_t count)
+{
+	struct sw_accel_fused_buf src[ACCEL_SW_FUSED_MAX_TASKS], dst[ACCEL_SW_FUSED_MAX_TASKS];
+	struct spdk_accel_task *task;
+	uint64_t offset, nbytes = tasks[0]->nbytes;
+	size_t tile_size = SW_ACCEL_FUSED_TILE_SIZE, len;
+	uint32_t i;
+	int rc;
+
+	assert(count <= ACCEL_SW_FUSED_MAX_TASKS);
+	for (i = 0; i < count; i++) {
+		task = tasks[i];
+		if (sw_accel_fused_crypto(task)) {
+			if (spdk_unlikely(task->block_size == 0 || nbytes % task->block_size != 0)) {
+				return -EINVAL;
+			}
+			tile_size = spdk_max(task->block_size, tile_size / task->block_size * task->block_size);
+		}
+
+		sw_accel_fused_buf_init(&src[i], task->s.iovs, task->s.iovcnt);
+		if (task->d.iovcnt != 0) {
+			sw_accel_fused_buf_init(&dst[i], task->d.iovs, task->d.iovcnt);
+		} else {
+			sw_accel_fused_buf_init(&dst[i], task->s.iovs, task->s.iovcnt);
+		}
+	}
+
+	for (offset = 0; offset < nbytes; offset += len) {
+		len = spdk_min(tile_size, nbytes - offset);
+
+		for (i = 0; i < count; i++) {
+			task = tasks[i];
+			sw_accel_fused_buf_next(&src[i], len);
+
+			switch (task->op_code) {
+			case SPDK_ACCEL_OPC_COPY:
+				sw_accel_fused_buf_next(&dst[i], len);
+				_sw_accel_copy_iovs(dst[i].tile, dst[i].tilecnt, src[i].tile, src[i].tilecnt);
+				break;
+			case SPDK_ACCEL_OPC_CRC32C:
+				/* Continue the CRC calculated over the previous tiles */
+				_sw_accel_crc32cv(task->crc_dst, src[i].tile, src[i].tilecnt,
+						  offset == 0 ? task->seed : ~(*task->crc_dst));
+				break;
+			case SPDK_ACCEL_OPC_ENCRYPT:
+			case SPDK_ACCEL_OPC_DECRYPT:
+				sw_accel_fused_buf_next(&dst[i], len);
+				rc = sw_accel_fused_crypto_tile(task, &src[i], &dst[i], offset, len);
+				if (spdk_unlikely(rc != 0)) {
+					return rc;
+				}
+				break;
+			default:
+				assert(0 && "bad opcode");
+				return -EINVAL;
+			}
+		}
+	}
+
+	return 0;
+}
+
 static int
 accel_comp_poll(void *arg)
 {
 	struct sw_accel_io_channel	*sw_ch = arg;
 	STAILQ_HEAD(, spdk_accel_task)	tasks_to_complete;
 	struct spdk_accel_task		*accel_task;
+	void				*offloaded[SW_ACCEL_OFFLOAD_BATCH];
+	size_t				num_offloaded = 0, i;
+
+	if (sw_ch->offload_outstanding) {
+		num_offloaded = spdk_ring_dequeue(sw_ch->offload_comp_ring, offloaded,
+						  SW_ACCEL_OFFLOAD_BATCH);
+		sw_ch->offload_outstanding -= num_offloaded;
+	}
 
-	if (STAILQ_EMPTY(&sw_ch->tasks_to_complete)) {
+	if (STAILQ_EMPTY(&sw_ch->tasks_to_complete) && !num_offloaded) {
 		return SPDK_POLLER_IDLE;
 	}
 
 	STAILQ_INIT(&tasks_to_complete);
 	STAILQ_SWAP(&tasks_to_complete, &sw_ch->tasks_to_complete, spdk_accel_task);
 
+	for (i = 0; i < num_offloaded; i++) {
+		accel_task = offloaded[i];
+		STAILQ_INSERT_TAIL(&tasks_to_complete, accel_task, link);
+	}
+
 	while ((accel_task = STAILQ_FIRST(&tasks_to_complete))) {
 		STAILQ_REMOVE_HEAD(&tasks_to_complete, link);
 		spdk_accel_task_complete(accel_task, accel_task->status);
@@ -700,12 +968,120 @@ accel_comp_poll(void *arg)
 	return SPDK_POLLER_BUSY;
 }
 
+static int
+sw_accel_execute_task(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	int rc = 0;
+
+	switch (accel_task->op_code) {
+	case SPDK_ACCEL_OPC_COPY:
+		_sw_accel_copy_iovs(accel_task->d.iovs, accel_task->d.iovcnt,
+				    accel_task->s.iovs, accel_task->s.iovcnt);
+		break;
+	case SPDK_ACCEL_OPC_FILL:
+		rc = _sw_accel_fill(accel_task->d.iovs, accel_task->d.iovcnt,
+				    accel_task->fill_pattern);
+		break;
+	case SPDK_ACCEL_OPC_DUALCAST:
+		rc = _sw_accel_dualcast_iovs(accel_task->d.iovs, accel_task->d.iovcnt,
+					     accel_task->d2.iovs, accel_task->d2.iovcnt,
+					     accel_task->s.iovs, accel_task->s.iovcnt);
+		break;
+	case SPDK_ACCEL_OPC_COMPARE:
+		rc = _sw_accel_compare(accel_task->s.iovs, accel_task->s.iovcnt,
+				       accel_task->s2.iovs, accel_task->s2.iovcnt);
+		break;
+	case SPDK_ACCEL_OPC_CRC32C:
+		_sw_accel_crc32cv(accel_task->crc_dst, accel_task->s.iovs, accel_task->s.iovcnt, accel_task->seed);
+		break;
+	case SPDK_ACCEL_OPC_COPY_CRC32C:
+		_sw_accel_copy_iovs(accel_task->d.iovs, accel_task->d.iovcnt,
+				    accel_task->s.iovs, accel_task->s.iovcnt);
+		_sw_accel_crc32cv(accel_task->crc_dst, accel_task->s.iovs,
+				  accel_task->s.iovcnt, accel_task->seed);
+		break;
+	case SPDK_ACCEL_OPC_COMPRESS:
+		rc = _sw_accel_compress(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_DECOMPRESS:
+		rc = _sw_accel_decompress(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_XOR:
+		rc = _sw_accel_xor(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_ENCRYPT:
+		rc = _sw_accel_encrypt(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_DECRYPT:
+		rc = _sw_accel_decrypt(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_DIF_VERIFY:
+		rc = _sw_accel_dif_verify(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_DIF_VERIFY_COPY:
+		rc = _sw_accel_dif_verify_copy(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_DIF_GENERATE:
+		rc = _sw_accel_dif_generate(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_DIF_GENERATE_COPY:
+		rc = _sw_accel_dif_generate_copy(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_DIX_GENERATE:
+		rc = _sw_accel_dix_generate(sw_ch, accel_task);
+		break;
+	case SPDK_ACCEL_OPC_DIX_VERIFY:
+		rc = _sw_accel_dix_verify(sw_ch, accel_task);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+
+	return rc;
+}
+
+/*
+ * Hands the tasks over to the offload helpers. Returns the first task which couldn't be
+ * offloaded (it and the following ones are executed inline), or NULL if all of them were.
+ */
+static struct spdk_accel_task *
+sw_accel_offload_tasks(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	struct sw_accel_task *sw_task;
+	void *tasks[SW_ACCEL_OFFLOAD_BATCH];
+	struct spdk_accel_task *next;
+	size_t count;
+
+	while (accel_task) {
+		next = accel_task;
+		count = 0;
+		while (next && count < SW_ACCEL_OFFLOAD_BATCH &&
+		       sw_ch->offload_outstanding + count < g_sw_offload.queue_depth) {
+			sw_task = SPDK_CONTAINEROF(next, struct sw_accel_task, task);
+			sw_task->sw_ch = sw_ch;
+			tasks[count++] = next;
+			next = STAILQ_NEXT(next, link);
+		}
+
+		if (count == 0 || spdk_ring_enqueue(g_sw_offload.submit_ring, tasks, count, NULL) != count) {
+			/* The queues are full, don't wait for the helpers */
+			return accel_task;
+		}
+
+		sw_ch->offload_outstanding += count;
+		accel_task = next;
+	}
+
+	return NULL;
+}
+
 static int
 sw_accel_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *accel_task)
 {
 	struct sw_accel_io_channel *sw_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *tmp;
-	int rc = 0;
+	int rc;
 
 	/*
 	 * Lazily initialize our completion poller. We don't want to complete
@@ -715,82 +1091,52 @@ sw_accel_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *accel_
 		sw_ch->completion_poller = SPDK_POLLER_REGISTER(accel_comp_poll, sw_ch, 0);
 	}
 
-	do {
-		switch (accel_task->op_code) {
-		case SPDK_ACCEL_OPC_COPY:
-			_sw_accel_copy_iovs(accel_task->d.iovs, accel_task->d.iovcnt,
-					    accel_task->s.iovs, accel_task->s.iovcnt);
-			break;
-		case SPDK_ACCEL_OPC_FILL:
-			rc = _sw_accel_fill(accel_task->d.iovs, accel_task->d.iovcnt,
-					    accel_task->fill_pattern);
-			break;
-		case SPDK_ACCEL_OPC_DUALCAST:
-			rc = _sw_accel_dualcast_iovs(accel_task->d.iovs, accel_task->d.iovcnt,
-						     accel_task->d2.iovs, accel_task->d2.iovcnt,
-						     accel_task->s.iovs, accel_task->s.iovcnt);
-			break;
-		case SPDK_ACCEL_OPC_COMPARE:
-			rc = _sw_accel_compare(accel_task->s.iovs, accel_task->s.iovcnt,
-					       accel_task->s2.iovs, accel_task->s2.iovcnt);
-			break;
-		case SPDK_ACCEL_OPC_CRC32C:
-			_sw_accel_crc32cv(accel_task->crc_dst, accel_task->s.iovs, accel_task->s.iovcnt, accel_task->seed);
-			break;
-		case SPDK_ACCEL_OPC_COPY_CRC32C:
-			_sw_accel_copy_iovs(accel_task->d.iovs, accel_task->d.iovcnt,
-					    accel_task->s.iovs, accel_task->s.iovcnt);
-			_sw_accel_crc32cv(accel_task->crc_dst, accel_task->s.iovs,
-					  accel_task->s.iovcnt, accel_task->seed);
-			break;
-		case SPDK_ACCEL_OPC_COMPRESS:
-			rc = _sw_accel_compress(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_DECOMPRESS:
-			rc = _sw_accel_decompress(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_XOR:
-			rc = _sw_accel_xor(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_ENCRYPT:
-			rc = _sw_accel_encrypt(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_DECRYPT:
-			rc = _sw_accel_decrypt(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_DIF_VERIFY:
-			rc = _sw_accel_dif_verify(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_DIF_VERIFY_COPY:
-			rc = _sw_accel_dif_verify_copy(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_DIF_GENERATE:
-			rc = _sw_accel_dif_generate(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_DIF_GENERATE_COPY:
-			rc = _sw_accel_dif_generate_copy(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_DIX_GENERATE:
-			rc = _sw_accel_dix_generate(sw_ch, accel_task);
-			break;
-		case SPDK_ACCEL_OPC_DIX_VERIFY:
-			rc = _sw_accel_dix_verify(sw_ch, accel_task);
-			break;
-		default:
-			assert(false);
-			break;
-		}
+	if (sw_ch->offload_comp_ring != NULL) {
+		accel_task = sw_accel_offload_tasks(sw_ch, accel_task);
+	}
+
+	while (accel_task) {
+		rc = sw_accel_execute_task(sw_ch, accel_task);
 
 		tmp = STAILQ_NEXT(accel_task, link);
 
 		_add_to_comp_list(sw_ch, accel_task, rc);
 
 		accel_task = tmp;
-	} while (accel_task);
+	}
 
 	return 0;
 }
 
+static int
+sw_accel_helper_poll(void *arg)
+{
+	struct sw_accel_helper *helper = arg;
+	struct spdk_accel_task *accel_task;
+	struct sw_accel_task *sw_task;
+	void *tasks[SW_ACCEL_OFFLOAD_BATCH];
+	size_t count, i, rc;
+
+	count = spdk_ring_dequeue(g_sw_offload.submit_ring, tasks, SW_ACCEL_OFFLOAD_BATCH);
+	if (count == 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	for (i = 0; i < count; i++) {
+		accel_task = tasks[i];
+		sw_task = SPDK_CONTAINEROF(accel_task, struct sw_accel_task, task);
+
+		accel_task->status = sw_accel_execute_task(&helper->ch, accel_task);
+
+		/* The completion ring is sized for all tasks the channel may have offloaded */
+		rc = spdk_ring_enqueue(sw_task->sw_ch->offload_comp_ring, &tasks[i], 1, NULL);
+		assert(rc == 1);
+		(void)rc;
+	}
+
+	return SPDK_POLLER_BUSY;
+}
+
 static int
 sw_accel_create_cb(void *io_device, void *ctx_buf)
 {
@@ -802,17 +1148,31 @@ sw_accel_create_cb(void *io_device, void *ctx_buf)
 
 	STAILQ_INIT(&sw_ch->tasks_to_complete);
 	sw_ch->completion_poller = NULL;
+	sw_ch->offload_comp_ring = NULL;
+	sw_ch->offload_outstanding = 0;
+
+	/* The helpers don't offload tasks themselves */
+	if (io_device != NULL && g_sw_offload.submit_ring != NULL) {
+		sw_ch->offload_comp_ring = spdk_ring_create(SPDK_RING_TYPE_MP_SC, g_sw_offload.queue_depth,
+					   SPDK_ENV_NUMA_ID_ANY);
+		if (sw_ch->offload_comp_ring == NULL) {
+			SPDK_ERRLOG("Failed to create the offload completion ring\n");
+			return -ENOMEM;
+		}
+	}
 
 #ifdef SPDK_CONFIG_HAVE_LZ4
 	sw_ch->lz4_stream = LZ4_createStream();
 	if (sw_ch->lz4_stream == NULL) {
 		SPDK_ERRLOG("Failed to create the lz4 stream for compression\n");
+		spdk_ring_free(sw_ch->offload_comp_ring);
 		return -ENOMEM;
 	}
 	sw_ch->lz4_stream_decode = LZ4_createStreamDecode();
 	if (sw_ch->lz4_stream_decode == NULL) {
 		SPDK_ERRLOG("Failed to create the lz4 stream for decompression\n");
 		LZ4_freeStream(sw_ch->lz4_stream);
+		spdk_ring_free(sw_ch->offload_comp_ring);
 		return -ENOMEM;
 	}
 #endif
@@ -856,6 +1216,9 @@ sw_accel_destroy_cb(void *io_device, void *ctx_buf)
 	LZ4_freeStreamDecode(sw_ch->lz4_stream_decode);
 #endif
 	spdk_poller_unregister(&sw_ch->completion_poller);
+
+	assert(sw_ch->offload_outstanding == 0);
+	spdk_ring_free(sw_ch->offload_comp_ring);
 }
 
 static struct spdk_io_channel *
@@ -867,23 +1230,198 @@ sw_accel_get_io_channel(void)
 static size_t
 sw_accel_module_get_ctx_size(void)
 {
-	return sizeof(struct spdk_accel_task);
+	return sizeof(struct sw_accel_task);
+}
+
+int
+accel_sw_set_offload_opts(const char *cpumask, uint32_t queue_depth)
+{
+	struct spdk_cpuset mask, env_mask;
+	uint32_t core;
+	int rc;
+
+	if (queue_depth == 0) {
+		SPDK_ERRLOG("Offload queue depth must be greater than 0\n");
+		return -EINVAL;
+	}
+
+	spdk_cpuset_zero(&mask);
+	if (cpumask != NULL) {
+		rc = spdk_cpuset_parse(&mask, cpumask);
+		if (rc) {
+			SPDK_ERRLOG("Invalid offload cpumask: %s\n", cpumask);
+			return -EINVAL;
+		}
+
+		spdk_cpuset_zero(&env_mask);
+		SPDK_ENV_FOREACH_CORE(core) {
+			spdk_cpuset_set_cpu(&env_mask, core, true);
+		}
+		spdk_cpuset_and(&env_mask, &mask);
+		if (!spdk_cpuset_equal(&env_mask, &mask)) {
+			SPDK_ERRLOG("Offload cpumask %s is not a subset of the application's cores\n", cpumask);
+			return -EINVAL;
+		}
+	}
+
+	spdk_cpuset_copy(&g_sw_offload.cpumask, &mask);
+	g_sw_offload.queue_depth = queue_depth;
+
+	return 0;
+}
+
+static void
+sw_accel_helper_start(void *ctx)
+{
+	struct sw_accel_helper *helper = ctx;
+
+	helper->poller = SPDK_POLLER_REGISTER(sw_accel_helper_poll, helper, 0);
+}
+
+static void
+sw_accel_offload_free(void)
+{
+	free(g_sw_offload.helpers);
+	g_sw_offload.helpers = NULL;
+	spdk_ring_free(g_sw_offload.submit_ring);
+	g_sw_offload.submit_ring = NULL;
+	g_sw_offload.num_helpers = 0;
+}
+
+static int
+sw_accel_offload_init(void)
+{
+	struct sw_accel_helper *helper;
+	struct spdk_cpuset cpumask;
+	char name[32];
+	uint32_t core, i;
+	int rc = 0;
+
+	g_sw_offload.num_helpers = spdk_cpuset_count(&g_sw_offload.cpumask);
+	if (g_sw_offload.num_helpers == 0) {
+		return 0;
+	}
+
+	g_sw_offload.helpers = calloc(g_sw_offload.num_helpers, sizeof(*g_sw_offload.helpers));
+	g_sw_offload.submit_ring = spdk_ring_create(SPDK_RING_TYPE_MP_MC, g_sw_offload.queue_depth,
+				   SPDK_ENV_NUMA_ID_ANY);
+	if (g_sw_offload.helpers == NULL || g_sw_offload.submit_ring == NULL) {
+		SPDK_ERRLOG("Failed to allocate software accel offload resources\n");
+		sw_accel_offload_free();
+		return -ENOMEM;
+	}
+
+	i = 0;
+	SPDK_ENV_FOREACH_CORE(core) {
+		if (!spdk_cpuset_get_cpu(&g_sw_offload.cpumask, core)) {
+			continue;
+		}
+
+		helper = &g_sw_offload.helpers[i];
+		rc = sw_accel_create_cb(NULL, &helper->ch);
+		if (rc) {
+			break;
+		}
+
+		spdk_cpuset_zero(&cpumask);
+		spdk_cpuset_set_cpu(&cpumask, core, true);
+		snprintf(name, sizeof(name), "accel_sw_%u", core);
+		helper->thread = spdk_thread_create(name, &cpumask);
+		if (helper->thread == NULL) {
+			sw_accel_destroy_cb(NULL, &helper->ch);
+			rc = -ENOMEM;
+			break;
+		}
+
+		spdk_thread_send_msg(helper->thread, sw_accel_helper_start, helper);
+		i++;
+	}
+
+	g_sw_offload.num_running = i;
+	if (i != g_sw_offload.num_helpers) {
+		/* Run with the helpers that have been started */
+		SPDK_ERRLOG("Failed to start software accel offload helper: %s\n", spdk_strerror(-rc));
+		g_sw_offload.num_helpers = i;
+	}
+
+	SPDK_NOTICELOG("Software accel tasks offloaded to %u helper thread(s)\n", g_sw_offload.num_helpers);
+
+	return 0;
 }
 
 static int
 sw_accel_module_init(void)
 {
+	int rc;
+
+	rc = sw_accel_offload_init();
+	if (rc) {
+		return rc;
+	}
+
 	spdk_io_device_register(&g_sw_module, sw_accel_create_cb, sw_accel_destroy_cb,
 				sizeof(struct sw_accel_io_channel), "sw_accel_module");
 
 	return 0;
 }
 
+static void
+sw_accel_helper_stopped(void *ctx)
+{
+	assert(g_sw_offload.num_running > 0);
+	if (--g_sw_offload.num_running > 0) {
+		return;
+	}
+
+	sw_accel_offload_free();
+	spdk_accel_module_finish();
+}
+
+static void
+sw_accel_helper_stop(void *ctx)
+{
+	struct sw_accel_helper *helper = ctx;
+
+	spdk_poller_unregister(&helper->poller);
+	sw_accel_destroy_cb(NULL, &helper->ch);
+	spdk_thread_exit(helper->thread);
+	spdk_thread_send_msg(g_sw_offload.fini_thread, sw_accel_helper_stopped, NULL);
+}
+
 static void
 sw_accel_module_fini(void *ctxt)
 {
+	uint32_t i;
+
 	spdk_io_device_unregister(&g_sw_module, NULL);
-	spdk_accel_module_finish();
+
+	if (g_sw_offload.num_running == 0) {
+		sw_accel_offload_free();
+		spdk_accel_module_finish();
+		return;
+	}
+
+	g_sw_offload.fini_thread = spdk_get_thread();
+	for (i = 0; i < g_sw_offload.num_helpers; i++) {
+		spdk_thread_send_msg(g_sw_offload.helpers[i].thread, sw_accel_helper_stop,
+				     &g_sw_offload.helpers[i]);
+	}
+}
+
+static void
+sw_accel_write_config_json(struct spdk_json_write_ctx *w)
+{
+	if (spdk_cpuset_count(&g_sw_offload.cpumask) == 0) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "accel_sw_set_options");
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "offload_cpumask", spdk_cpuset_fmt(&g_sw_offload.cpumask));
+	spdk_json_write_named_uint32(w, "offload_queue_depth", g_sw_offload.queue_depth);
+	spdk_json_write_object_end(w);
+	spdk_json_write_object_end(w);
 }
 
 static int
@@ -1008,7 +1546,7 @@ sw_accel_get_operation_info(enum spdk_accel_opcode opcode,
 static struct spdk_accel_module_if g_sw_module = {
 	.module_init			= sw_accel_module_init,
 	.module_fini			= sw_accel_module_fini,
-	.write_config_json		= NULL,
+	.write_config_json		= sw_accel_write_config_json,
 	.get_ctx_size			= sw_accel_module_get_ctx_size,
 	.name				= "software",
 	.priority			= SPDK_ACCEL_SW_PRIORITY,
@@ -1181,8 +1181,15 @@ static void
 bdev_io_get_buf_complete(struct spdk_bdev_io *bdev_io, bool status)
 {
 	struct spdk_io_channel *ch = spdk_bdev_io_get_io_channel(bdev_io);
+	bool trace_io = spdk_trace_io_enabled();
+	uint64_t io_ctx = 0;
 	void *buf;
 
+	/* The buffer might have been released by another I/O, so switch to this one's context */
+	if (trace_io) {
+		io_ctx = spdk_trace_io_set_ctx(bdev_io->internal.trace_io_id);
+	}
+
 	if (spdk_unlikely(bdev_io->internal.get_aux_buf_cb != NULL)) {
 		buf = bdev_io->internal.buf.ptr;
 		bdev_io->internal.buf.ptr = NULL;
@@ -1194,6 +1201,10 @@ bdev_io_get_buf_complete(struct spdk_bdev_io *bdev_io, bool status)
 		bdev_io->internal.get_buf_cb(ch, bdev_io, status);
 		bdev_io->internal.get_buf_cb = NULL;
 	}
+
+	if (trace_io) {
+		spdk_trace_io_set_ctx(io_ctx);
+	}
 }
 
 static void
@@ -1610,6 +1621,15 @@ bdev_submit_request(struct spdk_bdev *bdev, struct spdk_io_channel *ioch,
 	       ((bdev_io->u.bdev.dif_check_flags & bdev->dif_check_flags) ==
 		bdev_io->u.bdev.dif_check_flags));
 
+	if (spdk_trace_io_enabled()) {
+		/* Make the requests sent by the module on behalf of this I/O inherit its trace id */
+		uint64_t io_ctx = spdk_trace_io_set_ctx(bdev_io->internal.trace_io_id);
+
+		bdev->fn_table->submit_request(ioch, bdev_io);
+		spdk_trace_io_set_ctx(io_ctx);
+		return;
+	}
+
 	bdev->fn_table->submit_request(ioch, bdev_io);
 }
 
@@ -3789,6 +3809,11 @@ bdev_io_submit(struct spdk_bdev_io *bdev_io)
 			      ch->trace_id, bdev_io->u.bdev.num_blocks,
 			      (uintptr_t)bdev_io, (uint64_t)bdev_io->type, bdev_io->internal.caller_ctx,
 			      bdev_io->u.bdev.offset_blocks, ch->queue_depth);
+	if (spdk_unlikely(bdev_io->internal.trace_io_id != 0)) {
+		spdk_trace_record_tsc(bdev_io->internal.submit_tsc, TRACE_IO_BDEV_SUBMIT, ch->trace_id,
+				      bdev_io->u.bdev.num_blocks, bdev_io->internal.trace_io_id,
+				      (uintptr_t)bdev_io, (uint64_t)bdev_io->type);
+	}
 
 	if (bdev_io->internal.f.split) {
 		bdev_io_split(bdev_io);
@@ -3998,6 +4023,7 @@ bdev_io_init(struct spdk_bdev_io *bdev_io,
 	bdev_io->internal.get_aux_buf_cb = NULL;
 	bdev_io->internal.data_transfer_cpl = NULL;
 	bdev_io->internal.f.split = bdev_io_should_split(bdev_io);
+	bdev_io->internal.trace_io_id = spdk_trace_io_enabled() ? spdk_trace_io_get_ctx() : 0;
 }
 
 static bool
@@ -7701,6 +7727,16 @@ _bdev_io_complete(void *ctx)
 	assert(bdev_io->internal.cb != NULL);
 	assert(spdk_get_thread() == spdk_bdev_io_get_thread(bdev_io));
 
+	if (spdk_trace_io_enabled()) {
+		/* The callback may continue processing the parent request, e.g. in a vbdev */
+		uint64_t io_ctx = spdk_trace_io_set_ctx(bdev_io->internal.trace_io_id);
+
+		bdev_io->internal.cb(bdev_io, bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS,
+				     bdev_io->internal.caller_ctx);
+		spdk_trace_io_set_ctx(io_ctx);
+		return;
+	}
+
 	bdev_io->internal.cb(bdev_io, bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS,
 			     bdev_io->internal.caller_ctx);
 }
@@ -7728,6 +7764,10 @@ bdev_io_complete(void *ctx)
 	bdev_ch_remove_from_io_submitted(bdev_io);
 	spdk_trace_record_tsc(tsc, TRACE_BDEV_IO_DONE, bdev_ch->trace_id, 0, (uintptr_t)bdev_io,
 			      bdev_io->internal.caller_ctx, bdev_ch->queue_depth);
+	if (spdk_unlikely(bdev_io->internal.trace_io_id != 0)) {
+		spdk_trace_record_tsc(tsc, TRACE_IO_BDEV_COMPLETE, bdev_ch->trace_id, 0,
+				      bdev_io->internal.trace_io_id, (uintptr_t)bdev_io);
+	}
 
 	if (bdev_ch->histogram) {
 		if (bdev_io->bdev->internal.histogram_io_type == 0 ||
@@ -149,6 +149,8 @@ static const struct option g_cmdline_options[] = {
 	{"no-rpc-server",		no_argument,		NULL, NO_RPC_SERVER_OPT_IDX},
 #define ENFORCE_NUMA_OPT_IDX 274
 	{"enforce-numa",		no_argument,		NULL, ENFORCE_NUMA_OPT_IDX},
+#define TIMER_WHEEL_OPT_IDX	275
+	{"timer-wheel",			no_argument,		NULL, TIMER_WHEEL_OPT_IDX},
 };
 
 static int
@@ -327,6 +329,7 @@ spdk_app_opts_init(struct spdk_app_opts *opts, size_t opts_size)
 	SET_FIELD(rpc_log_file, NULL);
 	SET_FIELD(rpc_log_level, SPDK_LOG_DISABLED);
 	SET_FIELD(disable_cpumask_locks, false);
+	SET_FIELD(timer_wheel, false);
 #undef SET_FIELD
 }
 
@@ -691,10 +694,11 @@ app_copy_opts(struct spdk_app_opts *opts, struct spdk_app_opts *opts_user, size_
 	SET_FIELD(json_data);
 	SET_FIELD(json_data_size);
 	SET_FIELD(disable_cpumask_locks);
+	SET_FIELD(timer_wheel);
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_app_opts) == 253, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_app_opts) == 254, "Incorrect size");
 
 #undef SET_FIELD
 }
@@ -918,6 +922,14 @@ spdk_app_start(struct spdk_app_opts *opts_user, spdk_msg_fn start_fn,
 
 	SPDK_NOTICELOG("Total cores available: %d\n", spdk_env_get_core_count());
 
+	if (opts->timer_wheel) {
+		rc = spdk_thread_lib_set_timer_type(SPDK_THREAD_TIMER_WHEEL);
+		if (rc != 0) {
+			SPDK_ERRLOG("Unable to select the timing wheel: rc = %d\n", rc);
+			return 1;
+		}
+	}
+
 	if ((rc = spdk_reactors_init(opts->msg_mempool_size)) != 0) {
 		SPDK_ERRLOG("Reactor Initialization failed: rc = %d\n", rc);
 		return 1;
@@ -1102,6 +1114,7 @@ usage(void (*app_usage)(void))
 	printf("     --disable-cpumask-locks    Disable CPU core lock files.\n");
 	printf("     --interrupt-mode      set app to interrupt mode (Warning: CPU usage will be reduced only if all\n");
 	printf("                           pollers in the app support interrupt mode)\n");
+	printf("     --timer-wheel         schedule timed pollers on a timing wheel instead of a red-black tree\n");
 	printf(" -p, --main-core <id>      main (primary) core for DPDK\n");
 
 	printf("\nConfiguration options:\n");
@@ -1443,6 +1456,9 @@ spdk_app_parse_args(int argc, char **argv, struct spdk_app_opts *opts,
 		case INTERRUPT_MODE_OPT_IDX:
 			opts->interrupt_mode = true;
 			break;
+		case TIMER_WHEEL_OPT_IDX:
+			opts->timer_wheel = true;
+			break;
 		case VERSION_OPT_IDX:
 			printf(SPDK_VERSION_STRING"\n");
 			retval = SPDK_APP_PARSE_ARGS_HELP;
@@ -5,6 +5,8 @@
 
 #include "spdk/stdinc.h"
 
+#include <dlfcn.h>
+
 #include "spdk/event.h"
 #include "spdk/rpc.h"
 #include "spdk/string.h"
@@ -237,12 +239,33 @@ rpc_get_poller(struct spdk_poller *poller, struct spdk_json_write_ctx *w)
 	spdk_json_write_named_string(w, "state", spdk_poller_get_state_str(poller));
 	spdk_json_write_named_uint64(w, "run_count", stats.run_count);
 	spdk_json_write_named_uint64(w, "busy_count", stats.busy_count);
+	spdk_json_write_named_uint64(w, "tsc", stats.tsc);
 	if (period_ticks) {
 		spdk_json_write_named_uint64(w, "period_ticks", period_ticks);
 	}
 	spdk_json_write_object_end(w);
 }
 
+static void
+rpc_get_msg_fn(void *ctx, const struct spdk_thread_msg_stats *stats)
+{
+	struct spdk_json_write_ctx *w = ctx;
+	Dl_info info = {};
+
+	spdk_json_write_object_begin(w);
+	/* Only exported functions can be resolved, report the address of the others */
+	if (dladdr((void *)stats->fn, &info) != 0 && info.dli_sname != NULL &&
+	    info.dli_saddr == (void *)stats->fn) {
+		spdk_json_write_named_string(w, "name", info.dli_sname);
+	} else {
+		spdk_json_write_named_string_fmt(w, "name", "%p", (void *)stats->fn);
+	}
+	spdk_json_write_named_uint64(w, "id", (uintptr_t)stats->fn);
+	spdk_json_write_named_uint64(w, "run_count", stats->count);
+	spdk_json_write_named_uint64(w, "tsc", stats->tsc);
+	spdk_json_write_object_end(w);
+}
+
 static void
 _rpc_thread_get_pollers(void *arg)
 {
@@ -275,6 +298,10 @@ _rpc_thread_get_pollers(void *arg)
 	}
 	spdk_json_write_array_end(ctx->w);
 
+	spdk_json_write_named_array_begin(ctx->w, "msg_functions");
+	spdk_thread_get_msg_stats(thread, rpc_get_msg_fn, ctx->w);
+	spdk_json_write_array_end(ctx->w);
+
 	spdk_json_write_object_end(ctx->w);
 }
 
@@ -801,4 +828,34 @@ err:
 	free(ctx);
 }
 SPDK_RPC_REGISTER("thread_set_cpumask", rpc_thread_set_cpumask, SPDK_RPC_RUNTIME)
+
+struct rpc_thread_set_cycle_sample_rate {
+	uint32_t rate;
+};
+
+static const struct spdk_json_object_decoder rpc_thread_set_cycle_sample_rate_decoders[] = {
+	{"rate", offsetof(struct rpc_thread_set_cycle_sample_rate, rate), spdk_json_decode_uint32},
+};
+
+static void
+rpc_thread_set_cycle_sample_rate(struct spdk_jsonrpc_request *request,
+				 const struct spdk_json_val *params)
+{
+	struct rpc_thread_set_cycle_sample_rate req = {};
+
+	if (spdk_json_decode_object(params, rpc_thread_set_cycle_sample_rate_decoders,
+				    SPDK_COUNTOF(rpc_thread_set_cycle_sample_rate_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "spdk_json_decode_object failed");
+		return;
+	}
+
+	spdk_thread_lib_set_cycle_sample_rate(req.rate);
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+SPDK_RPC_REGISTER("thread_set_cycle_sample_rate", rpc_thread_set_cycle_sample_rate,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
 SPDK_LOG_REGISTER_COMPONENT(app_rpc)
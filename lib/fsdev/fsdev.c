@@ -17,10 +17,14 @@
 
 #define SPDK_FSDEV_IO_POOL_SIZE (64 * 1024 - 1)
 #define SPDK_FSDEV_IO_CACHE_SIZE 256
+#define SPDK_FSDEV_LOOKUP_CACHE_SIZE 0
+#define SPDK_FSDEV_LOOKUP_CACHE_LEASE_MS 1000
 
 static struct spdk_fsdev_opts g_fsdev_opts = {
 	.fsdev_io_pool_size = SPDK_FSDEV_IO_POOL_SIZE,
 	.fsdev_io_cache_size = SPDK_FSDEV_IO_CACHE_SIZE,
+	.lookup_cache_size = SPDK_FSDEV_LOOKUP_CACHE_SIZE,
+	.lookup_cache_lease_ms = SPDK_FSDEV_LOOKUP_CACHE_LEASE_MS,
 };
 
 TAILQ_HEAD(spdk_fsdev_list, spdk_fsdev);
@@ -194,6 +198,8 @@ spdk_fsdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_object_begin(w, "params");
 	spdk_json_write_named_uint32(w, "fsdev_io_pool_size", g_fsdev_opts.fsdev_io_pool_size);
 	spdk_json_write_named_uint32(w, "fsdev_io_cache_size", g_fsdev_opts.fsdev_io_cache_size);
+	spdk_json_write_named_uint32(w, "lookup_cache_size", g_fsdev_opts.lookup_cache_size);
+	spdk_json_write_named_uint32(w, "lookup_cache_lease_ms", g_fsdev_opts.lookup_cache_lease_ms);
 	spdk_json_write_object_end(w); /* params */
 	spdk_json_write_object_end(w);
 
@@ -489,6 +495,22 @@ fsdev_io_submit(struct spdk_fsdev_io *fsdev_io)
 	fsdev_io->internal.in_submit_request = false;
 }
 
+void
+fsdev_io_complete_from_cache(struct spdk_fsdev_io *fsdev_io, int status)
+{
+	struct spdk_fsdev_channel *ch = fsdev_io->internal.ch;
+
+	TAILQ_INSERT_TAIL(&ch->io_submitted, fsdev_io, internal.ch_link);
+
+	ch->io_outstanding++;
+	ch->shared_resource->io_outstanding++;
+	fsdev_io->internal.cache_hit = true;
+	/* Still called from the submission path, so the completion gets deferred */
+	fsdev_io->internal.in_submit_request = true;
+	spdk_fsdev_io_complete(fsdev_io, status);
+	fsdev_io->internal.in_submit_request = false;
+}
+
 static void
 fsdev_channel_destroy_resource(struct spdk_fsdev_channel *ch)
 {
@@ -658,6 +680,8 @@ spdk_fsdev_set_opts(const struct spdk_fsdev_opts *opts)
 
 	SET_FIELD(fsdev_io_pool_size);
 	SET_FIELD(fsdev_io_cache_size);
+	SET_FIELD(lookup_cache_size);
+	SET_FIELD(lookup_cache_lease_ms);
 
 	g_fsdev_opts.opts_size = opts->opts_size;
 
@@ -688,10 +712,12 @@ spdk_fsdev_get_opts(struct spdk_fsdev_opts *opts, size_t opts_size)
 
 	SET_FIELD(fsdev_io_pool_size);
 	SET_FIELD(fsdev_io_cache_size);
+	SET_FIELD(lookup_cache_size);
+	SET_FIELD(lookup_cache_lease_ms);
 
 	/* Do not remove this statement, you should always update this statement when you adding a new field,
 	 * and do not forget to add the SET_FIELD statement for your added field. */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_fsdev_opts) == 12, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_fsdev_opts) == 20, "Incorrect size");
 
 #undef SET_FIELD
 	return 0;
@@ -804,8 +830,23 @@ fsdev_register(struct spdk_fsdev *fsdev)
 	fsdev->internal.status = SPDK_FSDEV_STATUS_READY;
 	TAILQ_INIT(&fsdev->internal.open_descs);
 
+	fsdev->internal.cache = NULL;
+	if (g_fsdev_opts.lookup_cache_size != 0) {
+		fsdev->internal.cache = fsdev_cache_create(g_fsdev_opts.lookup_cache_size,
+				       g_fsdev_opts.lookup_cache_lease_ms);
+		if (!fsdev->internal.cache) {
+			SPDK_ERRLOG("Unable to allocate the lookup cache for fsdev %s\n", fsdev->name);
+			free(fsdev_name);
+			return -ENOMEM;
+		}
+	}
+
 	ret = fsdev_name_add(&fsdev->internal.fsdev_name, fsdev, fsdev->name);
 	if (ret != 0) {
+		if (fsdev->internal.cache) {
+			fsdev_cache_free(fsdev->internal.cache);
+			fsdev->internal.cache = NULL;
+		}
 		free(fsdev_name);
 		return ret;
 	}
@@ -838,6 +879,11 @@ fsdev_destroy_cb(void *io_device)
 
 	spdk_spin_destroy(&fsdev->internal.spinlock);
 
+	if (fsdev->internal.cache) {
+		fsdev_cache_free(fsdev->internal.cache);
+		fsdev->internal.cache = NULL;
+	}
+
 	rc = fsdev->fn_table->destruct(fsdev->ctxt);
 	if (rc < 0) {
 		SPDK_ERRLOG("destruct failed\n");
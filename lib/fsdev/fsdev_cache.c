@@ -0,0 +1,618 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Per-fsdev dentry and attribute cache.
+ *
+ * Every file object the cache knows about has a node, holding its attributes and two counters:
+ * nlookup, the lookups of the object the module has answered (and so holds a reference for),
+ * and served, the lookups the cache has answered on the module's behalf.  The module never
+ * sees the latter, so they are taken off the forgets before those are passed down.  A lookup
+ * is only answered from the cache while nlookup is non-zero, which guarantees the module
+ * hasn't dropped the object yet.  The counters may under-estimate what the client holds (the
+ * node could have been evicted, readdir entries aren't counted), which only costs misses.
+ *
+ * A dentry maps a name in a directory node to a node, or to nothing for a negative entry.
+ * Dentries and attributes are valid for the lease time after they were filled in, and are
+ * dropped earlier by any operation changing them.  Operations filling the cache record the
+ * epoch they were submitted in and don't fill anything if an invalidation has happened since,
+ * as their result may predate it.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/env.h"
+#include "spdk/queue.h"
+#include "spdk/util.h"
+#include "spdk/fsdev_module.h"
+#include "fsdev_internal.h"
+
+struct fsdev_cache_node;
+
+struct fsdev_cache_dentry {
+	/* Directory the name is in */
+	struct fsdev_cache_node				*parent;
+	/* Object the name resolves to, NULL for a negative entry */
+	struct fsdev_cache_node				*node;
+	uint64_t					expire_tsc;
+	uint32_t					hash;
+	LIST_ENTRY(fsdev_cache_dentry)			hash_link;
+	LIST_ENTRY(fsdev_cache_dentry)			parent_link;
+	LIST_ENTRY(fsdev_cache_dentry)			alias_link;
+	TAILQ_ENTRY(fsdev_cache_dentry)			lru_link;
+	char						name[];
+};
+
+struct fsdev_cache_node {
+	struct spdk_fsdev_file_object			*fobject;
+	uint64_t					nlookup;
+	uint64_t					served;
+	struct spdk_fsdev_file_attr			attr;
+	/* 0 if the attributes are not valid */
+	uint64_t					attr_expire_tsc;
+	/* Dentries resolving to this node */
+	LIST_HEAD(, fsdev_cache_dentry)			aliases;
+	/* Dentries in this directory */
+	LIST_HEAD(, fsdev_cache_dentry)			children;
+	LIST_ENTRY(fsdev_cache_node)			hash_link;
+	TAILQ_ENTRY(fsdev_cache_node)			lru_link;
+};
+
+struct spdk_fsdev_cache {
+	pthread_mutex_t					lock;
+	uint64_t					epoch;
+	uint64_t					lease_tsc;
+	uint32_t					max_entries;
+	uint32_t					hash_mask;
+	uint32_t					num_dentries;
+	uint32_t					num_nodes;
+	LIST_HEAD(, fsdev_cache_dentry)			*dentry_hash;
+	LIST_HEAD(, fsdev_cache_node)			*node_hash;
+	TAILQ_HEAD(, fsdev_cache_dentry)		dentry_lru;
+	TAILQ_HEAD(, fsdev_cache_node)			node_lru;
+};
+
+/* How many nodes from the LRU head are looked at when searching for one to evict */
+#define FSDEV_CACHE_EVICT_SCAN 8
+
+static inline void
+fsdev_cache_bump_epoch(struct spdk_fsdev_cache *cache)
+{
+	/* Under the lock, the fsdev I/Os read it without it */
+	__atomic_store_n(&cache->epoch, cache->epoch + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t
+fsdev_cache_ptr_hash(const void *ptr)
+{
+	uint64_t h = (uintptr_t)ptr * 0x9E3779B97F4A7C15ULL;
+
+	return (uint32_t)(h >> 32);
+}
+
+static inline uint32_t
+fsdev_cache_name_hash(const struct fsdev_cache_node *parent, const char *name)
+{
+	/* FNV-1a, seeded with the parent */
+	uint32_t h = 2166136261u ^ fsdev_cache_ptr_hash(parent);
+
+	while (*name) {
+		h ^= (uint8_t)*name++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+static inline bool
+fsdev_cache_name_is_cacheable(const char *name)
+{
+	/* The dot entries are resolved by the module relative to the directory itself */
+	return name[0] != '\0' && strcmp(name, ".") != 0 && strcmp(name, "..") != 0;
+}
+
+static struct fsdev_cache_node *
+fsdev_cache_node_find(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *fobject)
+{
+	struct fsdev_cache_node *node;
+
+	LIST_FOREACH(node, &cache->node_hash[fsdev_cache_ptr_hash(fobject) & cache->hash_mask],
+		     hash_link) {
+		if (node->fobject == fobject) {
+			return node;
+		}
+	}
+
+	return NULL;
+}
+
+static struct fsdev_cache_dentry *
+fsdev_cache_dentry_find(struct spdk_fsdev_cache *cache, struct fsdev_cache_node *parent,
+			const char *name, uint32_t hash)
+{
+	struct fsdev_cache_dentry *dentry;
+
+	LIST_FOREACH(dentry, &cache->dentry_hash[hash & cache->hash_mask], hash_link) {
+		if (dentry->hash == hash && dentry->parent == parent && !strcmp(dentry->name, name)) {
+			return dentry;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+fsdev_cache_dentry_free(struct spdk_fsdev_cache *cache, struct fsdev_cache_dentry *dentry)
+{
+	LIST_REMOVE(dentry, hash_link);
+	LIST_REMOVE(dentry, parent_link);
+	if (dentry->node) {
+		LIST_REMOVE(dentry, alias_link);
+	}
+	TAILQ_REMOVE(&cache->dentry_lru, dentry, lru_link);
+	assert(cache->num_dentries > 0);
+	cache->num_dentries--;
+	free(dentry);
+}
+
+static void
+fsdev_cache_node_drop_dentries(struct spdk_fsdev_cache *cache, struct fsdev_cache_node *node)
+{
+	while (!LIST_EMPTY(&node->aliases)) {
+		fsdev_cache_dentry_free(cache, LIST_FIRST(&node->aliases));
+	}
+
+	while (!LIST_EMPTY(&node->children)) {
+		fsdev_cache_dentry_free(cache, LIST_FIRST(&node->children));
+	}
+}
+
+static void
+fsdev_cache_node_free(struct spdk_fsdev_cache *cache, struct fsdev_cache_node *node)
+{
+	fsdev_cache_node_drop_dentries(cache, node);
+	LIST_REMOVE(node, hash_link);
+	TAILQ_REMOVE(&cache->node_lru, node, lru_link);
+	assert(cache->num_nodes > 0);
+	cache->num_nodes--;
+	free(node);
+}
+
+static void
+fsdev_cache_node_put(struct spdk_fsdev_cache *cache, struct fsdev_cache_node *node)
+{
+	if (node->nlookup == 0 && node->served == 0) {
+		fsdev_cache_node_free(cache, node);
+	}
+}
+
+static bool
+fsdev_cache_node_evict(struct spdk_fsdev_cache *cache)
+{
+	struct fsdev_cache_node *node;
+	int i = 0;
+
+	/*
+	 * Nodes with lookups served from the cache must stay until the client forgets them, the
+	 * module would otherwise get more forgets than lookups.  The other ones just lose the
+	 * count of lookups, which is safe.
+	 */
+	TAILQ_FOREACH(node, &cache->node_lru, lru_link) {
+		if (node->served == 0) {
+			fsdev_cache_node_free(cache, node);
+			return true;
+		}
+
+		if (++i == FSDEV_CACHE_EVICT_SCAN) {
+			break;
+		}
+	}
+
+	return false;
+}
+
+static struct fsdev_cache_node *
+fsdev_cache_node_get(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *fobject)
+{
+	struct fsdev_cache_node *node;
+
+	node = fsdev_cache_node_find(cache, fobject);
+	if (node) {
+		TAILQ_REMOVE(&cache->node_lru, node, lru_link);
+		TAILQ_INSERT_TAIL(&cache->node_lru, node, lru_link);
+		return node;
+	}
+
+	if (cache->num_nodes >= cache->max_entries && !fsdev_cache_node_evict(cache)) {
+		return NULL;
+	}
+
+	node = calloc(1, sizeof(*node));
+	if (!node) {
+		return NULL;
+	}
+
+	node->fobject = fobject;
+	LIST_INIT(&node->aliases);
+	LIST_INIT(&node->children);
+	LIST_INSERT_HEAD(&cache->node_hash[fsdev_cache_ptr_hash(fobject) & cache->hash_mask], node,
+			 hash_link);
+	TAILQ_INSERT_TAIL(&cache->node_lru, node, lru_link);
+	cache->num_nodes++;
+
+	return node;
+}
+
+static void
+fsdev_cache_dentry_set(struct spdk_fsdev_cache *cache, struct fsdev_cache_node *parent,
+		       const char *name, struct fsdev_cache_node *node, uint64_t expire_tsc)
+{
+	struct fsdev_cache_dentry *dentry;
+	uint32_t hash = fsdev_cache_name_hash(parent, name);
+	size_t len;
+
+	dentry = fsdev_cache_dentry_find(cache, parent, name, hash);
+	if (dentry) {
+		fsdev_cache_dentry_free(cache, dentry);
+	}
+
+	if (cache->num_dentries >= cache->max_entries) {
+		fsdev_cache_dentry_free(cache, TAILQ_FIRST(&cache->dentry_lru));
+	}
+
+	len = strlen(name) + 1;
+	dentry = malloc(sizeof(*dentry) + len);
+	if (!dentry) {
+		return;
+	}
+
+	memcpy(dentry->name, name, len);
+	dentry->parent = parent;
+	dentry->node = node;
+	dentry->expire_tsc = expire_tsc;
+	dentry->hash = hash;
+	LIST_INSERT_HEAD(&cache->dentry_hash[hash & cache->hash_mask], dentry, hash_link);
+	LIST_INSERT_HEAD(&parent->children, dentry, parent_link);
+	if (node) {
+		LIST_INSERT_HEAD(&node->aliases, dentry, alias_link);
+	}
+	TAILQ_INSERT_TAIL(&cache->dentry_lru, dentry, lru_link);
+	cache->num_dentries++;
+}
+
+struct spdk_fsdev_cache *
+fsdev_cache_create(uint32_t max_entries, uint32_t lease_ms)
+{
+	struct spdk_fsdev_cache *cache;
+	uint32_t num_buckets, i;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache) {
+		return NULL;
+	}
+
+	num_buckets = spdk_align32pow2(spdk_max(max_entries, 2));
+	cache->dentry_hash = calloc(num_buckets, sizeof(*cache->dentry_hash));
+	cache->node_hash = calloc(num_buckets, sizeof(*cache->node_hash));
+	if (!cache->dentry_hash || !cache->node_hash) {
+		free(cache->dentry_hash);
+		free(cache->node_hash);
+		free(cache);
+		return NULL;
+	}
+
+	for (i = 0; i < num_buckets; i++) {
+		LIST_INIT(&cache->dentry_hash[i]);
+		LIST_INIT(&cache->node_hash[i]);
+	}
+
+	if (pthread_mutex_init(&cache->lock, NULL)) {
+		free(cache->dentry_hash);
+		free(cache->node_hash);
+		free(cache);
+		return NULL;
+	}
+
+	cache->hash_mask = num_buckets - 1;
+	cache->max_entries = max_entries;
+	cache->lease_tsc = (uint64_t)lease_ms * spdk_get_ticks_hz() / SPDK_SEC_TO_MSEC;
+	cache->epoch = 1;
+	TAILQ_INIT(&cache->dentry_lru);
+	TAILQ_INIT(&cache->node_lru);
+
+	return cache;
+}
+
+static void
+fsdev_cache_flush_locked(struct spdk_fsdev_cache *cache)
+{
+	fsdev_cache_bump_epoch(cache);
+	while (!TAILQ_EMPTY(&cache->node_lru)) {
+		fsdev_cache_node_free(cache, TAILQ_FIRST(&cache->node_lru));
+	}
+
+	assert(cache->num_dentries == 0);
+}
+
+void
+fsdev_cache_free(struct spdk_fsdev_cache *cache)
+{
+	fsdev_cache_flush_locked(cache);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache->dentry_hash);
+	free(cache->node_hash);
+	free(cache);
+}
+
+uint64_t
+fsdev_cache_get_epoch(struct spdk_fsdev_cache *cache)
+{
+	return __atomic_load_n(&cache->epoch, __ATOMIC_ACQUIRE);
+}
+
+bool
+fsdev_cache_lookup(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *parent_fobject,
+		   const char *name, struct spdk_fsdev_file_object **fobject,
+		   struct spdk_fsdev_file_attr *attr, int *status)
+{
+	struct fsdev_cache_node *parent, *node;
+	struct fsdev_cache_dentry *dentry;
+	uint64_t now;
+	bool hit = false;
+
+	if (!parent_fobject || !fsdev_cache_name_is_cacheable(name)) {
+		return false;
+	}
+
+	now = spdk_get_ticks();
+
+	pthread_mutex_lock(&cache->lock);
+	parent = fsdev_cache_node_find(cache, parent_fobject);
+	if (!parent) {
+		goto out;
+	}
+
+	dentry = fsdev_cache_dentry_find(cache, parent, name, fsdev_cache_name_hash(parent, name));
+	if (!dentry) {
+		goto out;
+	}
+
+	if (now >= dentry->expire_tsc) {
+		fsdev_cache_dentry_free(cache, dentry);
+		goto out;
+	}
+
+	node = dentry->node;
+	if (!node) {
+		*fobject = NULL;
+		*status = -ENOENT;
+		hit = true;
+	} else if (node->nlookup != 0 && now < node->attr_expire_tsc) {
+		node->served++;
+		*fobject = node->fobject;
+		*attr = node->attr;
+		*status = 0;
+		hit = true;
+		TAILQ_REMOVE(&cache->node_lru, node, lru_link);
+		TAILQ_INSERT_TAIL(&cache->node_lru, node, lru_link);
+	}
+
+	if (hit) {
+		TAILQ_REMOVE(&cache->dentry_lru, dentry, lru_link);
+		TAILQ_INSERT_TAIL(&cache->dentry_lru, dentry, lru_link);
+	}
+out:
+	pthread_mutex_unlock(&cache->lock);
+	return hit;
+}
+
+void
+fsdev_cache_lookup_done(struct spdk_fsdev_cache *cache, uint64_t epoch,
+			struct spdk_fsdev_file_object *parent_fobject, const char *name, int status,
+			struct spdk_fsdev_file_object *fobject, const struct spdk_fsdev_file_attr *attr)
+{
+	struct fsdev_cache_node *parent, *node = NULL;
+	uint64_t now = spdk_get_ticks();
+
+	pthread_mutex_lock(&cache->lock);
+	if (status == 0) {
+		/* The lookup is counted even if its result is too old to be cached */
+		node = fsdev_cache_node_get(cache, fobject);
+		if (!node) {
+			goto out;
+		}
+		node->nlookup++;
+	}
+
+	if (epoch != cache->epoch || !parent_fobject || !fsdev_cache_name_is_cacheable(name)) {
+		goto out;
+	}
+
+	/* Creating the node above could have evicted the parent, so it's only looked up now */
+	parent = fsdev_cache_node_find(cache, parent_fobject);
+	if (!parent || parent == node) {
+		goto out;
+	}
+
+	if (status == 0) {
+		node->attr = *attr;
+		node->attr_expire_tsc = now + cache->lease_tsc;
+		fsdev_cache_dentry_set(cache, parent, name, node, now + cache->lease_tsc);
+	} else if (status == -ENOENT) {
+		fsdev_cache_dentry_set(cache, parent, name, NULL, now + cache->lease_tsc);
+	}
+out:
+	pthread_mutex_unlock(&cache->lock);
+}
+
+uint64_t
+fsdev_cache_forget(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *fobject,
+		   uint64_t nlookup)
+{
+	struct fsdev_cache_node *node;
+	uint64_t absorbed;
+
+	pthread_mutex_lock(&cache->lock);
+	node = fsdev_cache_node_find(cache, fobject);
+	if (node) {
+		/*
+		 * The lookups served from the cache are forgotten first, so that the module keeps
+		 * holding the object for as long as the client may use the ones it served.
+		 */
+		absorbed = spdk_min(node->served, nlookup);
+		node->served -= absorbed;
+		nlookup -= absorbed;
+		node->nlookup -= spdk_min(node->nlookup, nlookup);
+		fsdev_cache_node_put(cache, node);
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return nlookup;
+}
+
+bool
+fsdev_cache_getattr(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *fobject,
+		    struct spdk_fsdev_file_attr *attr)
+{
+	struct fsdev_cache_node *node;
+	uint64_t now = spdk_get_ticks();
+	bool hit = false;
+
+	pthread_mutex_lock(&cache->lock);
+	node = fsdev_cache_node_find(cache, fobject);
+	if (node && now < node->attr_expire_tsc) {
+		*attr = node->attr;
+		hit = true;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return hit;
+}
+
+void
+fsdev_cache_getattr_done(struct spdk_fsdev_cache *cache, uint64_t epoch,
+			 struct spdk_fsdev_file_object *fobject, const struct spdk_fsdev_file_attr *attr)
+{
+	struct fsdev_cache_node *node;
+
+	pthread_mutex_lock(&cache->lock);
+	if (epoch == cache->epoch) {
+		/* Only objects already known are updated, as the nodes keep the lookup count */
+		node = fsdev_cache_node_find(cache, fobject);
+		if (node) {
+			node->attr = *attr;
+			node->attr_expire_tsc = spdk_get_ticks() + cache->lease_tsc;
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void
+fsdev_cache_mount_done(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *root)
+{
+	struct fsdev_cache_node *node;
+
+	pthread_mutex_lock(&cache->lock);
+	fsdev_cache_flush_locked(cache);
+	/* The root is held by the mount */
+	node = fsdev_cache_node_get(cache, root);
+	if (node) {
+		node->nlookup++;
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void
+fsdev_cache_flush(struct spdk_fsdev_cache *cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	fsdev_cache_flush_locked(cache);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void
+fsdev_cache_invalidate_attr(struct spdk_fsdev_cache *cache,
+			    struct spdk_fsdev_file_object *fobject)
+{
+	struct fsdev_cache_node *node;
+
+	pthread_mutex_lock(&cache->lock);
+	fsdev_cache_bump_epoch(cache);
+	node = fsdev_cache_node_find(cache, fobject);
+	if (node) {
+		node->attr_expire_tsc = 0;
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/* Returns the object the entry resolved to, if it was cached */
+static struct spdk_fsdev_file_object *
+fsdev_cache_drop_entry(struct spdk_fsdev_cache *cache,
+		       struct spdk_fsdev_file_object *parent_fobject, const char *name)
+{
+	struct spdk_fsdev_file_object *fobject = NULL;
+	struct fsdev_cache_node *parent;
+	struct fsdev_cache_dentry *dentry;
+
+	pthread_mutex_lock(&cache->lock);
+	fsdev_cache_bump_epoch(cache);
+	parent = fsdev_cache_node_find(cache, parent_fobject);
+	if (parent) {
+		dentry = fsdev_cache_dentry_find(cache, parent, name, fsdev_cache_name_hash(parent, name));
+		if (dentry) {
+			if (dentry->node) {
+				fobject = dentry->node->fobject;
+			}
+			fsdev_cache_dentry_free(cache, dentry);
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return fobject;
+}
+
+void
+fsdev_cache_invalidate_entry(struct spdk_fsdev_cache *cache,
+			     struct spdk_fsdev_file_object *parent_fobject, const char *name)
+{
+	struct spdk_fsdev_file_object *fobject;
+
+	fobject = fsdev_cache_drop_entry(cache, parent_fobject, name);
+	/* Adding or removing a name changes the directory's times and the object's nlink */
+	fsdev_cache_invalidate_attr(cache, parent_fobject);
+	if (fobject) {
+		fsdev_cache_invalidate_attr(cache, fobject);
+	}
+}
+
+void
+fsdev_cache_invalidate_fobject(struct spdk_fsdev_cache *cache,
+			       struct spdk_fsdev_file_object *fobject)
+{
+	struct fsdev_cache_node *node;
+
+	pthread_mutex_lock(&cache->lock);
+	fsdev_cache_bump_epoch(cache);
+	node = fsdev_cache_node_find(cache, fobject);
+	if (node) {
+		node->attr_expire_tsc = 0;
+		fsdev_cache_node_drop_dentries(cache, node);
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void
+spdk_fsdev_invalidate_entry(struct spdk_fsdev *fsdev, struct spdk_fsdev_file_object *parent_fobject,
+			    const char *name)
+{
+	if (fsdev->internal.cache) {
+		fsdev_cache_invalidate_entry(fsdev->internal.cache, parent_fobject, name);
+	}
+}
+
+void
+spdk_fsdev_invalidate_fobject(struct spdk_fsdev *fsdev, struct spdk_fsdev_file_object *fobject)
+{
+	if (fsdev->internal.cache) {
+		fsdev_cache_invalidate_fobject(fsdev->internal.cache, fobject);
+	}
+}
@@ -12,8 +12,33 @@
 #include "spdk/thread.h"
 
 void fsdev_io_submit(struct spdk_fsdev_io *fsdev_io);
+void fsdev_io_complete_from_cache(struct spdk_fsdev_io *fsdev_io, int status);
 struct spdk_fsdev_io *fsdev_channel_get_io(struct spdk_fsdev_channel *channel);
 
+struct spdk_fsdev_cache *fsdev_cache_create(uint32_t max_entries, uint32_t lease_ms);
+void fsdev_cache_free(struct spdk_fsdev_cache *cache);
+uint64_t fsdev_cache_get_epoch(struct spdk_fsdev_cache *cache);
+bool fsdev_cache_lookup(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *parent_fobject,
+			const char *name, struct spdk_fsdev_file_object **fobject,
+			struct spdk_fsdev_file_attr *attr, int *status);
+void fsdev_cache_lookup_done(struct spdk_fsdev_cache *cache, uint64_t epoch,
+			     struct spdk_fsdev_file_object *parent_fobject, const char *name, int status,
+			     struct spdk_fsdev_file_object *fobject, const struct spdk_fsdev_file_attr *attr);
+uint64_t fsdev_cache_forget(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *fobject,
+			    uint64_t nlookup);
+bool fsdev_cache_getattr(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *fobject,
+			 struct spdk_fsdev_file_attr *attr);
+void fsdev_cache_getattr_done(struct spdk_fsdev_cache *cache, uint64_t epoch,
+			      struct spdk_fsdev_file_object *fobject, const struct spdk_fsdev_file_attr *attr);
+void fsdev_cache_mount_done(struct spdk_fsdev_cache *cache, struct spdk_fsdev_file_object *root);
+void fsdev_cache_flush(struct spdk_fsdev_cache *cache);
+void fsdev_cache_invalidate_attr(struct spdk_fsdev_cache *cache,
+				 struct spdk_fsdev_file_object *fobject);
+void fsdev_cache_invalidate_entry(struct spdk_fsdev_cache *cache,
+				  struct spdk_fsdev_file_object *parent_fobject, const char *name);
+void fsdev_cache_invalidate_fobject(struct spdk_fsdev_cache *cache,
+				    struct spdk_fsdev_file_object *fobject);
+
 #define __io_ch_to_fsdev_ch(io_ch)	((struct spdk_fsdev_channel *)spdk_io_channel_get_ctx(io_ch))
 
 #endif /* SPDK_FSDEV_INT_H */
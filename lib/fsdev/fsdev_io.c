@@ -43,6 +43,7 @@ fsdev_io_get_and_fill(struct spdk_fsdev_desc *desc, struct spdk_io_channel *ch,
 	fsdev_io->internal.cb_fn = cb_fn;
 	fsdev_io->internal.status = -ENOSYS;
 	fsdev_io->internal.in_submit_request = false;
+	fsdev_io->internal.cache_hit = false;
 
 	return fsdev_io;
 }
@@ -53,10 +54,41 @@ fsdev_io_free(struct spdk_fsdev_io *fsdev_io)
 	spdk_fsdev_free_io(fsdev_io);
 }
 
+/*
+ * The cache is updated when the I/Os changing it complete, before the user gets to know, so
+ * that anything it submits afterwards sees the change.
+ */
+static inline void
+fsdev_io_invalidate_attr(struct spdk_fsdev_io *fsdev_io, struct spdk_fsdev_file_object *fobject)
+{
+	struct spdk_fsdev_cache *cache = fsdev_io->fsdev->internal.cache;
+
+	if (cache) {
+		fsdev_cache_invalidate_attr(cache, fobject);
+	}
+}
+
+/* Also drops the attributes of the directory and of the object the name resolved to */
+static inline void
+fsdev_io_invalidate_entry(struct spdk_fsdev_io *fsdev_io,
+			  struct spdk_fsdev_file_object *parent_fobject, const char *name)
+{
+	struct spdk_fsdev_cache *cache = fsdev_io->fsdev->internal.cache;
+
+	if (cache) {
+		fsdev_cache_invalidate_entry(cache, parent_fobject, name);
+	}
+}
+
 static void
 _spdk_fsdev_mount_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
+	struct spdk_fsdev_cache *cache = fsdev_io->fsdev->internal.cache;
+
+	if (cache && fsdev_io->internal.status == 0) {
+		fsdev_cache_mount_done(cache, fsdev_io->u_out.mount.root_fobject);
+	}
 
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_mount_cpl_cb, &fsdev_io->u_out.mount.opts,
 		     fsdev_io->u_out.mount.root_fobject);
@@ -105,6 +137,11 @@ spdk_fsdev_umount(struct spdk_fsdev_desc *desc, struct spdk_io_channel *ch,
 		return -ENOBUFS;
 	}
 
+	/* The module drops all its file objects */
+	if (fsdev_io->fsdev->internal.cache) {
+		fsdev_cache_flush(fsdev_io->fsdev->internal.cache);
+	}
+
 	fsdev_io_submit(fsdev_io);
 	return 0;
 
@@ -114,6 +151,14 @@ static void
 _spdk_fsdev_lookup_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
+	struct spdk_fsdev_cache *cache = fsdev_io->fsdev->internal.cache;
+
+	if (cache && !fsdev_io->internal.cache_hit) {
+		fsdev_cache_lookup_done(cache, fsdev_io->internal.cache_epoch,
+					fsdev_io->u_in.lookup.parent_fobject, fsdev_io->u_in.lookup.name,
+					fsdev_io->internal.status, fsdev_io->u_out.lookup.fobject,
+					&fsdev_io->u_out.lookup.attr);
+	}
 
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_lookup_cpl_cb, fsdev_io->u_out.lookup.fobject,
 		     &fsdev_io->u_out.lookup.attr);
@@ -128,6 +173,8 @@ spdk_fsdev_lookup(struct spdk_fsdev_desc *desc, struct spdk_io_channel *ch, uint
 		  spdk_fsdev_lookup_cpl_cb cb_fn, void *cb_arg)
 {
 	struct spdk_fsdev_io *fsdev_io;
+	struct spdk_fsdev_cache *cache;
+	int status;
 
 	fsdev_io = fsdev_io_get_and_fill(desc, ch, unique, cb_fn, cb_arg, _spdk_fsdev_lookup_cb, ch,
 					 SPDK_FSDEV_IO_LOOKUP);
@@ -135,6 +182,18 @@ spdk_fsdev_lookup(struct spdk_fsdev_desc *desc, struct spdk_io_channel *ch, uint
 		return -ENOBUFS;
 	}
 
+	cache = fsdev_io->fsdev->internal.cache;
+	if (cache) {
+		fsdev_io->internal.cache_epoch = fsdev_cache_get_epoch(cache);
+		if (fsdev_cache_lookup(cache, parent_fobject, name, &fsdev_io->u_out.lookup.fobject,
+				       &fsdev_io->u_out.lookup.attr, &status)) {
+			fsdev_io->u_in.lookup.parent_fobject = parent_fobject;
+			fsdev_io->u_in.lookup.name = NULL;
+			fsdev_io_complete_from_cache(fsdev_io, status);
+			return 0;
+		}
+	}
+
 	fsdev_io->u_in.lookup.name = strdup(name);
 	if (!fsdev_io->u_in.lookup.name) {
 		fsdev_io_free(fsdev_io);
@@ -170,9 +229,19 @@ spdk_fsdev_forget(struct spdk_fsdev_desc *desc, struct spdk_io_channel *ch, uint
 		return -ENOBUFS;
 	}
 
+	if (fsdev_io->fsdev->internal.cache) {
+		/* The module only knows about the lookups it has answered itself */
+		nlookup = fsdev_cache_forget(fsdev_io->fsdev->internal.cache, fobject, nlookup);
+	}
+
 	fsdev_io->u_in.forget.fobject = fobject;
 	fsdev_io->u_in.forget.nlookup = nlookup;
 
+	if (nlookup == 0) {
+		fsdev_io_complete_from_cache(fsdev_io, 0);
+		return 0;
+	}
+
 	fsdev_io_submit(fsdev_io);
 	return 0;
 }
@@ -181,6 +250,12 @@ static void
 _spdk_fsdev_getattr_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
+	struct spdk_fsdev_cache *cache = fsdev_io->fsdev->internal.cache;
+
+	if (cache && !fsdev_io->internal.cache_hit && fsdev_io->internal.status == 0) {
+		fsdev_cache_getattr_done(cache, fsdev_io->internal.cache_epoch,
+					 fsdev_io->u_in.getattr.fobject, &fsdev_io->u_out.getattr.attr);
+	}
 
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_getattr_cpl_cb, &fsdev_io->u_out.getattr.attr);
 
@@ -193,6 +268,7 @@ spdk_fsdev_getattr(struct spdk_fsdev_desc *desc, struct spdk_io_channel *ch, uin
 		   spdk_fsdev_getattr_cpl_cb cb_fn, void *cb_arg)
 {
 	struct spdk_fsdev_io *fsdev_io;
+	struct spdk_fsdev_cache *cache;
 
 	fsdev_io = fsdev_io_get_and_fill(desc, ch, unique, cb_fn, cb_arg, _spdk_fsdev_getattr_cb, ch,
 					 SPDK_FSDEV_IO_GETATTR);
@@ -203,6 +279,15 @@ spdk_fsdev_getattr(struct spdk_fsdev_desc *desc, struct spdk_io_channel *ch, uin
 	fsdev_io->u_in.getattr.fobject = fobject;
 	fsdev_io->u_in.getattr.fhandle = fhandle;
 
+	cache = fsdev_io->fsdev->internal.cache;
+	if (cache) {
+		fsdev_io->internal.cache_epoch = fsdev_cache_get_epoch(cache);
+		if (fsdev_cache_getattr(cache, fobject, &fsdev_io->u_out.getattr.attr)) {
+			fsdev_io_complete_from_cache(fsdev_io, 0);
+			return 0;
+		}
+	}
+
 	fsdev_io_submit(fsdev_io);
 	return 0;
 }
@@ -212,6 +297,8 @@ _spdk_fsdev_setattr_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_attr(fsdev_io, fsdev_io->u_in.setattr.fobject);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_setattr_cpl_cb, &fsdev_io->u_out.setattr.attr);
 
 	fsdev_io_free(fsdev_io);
@@ -275,6 +362,9 @@ _spdk_fsdev_symlink_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.symlink.parent_fobject,
+				  fsdev_io->u_in.symlink.linkpath);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_symlink_cpl_cb, fsdev_io->u_out.symlink.fobject,
 		     &fsdev_io->u_out.symlink.attr);
 
@@ -323,6 +413,9 @@ _spdk_fsdev_mknod_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.mknod.parent_fobject,
+				  fsdev_io->u_in.mknod.name);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_mknod_cpl_cb, fsdev_io->u_out.mknod.fobject,
 		     &fsdev_io->u_out.mknod.attr);
 
@@ -365,6 +458,9 @@ _spdk_fsdev_mkdir_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.mkdir.parent_fobject,
+				  fsdev_io->u_in.mkdir.name);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_mkdir_cpl_cb, fsdev_io->u_out.mkdir.fobject,
 		     &fsdev_io->u_out.mkdir.attr);
 
@@ -406,6 +502,9 @@ _spdk_fsdev_unlink_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.unlink.parent_fobject,
+				  fsdev_io->u_in.unlink.name);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_unlink_cpl_cb);
 
 	free(fsdev_io->u_in.unlink.name);
@@ -443,6 +542,9 @@ _spdk_fsdev_rmdir_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.rmdir.parent_fobject,
+				  fsdev_io->u_in.rmdir.name);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_rmdir_cpl_cb);
 
 	free(fsdev_io->u_in.rmdir.name);
@@ -480,6 +582,11 @@ _spdk_fsdev_rename_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.rename.parent_fobject,
+				  fsdev_io->u_in.rename.name);
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.rename.new_parent_fobject,
+				  fsdev_io->u_in.rename.new_name);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_rename_cpl_cb);
 
 	free(fsdev_io->u_in.rename.name);
@@ -528,6 +635,10 @@ _spdk_fsdev_link_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.link.new_parent_fobject,
+				  fsdev_io->u_in.link.name);
+	fsdev_io_invalidate_attr(fsdev_io, fsdev_io->u_in.link.fobject);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_link_cpl_cb, fsdev_io->u_out.link.fobject,
 		     &fsdev_io->u_out.link.attr);
 
@@ -567,6 +678,10 @@ _spdk_fsdev_fopen_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	if (fsdev_io->u_in.open.flags & O_TRUNC) {
+		fsdev_io_invalidate_attr(fsdev_io, fsdev_io->u_in.open.fobject);
+	}
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_fopen_cpl_cb, fsdev_io->u_out.open.fhandle);
 
 	fsdev_io_free(fsdev_io);
@@ -635,6 +750,8 @@ _spdk_fsdev_write_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_attr(fsdev_io, fsdev_io->u_in.write.fobject);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_write_cpl_cb, fsdev_io->u_out.write.data_size);
 
 	fsdev_io_free(fsdev_io);
@@ -762,6 +879,8 @@ _spdk_fsdev_setxattr_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_attr(fsdev_io, fsdev_io->u_in.setxattr.fobject);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_setxattr_cpl_cb);
 
 	free(fsdev_io->u_in.setxattr.value);
@@ -881,6 +1000,8 @@ _spdk_fsdev_removexattr_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_attr(fsdev_io, fsdev_io->u_in.removexattr.fobject);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_removexattr_cpl_cb);
 
 	free(fsdev_io->u_in.removexattr.name);
@@ -1113,6 +1234,9 @@ _spdk_fsdev_create_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_entry(fsdev_io, fsdev_io->u_in.create.parent_fobject,
+				  fsdev_io->u_in.create.name);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_create_cpl_cb, fsdev_io->u_out.create.fobject,
 		     &fsdev_io->u_out.create.attr, fsdev_io->u_out.create.fhandle);
 
@@ -1184,6 +1308,8 @@ _spdk_fsdev_fallocate_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_attr(fsdev_io, fsdev_io->u_in.fallocate.fobject);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_fallocate_cpl_cb);
 
 	fsdev_io_free(fsdev_io);
@@ -1218,6 +1344,8 @@ _spdk_fsdev_copy_file_range_cb(struct spdk_fsdev_io *fsdev_io, void *cb_arg)
 {
 	struct spdk_io_channel *ch = cb_arg;
 
+	fsdev_io_invalidate_attr(fsdev_io, fsdev_io->u_in.copy_file_range.fobject_out);
+
 	CALL_USR_CLB(fsdev_io, ch, spdk_fsdev_copy_file_range_cpl_cb,
 		     fsdev_io->u_out.copy_file_range.data_size);
 
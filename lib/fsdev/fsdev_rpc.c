@@ -32,6 +32,8 @@ rpc_fsdev_get_opts(struct spdk_jsonrpc_request *request, const struct spdk_json_
 	spdk_json_write_object_begin(w);
 	spdk_json_write_named_uint32(w, "fsdev_io_pool_size", opts.fsdev_io_pool_size);
 	spdk_json_write_named_uint32(w, "fsdev_io_cache_size", opts.fsdev_io_cache_size);
+	spdk_json_write_named_uint32(w, "lookup_cache_size", opts.lookup_cache_size);
+	spdk_json_write_named_uint32(w, "lookup_cache_lease_ms", opts.lookup_cache_lease_ms);
 	spdk_json_write_object_end(w);
 	spdk_jsonrpc_end_result(request, w);
 }
@@ -40,11 +42,15 @@ SPDK_RPC_REGISTER("fsdev_get_opts", rpc_fsdev_get_opts, SPDK_RPC_RUNTIME)
 struct rpc_fsdev_set_opts {
 	uint32_t fsdev_io_pool_size;
 	uint32_t fsdev_io_cache_size;
+	uint32_t lookup_cache_size;
+	uint32_t lookup_cache_lease_ms;
 };
 
 static const struct spdk_json_object_decoder rpc_fsdev_set_opts_decoders[] = {
 	{"fsdev_io_pool_size", offsetof(struct rpc_fsdev_set_opts, fsdev_io_pool_size), spdk_json_decode_uint32, false},
 	{"fsdev_io_cache_size", offsetof(struct rpc_fsdev_set_opts, fsdev_io_cache_size), spdk_json_decode_uint32, false},
+	{"lookup_cache_size", offsetof(struct rpc_fsdev_set_opts, lookup_cache_size), spdk_json_decode_uint32, true},
+	{"lookup_cache_lease_ms", offsetof(struct rpc_fsdev_set_opts, lookup_cache_lease_ms), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -54,6 +60,17 @@ rpc_fsdev_set_opts(struct spdk_jsonrpc_request *request, const struct spdk_json_
 	int rc;
 	struct spdk_fsdev_opts opts = {};
 
+	rc = spdk_fsdev_get_opts(&opts, sizeof(opts));
+	if (rc) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "spdk_fsdev_get_opts failed with %d", rc);
+		return;
+	}
+
+	/* The lookup cache parameters are optional and keep their current values if omitted */
+	req.lookup_cache_size = opts.lookup_cache_size;
+	req.lookup_cache_lease_ms = opts.lookup_cache_lease_ms;
+
 	if (spdk_json_decode_object(params, rpc_fsdev_set_opts_decoders,
 				    SPDK_COUNTOF(rpc_fsdev_set_opts_decoders),
 				    &req)) {
@@ -63,15 +80,10 @@ rpc_fsdev_set_opts(struct spdk_jsonrpc_request *request, const struct spdk_json_
 		return;
 	}
 
-	rc = spdk_fsdev_get_opts(&opts, sizeof(opts));
-	if (rc) {
-		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
-						     "spdk_fsdev_get_opts failed with %d", rc);
-		return;
-	}
-
 	opts.fsdev_io_pool_size = req.fsdev_io_pool_size;
 	opts.fsdev_io_cache_size = req.fsdev_io_cache_size;
+	opts.lookup_cache_size = req.lookup_cache_size;
+	opts.lookup_cache_lease_ms = req.lookup_cache_lease_ms;
 
 	rc = spdk_fsdev_set_opts(&opts);
 	if (rc) {
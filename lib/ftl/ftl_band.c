@@ -489,12 +489,13 @@ is_band_relocateable(struct ftl_band *band)
 
 static void
 get_band_phys_info(struct spdk_ftl_dev *dev, uint64_t phys_id,
-		   double *invalidity, double *wr_cnt)
+		   double *invalidity, double *wr_cnt, double *age)
 {
 	struct ftl_band *band;
 	uint64_t band_id = phys_id * dev->num_logical_bands_in_physical;
+	uint64_t num_closed = 0;
 
-	*wr_cnt = *invalidity = 0.0L;
+	*wr_cnt = *invalidity = *age = 0.0L;
 	for (; band_id < ftl_get_num_bands(dev); band_id++) {
 		band = &dev->bands[band_id];
 
@@ -509,30 +510,64 @@ get_band_phys_info(struct spdk_ftl_dev *dev, uint64_t phys_id,
 		}
 
 		*invalidity += ftl_band_invalidity(band);
+
+		/* Age of the data is measured in sequence IDs handed out since the band was closed */
+		if (dev->sb->seq_id > band->md->close_seq_id) {
+			*age += dev->sb->seq_id - band->md->close_seq_id;
+		}
+		num_closed++;
 	}
 
 	*invalidity /= dev->num_logical_bands_in_physical;
 	*wr_cnt /= dev->num_logical_bands_in_physical;
+	if (num_closed) {
+		*age /= num_closed;
+	}
+}
+
+/*
+ * Cost-benefit ratio of cleaning a band (as in log-structured file systems): the benefit is the
+ * amount of space reclaimed weighted by the age of the data, the cost is reading and rewriting
+ * the still valid part of it. Old (cold) bands are therefore picked even if they are only
+ * moderately invalidated, since their remaining data is unlikely to be overwritten soon, while
+ * young (hot) bands are left to invalidate themselves further.
+ */
+static double
+band_cost_benefit(double invalidity, double age)
+{
+	double validity = 1.0L - invalidity;
+
+	return invalidity * (age + 1.0L) / (1.0L + validity);
 }
 
 static bool
-band_cmp(double a_invalidity, double a_wr_cnt,
-	 double b_invalidity, double b_wr_cnt,
+band_cmp(struct spdk_ftl_dev *dev,
+	 double a_invalidity, double a_wr_cnt, double a_age,
+	 double b_invalidity, double b_wr_cnt, double b_age,
 	 uint64_t a_id, uint64_t b_id)
 {
 	assert(a_id != FTL_BAND_PHYS_ID_INVALID);
 	assert(b_id != FTL_BAND_PHYS_ID_INVALID);
 	double diff = a_invalidity - b_invalidity;
+	double a_score, b_score;
+
 	if (diff < 0.0L) {
 		diff *= -1.0L;
 	}
 
 	/* Use the following metrics for picking bands for GC (in order):
-	 * - relative invalidity
-	 * - if invalidity is similar (within 10% points), then their write counts (how many times band was written to)
+	 * - cost-benefit ratio (if enabled), or relative invalidity
+	 * - if score is similar (within 10%), then their write counts (how many times band was written to)
 	 * - if write count is equal, then pick based on their placement on base device (lower LBAs win)
 	 */
-	if (diff > 0.1L) {
+	if (dev->gc_cost_benefit) {
+		a_score = band_cost_benefit(a_invalidity, a_age);
+		b_score = band_cost_benefit(b_invalidity, b_age);
+
+		if (a_score > b_score * 1.1L || b_score > a_score * 1.1L) {
+			return a_score > b_score;
+		}
+	} else if (diff > 0.1L) {
 		return a_invalidity > b_invalidity;
 	}
 
@@ -590,6 +625,7 @@ ftl_band_search_next_to_reloc(struct spdk_ftl_dev *dev)
 {
 	double invalidity, max_invalidity = 0.0L;
 	double wr_cnt, max_wr_cnt = 0.0L;
+	double age, max_age = 0.0L;
 	uint64_t phys_id = FTL_BAND_PHYS_ID_INVALID;
 	struct ftl_band *band;
 	uint64_t i, band_count;
@@ -622,18 +658,16 @@ ftl_band_search_next_to_reloc(struct spdk_ftl_dev *dev)
 		band = &dev->bands[i];
 
 		/* Calculate entire band physical group invalidity */
-		get_band_phys_info(dev, band->phys_id, &invalidity, &wr_cnt);
+		get_band_phys_info(dev, band->phys_id, &invalidity, &wr_cnt, &age);
 
 		if (invalidity != 0.0L) {
 			if (phys_id == FTL_BAND_PHYS_ID_INVALID ||
-			    band_cmp(invalidity, wr_cnt, max_invalidity, max_wr_cnt,
+			    band_cmp(dev, invalidity, wr_cnt, age, max_invalidity, max_wr_cnt, max_age,
 				     band->phys_id, phys_id)) {
 				max_wr_cnt = wr_cnt;
+				max_invalidity = invalidity;
+				max_age = age;
 				phys_id = band->phys_id;
-
-				if (invalidity > max_invalidity) {
-					max_invalidity = invalidity;
-				}
 			}
 		}
 	}
@@ -145,6 +145,9 @@ struct spdk_ftl_dev {
 	/* Manages data relocation */
 	struct ftl_reloc		*reloc;
 
+	/* Pick GC victims by cost-benefit ratio (invalidity and data age) instead of invalidity only */
+	bool				gc_cost_benefit;
+
 	/* Thread on which the poller is running */
 	struct spdk_thread		*core_thread;
 
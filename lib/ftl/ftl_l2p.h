@@ -16,6 +16,9 @@ struct ftl_rq;
 struct ftl_io;
 struct ftl_l2p_pin_ctx;
 
+/* Maximum number of L2P pages a single pin operation may span */
+#define FTL_L2P_MAX_PAGES_TO_PIN 4
+
 typedef void (*ftl_l2p_cb)(struct spdk_ftl_dev *dev, int status, void *ctx);
 typedef void (*ftl_l2p_pin_cb)(struct spdk_ftl_dev *dev, int status,
 			       struct ftl_l2p_pin_ctx *pin_ctx);
@@ -17,9 +17,12 @@
 #include "ftl_l2p_cache.h"
 #include "ftl_layout.h"
 #include "ftl_nv_cache_io.h"
+#include "mngt/ftl_mngt.h"
 #include "mngt/ftl_mngt_steps.h"
 #include "utils/ftl_defs.h"
 #include "utils/ftl_addr_utils.h"
+#include "utils/ftl_l2p_extent.h"
+#include "utils/ftl_property.h"
 
 struct ftl_l2p_cache_page_io_ctx {
 	struct ftl_l2p_cache *cache;
@@ -51,6 +54,19 @@ struct ftl_l2p_page {
 	ftl_df_obj_id obj_id;
 };
 
+#define FTL_L2P_CACHE_ZPAGE_MAX_EXTENTS 14
+/* Percentage of the L2P DRAM limit used for the compressed pages and their map */
+#define FTL_L2P_CACHE_ZPAGES_RATIO 10UL
+
+/* Extent encoded copy of a clean page evicted from the cache */
+struct ftl_l2p_zpage {
+	TAILQ_ENTRY(ftl_l2p_zpage) list_entry;
+	uint64_t page_no;
+	uint64_t num_extents;
+	struct ftl_l2p_extent extents[FTL_L2P_CACHE_ZPAGE_MAX_EXTENTS];
+};
+SPDK_STATIC_ASSERT(sizeof(struct ftl_l2p_zpage) == 256, "Incorrect zpage size");
+
 struct ftl_l2p_page_set;
 
 struct ftl_l2p_page_wait_ctx {
@@ -62,13 +78,12 @@ struct ftl_l2p_page_wait_ctx {
 };
 
 /* A L2P page contains 1024 4B entries (or 512 8B ones for big drives).
- * Currently internal IO will only pin 1 LBA at a time, so only one entry should be needed.
+ * Internal IO (compaction) pins runs of consecutive LBAs spanning at most FTL_L2P_MAX_PAGES_TO_PIN pages.
  * User IO is split on internal xfer_size boundaries, which is currently set to 1MiB (256 blocks),
  * so one entry should also be enough.
  * TODO: We should probably revisit this though, when/if the xfer_size is based on io requirements of the
  * bottom device (e.g. RAID5F), since then big IOs (especially unaligned ones) could potentially break this.
  */
-#define L2P_MAX_PAGES_TO_PIN 4
 struct ftl_l2p_page_set {
 	uint16_t to_pin_cnt;
 	uint16_t pinned_cnt;
@@ -77,7 +92,7 @@ struct ftl_l2p_page_set {
 	uint8_t deferred;
 	struct ftl_l2p_pin_ctx *pin_ctx;
 	TAILQ_ENTRY(ftl_l2p_page_set) list_entry;
-	struct ftl_l2p_page_wait_ctx entry[L2P_MAX_PAGES_TO_PIN];
+	struct ftl_l2p_page_wait_ctx entry[FTL_L2P_MAX_PAGES_TO_PIN];
 };
 
 struct ftl_l2p_l1_map_entry {
@@ -132,6 +147,43 @@ struct ftl_l2p_cache {
 		struct ftl_l2p_pin_ctx pin_ctx;
 	} lazy_trim;
 
+	/*
+	 * Compressed pages - clean pages dropped from the cache are kept extent encoded, if they
+	 * are sequential enough, so that the next page in doesn't need to read the L2P region.
+	 * The tier is volatile, it's not a part of the SHM state and starts empty.
+	 */
+	struct {
+		struct ftl_mempool *pool;
+		/* Compressed page by page number */
+		struct ftl_l2p_zpage **map;
+		TAILQ_HEAD(l2p_zpage_list, ftl_l2p_zpage) lru_list;
+		uint64_t count;
+		uint64_t max;
+		/* Page ins served from the compressed tier */
+		uint64_t hits;
+		/* Pages which were too fragmented to be compressed */
+		uint64_t rejected;
+	} zpages;
+
+	/* Incremental L2P checkpoint, see ftl_l2p_cache_process_ckpt() */
+	struct {
+#define FTL_L2P_CACHE_CKPT_QD			64
+#define FTL_L2P_CACHE_CKPT_PAGES_PER_POLL	4096
+		/* Sequence ID of the checkpoint in progress, 0 if there's none */
+		uint64_t seq_id;
+		/* Sequence ID of the last durable checkpoint, restored on superblock persist failure */
+		uint64_t prev_seq_id;
+		/* Next page to be checked */
+		uint64_t page_no;
+		/* Page writes and superblock update in flight */
+		uint32_t qd;
+		int status;
+		/* Number of completed checkpoints */
+		uint64_t count;
+		/* Pages written by the checkpoint */
+		uint64_t pages;
+	} ckpt;
+
 	/* This is a context for a management process */
 	struct ftl_l2p_cache_process_ctx mctx;
 
@@ -155,6 +207,12 @@ static void page_set_end(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 			 struct ftl_l2p_page_set *page_set);
 static void page_out_io_retry(void *arg);
 static void page_in_io_retry(void *arg);
+static void ftl_property_dump_l2p_zpages(struct spdk_ftl_dev *dev,
+		const struct ftl_property *property,
+		struct spdk_json_write_ctx *w);
+static void ftl_property_dump_l2p_ckpt(struct spdk_ftl_dev *dev,
+				       const struct ftl_property *property,
+				       struct spdk_json_write_ctx *w);
 
 static inline void
 ftl_l2p_page_queue_wait_ctx(struct ftl_l2p_page *page,
@@ -236,6 +294,89 @@ ftl_l2p_cache_page_remove(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page
 	ftl_mempool_put(cache->l2_ctx_pool, page);
 }
 
+static void
+ftl_l2p_cache_zpage_free(struct ftl_l2p_cache *cache, struct ftl_l2p_zpage *zpage)
+{
+	TAILQ_REMOVE(&cache->zpages.lru_list, zpage, list_entry);
+	cache->zpages.map[zpage->page_no] = NULL;
+	cache->zpages.count--;
+	ftl_mempool_put(cache->zpages.pool, zpage);
+}
+
+static void
+ftl_l2p_cache_zpage_store(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
+{
+	struct ftl_l2p_extent extents[FTL_L2P_CACHE_ZPAGE_MAX_EXTENTS];
+	struct ftl_l2p_zpage *zpage;
+	int num_extents;
+
+	if (!cache->zpages.pool) {
+		return;
+	}
+
+	assert(page->state == L2P_CACHE_PAGE_READY || page->state == L2P_CACHE_PAGE_FLUSHING);
+	assert(!cache->zpages.map[page->page_no]);
+
+	num_extents = ftl_l2p_extent_encode(cache->dev, page->page_buffer, cache->lbas_in_page,
+					    extents, FTL_L2P_CACHE_ZPAGE_MAX_EXTENTS);
+	if (num_extents < 0) {
+		/* Too fragmented, the page will be read from the disk */
+		cache->zpages.rejected++;
+		return;
+	}
+
+	zpage = ftl_mempool_get(cache->zpages.pool);
+	if (!zpage) {
+		/* Make room by dropping the coldest compressed page */
+		ftl_l2p_cache_zpage_free(cache, TAILQ_LAST(&cache->zpages.lru_list, l2p_zpage_list));
+		zpage = ftl_mempool_get(cache->zpages.pool);
+		assert(zpage);
+	}
+
+	zpage->page_no = page->page_no;
+	zpage->num_extents = num_extents;
+	memcpy(zpage->extents, extents, num_extents * sizeof(extents[0]));
+
+	TAILQ_INSERT_HEAD(&cache->zpages.lru_list, zpage, list_entry);
+	cache->zpages.map[page->page_no] = zpage;
+	cache->zpages.count++;
+}
+
+static bool
+ftl_l2p_cache_zpage_load(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
+{
+	struct ftl_l2p_zpage *zpage;
+
+	if (!cache->zpages.pool) {
+		return false;
+	}
+
+	zpage = cache->zpages.map[page->page_no];
+	if (!zpage) {
+		return false;
+	}
+
+	ftl_l2p_extent_decode(cache->dev, page->page_buffer, zpage->extents, zpage->num_extents);
+	ftl_l2p_cache_zpage_free(cache, zpage);
+	cache->zpages.hits++;
+
+	return true;
+}
+
+static void
+ftl_l2p_cache_zpages_drop(struct ftl_l2p_cache *cache)
+{
+	struct ftl_l2p_zpage *zpage;
+
+	if (!cache->zpages.pool) {
+		return;
+	}
+
+	while ((zpage = TAILQ_FIRST(&cache->zpages.lru_list))) {
+		ftl_l2p_cache_zpage_free(cache, zpage);
+	}
+}
+
 static inline struct ftl_l2p_page *
 ftl_l2p_cache_get_coldest_page(struct ftl_l2p_cache *cache)
 {
@@ -347,7 +488,8 @@ static inline void
 ftl_l2p_cache_page_unpin(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
 {
 	page->pin_ref_cnt--;
-	if (!page->pin_ref_cnt && !page->on_lru_list && page->state != L2P_CACHE_PAGE_FLUSHING) {
+	if (!page->pin_ref_cnt && !page->on_lru_list && page->state != L2P_CACHE_PAGE_FLUSHING &&
+	    page->state != L2P_CACHE_PAGE_PERSISTING) {
 		/* L2P_CACHE_PAGE_FLUSHING: the page is currently being evicted.
 		 * In such a case, the page can't be returned to the rank list, because
 		 * the ongoing eviction will remove it if no pg updates had happened.
@@ -357,6 +499,9 @@ ftl_l2p_cache_page_unpin(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
 		 * Depending on the page updates tracker, the page will be evicted
 		 * or returned to the rank list in context of the eviction completion
 		 * cb - see page_out_io_complete().
+		 *
+		 * L2P_CACHE_PAGE_PERSISTING: the page is being written by a checkpoint, it'll
+		 * be returned to the rank list on the write completion.
 		 */
 		ftl_l2p_cache_lru_add_page(cache, page);
 	}
@@ -431,6 +576,7 @@ ftl_l2p_cache_init(struct spdk_ftl_dev *dev)
 	void *l2p = _ftl_l2p_cache_init(dev, dev->layout.l2p.addr_size, l2p_size);
 	size_t page_sets_pool_size = 1 << 15;
 	size_t max_resident_size, max_resident_pgs;
+	size_t zpages_size = 0, zpages_map_size = 0;
 
 	if (!l2p) {
 		return -1;
@@ -451,6 +597,16 @@ ftl_l2p_cache_init(struct spdk_ftl_dev *dev)
 	if (max_resident_pgs > cache->num_pages) {
 		SPDK_NOTICELOG("l2p memory limit higher than entire L2P size\n");
 		max_resident_pgs = cache->num_pages;
+	} else {
+		/* The L2P doesn't fit in the memory limit, dedicate a part of it to compressed pages */
+		zpages_size = max_resident_size * FTL_L2P_CACHE_ZPAGES_RATIO / 100;
+		zpages_map_size = cache->num_pages * sizeof(*cache->zpages.map);
+		if (zpages_size < zpages_map_size + sizeof(struct ftl_l2p_zpage)) {
+			/* Not even room for the map, keep the whole limit for the resident pages */
+			zpages_size = 0;
+			zpages_map_size = 0;
+		}
+		max_resident_pgs = (max_resident_size - zpages_size) / ftl_l2p_cache_get_page_all_size();
 	}
 
 	/* Round down max res pgs to the nearest # of l2/l1 pgs */
@@ -484,6 +640,26 @@ ftl_l2p_cache_init(struct spdk_ftl_dev *dev)
 	cache->evict_keep = spdk_divide_round_up(cache->num_pages * FTL_L2P_CACHE_PAGE_AVAIL_RATIO, 100);
 	cache->evict_keep = spdk_min(FTL_L2P_CACHE_PAGE_AVAIL_MAX, cache->evict_keep);
 
+	TAILQ_INIT(&cache->zpages.lru_list);
+	cache->zpages.max = (zpages_size - zpages_map_size) / sizeof(struct ftl_l2p_zpage);
+	if (cache->zpages.max) {
+		cache->zpages.map = calloc(cache->num_pages, sizeof(*cache->zpages.map));
+		if (!cache->zpages.map) {
+			return -1;
+		}
+
+		cache->zpages.pool = ftl_mempool_create(cache->zpages.max, sizeof(struct ftl_l2p_zpage),
+							64, SPDK_ENV_NUMA_ID_ANY);
+		if (!cache->zpages.pool) {
+			return -1;
+		}
+		SPDK_NOTICELOG("l2p compressed pages limit is: %"PRIu64"\n", cache->zpages.max);
+	}
+	ftl_property_register(dev, "l2p_compression", NULL, 0, NULL, "Compressed L2P pages",
+			      ftl_property_dump_l2p_zpages, NULL, NULL, true);
+	ftl_property_register(dev, "l2p_checkpoint", NULL, 0, NULL, "Incremental L2P checkpoint",
+			      ftl_property_dump_l2p_ckpt, NULL, NULL, false);
+
 	if (!ftl_fast_startup(dev) && !ftl_fast_recovery(dev)) {
 		memset(cache->l2_mapping, (int)FTL_DF_OBJ_ID_INVALID, ftl_md_get_buffer_size(cache->l2_md));
 		ftl_mempool_initialize_ext(cache->l2_ctx_pool);
@@ -521,6 +697,13 @@ ftl_l2p_cache_deinit_l2(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
 
 	ftl_mempool_destroy(cache->page_sets_pool);
 	cache->page_sets_pool = NULL;
+
+	if (cache->zpages.pool) {
+		ftl_mempool_destroy(cache->zpages.pool);
+		cache->zpages.pool = NULL;
+	}
+	free(cache->zpages.map);
+	cache->zpages.map = NULL;
 }
 
 static void
@@ -556,6 +739,9 @@ process_init_ctx(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	assert(NULL == ctx->cb_ctx);
 	assert(0 == cache->l2_pgs_evicting);
 
+	/* The process rewrites the L2P region, compressed copies would get stale */
+	ftl_l2p_cache_zpages_drop(cache);
+
 	memset(ctx, 0, sizeof(*ctx));
 
 	ctx->cb = cb;
@@ -952,7 +1138,7 @@ ftl_l2p_cache_halt(struct spdk_ftl_dev *dev)
 
 	if (cache->state != L2P_CACHE_SHUTDOWN_DONE) {
 		cache->state = L2P_CACHE_IN_SHUTDOWN;
-		if (!cache->ios_in_flight && !cache->l2_pgs_evicting) {
+		if (!cache->ios_in_flight && !cache->l2_pgs_evicting && !cache->ckpt.qd) {
 			cache->state = L2P_CACHE_SHUTDOWN_DONE;
 		}
 	}
@@ -1010,7 +1196,7 @@ ftl_l2p_cache_pin(struct spdk_ftl_dev *dev, struct ftl_l2p_pin_ctx *pin_ctx)
 	uint64_t count = end - start + 1;
 	uint64_t i;
 
-	if (spdk_unlikely(count > L2P_MAX_PAGES_TO_PIN)) {
+	if (spdk_unlikely(count > FTL_L2P_MAX_PAGES_TO_PIN)) {
 		ftl_l2p_pin_complete(dev, -E2BIG, pin_ctx);
 		return;
 	}
@@ -1314,7 +1500,13 @@ page_in(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	}
 
 	if (page_in) {
-		page_in_io(dev, cache, page);
+		if (ftl_l2p_cache_zpage_load(cache, page)) {
+			/* Page restored from its compressed copy, complete it without the IO */
+			cache->ios_in_flight++;
+			page_in_io_complete(dev, cache, page, true);
+		} else {
+			page_in_io(dev, cache, page);
+		}
 	}
 }
 
@@ -1406,6 +1598,7 @@ page_out_io_complete(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	}
 
 	if (success && ftl_l2p_cache_page_can_remove(page)) {
+		ftl_l2p_cache_zpage_store(cache, page);
 		ftl_l2p_cache_page_remove(cache, page);
 	} else {
 		if (!page->pin_ref_cnt) {
@@ -1500,6 +1693,7 @@ ftl_l2p_cache_process_eviction(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *c
 		page_out_io(dev, cache, page);
 	} else {
 		/* Page clean and we can remove it */
+		ftl_l2p_cache_zpage_store(cache, page);
 		ftl_l2p_cache_page_remove(cache, page);
 	}
 }
@@ -1566,6 +1760,151 @@ ftl_l2p_lazy_trim_process(struct spdk_ftl_dev *dev)
 	ftl_l2p_cache_pin(dev, pin_ctx);
 }
 
+/*
+ * Incremental L2P checkpoint
+ *
+ * All dirty resident pages are written to the L2P region in the background, while the pages stay
+ * in the cache. Once done, the superblock records the checkpoint sequence ID (lower than the
+ * sequence ID of any chunk still open, as such a chunk may receive user writes after the
+ * checkpoint). Dirty shutdown recovery then starts from the L2P region and replays only bands
+ * and chunks closed after the checkpoint, see ftl_mngt_recovery_iteration_init_seq_ids().
+ *
+ * Checkpoints are taken once the sequence ID advances by the number of NV cache chunks, which
+ * bounds the amount of metadata to be replayed after a crash. A checkpoint is only taken if its
+ * sequence ID is past the last one: while a chunk opened before the last checkpoint stays open,
+ * another one wouldn't shorten the replay.
+ */
+static bool
+ckpt_required(struct spdk_ftl_dev *dev)
+{
+	if (dev->trim_in_progress) {
+		/* Lazy trims need to be applied to the pages first */
+		return false;
+	}
+
+	if (!dev->sb->ckpt_seq_id) {
+		return true;
+	}
+
+	return dev->sb->seq_id - dev->sb->ckpt_seq_id >= dev->nv_cache.chunk_count;
+}
+
+static void
+ckpt_page_out_cb(struct spdk_bdev_io *bdev_io, bool success, void *arg)
+{
+	struct ftl_l2p_page *page = arg;
+	struct ftl_l2p_cache *cache = page->ctx.cache;
+	struct spdk_ftl_dev *dev = cache->dev;
+
+	ftl_stats_bdev_io_completed(dev, FTL_STATS_TYPE_L2P, bdev_io);
+	spdk_bdev_free_io(bdev_io);
+
+	ftl_bug(page->ctx.updates > page->updates);
+	ftl_bug(page->on_lru_list);
+
+	cache->ckpt.qd--;
+	if (spdk_likely(success)) {
+		page->updates -= page->ctx.updates;
+	} else {
+		cache->ckpt.status = -EIO;
+	}
+
+	page->state = L2P_CACHE_PAGE_READY;
+	if (!page->pin_ref_cnt) {
+		ftl_l2p_cache_lru_add_page(cache, page);
+	}
+}
+
+static void
+ckpt_finish_cb(struct spdk_ftl_dev *dev, void *ctx, int status)
+{
+	struct ftl_l2p_cache *cache = ctx;
+
+	cache->ckpt.qd--;
+	if (status) {
+		FTL_ERRLOG(dev, "Failed to persist L2P checkpoint, seq_id %"PRIu64"\n", cache->ckpt.seq_id);
+		dev->sb->ckpt_seq_id = cache->ckpt.prev_seq_id;
+	} else {
+		cache->ckpt.count++;
+	}
+
+	cache->ckpt.seq_id = 0;
+}
+
+static void
+ckpt_finish(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
+{
+	if (cache->ckpt.status) {
+		/* Some pages weren't written, the previous checkpoint stays in effect */
+		cache->ckpt.seq_id = 0;
+		return;
+	}
+
+	cache->ckpt.prev_seq_id = dev->sb->ckpt_seq_id;
+	dev->sb->ckpt_seq_id = cache->ckpt.seq_id;
+
+	cache->ckpt.qd++;
+	if (ftl_mngt_l2p_checkpoint(dev, ckpt_finish_cb, cache)) {
+		ckpt_finish_cb(dev, cache, -ENOMEM);
+	}
+}
+
+static void
+ftl_l2p_cache_process_ckpt(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
+{
+	struct ftl_l2p_page *page;
+	uint64_t i, seq_id;
+
+	if (!cache->ckpt.seq_id) {
+		if (cache->ckpt.qd || !ckpt_required(dev)) {
+			return;
+		}
+
+		seq_id = ftl_nv_cache_get_min_open_seq_id(&dev->nv_cache);
+		seq_id = seq_id ? seq_id - 1 : dev->sb->seq_id;
+		if (seq_id <= dev->sb->ckpt_seq_id) {
+			/* Nothing has been written since the last checkpoint, as far as it can cover */
+			return;
+		}
+
+		cache->ckpt.seq_id = seq_id;
+		cache->ckpt.page_no = 0;
+		cache->ckpt.status = 0;
+		cache->ckpt.pages = 0;
+	}
+
+	for (i = 0; i < FTL_L2P_CACHE_CKPT_PAGES_PER_POLL; i++) {
+		if (cache->ckpt.page_no == cache->num_pages || cache->ckpt.qd >= FTL_L2P_CACHE_CKPT_QD) {
+			break;
+		}
+
+		page = get_l2p_page_by_df_id(cache, cache->ckpt.page_no);
+		if (page && page->updates) {
+			if (page->state != L2P_CACHE_PAGE_READY) {
+				/* The page is being evicted, its updates may not be a part of the ongoing write */
+				return;
+			}
+
+			if (page->on_lru_list) {
+				ftl_l2p_cache_lru_remove_page(cache, page);
+			}
+
+			page->state = L2P_CACHE_PAGE_PERSISTING;
+			page->ctx.cache = cache;
+			page->ctx.updates = page->updates;
+			cache->ckpt.qd++;
+			cache->ckpt.pages++;
+			process_page_out(page, ckpt_page_out_cb);
+		}
+
+		cache->ckpt.page_no++;
+	}
+
+	if (cache->ckpt.page_no == cache->num_pages && !cache->ckpt.qd) {
+		ckpt_finish(dev, cache);
+	}
+}
+
 void
 ftl_l2p_cache_process(struct spdk_ftl_dev *dev)
 {
@@ -1584,4 +1923,29 @@ ftl_l2p_cache_process(struct spdk_ftl_dev *dev)
 
 	ftl_l2p_cache_process_eviction(dev, cache);
 	ftl_l2p_lazy_trim_process(dev);
+	ftl_l2p_cache_process_ckpt(dev, cache);
+}
+
+static void
+ftl_property_dump_l2p_zpages(struct spdk_ftl_dev *dev, const struct ftl_property *property,
+			     struct spdk_json_write_ctx *w)
+{
+	struct ftl_l2p_cache *cache = dev->l2p;
+
+	spdk_json_write_named_uint64(w, "pages", cache->zpages.count);
+	spdk_json_write_named_uint64(w, "max_pages", cache->zpages.max);
+	spdk_json_write_named_uint64(w, "hits", cache->zpages.hits);
+	spdk_json_write_named_uint64(w, "rejected", cache->zpages.rejected);
+}
+
+static void
+ftl_property_dump_l2p_ckpt(struct spdk_ftl_dev *dev, const struct ftl_property *property,
+			   struct spdk_json_write_ctx *w)
+{
+	struct ftl_l2p_cache *cache = dev->l2p;
+
+	spdk_json_write_named_uint64(w, "seq_id", dev->sb->ckpt_seq_id);
+	spdk_json_write_named_bool(w, "in_progress", cache->ckpt.seq_id != 0);
+	spdk_json_write_named_uint64(w, "count", cache->ckpt.count);
+	spdk_json_write_named_uint64(w, "pages_written", cache->ckpt.pages);
 }
@@ -25,6 +25,9 @@ static void compaction_process_read_entry(void *arg);
 static void ftl_property_dump_cache_dev(struct spdk_ftl_dev *dev,
 					const struct ftl_property *property,
 					struct spdk_json_write_ctx *w);
+static void ftl_property_dump_compaction(struct spdk_ftl_dev *dev,
+		const struct ftl_property *property,
+		struct spdk_json_write_ctx *w);
 
 static inline void
 nvc_validate_md(struct ftl_nv_cache *nv_cache,
@@ -334,6 +337,8 @@ ftl_nv_cache_init(struct spdk_ftl_dev *dev)
 	ftl_nv_cache_init_update_limits(dev);
 	ftl_property_register(dev, "cache_device", NULL, 0, NULL, NULL, ftl_property_dump_cache_dev, NULL,
 			      NULL, true);
+	ftl_property_register(dev, "compaction", NULL, 0, NULL, "NV cache compaction progress",
+			      ftl_property_dump_compaction, NULL, NULL, false);
 
 	nv_cache->throttle.interval_tsc = FTL_NV_CACHE_THROTTLE_INTERVAL_MS *
 					  (spdk_get_ticks_hz() / 1000);
@@ -712,6 +717,42 @@ is_compaction_required(struct ftl_nv_cache *nv_cache)
 	return false;
 }
 
+/*
+ * Number of compactors allowed to run at the same time. It scales linearly with the backlog of full
+ * chunks - a single compactor is used when compaction has just started, all of them when the number
+ * of free chunks drops to the free target. Additional compactors are not started while the base
+ * device writer still has compacted data queued, as that would only grow the queue.
+ */
+static uint64_t
+compaction_active_limit(struct ftl_nv_cache *nv_cache)
+{
+	struct spdk_ftl_dev *dev = SPDK_CONTAINEROF(nv_cache, struct spdk_ftl_dev, nv_cache);
+	uint64_t usable_chunks = nv_cache->chunk_count - nv_cache->chunk_inactive_count;
+	uint64_t max_full, backlog, limit;
+
+	if (spdk_unlikely(nv_cache->halt)) {
+		return FTL_NV_CACHE_NUM_COMPACTORS;
+	}
+
+	max_full = usable_chunks > nv_cache->chunk_free_target ?
+		   usable_chunks - nv_cache->chunk_free_target : 0;
+	if (max_full <= nv_cache->chunk_compaction_threshold ||
+	    nv_cache->chunk_full_count >= max_full) {
+		limit = FTL_NV_CACHE_NUM_COMPACTORS;
+	} else {
+		backlog = nv_cache->chunk_full_count > nv_cache->chunk_compaction_threshold ?
+			  nv_cache->chunk_full_count - nv_cache->chunk_compaction_threshold : 0;
+		limit = 1 + (FTL_NV_CACHE_NUM_COMPACTORS - 1) * backlog /
+			(max_full - nv_cache->chunk_compaction_threshold);
+	}
+
+	if (!TAILQ_EMPTY(&dev->writer_user.rq_queue)) {
+		limit = spdk_min(limit, spdk_max(nv_cache->compaction_active_count, 1));
+	}
+
+	return limit;
+}
+
 static void compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor);
 static void compaction_process_pin_lba(struct ftl_nv_cache_compactor *comp);
 
@@ -728,13 +769,17 @@ compaction_process_pin_lba_cb(struct spdk_ftl_dev *dev, int status, struct ftl_l
 {
 	struct ftl_nv_cache_compactor *comp = pin_ctx->cb_ctx;
 	struct ftl_rq *rq = comp->rq;
+	/* A single pin covers the whole run of consecutive entries, skipped entries count as one */
+	uint64_t num_entries = spdk_max(pin_ctx->count, 1);
 
 	if (status) {
 		rq->iter.status = status;
 		pin_ctx->lba = FTL_LBA_INVALID;
 	}
 
-	if (--rq->iter.remaining == 0) {
+	assert(rq->iter.remaining >= num_entries);
+	rq->iter.remaining -= num_entries;
+	if (rq->iter.remaining == 0) {
 		if (rq->iter.status) {
 			/* unpin and try again */
 			ftl_rq_unpin(rq);
@@ -751,21 +796,46 @@ compaction_process_pin_lba(struct ftl_nv_cache_compactor *comp)
 {
 	struct ftl_rq *rq = comp->rq;
 	struct spdk_ftl_dev *dev = rq->dev;
-	struct ftl_rq_entry *entry;
+	struct ftl_rq_entry *entry, *head = NULL;
+	uint64_t lbas_in_page = dev->layout.l2p.lbas_in_page;
+	uint64_t count = 0;
 
 	assert(rq->iter.count);
 	rq->iter.remaining = rq->iter.count;
 	rq->iter.status = 0;
 
+	/*
+	 * Data read from the NV cache is mostly sequential, so pin whole runs of consecutive LBAs
+	 * (spanning at most FTL_L2P_MAX_PAGES_TO_PIN L2P pages) with a single pin operation issued
+	 * on behalf of the run's first entry. The other entries of the run skip pinning, so that
+	 * ftl_rq_unpin() releases each run exactly once.
+	 */
 	FTL_RQ_ENTRY_LOOP(rq, entry, rq->iter.count) {
-		struct ftl_l2p_pin_ctx *pin_ctx = &entry->l2p_pin_ctx;
+		if (head && entry->lba == head->lba + count &&
+		    (entry->lba / lbas_in_page) - (head->lba / lbas_in_page) < FTL_L2P_MAX_PAGES_TO_PIN) {
+			entry->l2p_pin_ctx.lba = FTL_LBA_INVALID;
+			entry->l2p_pin_ctx.count = 0;
+			count++;
+			continue;
+		}
+
+		if (head) {
+			ftl_l2p_pin(dev, head->lba, count, compaction_process_pin_lba_cb, comp,
+				    &head->l2p_pin_ctx);
+			head = NULL;
+		}
 
 		if (entry->lba == FTL_LBA_INVALID) {
-			ftl_l2p_pin_skip(dev, compaction_process_pin_lba_cb, comp, pin_ctx);
+			ftl_l2p_pin_skip(dev, compaction_process_pin_lba_cb, comp, &entry->l2p_pin_ctx);
 		} else {
-			ftl_l2p_pin(dev, entry->lba, 1, compaction_process_pin_lba_cb, comp, pin_ctx);
+			head = entry;
+			count = 1;
 		}
 	}
+
+	if (head) {
+		ftl_l2p_pin(dev, head->lba, count, compaction_process_pin_lba_cb, comp, &head->l2p_pin_ctx);
+	}
 }
 
 static void
@@ -1096,6 +1166,11 @@ compaction_process(struct ftl_nv_cache *nv_cache)
 		return;
 	}
 
+	nv_cache->compaction_active_limit = compaction_active_limit(nv_cache);
+	if (nv_cache->compaction_active_count >= nv_cache->compaction_active_limit) {
+		return;
+	}
+
 	compactor = TAILQ_FIRST(&nv_cache->compactor_list);
 	if (!compactor) {
 		return;
@@ -1135,7 +1210,6 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 
 		if (entry->lba != FTL_LBA_INVALID) {
 			ftl_l2p_update_base(dev, entry->lba, addr, entry->addr);
-			ftl_l2p_unpin(dev, entry->lba, 1);
 			chunk_compaction_advance(chunk, 1);
 		} else {
 			assert(entry->addr == FTL_ADDR_INVALID);
@@ -1145,6 +1219,7 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 		compaction_process_invalidate_entry(entry);
 	}
 
+	ftl_rq_unpin(rq);
 	compactor_deactivate(compactor);
 }
 
@@ -1172,9 +1247,9 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 		if (current_addr == entry->addr) {
 			entry->seq_id = chunk->md->seq_id;
 		} else {
-			/* This address already invalidated, just omit this block */
+			/* This address already invalidated, just omit this block (its L2P pin is released
+			 * together with the rest of the request) */
 			skip++;
-			ftl_l2p_unpin(dev, lba, 1);
 			compaction_process_invalidate_entry(entry);
 			chunk_compaction_advance(chunk, 1);
 		}
@@ -1186,6 +1261,7 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 		 */
 		ftl_writer_queue_rq(&dev->writer_user, rq);
 	} else {
+		ftl_rq_unpin(rq);
 		compactor_deactivate(compactor);
 	}
 }
@@ -1806,6 +1882,28 @@ ftl_nv_cache_get_max_seq_id(struct ftl_nv_cache *nv_cache, uint64_t *open_seq_id
 	*close_seq_id = c_seq_id;
 }
 
+uint64_t
+ftl_nv_cache_get_min_open_seq_id(struct ftl_nv_cache *nv_cache)
+{
+	uint64_t i, seq_id = 0;
+	struct ftl_nv_cache_chunk *chunk;
+
+	chunk = nv_cache->chunks;
+	assert(chunk);
+
+	for (i = 0; i < nv_cache->chunk_count; i++, chunk++) {
+		if (chunk->md->state != FTL_CHUNK_STATE_OPEN) {
+			continue;
+		}
+
+		if (!seq_id || chunk->md->seq_id < seq_id) {
+			seq_id = chunk->md->seq_id;
+		}
+	}
+
+	return seq_id;
+}
+
 typedef void (*ftl_chunk_ops_cb)(struct ftl_nv_cache_chunk *chunk, void *cntx, bool status);
 
 static void
@@ -2579,6 +2677,20 @@ ftl_property_dump_cache_dev(struct spdk_ftl_dev *dev, const struct ftl_property
 	spdk_json_write_array_end(w);
 }
 
+static void
+ftl_property_dump_compaction(struct spdk_ftl_dev *dev, const struct ftl_property *property,
+			     struct spdk_json_write_ctx *w)
+{
+	struct ftl_nv_cache *nv_cache = &dev->nv_cache;
+
+	spdk_json_write_named_uint64(w, "active_compactors", nv_cache->compaction_active_count);
+	spdk_json_write_named_uint64(w, "compactors_limit", nv_cache->compaction_active_limit);
+	spdk_json_write_named_uint64(w, "backlog_chunks", nv_cache->chunk_full_count);
+	spdk_json_write_named_uint64(w, "compacted_chunks", nv_cache->chunk_comp_count);
+	spdk_json_write_named_double(w, "bandwidth_MiBps", nv_cache->compaction_sma *
+				     spdk_get_ticks_hz() / (1024 * 1024));
+}
+
 void
 ftl_nv_cache_chunk_md_initialize(struct ftl_nv_cache_chunk_md *md)
 {
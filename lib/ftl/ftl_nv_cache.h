@@ -210,6 +210,8 @@ struct ftl_nv_cache {
 
 	TAILQ_HEAD(, ftl_nv_cache_compactor) compactor_list;
 	uint64_t compaction_active_count;
+	/* Number of compactors allowed to run, adjusted to the backlog of full chunks */
+	uint64_t compaction_active_limit;
 	uint64_t chunk_compaction_threshold;
 
 	struct ftl_nv_cache_chunk *chunks;
@@ -289,6 +291,15 @@ uint64_t chunk_tail_md_offset(struct ftl_nv_cache *nv_cache);
 void ftl_nv_cache_get_max_seq_id(struct ftl_nv_cache *nv_cache, uint64_t *open_seq_id,
 				 uint64_t *close_seq_id);
 
+/**
+ * @brief Get the lowest sequence ID of chunks which are still open
+ *
+ * @param nv_cache FLT NV cache
+ *
+ * @return Lowest open chunk sequence id, 0 if there are no open chunks
+ */
+uint64_t ftl_nv_cache_get_min_open_seq_id(struct ftl_nv_cache *nv_cache);
+
 void ftl_mngt_nv_cache_restore_chunk_state(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt);
 
 void ftl_mngt_nv_cache_recover_open_chunk(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt);
@@ -351,6 +351,19 @@ int ftl_mngt_call_dev_startup(struct spdk_ftl_dev *dev, ftl_mngt_completion cb,
 int ftl_mngt_trim(struct spdk_ftl_dev *dev, uint64_t lba, uint64_t num_blocks, spdk_ftl_fn cb,
 		  void *cb_cntx);
 
+/**
+ * @brief Persists the superblock with a new L2P checkpoint
+ *
+ * @param dev FTL device
+ * @param cb Caller callback
+ * @param cb_cntx Caller context
+ *
+ * @return Operation result
+ * @retval 0 The operation successful has started
+ * @retval Non-zero Failure
+ */
+int ftl_mngt_l2p_checkpoint(struct spdk_ftl_dev *dev, ftl_mngt_completion cb, void *cb_cntx);
+
 /**
  * @brief Shuts down a FTL instance
  *
@@ -63,3 +63,23 @@ ftl_mngt_restore_l2p(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 {
 	ftl_l2p_restore(dev, l2p_cb, mngt);
 }
+
+/*
+ * Makes an L2P checkpoint durable, dev->sb->ckpt_seq_id has already been updated by the caller
+ */
+static const struct ftl_mngt_process_desc g_desc_l2p_checkpoint = {
+	.name = "FTL L2P checkpoint",
+	.steps = {
+		{
+			.name = "Persist superblock",
+			.action = ftl_mngt_persist_superblock,
+		},
+		{}
+	}
+};
+
+int
+ftl_mngt_l2p_checkpoint(struct spdk_ftl_dev *dev, ftl_mngt_completion cb, void *cb_cntx)
+{
+	return ftl_mngt_process_execute(dev, &g_desc_l2p_checkpoint, cb, cb_cntx);
+}
@@ -118,7 +118,10 @@ ftl_mngt_recovery_init(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 	FTL_NOTICELOG(dev, "L2P resident size: %"PRIu64"MiB\n", (uint64_t)(l2p_limit / MiB));
 	FTL_NOTICELOG(dev, "Seq ID resident size: %"PRIu64"MiB\n", (uint64_t)(seq_limit / MiB));
 	FTL_NOTICELOG(dev, "Recovery iterations: %"PRIu64"\n", iterations);
-	dev->sb->ckpt_seq_id = 0;
+	if (dev->sb->ckpt_seq_id) {
+		FTL_NOTICELOG(dev, "L2P checkpoint seq ID: %"PRIu64", replaying newer metadata only\n",
+			      dev->sb->ckpt_seq_id);
+	}
 
 	/* Initialize region */
 	ctx->l2p_snippet.region = *ftl_layout_region_get(dev, FTL_LAYOUT_REGION_TYPE_L2P);
@@ -164,6 +167,9 @@ ftl_mngt_recovery_deinit(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt
 	ctx->l2p_snippet.md = NULL;
 	ctx->l2p_snippet.seq_id = NULL;
 
+	/* The whole L2P has been rebuilt, the checkpoint is no longer valid */
+	dev->sb->ckpt_seq_id = 0;
+
 	ftl_mngt_next_step(mngt);
 }
 
@@ -317,6 +323,30 @@ ftl_mngt_recovery_walk_band_tail_md(struct spdk_ftl_dev *dev, struct ftl_mngt_pr
 	}
 }
 
+/*
+ * Checks if the L2P checkpoint entry may be kept, i.e. it points to a band or chunk which has been
+ * closed before the checkpoint and won't be replayed
+ */
+static bool
+ckpt_addr_valid(struct spdk_ftl_dev *dev, ftl_addr addr, uint64_t ckpt_seq_id)
+{
+	struct ftl_nv_cache_chunk *chunk;
+	struct ftl_band *band;
+
+	if (addr == FTL_ADDR_INVALID) {
+		return false;
+	}
+
+	if (ftl_addr_in_nvc(dev, addr)) {
+		chunk = ftl_nv_cache_get_chunk_from_addr(dev, addr);
+		return chunk && chunk->md->state == FTL_CHUNK_STATE_CLOSED &&
+		       chunk->md->close_seq_id <= ckpt_seq_id;
+	}
+
+	band = ftl_band_from_addr(dev, addr);
+	return band->md->state == FTL_BAND_STATE_CLOSED && band->md->close_seq_id <= ckpt_seq_id;
+}
+
 static void
 ftl_mngt_recovery_iteration_init_seq_ids(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 {
@@ -325,13 +355,8 @@ ftl_mngt_recovery_iteration_init_seq_ids(struct spdk_ftl_dev *dev, struct ftl_mn
 	uint64_t *trim_map = ftl_md_get_buffer(md);
 	uint64_t page_id, trim_seq_id;
 	uint32_t lbas_in_page = FTL_BLOCK_SIZE / dev->layout.l2p.addr_size;
-	uint64_t lba, lba_off;
-
-	if (dev->sb->ckpt_seq_id) {
-		FTL_ERRLOG(dev, "Checkpoint recovery not supported!\n");
-		ftl_mngt_fail_step(mngt);
-		return;
-	}
+	uint64_t lba, lba_off, ckpt_seq_id = dev->sb->ckpt_seq_id;
+	ftl_addr addr;
 
 	for (lba = ctx->iter.lba_first; lba < ctx->iter.lba_last; lba++) {
 		lba_off = lba - ctx->iter.lba_first;
@@ -343,6 +368,18 @@ ftl_mngt_recovery_iteration_init_seq_ids(struct spdk_ftl_dev *dev, struct ftl_mn
 
 		trim_seq_id = trim_map[page_id];
 
+		if (ckpt_seq_id && trim_seq_id <= ckpt_seq_id) {
+			/*
+			 * The loaded L2P is the checkpoint, the entry is either still valid or will be
+			 * superseded by the replay of bands and chunks closed after the checkpoint
+			 */
+			addr = ftl_addr_load(dev, ctx->l2p_snippet.l2p, lba_off);
+			if (addr == FTL_ADDR_INVALID || ckpt_addr_valid(dev, addr, ckpt_seq_id)) {
+				ctx->l2p_snippet.seq_id[lba_off] = ckpt_seq_id;
+				continue;
+			}
+		}
+
 		ctx->l2p_snippet.seq_id[lba_off] = trim_seq_id;
 		ftl_addr_store(dev, ctx->l2p_snippet.l2p, lba_off, FTL_ADDR_INVALID);
 	}
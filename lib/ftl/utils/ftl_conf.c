@@ -141,6 +141,7 @@ ftl_conf_init_dev(struct spdk_ftl_dev *dev, const struct spdk_ftl_conf *conf)
 	}
 
 	dev->limit = SPDK_FTL_LIMIT_MAX;
+	dev->gc_cost_benefit = true;
 
 	ftl_property_register_bool_rw(dev, "prep_upgrade_on_shutdown", &dev->conf.prep_upgrade_on_shutdown,
 				      "", "During shutdown, FTL executes all actions which "
@@ -150,6 +151,10 @@ ftl_conf_init_dev(struct spdk_ftl_dev *dev, const struct spdk_ftl_conf *conf)
 				      "", "In verbose mode, user is able to get access to additional "
 				      "advanced FTL properties", false);
 
+	ftl_property_register_bool_rw(dev, "gc_cost_benefit", &dev->gc_cost_benefit,
+				      "", "Select bands for garbage collection based on their invalidity "
+				      "weighted by the age of the data, instead of invalidity only", false);
+
 	return 0;
 }
 
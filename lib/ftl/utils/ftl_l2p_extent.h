@@ -0,0 +1,94 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef FTL_L2P_EXTENT_H
+#define FTL_L2P_EXTENT_H
+
+#include "ftl_core.h"
+#include "utils/ftl_addr_utils.h"
+
+/*
+ * Extent (run-length) representation of a L2P page. Mostly sequentially written LBAs map to
+ * consecutive physical addresses, so such a page can be described by a handful of runs.
+ */
+struct ftl_l2p_extent {
+	/* Physical address of the first LBA in the run, FTL_ADDR_INVALID for a run of unmapped LBAs */
+	ftl_addr addr;
+
+	/* Number of LBAs in the run */
+	uint64_t num_lbas;
+};
+
+/**
+ * @brief Encodes a L2P page into extents
+ *
+ * @param dev FTL device
+ * @param page L2P page buffer
+ * @param lbas_in_page Number of L2P entries in the page
+ * @param extents Output extents
+ * @param max_extents Capacity of the extents array
+ *
+ * @return Number of extents used, -ENOSPC if the page doesn't fit in max_extents
+ */
+static inline int
+ftl_l2p_extent_encode(struct spdk_ftl_dev *dev, void *page, uint64_t lbas_in_page,
+		      struct ftl_l2p_extent *extents, uint64_t max_extents)
+{
+	struct ftl_l2p_extent *extent = NULL;
+	uint64_t num_extents = 0, i;
+	ftl_addr addr;
+
+	for (i = 0; i < lbas_in_page; i++) {
+		addr = ftl_addr_load(dev, page, i);
+
+		if (extent) {
+			if (addr == FTL_ADDR_INVALID && extent->addr == FTL_ADDR_INVALID) {
+				extent->num_lbas++;
+				continue;
+			}
+
+			if (addr != FTL_ADDR_INVALID && extent->addr != FTL_ADDR_INVALID &&
+			    addr == extent->addr + extent->num_lbas) {
+				extent->num_lbas++;
+				continue;
+			}
+		}
+
+		if (num_extents == max_extents) {
+			return -ENOSPC;
+		}
+
+		extent = &extents[num_extents++];
+		extent->addr = addr;
+		extent->num_lbas = 1;
+	}
+
+	return num_extents;
+}
+
+/**
+ * @brief Decodes extents back into a L2P page
+ *
+ * @param dev FTL device
+ * @param page L2P page buffer to fill
+ * @param extents Extents produced by ftl_l2p_extent_encode
+ * @param num_extents Number of extents
+ */
+static inline void
+ftl_l2p_extent_decode(struct spdk_ftl_dev *dev, void *page, const struct ftl_l2p_extent *extents,
+		      uint64_t num_extents)
+{
+	uint64_t offset = 0, i, j;
+
+	for (i = 0; i < num_extents; i++) {
+		for (j = 0; j < extents[i].num_lbas; j++) {
+			if (extents[i].addr == FTL_ADDR_INVALID) {
+				ftl_addr_store(dev, page, offset++, FTL_ADDR_INVALID);
+			} else {
+				ftl_addr_store(dev, page, offset++, extents[i].addr + j);
+			}
+		}
+	}
+}
+
+#endif /* FTL_L2P_EXTENT_H */
@@ -27,10 +27,12 @@
 #include "spdk/nvme_intel.h"
 #include "spdk/nvmf_spec.h"
 #include "spdk/tree.h"
+#include "spdk/trace.h"
 #include "spdk/uuid.h"
 #include "spdk/fd_group.h"
 
 #include "spdk_internal/assert.h"
+#include "spdk_internal/trace_defs.h"
 #include "spdk/log.h"
 
 extern pid_t g_spdk_nvme_pid;
@@ -380,6 +382,9 @@ struct nvme_request {
 
 	/** Sequence of accel operations associated with this request */
 	void				*accel_sequence;
+
+	/** Trace id of the sampled I/O this request was sent for, 0 if not sampled */
+	uint64_t			trace_io_id;
 };
 
 struct nvme_completion_poll_status {
@@ -1421,6 +1426,8 @@ nvme_request_clear(struct nvme_request *req)
 		req->pid = g_spdk_nvme_pid;		\
 		req->submit_tick = 0;			\
 		req->accel_sequence = NULL;		\
+		req->trace_io_id = spdk_trace_io_enabled() ?	\
+				   spdk_trace_io_get_ctx() : 0;	\
 	} while (0);
 
 static inline struct nvme_request *
@@ -1530,6 +1537,10 @@ nvme_complete_request(spdk_nvme_cmd_cb cb_fn, void *cb_arg, struct spdk_nvme_qpa
 		}
 	}
 
+	if (spdk_unlikely(req->trace_io_id != 0)) {
+		spdk_trace_record(TRACE_IO_NVME_COMPLETE, 0, 0, req->trace_io_id, (uintptr_t)req);
+	}
+
 	/* For PCIe completions, we want to avoid touching the req itself to avoid
 	 * dependencies on loading those cachelines. So call the internal helper
 	 * function instead using the qpair that was passed by the caller, instead
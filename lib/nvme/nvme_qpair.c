@@ -1048,6 +1048,10 @@ _nvme_qpair_submit_request(struct spdk_nvme_qpair *qpair, struct nvme_request *r
 	if (spdk_likely(nvme_qpair_get_state(qpair) == NVME_QPAIR_ENABLED) ||
 	    (req->cmd.opc == SPDK_NVME_OPC_FABRIC &&
 	     nvme_qpair_get_state(qpair) == NVME_QPAIR_CONNECTING)) {
+		if (spdk_unlikely(req->trace_io_id != 0)) {
+			spdk_trace_record(TRACE_IO_NVME_SUBMIT, 0, req->payload_size, req->trace_io_id,
+					  (uintptr_t)req, qpair->id, req->cmd.opc);
+		}
 		rc = nvme_transport_qpair_submit_request(qpair, req);
 	} else {
 		/* The controller is being reset - queue this request and
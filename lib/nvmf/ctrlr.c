@@ -4694,6 +4694,10 @@ _nvmf_request_complete(void *ctx)
 	nsid = req->cmd->nvme_cmd.nsid;
 	opcode = req->cmd->nvmf_cmd.opcode;
 
+	if (spdk_unlikely(req->trace_io_id != 0)) {
+		spdk_trace_record(TRACE_IO_NVMF_COMPLETE, 0, 0, req->trace_io_id, rsp->status_raw);
+	}
+
 	qpair = req->qpair;
 	if (spdk_likely(qpair->ctrlr)) {
 		sgroup = &qpair->group->sgroups[qpair->ctrlr->subsys->id];
@@ -4926,6 +4930,24 @@ nvmf_check_qpair_active(struct spdk_nvmf_request *req)
 	return false;
 }
 
+static enum spdk_nvmf_request_exec_status
+nvmf_ctrlr_process_io_cmd_traced(struct spdk_nvmf_request *req)
+{
+	enum spdk_nvmf_request_exec_status status;
+	uint64_t io_ctx;
+
+	if (req->trace_io_id != 0) {
+		spdk_trace_record(TRACE_IO_NVMF_EXEC, 0, 0, req->trace_io_id);
+	}
+
+	/* Make the bdev_ios submitted on behalf of this request inherit its trace id */
+	io_ctx = spdk_trace_io_set_ctx(req->trace_io_id);
+	status = nvmf_ctrlr_process_io_cmd(req);
+	spdk_trace_io_set_ctx(io_ctx);
+
+	return status;
+}
+
 void
 spdk_nvmf_request_exec(struct spdk_nvmf_request *req)
 {
@@ -4950,6 +4972,8 @@ spdk_nvmf_request_exec(struct spdk_nvmf_request *req)
 		status = nvmf_ctrlr_process_fabrics_cmd(req);
 	} else if (spdk_unlikely(nvmf_qpair_is_admin_queue(qpair))) {
 		status = nvmf_ctrlr_process_admin_cmd(req);
+	} else if (spdk_trace_io_enabled()) {
+		status = nvmf_ctrlr_process_io_cmd_traced(req);
 	} else {
 		status = nvmf_ctrlr_process_io_cmd(req);
 	}
@@ -20,9 +20,12 @@
 #include "spdk/queue.h"
 #include "spdk/util.h"
 #include "spdk/thread.h"
+#include "spdk/trace.h"
 #include "spdk/tree.h"
 #include "spdk/bit_array.h"
 
+#include "spdk_internal/trace_defs.h"
+
 /* The spec reserves cntlid values in the range FFF0h to FFFFh. */
 #define NVMF_MIN_CNTLID 1
 #define NVMF_MAX_CNTLID 0xFFEF
@@ -486,6 +489,35 @@ void nvmf_qpair_free_aer(struct spdk_nvmf_qpair *qpair);
 
 int nvmf_ctrlr_abort_request(struct spdk_nvmf_request *req);
 
+/*
+ * Called by the transports once a command is received, to decide whether to trace it
+ * across the bdev and NVMe layers.  tsc is the time it was received, 0 meaning now.
+ */
+static inline void
+nvmf_request_trace_recv(struct spdk_nvmf_request *req, uint64_t tsc)
+{
+	if (spdk_likely(!spdk_trace_io_enabled())) {
+		req->trace_io_id = 0;
+		return;
+	}
+
+	req->trace_io_id = spdk_trace_io_sample();
+	if (req->trace_io_id != 0) {
+		spdk_trace_record_tsc(tsc, TRACE_IO_NVMF_RECV, 0, 0, req->trace_io_id,
+				      req->qpair->qid, req->cmd->nvme_cmd.opc);
+	}
+}
+
+/* Called by the transports once the response of a command was sent to the host */
+static inline void
+nvmf_request_trace_sent(struct spdk_nvmf_request *req)
+{
+	if (spdk_unlikely(req->trace_io_id != 0)) {
+		spdk_trace_record(TRACE_IO_NVMF_SENT, 0, 0, req->trace_io_id);
+		req->trace_io_id = 0;
+	}
+}
+
 void nvmf_ctrlr_set_fatal_status(struct spdk_nvmf_ctrlr *ctrlr);
 
 static inline bool
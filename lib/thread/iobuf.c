@@ -11,6 +11,7 @@
 
 #define IOBUF_MIN_SMALL_POOL_SIZE	64
 #define IOBUF_MIN_LARGE_POOL_SIZE	8
+#define IOBUF_MIN_MID_POOL_SIZE		8
 #define IOBUF_DEFAULT_SMALL_POOL_SIZE	8192
 #define IOBUF_DEFAULT_LARGE_POOL_SIZE	1024
 #define IOBUF_ALIGNMENT			4096
@@ -23,6 +24,9 @@
  * for the default. */
 #define IOBUF_DEFAULT_LARGE_BUFSIZE	(132 * 1024)
 #define IOBUF_MAX_CHANNELS		64
+#define IOBUF_WAIT_POLL_PERIOD_US	10
+/* The small pool, the additional ones, and the large pool */
+#define IOBUF_MAX_CLASSES		(SPDK_IOBUF_MAX_MID_CLASSES + 2)
 
 SPDK_STATIC_ASSERT(sizeof(struct spdk_iobuf_buffer) <= IOBUF_MIN_SMALL_BUFSIZE,
 		   "Invalid data offset");
@@ -32,11 +36,16 @@ static bool g_iobuf_is_initialized = false;
 struct iobuf_channel_node {
 	spdk_iobuf_entry_stailq_t	small_queue;
 	spdk_iobuf_entry_stailq_t	large_queue;
+	spdk_iobuf_entry_stailq_t	mid_queue[SPDK_IOBUF_MAX_MID_CLASSES];
 };
 
 struct iobuf_channel {
 	struct iobuf_channel_node	node[SPDK_CONFIG_MAX_NUMA_NODES];
 	struct spdk_iobuf_channel	*channels[IOBUF_MAX_CHANNELS];
+	/* Polls the shared pools while requests are waiting on the thread */
+	struct spdk_poller		*poller;
+	/* Number of non-empty wait queues */
+	uint32_t			num_waiting;
 };
 
 struct iobuf_module {
@@ -44,15 +53,36 @@ struct iobuf_module {
 	TAILQ_ENTRY(iobuf_module)	tailq;
 };
 
+struct iobuf_pool {
+	struct spdk_ring		*ring;
+	/* Slabs the buffers of the pool are carved from */
+	void				**slabs;
+	/* Read without the lock, only updated atomically under it */
+	uint32_t			num_slabs;
+	uint32_t			max_slabs;
+	uint64_t			bufs_per_slab;
+	/* The pool is grown once it holds fewer buffers, by a message to the app thread */
+	uint64_t			grow_watermark;
+	bool				grow_pending;
+	/* Number of buffers allocated so far, and maximum number of buffers */
+	uint64_t			count;
+	uint64_t			max_count;
+	uint32_t			bufsize;
+	int32_t				numa_id;
+	/* Number of threads with requests waiting for a buffer of the pool */
+	uint32_t			waiting_threads;
+	/* Serializes the growth of the pool */
+	pthread_mutex_t			lock;
+};
+
 struct iobuf_node {
-	struct spdk_ring		*small_pool;
-	struct spdk_ring		*large_pool;
-	void				*small_pool_base;
-	void				*large_pool_base;
+	/* Pools ordered by buffer size: small, the additional ones, and large */
+	struct iobuf_pool		pools[IOBUF_MAX_CLASSES];
 };
 
 struct iobuf {
 	struct spdk_iobuf_opts		opts;
+	uint32_t			num_mid_classes;
 	TAILQ_HEAD(, iobuf_module)	modules;
 	spdk_iobuf_finish_cb		finish_cb;
 	void				*finish_arg;
@@ -82,19 +112,293 @@ struct iobuf_get_stats_ctx {
 	void				*cb_arg;
 };
 
+static inline uint32_t
+iobuf_num_classes(void)
+{
+	return g_iobuf.num_mid_classes + 2;
+}
+
+static const char *
+iobuf_class_name(uint32_t class)
+{
+	if (class == 0) {
+		return "small";
+	} else if (class > g_iobuf.num_mid_classes) {
+		return "large";
+	}
+
+	return "mid";
+}
+
+static void
+iobuf_class_get_opts(uint32_t class, uint32_t *bufsize, uint64_t *count)
+{
+	struct spdk_iobuf_opts *opts = &g_iobuf.opts;
+
+	if (class == 0) {
+		*bufsize = opts->small_bufsize;
+		*count = opts->small_pool_count;
+	} else if (class > g_iobuf.num_mid_classes) {
+		*bufsize = opts->large_bufsize;
+		*count = opts->large_pool_count;
+	} else {
+		*bufsize = opts->mid_bufsize[class - 1];
+		*count = opts->mid_pool_count[class - 1];
+	}
+}
+
+static struct spdk_iobuf_pool_cache *
+iobuf_node_cache_get_class(struct spdk_iobuf_node_cache *cache, uint32_t class)
+{
+	if (class == 0) {
+		return &cache->small;
+	} else if (class > g_iobuf.num_mid_classes) {
+		return &cache->large;
+	}
+
+	return &cache->mid[class - 1];
+}
+
+static spdk_iobuf_entry_stailq_t *
+iobuf_channel_node_get_queue(struct iobuf_channel_node *node, uint32_t class)
+{
+	if (class == 0) {
+		return &node->small_queue;
+	} else if (class > g_iobuf.num_mid_classes) {
+		return &node->large_queue;
+	}
+
+	return &node->mid_queue[class - 1];
+}
+
+/* Find the pool with the smallest buffers able to hold len bytes */
+static inline struct spdk_iobuf_pool_cache *
+iobuf_node_cache_get_pool(struct spdk_iobuf_node_cache *cache, uint64_t len)
+{
+	uint32_t i;
+
+	if (len <= cache->small.bufsize) {
+		return &cache->small;
+	}
+
+	for (i = 0; i < g_iobuf.num_mid_classes; ++i) {
+		if (len <= cache->mid[i].bufsize) {
+			return &cache->mid[i];
+		}
+	}
+
+	assert(len <= cache->large.bufsize);
+	return &cache->large;
+}
+
+static inline bool
+iobuf_pool_is_complete(struct iobuf_pool *pool)
+{
+	return __atomic_load_n(&pool->num_slabs, __ATOMIC_ACQUIRE) ==
+	       __atomic_load_n(&pool->max_slabs, __ATOMIC_RELAXED);
+}
+
+/* Add a slab of buffers to a pool.  Returns false if the pool cannot grow any further. */
+static bool
+iobuf_pool_grow(struct iobuf_pool *pool)
+{
+	struct spdk_iobuf_buffer *buf;
+	uint64_t i, count;
+	void *slab;
+	bool rc = true;
+
+	/* Checked again under the lock, this only avoids taking it once the pool is complete */
+	if (iobuf_pool_is_complete(pool)) {
+		return false;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+
+	/* Another thread might have grown the pool while we were waiting for the lock */
+	if (spdk_ring_count(pool->ring) >= pool->grow_watermark) {
+		goto out;
+	}
+
+	if (pool->num_slabs == pool->max_slabs) {
+		rc = false;
+		goto out;
+	}
+
+	count = spdk_min(pool->bufs_per_slab, pool->max_count - pool->count);
+	slab = spdk_malloc(count * pool->bufsize, IOBUF_ALIGNMENT, NULL, pool->numa_id,
+			   SPDK_MALLOC_DMA);
+	if (slab == NULL) {
+		SPDK_ERRLOG("Failed to grow iobuf pool of %"PRIu32" byte buffers beyond %"PRIu64
+			    " buffers\n", pool->bufsize, pool->count);
+		/* Don't try again on each miss */
+		__atomic_store_n(&pool->max_slabs, pool->num_slabs, __ATOMIC_RELAXED);
+		rc = false;
+		goto out;
+	}
+
+	pool->slabs[pool->num_slabs] = slab;
+	pool->count += count;
+	__atomic_store_n(&pool->num_slabs, pool->num_slabs + 1, __ATOMIC_RELEASE);
+
+	for (i = 0; i < count; i++) {
+		buf = slab + i * pool->bufsize;
+		spdk_ring_enqueue(pool->ring, (void **)&buf, 1, NULL);
+	}
+out:
+	pthread_mutex_unlock(&pool->lock);
+
+	return rc;
+}
+
+static void
+iobuf_pool_grow_msg(void *ctx)
+{
+	struct iobuf_pool *pool = ctx;
+
+	/* The pools might have been freed in the meantime */
+	if (pool->ring == NULL) {
+		return;
+	}
+
+	iobuf_pool_grow(pool);
+	__atomic_store_n(&pool->grow_pending, false, __ATOMIC_RELEASE);
+}
+
+/*
+ * Grow a pool running low on buffers ahead of demand.  Allocating a slab takes too long to be done
+ * on the data path, so it's done by the app thread, and the requests that find the pool empty in
+ * the meantime wait for the new buffers.
+ */
+static void
+iobuf_pool_request_grow(struct iobuf_pool *pool)
+{
+	if (spdk_likely(iobuf_pool_is_complete(pool) ||
+			spdk_ring_count(pool->ring) >= pool->grow_watermark)) {
+		return;
+	}
+
+	if (__atomic_exchange_n(&pool->grow_pending, true, __ATOMIC_ACQ_REL)) {
+		return;
+	}
+
+	if (spdk_thread_send_msg(spdk_thread_get_app_thread(), iobuf_pool_grow_msg, pool) != 0) {
+		__atomic_store_n(&pool->grow_pending, false, __ATOMIC_RELEASE);
+	}
+}
+
+static size_t
+iobuf_pool_dequeue(struct iobuf_pool *pool, void **bufs, size_t count)
+{
+	size_t sz;
+
+	do {
+		sz = spdk_ring_dequeue(pool->ring, bufs, count);
+	} while (sz == 0 && iobuf_pool_grow(pool));
+
+	return sz;
+}
+
+static void
+iobuf_channel_start_waiting(struct iobuf_channel *iobuf_ch, uint32_t *waiting_threads)
+{
+	__atomic_fetch_add(waiting_threads, 1, __ATOMIC_RELAXED);
+	if (iobuf_ch->num_waiting++ == 0) {
+		spdk_poller_resume(iobuf_ch->poller);
+	}
+}
+
+static void
+iobuf_channel_stop_waiting(struct iobuf_channel *iobuf_ch, uint32_t *waiting_threads)
+{
+	__atomic_fetch_sub(waiting_threads, 1, __ATOMIC_RELAXED);
+	assert(iobuf_ch->num_waiting > 0);
+	if (--iobuf_ch->num_waiting == 0) {
+		spdk_poller_pause(iobuf_ch->poller);
+	}
+}
+
+/* Hand a buffer to the first entry waiting on a queue */
+static void
+iobuf_queue_handoff(struct iobuf_channel *iobuf_ch, spdk_iobuf_entry_stailq_t *queue,
+		    uint32_t *waiting_threads, void *buf)
+{
+	struct spdk_iobuf_entry *entry;
+	uint64_t wait_us;
+	uint32_t bucket;
+
+	entry = STAILQ_FIRST(queue);
+	STAILQ_REMOVE_HEAD(queue, stailq);
+	if (STAILQ_EMPTY(queue)) {
+		iobuf_channel_stop_waiting(iobuf_ch, waiting_threads);
+	}
+
+	wait_us = (spdk_get_ticks() - entry->wait_tsc) * SPDK_SEC_TO_USEC / spdk_get_ticks_hz();
+	bucket = wait_us == 0 ? 0 : 64 - __builtin_clzll(wait_us);
+	entry->ch->wait_hist[spdk_min(bucket, SPDK_IOBUF_WAIT_HIST_BUCKETS - 1)]++;
+
+	entry->cb_fn(entry, buf);
+	if (spdk_unlikely(entry == STAILQ_LAST(queue, spdk_iobuf_entry, stailq))) {
+		STAILQ_REMOVE(queue, entry, spdk_iobuf_entry, stailq);
+		STAILQ_INSERT_HEAD(queue, entry, stailq);
+	}
+}
+
+/*
+ * Requests waiting on this thread are only served by the buffers released on this thread.  Poll
+ * the shared pools for the buffers released by the other threads while there are any.
+ */
+static int
+iobuf_channel_poll(void *ctx)
+{
+	struct iobuf_channel *iobuf_ch = ctx;
+	spdk_iobuf_entry_stailq_t *queue;
+	struct iobuf_pool *pool;
+	void *buf;
+	int32_t i;
+	uint32_t class;
+	int rc = SPDK_POLLER_IDLE;
+
+	IOBUF_FOREACH_NUMA_ID(i) {
+		for (class = 0; class < iobuf_num_classes(); ++class) {
+			queue = iobuf_channel_node_get_queue(&iobuf_ch->node[i], class);
+			pool = &g_iobuf.node[i].pools[class];
+			while (!STAILQ_EMPTY(queue) && spdk_ring_dequeue(pool->ring, &buf, 1) == 1) {
+				iobuf_queue_handoff(iobuf_ch, queue, &pool->waiting_threads, buf);
+				rc = SPDK_POLLER_BUSY;
+			}
+			if (!STAILQ_EMPTY(queue)) {
+				iobuf_pool_request_grow(pool);
+			}
+		}
+	}
+
+	return rc;
+}
+
 static int
 iobuf_channel_create_cb(void *io_device, void *ctx)
 {
 	struct iobuf_channel *ch = ctx;
 	struct iobuf_channel_node *node;
 	int32_t i;
+	uint32_t class;
 
 	IOBUF_FOREACH_NUMA_ID(i) {
 		node = &ch->node[i];
-		STAILQ_INIT(&node->small_queue);
-		STAILQ_INIT(&node->large_queue);
+		for (class = 0; class < iobuf_num_classes(); ++class) {
+			STAILQ_INIT(iobuf_channel_node_get_queue(node, class));
+		}
 	}
 
+	ch->poller = SPDK_POLLER_REGISTER(iobuf_channel_poll, ch, IOBUF_WAIT_POLL_PERIOD_US);
+	if (ch->poller == NULL) {
+		SPDK_ERRLOG("Failed to register iobuf poller\n");
+		return -ENOMEM;
+	}
+
+	/* Only polled while requests are waiting for a buffer */
+	spdk_poller_pause(ch->poller);
+
 	return 0;
 }
 
@@ -104,107 +408,119 @@ iobuf_channel_destroy_cb(void *io_device, void *ctx)
 	struct iobuf_channel *ch = ctx;
 	struct iobuf_channel_node *node __attribute__((unused));
 	int32_t i;
+	uint32_t class;
 
 	IOBUF_FOREACH_NUMA_ID(i) {
 		node = &ch->node[i];
-		assert(STAILQ_EMPTY(&node->small_queue));
-		assert(STAILQ_EMPTY(&node->large_queue));
+		for (class = 0; class < iobuf_num_classes(); ++class) {
+			assert(STAILQ_EMPTY(iobuf_channel_node_get_queue(node, class)));
+		}
 	}
+
+	assert(ch->num_waiting == 0);
+	spdk_poller_unregister(&ch->poller);
 }
 
-static int
-iobuf_node_initialize(struct iobuf_node *node, uint32_t numa_id)
+static void
+iobuf_pool_free(struct iobuf_pool *pool, const char *name)
 {
-	struct spdk_iobuf_opts *opts = &g_iobuf.opts;
-	struct spdk_iobuf_buffer *buf;
-	uint64_t i;
-	int rc;
+	uint32_t i;
 
-	if (!g_iobuf.opts.enable_numa) {
-		numa_id = SPDK_ENV_NUMA_ID_ANY;
+	if (pool->ring == NULL) {
+		/* This pool didn't get allocated, so just return immediately. */
+		return;
 	}
 
-	node->small_pool = spdk_ring_create(SPDK_RING_TYPE_MP_MC, opts->small_pool_count,
-					    numa_id);
-	if (!node->small_pool) {
-		SPDK_ERRLOG("Failed to create small iobuf pool\n");
-		rc = -ENOMEM;
-		goto error;
+	if (spdk_ring_count(pool->ring) != pool->count) {
+		SPDK_ERRLOG("%s iobuf pool count is %zu, expected %"PRIu64"\n", name,
+			    spdk_ring_count(pool->ring), pool->count);
 	}
 
-	node->small_pool_base = spdk_malloc(opts->small_bufsize * opts->small_pool_count, IOBUF_ALIGNMENT,
-					    NULL, numa_id, SPDK_MALLOC_DMA);
-	if (node->small_pool_base == NULL) {
-		SPDK_ERRLOG("Unable to allocate requested small iobuf pool size\n");
-		rc = -ENOMEM;
-		goto error;
+	for (i = 0; i < pool->num_slabs; i++) {
+		spdk_free(pool->slabs[i]);
 	}
 
-	node->large_pool = spdk_ring_create(SPDK_RING_TYPE_MP_MC, opts->large_pool_count,
-					    numa_id);
-	if (!node->large_pool) {
-		SPDK_ERRLOG("Failed to create large iobuf pool\n");
-		rc = -ENOMEM;
-		goto error;
-	}
+	free(pool->slabs);
+	pthread_mutex_destroy(&pool->lock);
+	spdk_ring_free(pool->ring);
+	memset(pool, 0, sizeof(*pool));
+}
 
-	node->large_pool_base = spdk_malloc(opts->large_bufsize * opts->large_pool_count, IOBUF_ALIGNMENT,
-					    NULL, numa_id, SPDK_MALLOC_DMA);
-	if (node->large_pool_base == NULL) {
-		SPDK_ERRLOG("Unable to allocate requested large iobuf pool size\n");
-		rc = -ENOMEM;
-		goto error;
+static int
+iobuf_pool_initialize(struct iobuf_pool *pool, const char *name, uint32_t bufsize,
+		      uint64_t count, int32_t numa_id)
+{
+	pool->ring = spdk_ring_create(SPDK_RING_TYPE_MP_MC, count, numa_id);
+	if (!pool->ring) {
+		SPDK_ERRLOG("Failed to create %s iobuf pool\n", name);
+		return -ENOMEM;
 	}
 
-	for (i = 0; i < opts->small_pool_count; i++) {
-		buf = node->small_pool_base + i * opts->small_bufsize;
-		spdk_ring_enqueue(node->small_pool, (void **)&buf, 1, NULL);
+	if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+		SPDK_ERRLOG("Failed to initialize %s iobuf pool lock\n", name);
+		spdk_ring_free(pool->ring);
+		pool->ring = NULL;
+		return -ENOMEM;
 	}
 
-	for (i = 0; i < opts->large_pool_count; i++) {
-		buf = node->large_pool_base + i * opts->large_bufsize;
-		spdk_ring_enqueue(node->large_pool, (void **)&buf, 1, NULL);
+	pool->bufsize = bufsize;
+	pool->max_count = count;
+	pool->numa_id = numa_id;
+	if (g_iobuf.opts.slab_size != 0) {
+		pool->bufs_per_slab = spdk_max(g_iobuf.opts.slab_size / bufsize, 1);
+	} else {
+		pool->bufs_per_slab = count;
 	}
+	pool->max_slabs = spdk_divide_round_up(count, pool->bufs_per_slab);
+	/* Grow when less than a quarter of a slab is left, so the new slab is ready in time */
+	pool->grow_watermark = spdk_max(pool->bufs_per_slab / 4, 1);
 
-	return 0;
+	pool->slabs = calloc(pool->max_slabs, sizeof(*pool->slabs));
+	if (pool->slabs == NULL) {
+		SPDK_ERRLOG("Failed to allocate %s iobuf pool slabs\n", name);
+		return -ENOMEM;
+	}
 
-error:
-	spdk_free(node->small_pool_base);
-	spdk_ring_free(node->small_pool);
-	spdk_free(node->large_pool_base);
-	spdk_ring_free(node->large_pool);
-	memset(node, 0, sizeof(*node));
+	if (!iobuf_pool_grow(pool)) {
+		SPDK_ERRLOG("Unable to allocate requested %s iobuf pool size\n", name);
+		return -ENOMEM;
+	}
 
-	return rc;
+	return 0;
 }
 
 static void
 iobuf_node_free(struct iobuf_node *node)
 {
-	if (node->small_pool == NULL) {
-		/* This node didn't get allocated, so just return immediately. */
-		return;
-	}
+	uint32_t class;
 
-	if (spdk_ring_count(node->small_pool) != g_iobuf.opts.small_pool_count) {
-		SPDK_ERRLOG("small iobuf pool count is %zu, expected %"PRIu64"\n",
-			    spdk_ring_count(node->small_pool), g_iobuf.opts.small_pool_count);
+	for (class = 0; class < iobuf_num_classes(); ++class) {
+		iobuf_pool_free(&node->pools[class], iobuf_class_name(class));
 	}
+}
 
-	if (spdk_ring_count(node->large_pool) != g_iobuf.opts.large_pool_count) {
-		SPDK_ERRLOG("large iobuf pool count is %zu, expected %"PRIu64"\n",
-			    spdk_ring_count(node->large_pool), g_iobuf.opts.large_pool_count);
+static int
+iobuf_node_initialize(struct iobuf_node *node, uint32_t numa_id)
+{
+	uint64_t count;
+	uint32_t class, bufsize;
+	int rc;
+
+	if (!g_iobuf.opts.enable_numa) {
+		numa_id = SPDK_ENV_NUMA_ID_ANY;
 	}
 
-	spdk_free(node->small_pool_base);
-	node->small_pool_base = NULL;
-	spdk_ring_free(node->small_pool);
-	node->small_pool = NULL;
+	for (class = 0; class < iobuf_num_classes(); ++class) {
+		iobuf_class_get_opts(class, &bufsize, &count);
+		rc = iobuf_pool_initialize(&node->pools[class], iobuf_class_name(class), bufsize,
+					   count, numa_id);
+		if (rc != 0) {
+			iobuf_node_free(node);
+			return rc;
+		}
+	}
 
-	spdk_free(node->large_pool_base);
-	node->large_pool_base = NULL;
-	spdk_ring_free(node->large_pool);
-	node->large_pool = NULL;
+	return 0;
 }
 
 int
@@ -219,6 +535,14 @@ spdk_iobuf_initialize(void)
 	opts->small_bufsize = SPDK_ALIGN_CEIL(opts->small_bufsize, IOBUF_ALIGNMENT);
 	opts->large_bufsize = SPDK_ALIGN_CEIL(opts->large_bufsize, IOBUF_ALIGNMENT);
 
+	g_iobuf.num_mid_classes = 0;
+	while (g_iobuf.num_mid_classes < SPDK_IOBUF_MAX_MID_CLASSES &&
+	       opts->mid_bufsize[g_iobuf.num_mid_classes] != 0) {
+		opts->mid_bufsize[g_iobuf.num_mid_classes] =
+			SPDK_ALIGN_CEIL(opts->mid_bufsize[g_iobuf.num_mid_classes], IOBUF_ALIGNMENT);
+		g_iobuf.num_mid_classes++;
+	}
+
 	IOBUF_FOREACH_NUMA_ID(i) {
 		node = &g_iobuf.node[i];
 		rc = iobuf_node_initialize(node, i);
@@ -280,9 +604,47 @@ spdk_iobuf_finish(spdk_iobuf_finish_cb cb_fn, void *cb_arg)
 	spdk_io_device_unregister(&g_iobuf, iobuf_unregister_cb);
 }
 
+static int
+iobuf_check_mid_opts(const struct spdk_iobuf_opts *opts)
+{
+	uint32_t i, bufsize, prev_bufsize;
+
+	prev_bufsize = SPDK_ALIGN_CEIL(opts->small_bufsize, IOBUF_ALIGNMENT);
+	for (i = 0; i < SPDK_IOBUF_MAX_MID_CLASSES && opts->mid_bufsize[i] != 0; i++) {
+		bufsize = SPDK_ALIGN_CEIL(opts->mid_bufsize[i], IOBUF_ALIGNMENT);
+		if (bufsize <= prev_bufsize) {
+			SPDK_ERRLOG("mid_bufsize[%" PRIu32 "] must be larger than small_bufsize and "
+				    "the preceding mid_bufsize, rounded up to %" PRIu32 " bytes\n",
+				    i, IOBUF_ALIGNMENT);
+			return -EINVAL;
+		}
+		if (bufsize >= SPDK_ALIGN_CEIL(opts->large_bufsize, IOBUF_ALIGNMENT)) {
+			SPDK_ERRLOG("mid_bufsize[%" PRIu32 "] must be smaller than large_bufsize\n", i);
+			return -EINVAL;
+		}
+		if (opts->mid_pool_count[i] < IOBUF_MIN_MID_POOL_SIZE) {
+			SPDK_ERRLOG("mid_pool_count[%" PRIu32 "] must be at least %" PRIu32 "\n",
+				    i, IOBUF_MIN_MID_POOL_SIZE);
+			return -EINVAL;
+		}
+		prev_bufsize = bufsize;
+	}
+
+	for (; i < SPDK_IOBUF_MAX_MID_CLASSES; i++) {
+		if (opts->mid_bufsize[i] != 0) {
+			SPDK_ERRLOG("mid_bufsize[%" PRIu32 "] follows an unused entry\n", i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 int
 spdk_iobuf_set_opts(const struct spdk_iobuf_opts *opts)
 {
+	int rc;
+
 	if (!opts) {
 		SPDK_ERRLOG("opts cannot be NULL\n");
 		return -1;
@@ -326,20 +688,43 @@ spdk_iobuf_set_opts(const struct spdk_iobuf_opts *opts)
 		return -EINVAL;
 	}
 
+	if (offsetof(struct spdk_iobuf_opts, mid_bufsize) + sizeof(opts->mid_bufsize) <=
+	    opts->opts_size) {
+		rc = iobuf_check_mid_opts(opts);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	if (offsetof(struct spdk_iobuf_opts, slab_size) + sizeof(opts->slab_size) <= opts->opts_size &&
+	    opts->slab_size != 0 && opts->slab_size < IOBUF_ALIGNMENT) {
+		SPDK_ERRLOG("slab_size must be 0 or at least %" PRIu32 "\n", IOBUF_ALIGNMENT);
+		return -EINVAL;
+	}
+
 #define SET_FIELD(field) \
         if (offsetof(struct spdk_iobuf_opts, field) + sizeof(opts->field) <= opts->opts_size) { \
                 g_iobuf.opts.field = opts->field; \
         } \
 
+#define SET_ARRAY(field) \
+        if (offsetof(struct spdk_iobuf_opts, field) + sizeof(opts->field) <= opts->opts_size) { \
+                memcpy(g_iobuf.opts.field, opts->field, sizeof(opts->field)); \
+        } \
+
 	SET_FIELD(small_pool_count);
 	SET_FIELD(large_pool_count);
 	SET_FIELD(small_bufsize);
 	SET_FIELD(large_bufsize);
 	SET_FIELD(enable_numa);
+	SET_ARRAY(mid_pool_count);
+	SET_ARRAY(mid_bufsize);
+	SET_FIELD(slab_size);
 
 	g_iobuf.opts.opts_size = opts->opts_size;
 
 #undef SET_FIELD
+#undef SET_ARRAY
 
 	return 0;
 }
@@ -364,17 +749,26 @@ spdk_iobuf_get_opts(struct spdk_iobuf_opts *opts, size_t opts_size)
 		opts->field = g_iobuf.opts.field; \
 	} \
 
+#define SET_ARRAY(field) \
+	if (offsetof(struct spdk_iobuf_opts, field) + sizeof(opts->field) <= opts_size) { \
+		memcpy(opts->field, g_iobuf.opts.field, sizeof(opts->field)); \
+	} \
+
 	SET_FIELD(small_pool_count);
 	SET_FIELD(large_pool_count);
 	SET_FIELD(small_bufsize);
 	SET_FIELD(large_bufsize);
 	SET_FIELD(enable_numa);
+	SET_ARRAY(mid_pool_count);
+	SET_ARRAY(mid_bufsize);
+	SET_FIELD(slab_size);
 
 #undef SET_FIELD
+#undef SET_ARRAY
 
 	/* Do not remove this statement, you should always update this statement when you adding a new field,
 	 * and do not forget to add the SET_FIELD statement for your added field. */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_iobuf_opts) == 40, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_iobuf_opts) == 120, "Incorrect size");
 }
 
 static void
@@ -384,20 +778,21 @@ iobuf_channel_node_init(struct spdk_iobuf_channel *ch, struct iobuf_channel *iob
 	struct iobuf_node *node = &g_iobuf.node[numa_id];
 	struct spdk_iobuf_node_cache *cache = &ch->cache[numa_id];
 	struct iobuf_channel_node *ch_node = &iobuf_ch->node[numa_id];
-
-	cache->small.queue = &ch_node->small_queue;
-	cache->large.queue = &ch_node->large_queue;
-	cache->small.pool = node->small_pool;
-	cache->large.pool = node->large_pool;
-	cache->small.bufsize = g_iobuf.opts.small_bufsize;
-	cache->large.bufsize = g_iobuf.opts.large_bufsize;
-	cache->small.cache_size = small_cache_size;
-	cache->large.cache_size = large_cache_size;
-	cache->small.cache_count = 0;
-	cache->large.cache_count = 0;
-
-	STAILQ_INIT(&cache->small.cache);
-	STAILQ_INIT(&cache->large.cache);
+	struct spdk_iobuf_pool_cache *pool;
+	uint32_t class;
+
+	for (class = 0; class < iobuf_num_classes(); ++class) {
+		pool = iobuf_node_cache_get_class(cache, class);
+		pool->queue = iobuf_channel_node_get_queue(ch_node, class);
+		pool->pool = node->pools[class].ring;
+		pool->bufsize = node->pools[class].bufsize;
+		pool->cache_size = class == 0 ? small_cache_size : large_cache_size;
+		pool->cache_count = 0;
+		pool->waiting_threads = &node->pools[class].waiting_threads;
+		memset(&pool->stats, 0, sizeof(pool->stats));
+
+		STAILQ_INIT(&pool->cache);
+	}
 }
 
 static int
@@ -405,34 +800,30 @@ iobuf_channel_node_populate(struct spdk_iobuf_channel *ch, const char *name, int
 {
 	struct iobuf_node *node = &g_iobuf.node[numa_id];
 	struct spdk_iobuf_node_cache *cache = &ch->cache[numa_id];
-	uint32_t small_cache_size = cache->small.cache_size;
-	uint32_t large_cache_size = cache->large.cache_size;
+	struct spdk_iobuf_pool_cache *pool;
 	struct spdk_iobuf_buffer *buf;
-	uint32_t i;
+	uint32_t i, class;
 
-	for (i = 0; i < small_cache_size; ++i) {
-		if (spdk_ring_dequeue(node->small_pool, (void **)&buf, 1) == 0) {
-			SPDK_ERRLOG("Failed to populate '%s' iobuf small buffer cache at %d/%d entries. "
-				    "You may need to increase spdk_iobuf_opts.small_pool_count (%"PRIu64")\n",
-				    name, i, small_cache_size, g_iobuf.opts.small_pool_count);
-			SPDK_ERRLOG("See scripts/calc-iobuf.py for guidance on how to calculate "
-				    "this value.\n");
-			return -ENOMEM;
+	for (class = 0; class < iobuf_num_classes(); ++class) {
+		/* Only the small and large caches are filled up front, the others fill up on release */
+		if (class != 0 && class <= g_iobuf.num_mid_classes) {
+			continue;
 		}
-		STAILQ_INSERT_TAIL(&cache->small.cache, buf, stailq);
-		cache->small.cache_count++;
-	}
-	for (i = 0; i < large_cache_size; ++i) {
-		if (spdk_ring_dequeue(node->large_pool, (void **)&buf, 1) == 0) {
-			SPDK_ERRLOG("Failed to populate '%s' iobuf large buffer cache at %d/%d entries. "
-				    "You may need to increase spdk_iobuf_opts.large_pool_count (%"PRIu64")\n",
-				    name, i, large_cache_size, g_iobuf.opts.large_pool_count);
-			SPDK_ERRLOG("See scripts/calc-iobuf.py for guidance on how to calculate "
-				    "this value.\n");
-			return -ENOMEM;
+
+		pool = iobuf_node_cache_get_class(cache, class);
+		for (i = 0; i < pool->cache_size; ++i) {
+			if (iobuf_pool_dequeue(&node->pools[class], (void **)&buf, 1) == 0) {
+				SPDK_ERRLOG("Failed to populate '%s' iobuf %s buffer cache at %d/%d entries. "
+					    "You may need to increase spdk_iobuf_opts.%s_pool_count (%"PRIu64")\n",
+					    name, iobuf_class_name(class), i, pool->cache_size,
+					    iobuf_class_name(class), node->pools[class].max_count);
+				SPDK_ERRLOG("See scripts/calc-iobuf.py for guidance on how to calculate "
+					    "this value.\n");
+				return -ENOMEM;
+			}
+			STAILQ_INSERT_TAIL(&pool->cache, buf, stailq);
+			pool->cache_count++;
 		}
-		STAILQ_INSERT_TAIL(&cache->large.cache, buf, stailq);
-		cache->large.cache_count++;
 	}
 
 	return 0;
@@ -483,6 +874,7 @@ spdk_iobuf_channel_init(struct spdk_iobuf_channel *ch, const char *name,
 
 	ch->parent = ioch;
 	ch->module = module;
+	memset(ch->wait_hist, 0, sizeof(ch->wait_hist));
 
 	IOBUF_FOREACH_NUMA_ID(numa_id) {
 		iobuf_channel_node_init(ch, iobuf_ch, numa_id,
@@ -507,34 +899,29 @@ static void
 iobuf_channel_node_fini(struct spdk_iobuf_channel *ch, int32_t numa_id)
 {
 	struct spdk_iobuf_node_cache *cache = &ch->cache[numa_id];
-	struct iobuf_node *node = &g_iobuf.node[numa_id];
 	struct spdk_iobuf_entry *entry __attribute__((unused));
+	struct spdk_iobuf_pool_cache *pool;
 	struct spdk_iobuf_buffer *buf;
+	uint32_t class;
 
-	/* Make sure none of the wait queue entries are coming from this module */
-	STAILQ_FOREACH(entry, cache->small.queue, stailq) {
-		assert(entry->module != ch->module);
-	}
-	STAILQ_FOREACH(entry, cache->large.queue, stailq) {
-		assert(entry->module != ch->module);
-	}
+	for (class = 0; class < iobuf_num_classes(); ++class) {
+		pool = iobuf_node_cache_get_class(cache, class);
 
-	/* Release cached buffers back to the pool */
-	while (!STAILQ_EMPTY(&cache->small.cache)) {
-		buf = STAILQ_FIRST(&cache->small.cache);
-		STAILQ_REMOVE_HEAD(&cache->small.cache, stailq);
-		spdk_ring_enqueue(node->small_pool, (void **)&buf, 1, NULL);
-		cache->small.cache_count--;
-	}
-	while (!STAILQ_EMPTY(&cache->large.cache)) {
-		buf = STAILQ_FIRST(&cache->large.cache);
-		STAILQ_REMOVE_HEAD(&cache->large.cache, stailq);
-		spdk_ring_enqueue(node->large_pool, (void **)&buf, 1, NULL);
-		cache->large.cache_count--;
-	}
+		/* Make sure none of the wait queue entries are coming from this module */
+		STAILQ_FOREACH(entry, pool->queue, stailq) {
+			assert(entry->module != ch->module);
+		}
 
-	assert(cache->small.cache_count == 0);
-	assert(cache->large.cache_count == 0);
+		/* Release cached buffers back to the pool */
+		while (!STAILQ_EMPTY(&pool->cache)) {
+			buf = STAILQ_FIRST(&pool->cache);
+			STAILQ_REMOVE_HEAD(&pool->cache, stailq);
+			spdk_ring_enqueue(pool->pool, (void **)&buf, 1, NULL);
+			pool->cache_count--;
+		}
+
+		assert(pool->cache_count == 0);
+	}
 }
 
 void
@@ -630,19 +1017,18 @@ spdk_iobuf_for_each_entry(struct spdk_iobuf_channel *ch,
 			  spdk_iobuf_for_each_entry_fn cb_fn, void *cb_ctx)
 {
 	struct spdk_iobuf_node_cache *cache;
-	uint32_t i;
+	uint32_t i, class;
 	int rc;
 
 	IOBUF_FOREACH_NUMA_ID(i) {
 		cache = &ch->cache[i];
 
-		rc = iobuf_pool_for_each_entry(ch, &cache->small, cb_fn, cb_ctx);
-		if (rc != 0) {
-			return rc;
-		}
-		rc = iobuf_pool_for_each_entry(ch, &cache->large, cb_fn, cb_ctx);
-		if (rc != 0) {
-			return rc;
+		for (class = 0; class < iobuf_num_classes(); ++class) {
+			rc = iobuf_pool_for_each_entry(ch, iobuf_node_cache_get_class(cache, class),
+						       cb_fn, cb_ctx);
+			if (rc != 0) {
+				return rc;
+			}
 		}
 	}
 
@@ -658,17 +1044,15 @@ iobuf_entry_abort_node(struct spdk_iobuf_channel *ch, int32_t numa_id,
 	struct spdk_iobuf_entry *e;
 
 	cache = &ch->cache[numa_id];
-
-	if (len <= cache->small.bufsize) {
-		pool = &cache->small;
-	} else {
-		assert(len <= cache->large.bufsize);
-		pool = &cache->large;
-	}
+	pool = iobuf_node_cache_get_pool(cache, len);
 
 	STAILQ_FOREACH(e, pool->queue, stailq) {
 		if (e == entry) {
 			STAILQ_REMOVE(pool->queue, entry, spdk_iobuf_entry, stailq);
+			if (STAILQ_EMPTY(pool->queue)) {
+				iobuf_channel_stop_waiting(spdk_io_channel_get_ctx(ch->parent),
+							   pool->waiting_threads);
+			}
 			return true;
 		}
 	}
@@ -689,23 +1073,55 @@ spdk_iobuf_entry_abort(struct spdk_iobuf_channel *ch, struct spdk_iobuf_entry *e
 
 #define IOBUF_BATCH_SIZE 32
 
+/* Pick the pools of the NUMA node the calling thread is running on */
+static inline int32_t
+iobuf_get_local_numa_id(void)
+{
+	int32_t numa_id;
+
+	if (!g_iobuf.opts.enable_numa) {
+		return 0;
+	}
+
+	numa_id = spdk_env_get_numa_id(spdk_env_get_current_core());
+	if (spdk_unlikely(numa_id < 0 || numa_id >= SPDK_CONFIG_MAX_NUMA_NODES ||
+			  g_iobuf.node[numa_id].pools[0].ring == NULL)) {
+		return spdk_env_get_first_numa_id();
+	}
+
+	return numa_id;
+}
+
+static void
+iobuf_node_request_grow(int32_t numa_id, struct spdk_iobuf_pool_cache *cache)
+{
+	struct iobuf_node *node = &g_iobuf.node[numa_id];
+	uint32_t class;
+
+	for (class = 0; class < iobuf_num_classes(); ++class) {
+		if (node->pools[class].ring == cache->pool) {
+			iobuf_pool_request_grow(&node->pools[class]);
+			return;
+		}
+	}
+
+	assert(0);
+}
+
 void *
 spdk_iobuf_get(struct spdk_iobuf_channel *ch, uint64_t len,
 	       struct spdk_iobuf_entry *entry, spdk_iobuf_get_cb cb_fn)
 {
 	struct spdk_iobuf_node_cache *cache;
 	struct spdk_iobuf_pool_cache *pool;
+	int32_t numa_id;
 	void *buf;
 
-	cache = &ch->cache[0];
+	numa_id = iobuf_get_local_numa_id();
+	cache = &ch->cache[numa_id];
 
 	assert(spdk_io_channel_get_thread(ch->parent) == spdk_get_thread());
-	if (len <= cache->small.bufsize) {
-		pool = &cache->small;
-	} else {
-		assert(len <= cache->large.bufsize);
-		pool = &cache->large;
-	}
+	pool = iobuf_node_cache_get_pool(cache, len);
 
 	buf = (void *)STAILQ_FIRST(&pool->cache);
 	if (buf) {
@@ -715,16 +1131,31 @@ spdk_iobuf_get(struct spdk_iobuf_channel *ch, uint64_t len,
 		pool->stats.cache++;
 	} else {
 		struct spdk_iobuf_buffer *bufs[IOBUF_BATCH_SIZE];
-		size_t sz, i;
-
-		/* If we're going to dequeue, we may as well dequeue a batch. */
-		sz = spdk_ring_dequeue(pool->pool, (void **)bufs, spdk_min(IOBUF_BATCH_SIZE,
-				       spdk_max(pool->cache_size, 1)));
+		size_t sz, i, count;
+
+		/* If we're going to dequeue, we may as well dequeue a batch, unless requests are
+		 * already waiting for buffers of this pool. */
+		if (spdk_likely(__atomic_load_n(pool->waiting_threads, __ATOMIC_RELAXED) == 0)) {
+			count = spdk_min(IOBUF_BATCH_SIZE, spdk_max(pool->cache_size, 1));
+		} else {
+			count = 1;
+		}
+		sz = spdk_ring_dequeue(pool->pool, (void **)bufs, count);
+		if (g_iobuf.opts.slab_size != 0) {
+			/* The pool may not have reached its maximum size yet */
+			iobuf_node_request_grow(numa_id, pool);
+		}
 		if (sz == 0) {
 			if (entry) {
+				if (STAILQ_EMPTY(pool->queue)) {
+					iobuf_channel_start_waiting(spdk_io_channel_get_ctx(ch->parent),
+								    pool->waiting_threads);
+				}
 				STAILQ_INSERT_TAIL(pool->queue, entry, stailq);
 				entry->module = ch->module;
 				entry->cb_fn = cb_fn;
+				entry->ch = ch;
+				entry->wait_tsc = spdk_get_ticks();
 				pool->stats.retry++;
 			}
 
@@ -744,10 +1175,29 @@ spdk_iobuf_get(struct spdk_iobuf_channel *ch, uint64_t len,
 	return (char *)buf;
 }
 
+/*
+ * Return a buffer to the shared pool, along with the buffers cached beyond the cache size, for
+ * the requests waiting on other threads.
+ */
+static void
+iobuf_pool_cache_release(struct spdk_iobuf_pool_cache *pool, void *buf)
+{
+	struct spdk_iobuf_buffer *bufs[IOBUF_BATCH_SIZE];
+	size_t sz = 0;
+
+	bufs[sz++] = buf;
+	while (pool->cache_count > pool->cache_size && sz < IOBUF_BATCH_SIZE) {
+		bufs[sz++] = STAILQ_FIRST(&pool->cache);
+		STAILQ_REMOVE_HEAD(&pool->cache, stailq);
+		pool->cache_count--;
+	}
+
+	spdk_ring_enqueue(pool->pool, (void **)bufs, sz, NULL);
+}
+
 void
 spdk_iobuf_put(struct spdk_iobuf_channel *ch, void *buf, uint64_t len)
 {
-	struct spdk_iobuf_entry *entry;
 	struct spdk_iobuf_buffer *iobuf_buf;
 	struct spdk_iobuf_node_cache *cache;
 	struct spdk_iobuf_pool_cache *pool;
@@ -763,11 +1213,7 @@ spdk_iobuf_put(struct spdk_iobuf_channel *ch, void *buf, uint64_t len)
 	cache = &ch->cache[numa_id];
 
 	assert(spdk_io_channel_get_thread(ch->parent) == spdk_get_thread());
-	if (len <= cache->small.bufsize) {
-		pool = &cache->small;
-	} else {
-		pool = &cache->large;
-	}
+	pool = iobuf_node_cache_get_pool(cache, len);
 
 	if (STAILQ_EMPTY(pool->queue)) {
 		if (pool->cache_size == 0) {
@@ -775,6 +1221,14 @@ spdk_iobuf_put(struct spdk_iobuf_channel *ch, void *buf, uint64_t len)
 			return;
 		}
 
+		/* Keep the buffers guaranteed by the cache size and give the rest to the other
+		 * threads if they're waiting for them. */
+		if (spdk_unlikely(__atomic_load_n(pool->waiting_threads, __ATOMIC_RELAXED) > 0) &&
+		    pool->cache_count >= pool->cache_size) {
+			iobuf_pool_cache_release(pool, buf);
+			return;
+		}
+
 		iobuf_buf = (struct spdk_iobuf_buffer *)buf;
 
 		STAILQ_INSERT_HEAD(&pool->cache, iobuf_buf, stailq);
@@ -798,13 +1252,8 @@ spdk_iobuf_put(struct spdk_iobuf_channel *ch, void *buf, uint64_t len)
 			spdk_ring_enqueue(pool->pool, (void **)bufs, sz, NULL);
 		}
 	} else {
-		entry = STAILQ_FIRST(pool->queue);
-		STAILQ_REMOVE_HEAD(pool->queue, stailq);
-		entry->cb_fn(entry, buf);
-		if (spdk_unlikely(entry == STAILQ_LAST(pool->queue, spdk_iobuf_entry, stailq))) {
-			STAILQ_REMOVE(pool->queue, entry, spdk_iobuf_entry, stailq);
-			STAILQ_INSERT_HEAD(pool->queue, entry, stailq);
-		}
+		iobuf_queue_handoff(spdk_io_channel_get_ctx(ch->parent), pool->queue,
+				    pool->waiting_threads, buf);
 	}
 }
 
@@ -840,7 +1289,11 @@ iobuf_get_channel_stats(struct spdk_io_channel_iter *iter)
 			module = (struct iobuf_module *)channel->module;
 			if (strcmp(it->module, module->name) == 0) {
 				struct spdk_iobuf_pool_cache *cache;
-				uint32_t i;
+				uint32_t i, k;
+
+				for (k = 0; k < SPDK_IOBUF_WAIT_HIST_BUCKETS; ++k) {
+					it->wait_hist[k] += channel->wait_hist[k];
+				}
 
 				IOBUF_FOREACH_NUMA_ID(i) {
 					cache = &channel->cache[i].small;
@@ -852,6 +1305,13 @@ iobuf_get_channel_stats(struct spdk_io_channel_iter *iter)
 					it->large_pool.cache += cache->stats.cache;
 					it->large_pool.main += cache->stats.main;
 					it->large_pool.retry += cache->stats.retry;
+
+					for (k = 0; k < g_iobuf.num_mid_classes; ++k) {
+						cache = &channel->cache[i].mid[k];
+						it->mid_pool[k].cache += cache->stats.cache;
+						it->mid_pool[k].main += cache->stats.main;
+						it->mid_pool[k].retry += cache->stats.retry;
+					}
 				}
 				break;
 			}
@@ -36,6 +36,24 @@
 #define SPDK_THREAD_EXIT_TIMEOUT_SEC	5
 #define SPDK_MAX_POLLER_NAME_LEN	256
 #define SPDK_MAX_THREAD_NAME_LEN	256
+#define SPDK_IO_CHANNEL_HASH_SIZE	64
+#define SPDK_MSG_OUTBOX_COUNT		4
+#define SPDK_MSG_OUTBOX_DEPTH		32
+#define SPDK_THREAD_MSG_STATS_SIZE	128
+#define SPDK_THREAD_CYCLE_SAMPLE_RATE	16
+
+/*
+ * Timing wheel geometry.  Each level of the wheel has 64 slots, a slot of level N covering
+ * 64^N time units.  Six levels cover 2^36 units, i.e. roughly 10 to 19 hours depending on the
+ * tick rate, later timers are put on the overflow list.
+ */
+#define TIMER_WHEEL_BITS		6
+#define TIMER_WHEEL_SLOTS		(1U << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_SLOT_MASK		(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS		6
+#define TIMER_WHEEL_OVERFLOW		(TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)
+#define TIMER_WHEEL_EXPIRED		(TIMER_WHEEL_OVERFLOW + 1)
+#define TIMER_WHEEL_NUM_LISTS		(TIMER_WHEEL_EXPIRED + 1)
 
 static struct spdk_thread *g_app_thread;
 
@@ -80,6 +98,9 @@ struct spdk_poller {
 	uint64_t			next_run_tick;
 	uint64_t			run_count;
 	uint64_t			busy_count;
+	/* Cycles spent in fn, estimated from the sampled runs */
+	uint64_t			tsc;
+	uint32_t			sample_countdown;
 	uint64_t			id;
 	spdk_poller_fn			fn;
 	void				*arg;
@@ -88,9 +109,32 @@ struct spdk_poller {
 	spdk_poller_set_interrupt_mode_cb set_intr_cb_fn;
 	void				*set_intr_cb_arg;
 
+	/* Index of the timing wheel list holding the poller. */
+	uint16_t			timer_list;
+
 	char				name[SPDK_MAX_POLLER_NAME_LEN + 1];
 };
 
+/*
+ * Hierarchical timing wheel holding the timed pollers of a thread, as an alternative to the
+ * red-black tree.  Timers are kept in time units of 2^shift ticks, the largest power of two
+ * not exceeding a microsecond.  Insertion and removal are O(1), while expiring
+ * a timer moves it at most once per level, towards the lower levels.
+ */
+struct timer_wheel {
+	/* Last processed time unit */
+	uint64_t				now;
+	uint64_t				count;
+	uint32_t				shift;
+	/* Bitmaps of non-empty slots of each level */
+	uint64_t				occupied[TIMER_WHEEL_LEVELS];
+	/*
+	 * Slots of all levels, followed by the overflow list and the list of pollers which
+	 * expired and are about to be executed.  Pollers are linked through their tailq.
+	 */
+	TAILQ_HEAD(timer_wheel_list, spdk_poller) lists[TIMER_WHEEL_NUM_LISTS];
+};
+
 enum spdk_thread_state {
 	/* The thread is processing poller and message by spdk_thread_poll(). */
 	SPDK_THREAD_STATE_RUNNING,
@@ -111,6 +155,20 @@ struct spdk_thread_post_poller_handler {
 
 #define SPDK_THREAD_MAX_POST_POLLER_HANDLERS (4)
 
+/* Number of runs and cycles spent in a message function, estimated from the sampled runs. */
+struct msg_fn_stats {
+	spdk_msg_fn			fn;
+	uint64_t			count;
+	uint64_t			tsc;
+};
+
+/* Messages posted to a thread, waiting to be enqueued together. */
+struct msg_outbox {
+	struct spdk_thread		*thread;
+	uint32_t			count;
+	struct spdk_msg			*msgs[SPDK_MSG_OUTBOX_DEPTH];
+};
+
 struct spdk_thread {
 	uint64_t			tsc_last;
 	struct spdk_thread_stats	stats;
@@ -126,6 +184,11 @@ struct spdk_thread {
 	 */
 	RB_HEAD(timed_pollers_tree, spdk_poller)	timed_pollers;
 	struct spdk_poller				*first_timed_poller;
+	/*
+	 * Replaces the timed_pollers tree if the timing wheel was selected by
+	 * spdk_thread_lib_set_timer_type().
+	 */
+	struct timer_wheel				*timer_wheel;
 	/*
 	 * Contains paused pollers.  Pollers on this queue are waiting until
 	 * they are resumed (in which case they're put onto the active/timer
@@ -138,6 +201,14 @@ struct spdk_thread {
 	int				msg_fd;
 	SLIST_HEAD(, spdk_msg)		msg_cache;
 	size_t				msg_cache_count;
+	/* Outboxes of spdk_thread_post_msg(), each one holding messages for one thread. */
+	struct msg_outbox		outboxes[SPDK_MSG_OUTBOX_COUNT];
+	uint32_t			outbox_count;
+	/* Number of outboxes of other threads holding messages for this thread. */
+	uint32_t			outbox_pending;
+	/* Open addressing hash table of the message functions, allocated on the first sample. */
+	struct msg_fn_stats		*msg_stats;
+	uint32_t			msg_sample_countdown;
 	spdk_msg_fn			critical_msg;
 	uint64_t			id;
 	uint64_t			next_poller_id;
@@ -145,7 +216,17 @@ struct spdk_thread {
 	int				pending_unregister_count;
 	uint32_t			for_each_count;
 
-	RB_HEAD(io_channel_tree, spdk_io_channel)	io_channels;
+	/* Channels of this thread, in the order they were created. */
+	TAILQ_HEAD(, spdk_io_channel)			io_channels;
+	/*
+	 * Hash table of the channels, keyed by io_device.  It's only modified by the thread
+	 * itself, under io_channels_lock, so the thread looks up its own channels without
+	 * taking any lock.  Other threads take the lock to look them up.
+	 */
+	struct spdk_io_channel				**io_channel_hash;
+	uint32_t					io_channel_hash_size;
+	uint32_t					io_channel_count;
+	pthread_spinlock_t				io_channels_lock;
 	TAILQ_ENTRY(spdk_thread)			tailq;
 
 	char				name[SPDK_MAX_THREAD_NAME_LEN + 1];
@@ -164,7 +245,7 @@ struct spdk_thread {
 
 	uint16_t			trace_id;
 
-	uint8_t				reserved[6];
+	uint8_t				reserved[2];
 
 	/* User context allocated at the end */
 	uint8_t				ctx[0];
@@ -187,6 +268,8 @@ static size_t g_ctx_sz = 0;
  * SPDK application is required.
  */
 static uint64_t g_thread_id = 1;
+/* One out of this many runs of each poller and of the messages of each thread is timed. */
+static uint32_t g_cycle_sample_rate = SPDK_THREAD_CYCLE_SAMPLE_RATE;
 
 enum spin_error {
 	SPIN_ERR_NONE,
@@ -268,13 +351,28 @@ struct io_device {
 	uint32_t			for_each_count;
 	RB_ENTRY(io_device)		node;
 
+	/*
+	 * Number of channels of the device, IO_DEVICE_UNREGISTERED is set once the device is
+	 * unregistered.  It's updated atomically, so that channels are created and released
+	 * without taking any global lock, and whoever drops it to IO_DEVICE_UNREGISTERED frees
+	 * the device.
+	 */
 	uint32_t			refcnt;
 
 	bool				pending_unregister;
 	bool				unregistered;
 };
 
+#define IO_DEVICE_UNREGISTERED		(1U << 31)
+
+/*
+ * The io_devices are looked up whenever a thread creates its first channel for them, which
+ * is far more frequent than registering and unregistering them, so the tree is protected by
+ * a read-write lock, allowing the threads to look it up concurrently.  Lock ordering is
+ * g_devlist_mutex, then g_io_devices_lock, then io_channels_lock of the threads.
+ */
 static RB_HEAD(io_device_tree, io_device) g_io_devices = RB_INITIALIZER(g_io_devices);
+static pthread_rwlock_t g_io_devices_lock = PTHREAD_RWLOCK_INITIALIZER;
 
 static int
 io_device_cmp(struct io_device *dev1, struct io_device *dev2)
@@ -284,14 +382,12 @@ io_device_cmp(struct io_device *dev1, struct io_device *dev2)
 
 RB_GENERATE_STATIC(io_device_tree, io_device, node, io_device_cmp);
 
-static int
-io_channel_cmp(struct spdk_io_channel *ch1, struct spdk_io_channel *ch2)
+static inline uint32_t
+ptr_hash(const void *ptr, uint32_t size)
 {
-	return (ch1->dev < ch2->dev ? -1 : ch1->dev > ch2->dev);
+	return (uint32_t)(((uintptr_t)ptr * 0x9E3779B97F4A7C15ULL) >> 32) & (size - 1);
 }
 
-RB_GENERATE_STATIC(io_channel_tree, spdk_io_channel, node, io_channel_cmp);
-
 struct spdk_msg {
 	spdk_msg_fn		fn;
 	void			*arg;
@@ -303,6 +399,7 @@ static struct spdk_mempool *g_spdk_msg_mempool = NULL;
 
 static TAILQ_HEAD(, spdk_thread) g_threads = TAILQ_HEAD_INITIALIZER(g_threads);
 static uint32_t g_thread_count = 0;
+static enum spdk_thread_timer_type g_timer_type = SPDK_THREAD_TIMER_RBTREE;
 
 static __thread struct spdk_thread *tls_thread = NULL;
 
@@ -350,6 +447,223 @@ timed_poller_compare(struct spdk_poller *poller1, struct spdk_poller *poller2)
 
 RB_GENERATE_STATIC(timed_pollers_tree, spdk_poller, node, timed_poller_compare);
 
+static struct timer_wheel *
+timer_wheel_create(uint64_t now)
+{
+	struct timer_wheel *wheel;
+	uint64_t unit = 1;
+	uint32_t i;
+
+	wheel = calloc(1, sizeof(*wheel));
+	if (wheel == NULL) {
+		return NULL;
+	}
+
+	while (unit * 2 * SPDK_SEC_TO_USEC <= spdk_get_ticks_hz()) {
+		unit <<= 1;
+		wheel->shift++;
+	}
+
+	for (i = 0; i < TIMER_WHEEL_NUM_LISTS; i++) {
+		TAILQ_INIT(&wheel->lists[i]);
+	}
+
+	wheel->now = now >> wheel->shift;
+
+	return wheel;
+}
+
+static void
+timer_wheel_add(struct timer_wheel *wheel, struct spdk_poller *poller, uint64_t expire)
+{
+	uint64_t delta;
+	uint32_t level, slot;
+
+	if (expire <= wheel->now) {
+		poller->timer_list = TIMER_WHEEL_EXPIRED;
+	} else {
+		delta = expire - wheel->now;
+		for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+			if (delta < (1ULL << ((level + 1) * TIMER_WHEEL_BITS))) {
+				break;
+			}
+		}
+
+		if (level == TIMER_WHEEL_LEVELS) {
+			poller->timer_list = TIMER_WHEEL_OVERFLOW;
+		} else {
+			slot = (expire >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_SLOT_MASK;
+			wheel->occupied[level] |= 1ULL << slot;
+			poller->timer_list = level * TIMER_WHEEL_SLOTS + slot;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&wheel->lists[poller->timer_list], poller, tailq);
+}
+
+static inline void
+timer_wheel_insert(struct timer_wheel *wheel, struct spdk_poller *poller)
+{
+	uint64_t expire;
+
+	/* Round up, so that the poller never runs before its next_run_tick.  The poller can't
+	 * expire before the next unit either, so that pollers rescheduled while the wheel is being
+	 * processed don't run again within the same poll.
+	 */
+	expire = (poller->next_run_tick + (1ULL << wheel->shift) - 1) >> wheel->shift;
+	expire = spdk_max(expire, wheel->now + 1);
+
+	timer_wheel_add(wheel, poller, expire);
+	wheel->count++;
+}
+
+static inline void
+timer_wheel_remove(struct timer_wheel *wheel, struct spdk_poller *poller)
+{
+	uint32_t list = poller->timer_list;
+
+	TAILQ_REMOVE(&wheel->lists[list], poller, tailq);
+	if (list < TIMER_WHEEL_OVERFLOW && TAILQ_EMPTY(&wheel->lists[list])) {
+		wheel->occupied[list / TIMER_WHEEL_SLOTS] &= ~(1ULL << (list % TIMER_WHEEL_SLOTS));
+	}
+
+	assert(wheel->count > 0);
+	wheel->count--;
+}
+
+/*
+ * Return the next time unit at which a slot of the wheel needs to be processed, or UINT64_MAX
+ * if the wheel doesn't hold any timers.  The slots of the upper levels are processed when their
+ * timers need to be moved to the lower levels, so it may be earlier than the next expiration.
+ */
+static uint64_t
+timer_wheel_next(struct timer_wheel *wheel)
+{
+	uint64_t next = UINT64_MAX, start, occupied;
+	uint32_t level, shift, slot;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		occupied = wheel->occupied[level];
+		if (occupied == 0) {
+			continue;
+		}
+
+		shift = level * TIMER_WHEEL_BITS;
+		start = (wheel->now >> shift) + 1;
+		slot = start & TIMER_WHEEL_SLOT_MASK;
+		/* Rotate the bitmap, so that bit 0 is the first slot to be processed */
+		if (slot != 0) {
+			occupied = (occupied >> slot) | (occupied << (TIMER_WHEEL_SLOTS - slot));
+		}
+		next = spdk_min(next, (start + __builtin_ctzll(occupied)) << shift);
+	}
+
+	if (!TAILQ_EMPTY(&wheel->lists[TIMER_WHEEL_OVERFLOW])) {
+		shift = TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS;
+		next = spdk_min(next, ((wheel->now >> shift) + 1) << shift);
+	}
+
+	return next;
+}
+
+static void
+timer_wheel_cascade(struct timer_wheel *wheel, uint32_t list)
+{
+	struct timer_wheel_list tmp;
+	struct spdk_poller *poller;
+
+	if (TAILQ_EMPTY(&wheel->lists[list])) {
+		return;
+	}
+
+	TAILQ_INIT(&tmp);
+	TAILQ_SWAP(&tmp, &wheel->lists[list], spdk_poller, tailq);
+	if (list < TIMER_WHEEL_OVERFLOW) {
+		wheel->occupied[list / TIMER_WHEEL_SLOTS] &= ~(1ULL << (list % TIMER_WHEEL_SLOTS));
+	}
+
+	while ((poller = TAILQ_FIRST(&tmp)) != NULL) {
+		TAILQ_REMOVE(&tmp, poller, tailq);
+		timer_wheel_add(wheel, poller,
+				(poller->next_run_tick + (1ULL << wheel->shift) - 1) >> wheel->shift);
+	}
+}
+
+/*
+ * Advance the wheel up to the time unit including now_tick and move all of the pollers which
+ * expired by then to the expired list.
+ */
+static void
+timer_wheel_advance(struct timer_wheel *wheel, uint64_t now_tick)
+{
+	uint64_t target = now_tick >> wheel->shift, next;
+	uint32_t level, shift;
+
+	while ((next = timer_wheel_next(wheel)) <= target) {
+		wheel->now = next;
+
+		shift = TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS;
+		if ((next & ((1ULL << shift) - 1)) == 0) {
+			timer_wheel_cascade(wheel, TIMER_WHEEL_OVERFLOW);
+		}
+
+		for (level = TIMER_WHEEL_LEVELS; level-- > 0;) {
+			shift = level * TIMER_WHEEL_BITS;
+			if ((next & ((1ULL << shift) - 1)) != 0) {
+				continue;
+			}
+			timer_wheel_cascade(wheel, level * TIMER_WHEEL_SLOTS +
+					    ((next >> shift) & TIMER_WHEEL_SLOT_MASK));
+		}
+	}
+
+	if (wheel->now < target) {
+		wheel->now = target;
+	}
+}
+
+static struct spdk_poller *
+timer_wheel_first(struct timer_wheel *wheel, uint32_t list)
+{
+	struct spdk_poller *poller;
+
+	for (; list < TIMER_WHEEL_NUM_LISTS; list++) {
+		poller = TAILQ_FIRST(&wheel->lists[list]);
+		if (poller != NULL) {
+			return poller;
+		}
+	}
+
+	return NULL;
+}
+
+static inline struct spdk_poller *
+timed_poller_first(struct spdk_thread *thread)
+{
+	if (thread->timer_wheel != NULL) {
+		return timer_wheel_first(thread->timer_wheel, 0);
+	}
+
+	return RB_MIN(timed_pollers_tree, &thread->timed_pollers);
+}
+
+static inline struct spdk_poller *
+timed_poller_next(struct spdk_thread *thread, struct spdk_poller *poller)
+{
+	struct spdk_poller *next;
+
+	if (thread->timer_wheel != NULL) {
+		next = TAILQ_NEXT(poller, tailq);
+		if (next != NULL) {
+			return next;
+		}
+
+		return timer_wheel_first(thread->timer_wheel, poller->timer_list + 1);
+	}
+
+	return RB_NEXT(timed_pollers_tree, &thread->timed_pollers, poller);
+}
+
 static inline struct spdk_thread *
 _get_thread(void)
 {
@@ -382,6 +696,8 @@ _thread_lib_init(size_t ctx_sz, size_t msg_mempool_sz)
 
 static void thread_interrupt_destroy(struct spdk_thread *thread);
 static int thread_interrupt_create(struct spdk_thread *thread);
+static void thread_flush_outboxes(struct spdk_thread *thread);
+static void thread_drop_outboxes(struct spdk_thread *thread);
 
 static void
 _free_thread(struct spdk_thread *thread)
@@ -390,7 +706,7 @@ _free_thread(struct spdk_thread *thread)
 	struct spdk_msg *msg;
 	struct spdk_poller *poller, *ptmp;
 
-	RB_FOREACH(ch, io_channel_tree, &thread->io_channels) {
+	TAILQ_FOREACH(ch, &thread->io_channels, tailq) {
 		SPDK_ERRLOG("thread %s still has channel for io_device %s\n",
 			    thread->name, ch->dev->name);
 	}
@@ -404,14 +720,20 @@ _free_thread(struct spdk_thread *thread)
 		free(poller);
 	}
 
-	RB_FOREACH_SAFE(poller, timed_pollers_tree, &thread->timed_pollers, ptmp) {
+	for (poller = timed_poller_first(thread); poller != NULL; poller = ptmp) {
+		ptmp = timed_poller_next(thread, poller);
 		if (poller->state != SPDK_POLLER_STATE_UNREGISTERED) {
 			SPDK_WARNLOG("timed_poller %s still registered at thread exit\n",
 				     poller->name);
 		}
-		RB_REMOVE(timed_pollers_tree, &thread->timed_pollers, poller);
+		if (thread->timer_wheel != NULL) {
+			timer_wheel_remove(thread->timer_wheel, poller);
+		} else {
+			RB_REMOVE(timed_pollers_tree, &thread->timed_pollers, poller);
+		}
 		free(poller);
 	}
+	free(thread->timer_wheel);
 
 	TAILQ_FOREACH_SAFE(poller, &thread->paused_pollers, tailq, ptmp) {
 		SPDK_WARNLOG("paused_poller %s still registered at thread exit\n", poller->name);
@@ -438,11 +760,16 @@ _free_thread(struct spdk_thread *thread)
 
 	assert(thread->msg_cache_count == 0);
 
+	thread_drop_outboxes(thread);
+
 	if (spdk_interrupt_mode_is_enabled()) {
 		thread_interrupt_destroy(thread);
 	}
 
 	spdk_ring_free(thread->messages);
+	free(thread->msg_stats);
+	pthread_spin_destroy(&thread->io_channels_lock);
+	free(thread->io_channel_hash);
 	free(thread);
 }
 
@@ -485,6 +812,36 @@ spdk_thread_lib_init_ext(spdk_thread_op_fn thread_op_fn,
 	return _thread_lib_init(ctx_sz, msg_mempool_sz);
 }
 
+void
+spdk_thread_lib_set_cycle_sample_rate(uint32_t rate)
+{
+	g_cycle_sample_rate = rate;
+}
+
+int
+spdk_thread_lib_set_timer_type(enum spdk_thread_timer_type type)
+{
+	switch (type) {
+	case SPDK_THREAD_TIMER_RBTREE:
+	case SPDK_THREAD_TIMER_WHEEL:
+		break;
+	default:
+		SPDK_ERRLOG("Unknown timer type %d\n", type);
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&g_devlist_mutex);
+	if (!TAILQ_EMPTY(&g_threads)) {
+		pthread_mutex_unlock(&g_devlist_mutex);
+		SPDK_ERRLOG("Timer type can't be changed once threads are created\n");
+		return -EBUSY;
+	}
+	g_timer_type = type;
+	pthread_mutex_unlock(&g_devlist_mutex);
+
+	return 0;
+}
+
 void
 spdk_thread_lib_fini(void)
 {
@@ -498,6 +855,7 @@ spdk_thread_lib_fini(void)
 	g_thread_op_fn = NULL;
 	g_thread_op_supported_fn = NULL;
 	g_ctx_sz = 0;
+	g_timer_type = SPDK_THREAD_TIMER_RBTREE;
 	if (g_app_thread != NULL) {
 		_free_thread(g_app_thread);
 		g_app_thread = NULL;
@@ -532,7 +890,7 @@ spdk_thread_create(const char *name, const struct spdk_cpuset *cpumask)
 		spdk_cpuset_negate(&thread->cpumask);
 	}
 
-	RB_INIT(&thread->io_channels);
+	TAILQ_INIT(&thread->io_channels);
 	TAILQ_INIT(&thread->active_pollers);
 	RB_INIT(&thread->timed_pollers);
 	TAILQ_INIT(&thread->paused_pollers);
@@ -541,6 +899,25 @@ spdk_thread_create(const char *name, const struct spdk_cpuset *cpumask)
 
 	thread->tsc_last = spdk_get_ticks();
 
+	if (g_timer_type == SPDK_THREAD_TIMER_WHEEL) {
+		thread->timer_wheel = timer_wheel_create(thread->tsc_last);
+		if (!thread->timer_wheel) {
+			SPDK_ERRLOG("Unable to allocate memory for timing wheel\n");
+			free(thread);
+			return NULL;
+		}
+	}
+
+	thread->io_channel_hash = calloc(SPDK_IO_CHANNEL_HASH_SIZE, sizeof(*thread->io_channel_hash));
+	if (!thread->io_channel_hash) {
+		SPDK_ERRLOG("Unable to allocate memory for io_channel hash table\n");
+		free(thread->timer_wheel);
+		free(thread);
+		return NULL;
+	}
+	thread->io_channel_hash_size = SPDK_IO_CHANNEL_HASH_SIZE;
+	pthread_spin_init(&thread->io_channels_lock, PTHREAD_PROCESS_PRIVATE);
+
 	/* Monotonic increasing ID is set to each created poller beginning at 1. Once the
 	 * ID exceeds UINT64_MAX a warning message is logged
 	 */
@@ -549,6 +926,9 @@ spdk_thread_create(const char *name, const struct spdk_cpuset *cpumask)
 	thread->messages = spdk_ring_create(SPDK_RING_TYPE_MP_SC, 65536, SPDK_ENV_NUMA_ID_ANY);
 	if (!thread->messages) {
 		SPDK_ERRLOG("Unable to allocate memory for message ring\n");
+		pthread_spin_destroy(&thread->io_channels_lock);
+		free(thread->io_channel_hash);
+		free(thread->timer_wheel);
 		free(thread);
 		return NULL;
 	}
@@ -666,7 +1046,8 @@ thread_exit(struct spdk_thread *thread, uint64_t now)
 		goto exited;
 	}
 
-	if (spdk_ring_count(thread->messages) > 0) {
+	if (spdk_ring_count(thread->messages) > 0 || thread->outbox_count > 0 ||
+	    __atomic_load_n(&thread->outbox_pending, __ATOMIC_SEQ_CST) > 0) {
 		SPDK_INFOLOG(thread, "thread %s still has messages\n", thread->name);
 		return;
 	}
@@ -686,7 +1067,8 @@ thread_exit(struct spdk_thread *thread, uint64_t now)
 		}
 	}
 
-	RB_FOREACH(poller, timed_pollers_tree, &thread->timed_pollers) {
+	for (poller = timed_poller_first(thread); poller != NULL;
+	     poller = timed_poller_next(thread, poller)) {
 		if (poller->state != SPDK_POLLER_STATE_UNREGISTERED) {
 			SPDK_INFOLOG(thread,
 				     "thread %s still has active timed poller %s\n",
@@ -702,7 +1084,7 @@ thread_exit(struct spdk_thread *thread, uint64_t now)
 		return;
 	}
 
-	RB_FOREACH(ch, io_channel_tree, &thread->io_channels) {
+	TAILQ_FOREACH(ch, &thread->io_channels, tailq) {
 		SPDK_INFOLOG(thread,
 			     "thread %s still has channel for io_device %s\n",
 			     thread->name, ch->dev->name);
@@ -838,6 +1220,89 @@ spdk_thread_get_from_ctx(void *ctx)
 	return SPDK_CONTAINEROF(ctx, struct spdk_thread, ctx);
 }
 
+/*
+ * Returns the number of runs represented by the current one if its cycles are to be
+ * measured, or 0 otherwise.
+ */
+static inline uint32_t
+thread_cycles_sample(uint32_t *countdown)
+{
+	if (spdk_likely(*countdown > 1)) {
+		(*countdown)--;
+		return 0;
+	}
+
+	*countdown = g_cycle_sample_rate;
+
+	return *countdown;
+}
+
+static struct msg_fn_stats *
+thread_get_msg_fn_stats(struct spdk_thread *thread, spdk_msg_fn fn)
+{
+	struct msg_fn_stats *stats;
+	uint32_t i, bucket;
+
+	if (spdk_unlikely(thread->msg_stats == NULL)) {
+		thread->msg_stats = calloc(SPDK_THREAD_MSG_STATS_SIZE, sizeof(*thread->msg_stats));
+		if (thread->msg_stats == NULL) {
+			return NULL;
+		}
+	}
+
+	bucket = ptr_hash((void *)fn, SPDK_THREAD_MSG_STATS_SIZE);
+	for (i = 0; i < SPDK_THREAD_MSG_STATS_SIZE; i++) {
+		stats = &thread->msg_stats[(bucket + i) & (SPDK_THREAD_MSG_STATS_SIZE - 1)];
+		if (stats->fn == fn) {
+			return stats;
+		}
+		if (stats->fn == NULL) {
+			stats->fn = fn;
+			return stats;
+		}
+	}
+
+	/* Too many different functions, stop accounting the new ones */
+	return NULL;
+}
+
+static void
+thread_run_msg_sampled(struct spdk_thread *thread, struct spdk_msg *msg, uint32_t weight)
+{
+	struct msg_fn_stats *stats;
+	spdk_msg_fn fn = msg->fn;
+	uint64_t tsc;
+
+	tsc = spdk_get_ticks();
+	fn(msg->arg);
+	tsc = spdk_get_ticks() - tsc;
+
+	stats = thread_get_msg_fn_stats(thread, fn);
+	if (stats != NULL) {
+		stats->count += weight;
+		stats->tsc += tsc * weight;
+	}
+}
+
+static inline int
+thread_run_poller_fn(struct spdk_poller *poller)
+{
+	uint32_t weight;
+	uint64_t tsc;
+	int rc;
+
+	weight = thread_cycles_sample(&poller->sample_countdown);
+	if (spdk_likely(weight == 0)) {
+		return poller->fn(poller->arg);
+	}
+
+	tsc = spdk_get_ticks();
+	rc = poller->fn(poller->arg);
+	poller->tsc += (spdk_get_ticks() - tsc) * weight;
+
+	return rc;
+}
+
 static inline uint32_t
 msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 {
@@ -875,12 +1340,18 @@ msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 
 	for (i = 0; i < count; i++) {
 		struct spdk_msg *msg = messages[i];
+		uint32_t weight;
 
 		assert(msg != NULL);
 
 		SPDK_DTRACE_PROBE2(msg_exec, msg->fn, msg->arg);
 
-		msg->fn(msg->arg);
+		weight = thread_cycles_sample(&thread->msg_sample_countdown);
+		if (spdk_likely(weight == 0)) {
+			msg->fn(msg->arg);
+		} else {
+			thread_run_msg_sampled(thread, msg, weight);
+		}
 
 		SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
 
@@ -904,6 +1375,11 @@ poller_insert_timer(struct spdk_thread *thread, struct spdk_poller *poller, uint
 
 	poller->next_run_tick = now + poller->period_ticks;
 
+	if (thread->timer_wheel != NULL) {
+		timer_wheel_insert(thread->timer_wheel, poller);
+		return;
+	}
+
 	/*
 	 * Insert poller in the thread's timed_pollers tree by next scheduled run time
 	 * as its key.
@@ -926,6 +1402,11 @@ poller_remove_timer(struct spdk_thread *thread, struct spdk_poller *poller)
 {
 	struct spdk_poller *tmp __attribute__((unused));
 
+	if (thread->timer_wheel != NULL) {
+		timer_wheel_remove(thread->timer_wheel, poller);
+		return;
+	}
+
 	tmp = RB_REMOVE(timed_pollers_tree, &thread->timed_pollers, poller);
 	assert(tmp != NULL);
 
@@ -985,7 +1466,7 @@ thread_execute_poller(struct spdk_thread *thread, struct spdk_poller *poller)
 	}
 
 	poller->state = SPDK_POLLER_STATE_RUNNING;
-	rc = poller->fn(poller->arg);
+	rc = thread_run_poller_fn(poller);
 
 	SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
 
@@ -1046,7 +1527,7 @@ thread_execute_timed_poller(struct spdk_thread *thread, struct spdk_poller *poll
 	}
 
 	poller->state = SPDK_POLLER_STATE_RUNNING;
-	rc = poller->fn(poller->arg);
+	rc = thread_run_poller_fn(poller);
 
 	SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
 
@@ -1101,6 +1582,27 @@ thread_run_pp_handlers(struct spdk_thread *thread)
 	thread->num_pp_handlers = 0;
 }
 
+static int
+thread_poll_timer_wheel(struct spdk_thread *thread, uint64_t now)
+{
+	struct timer_wheel *wheel = thread->timer_wheel;
+	struct spdk_poller *poller;
+	int rc = 0, timer_rc;
+
+	timer_wheel_advance(wheel, now);
+
+	while ((poller = TAILQ_FIRST(&wheel->lists[TIMER_WHEEL_EXPIRED])) != NULL) {
+		timer_wheel_remove(wheel, poller);
+
+		timer_rc = thread_execute_timed_poller(thread, poller, now);
+		if (timer_rc > rc) {
+			rc = timer_rc;
+		}
+	}
+
+	return rc;
+}
+
 static int
 thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 {
@@ -1136,6 +1638,19 @@ thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 		}
 	}
 
+	if (thread->timer_wheel != NULL) {
+		if (thread->timer_wheel->count > 0) {
+			int timer_rc;
+
+			timer_rc = thread_poll_timer_wheel(thread, now);
+			if (timer_rc > rc) {
+				rc = timer_rc;
+			}
+		}
+
+		return rc;
+	}
+
 	poller = thread->first_timed_poller;
 	while (poller != NULL) {
 		int timer_rc = 0;
@@ -1180,7 +1695,8 @@ _thread_remove_pollers(void *ctx)
 		}
 	}
 
-	RB_FOREACH_SAFE(poller, timed_pollers_tree, &thread->timed_pollers, tmp) {
+	for (poller = timed_poller_first(thread); poller != NULL; poller = tmp) {
+		tmp = timed_poller_next(thread, poller);
 		if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
 			poller_remove_timer(thread, poller);
 			free(poller);
@@ -1235,6 +1751,8 @@ spdk_thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 		rc = spdk_fd_group_wait(thread->fgrp, 0);
 	}
 
+	thread_flush_outboxes(thread);
+
 	thread_update_stats(thread, spdk_get_ticks(), now, rc);
 
 	tls_thread = orig_thread;
@@ -1246,6 +1764,20 @@ uint64_t
 spdk_thread_next_poller_expiration(struct spdk_thread *thread)
 {
 	struct spdk_poller *poller;
+	uint64_t next;
+
+	if (thread->timer_wheel != NULL) {
+		if (!TAILQ_EMPTY(&thread->timer_wheel->lists[TIMER_WHEEL_EXPIRED])) {
+			return thread->timer_wheel->now << thread->timer_wheel->shift;
+		}
+
+		next = timer_wheel_next(thread->timer_wheel);
+		if (next != UINT64_MAX) {
+			return next << thread->timer_wheel->shift;
+		}
+
+		return 0;
+	}
 
 	poller = thread->first_timed_poller;
 	if (poller) {
@@ -1265,7 +1797,8 @@ static bool
 thread_has_unpaused_pollers(struct spdk_thread *thread)
 {
 	if (TAILQ_EMPTY(&thread->active_pollers) &&
-	    RB_EMPTY(&thread->timed_pollers)) {
+	    RB_EMPTY(&thread->timed_pollers) &&
+	    (thread->timer_wheel == NULL || thread->timer_wheel->count == 0)) {
 		return false;
 	}
 
@@ -1399,6 +1932,146 @@ thread_send_msg_notification(const struct spdk_thread *target_thread)
 	return 0;
 }
 
+static int
+thread_get_msgs(struct spdk_thread *local_thread, struct spdk_msg **msgs, uint32_t count)
+{
+	uint32_t i = 0;
+
+	if (local_thread != NULL) {
+		while (i < count && local_thread->msg_cache_count > 0) {
+			msgs[i] = SLIST_FIRST(&local_thread->msg_cache);
+			assert(msgs[i] != NULL);
+			SLIST_REMOVE_HEAD(&local_thread->msg_cache, link);
+			local_thread->msg_cache_count--;
+			i++;
+		}
+	}
+
+	if (i < count) {
+		if (spdk_mempool_get_bulk(g_spdk_msg_mempool, (void **)&msgs[i], count - i) != 0) {
+			while (i > 0) {
+				spdk_mempool_put(g_spdk_msg_mempool, msgs[--i]);
+			}
+			SPDK_ERRLOG("msg could not be allocated\n");
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void
+thread_put_msgs(struct spdk_msg **msgs, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		spdk_mempool_put(g_spdk_msg_mempool, msgs[i]);
+	}
+}
+
+static int
+thread_enqueue_msgs(const struct spdk_thread *thread, struct spdk_msg **msgs, uint32_t count)
+{
+	if (spdk_ring_enqueue(thread->messages, (void **)msgs, count, NULL) != count) {
+		SPDK_ERRLOG("msg could not be enqueued\n");
+		thread_put_msgs(msgs, count);
+		return -EIO;
+	}
+
+	return thread_send_msg_notification(thread);
+}
+
+/*
+ * Enqueue the messages of an outbox.  If they don't fit in the queue of the target, they're kept
+ * in the outbox and retried by the next flush, so that the posted messages are never dropped.
+ */
+static int
+thread_flush_outbox(struct spdk_thread *thread, struct msg_outbox *outbox)
+{
+	struct spdk_thread *target = outbox->thread;
+
+	assert(outbox->count > 0);
+	if (spdk_ring_enqueue(target->messages, (void **)outbox->msgs, outbox->count,
+			      NULL) != outbox->count) {
+		SPDK_DEBUGLOG(thread, "Queue of thread %s is full, retrying %" PRIu32 " messages later\n",
+			      target->name, outbox->count);
+		return -EAGAIN;
+	}
+
+	thread_send_msg_notification(target);
+
+	/* Only release the target once the messages are in its queue, so that it can't exit before */
+	__atomic_fetch_sub(&target->outbox_pending, 1, __ATOMIC_SEQ_CST);
+
+	outbox->thread = NULL;
+	outbox->count = 0;
+	assert(thread->outbox_count > 0);
+	thread->outbox_count--;
+
+	return 0;
+}
+
+static void
+thread_flush_outboxes(struct spdk_thread *thread)
+{
+	uint32_t i;
+
+	if (spdk_likely(thread->outbox_count == 0)) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_MSG_OUTBOX_COUNT; i++) {
+		if (thread->outboxes[i].thread != NULL) {
+			thread_flush_outbox(thread, &thread->outboxes[i]);
+		}
+	}
+}
+
+/* Only called on a thread forced to exit before its outboxes could be flushed */
+static void
+thread_drop_outboxes(struct spdk_thread *thread)
+{
+	struct msg_outbox *outbox;
+	uint32_t i;
+
+	for (i = 0; i < SPDK_MSG_OUTBOX_COUNT && thread->outbox_count > 0; i++) {
+		outbox = &thread->outboxes[i];
+		if (outbox->thread == NULL) {
+			continue;
+		}
+
+		SPDK_ERRLOG("Dropped %" PRIu32 " messages posted to thread %s\n", outbox->count,
+			    outbox->thread->name);
+		thread_put_msgs(outbox->msgs, outbox->count);
+		__atomic_fetch_sub(&outbox->thread->outbox_pending, 1, __ATOMIC_SEQ_CST);
+		outbox->thread = NULL;
+		outbox->count = 0;
+		thread->outbox_count--;
+	}
+
+	assert(thread->outbox_count == 0);
+}
+
+/* Flush the messages posted to a thread, so that they run before the ones sent next */
+static inline int
+thread_flush_outbox_to(struct spdk_thread *thread, const struct spdk_thread *target)
+{
+	uint32_t i;
+
+	if (spdk_likely(thread == NULL || thread->outbox_count == 0)) {
+		return 0;
+	}
+
+	for (i = 0; i < SPDK_MSG_OUTBOX_COUNT; i++) {
+		if (thread->outboxes[i].thread == target) {
+			return thread_flush_outbox(thread, &thread->outboxes[i]);
+		}
+	}
+
+	return 0;
+}
+
 int
 spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx)
 {
@@ -1415,35 +2088,138 @@ spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx
 
 	local_thread = _get_thread();
 
-	msg = NULL;
-	if (local_thread != NULL) {
-		if (local_thread->msg_cache_count > 0) {
-			msg = SLIST_FIRST(&local_thread->msg_cache);
-			assert(msg != NULL);
-			SLIST_REMOVE_HEAD(&local_thread->msg_cache, link);
-			local_thread->msg_cache_count--;
-		}
+	rc = thread_get_msgs(local_thread, &msg, 1);
+	if (rc != 0) {
+		return rc;
 	}
 
-	if (msg == NULL) {
-		msg = spdk_mempool_get(g_spdk_msg_mempool);
-		if (!msg) {
-			SPDK_ERRLOG("msg could not be allocated\n");
-			return -ENOMEM;
-		}
+	msg->fn = fn;
+	msg->arg = ctx;
+
+	if (spdk_unlikely(thread_flush_outbox_to(local_thread, thread) != 0)) {
+		SPDK_ERRLOG("msg could not be enqueued\n");
+		thread_put_msgs(&msg, 1);
+		return -EIO;
+	}
+
+	return thread_enqueue_msgs(thread, &msg, 1);
+}
+
+int
+spdk_thread_send_msg_bulk(const struct spdk_thread *thread, spdk_msg_fn fn, void **ctx,
+			  uint32_t count)
+{
+	struct spdk_thread *local_thread;
+	struct spdk_msg *msgs[SPDK_THREAD_MAX_BULK_MSGS];
+	uint32_t i;
+	int rc;
+
+	assert(thread != NULL);
+
+	if (spdk_unlikely(count > SPDK_THREAD_MAX_BULK_MSGS)) {
+		SPDK_ERRLOG("Can't send more than %d messages at once\n", SPDK_THREAD_MAX_BULK_MSGS);
+		return -EINVAL;
+	}
+
+	if (spdk_unlikely(thread->state == SPDK_THREAD_STATE_EXITED)) {
+		SPDK_ERRLOG("Thread %s is marked as exited.\n", thread->name);
+		return -EIO;
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+
+	local_thread = _get_thread();
+
+	rc = thread_get_msgs(local_thread, msgs, count);
+	if (rc != 0) {
+		return rc;
+	}
+
+	for (i = 0; i < count; i++) {
+		msgs[i]->fn = fn;
+		msgs[i]->arg = ctx[i];
+	}
+
+	if (spdk_unlikely(thread_flush_outbox_to(local_thread, thread) != 0)) {
+		SPDK_ERRLOG("msg could not be enqueued\n");
+		thread_put_msgs(msgs, count);
+		return -EIO;
+	}
+
+	return thread_enqueue_msgs(thread, msgs, count);
+}
+
+int
+spdk_thread_post_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx)
+{
+	struct spdk_thread *local_thread;
+	struct msg_outbox *outbox = NULL, *fullest = NULL;
+	struct spdk_msg *msg;
+	uint32_t i;
+	int rc;
+
+	assert(thread != NULL);
+
+	local_thread = _get_thread();
+	if (local_thread == NULL || local_thread->in_interrupt) {
+		return spdk_thread_send_msg(thread, fn, ctx);
+	}
+
+	if (spdk_unlikely(thread->state == SPDK_THREAD_STATE_EXITED)) {
+		SPDK_ERRLOG("Thread %s is marked as exited.\n", thread->name);
+		return -EIO;
+	}
+
+	rc = thread_get_msgs(local_thread, &msg, 1);
+	if (rc != 0) {
+		return rc;
 	}
 
 	msg->fn = fn;
 	msg->arg = ctx;
 
-	rc = spdk_ring_enqueue(thread->messages, (void **)&msg, 1, NULL);
-	if (rc != 1) {
+	for (i = 0; i < SPDK_MSG_OUTBOX_COUNT; i++) {
+		if (local_thread->outboxes[i].thread == thread) {
+			outbox = &local_thread->outboxes[i];
+			break;
+		}
+		if (local_thread->outboxes[i].thread == NULL) {
+			if (outbox == NULL) {
+				outbox = &local_thread->outboxes[i];
+			}
+		} else if (fullest == NULL || local_thread->outboxes[i].count > fullest->count) {
+			fullest = &local_thread->outboxes[i];
+		}
+	}
+
+	if (outbox == NULL) {
+		/* All of the outboxes hold messages for other threads, make room */
+		if (thread_flush_outbox(local_thread, fullest) != 0) {
+			/* No messages are held for this thread, so sending directly keeps the order */
+			return thread_enqueue_msgs(thread, &msg, 1);
+		}
+		outbox = fullest;
+	} else if (outbox->count == SPDK_MSG_OUTBOX_DEPTH &&
+		   thread_flush_outbox(local_thread, outbox) != 0) {
 		SPDK_ERRLOG("msg could not be enqueued\n");
-		spdk_mempool_put(g_spdk_msg_mempool, msg);
+		thread_put_msgs(&msg, 1);
 		return -EIO;
 	}
 
-	return thread_send_msg_notification(thread);
+	if (outbox->thread == NULL) {
+		outbox->thread = (struct spdk_thread *)thread;
+		__atomic_fetch_add(&outbox->thread->outbox_pending, 1, __ATOMIC_SEQ_CST);
+		local_thread->outbox_count++;
+	}
+
+	outbox->msgs[outbox->count++] = msg;
+	if (outbox->count == SPDK_MSG_OUTBOX_DEPTH) {
+		thread_flush_outbox(local_thread, outbox);
+	}
+
+	return 0;
 }
 
 int
@@ -1973,6 +2749,29 @@ spdk_poller_get_stats(struct spdk_poller *poller, struct spdk_poller_stats *stat
 {
 	stats->run_count = poller->run_count;
 	stats->busy_count = poller->busy_count;
+	stats->tsc = poller->tsc;
+}
+
+void
+spdk_thread_get_msg_stats(struct spdk_thread *thread, spdk_thread_msg_stats_cb cb_fn, void *ctx)
+{
+	struct spdk_thread_msg_stats stats;
+	uint32_t i;
+
+	if (thread->msg_stats == NULL) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_THREAD_MSG_STATS_SIZE; i++) {
+		if (thread->msg_stats[i].fn == NULL) {
+			continue;
+		}
+
+		stats.fn = thread->msg_stats[i].fn;
+		stats.count = thread->msg_stats[i].count;
+		stats.tsc = thread->msg_stats[i].tsc;
+		cb_fn(ctx, &stats);
+	}
 }
 
 struct spdk_poller *
@@ -1990,13 +2789,13 @@ spdk_thread_get_next_active_poller(struct spdk_poller *prev)
 struct spdk_poller *
 spdk_thread_get_first_timed_poller(struct spdk_thread *thread)
 {
-	return RB_MIN(timed_pollers_tree, &thread->timed_pollers);
+	return timed_poller_first(thread);
 }
 
 struct spdk_poller *
 spdk_thread_get_next_timed_poller(struct spdk_poller *prev)
 {
-	return RB_NEXT(timed_pollers_tree, &thread->timed_pollers, prev);
+	return timed_poller_next(prev->thread, prev);
 }
 
 struct spdk_poller *
@@ -2014,13 +2813,13 @@ spdk_thread_get_next_paused_poller(struct spdk_poller *prev)
 struct spdk_io_channel *
 spdk_thread_get_first_io_channel(struct spdk_thread *thread)
 {
-	return RB_MIN(io_channel_tree, &thread->io_channels);
+	return TAILQ_FIRST(&thread->io_channels);
 }
 
 struct spdk_io_channel *
 spdk_thread_get_next_io_channel(struct spdk_io_channel *prev)
 {
-	return RB_NEXT(io_channel_tree, &thread->io_channels, prev);
+	return TAILQ_NEXT(prev, tailq);
 }
 
 uint16_t
@@ -2150,7 +2949,8 @@ spdk_thread_set_interrupt_mode(bool enable_interrupt)
 	}
 
 	/* Set pollers to expected mode */
-	RB_FOREACH_SAFE(poller, timed_pollers_tree, &thread->timed_pollers, tmp) {
+	for (poller = timed_poller_first(thread); poller != NULL; poller = tmp) {
+		tmp = timed_poller_next(thread, poller);
 		poller_set_interrupt_mode(poller, enable_interrupt);
 	}
 	TAILQ_FOREACH_SAFE(poller, &thread->active_pollers, tailq, tmp) {
@@ -2216,7 +3016,7 @@ spdk_io_device_register(void *io_device, spdk_io_channel_create_cb create_cb,
 	SPDK_DEBUGLOG(thread, "Registering io_device %s (%p) on thread %s\n",
 		      dev->name, dev->io_device, thread->name);
 
-	pthread_mutex_lock(&g_devlist_mutex);
+	pthread_rwlock_wrlock(&g_io_devices_lock);
 	tmp = RB_INSERT(io_device_tree, &g_io_devices, dev);
 	if (tmp != NULL) {
 		SPDK_ERRLOG("io_device %p already registered (old:%s new:%s)\n",
@@ -2224,7 +3024,7 @@ spdk_io_device_register(void *io_device, spdk_io_channel_create_cb create_cb,
 		free(dev);
 	}
 
-	pthread_mutex_unlock(&g_devlist_mutex);
+	pthread_rwlock_unlock(&g_io_devices_lock);
 }
 
 static void
@@ -2262,6 +3062,14 @@ io_device_free(struct io_device *dev)
 	}
 }
 
+static void
+io_device_put_ref(struct io_device *dev)
+{
+	if (__atomic_sub_fetch(&dev->refcnt, 1, __ATOMIC_ACQ_REL) == IO_DEVICE_UNREGISTERED) {
+		io_device_free(dev);
+	}
+}
+
 void
 spdk_io_device_unregister(void *io_device, spdk_io_device_unregister_cb unregister_cb)
 {
@@ -2277,10 +3085,12 @@ spdk_io_device_unregister(void *io_device, spdk_io_device_unregister_cb unregist
 	}
 
 	pthread_mutex_lock(&g_devlist_mutex);
+	pthread_rwlock_wrlock(&g_io_devices_lock);
 	dev = io_device_get(io_device);
 	if (!dev) {
 		SPDK_ERRLOG("io_device %p not found\n", io_device);
 		assert(false);
+		pthread_rwlock_unlock(&g_io_devices_lock);
 		pthread_mutex_unlock(&g_devlist_mutex);
 		return;
 	}
@@ -2292,6 +3102,7 @@ spdk_io_device_unregister(void *io_device, spdk_io_device_unregister_cb unregist
 	if (dev->pending_unregister && dev->for_each_count > 0) {
 		SPDK_ERRLOG("io_device %p already has a pending unregister\n", io_device);
 		assert(false);
+		pthread_rwlock_unlock(&g_io_devices_lock);
 		pthread_mutex_unlock(&g_devlist_mutex);
 		return;
 	}
@@ -2303,13 +3114,14 @@ spdk_io_device_unregister(void *io_device, spdk_io_device_unregister_cb unregist
 		SPDK_WARNLOG("io_device %s (%p) has %u for_each calls outstanding\n",
 			     dev->name, io_device, dev->for_each_count);
 		dev->pending_unregister = true;
+		pthread_rwlock_unlock(&g_io_devices_lock);
 		pthread_mutex_unlock(&g_devlist_mutex);
 		return;
 	}
 
-	dev->unregistered = true;
+	__atomic_store_n(&dev->unregistered, true, __ATOMIC_RELEASE);
 	RB_REMOVE(io_device_tree, &g_io_devices, dev);
-	refcnt = dev->refcnt;
+	pthread_rwlock_unlock(&g_io_devices_lock);
 	pthread_mutex_unlock(&g_devlist_mutex);
 
 	SPDK_DEBUGLOG(thread, "Unregistering io_device %s (%p) from thread %s\n",
@@ -2319,7 +3131,10 @@ spdk_io_device_unregister(void *io_device, spdk_io_device_unregister_cb unregist
 		thread->pending_unregister_count++;
 	}
 
-	if (refcnt > 0) {
+	/* No new channels can be created once the device is removed from the tree, so if the
+	 * device has no channels left, no other thread can free it anymore. */
+	refcnt = __atomic_or_fetch(&dev->refcnt, IO_DEVICE_UNREGISTERED, __ATOMIC_ACQ_REL);
+	if (refcnt != IO_DEVICE_UNREGISTERED) {
 		/* defer deletion */
 		return;
 	}
@@ -2333,13 +3148,97 @@ spdk_io_device_get_name(struct io_device *dev)
 	return dev->name;
 }
 
+/*
+ * Look up the channel of a registered io_device on the current thread.  Only the thread itself
+ * modifies its hash table, so it doesn't need to take the lock.
+ */
+static inline struct spdk_io_channel *
+thread_find_io_channel(struct spdk_thread *thread, void *io_device)
+{
+	struct spdk_io_channel *ch;
+
+	ch = thread->io_channel_hash[ptr_hash(io_device, thread->io_channel_hash_size)];
+	for (; ch != NULL; ch = ch->hash_next) {
+		if (ch->dev->io_device == io_device &&
+		    !__atomic_load_n(&ch->dev->unregistered, __ATOMIC_ACQUIRE)) {
+			return ch;
+		}
+	}
+
+	return NULL;
+}
+
+/* Look up the channel of an io_device on any thread. */
 static struct spdk_io_channel *
 thread_get_io_channel(struct spdk_thread *thread, struct io_device *dev)
 {
-	struct spdk_io_channel find = {};
+	struct spdk_io_channel *ch;
+
+	pthread_spin_lock(&thread->io_channels_lock);
+	ch = thread->io_channel_hash[ptr_hash(dev->io_device, thread->io_channel_hash_size)];
+	for (; ch != NULL; ch = ch->hash_next) {
+		if (ch->dev == dev) {
+			break;
+		}
+	}
+	pthread_spin_unlock(&thread->io_channels_lock);
 
-	find.dev = dev;
-	return RB_FIND(io_channel_tree, &thread->io_channels, &find);
+	return ch;
+}
+
+static void
+thread_insert_io_channel(struct spdk_thread *thread, struct spdk_io_channel *ch)
+{
+	struct spdk_io_channel **hash = NULL, **old_hash = NULL, *tmp, *next;
+	uint32_t size = thread->io_channel_hash_size, i, bucket;
+
+	/* Double the table once it holds as many channels as buckets.  It's allocated outside
+	 * of the lock and if that fails, the current table is kept, with longer chains. */
+	if (thread->io_channel_count >= size) {
+		hash = calloc(size * 2, sizeof(*hash));
+	}
+
+	pthread_spin_lock(&thread->io_channels_lock);
+	if (hash != NULL) {
+		for (i = 0; i < size; i++) {
+			for (tmp = thread->io_channel_hash[i]; tmp != NULL; tmp = next) {
+				next = tmp->hash_next;
+				bucket = ptr_hash(tmp->dev->io_device, size * 2);
+				tmp->hash_next = hash[bucket];
+				hash[bucket] = tmp;
+			}
+		}
+		old_hash = thread->io_channel_hash;
+		thread->io_channel_hash = hash;
+		thread->io_channel_hash_size = size * 2;
+	}
+
+	bucket = ptr_hash(ch->dev->io_device, thread->io_channel_hash_size);
+	ch->hash_next = thread->io_channel_hash[bucket];
+	thread->io_channel_hash[bucket] = ch;
+	TAILQ_INSERT_TAIL(&thread->io_channels, ch, tailq);
+	thread->io_channel_count++;
+	pthread_spin_unlock(&thread->io_channels_lock);
+
+	free(old_hash);
+}
+
+static void
+thread_remove_io_channel(struct spdk_thread *thread, struct spdk_io_channel *ch)
+{
+	struct spdk_io_channel **prev;
+
+	pthread_spin_lock(&thread->io_channels_lock);
+	prev = &thread->io_channel_hash[ptr_hash(ch->dev->io_device, thread->io_channel_hash_size)];
+	while (*prev != ch) {
+		assert(*prev != NULL);
+		prev = &(*prev)->hash_next;
+	}
+	*prev = ch->hash_next;
+	TAILQ_REMOVE(&thread->io_channels, ch, tailq);
+	assert(thread->io_channel_count > 0);
+	thread->io_channel_count--;
+	pthread_spin_unlock(&thread->io_channels_lock);
 }
 
 struct spdk_io_channel *
@@ -2350,48 +3249,48 @@ spdk_get_io_channel(void *io_device)
 	struct io_device *dev;
 	int rc;
 
-	pthread_mutex_lock(&g_devlist_mutex);
-	dev = io_device_get(io_device);
-	if (dev == NULL) {
-		SPDK_ERRLOG("could not find io_device %p\n", io_device);
-		pthread_mutex_unlock(&g_devlist_mutex);
-		return NULL;
-	}
-
 	thread = _get_thread();
 	if (!thread) {
 		SPDK_ERRLOG("No thread allocated\n");
-		pthread_mutex_unlock(&g_devlist_mutex);
 		return NULL;
 	}
 
 	if (spdk_unlikely(thread->state == SPDK_THREAD_STATE_EXITED)) {
 		SPDK_ERRLOG("Thread %s is marked as exited\n", thread->name);
-		pthread_mutex_unlock(&g_devlist_mutex);
 		return NULL;
 	}
 
-	ch = thread_get_io_channel(thread, dev);
+	ch = thread_find_io_channel(thread, io_device);
 	if (ch != NULL) {
 		ch->ref++;
 
 		SPDK_DEBUGLOG(thread, "Get io_channel %p for io_device %s (%p) on thread %s refcnt %u\n",
-			      ch, dev->name, dev->io_device, thread->name, ch->ref);
+			      ch, ch->dev->name, io_device, thread->name, ch->ref);
 
 		/*
 		 * An I/O channel already exists for this device on this
 		 *  thread, so return it.
 		 */
-		pthread_mutex_unlock(&g_devlist_mutex);
 		spdk_trace_record(TRACE_THREAD_IOCH_GET, 0, 0,
 				  (uint64_t)spdk_io_channel_get_ctx(ch), ch->ref);
 		return ch;
 	}
 
+	/* Taking a reference while the device is in the tree keeps it from being freed. */
+	pthread_rwlock_rdlock(&g_io_devices_lock);
+	dev = io_device_get(io_device);
+	if (dev == NULL) {
+		SPDK_ERRLOG("could not find io_device %p\n", io_device);
+		pthread_rwlock_unlock(&g_io_devices_lock);
+		return NULL;
+	}
+	__atomic_fetch_add(&dev->refcnt, 1, __ATOMIC_ACQ_REL);
+	pthread_rwlock_unlock(&g_io_devices_lock);
+
 	ch = calloc(1, sizeof(*ch) + dev->ctx_size);
 	if (ch == NULL) {
 		SPDK_ERRLOG("could not calloc spdk_io_channel\n");
-		pthread_mutex_unlock(&g_devlist_mutex);
+		io_device_put_ref(dev);
 		return NULL;
 	}
 
@@ -2400,24 +3299,18 @@ spdk_get_io_channel(void *io_device)
 	ch->thread = thread;
 	ch->ref = 1;
 	ch->destroy_ref = 0;
-	RB_INSERT(io_channel_tree, &thread->io_channels, ch);
+	thread_insert_io_channel(thread, ch);
 
 	SPDK_DEBUGLOG(thread, "Get io_channel %p for io_device %s (%p) on thread %s refcnt %u\n",
 		      ch, dev->name, dev->io_device, thread->name, ch->ref);
 
-	dev->refcnt++;
-
-	pthread_mutex_unlock(&g_devlist_mutex);
-
 	rc = dev->create_cb(io_device, (uint8_t *)ch + sizeof(*ch));
 	if (rc != 0) {
-		pthread_mutex_lock(&g_devlist_mutex);
-		RB_REMOVE(io_channel_tree, &ch->thread->io_channels, ch);
-		dev->refcnt--;
-		free(ch);
+		thread_remove_io_channel(thread, ch);
 		SPDK_ERRLOG("could not create io_channel for io_device %s (%p): %s (rc=%d)\n",
 			    dev->name, io_device, spdk_strerror(-rc), rc);
-		pthread_mutex_unlock(&g_devlist_mutex);
+		io_device_put_ref(dev);
+		free(ch);
 		return NULL;
 	}
 
@@ -2429,7 +3322,6 @@ static void
 put_io_channel(void *arg)
 {
 	struct spdk_io_channel *ch = arg;
-	bool do_remove_dev = true;
 	struct spdk_thread *thread;
 
 	thread = spdk_get_thread();
@@ -2456,29 +3348,11 @@ put_io_channel(void *arg)
 		return;
 	}
 
-	pthread_mutex_lock(&g_devlist_mutex);
-	RB_REMOVE(io_channel_tree, &ch->thread->io_channels, ch);
-	pthread_mutex_unlock(&g_devlist_mutex);
+	thread_remove_io_channel(thread, ch);
 
-	/* Don't hold the devlist mutex while the destroy_cb is called. */
 	ch->destroy_cb(ch->dev->io_device, spdk_io_channel_get_ctx(ch));
 
-	pthread_mutex_lock(&g_devlist_mutex);
-	ch->dev->refcnt--;
-
-	if (!ch->dev->unregistered) {
-		do_remove_dev = false;
-	}
-
-	if (ch->dev->refcnt > 0) {
-		do_remove_dev = false;
-	}
-
-	pthread_mutex_unlock(&g_devlist_mutex);
-
-	if (do_remove_dev) {
-		io_device_free(ch->dev);
-	}
+	io_device_put_ref(ch->dev);
 	free(ch);
 }
 
@@ -2603,9 +3477,7 @@ _call_channel(void *ctx)
 	 *  message had a chance to execute.  If so, skip calling
 	 *  the fn() on this thread.
 	 */
-	pthread_mutex_lock(&g_devlist_mutex);
 	ch = thread_get_io_channel(i->cur_thread, i->dev);
-	pthread_mutex_unlock(&g_devlist_mutex);
 
 	if (ch) {
 		i->fn(i);
@@ -2639,7 +3511,9 @@ spdk_for_each_channel(void *io_device, spdk_channel_msg fn, void *ctx,
 	i->orig_thread->for_each_count++;
 
 	pthread_mutex_lock(&g_devlist_mutex);
+	pthread_rwlock_rdlock(&g_io_devices_lock);
 	i->dev = io_device_get(io_device);
+	pthread_rwlock_unlock(&g_io_devices_lock);
 	if (i->dev == NULL) {
 		SPDK_ERRLOG("could not find io_device %p\n", io_device);
 		assert(false);
@@ -2792,6 +3666,8 @@ thread_interrupt_msg_process(void *arg)
 		}
 	}
 
+	thread_flush_outboxes(thread);
+
 	spdk_set_thread(orig_thread);
 	return rc;
 }
@@ -22,7 +22,8 @@ struct spdk_io_channel {
 	struct io_device		*dev;
 	uint32_t			ref;
 	uint32_t			destroy_ref;
-	RB_ENTRY(spdk_io_channel)	node;
+	TAILQ_ENTRY(spdk_io_channel)	tailq;
+	struct spdk_io_channel		*hash_next;
 	spdk_io_channel_destroy_cb	destroy_cb;
 
 	uint8_t				_padding[40];
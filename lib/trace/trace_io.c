@@ -0,0 +1,125 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/likely.h"
+#include "spdk/trace.h"
+#include "spdk/util.h"
+#include "spdk_internal/trace_defs.h"
+
+static uint32_t g_io_sample_rate = SPDK_TRACE_IO_SAMPLE_RATE_DEFAULT;
+static uint64_t g_io_id;
+
+/* Number of I/Os seen by this thread since the last one that was sampled */
+static __thread uint32_t t_io_count;
+/* Trace id of the I/O being processed by this thread */
+static __thread uint64_t t_io_ctx;
+
+uint64_t
+spdk_trace_io_sample(void)
+{
+	uint32_t rate = __atomic_load_n(&g_io_sample_rate, __ATOMIC_RELAXED);
+
+	if (!spdk_trace_io_enabled() || rate == 0 || ++t_io_count < rate) {
+		return 0;
+	}
+
+	t_io_count = 0;
+
+	return __atomic_add_fetch(&g_io_id, 1, __ATOMIC_RELAXED);
+}
+
+void
+spdk_trace_set_io_sample_rate(uint32_t rate)
+{
+	__atomic_store_n(&g_io_sample_rate, rate, __ATOMIC_RELAXED);
+}
+
+uint32_t
+spdk_trace_get_io_sample_rate(void)
+{
+	return __atomic_load_n(&g_io_sample_rate, __ATOMIC_RELAXED);
+}
+
+uint64_t
+spdk_trace_io_get_ctx(void)
+{
+	return t_io_ctx;
+}
+
+uint64_t
+spdk_trace_io_set_ctx(uint64_t io_id)
+{
+	uint64_t prev = t_io_ctx;
+
+	t_io_ctx = io_id;
+
+	return prev;
+}
+
+static void
+io_trace(void)
+{
+	struct spdk_trace_tpoint_opts opts[] = {
+		{
+			"IO_NVMF_RECV", TRACE_IO_NVMF_RECV,
+			OWNER_TYPE_NONE, OBJECT_NONE, 0,
+			{
+				{ "qid", SPDK_TRACE_ARG_TYPE_INT, 4 },
+				{ "opc", SPDK_TRACE_ARG_TYPE_INT, 4 }
+			}
+		},
+		{
+			"IO_NVMF_EXEC", TRACE_IO_NVMF_EXEC,
+			OWNER_TYPE_NONE, OBJECT_NONE, 0,
+			{}
+		},
+		{
+			"IO_NVMF_COMPLETE", TRACE_IO_NVMF_COMPLETE,
+			OWNER_TYPE_NONE, OBJECT_NONE, 0,
+			{
+				{ "status", SPDK_TRACE_ARG_TYPE_INT, 4 }
+			}
+		},
+		{
+			"IO_NVMF_SENT", TRACE_IO_NVMF_SENT,
+			OWNER_TYPE_NONE, OBJECT_NONE, 0,
+			{}
+		},
+		{
+			"IO_BDEV_SUBMIT", TRACE_IO_BDEV_SUBMIT,
+			OWNER_TYPE_BDEV, OBJECT_NONE, 0,
+			{
+				{ "bdev_io", SPDK_TRACE_ARG_TYPE_PTR, 8 },
+				{ "type", SPDK_TRACE_ARG_TYPE_INT, 4 }
+			}
+		},
+		{
+			"IO_BDEV_COMPLETE", TRACE_IO_BDEV_COMPLETE,
+			OWNER_TYPE_BDEV, OBJECT_NONE, 0,
+			{
+				{ "bdev_io", SPDK_TRACE_ARG_TYPE_PTR, 8 }
+			}
+		},
+		{
+			"IO_NVME_SUBMIT", TRACE_IO_NVME_SUBMIT,
+			OWNER_TYPE_NONE, OBJECT_NONE, 0,
+			{
+				{ "req", SPDK_TRACE_ARG_TYPE_PTR, 8 },
+				{ "qid", SPDK_TRACE_ARG_TYPE_INT, 4 },
+				{ "opc", SPDK_TRACE_ARG_TYPE_INT, 4 }
+			}
+		},
+		{
+			"IO_NVME_COMPLETE", TRACE_IO_NVME_COMPLETE,
+			OWNER_TYPE_NONE, OBJECT_NONE, 0,
+			{
+				{ "req", SPDK_TRACE_ARG_TYPE_PTR, 8 }
+			}
+		},
+	};
+
+	spdk_trace_register_description_ext(opts, SPDK_COUNTOF(opts));
+}
+SPDK_TRACE_REGISTER_FN(io_trace, "io", TRACE_GROUP_IO)
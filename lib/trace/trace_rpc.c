@@ -169,6 +169,35 @@ invalid:
 SPDK_RPC_REGISTER("trace_disable_tpoint_group", rpc_trace_disable_tpoint_group,
 		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
 
+struct rpc_io_sample_rate {
+	uint32_t rate;
+};
+
+static const struct spdk_json_object_decoder rpc_io_sample_rate_decoders[] = {
+	{"rate", offsetof(struct rpc_io_sample_rate, rate), spdk_json_decode_uint32},
+};
+
+static void
+rpc_trace_set_io_sample_rate(struct spdk_jsonrpc_request *request,
+			     const struct spdk_json_val *params)
+{
+	struct rpc_io_sample_rate req = {};
+
+	if (spdk_json_decode_object(params, rpc_io_sample_rate_decoders,
+				    SPDK_COUNTOF(rpc_io_sample_rate_decoders), &req)) {
+		SPDK_DEBUGLOG(trace, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		return;
+	}
+
+	spdk_trace_set_io_sample_rate(req.rate);
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+SPDK_RPC_REGISTER("trace_set_io_sample_rate", rpc_trace_set_io_sample_rate,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
+
 static void
 rpc_trace_get_tpoint_group_mask(struct spdk_jsonrpc_request *request,
 				const struct spdk_json_val *params)
@@ -4,36 +4,127 @@
  */
 
 #include "spdk/stdinc.h"
+#include "spdk/endian.h"
 #include "spdk/likely.h"
 #include "spdk/log.h"
 #include "spdk/trace_parser.h"
 #include "spdk/util.h"
 #include "spdk/env.h"
 
+#include <algorithm>
+#include <atomic>
 #include <exception>
 #include <map>
 #include <new>
+#include <queue>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 struct entry_key {
-	entry_key(uint16_t _lcore, uint64_t _tsc) : lcore(_lcore), tsc(_tsc) {}
+	entry_key(uint16_t _lcore, uint64_t _tsc, size_t _index) :
+		lcore(_lcore), tsc(_tsc), index(_index) {}
 	uint16_t lcore;
 	uint64_t tsc;
+	/* Index of the lcore_entries the entry comes from */
+	size_t index;
 };
 
+/* Orders the merge queue so that the entry with the lowest tsc is on top */
 class compare_entry_key
 {
 public:
 	bool operator()(const entry_key &first, const entry_key &second) const
 	{
 		if (first.tsc == second.tsc) {
-			return first.lcore < second.lcore;
+			return first.lcore > second.lcore;
 		} else {
-			return first.tsc < second.tsc;
+			return first.tsc > second.tsc;
 		}
 	}
 };
 
-typedef std::map<entry_key, spdk_trace_entry *, compare_entry_key> entry_map;
+typedef std::priority_queue<entry_key, std::vector<entry_key>, compare_entry_key> entry_queue;
+
+/* Entries of a single lcore sorted by their tsc */
+struct lcore_entries {
+	lcore_entries(spdk_trace_history *_history) : history(_history), first_tsc(0), pos(0) {}
+	spdk_trace_history		*history;
+	std::vector<spdk_trace_entry *>	entries;
+	/* The tsc of the oldest entry in the history */
+	uint64_t			first_tsc;
+	/* Next entry to be merged */
+	size_t				pos;
+};
+
+static bool
+compare_entry_tsc(const spdk_trace_entry *first, const spdk_trace_entry *second)
+{
+	return first->tsc < second->tsc;
+}
+
+/* Calls fn for each index in [0, count) using all available CPUs */
+template <typename Fn>
+static void
+run_parallel(size_t count, Fn fn)
+{
+	std::vector<std::thread> threads;
+	std::atomic<size_t> next(0);
+	size_t num_threads = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++) {
+			fn(i);
+		}
+	};
+
+	try {
+		for (size_t i = 1; i < num_threads; ++i) {
+			threads.emplace_back(worker);
+		}
+	} catch (const std::system_error &) {
+		/* Whatever the threads we did manage to start don't pick up is done below */
+	}
+
+	worker();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+/* Reverses the encoding described in SPDK_TRACE_STREAM_CHUNK_ENTRIES */
+static bool
+stream_decode(const uint8_t *in, size_t size, spdk_trace_entry *entries, uint64_t num_entries)
+{
+	const size_t num_words = sizeof(spdk_trace_entry) / sizeof(uint64_t);
+	uint64_t words[sizeof(spdk_trace_entry) / sizeof(uint64_t)];
+	uint8_t bytes[sizeof(uint64_t)];
+	const uint8_t *lengths;
+	size_t i = 0, len;
+
+	for (uint64_t e = 0; e < num_entries; ++e) {
+		if (i + num_words / 2 > size) {
+			return false;
+		}
+		lengths = &in[i];
+		i += num_words / 2;
+
+		for (size_t j = 0; j < num_words; ++j) {
+			len = (lengths[j / 2] >> (j % 2 * 4)) & 0xf;
+			if (len > sizeof(uint64_t) || i + len > size) {
+				return false;
+			}
+			memset(bytes, 0, sizeof(bytes));
+			memcpy(bytes, &in[i], len);
+			words[j] = from_le64(bytes);
+			i += len;
+		}
+
+		memcpy(&entries[e], words, sizeof(words));
+	}
+
+	return i == size;
+}
 
 struct argument_context {
 	spdk_trace_entry	*entry;
@@ -75,17 +166,19 @@ private:
 	spdk_trace_entry_buffer *get_next_buffer(spdk_trace_entry_buffer *buf, uint16_t lcore);
 	bool build_arg(argument_context *argctx, const spdk_trace_argument *arg, int argid,
 		       spdk_trace_parser_entry *pe);
-	void populate_events(spdk_trace_history *history, int num_entries, bool overflowed);
+	void populate_events(lcore_entries *lcore);
+	bool map_file(const char *filename, size_t file_size);
+	bool load_stream(const char *filename, size_t file_size);
 	bool init(const spdk_trace_parser_opts *opts);
 	void cleanup();
 
-	spdk_trace_file		*_trace_file;
-	size_t			_map_size;
-	int			_fd;
-	uint64_t		_tsc_offset;
-	entry_map		_entries;
-	entry_map::iterator	_iter;
-	object_stats		_stats[SPDK_TRACE_MAX_OBJECT];
+	spdk_trace_file			*_trace_file;
+	size_t				_map_size;
+	int				_fd;
+	uint64_t			_tsc_offset;
+	std::vector<lcore_entries>	_lcores;
+	entry_queue			_queue;
+	object_stats			_stats[SPDK_TRACE_MAX_OBJECT];
 };
 
 uint64_t
@@ -162,15 +255,21 @@ spdk_trace_parser::next_entry(spdk_trace_parser_entry *pe)
 {
 	spdk_trace_tpoint *tpoint;
 	spdk_trace_entry *entry;
+	lcore_entries *lcore;
 	object_stats *stats;
 	std::map<uint64_t, uint64_t>::iterator related_kv;
 
-	if (_iter == _entries.end()) {
+	if (_queue.empty()) {
 		return false;
 	}
 
-	pe->entry = entry = _iter->second;
-	pe->lcore = _iter->first.lcore;
+	lcore = &_lcores[_queue.top().index];
+	_queue.pop();
+	pe->entry = entry = lcore->entries[lcore->pos++];
+	pe->lcore = lcore->history->lcore;
+	if (lcore->pos < lcore->entries.size()) {
+		_queue.push(entry_key(pe->lcore, lcore->entries[lcore->pos]->tsc, lcore - &_lcores[0]));
+	}
 	/* Set related index to the max value to indicate "empty" state */
 	pe->related_index = UINT64_MAX;
 	pe->related_type = OBJECT_NONE;
@@ -219,18 +318,18 @@ spdk_trace_parser::next_entry(spdk_trace_parser_entry *pe)
 		}
 	}
 
-	_iter++;
 	return true;
 }
 
 void
-spdk_trace_parser::populate_events(spdk_trace_history *history, int num_entries, bool overflowed)
+spdk_trace_parser::populate_events(lcore_entries *lcore)
 {
+	spdk_trace_history *history = lcore->history;
+	int num_entries = history->num_entries;
 	int i, num_entries_filled;
 	spdk_trace_entry *e;
-	int first, last, lcore;
+	int first, last;
 
-	lcore = history->lcore;
 	e = history->entries;
 
 	num_entries_filled = num_entries;
@@ -253,21 +352,13 @@ spdk_trace_parser::populate_events(spdk_trace_history *history, int num_entries,
 		last = num_entries_filled - 1;
 	}
 
-	/*
-	 * We keep track of the highest first TSC out of all reactors iff. any
-	 * have overflowed their circular buffer.
-	 *  We will ignore any events that occurred before this TSC on any
-	 *  other reactors.  This will ensure we only print data for the
-	 *  subset of time where we have data across all reactors.
-	 */
-	if (e[first].tsc > _tsc_offset && overflowed) {
-		_tsc_offset = e[first].tsc;
-	}
+	lcore->first_tsc = e[first].tsc;
+	lcore->entries.reserve(num_entries_filled);
 
 	i = first;
 	while (1) {
 		if (e[i].tpoint_id != SPDK_TRACE_MAX_TPOINT_ID) {
-			_entries[entry_key(lcore, e[i].tsc)] = &e[i];
+			lcore->entries.push_back(&e[i]);
 		}
 		if (i == last) {
 			break;
@@ -277,6 +368,182 @@ spdk_trace_parser::populate_events(spdk_trace_history *history, int num_entries,
 			i = 0;
 		}
 	}
+
+	/* The entries are recorded in order, unless the tracepoints were given their own tsc */
+	if (!std::is_sorted(lcore->entries.begin(), lcore->entries.end(), compare_entry_tsc)) {
+		std::stable_sort(lcore->entries.begin(), lcore->entries.end(), compare_entry_tsc);
+	}
+}
+
+bool
+spdk_trace_parser::map_file(const char *filename, size_t file_size)
+{
+	/* Map the header of trace file */
+	_map_size = sizeof(*_trace_file);
+	_trace_file = static_cast<spdk_trace_file *>(mmap(NULL, _map_size, PROT_READ,
+			MAP_SHARED, _fd, 0));
+	if (_trace_file == MAP_FAILED) {
+		SPDK_ERRLOG("Could not mmap trace file: %s\n", filename);
+		_trace_file = NULL;
+		return false;
+	}
+
+	/* Remap the entire trace file */
+	_map_size = spdk_get_trace_file_size(_trace_file);
+	munmap(_trace_file, sizeof(*_trace_file));
+	if (file_size < _map_size) {
+		SPDK_ERRLOG("Trace file %s is not valid\n", filename);
+		_trace_file = NULL;
+		return false;
+	}
+	_trace_file = static_cast<spdk_trace_file *>(mmap(NULL, _map_size, PROT_READ,
+			MAP_SHARED, _fd, 0));
+	if (_trace_file == MAP_FAILED) {
+		SPDK_ERRLOG("Could not mmap trace file: %s\n", filename);
+		_trace_file = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool
+spdk_trace_parser::load_stream(const char *filename, size_t file_size)
+{
+	const spdk_trace_stream_chunk *chunk;
+	const spdk_trace_file *header;
+	const uint8_t *stream, *owners = NULL;
+	std::vector<std::vector<const spdk_trace_stream_chunk *>> chunks(SPDK_TRACE_MAX_LCORE);
+	std::vector<const spdk_trace_history *> histories(SPDK_TRACE_MAX_LCORE);
+	std::vector<uint64_t> counts(SPDK_TRACE_MAX_LCORE);
+	std::vector<uint16_t> lcores;
+	std::atomic<bool> failed(false);
+	spdk_trace_history *history;
+	size_t offset, owner_size = 0, size;
+	void *map;
+
+	if (file_size < sizeof(uint64_t) + sizeof(*header)) {
+		SPDK_ERRLOG("Trace stream %s is not valid\n", filename);
+		return false;
+	}
+
+	map = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+	if (map == MAP_FAILED) {
+		SPDK_ERRLOG("Could not mmap trace stream: %s\n", filename);
+		return false;
+	}
+
+	stream = static_cast<const uint8_t *>(map);
+	header = reinterpret_cast<const spdk_trace_file *>(stream + sizeof(uint64_t));
+	offset = sizeof(uint64_t) + sizeof(*header);
+	while (offset + sizeof(*chunk) <= file_size) {
+		chunk = reinterpret_cast<const spdk_trace_stream_chunk *>(stream + offset);
+		if (offset + sizeof(*chunk) + chunk->size > file_size) {
+			/* The recorder was likely stopped in the middle of writing a chunk */
+			SPDK_WARNLOG("Trace stream %s is truncated\n", filename);
+			break;
+		}
+
+		if (chunk->lcore >= SPDK_TRACE_MAX_LCORE) {
+			SPDK_ERRLOG("Invalid lcore %u in trace stream %s\n", chunk->lcore, filename);
+			munmap(map, file_size);
+			return false;
+		}
+
+		switch (chunk->type) {
+		case SPDK_TRACE_STREAM_CHUNK_ENTRIES:
+			chunks[chunk->lcore].push_back(chunk);
+			counts[chunk->lcore] += chunk->num_entries;
+			break;
+		case SPDK_TRACE_STREAM_CHUNK_HISTORY:
+			if (chunk->size >= sizeof(spdk_trace_history)) {
+				histories[chunk->lcore] = reinterpret_cast<const spdk_trace_history *>(chunk + 1);
+			}
+			break;
+		case SPDK_TRACE_STREAM_CHUNK_OWNERS:
+			owners = reinterpret_cast<const uint8_t *>(chunk + 1);
+			owner_size = chunk->size;
+			break;
+		default:
+			SPDK_ERRLOG("Invalid chunk type %u in trace stream %s\n", chunk->type, filename);
+			munmap(map, file_size);
+			return false;
+		}
+
+		offset += sizeof(*chunk) + chunk->size;
+	}
+
+	/* Lay the entries out the same way spdk_trace_record does when aggregating them */
+	size = sizeof(*_trace_file);
+	for (uint16_t lcore = 0; lcore < SPDK_TRACE_MAX_LCORE; ++lcore) {
+		if (counts[lcore] > 0 || histories[lcore] != NULL) {
+			lcores.push_back(lcore);
+			size += spdk_get_trace_history_size(counts[lcore]);
+		}
+	}
+	size += (size_t)header->num_owners *
+		(sizeof(spdk_trace_owner) + header->owner_description_size);
+
+	_trace_file = static_cast<spdk_trace_file *>(mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (_trace_file == MAP_FAILED) {
+		SPDK_ERRLOG("Could not allocate memory for trace stream: %s\n", filename);
+		_trace_file = NULL;
+		munmap(map, file_size);
+		return false;
+	}
+	_map_size = size;
+
+	memcpy(_trace_file, header, sizeof(*_trace_file));
+	_trace_file->file_size = size;
+	memset(_trace_file->lcore_history_offsets, 0, sizeof(_trace_file->lcore_history_offsets));
+
+	size = sizeof(*_trace_file);
+	for (uint16_t lcore : lcores) {
+		_trace_file->lcore_history_offsets[lcore] = size;
+		history = spdk_get_per_lcore_history(_trace_file, lcore);
+		if (histories[lcore] != NULL) {
+			memcpy(history, histories[lcore], sizeof(*history));
+		}
+		history->lcore = lcore;
+		history->num_entries = counts[lcore];
+		history->next_entry = counts[lcore];
+		size += spdk_get_trace_history_size(counts[lcore]);
+	}
+
+	_trace_file->owner_offset = size;
+	if (owners != NULL && owner_size == _map_size - size) {
+		memcpy(reinterpret_cast<uint8_t *>(_trace_file) + size, owners, owner_size);
+	}
+
+	/* The cores were streamed independently, so they can be decoded in parallel too */
+	run_parallel(lcores.size(), [&](size_t i) {
+		spdk_trace_entry *entry = spdk_get_per_lcore_history(_trace_file, lcores[i])->entries;
+		uint64_t tsc;
+
+		for (const spdk_trace_stream_chunk *c : chunks[lcores[i]]) {
+			if (!stream_decode(reinterpret_cast<const uint8_t *>(c + 1), c->size, entry,
+					   c->num_entries)) {
+				failed = true;
+				return;
+			}
+
+			/* Each chunk stores the tsc as a difference to the previous entry's */
+			tsc = 0;
+			for (uint64_t j = 0; j < c->num_entries; ++j, ++entry) {
+				tsc += entry->tsc;
+				entry->tsc = tsc;
+			}
+		}
+	});
+
+	munmap(map, file_size);
+	if (failed) {
+		SPDK_ERRLOG("Trace stream %s is corrupted\n", filename);
+		return false;
+	}
+
+	return true;
 }
 
 bool
@@ -284,8 +551,9 @@ spdk_trace_parser::init(const spdk_trace_parser_opts *opts)
 {
 	spdk_trace_history *history;
 	struct stat st;
+	uint64_t magic = 0;
 	int rc, i, entry_num;
-	bool overflowed;
+	bool overflowed = false;
 
 	switch (opts->mode) {
 	case SPDK_TRACE_PARSER_MODE_FILE:
@@ -315,29 +583,19 @@ spdk_trace_parser::init(const spdk_trace_parser_opts *opts)
 		return false;
 	}
 
-	/* Map the header of trace file */
-	_map_size = sizeof(*_trace_file);
-	_trace_file = static_cast<spdk_trace_file *>(mmap(NULL, _map_size, PROT_READ,
-			MAP_SHARED, _fd, 0));
-	if (_trace_file == MAP_FAILED) {
-		SPDK_ERRLOG("Could not mmap trace file: %s\n", opts->filename);
-		_trace_file = NULL;
-		return false;
+	if (opts->mode == SPDK_TRACE_PARSER_MODE_FILE) {
+		rc = pread(_fd, &magic, sizeof(magic), 0);
+		if (rc != sizeof(magic)) {
+			SPDK_ERRLOG("Could not read trace file: %s\n", opts->filename);
+			return false;
+		}
 	}
 
-	/* Remap the entire trace file */
-	_map_size = spdk_get_trace_file_size(_trace_file);
-	munmap(_trace_file, sizeof(*_trace_file));
-	if ((size_t)st.st_size < _map_size) {
-		SPDK_ERRLOG("Trace file %s is not valid\n", opts->filename);
-		_trace_file = NULL;
-		return false;
-	}
-	_trace_file = static_cast<spdk_trace_file *>(mmap(NULL, _map_size, PROT_READ,
-			MAP_SHARED, _fd, 0));
-	if (_trace_file == MAP_FAILED) {
-		SPDK_ERRLOG("Could not mmap trace file: %s\n", opts->filename);
-		_trace_file = NULL;
+	if (magic == SPDK_TRACE_STREAM_MAGIC) {
+		if (!load_stream(opts->filename, st.st_size)) {
+			return false;
+		}
+	} else if (!map_file(opts->filename, st.st_size)) {
 		return false;
 	}
 
@@ -367,7 +625,7 @@ spdk_trace_parser::init(const spdk_trace_parser_opts *opts)
 			if (history == NULL || history->num_entries == 0 || history->entries[0].tsc == 0) {
 				continue;
 			}
-			populate_events(history, history->num_entries, overflowed);
+			_lcores.push_back(lcore_entries(history));
 		}
 	} else {
 		history = spdk_get_per_lcore_history(_trace_file, opts->lcore);
@@ -377,11 +635,32 @@ spdk_trace_parser::init(const spdk_trace_parser_opts *opts)
 			return false;
 		}
 		if (history->num_entries > 0 && history->entries[0].tsc != 0) {
-			populate_events(history, history->num_entries, false);
+			_lcores.push_back(lcore_entries(history));
+		}
+	}
+
+	/* Each core's entries are sorted on their own and merged as they're being iterated over */
+	run_parallel(_lcores.size(), [this](size_t i) {
+		populate_events(&_lcores[i]);
+	});
+
+	for (size_t i = 0; i < _lcores.size(); ++i) {
+		/*
+		 * We keep track of the highest first TSC out of all reactors iff. any
+		 * have overflowed their circular buffer.
+		 *  We will ignore any events that occurred before this TSC on any
+		 *  other reactors.  This will ensure we only print data for the
+		 *  subset of time where we have data across all reactors.
+		 */
+		if (_lcores[i].first_tsc > _tsc_offset && overflowed) {
+			_tsc_offset = _lcores[i].first_tsc;
+		}
+
+		if (!_lcores[i].entries.empty()) {
+			_queue.push(entry_key(_lcores[i].history->lcore, _lcores[i].entries[0]->tsc, i));
 		}
 	}
 
-	_iter = _entries.begin();
 	return true;
 }
 
@@ -3,8 +3,6 @@
  *   All rights reserved.
  */
 
-#include <liburing.h>
-
 #include "spdk/stdinc.h"
 #include "spdk/string.h"
 #include "spdk/bdev.h"
@@ -13,6 +11,7 @@
 #include "spdk/likely.h"
 #include "spdk/log.h"
 #include "spdk/util.h"
+#include "spdk_internal/uring.h"
 #include "spdk/queue.h"
 #include "spdk/json.h"
 #include "spdk/ublk.h"
@@ -21,6 +20,8 @@
 
 #include "ublk_internal.h"
 
+#include <sys/eventfd.h>
+
 #define UBLK_CTRL_DEV					"/dev/ublk-control"
 #define UBLK_BLK_CDEV					"/dev/ublkc"
 
@@ -46,6 +47,8 @@ static uint32_t g_next_ublk_poll_group = 0;
 static uint32_t g_ublks_max = UBLK_DEFAULT_MAX_SUPPORTED_DEVS;
 static struct spdk_cpuset g_core_mask;
 static bool g_disable_user_copy = false;
+static bool g_disable_fixed_buffers = false;
+static bool g_disable_queue_affinity = false;
 
 struct ublk_queue;
 struct ublk_poll_group;
@@ -53,8 +56,14 @@ struct ublk_io;
 static void _ublk_submit_bdev_io(struct ublk_queue *q, struct ublk_io *io);
 static void ublk_dev_queue_fini(struct ublk_queue *q);
 static int ublk_poll(void *arg);
+static void ublk_poll_group_notify(struct ublk_poll_group *poll_group);
+static void ublk_poller_set_interrupt_mode(struct spdk_poller *poller, void *cb_arg,
+		bool interrupt_mode);
+static int ublk_poll_group_register_interrupt(struct ublk_poll_group *poll_group);
+static void ublk_poll_group_unregister_interrupt(struct ublk_poll_group *poll_group);
 
 static int ublk_set_params(struct spdk_ublk_dev *ublk);
+static int ublk_get_queue_affinity(struct spdk_ublk_dev *ublk);
 static int ublk_start_dev(struct spdk_ublk_dev *ublk, bool is_recovering);
 static void ublk_free_dev(struct spdk_ublk_dev *ublk);
 static void ublk_delete_dev(void *arg);
@@ -64,6 +73,7 @@ static int ublk_ctrl_start_recovery(struct spdk_ublk_dev *ublk);
 static int ublk_ctrl_cmd_submit(struct spdk_ublk_dev *ublk, uint32_t cmd_op);
 
 static const char *ublk_op_name[64] = {
+	[UBLK_CMD_GET_QUEUE_AFFINITY] = "UBLK_CMD_GET_QUEUE_AFFINITY",
 	[UBLK_CMD_GET_DEV_INFO] = "UBLK_CMD_GET_DEV_INFO",
 	[UBLK_CMD_ADD_DEV] =	"UBLK_CMD_ADD_DEV",
 	[UBLK_CMD_DEL_DEV] =	"UBLK_CMD_DEL_DEV",
@@ -111,6 +121,11 @@ struct ublk_queue {
 	struct spdk_ublk_dev	*dev;
 	struct ublk_poll_group	*poll_group;
 	struct spdk_io_channel	*bdev_ch;
+	/* CPUs the kernel submits the requests of this queue from */
+	cpu_set_t		cpuset;
+	bool			has_affinity;
+	/* Buffers registered in the ring, synced with g_ublk_bufs by the poller */
+	struct spdk_uring_fixed_bufs	fixed_bufs;
 
 	TAILQ_ENTRY(ublk_queue)	tailq;
 };
@@ -127,6 +142,7 @@ struct spdk_ublk_dev {
 	uint32_t		num_queues;
 	uint32_t		queue_depth;
 	uint32_t		online_num_queues;
+	uint32_t		affinity_q_id;
 	uint32_t		sector_per_block_shift;
 	struct ublk_queue	queues[UBLK_DEV_MAX_QUEUES];
 
@@ -146,7 +162,15 @@ struct spdk_ublk_dev {
 
 struct ublk_poll_group {
 	struct spdk_thread		*ublk_thread;
+	uint32_t			core;
+	/* Number of ublk queues assigned, only accessed from the app thread */
+	uint32_t			num_queues;
 	struct spdk_poller		*ublk_poller;
+	/* eventfd signaled by the rings of all the queues in interrupt mode */
+	int				efd;
+	struct spdk_interrupt		*intr;
+	bool				interrupt_mode;
+	bool				notified;
 	struct spdk_iobuf_channel	iobuf_ch;
 	TAILQ_HEAD(, ublk_queue)	queue_list;
 };
@@ -169,11 +193,19 @@ struct ublk_tgt {
 	bool			user_copy;
 	/* `ublk_drv` supports UBLK_F_USER_RECOVERY */
 	bool			user_recovery;
+	/* user copy I/Os use the buffers registered with the queue rings */
+	bool			fixed_bufs;
+	/* queues are placed on the cores the kernel submits their requests from */
+	bool			queue_affinity;
 };
 
 static TAILQ_HEAD(, spdk_ublk_dev) g_ublk_devs = TAILQ_HEAD_INITIALIZER(g_ublk_devs);
 static struct ublk_tgt g_ublk_tgt;
 
+/* Buffers of the mem map below, which the iobuf pools come from, registered in the queue rings */
+static struct spdk_uring_buf_table g_ublk_bufs = SPDK_URING_BUF_TABLE_INITIALIZER;
+static struct spdk_mem_map *g_ublk_map;
+
 /* helpers for using io_uring */
 static inline int
 ublk_setup_ring(uint32_t depth, struct io_uring *r, unsigned flags)
@@ -186,6 +218,16 @@ ublk_setup_ring(uint32_t depth, struct io_uring *r, unsigned flags)
 	return io_uring_queue_init_params(depth, r, &p);
 }
 
+/*
+ * With IORING_SETUP_TASKRUN_FLAG, the kernel tells when it has completions to run the next
+ * time the ring is entered, instead of interrupting the thread to run them.
+ */
+static inline bool
+ublk_ring_needs_enter(struct io_uring *r)
+{
+	return __atomic_load_n(r->sq.kflags, __ATOMIC_RELAXED) & (IORING_SQ_TASKRUN | IORING_SQ_CQ_OVERFLOW);
+}
+
 static inline struct io_uring_sqe *
 ublk_uring_get_sqe(struct io_uring *r, uint32_t idx)
 {
@@ -210,6 +252,9 @@ ublk_set_sqe_cmd_op(struct io_uring_sqe *sqe, uint32_t cmd_op)
 		case UBLK_CMD_GET_DEV_INFO:
 			opc = _IOR('u', UBLK_CMD_GET_DEV_INFO, struct ublksrv_ctrl_cmd);
 			break;
+		case UBLK_CMD_GET_QUEUE_AFFINITY:
+			opc = _IOR('u', UBLK_CMD_GET_QUEUE_AFFINITY, struct ublksrv_ctrl_cmd);
+			break;
 		case UBLK_CMD_ADD_DEV:
 			opc = _IOWR('u', UBLK_CMD_ADD_DEV, struct ublksrv_ctrl_cmd);
 			break;
@@ -277,6 +322,22 @@ ublk_user_copy_pos(uint16_t q_id, uint16_t tag)
 				uint64_t)tag) << UBLK_TAG_OFF));
 }
 
+static void
+ublk_queue_fixed_bufs_init(struct ublk_queue *q)
+{
+	int rc;
+
+	if (!g_ublk_tgt.fixed_bufs) {
+		return;
+	}
+
+	rc = spdk_uring_fixed_bufs_init(&q->fixed_bufs, &q->ring, &g_ublk_bufs);
+	if (rc != 0) {
+		SPDK_WARNLOG("ublk%u: cannot register buffers in queue %u: %s\n", q->dev->ublk_id,
+			     q->q_id, spdk_strerror(-rc));
+	}
+}
+
 void
 spdk_ublk_init(void)
 {
@@ -350,8 +411,14 @@ ublk_ctrl_process_cqe(struct io_uring_cqe *cqe)
 	ublk->ctrl_ops_in_progress--;
 
 	if (spdk_unlikely(cqe->res != 0)) {
-		ublk_ctrl_cmd_error(ublk, cqe->res);
-		return;
+		if (ublk->current_cmd_op != UBLK_CMD_GET_QUEUE_AFFINITY) {
+			ublk_ctrl_cmd_error(ublk, cqe->res);
+			return;
+		}
+		/* Not fatal, the remaining queues just get the default placement */
+		SPDK_WARNLOG("ublk%u: cannot get the affinity of queue %u: %s\n", ublk->ublk_id,
+			     ublk->affinity_q_id, spdk_strerror(-cqe->res));
+		ublk->affinity_q_id = ublk->num_queues;
 	}
 
 	switch (ublk->current_cmd_op) {
@@ -363,7 +430,18 @@ ublk_ctrl_process_cqe(struct io_uring_cqe *cqe)
 		}
 		break;
 	case UBLK_CMD_SET_PARAMS:
-		rc = ublk_start_dev(ublk, false);
+		rc = ublk_get_queue_affinity(ublk);
+		if (rc < 0) {
+			ublk_delete_dev(ublk);
+			goto cb_done;
+		}
+		break;
+	case UBLK_CMD_GET_QUEUE_AFFINITY:
+		if (cqe->res == 0) {
+			ublk->queues[ublk->affinity_q_id].has_affinity = true;
+			ublk->affinity_q_id++;
+		}
+		rc = ublk_get_queue_affinity(ublk);
 		if (rc < 0) {
 			ublk_delete_dev(ublk);
 			goto cb_done;
@@ -403,7 +481,7 @@ ublk_ctrl_process_cqe(struct io_uring_cqe *cqe)
 		}
 		break;
 	case UBLK_CMD_START_USER_RECOVERY:
-		rc = ublk_start_dev(ublk, true);
+		rc = ublk_get_queue_affinity(ublk);
 		if (rc < 0) {
 			ublk_delete_dev(ublk);
 			goto cb_done;
@@ -493,6 +571,11 @@ ublk_ctrl_cmd_submit(struct spdk_ublk_dev *ublk, uint32_t cmd_op)
 		cmd->addr = (__u64)(uintptr_t)&ublk->dev_params;
 		cmd->len = sizeof(ublk->dev_params);
 		break;
+	case UBLK_CMD_GET_QUEUE_AFFINITY:
+		cmd->addr = (__u64)(uintptr_t)&ublk->queues[ublk->affinity_q_id].cpuset;
+		cmd->len = sizeof(cpu_set_t);
+		cmd->data[0] = ublk->affinity_q_id;
+		break;
 	case UBLK_CMD_START_DEV:
 		cmd->data[0] = getpid();
 		break;
@@ -678,6 +761,18 @@ ublk_poller_register(void *args)
 
 	TAILQ_INIT(&poll_group->queue_list);
 	poll_group->ublk_poller = SPDK_POLLER_REGISTER(ublk_poll, poll_group, 0);
+	poll_group->efd = -1;
+	if (spdk_interrupt_mode_is_enabled()) {
+		rc = ublk_poll_group_register_interrupt(poll_group);
+		if (rc != 0) {
+			/* The poller then keeps busy polling in interrupt mode */
+			SPDK_ERRLOG("Failed to register the interrupt of %s: %s\n",
+				    spdk_thread_get_name(poll_group->ublk_thread), spdk_strerror(-rc));
+		} else {
+			spdk_poller_register_interrupt(poll_group->ublk_poller, ublk_poller_set_interrupt_mode,
+						       poll_group);
+		}
+	}
 	rc = spdk_iobuf_channel_init(&poll_group->iobuf_ch, "ublk",
 				     UBLK_IOBUF_SMALL_CACHE_SIZE, UBLK_IOBUF_LARGE_CACHE_SIZE);
 	if (rc != 0) {
@@ -687,10 +782,14 @@ ublk_poller_register(void *args)
 
 struct rpc_create_target {
 	bool disable_user_copy;
+	bool disable_fixed_buffers;
+	bool disable_queue_affinity;
 };
 
 static const struct spdk_json_object_decoder rpc_ublk_create_target[] = {
 	{"disable_user_copy", offsetof(struct rpc_create_target, disable_user_copy), spdk_json_decode_bool, true},
+	{"disable_fixed_buffers", offsetof(struct rpc_create_target, disable_fixed_buffers), spdk_json_decode_bool, true},
+	{"disable_queue_affinity", offsetof(struct rpc_create_target, disable_queue_affinity), spdk_json_decode_bool, true},
 };
 
 int
@@ -701,6 +800,7 @@ ublk_create_target(const char *cpumask_str, const struct spdk_json_val *params)
 	char thread_name[32];
 	struct rpc_create_target req = {};
 	struct ublk_poll_group *poll_group;
+	struct spdk_cpuset thread_mask;
 
 	if (g_ublk_tgt.active == true) {
 		SPDK_ERRLOG("UBLK target has been created\n");
@@ -720,6 +820,8 @@ ublk_create_target(const char *cpumask_str, const struct spdk_json_val *params)
 			return -EINVAL;
 		}
 		g_disable_user_copy = req.disable_user_copy;
+		g_disable_fixed_buffers = req.disable_fixed_buffers;
+		g_disable_queue_affinity = req.disable_queue_affinity;
 	}
 
 	assert(g_ublk_tgt.poll_groups == NULL);
@@ -738,13 +840,26 @@ ublk_create_target(const char *cpumask_str, const struct spdk_json_val *params)
 
 	spdk_iobuf_register_module("ublk");
 
+	if (g_ublk_tgt.user_copy && !g_disable_fixed_buffers) {
+		g_ublk_map = spdk_uring_buf_table_map_alloc(&g_ublk_bufs);
+		if (g_ublk_map == NULL) {
+			SPDK_WARNLOG("cannot allocate the mem map, fixed buffers disabled\n");
+		}
+	}
+	g_ublk_tgt.fixed_bufs = g_ublk_map != NULL;
+	g_ublk_tgt.queue_affinity = !g_disable_queue_affinity;
+
 	SPDK_ENV_FOREACH_CORE(i) {
 		if (!spdk_cpuset_get_cpu(&g_core_mask, i)) {
 			continue;
 		}
 		snprintf(thread_name, sizeof(thread_name), "ublk_thread%u", i);
 		poll_group = &g_ublk_tgt.poll_groups[g_num_ublk_poll_groups];
-		poll_group->ublk_thread = spdk_thread_create(thread_name, &g_core_mask);
+		/* Each poll group stays on its own core, so the queues can be placed by core */
+		spdk_cpuset_zero(&thread_mask);
+		spdk_cpuset_set_cpu(&thread_mask, i, true);
+		poll_group->core = i;
+		poll_group->ublk_thread = spdk_thread_create(thread_name, &thread_mask);
 		spdk_thread_send_msg(poll_group->ublk_thread, ublk_poller_register, poll_group);
 		g_num_ublk_poll_groups++;
 	}
@@ -773,6 +888,9 @@ _ublk_fini_done(void *args)
 	g_ublk_tgt.ioctl_encode = false;
 	g_ublk_tgt.user_copy = false;
 	g_ublk_tgt.user_recovery = false;
+	g_ublk_tgt.fixed_bufs = false;
+	g_ublk_tgt.queue_affinity = false;
+	spdk_mem_map_free(&g_ublk_map);
 
 	if (g_ublk_tgt.cb_fn) {
 		g_ublk_tgt.cb_fn(g_ublk_tgt.cb_arg);
@@ -796,6 +914,7 @@ ublk_thread_exit(void *args)
 	for (i = 0; i < g_num_ublk_poll_groups; i++) {
 		if (g_ublk_tgt.poll_groups[i].ublk_thread == ublk_thread) {
 			spdk_poller_unregister(&g_ublk_tgt.poll_groups[i].ublk_poller);
+			ublk_poll_group_unregister_interrupt(&g_ublk_tgt.poll_groups[i]);
 			spdk_iobuf_channel_fini(&g_ublk_tgt.poll_groups[i].iobuf_ch);
 			spdk_thread_bind(ublk_thread, false);
 			spdk_thread_exit(ublk_thread);
@@ -942,6 +1061,15 @@ spdk_ublk_write_config_json(struct spdk_json_write_ctx *w)
 		spdk_json_write_named_string(w, "method", "ublk_create_target");
 		spdk_json_write_named_object_begin(w, "params");
 		spdk_json_write_named_string(w, "cpumask", spdk_cpuset_fmt(&g_core_mask));
+		if (g_disable_user_copy) {
+			spdk_json_write_named_bool(w, "disable_user_copy", true);
+		}
+		if (g_disable_fixed_buffers) {
+			spdk_json_write_named_bool(w, "disable_fixed_buffers", true);
+		}
+		if (g_disable_queue_affinity) {
+			spdk_json_write_named_bool(w, "disable_queue_affinity", true);
+		}
 		spdk_json_write_object_end(w);
 
 		spdk_json_write_object_end(w);
@@ -1002,6 +1130,10 @@ ublk_delete_dev(void *arg)
 
 	assert(spdk_thread_is_app_thread(NULL));
 	for (q_idx = 0; q_idx < ublk->num_queues; q_idx++) {
+		if (ublk->queues[q_idx].poll_group != NULL) {
+			assert(ublk->queues[q_idx].poll_group->num_queues > 0);
+			ublk->queues[q_idx].poll_group->num_queues--;
+		}
 		ublk_dev_queue_fini(&ublk->queues[q_idx]);
 	}
 
@@ -1132,6 +1264,7 @@ ublk_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 		      q->q_id, io->tag, res);
 	TAILQ_REMOVE(&q->inflight_io_list, io, tailq);
 	TAILQ_INSERT_TAIL(&q->completed_io_list, io, tailq);
+	ublk_poll_group_notify(q->poll_group);
 
 	if (bdev_io != NULL) {
 		spdk_bdev_free_io(bdev_io);
@@ -1146,16 +1279,27 @@ ublk_queue_user_copy(struct ublk_io *io, bool is_write)
 	struct io_uring_sqe *sqe;
 	uint64_t pos;
 	uint32_t nbytes;
+	int buf_index;
 
 	nbytes = iod->nr_sectors * (1ULL << LINUX_SECTOR_SHIFT);
 	pos = ublk_user_copy_pos(q->q_id, io->tag);
 	sqe = io_uring_get_sqe(&q->ring);
 	assert(sqe);
 
+	/* With a registered buffer, the kernel doesn't have to pin the payload pages for each copy */
+	buf_index = spdk_uring_fixed_bufs_get_index(&q->fixed_bufs, g_ublk_map, io->payload, nbytes);
 	if (is_write) {
-		io_uring_prep_read(sqe, 0, io->payload, nbytes, pos);
+		if (buf_index >= 0) {
+			io_uring_prep_read_fixed(sqe, 0, io->payload, nbytes, pos, buf_index);
+		} else {
+			io_uring_prep_read(sqe, 0, io->payload, nbytes, pos);
+		}
 	} else {
-		io_uring_prep_write(sqe, 0, io->payload, nbytes, pos);
+		if (buf_index >= 0) {
+			io_uring_prep_write_fixed(sqe, 0, io->payload, nbytes, pos, buf_index);
+		} else {
+			io_uring_prep_write(sqe, 0, io->payload, nbytes, pos);
+		}
 	}
 	io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
 	io_uring_sqe_set_data64(sqe, build_user_data(io->tag, 0));
@@ -1163,6 +1307,7 @@ ublk_queue_user_copy(struct ublk_io *io, bool is_write)
 	io->user_copy = true;
 	TAILQ_REMOVE(&q->inflight_io_list, io, tailq);
 	TAILQ_INSERT_TAIL(&q->completed_io_list, io, tailq);
+	ublk_poll_group_notify(q->poll_group);
 }
 
 static void
@@ -1384,6 +1529,9 @@ ublk_io_xmit(struct ublk_queue *q)
 	struct ublk_io *io;
 
 	if (TAILQ_EMPTY(&q->completed_io_list)) {
+		if (spdk_unlikely(ublk_ring_needs_enter(&q->ring))) {
+			io_uring_get_events(&q->ring);
+		}
 		return 0;
 	}
 
@@ -1407,7 +1555,15 @@ ublk_io_xmit(struct ublk_queue *q)
 	}
 
 	q->cmd_inflight += count;
-	rc = io_uring_submit(&q->ring);
+	/*
+	 * The commits, fetches and user copies of the queue are all submitted, and the pending
+	 * completions run, by a single system call.
+	 */
+	if (ublk_ring_needs_enter(&q->ring)) {
+		rc = io_uring_submit_and_get_events(&q->ring);
+	} else {
+		rc = io_uring_submit(&q->ring);
+	}
 	if (rc != count) {
 		SPDK_ERRLOG("could not submit all commands\n");
 		assert(false);
@@ -1440,6 +1596,7 @@ write_get_buffer_done(struct ublk_io *io)
 
 	TAILQ_REMOVE(&io->q->inflight_io_list, io, tailq);
 	TAILQ_INSERT_TAIL(&io->q->completed_io_list, io, tailq);
+	ublk_poll_group_notify(io->q->poll_group);
 }
 
 static int
@@ -1524,6 +1681,10 @@ ublk_poll(void *arg)
 
 	TAILQ_FOREACH_SAFE(q, &poll_group->queue_list, tailq, q_tmp) {
 		sent = ublk_io_xmit(q);
+		/* Nothing is left to submit now, so the registered buffers can change */
+		if (spdk_unlikely(spdk_uring_fixed_bufs_need_sync(&q->fixed_bufs, &g_ublk_bufs))) {
+			spdk_uring_fixed_bufs_sync(&q->fixed_bufs, &q->ring, &g_ublk_bufs);
+		}
 		received = ublk_io_recv(q);
 		if (spdk_unlikely(q->is_stopping)) {
 			ublk_try_close_queue(q);
@@ -1537,6 +1698,119 @@ ublk_poll(void *arg)
 	}
 }
 
+/* Wakes the poll group up to process the queues in interrupt mode */
+static void
+ublk_poll_group_notify(struct ublk_poll_group *poll_group)
+{
+	uint64_t notify = 1;
+
+	if (spdk_likely(!poll_group->interrupt_mode) || poll_group->notified) {
+		return;
+	}
+
+	poll_group->notified = true;
+	if (write(poll_group->efd, &notify, sizeof(notify)) < 0) {
+		SPDK_ERRLOG("Failed to notify %s: %s\n", spdk_thread_get_name(poll_group->ublk_thread),
+			    spdk_strerror(errno));
+	}
+}
+
+static int
+ublk_poll_group_interrupt(void *arg)
+{
+	struct ublk_poll_group *poll_group = arg;
+	struct ublk_queue *q;
+	uint64_t notify;
+	int rc;
+
+	/* Clear the eventfd before polling, so that no event is missed */
+	if (read(poll_group->efd, &notify, sizeof(notify)) < 0 && errno != EAGAIN) {
+		SPDK_ERRLOG("Failed to read the eventfd of %s: %s\n",
+			    spdk_thread_get_name(poll_group->ublk_thread), spdk_strerror(errno));
+	}
+	poll_group->notified = false;
+
+	rc = ublk_poll(poll_group);
+
+	/* The CQEs left over by ublk_io_recv() won't signal the eventfd again */
+	TAILQ_FOREACH(q, &poll_group->queue_list, tailq) {
+		if (io_uring_cq_ready(&q->ring) > 0) {
+			ublk_poll_group_notify(poll_group);
+			break;
+		}
+	}
+
+	return rc;
+}
+
+static void
+ublk_poller_set_interrupt_mode(struct spdk_poller *poller, void *cb_arg, bool interrupt_mode)
+{
+	struct ublk_poll_group *poll_group = cb_arg;
+	struct ublk_queue *q;
+
+	poll_group->interrupt_mode = interrupt_mode;
+	/* The rings only signal the eventfd in interrupt mode */
+	TAILQ_FOREACH(q, &poll_group->queue_list, tailq) {
+		io_uring_cq_eventfd_toggle(&q->ring, interrupt_mode);
+	}
+
+	/* Process what came in before the eventfd was enabled */
+	poll_group->notified = false;
+	ublk_poll_group_notify(poll_group);
+}
+
+static int
+ublk_poll_group_register_interrupt(struct ublk_poll_group *poll_group)
+{
+	int efd;
+
+	efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (efd < 0) {
+		return -errno;
+	}
+
+	poll_group->intr = SPDK_INTERRUPT_REGISTER(efd, ublk_poll_group_interrupt, poll_group);
+	if (poll_group->intr == NULL) {
+		close(efd);
+		return -ENOMEM;
+	}
+	poll_group->efd = efd;
+
+	return 0;
+}
+
+static void
+ublk_poll_group_unregister_interrupt(struct ublk_poll_group *poll_group)
+{
+	if (poll_group->efd < 0) {
+		return;
+	}
+
+	spdk_interrupt_unregister(&poll_group->intr);
+	close(poll_group->efd);
+	poll_group->efd = -1;
+}
+
+static void
+ublk_queue_interrupt_init(struct ublk_queue *q)
+{
+	struct ublk_poll_group *poll_group = q->poll_group;
+	int rc;
+
+	if (poll_group->efd < 0) {
+		return;
+	}
+
+	rc = io_uring_register_eventfd(&q->ring, poll_group->efd);
+	if (rc != 0) {
+		SPDK_ERRLOG("ublk%u: cannot register the eventfd in queue %u: %s\n", q->dev->ublk_id,
+			    q->q_id, spdk_strerror(-rc));
+		return;
+	}
+	io_uring_cq_eventfd_toggle(&q->ring, poll_group->interrupt_mode);
+}
+
 static void
 ublk_bdev_hot_remove(struct spdk_ublk_dev *ublk)
 {
@@ -1581,6 +1855,7 @@ ublk_dev_queue_init(struct ublk_queue *q)
 	uint32_t j;
 	struct spdk_ublk_dev *ublk = q->dev;
 	unsigned long off;
+	unsigned flags;
 
 	cmd_buf_size = ublk_queue_cmd_buf_sz(q->q_depth);
 	off = UBLKSRV_CMD_BUF_OFFSET +
@@ -1599,7 +1874,18 @@ ublk_dev_queue_init(struct ublk_queue *q)
 		q->ios[j].iod = &q->io_cmd_buf[j];
 	}
 
-	rc = ublk_setup_ring(q->q_depth, &q->ring, IORING_SETUP_SQE128);
+	/*
+	 * Only the poll group thread submits to the ring, so the kernel can defer running the
+	 * completions until the thread enters the ring, rather than interrupting it for each one.
+	 * The poll group thread enables the ring.
+	 */
+	flags = IORING_SETUP_SQE128 | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_R_DISABLED |
+		IORING_SETUP_TASKRUN_FLAG;
+	rc = ublk_setup_ring(q->q_depth, &q->ring, flags | IORING_SETUP_DEFER_TASKRUN);
+	if (rc == -EINVAL) {
+		/* IORING_SETUP_DEFER_TASKRUN needs Linux 6.1 */
+		rc = ublk_setup_ring(q->q_depth, &q->ring, flags | IORING_SETUP_COOP_TASKRUN);
+	}
 	if (rc < 0) {
 		SPDK_ERRLOG("Failed at setup uring: %s\n", spdk_strerror(-rc));
 		munmap(q->io_cmd_buf, ublk_queue_cmd_buf_sz(q->q_depth));
@@ -1633,6 +1919,7 @@ ublk_dev_queue_fini(struct ublk_queue *q)
 	if (q->io_cmd_buf) {
 		munmap(q->io_cmd_buf, ublk_queue_cmd_buf_sz(q->q_depth));
 	}
+	spdk_uring_fixed_bufs_fini(&q->fixed_bufs);
 }
 
 static void
@@ -1868,15 +2155,40 @@ ublk_queue_recovery_done(void *arg)
 	}
 }
 
+static void
+ublk_queue_start_failed(void *arg)
+{
+	struct spdk_ublk_dev *ublk = arg;
+
+	if (ublk->ctrl_cb) {
+		ublk->ctrl_cb(ublk->cb_arg, -EIO);
+		ublk->ctrl_cb = NULL;
+	}
+
+	/* The queue never fetched any I/O, so it won't be aborted by the kernel, close it here */
+	ublk_close_dev(ublk);
+	ublk_try_close_dev(ublk);
+}
+
 static void
 ublk_queue_run(void *arg1)
 {
 	struct ublk_queue	*q = arg1;
 	struct spdk_ublk_dev *ublk = q->dev;
 	struct ublk_poll_group *poll_group = q->poll_group;
+	int rc;
 
 	assert(spdk_get_thread() == poll_group->ublk_thread);
+	rc = io_uring_enable_rings(&q->ring);
+	if (rc != 0) {
+		SPDK_ERRLOG("ublk%u: cannot enable the ring of queue %u: %s\n", ublk->ublk_id, q->q_id,
+			    spdk_strerror(-rc));
+		spdk_thread_send_msg(spdk_thread_get_app_thread(), ublk_queue_start_failed, ublk);
+		return;
+	}
 	q->bdev_ch = spdk_bdev_get_io_channel(ublk->bdev_desc);
+	ublk_queue_fixed_bufs_init(q);
+	ublk_queue_interrupt_init(q);
 	/* Queues must be filled with IO in the io pthread */
 	ublk_dev_queue_io_init(q);
 
@@ -1976,6 +2288,50 @@ ublk_start_disk(const char *bdev_name, uint32_t ublk_id,
 	return rc;
 }
 
+/*
+ * Picks the poll group of a queue: preferably one running on a CPU the kernel submits the
+ * requests of the queue from, so that they're handled without bouncing between CPUs, then the
+ * least loaded one, starting from the next one in turn.
+ */
+static struct ublk_poll_group *
+ublk_select_poll_group(struct ublk_queue *q)
+{
+	struct spdk_ublk_dev *ublk = q->dev;
+	struct ublk_poll_group *poll_group, *best = NULL;
+	bool aligned, best_aligned = false;
+	uint32_t i;
+
+	for (i = 0; i < g_num_ublk_poll_groups; i++) {
+		poll_group = &g_ublk_tgt.poll_groups[(g_next_ublk_poll_group + i) % g_num_ublk_poll_groups];
+		aligned = q->has_affinity && CPU_ISSET(poll_group->core, &q->cpuset);
+		if (best == NULL || (aligned && !best_aligned) ||
+		    (aligned == best_aligned && poll_group->num_queues < best->num_queues)) {
+			best = poll_group;
+			best_aligned = aligned;
+		}
+	}
+
+	assert(best != NULL);
+	g_next_ublk_poll_group = (best - g_ublk_tgt.poll_groups + 1) % g_num_ublk_poll_groups;
+	best->num_queues++;
+
+	UBLK_DEBUGLOG(ublk, "queue %u on core %u%s\n", q->q_id, best->core,
+		      best_aligned ? "" : ", not in its blk-mq CPUs");
+
+	return best;
+}
+
+/* Asks the kernel for the blk-mq CPUs of each queue, one at a time, then starts the device */
+static int
+ublk_get_queue_affinity(struct spdk_ublk_dev *ublk)
+{
+	if (!g_ublk_tgt.queue_affinity || ublk->affinity_q_id == ublk->num_queues) {
+		return ublk_start_dev(ublk, ublk->is_recovering);
+	}
+
+	return ublk_ctrl_cmd_submit(ublk, UBLK_CMD_GET_QUEUE_AFFINITY);
+}
+
 static int
 ublk_start_dev(struct spdk_ublk_dev *ublk, bool is_recovering)
 {
@@ -2010,13 +2366,9 @@ ublk_start_dev(struct spdk_ublk_dev *ublk, bool is_recovering)
 
 	/* Send queue to different spdk_threads for load balance */
 	for (q_id = 0; q_id < ublk->num_queues; q_id++) {
-		ublk->queues[q_id].poll_group = &g_ublk_tgt.poll_groups[g_next_ublk_poll_group];
-		ublk_thread = g_ublk_tgt.poll_groups[g_next_ublk_poll_group].ublk_thread;
+		ublk->queues[q_id].poll_group = ublk_select_poll_group(&ublk->queues[q_id]);
+		ublk_thread = ublk->queues[q_id].poll_group->ublk_thread;
 		spdk_thread_send_msg(ublk_thread, ublk_queue_run, &ublk->queues[q_id]);
-		g_next_ublk_poll_group++;
-		if (g_next_ublk_poll_group == g_num_ublk_poll_groups) {
-			g_next_ublk_poll_group = 0;
-		}
 	}
 
 	return 0;
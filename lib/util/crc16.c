@@ -3,8 +3,8 @@
  *   All rights reserved.
  */
 
+#include "crc_internal.h"
 #include "spdk/crc16.h"
-#include "spdk/config.h"
 
 /*
  * Use Intelligent Storage Acceleration Library for line speed CRC
@@ -28,7 +28,8 @@ spdk_crc16_t10dif_copy(uint16_t init_crc, uint8_t *dst, uint8_t *src,
 
 #else
 /*
- * Use table-driven (somewhat faster) CRC
+ * Use table-driven (somewhat faster) CRC, folded with carry-less multiplication for
+ * longer buffers when the CPU supports it
  */
 
 /*
@@ -613,13 +614,31 @@ crc_update_fast(uint16_t crc, const void *data, size_t data_len)
 	return crc & 0xffff;
 }
 
+static struct crc_fold_consts g_crc16_fold;
+static bool g_crc16_use_fold;
+
+__attribute__((constructor)) static void
+crc16_init(void)
+{
+	g_crc16_use_fold = crc_fold_init(&g_crc16_fold, SPDK_T10DIF_CRC16_POLYNOMIAL, 16, false);
+}
+
 static inline uint16_t
-crc16_table_t10dif(uint16_t init_crc, const void *buf, size_t len)
+crc16_t10dif_update(uint16_t init_crc, const void *buf, size_t len)
 {
 	uint16_t crc;
 	const uint8_t *data = (const uint8_t *)buf;
+	uint8_t rem[16];
+	size_t fold_len;
 
 	crc = init_crc;
+	if (g_crc16_use_fold && len >= CRC_FOLD_MIN_LEN) {
+		fold_len = len & ~(size_t)15;
+		crc_fold(&g_crc16_fold, data, fold_len, crc, rem);
+		crc = crc_update_fast(0, rem, sizeof(rem));
+		data += fold_len;
+		len -= fold_len;
+	}
 	crc = crc_update_fast(crc, data, len);
 	return crc;
 }
@@ -627,14 +646,14 @@ crc16_table_t10dif(uint16_t init_crc, const void *buf, size_t len)
 uint16_t
 spdk_crc16_t10dif(uint16_t init_crc, const void *buf, size_t len)
 {
-	return (crc16_table_t10dif(init_crc, buf, len));
+	return (crc16_t10dif_update(init_crc, buf, len));
 }
 
 uint16_t
 spdk_crc16_t10dif_copy(uint16_t init_crc, uint8_t *dst, uint8_t *src, size_t len)
 {
 	memcpy(dst, src, len);
-	return (crc16_table_t10dif(init_crc, src, len));
+	return (crc16_t10dif_update(init_crc, src, len));
 }
 
 #endif
@@ -6,6 +6,7 @@
 #include "util_internal.h"
 #include "crc_internal.h"
 #include "spdk/crc32.h"
+#include "spdk/endian.h"
 
 void
 crc32_table_init(struct spdk_crc32_table *table, uint32_t polynomial_reflect)
@@ -22,58 +23,40 @@ crc32_table_init(struct spdk_crc32_table *table, uint32_t polynomial_reflect)
 				val = (val >> 1);
 			}
 		}
-		table->table[i] = val;
-	}
-}
-
-#ifdef SPDK_HAVE_ARM_CRC
-
-uint32_t
-crc32_update(const struct spdk_crc32_table *table, const void *buf, size_t len, uint32_t crc)
-{
-	size_t count_pre, count_post, count_mid;
-	const uint64_t *dword_buf;
-
-	/* process the head and tail bytes separately to make the buf address
-	 * passed to crc32_d is 8 byte aligned. This can avoid unaligned loads.
-	 */
-	count_pre = ((uint64_t)buf & 7) == 0 ? 0 : 8 - ((uint64_t)buf & 7);
-	count_post = (uint64_t)(buf + len) & 7;
-	count_mid = (len - count_pre - count_post) / 8;
-
-	while (count_pre--) {
-		crc = __crc32b(crc, *(const uint8_t *)buf);
-		buf++;
+		table->table[0][i] = val;
 	}
 
-	dword_buf = (const uint64_t *)buf;
-	while (count_mid--) {
-		crc = __crc32d(crc, *dword_buf);
-		dword_buf++;
-	}
-
-	buf = dword_buf;
-	while (count_post--) {
-		crc = __crc32b(crc, *(const uint8_t *)buf);
-		buf++;
+	/* table[j][i] is the CRC of byte i followed by j zero bytes */
+	for (j = 1; j < 8; j++) {
+		for (i = 0; i < 256; i++) {
+			val = table->table[j - 1][i];
+			table->table[j][i] = (val >> 8) ^ table->table[0][val & 0xff];
+		}
 	}
-
-	return crc;
 }
 
-#else
-
 uint32_t
 crc32_update(const struct spdk_crc32_table *table, const void *buf, size_t len, uint32_t crc)
 {
 	const uint8_t *buf_u8 = buf;
-	size_t i;
+	uint64_t val;
+
+	/* Slicing-by-8: process 8 bytes per iteration with independent table lookups */
+	for (; len >= 8; buf_u8 += 8, len -= 8) {
+		val = from_le64(buf_u8) ^ crc;
+		crc = table->table[7][val & 0xff] ^
+		      table->table[6][(val >> 8) & 0xff] ^
+		      table->table[5][(val >> 16) & 0xff] ^
+		      table->table[4][(val >> 24) & 0xff] ^
+		      table->table[3][(val >> 32) & 0xff] ^
+		      table->table[2][(val >> 40) & 0xff] ^
+		      table->table[1][(val >> 48) & 0xff] ^
+		      table->table[0][val >> 56];
+	}
 
-	for (i = 0; i < len; i++) {
-		crc = (crc >> 8) ^ table->table[(crc ^ buf_u8[i]) & 0xff];
+	for (; len > 0; buf_u8++, len--) {
+		crc = (crc >> 8) ^ table->table[0][(crc ^ *buf_u8) & 0xff];
 	}
 
 	return crc;
 }
-
-#endif
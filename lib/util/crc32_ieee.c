@@ -4,18 +4,92 @@
  */
 
 #include "util_internal.h"
+#include "crc_internal.h"
 #include "spdk/crc32.h"
+#include "spdk/likely.h"
+#include "spdk/util.h"
+
+/* IEEE CRC-32 polynomial, in normal representation */
+#define CRC32_IEEE_POLYNOMIAL 0x04c11db7UL
 
 static struct spdk_crc32_table g_crc32_ieee_table;
+static struct crc_fold_consts g_crc32_ieee_fold;
+static bool g_crc32_ieee_use_fold;
+
+/* x86 only provides an instruction for CRC-32C */
+#if defined(SPDK_HAVE_CRC32_HW) && defined(__aarch64__)
+#define CRC32_IEEE_HAVE_HW
+
+static bool g_crc32_ieee_use_hw;
+
+static uint32_t
+crc32_ieee_update_hw(const void *buf, size_t len, uint32_t crc)
+{
+	size_t count_pre, count_post, count_mid;
+	const uint64_t *dword_buf;
+
+	/* process the head and tail bytes separately to make the buf address
+	 * passed to crc32_d is 8 byte aligned. This can avoid unaligned loads.
+	 */
+	count_pre = spdk_min(len, (8 - ((uintptr_t)buf & 7)) & 7);
+	count_mid = (len - count_pre) / 8;
+	count_post = (len - count_pre) & 7;
+
+	while (count_pre--) {
+		crc = __crc32b(crc, *(const uint8_t *)buf);
+		buf++;
+	}
+
+	dword_buf = (const uint64_t *)buf;
+	while (count_mid--) {
+		crc = __crc32d(crc, *dword_buf);
+		dword_buf++;
+	}
+
+	buf = dword_buf;
+	while (count_post--) {
+		crc = __crc32b(crc, *(const uint8_t *)buf);
+		buf++;
+	}
+
+	return crc;
+}
+#endif
 
 __attribute__((constructor)) static void
 crc32_ieee_init(void)
 {
 	crc32_table_init(&g_crc32_ieee_table, SPDK_CRC32_POLYNOMIAL_REFLECT);
+#ifdef CRC32_IEEE_HAVE_HW
+	g_crc32_ieee_use_hw = crc32_hw_available();
+#endif
+	g_crc32_ieee_use_fold = crc_fold_init(&g_crc32_ieee_fold, CRC32_IEEE_POLYNOMIAL, 32, true);
+}
+
+static inline uint32_t
+crc32_ieee_update(const void *buf, size_t len, uint32_t crc)
+{
+#ifdef CRC32_IEEE_HAVE_HW
+	if (spdk_likely(g_crc32_ieee_use_hw)) {
+		return crc32_ieee_update_hw(buf, len, crc);
+	}
+#endif
+	return crc32_update(&g_crc32_ieee_table, buf, len, crc);
 }
 
 uint32_t
 spdk_crc32_ieee_update(const void *buf, size_t len, uint32_t crc)
 {
-	return crc32_update(&g_crc32_ieee_table, buf, len, crc);
+	uint8_t rem[16];
+	size_t fold_len;
+
+	if (g_crc32_ieee_use_fold && len >= CRC_FOLD_MIN_LEN) {
+		fold_len = len & ~(size_t)15;
+		crc_fold(&g_crc32_ieee_fold, buf, fold_len, crc, rem);
+		crc = crc32_ieee_update(rem, sizeof(rem), 0);
+		buf = (const uint8_t *)buf + fold_len;
+		len -= fold_len;
+	}
+
+	return crc32_ieee_update(buf, len, crc);
 }
@@ -6,6 +6,8 @@
 #include "util_internal.h"
 #include "crc_internal.h"
 #include "spdk/crc32.h"
+#include "spdk/likely.h"
+#include "spdk/util.h"
 
 #ifdef SPDK_HAVE_ISAL
 
@@ -15,10 +17,26 @@ spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 	return crc32_iscsi((unsigned char *)buf, len, crc);
 }
 
-#elif defined(SPDK_HAVE_SSE4_2)
+#else
 
-uint32_t
-spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
+/* CRC-32C (Castagnoli) polynomial, in normal representation */
+#define CRC32C_POLYNOMIAL 0x1edc6f41UL
+
+/*
+ * The CRC-32C instruction is already fast, folding only pays off for longer buffers,
+ * where the instruction is limited by its latency
+ */
+#define CRC32C_FOLD_MIN_LEN 128
+
+static struct spdk_crc32_table g_crc32c_table;
+static struct crc_fold_consts g_crc32c_fold;
+static bool g_crc32c_use_hw;
+static bool g_crc32c_use_fold;
+
+#if defined(SPDK_HAVE_CRC32_HW) && defined(__x86_64__)
+
+SPDK_CRC32_HW_TARGET static uint32_t
+crc32c_update_hw(const void *buf, size_t len, uint32_t crc)
 {
 	size_t count_pre, count_post, count_mid;
 	const uint64_t *dword_buf;
@@ -27,9 +45,9 @@ spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 	/* process the head and tail bytes separately to make the buf address
 	 * passed to _mm_crc32_u64 is 8 byte aligned. This can avoid unaligned loads.
 	 */
-	count_pre = ((uint64_t)buf & 7) == 0 ? 0 : 8 - ((uint64_t)buf & 7);
-	count_post = (uint64_t)((uintptr_t)buf + len) & 7;
-	count_mid = (len - count_pre - count_post) / 8;
+	count_pre = spdk_min(len, (8 - ((uintptr_t)buf & 7)) & 7);
+	count_mid = (len - count_pre) / 8;
+	count_post = (len - count_pre) & 7;
 
 	while (count_pre--) {
 		crc = _mm_crc32_u8(crc, *(const uint8_t *)buf);
@@ -55,10 +73,10 @@ spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 	return crc;
 }
 
-#elif defined(SPDK_HAVE_ARM_CRC)
+#elif defined(SPDK_HAVE_CRC32_HW)
 
-uint32_t
-spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
+static uint32_t
+crc32c_update_hw(const void *buf, size_t len, uint32_t crc)
 {
 	size_t count_pre, count_post, count_mid;
 	const uint64_t *dword_buf;
@@ -66,9 +84,9 @@ spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 	/* process the head and tail bytes separately to make the buf address
 	 * passed to crc32_cd is 8 byte aligned. This can avoid unaligned loads.
 	 */
-	count_pre = ((uint64_t)buf & 7) == 0 ? 0 : 8 - ((uint64_t)buf & 7);
-	count_post = (uint64_t)(buf + len) & 7;
-	count_mid = (len - count_pre - count_post) / 8;
+	count_pre = spdk_min(len, (8 - ((uintptr_t)buf & 7)) & 7);
+	count_mid = (len - count_pre) / 8;
+	count_post = (len - count_pre) & 7;
 
 	while (count_pre--) {
 		crc = __crc32cb(crc, *(const uint8_t *)buf);
@@ -90,20 +108,44 @@ spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 	return crc;
 }
 
-#else /* Neither SSE 4.2 nor ARM CRC32 instructions available */
-
-static struct spdk_crc32_table g_crc32c_table;
+#endif
 
 __attribute__((constructor)) static void
 crc32c_init(void)
 {
 	crc32_table_init(&g_crc32c_table, SPDK_CRC32C_POLYNOMIAL_REFLECT);
+#ifdef SPDK_HAVE_CRC32_HW
+	g_crc32c_use_hw = crc32_hw_available();
+#endif
+	g_crc32c_use_fold = crc_fold_init(&g_crc32c_fold, CRC32C_POLYNOMIAL, 32, true);
+}
+
+static inline uint32_t
+crc32c_update(const void *buf, size_t len, uint32_t crc)
+{
+#ifdef SPDK_HAVE_CRC32_HW
+	if (spdk_likely(g_crc32c_use_hw)) {
+		return crc32c_update_hw(buf, len, crc);
+	}
+#endif
+	return crc32_update(&g_crc32c_table, buf, len, crc);
 }
 
 uint32_t
 spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 {
-	return crc32_update(&g_crc32c_table, buf, len, crc);
+	uint8_t rem[16];
+	size_t fold_len;
+
+	if (g_crc32c_use_fold && len >= CRC32C_FOLD_MIN_LEN) {
+		fold_len = len & ~(size_t)15;
+		crc_fold(&g_crc32c_fold, buf, fold_len, crc, rem);
+		crc = crc32c_update(rem, sizeof(rem), 0);
+		buf = (const uint8_t *)buf + fold_len;
+		len -= fold_len;
+	}
+
+	return crc32c_update(buf, len, crc);
 }
 
 #endif
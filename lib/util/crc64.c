@@ -5,6 +5,7 @@
 
 #include "crc_internal.h"
 #include "spdk/crc64.h"
+#include "spdk/endian.h"
 
 #ifdef SPDK_CONFIG_ISAL
 #include "isa-l/include/crc64.h"
@@ -148,22 +149,71 @@ static const uint64_t crc64_rocksoft_refl_table[256] = {
 	0x55b4a08fdfd90e51ULL, 0x2ada5047efec8728ULL
 };
 
+/* CRC-64/NVME polynomial, in normal representation */
+#define CRC64_NVME_POLYNOMIAL 0xad93d23594c93659ULL
+
+/* Slicing-by-8 tables, generated from crc64_rocksoft_refl_table */
+static uint64_t g_crc64_table[8][256];
+static struct crc_fold_consts g_crc64_fold;
+static bool g_crc64_use_fold;
+
+__attribute__((constructor)) static void
+crc64_init(void)
+{
+	uint64_t val;
+	int i, j;
+
+	memcpy(g_crc64_table[0], crc64_rocksoft_refl_table, sizeof(g_crc64_table[0]));
+	for (j = 1; j < 8; j++) {
+		for (i = 0; i < 256; i++) {
+			val = g_crc64_table[j - 1][i];
+			g_crc64_table[j][i] = (val >> 8) ^ g_crc64_table[0][val & 0xff];
+		}
+	}
+
+	g_crc64_use_fold = crc_fold_init(&g_crc64_fold, CRC64_NVME_POLYNOMIAL, 64, true);
+}
+
 static inline uint64_t
-crc64_rocksoft_refl_base(uint64_t seed, const uint8_t *buf, uint64_t len)
+crc64_rocksoft_refl_base(uint64_t crc, const uint8_t *buf, uint64_t len)
 {
-	uint64_t i, crc = ~seed;
+	uint64_t val;
+
+	for (; len >= 8; buf += 8, len -= 8) {
+		val = from_le64(buf) ^ crc;
+		crc = g_crc64_table[7][val & 0xff] ^
+		      g_crc64_table[6][(val >> 8) & 0xff] ^
+		      g_crc64_table[5][(val >> 16) & 0xff] ^
+		      g_crc64_table[4][(val >> 24) & 0xff] ^
+		      g_crc64_table[3][(val >> 32) & 0xff] ^
+		      g_crc64_table[2][(val >> 40) & 0xff] ^
+		      g_crc64_table[1][(val >> 48) & 0xff] ^
+		      g_crc64_table[0][val >> 56];
+	}
 
-	for (i = 0; i < len; i++) {
-		uint8_t byte = buf[i];
-		crc = crc64_rocksoft_refl_table[(uint8_t) crc ^ byte] ^ (crc >> 8);
+	for (; len > 0; buf++, len--) {
+		crc = crc64_rocksoft_refl_table[(uint8_t) crc ^ *buf] ^ (crc >> 8);
 	}
 
-	return ~crc;
+	return crc;
 }
 
 uint64_t
 spdk_crc64_nvme(const void *buf, size_t len, uint64_t crc)
 {
-	return crc64_rocksoft_refl_base(crc, (const uint8_t *)buf, len);
+	const uint8_t *data = buf;
+	uint8_t rem[16];
+	size_t fold_len;
+
+	crc = ~crc;
+	if (g_crc64_use_fold && len >= CRC_FOLD_MIN_LEN) {
+		fold_len = len & ~(size_t)15;
+		crc_fold(&g_crc64_fold, data, fold_len, crc, rem);
+		crc = crc64_rocksoft_refl_base(0, rem, sizeof(rem));
+		data += fold_len;
+		len -= fold_len;
+	}
+
+	return ~crc64_rocksoft_refl_base(crc, data, len);
 }
 #endif
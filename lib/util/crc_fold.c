@@ -0,0 +1,352 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "crc_internal.h"
+#include "spdk/util.h"
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+
+static bool
+crc_arm_hwcap(unsigned long cap)
+{
+	return (getauxval(AT_HWCAP) & cap) == cap;
+}
+#endif
+
+bool
+crc32_hw_available(void)
+{
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+#elif defined(SPDK_HAVE_CRC32_HW) && defined(__linux__)
+	return crc_arm_hwcap(HWCAP_CRC32);
+#elif defined(SPDK_HAVE_CRC32_HW)
+	return true;
+#else
+	return false;
+#endif
+}
+
+static bool
+crc_fold_available(void)
+{
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#elif defined(SPDK_HAVE_CRC_FOLD) && defined(__linux__)
+	return crc_arm_hwcap(HWCAP_PMULL);
+#elif defined(SPDK_HAVE_CRC_FOLD)
+	return true;
+#else
+	return false;
+#endif
+}
+
+static bool
+crc_fold_wide_available(void)
+{
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	return crc_fold_available() && __builtin_cpu_supports("avx2") &&
+	       __builtin_cpu_supports("vpclmulqdq");
+#else
+	return false;
+#endif
+}
+
+/* Calculate x^n mod P, in normal representation */
+static uint64_t
+crc_xpow_mod(uint32_t n, uint64_t poly, uint32_t width)
+{
+	uint64_t msb = 1ULL << (width - 1);
+	uint64_t mask = msb | (msb - 1);
+	uint64_t rem = 1;
+	bool carry;
+
+	while (n--) {
+		carry = rem & msb;
+		rem = (rem << 1) & mask;
+		if (carry) {
+			rem ^= poly;
+		}
+	}
+
+	return rem;
+}
+
+static uint64_t
+crc_bit_reverse64(uint64_t val)
+{
+	uint64_t rev = 0;
+	int i;
+
+	for (i = 0; i < 64; i++) {
+		rev = (rev << 1) | ((val >> i) & 1);
+	}
+
+	return rev;
+}
+
+bool
+crc_fold_init(struct crc_fold_consts *consts, uint64_t poly, uint32_t width, bool reflected)
+{
+	static const uint32_t distance[] = { 1024, 768, 512, 384, 256, 128 };
+	uint32_t i, dist;
+
+	assert(width > 0 && width <= 64);
+
+	consts->width = width;
+	consts->reflected = reflected;
+
+	/*
+	 * Folding a 128-bit block A = H * x^64 + L by dist bits multiplies both of its
+	 * halves by x^(dist + 64) mod P and x^dist mod P respectively.  For reflected CRCs,
+	 * the lower half of the register holds the higher degree coefficients and the
+	 * carry-less product of two reflected values comes out multiplied by x, hence the
+	 * adjusted exponents.  The multiplier for the lower half of the register is stored in
+	 * k[][0] and the one for the upper half in k[][1].
+	 */
+	for (i = 0; i < SPDK_COUNTOF(distance); i++) {
+		dist = distance[i];
+		if (reflected) {
+			consts->k[i][0] = crc_bit_reverse64(crc_xpow_mod(dist + 63, poly, width));
+			consts->k[i][1] = crc_bit_reverse64(crc_xpow_mod(dist - 1, poly, width));
+		} else {
+			consts->k[i][0] = crc_xpow_mod(dist, poly, width);
+			consts->k[i][1] = crc_xpow_mod(dist + 64, poly, width);
+		}
+	}
+
+	consts->wide = crc_fold_wide_available();
+
+	return crc_fold_available();
+}
+
+#if defined(__x86_64__)
+
+SPDK_CRC_FOLD_TARGET static inline __m128i
+crc_fold_load(const uint8_t *buf, bool reflected)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i val = _mm_loadu_si128((const __m128i *)buf);
+
+	return reflected ? val : _mm_shuffle_epi8(val, bswap);
+}
+
+SPDK_CRC_FOLD_TARGET static inline __m128i
+crc_fold_128(__m128i val, const uint64_t *k)
+{
+	__m128i mul = _mm_loadu_si128((const __m128i *)k);
+
+	return _mm_xor_si128(_mm_clmulepi64_si128(val, mul, 0x00),
+			     _mm_clmulepi64_si128(val, mul, 0x11));
+}
+
+SPDK_CRC_FOLD_TARGET static inline void
+crc_fold_store(uint8_t *rem, __m128i val, bool reflected)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+	_mm_storeu_si128((__m128i *)rem, reflected ? val : _mm_shuffle_epi8(val, bswap));
+}
+
+/*
+ * 256-bit variant of the kernel, folding two 128-bit blocks per instruction.  Each 256-bit
+ * register holds two consecutive blocks, the earlier one in the lower half.
+ */
+#define CRC_FOLD_WIDE_TARGET __attribute__((target("avx2,pclmul,vpclmulqdq,sse4.1")))
+#define CRC_FOLD_WIDE_MIN_LEN	256
+
+CRC_FOLD_WIDE_TARGET static inline __m256i
+crc_fold_wide_load(const uint8_t *buf, bool reflected)
+{
+	const __m256i bswap = _mm256_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+					      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m256i val = _mm256_loadu_si256((const __m256i *)buf);
+
+	return reflected ? val : _mm256_shuffle_epi8(val, bswap);
+}
+
+CRC_FOLD_WIDE_TARGET static inline __m256i
+crc_fold_256(__m256i val, const uint64_t *k)
+{
+	__m256i mul = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)k));
+
+	return _mm256_xor_si256(_mm256_clmulepi64_epi128(val, mul, 0x00),
+				_mm256_clmulepi64_epi128(val, mul, 0x11));
+}
+
+CRC_FOLD_WIDE_TARGET static void
+crc_fold_wide(const struct crc_fold_consts *consts, const uint8_t *data, size_t len,
+	      uint64_t crc, uint8_t *rem)
+{
+	bool reflected = consts->reflected;
+	__m256i y0, y1, y2, y3;
+	__m128i x0;
+
+	y0 = crc_fold_wide_load(data, reflected);
+	y1 = crc_fold_wide_load(data + 32, reflected);
+	y2 = crc_fold_wide_load(data + 64, reflected);
+	y3 = crc_fold_wide_load(data + 96, reflected);
+	if (reflected) {
+		y0 = _mm256_xor_si256(y0, _mm256_set_epi64x(0, 0, 0, crc));
+	} else {
+		y0 = _mm256_xor_si256(y0, _mm256_set_epi64x(0, 0, crc << (64 - consts->width), 0));
+	}
+
+	for (data += 128, len -= 128; len >= 128; data += 128, len -= 128) {
+		y0 = _mm256_xor_si256(crc_fold_256(y0, consts->k[0]), crc_fold_wide_load(data, reflected));
+		y1 = _mm256_xor_si256(crc_fold_256(y1, consts->k[0]), crc_fold_wide_load(data + 32, reflected));
+		y2 = _mm256_xor_si256(crc_fold_256(y2, consts->k[0]), crc_fold_wide_load(data + 64, reflected));
+		y3 = _mm256_xor_si256(crc_fold_256(y3, consts->k[0]), crc_fold_wide_load(data + 96, reflected));
+	}
+
+	y0 = _mm256_xor_si256(_mm256_xor_si256(crc_fold_256(y0, consts->k[1]),
+					       crc_fold_256(y1, consts->k[2])),
+			      _mm256_xor_si256(crc_fold_256(y2, consts->k[4]), y3));
+
+	for (; len >= 32; data += 32, len -= 32) {
+		y0 = _mm256_xor_si256(crc_fold_256(y0, consts->k[4]), crc_fold_wide_load(data, reflected));
+	}
+
+	x0 = _mm_xor_si128(crc_fold_128(_mm256_castsi256_si128(y0), consts->k[5]),
+			   _mm256_extracti128_si256(y0, 1));
+	if (len > 0) {
+		x0 = _mm_xor_si128(crc_fold_128(x0, consts->k[5]), crc_fold_load(data, reflected));
+	}
+
+	crc_fold_store(rem, x0, reflected);
+}
+
+SPDK_CRC_FOLD_TARGET void
+crc_fold(const struct crc_fold_consts *consts, const void *buf, size_t len, uint64_t crc,
+	 uint8_t *rem)
+{
+	const uint8_t *data = buf;
+	bool reflected = consts->reflected;
+	__m128i x0, x1, x2, x3;
+
+	assert(len >= CRC_FOLD_MIN_LEN && len % 16 == 0);
+
+	if (consts->wide && len >= CRC_FOLD_WIDE_MIN_LEN) {
+		crc_fold_wide(consts, data, len, crc, rem);
+		return;
+	}
+
+	x0 = crc_fold_load(data, reflected);
+	x1 = crc_fold_load(data + 16, reflected);
+	x2 = crc_fold_load(data + 32, reflected);
+	x3 = crc_fold_load(data + 48, reflected);
+	if (reflected) {
+		x0 = _mm_xor_si128(x0, _mm_set_epi64x(0, crc));
+	} else {
+		x0 = _mm_xor_si128(x0, _mm_set_epi64x(crc << (64 - consts->width), 0));
+	}
+
+	for (data += 64, len -= 64; len >= 64; data += 64, len -= 64) {
+		x0 = _mm_xor_si128(crc_fold_128(x0, consts->k[2]), crc_fold_load(data, reflected));
+		x1 = _mm_xor_si128(crc_fold_128(x1, consts->k[2]), crc_fold_load(data + 16, reflected));
+		x2 = _mm_xor_si128(crc_fold_128(x2, consts->k[2]), crc_fold_load(data + 32, reflected));
+		x3 = _mm_xor_si128(crc_fold_128(x3, consts->k[2]), crc_fold_load(data + 48, reflected));
+	}
+
+	x0 = _mm_xor_si128(_mm_xor_si128(crc_fold_128(x0, consts->k[3]), crc_fold_128(x1, consts->k[4])),
+			   _mm_xor_si128(crc_fold_128(x2, consts->k[5]), x3));
+
+	for (; len > 0; data += 16, len -= 16) {
+		x0 = _mm_xor_si128(crc_fold_128(x0, consts->k[5]), crc_fold_load(data, reflected));
+	}
+
+	crc_fold_store(rem, x0, reflected);
+}
+
+#elif defined(SPDK_HAVE_CRC_FOLD)
+
+static inline uint64x2_t
+crc_fold_load(const uint8_t *buf, bool reflected)
+{
+	uint8x16_t val = vld1q_u8(buf);
+
+	if (!reflected) {
+		val = vrev64q_u8(val);
+		val = vextq_u8(val, val, 8);
+	}
+
+	return vreinterpretq_u64_u8(val);
+}
+
+static inline uint64x2_t
+crc_fold_128(uint64x2_t val, const uint64_t *k)
+{
+	poly128_t lo, hi;
+
+	lo = vmull_p64((poly64_t)vgetq_lane_u64(val, 0), (poly64_t)k[0]);
+	hi = vmull_p64((poly64_t)vgetq_lane_u64(val, 1), (poly64_t)k[1]);
+
+	return veorq_u64(vreinterpretq_u64_p128(lo), vreinterpretq_u64_p128(hi));
+}
+
+static inline void
+crc_fold_store(uint8_t *rem, uint64x2_t val, bool reflected)
+{
+	uint8x16_t out = vreinterpretq_u8_u64(val);
+
+	if (!reflected) {
+		out = vrev64q_u8(out);
+		out = vextq_u8(out, out, 8);
+	}
+	vst1q_u8(rem, out);
+}
+
+void
+crc_fold(const struct crc_fold_consts *consts, const void *buf, size_t len, uint64_t crc,
+	 uint8_t *rem)
+{
+	const uint8_t *data = buf;
+	bool reflected = consts->reflected;
+	uint64x2_t x0, x1, x2, x3;
+
+	assert(len >= CRC_FOLD_MIN_LEN && len % 16 == 0);
+
+	x0 = crc_fold_load(data, reflected);
+	x1 = crc_fold_load(data + 16, reflected);
+	x2 = crc_fold_load(data + 32, reflected);
+	x3 = crc_fold_load(data + 48, reflected);
+	if (reflected) {
+		x0 = veorq_u64(x0, vsetq_lane_u64(crc, vdupq_n_u64(0), 0));
+	} else {
+		x0 = veorq_u64(x0, vsetq_lane_u64(crc << (64 - consts->width), vdupq_n_u64(0), 1));
+	}
+
+	for (data += 64, len -= 64; len >= 64; data += 64, len -= 64) {
+		x0 = veorq_u64(crc_fold_128(x0, consts->k[2]), crc_fold_load(data, reflected));
+		x1 = veorq_u64(crc_fold_128(x1, consts->k[2]), crc_fold_load(data + 16, reflected));
+		x2 = veorq_u64(crc_fold_128(x2, consts->k[2]), crc_fold_load(data + 32, reflected));
+		x3 = veorq_u64(crc_fold_128(x3, consts->k[2]), crc_fold_load(data + 48, reflected));
+	}
+
+	x0 = veorq_u64(veorq_u64(crc_fold_128(x0, consts->k[3]), crc_fold_128(x1, consts->k[4])),
+		       veorq_u64(crc_fold_128(x2, consts->k[5]), x3));
+
+	for (; len > 0; data += 16, len -= 16) {
+		x0 = veorq_u64(crc_fold_128(x0, consts->k[5]), crc_fold_load(data, reflected));
+	}
+
+	crc_fold_store(rem, x0, reflected);
+}
+
+#else
+
+void
+crc_fold(const struct crc_fold_consts *consts, const void *buf, size_t len, uint64_t crc,
+	 uint8_t *rem)
+{
+	/* crc_fold_init() returns false on these CPUs */
+	assert(false);
+	abort();
+}
+
+#endif
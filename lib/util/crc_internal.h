@@ -7,16 +7,93 @@
 #define SPDK_CRC_INTERNAL_H
 
 #include "spdk/config.h"
+#include "spdk/stdinc.h"
 
 #ifdef SPDK_CONFIG_ISAL
 #define SPDK_HAVE_ISAL
 #include <isa-l/include/crc.h>
-#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
-#define SPDK_HAVE_ARM_CRC
-#include <arm_acle.h>
-#elif defined(__x86_64__) && defined(__SSE4_2__)
-#define SPDK_HAVE_SSE4_2
+#endif
+
+/*
+ * CRCs that ISA-L doesn't provide, or all of them if SPDK is built without ISA-L, are
+ * calculated by the kernels below, selected at startup depending on the features of the
+ * CPU we're running on.  On x86, they're built with function-level target attributes, so
+ * they're also available to binaries built for a baseline x86-64 CPU.  On Arm, they
+ * require the compiler to target the CRC and crypto extensions.
+ */
+#if defined(__x86_64__)
+#define SPDK_HAVE_CRC32_HW
+#define SPDK_HAVE_CRC_FOLD
+#define SPDK_CRC32_HW_TARGET __attribute__((target("sse4.2")))
+#define SPDK_CRC_FOLD_TARGET __attribute__((target("pclmul,sse4.1")))
 #include <x86intrin.h>
+#elif defined(__aarch64__)
+#define SPDK_CRC_FOLD_TARGET
+#ifdef __ARM_FEATURE_CRC32
+#define SPDK_HAVE_CRC32_HW
+#define SPDK_CRC32_HW_TARGET
+#include <arm_acle.h>
 #endif
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)
+#define SPDK_HAVE_CRC_FOLD
+#include <arm_neon.h>
+#endif
+#endif
+
+/*
+ * Shortest buffer that can be folded.  Folding is already faster than the table-driven
+ * implementations at this length.
+ */
+#define CRC_FOLD_MIN_LEN	64
+
+/*
+ * Multipliers used to fold the data 128 or 256 bits at a time with carry-less multiplication
+ * (PCLMULQDQ on x86, PMULL on Arm).  The folding reduces a buffer to a 128-bit value
+ * with the same remainder, which is then passed to a regular CRC implementation.
+ */
+struct crc_fold_consts {
+	/* Multipliers for folding by 1024, 768, 512, 384, 256 and 128 bits */
+	uint64_t	k[6][2];
+	uint32_t	width;
+	bool		reflected;
+	/* Whether the CPU can fold 256 bits per instruction (VPCLMULQDQ) */
+	bool		wide;
+};
+
+/**
+ * Check whether the CPU provides CRC-32 and CRC-32C instructions.
+ */
+bool crc32_hw_available(void);
+
+/**
+ * Calculate the multipliers used to fold a CRC.
+ *
+ * \param consts Constants to initialize.
+ * \param poly CRC polynomial in normal (not bit reflected) representation, without the
+ * implicit x^width term.
+ * \param width Width of the CRC in bits, up to 64.
+ * \param reflected Whether the CRC is bit reflected (LSB first).
+ *
+ * \return true if the CPU supports carry-less multiplication and crc_fold() can be used,
+ * false otherwise.
+ */
+bool crc_fold_init(struct crc_fold_consts *consts, uint64_t poly, uint32_t width,
+		   bool reflected);
+
+/**
+ * Fold a buffer into a 128-bit remainder.
+ *
+ * Continuing a CRC calculation over the 16 bytes stored in rem, starting from 0, gives
+ * the same CRC as calculating it over buf starting from crc.
+ *
+ * \param consts Constants initialized by crc_fold_init().
+ * \param buf Data buffer.
+ * \param len Length of buf in bytes.  Must be a multiple of 16 and at least
+ * CRC_FOLD_MIN_LEN.
+ * \param crc Previous CRC value.
+ * \param rem Buffer of 16 bytes receiving the remainder.
+ */
+void crc_fold(const struct crc_fold_consts *consts, const void *buf, size_t len,
+	      uint64_t crc, uint8_t *rem);
 
 #endif /* SPDK_CRC_INTERNAL_H */
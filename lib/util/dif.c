@@ -717,23 +717,44 @@ _dif_generate(void *_dif, uint64_t guard, uint32_t offset_blocks,
 	}
 }
 
+/*
+ * Get the number of whole blocks, up to max_blocks, left in the current iovec.  The fast
+ * paths below are used when all the iovecs hold whole blocks, which lets them walk the
+ * blocks of each iovec without going through the SGL for every block.
+ */
+static inline uint32_t
+_dif_sgl_get_blocks(struct _dif_sgl *sgl, uint8_t **buf, uint32_t block_size,
+		    uint32_t max_blocks)
+{
+	uint32_t buf_len;
+
+	_dif_sgl_get_buf(sgl, buf, &buf_len);
+
+	return spdk_min(buf_len / block_size, max_blocks);
+}
+
 static void
 dif_generate(struct _dif_sgl *sgl, uint32_t num_blocks, const struct spdk_dif_ctx *ctx)
 {
-	uint32_t offset_blocks;
+	uint32_t offset_blocks = 0, iov_blocks, i;
 	uint8_t *buf;
 	uint64_t guard = 0;
 
-	for (offset_blocks = 0; offset_blocks < num_blocks; offset_blocks++) {
-		_dif_sgl_get_buf(sgl, &buf, NULL);
+	while (offset_blocks < num_blocks) {
+		iov_blocks = _dif_sgl_get_blocks(sgl, &buf, ctx->block_size,
+						 num_blocks - offset_blocks);
 
-		if (ctx->dif_flags & SPDK_DIF_FLAGS_GUARD_CHECK) {
-			guard = _dif_generate_guard(ctx->guard_seed, buf, ctx->guard_interval, ctx->dif_pi_format);
-		}
+		for (i = 0; i < iov_blocks; i++, buf += ctx->block_size) {
+			if (ctx->dif_flags & SPDK_DIF_FLAGS_GUARD_CHECK) {
+				guard = _dif_generate_guard(ctx->guard_seed, buf, ctx->guard_interval,
+							    ctx->dif_pi_format);
+			}
 
-		_dif_generate(buf + ctx->guard_interval, guard, offset_blocks, ctx);
+			_dif_generate(buf + ctx->guard_interval, guard, offset_blocks + i, ctx);
+		}
 
-		_dif_sgl_advance(sgl, ctx->block_size);
+		_dif_sgl_advance(sgl, iov_blocks * ctx->block_size);
+		offset_blocks += iov_blocks;
 	}
 }
 
@@ -952,24 +973,30 @@ static int
 dif_verify(struct _dif_sgl *sgl, uint32_t num_blocks,
 	   const struct spdk_dif_ctx *ctx, struct spdk_dif_error *err_blk)
 {
-	uint32_t offset_blocks;
+	uint32_t offset_blocks = 0, iov_blocks, i;
 	int rc;
 	uint8_t *buf;
 	uint64_t guard = 0;
 
-	for (offset_blocks = 0; offset_blocks < num_blocks; offset_blocks++) {
-		_dif_sgl_get_buf(sgl, &buf, NULL);
+	while (offset_blocks < num_blocks) {
+		iov_blocks = _dif_sgl_get_blocks(sgl, &buf, ctx->block_size,
+						 num_blocks - offset_blocks);
 
-		if (ctx->dif_flags & SPDK_DIF_FLAGS_GUARD_CHECK) {
-			guard = _dif_generate_guard(ctx->guard_seed, buf, ctx->guard_interval, ctx->dif_pi_format);
-		}
+		for (i = 0; i < iov_blocks; i++, buf += ctx->block_size) {
+			if (ctx->dif_flags & SPDK_DIF_FLAGS_GUARD_CHECK) {
+				guard = _dif_generate_guard(ctx->guard_seed, buf, ctx->guard_interval,
+							    ctx->dif_pi_format);
+			}
 
-		rc = _dif_verify(buf + ctx->guard_interval, guard, offset_blocks, ctx, err_blk);
-		if (rc != 0) {
-			return rc;
+			rc = _dif_verify(buf + ctx->guard_interval, guard, offset_blocks + i, ctx,
+					 err_blk);
+			if (rc != 0) {
+				return rc;
+			}
 		}
 
-		_dif_sgl_advance(sgl, ctx->block_size);
+		_dif_sgl_advance(sgl, iov_blocks * ctx->block_size);
+		offset_blocks += iov_blocks;
 	}
 
 	return 0;
@@ -1859,27 +1886,32 @@ static void
 dix_generate(struct _dif_sgl *data_sgl, struct _dif_sgl *md_sgl,
 	     uint32_t num_blocks, const struct spdk_dif_ctx *ctx)
 {
-	uint32_t offset_blocks = 0;
+	uint32_t offset_blocks = 0, iov_blocks, i;
 	uint8_t *data_buf, *md_buf;
 	uint64_t guard;
 
+	/* The metadata is in a single iovec */
+	_dif_sgl_get_buf(md_sgl, &md_buf, NULL);
+
 	while (offset_blocks < num_blocks) {
-		_dif_sgl_get_buf(data_sgl, &data_buf, NULL);
-		_dif_sgl_get_buf(md_sgl, &md_buf, NULL);
+		iov_blocks = _dif_sgl_get_blocks(data_sgl, &data_buf, ctx->block_size,
+						 num_blocks - offset_blocks);
+
+		for (i = 0; i < iov_blocks; i++, data_buf += ctx->block_size, md_buf += ctx->md_size) {
+			guard = 0;
+			if (ctx->dif_flags & SPDK_DIF_FLAGS_GUARD_CHECK) {
+				guard = _dif_generate_guard(ctx->guard_seed, data_buf, ctx->block_size,
+							    ctx->dif_pi_format);
+				guard = _dif_generate_guard(guard, md_buf, ctx->guard_interval,
+							    ctx->dif_pi_format);
+			}
 
-		guard = 0;
-		if (ctx->dif_flags & SPDK_DIF_FLAGS_GUARD_CHECK) {
-			guard = _dif_generate_guard(ctx->guard_seed, data_buf, ctx->block_size,
-						    ctx->dif_pi_format);
-			guard = _dif_generate_guard(guard, md_buf, ctx->guard_interval,
-						    ctx->dif_pi_format);
+			_dif_generate(md_buf + ctx->guard_interval, guard, offset_blocks + i, ctx);
 		}
 
-		_dif_generate(md_buf + ctx->guard_interval, guard, offset_blocks, ctx);
-
-		_dif_sgl_advance(data_sgl, ctx->block_size);
-		_dif_sgl_advance(md_sgl, ctx->md_size);
-		offset_blocks++;
+		_dif_sgl_advance(data_sgl, iov_blocks * ctx->block_size);
+		_dif_sgl_advance(md_sgl, iov_blocks * ctx->md_size);
+		offset_blocks += iov_blocks;
 	}
 }
 
@@ -1965,31 +1997,37 @@ dix_verify(struct _dif_sgl *data_sgl, struct _dif_sgl *md_sgl,
 	   uint32_t num_blocks, const struct spdk_dif_ctx *ctx,
 	   struct spdk_dif_error *err_blk)
 {
-	uint32_t offset_blocks = 0;
+	uint32_t offset_blocks = 0, iov_blocks, i;
 	uint8_t *data_buf, *md_buf;
 	uint64_t guard;
 	int rc;
 
-	while (offset_blocks < num_blocks) {
-		_dif_sgl_get_buf(data_sgl, &data_buf, NULL);
-		_dif_sgl_get_buf(md_sgl, &md_buf, NULL);
+	/* The metadata is in a single iovec */
+	_dif_sgl_get_buf(md_sgl, &md_buf, NULL);
 
-		guard = 0;
-		if (ctx->dif_flags & SPDK_DIF_FLAGS_GUARD_CHECK) {
-			guard = _dif_generate_guard(ctx->guard_seed, data_buf, ctx->block_size,
-						    ctx->dif_pi_format);
-			guard = _dif_generate_guard(guard, md_buf, ctx->guard_interval,
-						    ctx->dif_pi_format);
-		}
+	while (offset_blocks < num_blocks) {
+		iov_blocks = _dif_sgl_get_blocks(data_sgl, &data_buf, ctx->block_size,
+						 num_blocks - offset_blocks);
+
+		for (i = 0; i < iov_blocks; i++, data_buf += ctx->block_size, md_buf += ctx->md_size) {
+			guard = 0;
+			if (ctx->dif_flags & SPDK_DIF_FLAGS_GUARD_CHECK) {
+				guard = _dif_generate_guard(ctx->guard_seed, data_buf, ctx->block_size,
+							    ctx->dif_pi_format);
+				guard = _dif_generate_guard(guard, md_buf, ctx->guard_interval,
+							    ctx->dif_pi_format);
+			}
 
-		rc = _dif_verify(md_buf + ctx->guard_interval, guard, offset_blocks, ctx, err_blk);
-		if (rc != 0) {
-			return rc;
+			rc = _dif_verify(md_buf + ctx->guard_interval, guard, offset_blocks + i, ctx,
+					 err_blk);
+			if (rc != 0) {
+				return rc;
+			}
 		}
 
-		_dif_sgl_advance(data_sgl, ctx->block_size);
-		_dif_sgl_advance(md_sgl, ctx->md_size);
-		offset_blocks++;
+		_dif_sgl_advance(data_sgl, iov_blocks * ctx->block_size);
+		_dif_sgl_advance(md_sgl, iov_blocks * ctx->md_size);
+		offset_blocks += iov_blocks;
 	}
 
 	return 0;
@@ -20,7 +20,8 @@
 #define SPDK_CRC32C_POLYNOMIAL_REFLECT 0x82f63b78UL
 
 struct spdk_crc32_table {
-	uint32_t table[256];
+	/* Slicing-by-8 tables, table[0] being the regular bytewise table */
+	uint32_t table[8][256];
 };
 
 /**
@@ -157,8 +157,16 @@ _comp_reduce_compress(struct spdk_reduce_backing_dev *dev,
 		      struct iovec *dst_iovs, int dst_iovcnt,
 		      struct spdk_reduce_vol_cb_args *cb_arg)
 {
+	struct vbdev_compress *comp_bdev = SPDK_CONTAINEROF(dev, struct vbdev_compress, backing_dev);
 	int rc;
 
+	/* Don't waste a compression pass on data that won't compress, reduce will store the
+	 * chunk uncompressed when the operation fails */
+	if (spdk_accel_compress_is_incompressible(comp_bdev->accel_channel, src_iovs, src_iovcnt)) {
+		cb_arg->cb_fn(cb_arg->cb_arg, -ENOSPC);
+		return;
+	}
+
 	rc = _compress_operation(dev, src_iovs, src_iovcnt, dst_iovs, dst_iovcnt, true, cb_arg);
 	if (rc) {
 		SPDK_ERRLOG("with compress operation code %d (%s)\n", rc, spdk_strerror(-rc));
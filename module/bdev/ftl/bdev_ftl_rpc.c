@@ -205,6 +205,15 @@ rpc_bdev_ftl_unmap(struct spdk_jsonrpc_request *request, const struct spdk_json_
 
 SPDK_RPC_REGISTER("bdev_ftl_unmap", rpc_bdev_ftl_unmap, SPDK_RPC_RUNTIME)
 
+static double
+ftl_stats_waf(const struct ftl_stats *stats, uint64_t write_blocks)
+{
+	/* WAF is calculated against the user data written to the base device by compaction */
+	uint64_t user_blocks = stats->entries[FTL_STATS_TYPE_CMP].write.blocks;
+
+	return user_blocks ? (double)write_blocks / (double)user_blocks : 0.0;
+}
+
 static void
 _rpc_bdev_ftl_get_stats(void *ctx, int rc)
 {
@@ -272,6 +281,19 @@ _rpc_bdev_ftl_get_stats(void *ctx, int rc)
 		spdk_json_write_object_end(w);
 	}
 
+	spdk_json_write_named_object_begin(w, "waf");
+	spdk_json_write_named_double(w, "cmp", ftl_stats_waf(stats,
+				     stats->entries[FTL_STATS_TYPE_CMP].write.blocks));
+	spdk_json_write_named_double(w, "gc", ftl_stats_waf(stats,
+				     stats->entries[FTL_STATS_TYPE_GC].write.blocks));
+	spdk_json_write_named_double(w, "md_base", ftl_stats_waf(stats,
+				     stats->entries[FTL_STATS_TYPE_MD_BASE].write.blocks));
+	spdk_json_write_named_double(w, "total", ftl_stats_waf(stats,
+				     stats->entries[FTL_STATS_TYPE_CMP].write.blocks +
+				     stats->entries[FTL_STATS_TYPE_GC].write.blocks +
+				     stats->entries[FTL_STATS_TYPE_MD_BASE].write.blocks));
+	spdk_json_write_object_end(w);
+
 	spdk_json_write_object_end(w);
 	spdk_jsonrpc_end_result(request, w);
 	free(ftl_stats_ctx);
@@ -38,6 +38,7 @@ static void
 iobuf_write_config_json(struct spdk_json_write_ctx *w)
 {
 	struct spdk_iobuf_opts opts;
+	uint32_t i;
 
 	spdk_iobuf_get_opts(&opts, sizeof(opts));
 
@@ -52,6 +53,19 @@ iobuf_write_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "small_bufsize", opts.small_bufsize);
 	spdk_json_write_named_uint32(w, "large_bufsize", opts.large_bufsize);
 	spdk_json_write_named_bool(w, "enable_numa", opts.enable_numa);
+	if (opts.mid_bufsize[0] != 0) {
+		spdk_json_write_named_array_begin(w, "mid_pool_counts");
+		for (i = 0; i < SPDK_IOBUF_MAX_MID_CLASSES && opts.mid_bufsize[i] != 0; i++) {
+			spdk_json_write_uint64(w, opts.mid_pool_count[i]);
+		}
+		spdk_json_write_array_end(w);
+		spdk_json_write_named_array_begin(w, "mid_bufsizes");
+		for (i = 0; i < SPDK_IOBUF_MAX_MID_CLASSES && opts.mid_bufsize[i] != 0; i++) {
+			spdk_json_write_uint32(w, opts.mid_bufsize[i]);
+		}
+		spdk_json_write_array_end(w);
+	}
+	spdk_json_write_named_uint32(w, "slab_size", opts.slab_size);
 	spdk_json_write_object_end(w);
 	spdk_json_write_object_end(w);
 
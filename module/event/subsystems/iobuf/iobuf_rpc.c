@@ -9,12 +9,39 @@
 #include "spdk/string.h"
 #include "spdk_internal/init.h"
 
+static int
+rpc_decode_mid_pool_counts(const struct spdk_json_val *val, void *out)
+{
+	uint64_t *counts = out;
+	size_t count;
+
+	memset(counts, 0, sizeof(uint64_t) * SPDK_IOBUF_MAX_MID_CLASSES);
+
+	return spdk_json_decode_array(val, spdk_json_decode_uint64, counts, SPDK_IOBUF_MAX_MID_CLASSES,
+				      &count, sizeof(uint64_t));
+}
+
+static int
+rpc_decode_mid_bufsizes(const struct spdk_json_val *val, void *out)
+{
+	uint32_t *bufsizes = out;
+	size_t count;
+
+	memset(bufsizes, 0, sizeof(uint32_t) * SPDK_IOBUF_MAX_MID_CLASSES);
+
+	return spdk_json_decode_array(val, spdk_json_decode_uint32, bufsizes, SPDK_IOBUF_MAX_MID_CLASSES,
+				      &count, sizeof(uint32_t));
+}
+
 static const struct spdk_json_object_decoder rpc_iobuf_set_options_decoders[] = {
 	{"small_pool_count", offsetof(struct spdk_iobuf_opts, small_pool_count), spdk_json_decode_uint64, true},
 	{"large_pool_count", offsetof(struct spdk_iobuf_opts, large_pool_count), spdk_json_decode_uint64, true},
 	{"small_bufsize", offsetof(struct spdk_iobuf_opts, small_bufsize), spdk_json_decode_uint32, true},
 	{"large_bufsize", offsetof(struct spdk_iobuf_opts, large_bufsize), spdk_json_decode_uint32, true},
 	{"enable_numa", offsetof(struct spdk_iobuf_opts, enable_numa), spdk_json_decode_bool, true},
+	{"mid_pool_counts", offsetof(struct spdk_iobuf_opts, mid_pool_count), rpc_decode_mid_pool_counts, true},
+	{"mid_bufsizes", offsetof(struct spdk_iobuf_opts, mid_bufsize), rpc_decode_mid_bufsizes, true},
+	{"slab_size", offsetof(struct spdk_iobuf_opts, slab_size), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -49,7 +76,10 @@ rpc_iobuf_get_stats_done(struct spdk_iobuf_module_stats *modules, uint32_t num_m
 	struct spdk_jsonrpc_request *request = cb_arg;
 	struct spdk_json_write_ctx *w;
 	struct spdk_iobuf_module_stats *it;
-	uint32_t i;
+	struct spdk_iobuf_opts opts;
+	uint32_t i, j;
+
+	spdk_iobuf_get_opts(&opts, sizeof(opts));
 
 	w = spdk_jsonrpc_begin_result(request);
 	spdk_json_write_array_begin(w);
@@ -72,6 +102,32 @@ rpc_iobuf_get_stats_done(struct spdk_iobuf_module_stats *modules, uint32_t num_m
 		spdk_json_write_named_uint64(w, "retry", it->large_pool.retry);
 		spdk_json_write_object_end(w);
 
+		if (opts.mid_bufsize[0] != 0) {
+			spdk_json_write_named_array_begin(w, "mid_pools");
+			for (j = 0; j < SPDK_IOBUF_MAX_MID_CLASSES && opts.mid_bufsize[j] != 0; ++j) {
+				spdk_json_write_object_begin(w);
+				spdk_json_write_named_uint32(w, "bufsize", opts.mid_bufsize[j]);
+				spdk_json_write_named_uint64(w, "cache", it->mid_pool[j].cache);
+				spdk_json_write_named_uint64(w, "main", it->mid_pool[j].main);
+				spdk_json_write_named_uint64(w, "retry", it->mid_pool[j].retry);
+				spdk_json_write_object_end(w);
+			}
+			spdk_json_write_array_end(w);
+		}
+
+		/* Only report the buckets that were hit to keep the output short */
+		spdk_json_write_named_array_begin(w, "wait_histogram");
+		for (j = 0; j < SPDK_IOBUF_WAIT_HIST_BUCKETS; ++j) {
+			if (it->wait_hist[j] == 0) {
+				continue;
+			}
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_uint64(w, "min_us", j == 0 ? 0 : 1ULL << (j - 1));
+			spdk_json_write_named_uint64(w, "count", it->wait_hist[j]);
+			spdk_json_write_object_end(w);
+		}
+		spdk_json_write_array_end(w);
+
 		spdk_json_write_object_end(w);
 	}
 
@@ -10,6 +10,7 @@
 #define SPDK_AIO_MGR_H
 
 #include "spdk/stdinc.h"
+#include "spdk/config.h"
 #include "spdk/queue.h"
 
 struct spdk_aio_mgr_io;
@@ -26,4 +27,25 @@ void spdk_aio_mgr_cancel(struct spdk_aio_mgr *mgr, struct spdk_aio_mgr_io *aio);
 bool spdk_aio_mgr_poll(struct spdk_aio_mgr *mgr); /* Returns true if it did some real work */
 void spdk_aio_mgr_delete(struct spdk_aio_mgr *mgr);
 
+#ifdef SPDK_CONFIG_URING
+/*
+ * io_uring implementation of the interface above.  The I/Os are only queued by read and write,
+ * and submitted in a batch by the next poll.  The descriptors are registered with the ring the
+ * first time they're used, so spdk_uring_mgr_forget_fd() must be called on each manager before
+ * a descriptor is closed, once there are no more I/Os to it.  This frees its slot for the
+ * descriptors sharing it, which use plain descriptors until then.
+ */
+struct spdk_uring_mgr;
+
+struct spdk_uring_mgr *spdk_uring_mgr_create(uint32_t max_aios);
+struct spdk_aio_mgr_io *spdk_uring_mgr_read(struct spdk_uring_mgr *mgr, fsdev_aio_done_cb clb,
+		void *ctx, int fd, uint64_t offs, uint32_t size, struct iovec *iovs, uint32_t iovcnt);
+struct spdk_aio_mgr_io *spdk_uring_mgr_write(struct spdk_uring_mgr *mgr, fsdev_aio_done_cb clb,
+		void *ctx, int fd, uint64_t offs, uint32_t size, const struct iovec *iovs, uint32_t iovcnt);
+void spdk_uring_mgr_cancel(struct spdk_uring_mgr *mgr, struct spdk_aio_mgr_io *aio);
+void spdk_uring_mgr_forget_fd(struct spdk_uring_mgr *mgr, int fd);
+bool spdk_uring_mgr_poll(struct spdk_uring_mgr *mgr); /* Returns true if it did some real work */
+void spdk_uring_mgr_delete(struct spdk_uring_mgr *mgr);
+#endif
+
 #endif /* SPDK_AIO_MGR_H */
@@ -8,10 +8,13 @@
 #include "spdk/config.h"
 #include "spdk/util.h"
 #include "spdk/thread.h"
+#include "spdk/env.h"
 #include "aio_mgr.h"
 #include "fsdev_aio.h"
 
 #define IO_STATUS_ASYNC INT_MIN
+/* Returned by the completion of a metadata operation to run its blocking part once more */
+#define IO_STATUS_AGAIN (INT_MIN + 1)
 
 #ifndef UNUSED
 #define UNUSED(x) (void)(x)
@@ -26,6 +29,14 @@
 #define DEFAULT_XATTR_ENABLED false
 #define DEFAULT_SKIP_RW false
 #define DEFAULT_TIMEOUT_MS 0 /* to prevent the attribute caching */
+#define DEFAULT_MD_THREADS 0
+#define DEFAULT_URING_ENABLED false
+#define MAX_MD_THREADS 64
+/* Size of the ring passing the metadata operations done by the workers back to a channel */
+#define MD_DONE_RING_SIZE 4096
+#define MD_DONE_BATCH 32
+/* Number of directory entries looked up by a worker at a time */
+#define READDIR_BATCH 32
 
 #ifdef SPDK_CONFIG_HAVE_STRUCT_STAT_ST_ATIM
 /* Linux */
@@ -69,9 +80,13 @@ struct spdk_fsdev_file_handle {
 	int fd;
 	struct {
 		DIR *dp;
-		struct dirent *entry;
+		/* Position of the directory stream */
 		off_t offset;
 	} dir;
+#ifdef SPDK_CONFIG_URING
+	/* Set once fd has been used by a ring, which may have registered it */
+	bool uring_used;
+#endif
 	struct spdk_fsdev_file_object *fobject;
 	TAILQ_ENTRY(spdk_fsdev_file_handle) link;
 };
@@ -99,22 +114,78 @@ struct aio_fsdev {
 	struct spdk_fsdev_mount_opts mount_opts;
 	char *root_path;
 	int proc_self_fd;
+	/* Protects the queue of metadata operations */
 	pthread_mutex_t mutex;
+	pthread_cond_t md_cond;
+	TAILQ_HEAD(, aio_fsdev_io) md_queue;
+	pthread_t *md_threads;
+	uint32_t num_md_threads;
+	bool md_stop;
 	struct spdk_fsdev_file_object *root;
 	TAILQ_ENTRY(aio_fsdev) tailq;
 	bool xattr_enabled;
 	bool skip_rw;
+	bool uring_enabled;
 };
 
+/* Directory entry read and looked up by a worker */
+struct lo_dirent {
+	/* Offset of the next entry */
+	off_t off;
+	ino_t ino;
+	bool is_dot;
+	int status;
+	/* O_PATH descriptor of the entry, -1 once the fobject is created */
+	int fd;
+	struct stat stat;
+	char name[NAME_MAX + 1];
+};
+
+struct lo_dirent_batch {
+	/* Offset the worker starts reading at */
+	off_t offset;
+	int status;
+	bool eof;
+	uint32_t count;
+	uint32_t next;
+	struct lo_dirent ents[READDIR_BATCH];
+};
+
+typedef int (*fsdev_op_handler_func)(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io);
+
 struct aio_fsdev_io {
 	struct spdk_aio_mgr_io *aio;
 	struct aio_io_channel *ch;
 	TAILQ_ENTRY(aio_fsdev_io) link;
+	/*
+	 * Metadata operations are split in a blocking part, run by a worker thread, and an optional
+	 * completion part, run back on the thread of the channel, which can access the fobjects.
+	 */
+	struct {
+		fsdev_op_handler_func work;
+		fsdev_op_handler_func done;
+		struct spdk_io_channel *ch;
+		int status;
+		/* O_PATH descriptor of the file looked up by the operation */
+		int fd;
+		/* Descriptor opened by create, open and opendir */
+		int open_fd;
+		DIR *dp;
+		/* Handle closed by release and releasedir */
+		struct spdk_fsdev_file_handle *fhandle;
+		struct stat stat;
+		struct lo_dirent_batch *dirents;
+	} md;
 };
 
 struct aio_io_channel {
 	struct spdk_poller *poller;
 	struct spdk_aio_mgr *mgr;
+#ifdef SPDK_CONFIG_URING
+	/* Created by the first I/O of an fsdev using io_uring */
+	struct spdk_uring_mgr *uring;
+#endif
+	struct spdk_ring *md_done;
 	TAILQ_HEAD(, aio_fsdev_io) ios_in_progress;
 	TAILQ_HEAD(, aio_fsdev_io) ios_to_complete;
 };
@@ -152,6 +223,147 @@ fsdev_aio_is_valid_fhandle(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_hand
 	return fhandle != NULL;
 }
 
+static void
+fsdev_aio_md_queue(struct aio_fsdev *vfsdev, struct aio_fsdev_io *vfsdev_io)
+{
+	pthread_mutex_lock(&vfsdev->mutex);
+	TAILQ_INSERT_TAIL(&vfsdev->md_queue, vfsdev_io, link);
+	pthread_cond_signal(&vfsdev->md_cond);
+	pthread_mutex_unlock(&vfsdev->mutex);
+}
+
+/*
+ * Run a metadata operation.  The work function only issues syscalls and fills the md fields of
+ * the aio_fsdev_io, so it's executed by a worker thread, if there are any, not to stall the
+ * reactor while the backing filesystem is slow.  The done function then runs on the thread of
+ * the channel and returns the status of the operation, or IO_STATUS_AGAIN to run the work
+ * function again.  If done is NULL, the status returned by work is used.
+ */
+static int
+fsdev_aio_md_submit(struct spdk_io_channel *_ch, struct spdk_fsdev_io *fsdev_io,
+		    fsdev_op_handler_func work, fsdev_op_handler_func done)
+{
+	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	int status;
+
+	vfsdev_io->ch = spdk_io_channel_get_ctx(_ch);
+	vfsdev_io->md.ch = _ch;
+	vfsdev_io->md.work = work;
+	vfsdev_io->md.done = done;
+
+	if (vfsdev->num_md_threads != 0) {
+		fsdev_aio_md_queue(vfsdev, vfsdev_io);
+		return IO_STATUS_ASYNC;
+	}
+
+	do {
+		vfsdev_io->md.status = work(_ch, fsdev_io);
+		status = done ? done(_ch, fsdev_io) : vfsdev_io->md.status;
+	} while (status == IO_STATUS_AGAIN);
+
+	return status;
+}
+
+static void
+fsdev_aio_md_complete(struct aio_fsdev_io *vfsdev_io)
+{
+	struct spdk_fsdev_io *fsdev_io = aio_to_fsdev_io(vfsdev_io);
+	int status;
+
+	if (vfsdev_io->md.done) {
+		status = vfsdev_io->md.done(vfsdev_io->md.ch, fsdev_io);
+		if (status == IO_STATUS_AGAIN) {
+			fsdev_aio_md_queue(fsdev_to_aio_fsdev(fsdev_io->fsdev), vfsdev_io);
+			return;
+		}
+	} else {
+		status = vfsdev_io->md.status;
+	}
+
+	spdk_fsdev_io_complete(fsdev_io, status);
+}
+
+static void *
+fsdev_aio_md_worker(void *arg)
+{
+	struct aio_fsdev *vfsdev = arg;
+	struct aio_fsdev_io *vfsdev_io;
+
+	pthread_mutex_lock(&vfsdev->mutex);
+	while (true) {
+		vfsdev_io = TAILQ_FIRST(&vfsdev->md_queue);
+		if (vfsdev_io == NULL) {
+			if (vfsdev->md_stop) {
+				break;
+			}
+
+			pthread_cond_wait(&vfsdev->md_cond, &vfsdev->mutex);
+			continue;
+		}
+
+		TAILQ_REMOVE(&vfsdev->md_queue, vfsdev_io, link);
+		pthread_mutex_unlock(&vfsdev->mutex);
+
+		vfsdev_io->md.status = vfsdev_io->md.work(vfsdev_io->md.ch, aio_to_fsdev_io(vfsdev_io));
+
+		/* The ring is large enough for any sane number of outstanding operations */
+		while (spdk_ring_enqueue(vfsdev_io->ch->md_done, (void **)&vfsdev_io, 1, NULL) != 1) {
+			sched_yield();
+		}
+
+		pthread_mutex_lock(&vfsdev->mutex);
+	}
+	pthread_mutex_unlock(&vfsdev->mutex);
+
+	return NULL;
+}
+
+static void
+fsdev_aio_md_stop_threads(struct aio_fsdev *vfsdev)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&vfsdev->mutex);
+	vfsdev->md_stop = true;
+	pthread_cond_broadcast(&vfsdev->md_cond);
+	pthread_mutex_unlock(&vfsdev->mutex);
+
+	for (i = 0; i < vfsdev->num_md_threads; i++) {
+		pthread_join(vfsdev->md_threads[i], NULL);
+	}
+
+	vfsdev->num_md_threads = 0;
+	free(vfsdev->md_threads);
+	vfsdev->md_threads = NULL;
+}
+
+/* Called through spdk_call_unaffinitized() for the workers not to compete with the reactors */
+static void *
+fsdev_aio_md_start_threads(void *arg)
+{
+	struct aio_fsdev *vfsdev = arg;
+	uint32_t i, num_threads = vfsdev->num_md_threads;
+	int rc;
+
+	vfsdev->num_md_threads = 0;
+	for (i = 0; i < num_threads; i++) {
+		rc = pthread_create(&vfsdev->md_threads[i], NULL, fsdev_aio_md_worker, vfsdev);
+		if (rc != 0) {
+			SPDK_ERRLOG("Could not create metadata thread %" PRIu32 " (err=%d)\n", i, rc);
+			fsdev_aio_md_stop_threads(vfsdev);
+			return NULL;
+		}
+
+		vfsdev->num_md_threads++;
+#if defined(__linux__)
+		pthread_setname_np(vfsdev->md_threads[i], "fsdev_aio_md");
+#endif
+	}
+
+	return vfsdev;
+}
+
 static int
 is_dot_or_dotdot(const char *name)
 {
@@ -287,8 +499,9 @@ file_handle_create(struct spdk_fsdev_file_object *fobject, int fd)
 	return fhandle;
 }
 
+/* Detach the fhandle from its fobject.  The descriptors are closed by file_handle_free(). */
 static void
-file_handle_delete(struct spdk_fsdev_file_handle *fhandle)
+file_handle_detach(struct spdk_fsdev_file_handle *fhandle)
 {
 	struct spdk_fsdev_file_object *fobject = fhandle->fobject;
 
@@ -296,15 +509,50 @@ file_handle_delete(struct spdk_fsdev_file_handle *fhandle)
 	fobject->refcount--;
 	TAILQ_REMOVE(&fobject->handles, fhandle, link);
 	spdk_spin_unlock(&fobject->lock);
+}
 
+static void
+file_handle_free(struct spdk_fsdev_file_handle *fhandle)
+{
 	if (fhandle->dir.dp) {
 		closedir(fhandle->dir.dp);
+	} else {
+		close(fhandle->fd);
 	}
 
-	close(fhandle->fd);
 	free(fhandle);
 }
 
+static void
+file_handle_delete(struct spdk_fsdev_file_handle *fhandle)
+{
+	file_handle_detach(fhandle);
+	file_handle_free(fhandle);
+}
+
+static void
+stat_to_attr(const struct stat *stbuf, struct spdk_fsdev_file_attr *attr)
+{
+	memset(attr, 0, sizeof(*attr));
+
+	attr->ino = stbuf->st_ino;
+	attr->size = stbuf->st_size;
+	attr->blocks = stbuf->st_blocks;
+	attr->atime = stbuf->st_atime;
+	attr->mtime = stbuf->st_mtime;
+	attr->ctime = stbuf->st_ctime;
+	attr->atimensec = ST_ATIM_NSEC(stbuf);
+	attr->mtimensec = ST_MTIM_NSEC(stbuf);
+	attr->ctimensec = ST_CTIM_NSEC(stbuf);
+	attr->mode = stbuf->st_mode;
+	attr->nlink = stbuf->st_nlink;
+	attr->uid = stbuf->st_uid;
+	attr->gid = stbuf->st_gid;
+	attr->rdev = stbuf->st_rdev;
+	attr->blksize = stbuf->st_blksize;
+	attr->valid_ms = DEFAULT_TIMEOUT_MS;
+}
+
 static int
 file_object_fill_attr(struct spdk_fsdev_file_object *fobject, struct spdk_fsdev_file_attr *attr)
 {
@@ -318,24 +566,7 @@ file_object_fill_attr(struct spdk_fsdev_file_object *fobject, struct spdk_fsdev_
 		return res;
 	}
 
-	memset(attr, 0, sizeof(*attr));
-
-	attr->ino = stbuf.st_ino;
-	attr->size = stbuf.st_size;
-	attr->blocks = stbuf.st_blocks;
-	attr->atime = stbuf.st_atime;
-	attr->mtime = stbuf.st_mtime;
-	attr->ctime = stbuf.st_ctime;
-	attr->atimensec = ST_ATIM_NSEC(&stbuf);
-	attr->mtimensec = ST_MTIM_NSEC(&stbuf);
-	attr->ctimensec = ST_CTIM_NSEC(&stbuf);
-	attr->mode = stbuf.st_mode;
-	attr->nlink = stbuf.st_nlink;
-	attr->uid = stbuf.st_uid;
-	attr->gid = stbuf.st_gid;
-	attr->rdev = stbuf.st_rdev;
-	attr->blksize = stbuf.st_blksize;
-	attr->valid_ms = DEFAULT_TIMEOUT_MS;
+	stat_to_attr(&stbuf, attr);
 
 	return 0;
 }
@@ -416,46 +647,52 @@ lo_getattr(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 }
 
 static int
-lo_opendir(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_opendir_work(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
-	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
-	int error;
-	int fd;
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
 	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.opendir.fobject;
-	uint32_t flags = fsdev_io->u_in.opendir.flags;
-	struct spdk_fsdev_file_handle *fhandle = NULL;
-
-	UNUSED(flags);
-
-	if (!fsdev_aio_is_valid_fobject(vfsdev, fobject)) {
-		SPDK_ERRLOG("Invalid fobject: %p\n", fobject);
-		return -EINVAL;
-	}
+	int error, fd;
 
 	fd = openat(fobject->fd, ".", O_RDONLY);
 	if (fd == -1) {
 		error = -errno;
 		SPDK_ERRLOG("openat failed for " FOBJECT_FMT " (err=%d)\n", FOBJECT_ARGS(fobject), error);
-		goto out_err;
+		return error;
 	}
 
-	fhandle = file_handle_create(fobject, fd);
-	if (fhandle == NULL) {
-		error = -ENOMEM;
-		SPDK_ERRLOG("file_handle_create failed for " FOBJECT_FMT " (err=%d)\n", FOBJECT_ARGS(fobject),
-			    error);
-		goto out_err;
-	}
-
-	fhandle->dir.dp = fdopendir(fd);
-	if (fhandle->dir.dp == NULL) {
+	vfsdev_io->md.dp = fdopendir(fd);
+	if (vfsdev_io->md.dp == NULL) {
 		error = -errno;
 		SPDK_ERRLOG("fdopendir failed for " FOBJECT_FMT " (err=%d)\n", FOBJECT_ARGS(fobject), error);
-		goto out_err;
+		close(fd);
+		return error;
+	}
+
+	vfsdev_io->md.open_fd = fd;
+
+	return 0;
+}
+
+static int
+lo_opendir_done(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.opendir.fobject;
+	struct spdk_fsdev_file_handle *fhandle;
+
+	if (vfsdev_io->md.status) {
+		return vfsdev_io->md.status;
+	}
+
+	fhandle = file_handle_create(fobject, vfsdev_io->md.open_fd);
+	if (fhandle == NULL) {
+		SPDK_ERRLOG("file_handle_create failed for " FOBJECT_FMT "\n", FOBJECT_ARGS(fobject));
+		closedir(vfsdev_io->md.dp);
+		return -ENOMEM;
 	}
 
+	fhandle->dir.dp = vfsdev_io->md.dp;
 	fhandle->dir.offset = 0;
-	fhandle->dir.entry = NULL;
 
 	SPDK_DEBUGLOG(fsdev_aio, "OPENDIR succeeded for " FOBJECT_FMT " (fh=%p)\n",
 		      FOBJECT_ARGS(fobject), fhandle);
@@ -463,15 +700,84 @@ lo_opendir(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 	fsdev_io->u_out.opendir.fhandle = fhandle;
 
 	return 0;
+}
 
-out_err:
-	if (fhandle) {
-		file_handle_delete(fhandle);
-	} else if (fd != -1) {
-		close(fd);
+static int
+lo_opendir(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.opendir.fobject;
+	uint32_t flags = fsdev_io->u_in.opendir.flags;
+
+	UNUSED(flags);
+
+	if (!fsdev_aio_is_valid_fobject(vfsdev, fobject)) {
+		SPDK_ERRLOG("Invalid fobject: %p\n", fobject);
+		return -EINVAL;
+	}
+
+	return fsdev_aio_md_submit(ch, fsdev_io, lo_opendir_work, lo_opendir_done);
+}
+
+/* Closing a file can block as long as flushing its data, so it's left to the workers */
+static int
+lo_release_work(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+
+	file_handle_free(vfsdev_io->md.fhandle);
+
+	return 0;
+}
+
+#ifdef SPDK_CONFIG_URING
+static void
+lo_release_forget_fd(struct spdk_io_channel_iter *i)
+{
+	struct spdk_fsdev_io *fsdev_io = spdk_io_channel_iter_get_ctx(i);
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct aio_io_channel *ch = spdk_io_channel_get_ctx(spdk_io_channel_iter_get_channel(i));
+
+	if (ch->uring) {
+		spdk_uring_mgr_forget_fd(ch->uring, vfsdev_io->md.fhandle->fd);
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+lo_release_forget_fd_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_fsdev_io *fsdev_io = spdk_io_channel_iter_get_ctx(i);
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+
+	status = fsdev_aio_md_submit(vfsdev_io->md.ch, fsdev_io, lo_release_work, NULL);
+	if (status != IO_STATUS_ASYNC) {
+		spdk_fsdev_io_complete(fsdev_io, status);
+	}
+}
+#endif
+
+static int
+lo_release_fhandle(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io,
+		   struct spdk_fsdev_file_handle *fhandle)
+{
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+
+	file_handle_detach(fhandle);
+	vfsdev_io->md.fhandle = fhandle;
+
+#ifdef SPDK_CONFIG_URING
+	/* The rings hold a reference to the registered files, drop it before closing them */
+	if (fhandle->uring_used) {
+		vfsdev_io->md.ch = ch;
+		spdk_for_each_channel(&g_aio_fsdev_head, lo_release_forget_fd, fsdev_io,
+				      lo_release_forget_fd_done);
+		return IO_STATUS_ASYNC;
 	}
+#endif
 
-	return error;
+	return fsdev_aio_md_submit(ch, fsdev_io, lo_release_work, NULL);
 }
 
 static int
@@ -494,9 +800,7 @@ lo_releasedir(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 	SPDK_DEBUGLOG(fsdev_aio, "RELEASEDIR succeeded for " FOBJECT_FMT " (fh=%p)\n",
 		      FOBJECT_ARGS(fobject), fhandle);
 
-	file_handle_delete(fhandle);
-
-	return 0;
+	return lo_release_fhandle(ch, fsdev_io, fhandle);
 }
 
 static int
@@ -555,15 +859,16 @@ lo_umount(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 	return 0;
 }
 
+/*
+ * Blocking part of a lookup, safe to be called by the workers: open the file and get its
+ * attributes.  The lookup is finished by lo_lookup_finish() on an SPDK thread.
+ */
 static int
-lo_do_lookup(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fobject,
-	     const char *name, struct spdk_fsdev_file_object **pfobject,
-	     struct spdk_fsdev_file_attr *attr)
+lo_lookup_open(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fobject,
+	       const char *name, int *pfd, struct stat *stat)
 {
 	int newfd;
 	int res;
-	struct stat stat;
-	struct spdk_fsdev_file_object *fobject;
 
 	/* Do not allow escaping root directory */
 	if (parent_fobject == vfsdev->root && strcmp(name, "..") == 0) {
@@ -578,7 +883,7 @@ lo_do_lookup(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fob
 		return res;
 	}
 
-	res = fstatat(newfd, "", &stat, AT_EMPTY_PATH | AT_SYMLINK_NOFOLLOW);
+	res = fstatat(newfd, "", stat, AT_EMPTY_PATH | AT_SYMLINK_NOFOLLOW);
 	if (res == -1) {
 		res = -errno;
 		SPDK_ERRLOG("fstatat(%s) failed with %d\n", name, res);
@@ -586,14 +891,27 @@ lo_do_lookup(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fob
 		return res;
 	}
 
+	*pfd = newfd;
+
+	return 0;
+}
+
+/* Find or create the fobject of a file opened by lo_lookup_open(), consuming its descriptor */
+static int
+lo_lookup_finish(struct spdk_fsdev_file_object *parent_fobject, const char *name, int newfd,
+		 const struct stat *stat, struct spdk_fsdev_file_object **pfobject,
+		 struct spdk_fsdev_file_attr *attr)
+{
+	struct spdk_fsdev_file_object *fobject;
+
 	spdk_spin_lock(&parent_fobject->lock);
-	fobject = lo_find_leaf_unsafe(parent_fobject, stat.st_ino, stat.st_dev);
+	fobject = lo_find_leaf_unsafe(parent_fobject, stat->st_ino, stat->st_dev);
 	if (fobject) {
 		close(newfd);
-		newfd = -1;
-		file_object_ref(fobject); /* reference by a lo_do_lookup caller */
+		file_object_ref(fobject); /* reference by a lo_lookup_finish caller */
 	} else {
-		fobject = file_object_create_unsafe(parent_fobject, newfd, stat.st_ino, stat.st_dev, stat.st_mode);
+		fobject = file_object_create_unsafe(parent_fobject, newfd, stat->st_ino, stat->st_dev,
+						    stat->st_mode);
 	}
 	spdk_spin_unlock(&parent_fobject->lock);
 
@@ -604,15 +922,7 @@ lo_do_lookup(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fob
 	}
 
 	if (attr) {
-		res = file_object_fill_attr(fobject, attr);
-		if (res) {
-			SPDK_ERRLOG("fill_attr(%s) failed with %d\n", name, res);
-			file_object_unref(fobject, 1);
-			if (newfd != -1) {
-				close(newfd);
-			}
-			return res;
-		}
+		stat_to_attr(stat, attr);
 	}
 
 	*pfobject = fobject;
@@ -623,44 +933,79 @@ lo_do_lookup(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fob
 }
 
 static int
-lo_lookup(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_lookup_work(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
 	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
-	int err;
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
 	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.lookup.parent_fobject;
-	char *name = fsdev_io->u_in.lookup.name;
+	int res;
 
 	if (!parent_fobject) {
-		err = file_object_fill_attr(vfsdev->root, &fsdev_io->u_out.lookup.attr);
-		if (err) {
-			SPDK_DEBUGLOG(fsdev_aio, "file_object_fill_attr(root) failed with err=%d\n", err);
-			return err;
+		res = fstatat(vfsdev->root->fd, "", &vfsdev_io->md.stat, AT_EMPTY_PATH | AT_SYMLINK_NOFOLLOW);
+		if (res == -1) {
+			res = -errno;
+			SPDK_DEBUGLOG(fsdev_aio, "fstatat(root) failed with err=%d\n", res);
+			return res;
 		}
 
-		file_object_ref(vfsdev->root);
-		fsdev_io->u_out.lookup.fobject = vfsdev->root;
 		return 0;
 	}
 
-	SPDK_DEBUGLOG(fsdev_aio, "  name %s\n", name);
+	return lo_lookup_open(vfsdev, parent_fobject, fsdev_io->u_in.lookup.name, &vfsdev_io->md.fd,
+			      &vfsdev_io->md.stat);
+}
 
-	/* Don't use is_safe_path_component(), allow "." and ".." for NFS export
-	 * support.
-	 */
-	if (strchr(name, '/')) {
-		return -EINVAL;
+static int
+lo_lookup_done(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.lookup.parent_fobject;
+	char *name = fsdev_io->u_in.lookup.name;
+	int err;
+
+	if (vfsdev_io->md.status) {
+		SPDK_DEBUGLOG(fsdev_aio, "lookup(%s) failed with err=%d\n", name, vfsdev_io->md.status);
+		return vfsdev_io->md.status;
+	}
+
+	if (!parent_fobject) {
+		stat_to_attr(&vfsdev_io->md.stat, &fsdev_io->u_out.lookup.attr);
+		file_object_ref(vfsdev->root);
+		fsdev_io->u_out.lookup.fobject = vfsdev->root;
+		return 0;
 	}
 
-	err = lo_do_lookup(vfsdev, parent_fobject, name, &fsdev_io->u_out.lookup.fobject,
-			   &fsdev_io->u_out.lookup.attr);
+	err = lo_lookup_finish(parent_fobject, name, vfsdev_io->md.fd, &vfsdev_io->md.stat,
+			       &fsdev_io->u_out.lookup.fobject, &fsdev_io->u_out.lookup.attr);
 	if (err) {
-		SPDK_DEBUGLOG(fsdev_aio, "lo_do_lookup(%s) failed with err=%d\n", name, err);
+		SPDK_DEBUGLOG(fsdev_aio, "lo_lookup_finish(%s) failed with err=%d\n", name, err);
 		return err;
 	}
 
 	return 0;
 }
 
+static int
+lo_lookup(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.lookup.parent_fobject;
+	char *name = fsdev_io->u_in.lookup.name;
+
+	if (parent_fobject) {
+		SPDK_DEBUGLOG(fsdev_aio, "  name %s\n", name);
+
+		/* Don't use is_safe_path_component(), allow "." and ".." for NFS export
+		 * support.
+		 */
+		if (strchr(name, '/')) {
+			return -EINVAL;
+		}
+	}
+
+	return fsdev_aio_md_submit(ch, fsdev_io, lo_lookup_work, lo_lookup_done);
+}
+
 /*
  * Change to uid/gid of caller so that file is created with ownership of caller.
  */
@@ -705,92 +1050,166 @@ lo_restore_cred(struct lo_cred *old)
 	}
 }
 
+/*
+ * Read the next batch of directory entries and look them up, so the entries can be passed to the
+ * callback on the SPDK thread without any further syscalls.
+ */
 static int
-lo_readdir(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_readdir_work(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
 	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct lo_dirent_batch *batch = fsdev_to_aio_io(fsdev_io)->md.dirents;
 	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.readdir.fobject;
 	struct spdk_fsdev_file_handle *fhandle = fsdev_io->u_in.readdir.fhandle;
-	uint64_t offset = fsdev_io->u_in.readdir.offset;
-
-	if (!fsdev_aio_is_valid_fobject(vfsdev, fobject)) {
-		SPDK_ERRLOG("Invalid fobject: %p\n", fobject);
-		return -EINVAL;
-	}
-
-	if (!fsdev_aio_is_valid_fhandle(vfsdev, fhandle)) {
-		SPDK_ERRLOG("Invalid fhandle: %p\n", fhandle);
-		return -EINVAL;
-	}
-
-	if (((off_t)offset) != fhandle->dir.offset) {
-		seekdir(fhandle->dir.dp, offset);
-		fhandle->dir.entry = NULL;
-		fhandle->dir.offset = offset;
-	}
-
-	while (1) {
-		off_t nextoff;
-		const char *name;
-		int res;
-
-		if (!fhandle->dir.entry) {
-			errno = 0;
-			fhandle->dir.entry = readdir(fhandle->dir.dp);
-			if (!fhandle->dir.entry) {
-				if (errno) {  /* Error */
-					res = -errno;
-					SPDK_ERRLOG("readdir failed with err=%d", res);
-					return res;
-				} else {  /* End of stream */
-					break;
-				}
+	struct lo_dirent *ent;
+	struct dirent *entry;
+
+	if (batch->offset != fhandle->dir.offset) {
+		seekdir(fhandle->dir.dp, batch->offset);
+		fhandle->dir.offset = batch->offset;
+	}
+
+	batch->count = 0;
+	batch->next = 0;
+	batch->status = 0;
+	batch->eof = false;
+
+	while (batch->count < READDIR_BATCH) {
+		errno = 0;
+		entry = readdir(fhandle->dir.dp);
+		if (!entry) {
+			if (errno) {  /* Error */
+				batch->status = -errno;
+				SPDK_ERRLOG("readdir failed with err=%d", batch->status);
+			} else {  /* End of stream */
+				batch->eof = true;
 			}
+			break;
 		}
 
-		nextoff = fhandle->dir.entry->d_off;
-		name = fhandle->dir.entry->d_name;
+		fhandle->dir.offset = entry->d_off;
 
 		/* Hide root's parent directory */
-		if (fobject == vfsdev->root && strcmp(name, "..") == 0) {
-			goto skip_entry;
+		if (fobject == vfsdev->root && strcmp(entry->d_name, "..") == 0) {
+			continue;
 		}
 
-		if (is_dot_or_dotdot(name)) {
+		ent = &batch->ents[batch->count++];
+		ent->off = entry->d_off;
+		ent->ino = entry->d_ino;
+		ent->is_dot = is_dot_or_dotdot(entry->d_name);
+		ent->fd = -1;
+		snprintf(ent->name, sizeof(ent->name), "%s", entry->d_name);
+
+		if (!ent->is_dot) {
+			ent->status = lo_lookup_open(vfsdev, fobject, ent->name, &ent->fd, &ent->stat);
+		}
+	}
+
+	return 0;
+}
+
+static int
+lo_readdir_done(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct lo_dirent_batch *batch = vfsdev_io->md.dirents;
+	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.readdir.fobject;
+	struct spdk_fsdev_file_handle *fhandle = fsdev_io->u_in.readdir.fhandle;
+	struct lo_dirent *ent;
+	int res = 0;
+
+	for (; batch->next < batch->count; batch->next++) {
+		ent = &batch->ents[batch->next];
+
+		if (ent->is_dot) {
 			fsdev_io->u_out.readdir.fobject = NULL;
 			memset(&fsdev_io->u_out.readdir.attr, 0, sizeof(fsdev_io->u_out.readdir.attr));
-			fsdev_io->u_out.readdir.attr.ino = fhandle->dir.entry->d_ino;
+			fsdev_io->u_out.readdir.attr.ino = ent->ino;
 			fsdev_io->u_out.readdir.attr.mode = DT_DIR << 12;
-			goto skip_lookup;
-		}
+		} else {
+			if (ent->status) {
+				res = ent->status;
+				SPDK_DEBUGLOG(fsdev_aio, "lookup(%s) failed with err=%d\n", ent->name, res);
+				goto out;
+			}
 
-		res = lo_do_lookup(vfsdev, fobject, name, &fsdev_io->u_out.readdir.fobject,
-				   &fsdev_io->u_out.readdir.attr);
-		if (res) {
-			SPDK_DEBUGLOG(fsdev_aio, "lo_do_lookup(%s) failed with err=%d\n", name, res);
-			return res;
+			res = lo_lookup_finish(fobject, ent->name, ent->fd, &ent->stat,
+					       &fsdev_io->u_out.readdir.fobject,
+					       &fsdev_io->u_out.readdir.attr);
+			ent->fd = -1;
+			if (res) {
+				SPDK_DEBUGLOG(fsdev_aio, "lo_lookup_finish(%s) failed with err=%d\n", ent->name, res);
+				goto out;
+			}
 		}
 
-skip_lookup:
-		fsdev_io->u_out.readdir.name = name;
-		fsdev_io->u_out.readdir.offset = nextoff;
+		fsdev_io->u_out.readdir.name = ent->name;
+		fsdev_io->u_out.readdir.offset = ent->off;
 
-		res = fsdev_io->u_in.readdir.entry_cb_fn(fsdev_io, fsdev_io->internal.cb_arg);
-		if (res) {
+		if (fsdev_io->u_in.readdir.entry_cb_fn(fsdev_io, fsdev_io->internal.cb_arg)) {
 			if (fsdev_io->u_out.readdir.fobject) {
 				file_object_unref(fsdev_io->u_out.readdir.fobject, 1);
 			}
-			break;
+			/* The directory stream is past this entry, the next readdir will seek back to it */
+			goto out;
 		}
+	}
 
-skip_entry:
-		fhandle->dir.entry = NULL;
-		fhandle->dir.offset = nextoff;
+	res = batch->status;
+	if (!res && !batch->eof) {
+		/* Everything was consumed, continue from the current position of the stream */
+		batch->offset = fhandle->dir.offset;
+		return IO_STATUS_AGAIN;
 	}
 
-	SPDK_DEBUGLOG(fsdev_aio, "READDIR succeeded for " FOBJECT_FMT " (fh=%p, offset=%" PRIu64 ")\n",
-		      FOBJECT_ARGS(fobject), fhandle, offset);
-	return 0;
+out:
+	for (; batch->next < batch->count; batch->next++) {
+		if (batch->ents[batch->next].fd != -1) {
+			close(batch->ents[batch->next].fd);
+		}
+	}
+
+	free(batch);
+	vfsdev_io->md.dirents = NULL;
+
+	if (!res) {
+		SPDK_DEBUGLOG(fsdev_aio, "READDIR succeeded for " FOBJECT_FMT " (fh=%p, offset=%" PRIu64 ")\n",
+			      FOBJECT_ARGS(fobject), fhandle, fsdev_io->u_in.readdir.offset);
+	}
+
+	return res;
+}
+
+static int
+lo_readdir(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.readdir.fobject;
+	struct spdk_fsdev_file_handle *fhandle = fsdev_io->u_in.readdir.fhandle;
+	struct lo_dirent_batch *batch;
+
+	if (!fsdev_aio_is_valid_fobject(vfsdev, fobject)) {
+		SPDK_ERRLOG("Invalid fobject: %p\n", fobject);
+		return -EINVAL;
+	}
+
+	if (!fsdev_aio_is_valid_fhandle(vfsdev, fhandle)) {
+		SPDK_ERRLOG("Invalid fhandle: %p\n", fhandle);
+		return -EINVAL;
+	}
+
+	batch = malloc(sizeof(*batch));
+	if (!batch) {
+		SPDK_ERRLOG("Cannot alloc readdir batch\n");
+		return -ENOMEM;
+	}
+
+	batch->offset = fsdev_io->u_in.readdir.offset;
+	vfsdev_io->md.dirents = batch;
+
+	return fsdev_aio_md_submit(ch, fsdev_io, lo_readdir_work, lo_readdir_done);
 }
 
 static int
@@ -845,18 +1264,12 @@ update_open_flags(struct aio_fsdev *vfsdev, uint32_t flags)
 }
 
 static int
-lo_open(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_open_work(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
 	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
-	int fd, saverr;
 	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.open.fobject;
 	uint32_t flags = fsdev_io->u_in.open.flags;
-	struct spdk_fsdev_file_handle *fhandle;
-
-	if (!fsdev_aio_is_valid_fobject(vfsdev, fobject)) {
-		SPDK_ERRLOG("Invalid fobject: %p\n", fobject);
-		return -EINVAL;
-	}
+	int fd, saverr;
 
 	flags = update_open_flags(vfsdev, flags);
 
@@ -868,6 +1281,23 @@ lo_open(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 		return saverr;
 	}
 
+	fsdev_to_aio_io(fsdev_io)->md.open_fd = fd;
+
+	return 0;
+}
+
+static int
+lo_open_done(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.open.fobject;
+	struct spdk_fsdev_file_handle *fhandle;
+	int fd = vfsdev_io->md.open_fd;
+
+	if (vfsdev_io->md.status) {
+		return vfsdev_io->md.status;
+	}
+
 	fhandle = file_handle_create(fobject, fd);
 	if (!fhandle) {
 		SPDK_ERRLOG("cannot create a file handle (fd=%d)\n", fd);
@@ -883,6 +1313,20 @@ lo_open(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 	return 0;
 }
 
+static int
+lo_open(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.open.fobject;
+
+	if (!fsdev_aio_is_valid_fobject(vfsdev, fobject)) {
+		SPDK_ERRLOG("Invalid fobject: %p\n", fobject);
+		return -EINVAL;
+	}
+
+	return fsdev_aio_md_submit(ch, fsdev_io, lo_open_work, lo_open_done);
+}
+
 static int
 lo_flush(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
@@ -1033,36 +1477,22 @@ lo_setattr(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 }
 
 static int
-lo_create(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_create_work(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
 	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
 	int fd;
 	int err;
 	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.create.parent_fobject;
 	const char *name = fsdev_io->u_in.create.name;
 	uint32_t mode = fsdev_io->u_in.create.mode;
 	uint32_t flags = fsdev_io->u_in.create.flags;
-	uint32_t umask = fsdev_io->u_in.create.umask;
 	struct lo_cred old_cred, new_cred = {
 		.euid = fsdev_io->u_in.create.euid,
 		.egid = fsdev_io->u_in.create.egid,
 	};
-	struct spdk_fsdev_file_object *fobject;
-	struct spdk_fsdev_file_handle *fhandle;
-	struct spdk_fsdev_file_attr *attr = &fsdev_io->u_out.create.attr;
-
-	if (!fsdev_aio_is_valid_fobject(vfsdev, parent_fobject)) {
-		SPDK_ERRLOG("Invalid parent_fobject: %p\n", parent_fobject);
-		return -EINVAL;
-	}
-
-	UNUSED(umask);
-
-	if (!is_safe_path_component(name)) {
-		SPDK_ERRLOG("CREATE: %s not a safe component\n", name);
-		return -EINVAL;
-	}
 
+	/* The credentials are only changed for the calling thread */
 	err = lo_change_cred(&new_cred, &old_cred);
 	if (err) {
 		SPDK_ERRLOG("CREATE: cannot change credentials\n");
@@ -1080,9 +1510,38 @@ lo_create(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 		return err;
 	}
 
-	err = lo_do_lookup(vfsdev, parent_fobject, name, &fobject, attr);
+	err = lo_lookup_open(vfsdev, parent_fobject, name, &vfsdev_io->md.fd, &vfsdev_io->md.stat);
+	if (err) {
+		SPDK_ERRLOG("CREATE: lookup failed with %d\n", err);
+		close(fd);
+		return err;
+	}
+
+	vfsdev_io->md.open_fd = fd;
+
+	return 0;
+}
+
+static int
+lo_create_done(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.create.parent_fobject;
+	const char *name = fsdev_io->u_in.create.name;
+	int fd = vfsdev_io->md.open_fd;
+	struct spdk_fsdev_file_object *fobject;
+	struct spdk_fsdev_file_handle *fhandle;
+	int err;
+
+	if (vfsdev_io->md.status) {
+		return vfsdev_io->md.status;
+	}
+
+	err = lo_lookup_finish(parent_fobject, name, vfsdev_io->md.fd, &vfsdev_io->md.stat, &fobject,
+			       &fsdev_io->u_out.create.attr);
 	if (err) {
 		SPDK_ERRLOG("CREATE: lookup failed with %d\n", err);
+		close(fd);
 		return err;
 	}
 
@@ -1103,6 +1562,29 @@ lo_create(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 	return 0;
 }
 
+static int
+lo_create(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.create.parent_fobject;
+	const char *name = fsdev_io->u_in.create.name;
+	uint32_t umask = fsdev_io->u_in.create.umask;
+
+	if (!fsdev_aio_is_valid_fobject(vfsdev, parent_fobject)) {
+		SPDK_ERRLOG("Invalid parent_fobject: %p\n", parent_fobject);
+		return -EINVAL;
+	}
+
+	UNUSED(umask);
+
+	if (!is_safe_path_component(name)) {
+		SPDK_ERRLOG("CREATE: %s not a safe component\n", name);
+		return -EINVAL;
+	}
+
+	return fsdev_aio_md_submit(ch, fsdev_io, lo_create_work, lo_create_done);
+}
+
 static int
 lo_release(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
@@ -1123,9 +1605,36 @@ lo_release(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 	SPDK_DEBUGLOG(fsdev_aio, "RELEASE succeeded for " FOBJECT_FMT " fh=%p)\n",
 		      FOBJECT_ARGS(fobject), fhandle);
 
-	file_handle_delete(fhandle);
+	return lo_release_fhandle(ch, fsdev_io, fhandle);
+}
 
-	return 0;
+static struct spdk_aio_mgr_io *
+lo_submit_aio(struct aio_fsdev *vfsdev, struct aio_io_channel *ch,
+	      struct spdk_fsdev_file_handle *fhandle, fsdev_aio_done_cb clb, void *ctx, uint64_t offs,
+	      uint32_t size, struct iovec *iovs, uint32_t iovcnt, bool read)
+{
+#ifdef SPDK_CONFIG_URING
+	if (vfsdev->uring_enabled) {
+		if (!ch->uring) {
+			ch->uring = spdk_uring_mgr_create(MAX_AIOS);
+			if (!ch->uring) {
+				clb(ctx, 0, ENOMEM);
+				return NULL;
+			}
+		}
+
+		fhandle->uring_used = true;
+		if (read) {
+			return spdk_uring_mgr_read(ch->uring, clb, ctx, fhandle->fd, offs, size, iovs, iovcnt);
+		}
+		return spdk_uring_mgr_write(ch->uring, clb, ctx, fhandle->fd, offs, size, iovs, iovcnt);
+	}
+#endif
+
+	if (read) {
+		return spdk_aio_mgr_read(ch->mgr, clb, ctx, fhandle->fd, offs, size, iovs, iovcnt);
+	}
+	return spdk_aio_mgr_write(ch->mgr, clb, ctx, fhandle->fd, offs, size, iovs, iovcnt);
 }
 
 static void
@@ -1191,8 +1700,10 @@ lo_read(struct spdk_io_channel *_ch, struct spdk_fsdev_io *fsdev_io)
 		return IO_STATUS_ASYNC;
 	}
 
-	vfsdev_io->aio = spdk_aio_mgr_read(ch->mgr, lo_read_cb, fsdev_io, fhandle->fd, offs, size, outvec,
-					   outcnt);
+	/* The callback is called before returning if the submission fails */
+	vfsdev_io->aio = NULL;
+	vfsdev_io->aio = lo_submit_aio(vfsdev, ch, fhandle, lo_read_cb, fsdev_io, offs, size, outvec,
+				       outcnt, true);
 	if (vfsdev_io->aio) {
 		vfsdev_io->ch = ch;
 		TAILQ_INSERT_TAIL(&ch->ios_in_progress, vfsdev_io, link);
@@ -1263,8 +1774,9 @@ lo_write(struct spdk_io_channel *_ch, struct spdk_fsdev_io *fsdev_io)
 		return IO_STATUS_ASYNC;
 	}
 
-	vfsdev_io->aio = spdk_aio_mgr_write(ch->mgr, lo_write_cb, fsdev_io,
-					    fhandle->fd, offs, size, invec, incnt);
+	vfsdev_io->aio = NULL;
+	vfsdev_io->aio = lo_submit_aio(vfsdev, ch, fhandle, lo_write_cb, fsdev_io, offs, size,
+				       (struct iovec *)invec, incnt, false);
 	if (vfsdev_io->aio) {
 		vfsdev_io->ch = ch;
 		TAILQ_INSERT_TAIL(&ch->ios_in_progress, vfsdev_io, link);
@@ -1345,46 +1857,91 @@ lo_statfs(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 	return 0;
 }
 
+struct lo_mknod_args {
+	struct spdk_fsdev_file_object *parent_fobject;
+	const char *name;
+	mode_t mode;
+	dev_t rdev;
+	const char *link;
+	uid_t euid;
+	gid_t egid;
+	struct spdk_fsdev_file_object **pfobject;
+	struct spdk_fsdev_file_attr *attr;
+};
+
+static void
+lo_mknod_symlink_get_args(struct spdk_fsdev_io *fsdev_io, struct lo_mknod_args *args)
+{
+	memset(args, 0, sizeof(*args));
+
+	switch (spdk_fsdev_io_get_type(fsdev_io)) {
+	case SPDK_FSDEV_IO_MKNOD:
+		args->parent_fobject = fsdev_io->u_in.mknod.parent_fobject;
+		args->name = fsdev_io->u_in.mknod.name;
+		args->mode = fsdev_io->u_in.mknod.mode;
+		args->rdev = fsdev_io->u_in.mknod.rdev;
+		args->euid = fsdev_io->u_in.mknod.euid;
+		args->egid = fsdev_io->u_in.mknod.egid;
+		args->pfobject = &fsdev_io->u_out.mknod.fobject;
+		args->attr = &fsdev_io->u_out.mknod.attr;
+		break;
+	case SPDK_FSDEV_IO_MKDIR:
+		args->parent_fobject = fsdev_io->u_in.mkdir.parent_fobject;
+		args->name = fsdev_io->u_in.mkdir.name;
+		args->mode = S_IFDIR | fsdev_io->u_in.mkdir.mode;
+		args->euid = fsdev_io->u_in.mkdir.euid;
+		args->egid = fsdev_io->u_in.mkdir.egid;
+		args->pfobject = &fsdev_io->u_out.mkdir.fobject;
+		args->attr = &fsdev_io->u_out.mkdir.attr;
+		break;
+	case SPDK_FSDEV_IO_SYMLINK:
+		args->parent_fobject = fsdev_io->u_in.symlink.parent_fobject;
+		args->name = fsdev_io->u_in.symlink.target;
+		args->mode = S_IFLNK;
+		args->link = fsdev_io->u_in.symlink.linkpath;
+		args->euid = fsdev_io->u_in.symlink.euid;
+		args->egid = fsdev_io->u_in.symlink.egid;
+		args->pfobject = &fsdev_io->u_out.symlink.fobject;
+		args->attr = &fsdev_io->u_out.symlink.attr;
+		break;
+	default:
+		assert(false);
+	}
+}
+
 static int
-lo_mknod_symlink(struct spdk_fsdev_io *fsdev_io, struct spdk_fsdev_file_object *parent_fobject,
-		 const char *name, mode_t mode, dev_t rdev, const char *link, uid_t euid, gid_t egid,
-		 struct spdk_fsdev_file_object **pfobject, struct spdk_fsdev_file_attr *attr)
+lo_mknod_symlink_work(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
 	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
-	int res;
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct lo_mknod_args args;
+	int res = -1;
 	int saverr;
-	struct lo_cred old_cred, new_cred = {
-		.euid = euid,
-		.egid = egid,
-	};
-
-	if (!fsdev_aio_is_valid_fobject(vfsdev, parent_fobject)) {
-		SPDK_ERRLOG("Invalid parent_fobject: %p\n", parent_fobject);
-		return -EINVAL;
-	}
+	struct lo_cred old_cred, new_cred;
 
-	if (!is_safe_path_component(name)) {
-		SPDK_ERRLOG("%s isn'h safe\n", name);
-		return -EINVAL;
-	}
+	lo_mknod_symlink_get_args(fsdev_io, &args);
+	new_cred.euid = args.euid;
+	new_cred.egid = args.egid;
 
+	/* The credentials are only changed for the calling thread */
 	res = lo_change_cred(&new_cred, &old_cred);
 	if (res) {
 		SPDK_ERRLOG("cannot change cred (err=%d)\n", res);
 		return res;
 	}
 
-	if (S_ISDIR(mode)) {
-		res = mkdirat(parent_fobject->fd, name, mode);
-	} else if (S_ISLNK(mode)) {
-		if (link) {
-			res = symlinkat(link, parent_fobject->fd, name);
+	if (S_ISDIR(args.mode)) {
+		res = mkdirat(args.parent_fobject->fd, args.name, args.mode);
+	} else if (S_ISLNK(args.mode)) {
+		if (args.link) {
+			res = symlinkat(args.link, args.parent_fobject->fd, args.name);
 		} else {
 			SPDK_ERRLOG("NULL link pointer\n");
+			res = -1;
 			errno = EINVAL;
 		}
 	} else {
-		res = mknodat(parent_fobject->fd, name, mode, rdev);
+		res = mknodat(args.parent_fobject->fd, args.name, args.mode, args.rdev);
 	}
 	saverr = -errno;
 
@@ -1395,64 +1952,83 @@ lo_mknod_symlink(struct spdk_fsdev_io *fsdev_io, struct spdk_fsdev_file_object *
 		return saverr;
 	}
 
-	res = lo_do_lookup(vfsdev, parent_fobject, name, pfobject, attr);
+	res = lo_lookup_open(vfsdev, args.parent_fobject, args.name, &vfsdev_io->md.fd,
+			     &vfsdev_io->md.stat);
 	if (res) {
 		SPDK_ERRLOG("lookup failed (err=%d)\n", res);
 		return res;
 	}
 
-	SPDK_DEBUGLOG(fsdev_aio, "lo_mknod_symlink(" FOBJECT_FMT "/%s -> " FOBJECT_FMT "\n",
-		      FOBJECT_ARGS(parent_fobject), name, FOBJECT_ARGS(*pfobject));
-
 	return 0;
 }
 
 static int
-lo_mknod(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_mknod_symlink_done(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
-	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.mknod.parent_fobject;
-	char *name = fsdev_io->u_in.mknod.name;
-	mode_t mode = fsdev_io->u_in.mknod.mode;
-	dev_t rdev = fsdev_io->u_in.mknod.rdev;
-	uid_t euid = fsdev_io->u_in.mknod.euid;
-	gid_t egid = fsdev_io->u_in.mknod.egid;
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct lo_mknod_args args;
+	int res;
 
-	return lo_mknod_symlink(fsdev_io, parent_fobject, name, mode, rdev, NULL, euid, egid,
-				&fsdev_io->u_out.mknod.fobject, &fsdev_io->u_out.mknod.attr);
+	if (vfsdev_io->md.status) {
+		return vfsdev_io->md.status;
+	}
+
+	lo_mknod_symlink_get_args(fsdev_io, &args);
+
+	res = lo_lookup_finish(args.parent_fobject, args.name, vfsdev_io->md.fd, &vfsdev_io->md.stat,
+			       args.pfobject, args.attr);
+	if (res) {
+		SPDK_ERRLOG("lookup failed (err=%d)\n", res);
+		return res;
+	}
+
+	SPDK_DEBUGLOG(fsdev_aio, "lo_mknod_symlink(" FOBJECT_FMT "/%s -> " FOBJECT_FMT "\n",
+		      FOBJECT_ARGS(args.parent_fobject), args.name, FOBJECT_ARGS(*args.pfobject));
+
+	return 0;
 }
 
+/* Handles mknod, mkdir and symlink */
 static int
-lo_mkdir(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_mknod_symlink(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
-	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.mkdir.parent_fobject;
-	char *name = fsdev_io->u_in.mkdir.name;
-	mode_t mode = fsdev_io->u_in.mkdir.mode;
-	uid_t euid = fsdev_io->u_in.mkdir.euid;
-	gid_t egid = fsdev_io->u_in.mkdir.egid;
+	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct lo_mknod_args args;
+
+	lo_mknod_symlink_get_args(fsdev_io, &args);
+
+	if (!fsdev_aio_is_valid_fobject(vfsdev, args.parent_fobject)) {
+		SPDK_ERRLOG("Invalid parent_fobject: %p\n", args.parent_fobject);
+		return -EINVAL;
+	}
 
-	return lo_mknod_symlink(fsdev_io, parent_fobject, name, S_IFDIR | mode, 0, NULL, euid, egid,
-				&fsdev_io->u_out.mkdir.fobject, &fsdev_io->u_out.mkdir.attr);
+	if (!is_safe_path_component(args.name)) {
+		SPDK_ERRLOG("%s isn'h safe\n", args.name);
+		return -EINVAL;
+	}
+
+	return fsdev_aio_md_submit(ch, fsdev_io, lo_mknod_symlink_work, lo_mknod_symlink_done);
 }
 
+/* Check that the entry exists, without creating its fobject, so it can be called by the workers */
 static int
-lo_symlink(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_check_entry(struct spdk_fsdev_file_object *parent_fobject, const char *name)
 {
-	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.symlink.parent_fobject;
-	char *target = fsdev_io->u_in.symlink.target;
-	char *linkpath = fsdev_io->u_in.symlink.linkpath;
-	uid_t euid = fsdev_io->u_in.symlink.euid;
-	gid_t egid = fsdev_io->u_in.symlink.egid;
+	struct stat stat;
 
-	return lo_mknod_symlink(fsdev_io, parent_fobject, target, S_IFLNK, 0, linkpath, euid, egid,
-				&fsdev_io->u_out.symlink.fobject, &fsdev_io->u_out.symlink.attr);
+	if (fstatat(parent_fobject->fd, name, &stat, AT_SYMLINK_NOFOLLOW) == -1) {
+		SPDK_ERRLOG("can't find '%s' under " FOBJECT_FMT " (err=%d)\n", name,
+			    FOBJECT_ARGS(parent_fobject), -errno);
+		return -EIO;
+	}
+
+	return 0;
 }
 
 static int
 lo_do_unlink(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fobject,
 	     const char *name, bool is_dir)
 {
-	/* fobject must be initialized to avoid a scan-build false positive */
-	struct spdk_fsdev_file_object *fobject = NULL;
 	int res;
 
 	if (!fsdev_aio_is_valid_fobject(vfsdev, parent_fobject)) {
@@ -1465,10 +2041,9 @@ lo_do_unlink(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fob
 		return -EINVAL;
 	}
 
-	res = lo_do_lookup(vfsdev, parent_fobject, name, &fobject, NULL);
+	res = lo_check_entry(parent_fobject, name);
 	if (res) {
-		SPDK_ERRLOG("can't find '%s' under " FOBJECT_FMT "\n", name, FOBJECT_ARGS(parent_fobject));
-		return -EIO;
+		return res;
 	}
 
 	res = unlinkat(parent_fobject->fd, name, is_dir ? AT_REMOVEDIR : 0);
@@ -1478,7 +2053,6 @@ lo_do_unlink(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *parent_fob
 			     FOBJECT_ARGS(parent_fobject), name, res);
 	}
 
-	file_object_unref(fobject, 1);
 	return res;
 }
 
@@ -1507,8 +2081,6 @@ lo_rename(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
 	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
 	int res, saverr;
-	/* old_fobject must be initialized to avoid a scan-build false positive */
-	struct spdk_fsdev_file_object *old_fobject = NULL;
 	struct spdk_fsdev_file_object *parent_fobject = fsdev_io->u_in.rename.parent_fobject;
 	char *name = fsdev_io->u_in.rename.name;
 	struct spdk_fsdev_file_object *new_parent_fobject = fsdev_io->u_in.rename.new_parent_fobject;
@@ -1535,10 +2107,9 @@ lo_rename(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 		return -EINVAL;
 	}
 
-	res = lo_do_lookup(vfsdev, parent_fobject, name, &old_fobject, NULL);
+	res = lo_check_entry(parent_fobject, name);
 	if (res) {
-		SPDK_ERRLOG("can't find '%s' under " FOBJECT_FMT "\n", name, FOBJECT_ARGS(parent_fobject));
-		return -EIO;
+		return res;
 	}
 
 	saverr = 0;
@@ -1565,8 +2136,6 @@ lo_rename(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 		}
 	}
 
-	file_object_unref(old_fobject, 1);
-
 	return saverr;
 }
 
@@ -1590,25 +2159,16 @@ linkat_empty_nofollow(struct aio_fsdev *vfsdev, struct spdk_fsdev_file_object *f
 }
 
 static int
-lo_link(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+lo_link_work(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
 	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
 	int res;
 	int saverr;
 	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.link.fobject;
 	struct spdk_fsdev_file_object *new_parent_fobject = fsdev_io->u_in.link.new_parent_fobject;
 	char *name = fsdev_io->u_in.link.name;
 
-	if (!fsdev_aio_is_valid_fobject(vfsdev, fobject)) {
-		SPDK_ERRLOG("Invalid fobject: %p\n", fobject);
-		return -EINVAL;
-	}
-
-	if (!is_safe_path_component(name)) {
-		SPDK_ERRLOG("%s is not a safe component\n", name);
-		return -EINVAL;
-	}
-
 	res = linkat_empty_nofollow(vfsdev, fobject, new_parent_fobject->fd, name);
 	if (res == -1) {
 		saverr = -errno;
@@ -1617,19 +2177,61 @@ lo_link(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 		return saverr;
 	}
 
-	res = lo_do_lookup(vfsdev, new_parent_fobject, name, &fsdev_io->u_out.link.fobject,
-			   &fsdev_io->u_out.link.attr);
+	res = lo_lookup_open(vfsdev, new_parent_fobject, name, &vfsdev_io->md.fd, &vfsdev_io->md.stat);
+	if (res) {
+		SPDK_ERRLOG("lookup failed (err=%d)\n", res);
+		return res;
+	}
+
+	return 0;
+}
+
+static int
+lo_link_done(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev_io *vfsdev_io = fsdev_to_aio_io(fsdev_io);
+	struct spdk_fsdev_file_object *new_parent_fobject = fsdev_io->u_in.link.new_parent_fobject;
+	char *name = fsdev_io->u_in.link.name;
+	int res;
+
+	if (vfsdev_io->md.status) {
+		return vfsdev_io->md.status;
+	}
+
+	res = lo_lookup_finish(new_parent_fobject, name, vfsdev_io->md.fd, &vfsdev_io->md.stat,
+			       &fsdev_io->u_out.link.fobject, &fsdev_io->u_out.link.attr);
 	if (res) {
 		SPDK_ERRLOG("lookup failed (err=%d)\n", res);
 		return res;
 	}
 
 	SPDK_DEBUGLOG(fsdev_aio, "LINK succeeded for " FOBJECT_FMT " -> " FOBJECT_FMT " name=%s\n",
-		      FOBJECT_ARGS(fobject), FOBJECT_ARGS(fsdev_io->u_out.link.fobject), name);
+		      FOBJECT_ARGS(fsdev_io->u_in.link.fobject), FOBJECT_ARGS(fsdev_io->u_out.link.fobject),
+		      name);
 
 	return 0;
 }
 
+static int
+lo_link(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
+{
+	struct aio_fsdev *vfsdev = fsdev_to_aio_fsdev(fsdev_io->fsdev);
+	struct spdk_fsdev_file_object *fobject = fsdev_io->u_in.link.fobject;
+	char *name = fsdev_io->u_in.link.name;
+
+	if (!fsdev_aio_is_valid_fobject(vfsdev, fobject)) {
+		SPDK_ERRLOG("Invalid fobject: %p\n", fobject);
+		return -EINVAL;
+	}
+
+	if (!is_safe_path_component(name)) {
+		SPDK_ERRLOG("%s is not a safe component\n", name);
+		return -EINVAL;
+	}
+
+	return fsdev_aio_md_submit(ch, fsdev_io, lo_link_work, lo_link_done);
+}
+
 static int
 lo_fsync(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
@@ -2083,6 +2685,12 @@ lo_abort(struct spdk_io_channel *_ch, struct spdk_fsdev_io *fsdev_io)
 	TAILQ_FOREACH(vfsdev_io, &ch->ios_in_progress, link) {
 		struct spdk_fsdev_io *_fsdev_io = aio_to_fsdev_io(vfsdev_io);
 		if (spdk_fsdev_io_get_unique(_fsdev_io) == unique_to_abort) {
+#ifdef SPDK_CONFIG_URING
+			if (fsdev_to_aio_fsdev(_fsdev_io->fsdev)->uring_enabled) {
+				spdk_uring_mgr_cancel(ch->uring, vfsdev_io->aio);
+				return 0;
+			}
+#endif
 			spdk_aio_mgr_cancel(ch->mgr, vfsdev_io->aio);
 			return 0;
 		}
@@ -2096,12 +2704,26 @@ aio_io_poll(void *arg)
 {
 	struct aio_fsdev_io *vfsdev_io, *tmp;
 	struct aio_io_channel *ch = arg;
+	void *md_ios[MD_DONE_BATCH];
+	size_t i, count;
 	int res = SPDK_POLLER_IDLE;
 
 	if (spdk_aio_mgr_poll(ch->mgr)) {
 		res = SPDK_POLLER_BUSY;
 	}
 
+#ifdef SPDK_CONFIG_URING
+	if (ch->uring && spdk_uring_mgr_poll(ch->uring)) {
+		res = SPDK_POLLER_BUSY;
+	}
+#endif
+
+	count = spdk_ring_dequeue(ch->md_done, md_ios, MD_DONE_BATCH);
+	for (i = 0; i < count; i++) {
+		fsdev_aio_md_complete(md_ios[i]);
+		res = SPDK_POLLER_BUSY;
+	}
+
 	TAILQ_FOREACH_SAFE(vfsdev_io, &ch->ios_to_complete, link, tmp) {
 		struct spdk_fsdev_io *fsdev_io = aio_to_fsdev_io(vfsdev_io);
 
@@ -2125,6 +2747,13 @@ aio_fsdev_create_cb(void *io_device, void *ctx_buf)
 		return -ENOMEM;
 	}
 
+	ch->md_done = spdk_ring_create(SPDK_RING_TYPE_MP_SC, MD_DONE_RING_SIZE, SPDK_ENV_NUMA_ID_ANY);
+	if (!ch->md_done) {
+		SPDK_ERRLOG("metadata ring init failed (thread=%s)\n", spdk_thread_get_name(thread));
+		spdk_aio_mgr_delete(ch->mgr);
+		return -ENOMEM;
+	}
+
 	ch->poller = SPDK_POLLER_REGISTER(aio_io_poll, ch, 0);
 	TAILQ_INIT(&ch->ios_in_progress);
 	TAILQ_INIT(&ch->ios_to_complete);
@@ -2145,6 +2774,13 @@ aio_fsdev_destroy_cb(void *io_device, void *ctx_buf)
 
 	spdk_poller_unregister(&ch->poller);
 	spdk_aio_mgr_delete(ch->mgr);
+#ifdef SPDK_CONFIG_URING
+	if (ch->uring) {
+		spdk_uring_mgr_delete(ch->uring);
+	}
+#endif
+	assert(spdk_ring_count(ch->md_done) == 0);
+	spdk_ring_free(ch->md_done);
 
 	SPDK_DEBUGLOG(fsdev_aio, "Destroyed aio fsdev IO channel: thread %s, thread id %" PRIu64
 		      "\n",
@@ -2196,6 +2832,13 @@ SPDK_FSDEV_MODULE_REGISTER(aio, &aio_fsdev_module);
 static void
 fsdev_aio_free(struct aio_fsdev *vfsdev)
 {
+	if (vfsdev->md_threads) {
+		fsdev_aio_md_stop_threads(vfsdev);
+	}
+
+	pthread_cond_destroy(&vfsdev->md_cond);
+	pthread_mutex_destroy(&vfsdev->mutex);
+
 	if (vfsdev->proc_self_fd != -1) {
 		close(vfsdev->proc_self_fd);
 	}
@@ -2213,6 +2856,61 @@ fsdev_aio_free(struct aio_fsdev *vfsdev)
 	free(vfsdev);
 }
 
+static void
+fsdev_aio_free_fobjects(struct aio_fsdev *vfsdev)
+{
+	/* All the I/Os are done, stop the workers before freeing the fobjects they could use */
+	if (vfsdev->md_threads) {
+		fsdev_aio_md_stop_threads(vfsdev);
+	}
+
+	fsdev_free_leafs(vfsdev->root, true);
+	vfsdev->root = NULL;
+}
+
+#ifdef SPDK_CONFIG_URING
+static void
+fsdev_aio_forget_fobject_fds(struct spdk_uring_mgr *uring, struct spdk_fsdev_file_object *fobject)
+{
+	struct spdk_fsdev_file_handle *fhandle;
+	struct spdk_fsdev_file_object *leaf_fobject;
+
+	TAILQ_FOREACH(fhandle, &fobject->handles, link) {
+		if (fhandle->uring_used) {
+			spdk_uring_mgr_forget_fd(uring, fhandle->fd);
+		}
+	}
+
+	TAILQ_FOREACH(leaf_fobject, &fobject->leafs, link) {
+		fsdev_aio_forget_fobject_fds(uring, leaf_fobject);
+	}
+}
+
+static void
+fsdev_aio_forget_fds(struct spdk_io_channel_iter *i)
+{
+	struct aio_fsdev *vfsdev = spdk_io_channel_iter_get_ctx(i);
+	struct aio_io_channel *ch = spdk_io_channel_get_ctx(spdk_io_channel_iter_get_channel(i));
+
+	/* The rings are shared with the other fsdevs, only drop the files of this one */
+	if (ch->uring && vfsdev->root) {
+		fsdev_aio_forget_fobject_fds(ch->uring, vfsdev->root);
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+fsdev_aio_forget_fds_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct aio_fsdev *vfsdev = spdk_io_channel_iter_get_ctx(i);
+
+	fsdev_aio_free_fobjects(vfsdev);
+	spdk_fsdev_destruct_done(&vfsdev->fsdev, 0);
+	fsdev_aio_free(vfsdev);
+}
+#endif
+
 static int
 fsdev_aio_destruct(void *ctx)
 {
@@ -2220,17 +2918,20 @@ fsdev_aio_destruct(void *ctx)
 
 	TAILQ_REMOVE(&g_aio_fsdev_head, vfsdev, tailq);
 
-	fsdev_free_leafs(vfsdev->root, true);
-	vfsdev->root = NULL;
-
-	pthread_mutex_destroy(&vfsdev->mutex);
+#ifdef SPDK_CONFIG_URING
+	/* Files still open may be registered with the rings, they must be dropped before closing */
+	if (vfsdev->uring_enabled) {
+		spdk_for_each_channel(&g_aio_fsdev_head, fsdev_aio_forget_fds, vfsdev,
+				      fsdev_aio_forget_fds_done);
+		return 1;
+	}
+#endif
 
+	fsdev_aio_free_fobjects(vfsdev);
 	fsdev_aio_free(vfsdev);
 	return 0;
 }
 
-typedef int (*fsdev_op_handler_func)(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io);
-
 static fsdev_op_handler_func handlers[] = {
 	[SPDK_FSDEV_IO_MOUNT] = lo_mount,
 	[SPDK_FSDEV_IO_UMOUNT] = lo_umount,
@@ -2239,9 +2940,9 @@ static fsdev_op_handler_func handlers[] = {
 	[SPDK_FSDEV_IO_GETATTR] = lo_getattr,
 	[SPDK_FSDEV_IO_SETATTR] = lo_setattr,
 	[SPDK_FSDEV_IO_READLINK] = lo_readlink,
-	[SPDK_FSDEV_IO_SYMLINK] = lo_symlink,
-	[SPDK_FSDEV_IO_MKNOD] = lo_mknod,
-	[SPDK_FSDEV_IO_MKDIR] = lo_mkdir,
+	[SPDK_FSDEV_IO_SYMLINK] = lo_mknod_symlink,
+	[SPDK_FSDEV_IO_MKNOD] = lo_mknod_symlink,
+	[SPDK_FSDEV_IO_MKDIR] = lo_mknod_symlink,
 	[SPDK_FSDEV_IO_UNLINK] = lo_unlink,
 	[SPDK_FSDEV_IO_RMDIR] = lo_rmdir,
 	[SPDK_FSDEV_IO_RENAME] = lo_rename,
@@ -2268,6 +2969,31 @@ static fsdev_op_handler_func handlers[] = {
 	[SPDK_FSDEV_IO_COPY_FILE_RANGE] = lo_copy_file_range,
 };
 
+/*
+ * Handlers that only issue syscalls, without accessing the fobject tree, and are entirely run by
+ * the metadata workers.  The others either split their work through fsdev_aio_md_submit() or are
+ * cheap enough to be run on the SPDK thread.
+ */
+static const bool md_offload[__SPDK_FSDEV_IO_LAST] = {
+	[SPDK_FSDEV_IO_GETATTR] = true,
+	[SPDK_FSDEV_IO_SETATTR] = true,
+	[SPDK_FSDEV_IO_READLINK] = true,
+	[SPDK_FSDEV_IO_UNLINK] = true,
+	[SPDK_FSDEV_IO_RMDIR] = true,
+	[SPDK_FSDEV_IO_RENAME] = true,
+	[SPDK_FSDEV_IO_STATFS] = true,
+	[SPDK_FSDEV_IO_FSYNC] = true,
+	[SPDK_FSDEV_IO_SETXATTR] = true,
+	[SPDK_FSDEV_IO_GETXATTR] = true,
+	[SPDK_FSDEV_IO_LISTXATTR] = true,
+	[SPDK_FSDEV_IO_REMOVEXATTR] = true,
+	[SPDK_FSDEV_IO_FLUSH] = true,
+	[SPDK_FSDEV_IO_FSYNCDIR] = true,
+	[SPDK_FSDEV_IO_FLOCK] = true,
+	[SPDK_FSDEV_IO_FALLOCATE] = true,
+	[SPDK_FSDEV_IO_COPY_FILE_RANGE] = true,
+};
+
 static void
 fsdev_aio_submit_request(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev_io)
 {
@@ -2276,7 +3002,11 @@ fsdev_aio_submit_request(struct spdk_io_channel *ch, struct spdk_fsdev_io *fsdev
 
 	assert(type >= 0 && type < __SPDK_FSDEV_IO_LAST);
 
-	status = handlers[type](ch, fsdev_io);
+	if (md_offload[type]) {
+		status = fsdev_aio_md_submit(ch, fsdev_io, handlers[type], NULL);
+	} else {
+		status = handlers[type](ch, fsdev_io);
+	}
 	if (status != IO_STATUS_ASYNC) {
 		spdk_fsdev_io_complete(fsdev_io, status);
 	}
@@ -2303,6 +3033,8 @@ fsdev_aio_write_config_json(struct spdk_fsdev *fsdev, struct spdk_json_write_ctx
 				   !!vfsdev->mount_opts.writeback_cache_enabled);
 	spdk_json_write_named_uint32(w, "max_write", vfsdev->mount_opts.max_write);
 	spdk_json_write_named_bool(w, "skip_rw", vfsdev->skip_rw);
+	spdk_json_write_named_uint32(w, "md_threads", vfsdev->num_md_threads);
+	spdk_json_write_named_bool(w, "enable_uring", vfsdev->uring_enabled);
 	spdk_json_write_object_end(w); /* params */
 	spdk_json_write_object_end(w);
 }
@@ -2371,6 +3103,8 @@ spdk_fsdev_aio_get_default_opts(struct spdk_fsdev_aio_opts *opts)
 	opts->writeback_cache_enabled = DEFAULT_WRITEBACK_CACHE;
 	opts->max_write = DEFAULT_MAX_WRITE;
 	opts->skip_rw = DEFAULT_SKIP_RW;
+	opts->md_threads = DEFAULT_MD_THREADS;
+	opts->uring_enabled = DEFAULT_URING_ENABLED;
 }
 
 int
@@ -2387,6 +3121,9 @@ spdk_fsdev_aio_create(struct spdk_fsdev **fsdev, const char *name, const char *r
 	}
 
 	vfsdev->proc_self_fd = -1;
+	pthread_mutex_init(&vfsdev->mutex, NULL);
+	pthread_cond_init(&vfsdev->md_cond, NULL);
+	TAILQ_INIT(&vfsdev->md_queue);
 
 	vfsdev->fsdev.name = strdup(name);
 	if (!vfsdev->fsdev.name) {
@@ -2422,13 +3159,41 @@ spdk_fsdev_aio_create(struct spdk_fsdev **fsdev, const char *name, const char *r
 		return rc;
 	}
 
+#ifndef SPDK_CONFIG_URING
+	if (opts->uring_enabled) {
+		SPDK_ERRLOG("io_uring can only be enabled if SPDK is built with it\n");
+		fsdev_aio_free(vfsdev);
+		return -ENOTSUP;
+	}
+#endif
+
+	if (opts->md_threads > MAX_MD_THREADS) {
+		SPDK_ERRLOG("Too many metadata threads: %" PRIu32 " (max %d)\n", opts->md_threads,
+			    MAX_MD_THREADS);
+		fsdev_aio_free(vfsdev);
+		return -EINVAL;
+	}
+
+	if (opts->md_threads != 0) {
+		vfsdev->md_threads = calloc(opts->md_threads, sizeof(*vfsdev->md_threads));
+		if (!vfsdev->md_threads) {
+			SPDK_ERRLOG("Could not allocate metadata threads\n");
+			fsdev_aio_free(vfsdev);
+			return -ENOMEM;
+		}
+
+		vfsdev->num_md_threads = opts->md_threads;
+		if (spdk_call_unaffinitized(fsdev_aio_md_start_threads, vfsdev) == NULL) {
+			fsdev_aio_free(vfsdev);
+			return -ENOMEM;
+		}
+	}
+
 	vfsdev->xattr_enabled = opts->xattr_enabled;
 	vfsdev->fsdev.ctxt = vfsdev;
 	vfsdev->fsdev.fn_table = &aio_fn_table;
 	vfsdev->fsdev.module = &aio_fsdev_module;
 
-	pthread_mutex_init(&vfsdev->mutex, NULL);
-
 	rc = spdk_fsdev_register(&vfsdev->fsdev);
 	if (rc) {
 		fsdev_aio_free(vfsdev);
@@ -2439,13 +3204,15 @@ spdk_fsdev_aio_create(struct spdk_fsdev **fsdev, const char *name, const char *r
 	vfsdev->mount_opts.max_write = DEFAULT_MAX_WRITE;
 
 	vfsdev->skip_rw = opts->skip_rw;
+	vfsdev->uring_enabled = opts->uring_enabled;
 
 	*fsdev = &(vfsdev->fsdev);
 	TAILQ_INSERT_TAIL(&g_aio_fsdev_head, vfsdev, tailq);
 	SPDK_DEBUGLOG(fsdev_aio, "Created aio filesystem %s (xattr_enabled=%" PRIu8 " writeback_cache=%"
-		      PRIu8 " max_write=%" PRIu32 " skip_rw=%" PRIu8 ")\n",
+		      PRIu8 " max_write=%" PRIu32 " skip_rw=%" PRIu8 " md_threads=%" PRIu32 " uring=%" PRIu8 ")\n",
 		      vfsdev->fsdev.name, vfsdev->xattr_enabled, vfsdev->mount_opts.writeback_cache_enabled,
-		      vfsdev->mount_opts.max_write, vfsdev->skip_rw);
+		      vfsdev->mount_opts.max_write, vfsdev->skip_rw, vfsdev->num_md_threads,
+		      vfsdev->uring_enabled);
 	return rc;
 }
 void
@@ -17,6 +17,10 @@ struct spdk_fsdev_aio_opts {
 	bool writeback_cache_enabled;
 	uint32_t max_write;
 	bool skip_rw;
+	/* Number of threads running the metadata operations, 0 to run them on the SPDK threads */
+	uint32_t md_threads;
+	/* Use io_uring instead of AIO for the reads and writes */
+	bool uring_enabled;
 };
 
 typedef void (*spdk_delete_aio_fsdev_complete)(void *cb_arg, int fsdeverrno);
@@ -0,0 +1,359 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "spdk/stdinc.h"
+#include "spdk/env.h"
+#include "spdk/util.h"
+#include "spdk/log.h"
+#include "spdk/string.h"
+#include "spdk_internal/assert.h"
+#include "spdk_internal/uring.h"
+#include "aio_mgr.h"
+
+#define URING_REAP_BATCH 64
+/* Size of the sparse table of registered files of each ring */
+#define URING_MAX_FILES 1024
+
+struct spdk_aio_mgr_io {
+	struct spdk_uring_mgr *mgr;
+	TAILQ_ENTRY(spdk_aio_mgr_io) link;
+	fsdev_aio_done_cb clb;
+	void *ctx;
+};
+
+struct spdk_uring_mgr {
+	struct io_uring ring;
+	TAILQ_HEAD(, spdk_aio_mgr_io) in_flight;
+	struct {
+		struct spdk_aio_mgr_io *arr;
+		TAILQ_HEAD(, spdk_aio_mgr_io) pool;
+	} aios;
+	/* Number of SQEs queued since the last io_uring_submit() */
+	uint32_t num_pending;
+	/* Descriptor registered in each slot (fd % URING_MAX_FILES) or -1, until it's forgotten */
+	int files[URING_MAX_FILES];
+	bool fixed_files;
+	/* Buffers registered in this ring, synced with g_uring_bufs by the poller */
+	struct spdk_uring_fixed_bufs bufs;
+	bool map_ref;
+};
+
+static struct spdk_uring_buf_table g_uring_bufs = SPDK_URING_BUF_TABLE_INITIALIZER;
+static pthread_mutex_t g_uring_map_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct spdk_mem_map *g_uring_map;
+static uint32_t g_uring_map_refcnt;
+
+static bool
+uring_mgr_map_get(void)
+{
+	bool rc = true;
+
+	pthread_mutex_lock(&g_uring_map_mutex);
+	if (g_uring_map_refcnt == 0) {
+		g_uring_map = spdk_uring_buf_table_map_alloc(&g_uring_bufs);
+		if (!g_uring_map) {
+			SPDK_WARNLOG("cannot alloc mem map, fixed buffers disabled\n");
+			rc = false;
+		}
+	}
+	if (rc) {
+		g_uring_map_refcnt++;
+	}
+	pthread_mutex_unlock(&g_uring_map_mutex);
+
+	return rc;
+}
+
+static void
+uring_mgr_map_put(void)
+{
+	pthread_mutex_lock(&g_uring_map_mutex);
+	assert(g_uring_map_refcnt > 0);
+	if (--g_uring_map_refcnt == 0) {
+		spdk_mem_map_free(&g_uring_map);
+	}
+	pthread_mutex_unlock(&g_uring_map_mutex);
+}
+
+/* Returns the index of fd in the registered files, registering it if needed, or -1 */
+static int
+uring_mgr_get_file_index(struct spdk_uring_mgr *mgr, int fd)
+{
+	uint32_t slot = fd % URING_MAX_FILES;
+	int rc;
+
+	if (!mgr->fixed_files) {
+		return -1;
+	}
+
+	if (mgr->files[slot] == fd) {
+		return slot;
+	}
+
+	/*
+	 * The slot is taken by another descriptor, and I/Os already queued may refer to it, so it
+	 * can't be replaced.  The I/O just uses the plain descriptor.
+	 */
+	if (mgr->files[slot] != -1) {
+		return -1;
+	}
+
+	rc = io_uring_register_files_update(&mgr->ring, slot, &fd, 1);
+	if (rc != 1) {
+		SPDK_DEBUGLOG(spdk_aio_mgr_io, "cannot register fd=%d: %d\n", fd, rc);
+		return -1;
+	}
+	mgr->files[slot] = fd;
+
+	return slot;
+}
+
+static struct spdk_aio_mgr_io *
+uring_mgr_get_aio(struct spdk_uring_mgr *mgr, fsdev_aio_done_cb clb, void *ctx)
+{
+	struct spdk_aio_mgr_io *aio = TAILQ_FIRST(&mgr->aios.pool);
+
+	if (aio) {
+		aio->mgr = mgr;
+		aio->clb = clb;
+		aio->ctx = ctx;
+		TAILQ_REMOVE(&mgr->aios.pool, aio, link);
+	}
+
+	return aio;
+}
+
+static struct io_uring_sqe *
+uring_mgr_get_sqe(struct spdk_uring_mgr *mgr)
+{
+	struct io_uring_sqe *sqe;
+	int rc;
+
+	sqe = io_uring_get_sqe(&mgr->ring);
+	if (!sqe) {
+		/* The SQ is full, don't wait for the poller to submit the batch */
+		rc = io_uring_submit(&mgr->ring);
+		if (rc < 0) {
+			SPDK_ERRLOG("io_uring_submit failed with %d\n", rc);
+			return NULL;
+		}
+		mgr->num_pending = 0;
+		sqe = io_uring_get_sqe(&mgr->ring);
+	}
+
+	return sqe;
+}
+
+static struct spdk_aio_mgr_io *
+uring_mgr_submit_io(struct spdk_uring_mgr *mgr, fsdev_aio_done_cb clb, void *ctx, int fd,
+		    uint64_t offs, uint32_t size, struct iovec *iovs, uint32_t iovcnt, bool read)
+{
+	struct spdk_aio_mgr_io *aio;
+	struct io_uring_sqe *sqe;
+	int file_index, buf_index = -1;
+
+	SPDK_DEBUGLOG(spdk_aio_mgr_io, "%s: fd=%d offs=%" PRIu64 " size=%" PRIu32 " iovcnt=%" PRIu32 "\n",
+		      read ? "read" : "write", fd, offs, size, iovcnt);
+
+	aio = uring_mgr_get_aio(mgr, clb, ctx);
+	if (!aio) {
+		SPDK_ERRLOG("Cannot get aio\n");
+		clb(ctx, 0, EFAULT);
+		return NULL;
+	}
+
+	sqe = uring_mgr_get_sqe(mgr);
+	if (!sqe) {
+		TAILQ_INSERT_TAIL(&mgr->aios.pool, aio, link);
+		clb(ctx, 0, EAGAIN);
+		return NULL;
+	}
+
+	/* There are no vectored fixed buffer operations, so they're only used for a single iov */
+	if (iovcnt == 1) {
+		buf_index = spdk_uring_fixed_bufs_get_index(&mgr->bufs, g_uring_map, iovs->iov_base,
+							    iovs->iov_len);
+	}
+
+	if (buf_index >= 0 && read) {
+		io_uring_prep_read_fixed(sqe, fd, iovs->iov_base, iovs->iov_len, offs, buf_index);
+	} else if (buf_index >= 0) {
+		io_uring_prep_write_fixed(sqe, fd, iovs->iov_base, iovs->iov_len, offs, buf_index);
+	} else if (read) {
+		io_uring_prep_readv(sqe, fd, iovs, iovcnt, offs);
+	} else {
+		io_uring_prep_writev(sqe, fd, iovs, iovcnt, offs);
+	}
+
+	file_index = uring_mgr_get_file_index(mgr, fd);
+	if (file_index >= 0) {
+		sqe->fd = file_index;
+		sqe->flags |= IOSQE_FIXED_FILE;
+	}
+
+	io_uring_sqe_set_data(sqe, aio);
+	mgr->num_pending++;
+	TAILQ_INSERT_TAIL(&mgr->in_flight, aio, link);
+
+	return aio;
+}
+
+struct spdk_uring_mgr *
+spdk_uring_mgr_create(uint32_t max_aios)
+{
+	struct spdk_uring_mgr *mgr;
+	uint32_t i;
+	int rc;
+
+	mgr = calloc(1, sizeof(*mgr));
+	if (!mgr) {
+		SPDK_ERRLOG("cannot alloc mgr of %zu bytes\n", sizeof(*mgr));
+		return NULL;
+	}
+
+	rc = io_uring_queue_init(max_aios, &mgr->ring, 0);
+	if (rc < 0) {
+		SPDK_ERRLOG("io_uring_queue_init(%" PRIu32 ") failed with %d\n", max_aios, rc);
+		free(mgr);
+		return NULL;
+	}
+
+	mgr->aios.arr = calloc(max_aios, sizeof(mgr->aios.arr[0]));
+	if (!mgr->aios.arr) {
+		SPDK_ERRLOG("cannot alloc aios pool of %" PRIu32 "\n", max_aios);
+		io_uring_queue_exit(&mgr->ring);
+		free(mgr);
+		return NULL;
+	}
+
+	TAILQ_INIT(&mgr->in_flight);
+	TAILQ_INIT(&mgr->aios.pool);
+
+	for (i = 0; i < max_aios; i++) {
+		TAILQ_INSERT_TAIL(&mgr->aios.pool, &mgr->aios.arr[i], link);
+	}
+
+	/* Sparse tables require Linux 5.19, the I/Os just use plain descriptors and buffers before */
+	for (i = 0; i < URING_MAX_FILES; i++) {
+		mgr->files[i] = -1;
+	}
+	mgr->fixed_files = io_uring_register_files_sparse(&mgr->ring, URING_MAX_FILES) == 0;
+
+	mgr->map_ref = uring_mgr_map_get();
+	if (mgr->map_ref && spdk_uring_fixed_bufs_init(&mgr->bufs, &mgr->ring, &g_uring_bufs) != 0) {
+		uring_mgr_map_put();
+		mgr->map_ref = false;
+	}
+
+	SPDK_DEBUGLOG(spdk_aio_mgr_io, "uring mgr %p created: fixed_files=%d fixed_bufs=%d\n", mgr,
+		      mgr->fixed_files, mgr->bufs.iovs != NULL);
+
+	return mgr;
+}
+
+struct spdk_aio_mgr_io *
+spdk_uring_mgr_read(struct spdk_uring_mgr *mgr, fsdev_aio_done_cb clb, void *ctx,
+		    int fd, uint64_t offs, uint32_t size, struct iovec *iovs, uint32_t iovcnt)
+{
+	return uring_mgr_submit_io(mgr, clb, ctx, fd, offs, size, iovs, iovcnt, true);
+}
+
+struct spdk_aio_mgr_io *
+spdk_uring_mgr_write(struct spdk_uring_mgr *mgr, fsdev_aio_done_cb clb, void *ctx,
+		     int fd, uint64_t offs, uint32_t size, const struct iovec *iovs, uint32_t iovcnt)
+{
+	return uring_mgr_submit_io(mgr, clb, ctx, fd, offs, size, (struct iovec *)iovs, iovcnt, false);
+}
+
+void
+spdk_uring_mgr_cancel(struct spdk_uring_mgr *mgr, struct spdk_aio_mgr_io *aio)
+{
+	struct io_uring_sqe *sqe;
+
+	assert(mgr == aio->mgr);
+
+	sqe = uring_mgr_get_sqe(mgr);
+	if (!sqe) {
+		SPDK_WARNLOG("aio=%p cancellation failed\n", aio);
+		return;
+	}
+
+	/* The I/O completes with -ECANCELED if it could be cancelled */
+	io_uring_prep_cancel(sqe, aio, 0);
+	io_uring_sqe_set_data(sqe, NULL);
+	mgr->num_pending++;
+}
+
+void
+spdk_uring_mgr_forget_fd(struct spdk_uring_mgr *mgr, int fd)
+{
+	uint32_t slot = fd % URING_MAX_FILES;
+	int unused = -1;
+
+	if (mgr->files[slot] == fd) {
+		io_uring_register_files_update(&mgr->ring, slot, &unused, 1);
+		mgr->files[slot] = -1;
+	}
+}
+
+bool
+spdk_uring_mgr_poll(struct spdk_uring_mgr *mgr)
+{
+	struct io_uring_cqe *cqes[URING_REAP_BATCH];
+	struct spdk_aio_mgr_io *aio;
+	uint32_t submitted = 0, count, i;
+	int rc;
+
+	if (spdk_uring_fixed_bufs_need_sync(&mgr->bufs, &g_uring_bufs)) {
+		spdk_uring_fixed_bufs_sync(&mgr->bufs, &mgr->ring, &g_uring_bufs);
+	}
+
+	if (mgr->num_pending > 0) {
+		rc = io_uring_submit(&mgr->ring);
+		if (rc < 0) {
+			SPDK_WARNLOG("io_uring_submit failed with %d\n", rc);
+		} else {
+			submitted = mgr->num_pending;
+			mgr->num_pending = 0;
+		}
+	}
+
+	if (TAILQ_EMPTY(&mgr->in_flight)) {
+		return submitted > 0;
+	}
+
+	count = io_uring_peek_batch_cqe(&mgr->ring, cqes, SPDK_COUNTOF(cqes));
+	for (i = 0; i < count; i++) {
+		aio = io_uring_cqe_get_data(cqes[i]);
+		if (!aio) {
+			/* Completion of a cancel request */
+			continue;
+		}
+
+		SPDK_DEBUGLOG(spdk_aio_mgr_io, "aio=%p completed with res=%d\n", aio, cqes[i]->res);
+
+		TAILQ_REMOVE(&mgr->in_flight, aio, link);
+		if (cqes[i]->res >= 0) {
+			aio->clb(aio->ctx, cqes[i]->res, 0);
+		} else {
+			aio->clb(aio->ctx, 0, -cqes[i]->res);
+		}
+		TAILQ_INSERT_TAIL(&mgr->aios.pool, aio, link);
+	}
+	io_uring_cq_advance(&mgr->ring, count);
+
+	return submitted + count > 0;
+}
+
+void
+spdk_uring_mgr_delete(struct spdk_uring_mgr *mgr)
+{
+	assert(TAILQ_EMPTY(&mgr->in_flight));
+
+	io_uring_queue_exit(&mgr->ring);
+	spdk_uring_fixed_bufs_fini(&mgr->bufs);
+	if (mgr->map_ref) {
+		uring_mgr_map_put();
+	}
+	free(mgr->aios.arr);
+	free(mgr);
+}
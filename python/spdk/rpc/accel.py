@@ -34,6 +34,27 @@ def accel_assign_opc(client, opname, module):
     return client.call('accel_assign_opc', params)
 
 
+def accel_assign_opc_modules(client, opname, modules, policy=None, queue_depth=None):
+    """Balance an operation across several modules.
+
+    Args:
+        opname: name of operation
+        modules: names of modules
+        policy: module selection policy: spillover or latency (optional)
+        queue_depth: number of outstanding operations on a module before moving on to the others (optional)
+    """
+    params = {
+        'opname': opname,
+        'modules': modules,
+    }
+    if policy is not None:
+        params['policy'] = policy
+    if queue_depth is not None:
+        params['queue_depth'] = queue_depth
+
+    return client.call('accel_assign_opc_modules', params)
+
+
 def accel_crypto_key_create(client, cipher, key, key2, tweak_mode, name):
     """Create Data Encryption Key Identifier.
 
@@ -94,7 +115,9 @@ def accel_set_driver(client, name):
 
 
 def accel_set_options(client, small_cache_size, large_cache_size,
-                      task_count, sequence_count, buf_count):
+                      task_count, sequence_count, buf_count,
+                      compress_sample_size=None, compress_entropy_threshold=None,
+                      magazine_size=None, depot_count=None):
     """Set accel framework's options."""
     params = {}
 
@@ -108,10 +131,30 @@ def accel_set_options(client, small_cache_size, large_cache_size,
         params['sequence_count'] = sequence_count
     if buf_count is not None:
         params['buf_count'] = buf_count
+    if compress_sample_size is not None:
+        params['compress_sample_size'] = compress_sample_size
+    if compress_entropy_threshold is not None:
+        params['compress_entropy_threshold'] = compress_entropy_threshold
+    if magazine_size is not None:
+        params['magazine_size'] = magazine_size
+    if depot_count is not None:
+        params['depot_count'] = depot_count
 
     return client.call('accel_set_options', params)
 
 
+def accel_sw_set_options(client, offload_cpumask=None, offload_queue_depth=None):
+    """Set the software accel module's options."""
+    params = {}
+
+    if offload_cpumask is not None:
+        params['offload_cpumask'] = offload_cpumask
+    if offload_queue_depth is not None:
+        params['offload_queue_depth'] = offload_queue_depth
+
+    return client.call('accel_sw_set_options', params)
+
+
 def accel_get_stats(client):
     """Get accel framework's statistics"""
 
@@ -111,6 +111,19 @@ def thread_set_cpumask(client, id, cpumask):
     return client.call('thread_set_cpumask', params)
 
 
+def thread_set_cycle_sample_rate(client, rate):
+    """Set how often the cycles spent in pollers and messages are measured.
+
+    Args:
+        rate: one out of this many runs is timed, 0 disables the accounting
+
+    Returns:
+        True or False
+    """
+    params = {'rate': rate}
+    return client.call('thread_set_cycle_sample_rate', params)
+
+
 def log_enable_timestamps(client, enabled):
     """Enable or disable timestamps.
 
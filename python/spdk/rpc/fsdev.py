@@ -14,12 +14,15 @@ def fsdev_get_opts(client):
     return client.call('fsdev_get_opts')
 
 
-def fsdev_set_opts(client, fsdev_io_pool_size: int = None, fsdev_io_cache_size: int = None):
+def fsdev_set_opts(client, fsdev_io_pool_size: int = None, fsdev_io_cache_size: int = None,
+                   lookup_cache_size: int = None, lookup_cache_lease_ms: int = None):
     """Set fsdev subsystem opts.
 
     Args:
         fsdev_io_pool_size: size of fsdev IO objects pool
         fsdev_io_cache_size: size of fsdev IO objects cache per thread
+        lookup_cache_size: max number of cached entries per fsdev (0 to disable the cache)
+        lookup_cache_lease_ms: lifetime of a cached entry or attribute in milliseconds
     """
     params = {
     }
@@ -28,12 +31,17 @@ def fsdev_set_opts(client, fsdev_io_pool_size: int = None, fsdev_io_cache_size:
         params['fsdev_io_pool_size'] = fsdev_io_pool_size
     if fsdev_io_cache_size is not None:
         params['fsdev_io_cache_size'] = fsdev_io_cache_size
+    if lookup_cache_size is not None:
+        params['lookup_cache_size'] = lookup_cache_size
+    if lookup_cache_lease_ms is not None:
+        params['lookup_cache_lease_ms'] = lookup_cache_lease_ms
 
     return client.call('fsdev_set_opts', params)
 
 
 def fsdev_aio_create(client, name, root_path, enable_xattr: bool = None,
-                     enable_writeback_cache: bool = None, max_write: int = None, skip_rw: bool = None):
+                     enable_writeback_cache: bool = None, max_write: int = None, skip_rw: bool = None,
+                     md_threads: int = None, enable_uring: bool = None):
     """Create a aio filesystem.
 
     Args:
@@ -43,6 +51,8 @@ def fsdev_aio_create(client, name, root_path, enable_xattr: bool = None,
         writeback_cache: enable/disable the write cache
         max_write: max write size
         skip_rw: if true skips read/write IOs
+        md_threads: number of threads running the metadata operations
+        enable_uring: use io_uring instead of AIO for the reads and writes
     """
     params = {
         'name': name,
@@ -56,6 +66,10 @@ def fsdev_aio_create(client, name, root_path, enable_xattr: bool = None,
         params['max_write'] = max_write
     if skip_rw is not None:
         params['skip_rw'] = skip_rw
+    if md_threads is not None:
+        params['md_threads'] = md_threads
+    if enable_uring is not None:
+        params['enable_uring'] = enable_uring
     return client.call('fsdev_aio_create', params)
 
 
@@ -3,7 +3,8 @@
 #  All rights reserved.
 
 
-def iobuf_set_options(client, small_pool_count, large_pool_count, small_bufsize, large_bufsize, enable_numa=None):
+def iobuf_set_options(client, small_pool_count, large_pool_count, small_bufsize, large_bufsize, enable_numa=None,
+                      mid_pool_counts=None, mid_bufsizes=None, slab_size=None):
     """Set iobuf pool options.
 
     Args:
@@ -12,6 +13,9 @@ def iobuf_set_options(client, small_pool_count, large_pool_count, small_bufsize,
         small_bufsize: size of a small buffer
         large_bufsize: size of a large buffer
         enable_numa: enable per-NUMA buffer pools
+        mid_pool_counts: list of the numbers of buffers of the additional pools
+        mid_bufsizes: list of the buffer sizes of the additional pools, between small_bufsize and large_bufsize
+        slab_size: size of the slabs the pools grow by on demand, 0 allocates them in full at startup
     """
     params = {}
 
@@ -25,6 +29,12 @@ def iobuf_set_options(client, small_pool_count, large_pool_count, small_bufsize,
         params['large_bufsize'] = large_bufsize
     if enable_numa is not None:
         params['enable_numa'] = enable_numa
+    if mid_pool_counts is not None:
+        params['mid_pool_counts'] = mid_pool_counts
+    if mid_bufsizes is not None:
+        params['mid_bufsizes'] = mid_bufsizes
+    if slab_size is not None:
+        params['slab_size'] = slab_size
 
     return client.call('iobuf_set_options', params)
 
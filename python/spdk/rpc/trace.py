@@ -47,6 +47,16 @@ def trace_clear_tpoint_mask(client, name, tpoint_mask):
     return client.call('trace_clear_tpoint_mask', params)
 
 
+def trace_set_io_sample_rate(client, rate):
+    """Set the rate at which I/Os are sampled by the "io" tpoint group.
+
+    Args:
+        rate: one out of every rate I/Os is traced across all layers (0 disables sampling).
+    """
+    params = {'rate': rate}
+    return client.call('trace_set_io_sample_rate', params)
+
+
 def trace_get_tpoint_group_mask(client):
     """Get trace point group mask
 
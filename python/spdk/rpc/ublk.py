@@ -3,12 +3,17 @@
 #  All rights reserved.
 
 
-def ublk_create_target(client, cpumask=None, disable_user_copy=None):
+def ublk_create_target(client, cpumask=None, disable_user_copy=None, disable_fixed_buffers=None,
+                       disable_queue_affinity=None):
     params = {}
     if cpumask:
         params['cpumask'] = cpumask
     if disable_user_copy:
         params['disable_user_copy'] = True
+    if disable_fixed_buffers:
+        params['disable_fixed_buffers'] = True
+    if disable_queue_affinity:
+        params['disable_queue_affinity'] = True
     return client.call('ublk_create_target', params)
 
 
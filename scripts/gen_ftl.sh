@@ -8,24 +8,32 @@ set -e
 rootdir=$(readlink -f $(dirname $0))/..
 
 function usage() {
-	echo "Usage: [-j] $0 -n BDEV_NAME -d BASE_BDEV [-u UUID] [-c CACHE]"
+	echo "Usage: [-j] $0 -n BDEV_NAME -d BASE_BDEV [-u UUID] [-c CACHE] [-m CORE_MASK] [-s STRIP_SIZE_KB]"
 	echo "UUID is required when restoring device state"
 	echo
 	echo "BDEV_NAME - name of the bdev"
 	echo "BASE_BDEV - name of the bdev to be used as underlying device"
 	echo "UUID - bdev's uuid (used when in restore mode)"
 	echo "CACHE - name of the bdev to be used as write buffer cache"
+	echo "CORE_MASK - core mask of the FTL core thread"
+	echo "STRIP_SIZE_KB - strip size of the raid0 bdev used for sharding (default: 128)"
+	echo
+	echo "To shard the device across several FTL instances (each one driven by its own core thread)"
+	echo "pass comma separated lists of the same length as BASE_BDEV, CACHE, CORE_MASK and UUID"
+	echo "(when restoring, every shard requires its UUID)."
+	echo "Each shard is then created as BDEV_NAME_shardN and BDEV_NAME is a raid0 bdev striping"
+	echo "the LBA space across all of them."
 }
 
-function create_json_config() {
-	echo "{"
-	echo '"subsystem": "bdev",'
-	echo '"config": ['
+function create_ftl_config() {
 	echo '{'
 	echo '"method": "bdev_ftl_create",'
 	echo '"params": {'
 	echo "\"name\": \"$1\","
 	echo "\"base_bdev\": \"$2\","
+	if [ -n "$5" ]; then
+		echo "\"core_mask\": \"$5\","
+	fi
 	if [ -n "$4" ]; then
 		echo "\"uuid\": \"$3\","
 		echo "\"cache\": \"$4\""
@@ -34,18 +42,55 @@ function create_json_config() {
 	fi
 	echo '}'
 	echo '}'
+}
+
+function create_raid_config() {
+	local name=$1 strip_size=$2
+	shift 2
+
+	echo '{'
+	echo '"method": "bdev_raid_create",'
+	echo '"params": {'
+	echo "\"name\": \"$name\","
+	echo '"raid_level": "raid0",'
+	echo "\"strip_size_kb\": $strip_size,"
+	echo "\"base_bdevs\": [$(printf '"%s",' "$@" | sed 's/,$//')]"
+	echo '}'
+	echo '}'
+}
+
+function create_json_config() {
+	local i shard_names=()
+
+	echo "{"
+	echo '"subsystem": "bdev",'
+	echo '"config": ['
+	if ((${#base_bdevs[@]} == 1)); then
+		create_ftl_config "$name" "${base_bdevs[0]}" "${uuids[0]}" "${caches[0]}" "${core_masks[0]}"
+	else
+		for i in "${!base_bdevs[@]}"; do
+			shard_names+=("${name}_shard$i")
+			create_ftl_config "${name}_shard$i" "${base_bdevs[i]}" "${uuids[i]}" \
+				"${caches[i]}" "${core_masks[i]}"
+			echo ','
+		done
+		create_raid_config "$name" "$strip_size" "${shard_names[@]}"
+	fi
 	echo ']'
 	echo '}'
 }
 
 uuid=00000000-0000-0000-0000-000000000000
+strip_size=128
 
-while getopts ":c:d:hn:u:" arg; do
+while getopts ":c:d:hm:n:s:u:" arg; do
 	case "$arg" in
 		n) name=$OPTARG ;;
 		d) base_bdev=$OPTARG ;;
-		u) uuid=$OPTARG ;;
+		u) uuid_list=$OPTARG ;;
 		c) cache=$OPTARG ;;
+		m) core_mask=$OPTARG ;;
+		s) strip_size=$OPTARG ;;
 		h)
 			usage
 			exit 0
@@ -62,4 +107,32 @@ if [[ -z "$name" || -z "$base_bdev" ]]; then
 	exit 1
 fi
 
-create_json_config $name $base_bdev $uuid $cache
+IFS=',' read -ra base_bdevs <<< "$base_bdev"
+IFS=',' read -ra caches <<< "$cache"
+IFS=',' read -ra core_masks <<< "$core_mask"
+IFS=',' read -ra uuids <<< "$uuid_list"
+
+if [[ -z "$uuid_list" ]]; then
+	# Create mode, each instance generates its own UUID
+	uuids=()
+	for _ in "${base_bdevs[@]}"; do
+		uuids+=("$uuid")
+	done
+elif ((${#uuids[@]} != ${#base_bdevs[@]})); then
+	# Restoring a shard with the UUID of another one would lose its data
+	echo "Number of UUIDs doesn't match the number of shards"
+	exit 1
+fi
+
+if ((${#base_bdevs[@]} > 1)); then
+	if ((${#caches[@]} != ${#base_bdevs[@]})); then
+		echo "Each shard requires its own cache bdev"
+		exit 1
+	fi
+	if [[ -n "$core_mask" ]] && ((${#core_masks[@]} != ${#base_bdevs[@]})); then
+		echo "Number of core masks doesn't match the number of shards"
+		exit 1
+	fi
+fi
+
+create_json_config
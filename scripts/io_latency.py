@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+#  SPDX-License-Identifier: BSD-3-Clause
+#
+
+"""Break down the latency of the I/Os sampled by the "io" tpoint group.
+
+Reads the output of `spdk_trace -j` and reports, for each stage an NVMe-oF command goes
+through, the distribution of the time spent in it:
+
+  queueing:  from the command's arrival to its execution (buffer allocation, data transfer
+             from the host, waiting behind other commands)
+  bdev:      time spent by the bdev layer and the bdev modules (e.g. lvol, raid, crypto)
+  device:    from the submission of the first NVMe command sent to the device to the
+             completion of the last one, or the time spent by the bottom bdevs if the I/O
+             didn't reach an NVMe device
+  transport: from the command's completion to the response being sent to the host
+  total:     from the command's arrival to the response being sent
+"""
+
+import argparse
+import json
+import sys
+
+STAGES = ['queueing', 'bdev', 'device', 'transport', 'total']
+
+
+class SampledIO:
+    def __init__(self):
+        self.nvmf = {}
+        self.bdev_spans = []
+        self.bdev_open = {}
+        self.nvme_submit = None
+        self.nvme_complete = None
+
+    def bdev_submit(self, bdev_io, tsc):
+        span = [tsc, None]
+        self.bdev_spans.append(span)
+        self.bdev_open[bdev_io] = span
+
+    def bdev_complete(self, bdev_io, tsc):
+        span = self.bdev_open.pop(bdev_io, None)
+        if span is not None:
+            span[1] = tsc
+
+    def nvme(self, name, tsc):
+        if name == 'IO_NVME_SUBMIT':
+            self.nvme_submit = tsc if self.nvme_submit is None else min(self.nvme_submit, tsc)
+        else:
+            self.nvme_complete = tsc if self.nvme_complete is None else max(self.nvme_complete, tsc)
+
+    def device_time(self):
+        if self.nvme_submit is not None and self.nvme_complete is not None:
+            return self.nvme_complete - self.nvme_submit
+
+        # Without NVMe commands, the device time is the one spent by the bdevs at the bottom
+        # of the stack, i.e. the bdev_ios that didn't submit any other bdev_io
+        spans = [s for s in self.bdev_spans if s[1] is not None]
+        leaves = [s for s in spans if not any(o is not s and s[0] <= o[0] and o[1] <= s[1]
+                                              for o in spans)]
+        if not leaves:
+            return None
+        return max(s[1] for s in leaves) - min(s[0] for s in leaves)
+
+    def stages(self):
+        try:
+            recv, execute, complete, sent = (self.nvmf[n] for n in ('IO_NVMF_RECV', 'IO_NVMF_EXEC',
+                                                                    'IO_NVMF_COMPLETE',
+                                                                    'IO_NVMF_SENT'))
+        except KeyError:
+            return None
+
+        device = self.device_time()
+        if device is None:
+            return None
+
+        return {'queueing': execute - recv,
+                'bdev': complete - execute - device,
+                'device': device,
+                'transport': sent - complete,
+                'total': sent - recv}
+
+
+def parse_trace(file):
+    trace = json.load(file)
+    names = {t['id']: t['name'] for t in trace['tpoints'] if t['name'].startswith('IO_')}
+    ios = {}
+
+    for entry in trace['entries']:
+        name = names.get(entry['tpoint'])
+        if name is None or 'object' not in entry:
+            continue
+
+        io = ios.setdefault(entry['object']['value'], SampledIO())
+        tsc = entry['tsc']
+        if name.startswith('IO_NVMF_'):
+            io.nvmf.setdefault(name, tsc)
+        elif name == 'IO_BDEV_SUBMIT':
+            io.bdev_submit(entry['args'][0], tsc)
+        elif name == 'IO_BDEV_COMPLETE':
+            io.bdev_complete(entry['args'][0], tsc)
+        elif name.startswith('IO_NVME_'):
+            io.nvme(name, tsc)
+
+    return trace['tsc_rate'], ios
+
+
+def percentile(values, p):
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def print_histogram(stage, values):
+    print(f'\n{stage} latency histogram')
+    print('=' * 60)
+    print('       Range in us     Cumulative    IO count')
+
+    upper, index, total = 1.0, 0, len(values)
+    while index < total:
+        count = 0
+        while index < total and values[index] < upper:
+            count += 1
+            index += 1
+        if count > 0:
+            print(f'{upper / 2 if upper > 1 else 0:10.3f} - {upper:10.3f}: '
+                  f'{100.0 * index / total:9.4f}%  ({count:9d})')
+        upper *= 2
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-i', '--input', type=argparse.FileType('r'), default=sys.stdin,
+                        help='Output of spdk_trace -j (default: stdin)')
+    parser.add_argument('-s', '--summary', action='store_true',
+                        help='Only print the summary, without the histograms')
+    parser.add_argument('-j', '--json', action='store_true', help='Print the summary as JSON')
+    args = parser.parse_args(argv)
+
+    tsc_rate, ios = parse_trace(args.input)
+    results = {stage: [] for stage in STAGES}
+    incomplete = 0
+
+    for io in ios.values():
+        stages = io.stages()
+        if stages is None:
+            incomplete += 1
+            continue
+        for stage, tsc in stages.items():
+            results[stage].append(tsc * 1000000 / tsc_rate)
+
+    summary = {'ios': len(results['total']), 'incomplete': incomplete, 'stages': {}}
+    for stage in STAGES:
+        values = sorted(results[stage])
+        results[stage] = values
+        if not values:
+            continue
+        summary['stages'][stage] = {'avg_us': sum(values) / len(values),
+                                    'p50_us': percentile(values, 50),
+                                    'p90_us': percentile(values, 90),
+                                    'p99_us': percentile(values, 99),
+                                    'max_us': values[-1]}
+
+    if args.json:
+        print(json.dumps(summary, indent=2))
+        return
+
+    print(f"{summary['ios']} sampled I/Os, {incomplete} incomplete (not fully captured)")
+    print(f"{'Stage':<12}{'Avg (us)':>12}{'p50':>12}{'p90':>12}{'p99':>12}{'Max':>12}")
+    for stage, s in summary['stages'].items():
+        print(f"{stage:<12}{s['avg_us']:12.3f}{s['p50_us']:12.3f}{s['p90_us']:12.3f}"
+              f"{s['p99_us']:12.3f}{s['max_us']:12.3f}")
+
+    if not args.summary:
+        for stage in STAGES:
+            if results[stage]:
+                print_histogram(stage, results[stage])
+
+
+if __name__ == '__main__':
+    main(sys.argv[1:])
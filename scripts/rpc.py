@@ -1988,6 +1988,14 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
         type=lambda m: int(m, 16))
     p.set_defaults(func=trace_clear_tpoint_mask)
 
+    def trace_set_io_sample_rate(args):
+        rpc.trace.trace_set_io_sample_rate(args.client, rate=args.rate)
+
+    p = subparsers.add_parser('trace_set_io_sample_rate',
+                              help='set the rate at which I/Os are traced across all layers by the "io" tpoint group')
+    p.add_argument('rate', help='one out of every rate I/Os is sampled, 0 disables sampling', type=int)
+    p.set_defaults(func=trace_set_io_sample_rate)
+
     def trace_get_tpoint_group_mask(args):
         print_dict(rpc.trace.trace_get_tpoint_group_mask(args.client))
 
@@ -2497,11 +2505,15 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     def ublk_create_target(args):
         rpc.ublk.ublk_create_target(args.client,
                                     cpumask=args.cpumask,
-                                    disable_user_copy=args.disable_user_copy)
+                                    disable_user_copy=args.disable_user_copy,
+                                    disable_fixed_buffers=args.disable_fixed_buffers,
+                                    disable_queue_affinity=args.disable_queue_affinity)
     p = subparsers.add_parser('ublk_create_target',
                               help='Create spdk ublk target for ublk dev')
     p.add_argument('-m', '--cpumask', help='cpu mask for ublk dev')
     p.add_argument('--disable-user-copy', help='Disable user copy feature', action='store_true')
+    p.add_argument('--disable-fixed-buffers', help='Disable registered buffers for user copy', action='store_true')
+    p.add_argument('--disable-queue-affinity', help='Disable placing queues on their blk-mq CPUs', action='store_true')
     p.set_defaults(func=ublk_create_target)
 
     def ublk_destroy_target(args):
@@ -3293,6 +3305,18 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-m', '--module', help='name of module')
     p.set_defaults(func=accel_assign_opc)
 
+    def accel_assign_opc_modules(args):
+        rpc.accel.accel_assign_opc_modules(args.client, opname=args.opname, modules=args.modules.split(','),
+                                           policy=args.policy, queue_depth=args.queue_depth)
+
+    p = subparsers.add_parser('accel_assign_opc_modules', help='Balance an operation across several modules.')
+    p.add_argument('-o', '--opname', help='opname', required=True)
+    p.add_argument('-m', '--modules', help='comma separated names of modules', required=True)
+    p.add_argument('-p', '--policy', help='module selection policy', choices=['spillover', 'latency'])
+    p.add_argument('-q', '--queue-depth', help='number of outstanding operations on a module before moving on to the others',
+                   type=int)
+    p.set_defaults(func=accel_assign_opc_modules)
+
     def accel_crypto_key_create(args):
         print_dict(rpc.accel.accel_crypto_key_create(args.client,
                                                      cipher=args.cipher,
@@ -3335,16 +3359,38 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
 
     def accel_set_options(args):
         rpc.accel.accel_set_options(args.client, args.small_cache_size, args.large_cache_size,
-                                    args.task_count, args.sequence_count, args.buf_count)
+                                    args.task_count, args.sequence_count, args.buf_count,
+                                    compress_sample_size=args.compress_sample_size,
+                                    compress_entropy_threshold=args.compress_entropy_threshold,
+                                    magazine_size=args.magazine_size,
+                                    depot_count=args.depot_count)
 
     p = subparsers.add_parser('accel_set_options', help='Set accel framework\'s options')
     p.add_argument('--small-cache-size', type=int, help='Size of the small iobuf cache')
     p.add_argument('--large-cache-size', type=int, help='Size of the large iobuf cache')
-    p.add_argument('--task-count', type=int, help='Maximum number of tasks per IO channel')
-    p.add_argument('--sequence-count', type=int, help='Maximum number of sequences per IO channel')
-    p.add_argument('--buf-count', type=int, help='Maximum number of buffers per IO channel')
+    p.add_argument('--task-count', type=int, help='Number of tasks allocated with each IO channel')
+    p.add_argument('--sequence-count', type=int, help='Number of sequences allocated with each IO channel')
+    p.add_argument('--buf-count', type=int, help='Number of buffers allocated with each IO channel')
+    p.add_argument('--compress-sample-size', type=int, help='Number of bytes sampled to detect ' +
+                   'incompressible data, 0 disables the check')
+    p.add_argument('--compress-entropy-threshold', type=int, help='Entropy of the sample, in ' +
+                   'hundredths of a bit per byte, above which data is considered incompressible')
+    p.add_argument('--magazine-size', type=int, help='Number of objects moved at once between an ' +
+                   'IO channel and the depot of its NUMA node')
+    p.add_argument('--depot-count', type=int, help='Maximum number of tasks, sequences, and ' +
+                   'buffers each allocated per NUMA node once IO channels run out of them, 0 ' +
+                   'disables the depots')
     p.set_defaults(func=accel_set_options)
 
+    def accel_sw_set_options(args):
+        rpc.accel.accel_sw_set_options(args.client, offload_cpumask=args.offload_cpumask,
+                                       offload_queue_depth=args.offload_queue_depth)
+
+    p = subparsers.add_parser('accel_sw_set_options', help='Set the software accel module\'s options')
+    p.add_argument('--offload-cpumask', help='Cores of the helper threads executing the tasks')
+    p.add_argument('--offload-queue-depth', type=int, help='Maximum number of tasks offloaded per IO channel')
+    p.set_defaults(func=accel_sw_set_options)
+
     def accel_get_stats(args):
         print_dict(rpc.accel.accel_get_stats(args.client))
 
@@ -3599,6 +3645,14 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-m', '--cpumask', help='cpumask for this thread')
     p.set_defaults(func=thread_set_cpumask)
 
+    def thread_set_cycle_sample_rate(args):
+        rpc.app.thread_set_cycle_sample_rate(args.client, rate=args.rate)
+    p = subparsers.add_parser('thread_set_cycle_sample_rate',
+                              help="""set how often the cycles spent in pollers and messages are
+    measured, one out of rate runs is timed and 0 disables the accounting""")
+    p.add_argument('rate', type=int, help='sampling rate')
+    p.set_defaults(func=thread_set_cycle_sample_rate)
+
     def log_enable_timestamps(args):
         ret = rpc.app.log_enable_timestamps(args.client,
                                             enabled=args.enabled)
@@ -3676,17 +3730,22 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
 
     def fsdev_set_opts(args):
         print(rpc.fsdev.fsdev_set_opts(args.client, fsdev_io_pool_size=args.fsdev_io_pool_size,
-                                       fsdev_io_cache_size=args.fsdev_io_cache_size))
+                                       fsdev_io_cache_size=args.fsdev_io_cache_size,
+                                       lookup_cache_size=args.lookup_cache_size,
+                                       lookup_cache_lease_ms=args.lookup_cache_lease_ms))
 
     p = subparsers.add_parser('fsdev_set_opts', help='Set the fsdev subsystem options')
     p.add_argument('fsdev-io-pool-size', help='Size of fsdev IO objects pool', type=int)
     p.add_argument('fsdev-io-cache-size', help='Size of fsdev IO objects cache per thread', type=int)
+    p.add_argument('--lookup-cache-size', help='Max number of cached entries per fsdev (0 disables the cache)', type=int)
+    p.add_argument('--lookup-cache-lease-ms', help='Lifetime of a cached entry or attribute in milliseconds', type=int)
     p.set_defaults(func=fsdev_set_opts)
 
     def fsdev_aio_create(args):
         print(rpc.fsdev.fsdev_aio_create(args.client, name=args.name, root_path=args.root_path,
                                          enable_xattr=args.enable_xattr, enable_writeback_cache=args.enable_writeback_cache,
-                                         max_write=args.max_write, skip_rw=args.skip_rw))
+                                         max_write=args.max_write, skip_rw=args.skip_rw,
+                                         md_threads=args.md_threads, enable_uring=args.enable_uring))
 
     p = subparsers.add_parser('fsdev_aio_create', help='Create a aio filesystem')
     p.add_argument('name', help='Filesystem name. Example: aio0.')
@@ -3705,6 +3764,10 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
 
     p.add_argument('--skip-rw', dest='skip_rw', help="Do not process read or write commands. This is used for testing.",
                    action='store_true', default=None)
+    p.add_argument('--md-threads', help='Number of threads running the metadata operations, 0 to run them '
+                   'on the SPDK threads (default: 0)', type=int)
+    p.add_argument('--enable-uring', help='Use io_uring instead of AIO for the reads and writes', action='store_true',
+                   default=None)
 
     p.set_defaults(func=fsdev_aio_create)
 
@@ -3888,13 +3951,22 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                     large_pool_count=args.large_pool_count,
                                     small_bufsize=args.small_bufsize,
                                     large_bufsize=args.large_bufsize,
-                                    enable_numa=args.enable_numa)
+                                    enable_numa=args.enable_numa,
+                                    mid_pool_counts=args.mid_pool_counts,
+                                    mid_bufsizes=args.mid_bufsizes,
+                                    slab_size=args.slab_size)
     p = subparsers.add_parser('iobuf_set_options', help='Set iobuf pool options')
     p.add_argument('--small-pool-count', help='number of small buffers in the global pool', type=int)
     p.add_argument('--large-pool-count', help='number of large buffers in the global pool', type=int)
     p.add_argument('--small-bufsize', help='size of a small buffer', type=int)
     p.add_argument('--large-bufsize', help='size of a large buffer', type=int)
     p.add_argument('--enable-numa', help='enable per-NUMA node buffer pools', action='store_true')
+    p.add_argument('--mid-pool-counts', help='comma separated numbers of buffers of the additional pools',
+                   type=lambda x: [int(c) for c in x.split(',')])
+    p.add_argument('--mid-bufsizes', help='comma separated buffer sizes of the additional pools, between the ' +
+                   'small and large buffer sizes, in increasing order', type=lambda x: [int(s) for s in x.split(',')])
+    p.add_argument('--slab-size', help='size of the slabs the pools grow by on demand, 0 allocates them in ' +
+                   'full at startup', type=int)
     p.set_defaults(func=iobuf_set_options)
 
     def iobuf_get_stats(args):
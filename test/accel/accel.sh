@@ -32,6 +32,8 @@ build_accel_config() {
 	[[ $SPDK_TEST_ACCEL_DSA -gt 0 ]] && accel_json_cfg+=('{"method": "dsa_scan_accel_module"}')
 	[[ $SPDK_TEST_ACCEL_IAA -gt 0 ]] && accel_json_cfg+=('{"method": "iaa_scan_accel_module"}')
 	[[ $SPDK_TEST_IOAT -gt 0 ]] && accel_json_cfg+=('{"method": "ioat_scan_accel_module"}')
+	[[ -n $SW_OFFLOAD_CPUMASK ]] && accel_json_cfg+=("{\"method\": \"accel_sw_set_options\", \"params\":{\"offload_cpumask\": \"$SW_OFFLOAD_CPUMASK\"}}")
+	[[ -n $BALANCE_POLICY ]] && accel_json_cfg+=("{\"method\": \"accel_assign_opc_modules\", \"params\":{\"opname\": \"crc32c\", \"modules\": [\"software\", \"error\"], \"policy\": \"$BALANCE_POLICY\", \"queue_depth\": 8}}")
 
 	if [[ $COMPRESSDEV ]]; then
 		accel_json_cfg+=('{"method": "compressdev_scan_accel_module", "params":{"pmd": 0}}')
@@ -136,4 +138,19 @@ if [[ $CONFIG_DPDK_COMPRESSDEV == y ]]; then
 	unset COMPRESSDEV
 fi
 
+# Execute the software module's tasks on a helper thread running on the second core
+SW_OFFLOAD_CPUMASK=0x2
+run_test "accel_sw_offload_crc32c" accel_test -t 1 -w crc32c -y -m 0x3
+run_test "accel_sw_offload_copy" accel_test -t 1 -w copy -y -m 0x3 -q 128
+run_test "accel_sw_offload_dif_generate" accel_test -t 1 -w dif_generate -m 0x3
+unset SW_OFFLOAD_CPUMASK
+
+# Balance crc32c across the software module and the error module (a passthrough to the software
+# module, as long as no errors are injected)
+BALANCE_POLICY=spillover
+run_test "accel_balance_spillover_crc32c" accel_perf -t 1 -w crc32c -y -q 64
+BALANCE_POLICY=latency
+run_test "accel_balance_latency_crc32c" accel_perf -t 1 -w crc32c -y -q 64
+unset BALANCE_POLICY
+
 run_test "accel_dif_functional_tests" "$testdir/dif/dif" -c <(build_accel_config)
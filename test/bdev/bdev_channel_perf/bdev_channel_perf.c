@@ -0,0 +1,319 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Measures how long it takes to get and put an IO channel of every bdev on each
+ * reactor at the same time, which is what happens at startup of a target serving
+ * many bdevs.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/env.h"
+#include "spdk/event.h"
+#include "spdk/log.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+struct channel_perf_worker {
+	struct spdk_thread		*thread;
+	struct spdk_io_channel		**channels;
+	uint64_t			tsc;
+	uint32_t			failed;
+};
+
+struct channel_perf_phase {
+	const char			*name;
+	spdk_msg_fn			fn;
+};
+
+static struct spdk_bdev_desc **g_descs;
+static uint32_t g_num_descs;
+static struct channel_perf_worker *g_workers;
+static uint32_t g_num_workers;
+static uint32_t g_num_done;
+static uint32_t g_phase;
+static uint64_t g_start_tsc;
+static struct spdk_thread *g_main_thread;
+static int g_rc;
+
+static void channel_perf_run_phase(void);
+
+static void
+channel_perf_get(void *ctx)
+{
+	struct channel_perf_worker *worker = ctx;
+	uint64_t tsc = spdk_get_ticks();
+	uint32_t i;
+
+	for (i = 0; i < g_num_descs; i++) {
+		worker->channels[i] = spdk_bdev_get_io_channel(g_descs[i]);
+		if (worker->channels[i] == NULL) {
+			worker->failed++;
+		}
+	}
+
+	worker->tsc = spdk_get_ticks() - tsc;
+}
+
+static void
+channel_perf_get_existing(void *ctx)
+{
+	struct channel_perf_worker *worker = ctx;
+	uint64_t tsc = spdk_get_ticks();
+	struct spdk_io_channel *ch;
+	uint32_t i;
+
+	/* Every channel already exists on this thread, so this only takes another reference */
+	for (i = 0; i < g_num_descs; i++) {
+		ch = spdk_bdev_get_io_channel(g_descs[i]);
+		if (ch != worker->channels[i]) {
+			worker->failed++;
+		}
+		if (ch != NULL) {
+			spdk_put_io_channel(ch);
+		}
+	}
+
+	worker->tsc = spdk_get_ticks() - tsc;
+}
+
+static void
+channel_perf_put(void *ctx)
+{
+	struct channel_perf_worker *worker = ctx;
+	uint64_t tsc = spdk_get_ticks();
+	uint32_t i;
+
+	for (i = 0; i < g_num_descs; i++) {
+		if (worker->channels[i] != NULL) {
+			spdk_put_io_channel(worker->channels[i]);
+			worker->channels[i] = NULL;
+		}
+	}
+
+	worker->tsc = spdk_get_ticks() - tsc;
+}
+
+static const struct channel_perf_phase g_phases[] = {
+	{ "get", channel_perf_get },
+	{ "get existing", channel_perf_get_existing },
+	{ "put", channel_perf_put },
+};
+
+static void
+channel_perf_exit_worker(void *ctx)
+{
+	spdk_thread_exit(spdk_get_thread());
+}
+
+static void
+channel_perf_stop(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < g_num_workers; i++) {
+		if (g_workers[i].thread != NULL) {
+			spdk_thread_send_msg(g_workers[i].thread, channel_perf_exit_worker, NULL);
+		}
+		free(g_workers[i].channels);
+	}
+	free(g_workers);
+	g_workers = NULL;
+
+	for (i = 0; i < g_num_descs; i++) {
+		spdk_bdev_close(g_descs[i]);
+	}
+	free(g_descs);
+	g_descs = NULL;
+
+	spdk_app_stop(g_rc);
+}
+
+static void
+channel_perf_print_phase(void)
+{
+	uint64_t tsc = spdk_get_ticks() - g_start_tsc, hz = spdk_get_ticks_hz();
+	struct channel_perf_worker *worker;
+	uint32_t i;
+
+	for (i = 0; i < g_num_workers; i++) {
+		worker = &g_workers[i];
+		printf("%-20s %-12s %8" PRIu32 " channels in %10.3f ms, %8.3f us per channel\n",
+		       spdk_thread_get_name(worker->thread), g_phases[g_phase].name, g_num_descs,
+		       (double)worker->tsc * SPDK_SEC_TO_MSEC / hz,
+		       (double)worker->tsc * SPDK_SEC_TO_USEC / hz / g_num_descs);
+		if (worker->failed != 0) {
+			fprintf(stderr, "%s: %s failed for %" PRIu32 " channels\n",
+				spdk_thread_get_name(worker->thread), g_phases[g_phase].name,
+				worker->failed);
+			g_rc = -1;
+		}
+		worker->failed = 0;
+	}
+
+	printf("%-20s %-12s %8" PRIu64 " channels in %10.3f ms, %8.0f channels/s\n", "Total",
+	       g_phases[g_phase].name, (uint64_t)g_num_descs * g_num_workers,
+	       (double)tsc * SPDK_SEC_TO_MSEC / hz,
+	       (double)g_num_descs * g_num_workers * hz / spdk_max(tsc, 1));
+}
+
+static void
+channel_perf_worker_done(void *ctx)
+{
+	if (++g_num_done < g_num_workers) {
+		return;
+	}
+
+	channel_perf_print_phase();
+
+	if (g_rc != 0 || ++g_phase == SPDK_COUNTOF(g_phases)) {
+		/* Put whatever channels were taken before bailing out */
+		if (g_phase < SPDK_COUNTOF(g_phases) - 1) {
+			g_phase = SPDK_COUNTOF(g_phases) - 1;
+			channel_perf_run_phase();
+			return;
+		}
+		channel_perf_stop();
+		return;
+	}
+
+	channel_perf_run_phase();
+}
+
+static void
+channel_perf_run_worker(void *ctx)
+{
+	g_phases[g_phase].fn(ctx);
+	spdk_thread_send_msg(g_main_thread, channel_perf_worker_done, NULL);
+}
+
+static void
+channel_perf_run_phase(void)
+{
+	uint32_t i;
+
+	g_num_done = 0;
+	g_start_tsc = spdk_get_ticks();
+	for (i = 0; i < g_num_workers; i++) {
+		spdk_thread_send_msg(g_workers[i].thread, channel_perf_run_worker, &g_workers[i]);
+	}
+}
+
+static void
+channel_perf_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void *ctx)
+{
+}
+
+static int
+channel_perf_open_bdevs(void)
+{
+	struct spdk_bdev *bdev;
+	uint32_t num_bdevs = 0;
+	int rc;
+
+	for (bdev = spdk_bdev_first(); bdev != NULL; bdev = spdk_bdev_next(bdev)) {
+		num_bdevs++;
+	}
+
+	if (num_bdevs == 0) {
+		fprintf(stderr, "No bdevs found, pass a configuration with --json\n");
+		return -ENODEV;
+	}
+
+	g_descs = calloc(num_bdevs, sizeof(*g_descs));
+	if (g_descs == NULL) {
+		return -ENOMEM;
+	}
+
+	for (bdev = spdk_bdev_first(); bdev != NULL; bdev = spdk_bdev_next(bdev)) {
+		rc = spdk_bdev_open_ext(spdk_bdev_get_name(bdev), false, channel_perf_bdev_event_cb,
+					NULL, &g_descs[g_num_descs]);
+		if (rc != 0) {
+			fprintf(stderr, "Could not open bdev %s: %s\n", spdk_bdev_get_name(bdev),
+				spdk_strerror(-rc));
+			return rc;
+		}
+		g_num_descs++;
+	}
+
+	return 0;
+}
+
+static int
+channel_perf_create_workers(void)
+{
+	struct spdk_cpuset cpumask;
+	char name[32];
+	uint32_t i, core;
+
+	g_workers = calloc(spdk_env_get_core_count(), sizeof(*g_workers));
+	if (g_workers == NULL) {
+		return -ENOMEM;
+	}
+
+	SPDK_ENV_FOREACH_CORE(core) {
+		i = g_num_workers++;
+
+		g_workers[i].channels = calloc(g_num_descs, sizeof(*g_workers[i].channels));
+		if (g_workers[i].channels == NULL) {
+			return -ENOMEM;
+		}
+
+		spdk_cpuset_zero(&cpumask);
+		spdk_cpuset_set_cpu(&cpumask, core, true);
+		snprintf(name, sizeof(name), "channel_perf_%" PRIu32, core);
+		g_workers[i].thread = spdk_thread_create(name, &cpumask);
+		if (g_workers[i].thread == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void
+channel_perf_start(void *ctx)
+{
+	int rc;
+
+	g_main_thread = spdk_get_thread();
+
+	rc = channel_perf_open_bdevs();
+	if (rc == 0) {
+		rc = channel_perf_create_workers();
+	}
+
+	if (rc != 0) {
+		g_rc = rc;
+		channel_perf_stop();
+		return;
+	}
+
+	printf("Getting IO channels of %" PRIu32 " bdevs on %" PRIu32 " threads\n",
+	       g_num_descs, g_num_workers);
+	channel_perf_run_phase();
+}
+
+int
+main(int argc, char **argv)
+{
+	struct spdk_app_opts opts = {};
+	int rc;
+
+	spdk_app_opts_init(&opts, sizeof(opts));
+	opts.name = "bdev_channel_perf";
+	opts.rpc_addr = NULL;
+
+	rc = spdk_app_parse_args(argc, argv, &opts, "", NULL, NULL, NULL);
+	if (rc != SPDK_APP_PARSE_ARGS_SUCCESS) {
+		return rc;
+	}
+
+	rc = spdk_app_start(&opts, channel_perf_start, NULL);
+	spdk_app_fini();
+
+	return rc;
+}
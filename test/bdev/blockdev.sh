@@ -647,6 +647,24 @@ function dif_insert_strip_test_suite() {
 	trap - SIGINT SIGTERM EXIT
 }
 
+# Get and put IO channels of 10000 null bdevs on two reactors at the same time
+function bdev_channel_perf_test() {
+	local channel_perf_conf="$testdir/channel_perf.json"
+	local i
+
+	{
+		echo '{"subsystems": [{"subsystem": "bdev", "config": ['
+		for ((i = 0; i < 10000; i++)); do
+			((i > 0)) && echo ','
+			echo "{\"method\": \"bdev_null_create\", \"params\": {\"name\": \"Null$i\", \"num_blocks\": 1024, \"block_size\": 512}}"
+		done
+		echo ']}]}'
+	} > "$channel_perf_conf"
+
+	$testdir/bdev_channel_perf/bdev_channel_perf -m 0x3 --json "$channel_perf_conf" "$env_ctx"
+	rm -f "$channel_perf_conf"
+}
+
 function bdev_gpt_uuid() {
 	local bdev
 
@@ -827,6 +845,7 @@ if [[ $test_type == bdev ]]; then
 	run_test "bdev_error" error_test_suite "$env_ctx"
 	run_test "bdev_stat" stat_test_suite "$env_ctx"
 	run_test "bdev_dif_insert_strip" dif_insert_strip_test_suite "$env_ctx"
+	run_test "bdev_channel_perf" bdev_channel_perf_test
 fi
 
 if [[ $test_type == gpt ]]; then
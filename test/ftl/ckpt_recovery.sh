@@ -0,0 +1,103 @@
+#!/usr/bin/env bash
+#  SPDX-License-Identifier: BSD-3-Clause
+#
+testdir=$(readlink -f $(dirname $0))
+rootdir=$(readlink -f $testdir/../..)
+source $rootdir/test/common/autotest_common.sh
+source $testdir/common.sh
+
+rpc_py=$rootdir/scripts/rpc.py
+spdk_dd="$SPDK_BIN_DIR/spdk_dd"
+
+while getopts ':c:' opt; do
+	case $opt in
+		c) nv_cache=$OPTARG ;;
+		?) echo "Usage: $0 -c NV_CACHE_PCI_BDF BASE_PCI_BDF" && exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+device=$1
+timeout=240
+
+block_size=4096
+chunk_size=262144
+# Data written before and after the L2P checkpoint
+data_size=$((chunk_size * 4))
+
+restore_kill() {
+	rm -f $testdir/config/ftl.json
+	rm -f $testdir/testfile
+	rm -f $testdir/testfile2
+	rm -f $testdir/testfile.md5
+	rm -f $testdir/testfile2.md5
+	rm -f $testdir/recovery.log
+
+	killprocess $svcpid || true
+	rmmod nbd || true
+	remove_shm
+}
+
+trap "restore_kill; exit 1" SIGINT SIGTERM EXIT
+
+ftl_get_ckpt_count() {
+	$rpc_py bdev_ftl_get_properties -b ftl0 | jq '.properties[] | select(.name == "l2p_checkpoint") | .count'
+}
+
+"$SPDK_BIN_DIR/spdk_tgt" -m 0x1 &
+svcpid=$!
+# Wait until spdk_tgt starts
+waitforlisten $svcpid
+
+split_bdev=$(create_base_bdev nvme0 $device $((1024 * 101)))
+nvc_bdev=$(create_nv_cache_bdev nvc0 $nv_cache $split_bdev)
+
+# Keep the L2P cache small, so only a part of it is resident when the checkpoint is taken
+l2p_dram_size_mb=$(($(get_bdev_size $split_bdev) * 10 / 100 / 1024))
+$rpc_py -t $timeout bdev_ftl_create -b ftl0 -d $split_bdev -c $nvc_bdev --l2p_dram_limit $l2p_dram_size_mb
+
+(
+	echo '{"subsystems": ['
+	$rpc_py save_subsystem_config -n bdev
+	echo ']}'
+) > $testdir/config/ftl.json
+
+modprobe nbd
+$rpc_py nbd_start_disk ftl0 /dev/nbd0
+waitfornbd nbd0
+
+# Write enough data to advance the sequence ID past the checkpoint interval
+$spdk_dd -m 0x2 --if=/dev/urandom --of=$testdir/testfile --bs=$block_size --count=$data_size
+md5sum $testdir/testfile > $testdir/testfile.md5
+$spdk_dd -m 0x2 --if=$testdir/testfile --of=/dev/nbd0 --bs=$block_size --count=$data_size --oflag=direct
+sync /dev/nbd0
+
+# Wait for the background L2P checkpoint
+for ((i = 0; i < timeout; i++)); do
+	[[ $(ftl_get_ckpt_count) -gt 0 ]] && break
+	sleep 1
+done
+[[ $(ftl_get_ckpt_count) -gt 0 ]]
+
+# Data written after the checkpoint has to be recovered by the replay
+$spdk_dd -m 0x2 --if=/dev/urandom --of=$testdir/testfile2 --bs=$block_size --count=$chunk_size
+md5sum $testdir/testfile2 > $testdir/testfile2.md5
+$spdk_dd -m 0x2 --if=$testdir/testfile2 --of=/dev/nbd0 --bs=$block_size --count=$chunk_size \
+	--seek=$data_size --oflag=direct
+sync /dev/nbd0
+$rpc_py nbd_stop_disk /dev/nbd0
+
+# Force kill bdev service (dirty shutdown) without unloading FTL
+kill -9 $svcpid
+rm -f /dev/shm/spdk_tgt_trace.pid$svcpid
+
+# Verify that the recovery started from the checkpoint and the data is consistent
+$spdk_dd --ib=ftl0 --of=$testdir/testfile --count=$data_size --json=$testdir/config/ftl.json \
+	2>&1 | tee $testdir/recovery.log
+grep -q "L2P checkpoint seq ID" $testdir/recovery.log
+md5sum -c $testdir/testfile.md5
+$spdk_dd --ib=ftl0 --of=$testdir/testfile2 --count=$chunk_size --skip=$data_size --json=$testdir/config/ftl.json
+md5sum -c $testdir/testfile2.md5
+
+trap - SIGINT SIGTERM EXIT
+restore_kill
@@ -75,6 +75,7 @@ run_test "ftl_bdevperf" $testdir/bdevperf.sh $device $nv_cache
 run_test "ftl_trim" $testdir/trim.sh $device $nv_cache
 run_test "ftl_restore" $testdir/restore.sh -c $nv_cache $device
 run_test "ftl_dirty_shutdown" $testdir/dirty_shutdown.sh -c $nv_cache $device
+run_test "ftl_ckpt_recovery" $testdir/ckpt_recovery.sh -c $nv_cache $device
 run_test "ftl_upgrade_shutdown" $testdir/upgrade_shutdown.sh $device $nv_cache
 
 if [[ $RUN_NIGHTLY -eq 1 ]]; then
@@ -0,0 +1,276 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/env.h"
+#include "spdk/event.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#define MAX_IN_FLIGHT	8192
+
+enum msg_perf_mode {
+	MSG_PERF_SEND,
+	MSG_PERF_BULK,
+	MSG_PERF_POST,
+};
+
+static const char *g_mode_names[] = {
+	[MSG_PERF_SEND] = "send",
+	[MSG_PERF_BULK] = "bulk",
+	[MSG_PERF_POST] = "post",
+};
+
+static enum msg_perf_mode g_mode = MSG_PERF_SEND;
+static int g_batch_size = 16;
+static int g_time_in_sec;
+
+static struct spdk_thread *g_receiver;
+static struct spdk_poller *g_send_poller;
+static struct spdk_poller *g_timer;
+static uint64_t g_sent;
+static uint64_t g_ring_ops;
+static uint64_t g_received;
+static uint64_t g_start_tsc;
+static bool g_stopping;
+static int g_rc;
+
+static struct spdk_thread_stats g_start_stats;
+
+static void
+msg_perf_receive(void *ctx)
+{
+	__atomic_fetch_add(&g_received, 1, __ATOMIC_RELAXED);
+}
+
+static void _msg_perf_end(void);
+
+static int
+msg_perf_send(void *arg)
+{
+	void *ctx[SPDK_THREAD_MAX_BULK_MSGS] = {};
+	uint64_t received = __atomic_load_n(&g_received, __ATOMIC_RELAXED);
+	int i, rc = 0;
+
+	if (g_sent - received + g_batch_size > MAX_IN_FLIGHT) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	switch (g_mode) {
+	case MSG_PERF_SEND:
+		for (i = 0; i < g_batch_size && rc == 0; i++) {
+			rc = spdk_thread_send_msg(g_receiver, msg_perf_receive, NULL);
+		}
+		g_ring_ops += g_batch_size;
+		break;
+	case MSG_PERF_BULK:
+		rc = spdk_thread_send_msg_bulk(g_receiver, msg_perf_receive, ctx, g_batch_size);
+		g_ring_ops++;
+		break;
+	case MSG_PERF_POST:
+		for (i = 0; i < g_batch_size && rc == 0; i++) {
+			rc = spdk_thread_post_msg(g_receiver, msg_perf_receive, NULL);
+		}
+		/* The outbox is flushed when full and at the end of each poll */
+		g_ring_ops += spdk_divide_round_up(g_batch_size, 32);
+		break;
+	}
+
+	if (rc != 0) {
+		fprintf(stderr, "Failed to send messages: %s\n", spdk_strerror(-rc));
+		g_rc = rc;
+		_msg_perf_end();
+		return SPDK_POLLER_IDLE;
+	}
+
+	g_sent += g_batch_size;
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+msg_perf_exit_receiver(void *ctx)
+{
+	spdk_thread_exit(spdk_get_thread());
+}
+
+static void
+_msg_perf_end(void)
+{
+	struct spdk_thread_stats end_stats;
+	uint64_t tsc_hz, busy_cyc, elapsed_tsc, msg_cost_cyc, msg_cost_nsec;
+
+	if (g_stopping) {
+		return;
+	}
+	g_stopping = true;
+
+	spdk_thread_get_stats(&end_stats);
+	busy_cyc = end_stats.busy_tsc - g_start_stats.busy_tsc;
+	elapsed_tsc = spdk_get_ticks() - g_start_tsc;
+	tsc_hz = spdk_get_ticks_hz();
+
+	printf("\r ======================================\n");
+
+	printf("\r mode: %s\n", g_mode_names[g_mode]);
+	printf("\r batch_size: %d\n", g_batch_size);
+	printf("\r busy:%" PRIu64 " (cyc)\n", busy_cyc);
+	printf("\r total_sent: %" PRIu64 "\n", g_sent);
+	printf("\r total_received: %" PRIu64 "\n", __atomic_load_n(&g_received, __ATOMIC_RELAXED));
+	printf("\r total_ring_enqueues: %" PRIu64 "\n", g_ring_ops);
+	printf("\r tsc_hz: %" PRIu64 " (cyc)\n", tsc_hz);
+
+	printf("\r ======================================\n");
+
+	msg_cost_cyc = busy_cyc / spdk_max(g_sent, 1);
+	msg_cost_nsec = (msg_cost_cyc * SPDK_SEC_TO_NSEC) / tsc_hz;
+
+	printf("\r send_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n", msg_cost_cyc, msg_cost_nsec);
+	printf("\r msgs_per_sec: %" PRIu64 "\n", g_sent * tsc_hz / spdk_max(elapsed_tsc, 1));
+
+	spdk_poller_unregister(&g_timer);
+	spdk_poller_unregister(&g_send_poller);
+
+	if (g_receiver != NULL) {
+		spdk_thread_send_msg(g_receiver, msg_perf_exit_receiver, NULL);
+	}
+
+	spdk_app_stop(g_rc);
+}
+
+static int
+msg_perf_end(void *arg)
+{
+	_msg_perf_end();
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+msg_perf_start(void *arg1)
+{
+	struct spdk_cpuset cpumask;
+	uint32_t core;
+
+	/* Receive the messages on another core if there is one */
+	core = spdk_env_get_next_core(spdk_env_get_current_core());
+	if (core == UINT32_MAX) {
+		core = spdk_env_get_current_core();
+	}
+
+	spdk_cpuset_zero(&cpumask);
+	spdk_cpuset_set_cpu(&cpumask, core, true);
+	g_receiver = spdk_thread_create("msg_perf_receiver", &cpumask);
+	if (g_receiver == NULL) {
+		fprintf(stderr, "Failed to create the receiver thread\n");
+		spdk_app_stop(-ENOMEM);
+		return;
+	}
+
+	printf("Sending messages in batches of %d with %s for %d seconds to core %" PRIu32 ".\n",
+	       g_batch_size, g_mode_names[g_mode], g_time_in_sec, core);
+	fflush(stdout);
+
+	spdk_thread_get_stats(&g_start_stats);
+	g_start_tsc = spdk_get_ticks();
+
+	g_send_poller = SPDK_POLLER_REGISTER(msg_perf_send, NULL, 0);
+	g_timer = SPDK_POLLER_REGISTER(msg_perf_end, NULL, g_time_in_sec * SPDK_SEC_TO_USEC);
+}
+
+static void
+msg_perf_shutdown_cb(void)
+{
+	_msg_perf_end();
+}
+
+static int
+msg_perf_parse_arg(int ch, char *arg)
+{
+	int tmp;
+
+	if (ch == 'M') {
+		for (tmp = 0; tmp < (int)SPDK_COUNTOF(g_mode_names); tmp++) {
+			if (strcmp(arg, g_mode_names[tmp]) == 0) {
+				g_mode = tmp;
+				return 0;
+			}
+		}
+		fprintf(stderr, "Unknown mode %s.\n", arg);
+		return -EINVAL;
+	}
+
+	tmp = spdk_strtol(optarg, 10);
+	if (tmp < 0) {
+		fprintf(stderr, "Parse failed for the option %c.\n", ch);
+		return tmp;
+	}
+
+	switch (ch) {
+	case 'b':
+		g_batch_size = tmp;
+		break;
+	case 't':
+		g_time_in_sec = tmp;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void
+msg_perf_usage(void)
+{
+	printf(" -M <mode>              send, bulk, or post\n");
+	printf(" -b <number>            number of messages sent per poll\n");
+	printf(" -t <time>              run time in seconds\n");
+}
+
+static int
+msg_perf_verify_params(void)
+{
+	if (g_batch_size <= 0 || g_batch_size > SPDK_THREAD_MAX_BULK_MSGS) {
+		fprintf(stderr, "batch size must be between 1 and %d\n", SPDK_THREAD_MAX_BULK_MSGS);
+		return -EINVAL;
+	}
+
+	if (g_time_in_sec <= 0) {
+		fprintf(stderr, "run time must be positive\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct spdk_app_opts opts;
+	int rc;
+
+	spdk_app_opts_init(&opts, sizeof(opts));
+	opts.name = "msg_perf";
+	opts.shutdown_cb = msg_perf_shutdown_cb;
+	opts.rpc_addr = NULL;
+
+	rc = spdk_app_parse_args(argc, argv, &opts, "M:b:t:", NULL,
+				 msg_perf_parse_arg, msg_perf_usage);
+	if (rc != SPDK_APP_PARSE_ARGS_SUCCESS) {
+		return rc;
+	}
+
+	rc = msg_perf_verify_params();
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = spdk_app_start(&opts, msg_perf_start, NULL);
+
+	spdk_app_fini();
+
+	return rc;
+}
@@ -9,15 +9,17 @@
 #include "spdk/thread.h"
 #include "spdk/util.h"
 
-#define MAX_NUM_POLLERS	1000
+#define MAX_NUM_POLLERS	16384
 
 static int g_time_in_sec;
 static int g_period_in_usec;
 static int g_num_pollers;
 
 static struct spdk_poller *g_timer;
+static struct spdk_poller *g_poll_counter;
 static struct spdk_poller *g_pollers[MAX_NUM_POLLERS];
 static uint64_t g_run_count;
+static uint64_t g_poll_count;
 
 static struct spdk_thread_stats g_start_stats;
 
@@ -29,22 +31,35 @@ poller_run(void *arg)
 	return SPDK_POLLER_BUSY;
 }
 
+/* Runs once per spdk_thread_poll() call, to measure the cost of a whole iteration. */
+static int
+poll_count(void *arg)
+{
+	g_poll_count++;
+
+	return SPDK_POLLER_IDLE;
+}
+
 static void
 _poller_perf_end(void)
 {
 	struct spdk_thread_stats end_stats;
-	uint64_t tsc_hz, busy_cyc, poller_cost_cyc, poller_cost_nsec;
+	uint64_t tsc_hz, busy_cyc, idle_cyc, poller_cost_cyc, poller_cost_nsec;
+	uint64_t poll_cost_cyc, poll_cost_nsec;
 	int i;
 
 	spdk_thread_get_stats(&end_stats);
 	busy_cyc = end_stats.busy_tsc - g_start_stats.busy_tsc;
+	idle_cyc = end_stats.idle_tsc - g_start_stats.idle_tsc;
 
 	tsc_hz = spdk_get_ticks_hz();
 
 	printf("\r ======================================\n");
 
 	printf("\r busy:%" PRIu64 " (cyc)\n", busy_cyc);
+	printf("\r idle:%" PRIu64 " (cyc)\n", idle_cyc);
 	printf("\r total_run_count: %" PRIu64 "\n", g_run_count);
+	printf("\r total_poll_count: %" PRIu64 "\n", g_poll_count);
 	printf("\r tsc_hz: %" PRIu64 " (cyc)\n", tsc_hz);
 
 	printf("\r ======================================\n");
@@ -55,7 +70,14 @@ _poller_perf_end(void)
 	printf("\r poller_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n",
 	       poller_cost_cyc, poller_cost_nsec);
 
+	poll_cost_cyc = (busy_cyc + idle_cyc) / spdk_max(g_poll_count, 1);
+	poll_cost_nsec = (poll_cost_cyc * SPDK_SEC_TO_NSEC) / tsc_hz;
+
+	printf("\r thread_poll_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n",
+	       poll_cost_cyc, poll_cost_nsec);
+
 	spdk_poller_unregister(&g_timer);
+	spdk_poller_unregister(&g_poll_counter);
 
 	for (i = 0; i < g_num_pollers; i++) {
 		spdk_poller_unregister(&g_pollers[i]);
@@ -85,6 +107,8 @@ poller_perf_start(void *arg1)
 		g_pollers[i] = SPDK_POLLER_REGISTER(poller_run, NULL, g_period_in_usec);
 	}
 
+	g_poll_counter = SPDK_POLLER_REGISTER(poll_count, NULL, 0);
+
 	spdk_thread_get_stats(&g_start_stats);
 
 	g_timer = SPDK_POLLER_REGISTER(poller_perf_end, NULL, g_time_in_sec * SPDK_SEC_TO_USEC);
@@ -10,6 +10,12 @@ source $rootdir/test/common/autotest_common.sh
 
 run_test "thread_poller_perf" $testdir/poller_perf/poller_perf -b 1000 -l 1 -t 1
 run_test "thread_poller_perf" $testdir/poller_perf/poller_perf -b 1000 -l 0 -t 1
+run_test "thread_poller_perf_rbtree" $testdir/poller_perf/poller_perf -b 10000 -l 1000 -t 1
+run_test "thread_poller_perf_timer_wheel" $testdir/poller_perf/poller_perf -b 10000 -l 1000 -t 1 \
+	--timer-wheel
+run_test "thread_msg_perf_send" $testdir/msg_perf/msg_perf -m 0x3 -M send -b 32 -t 1
+run_test "thread_msg_perf_bulk" $testdir/msg_perf/msg_perf -m 0x3 -M bulk -b 32 -t 1
+run_test "thread_msg_perf_post" $testdir/msg_perf/msg_perf -m 0x3 -M post -b 32 -t 1
 
 # spdk_lock.c includes thread.c, which causes problems when registering the same
 # tracepoint for "thread" in the program and shared library. It is sufficient
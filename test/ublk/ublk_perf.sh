@@ -0,0 +1,70 @@
+#!/usr/bin/env bash
+#  SPDX-License-Identifier: BSD-3-Clause
+#
+# Compares the throughput of a ublk device backed by a null bdev with the different data
+# transfer and queue placement modes of the ublk target:
+#   get_data        - UBLK_F_NEED_GET_DATA, the kernel copies the data (--disable-user-copy)
+#   user_copy       - user copy without the buffers registered with the queue rings
+#   fixed_bufs      - user copy with the registered buffers (default)
+#   no_affinity     - as fixed_bufs, but queues placed round robin (--disable-queue-affinity)
+#   interrupt       - as fixed_bufs, with spdk_tgt in interrupt mode
+#
+# Usage: ublk_perf.sh [runtime in seconds]
+#
+testdir=$(readlink -f "$(dirname $0)")
+rootdir=$(readlink -f "$testdir/../..")
+source "$rootdir/test/common/autotest_common.sh"
+
+RUNTIME=${1:-10}
+CPU_MASK=0xf
+NUM_QUEUE=4
+QUEUE_DEPTH=128
+FIO_JOBS=4
+
+modprobe ublk_drv
+
+function cleanup() {
+	killprocess $spdk_pid
+}
+
+function run_fio() {
+	local rw=$1 bs=$2
+
+	taskset -c 4-7 fio --name=ublk_perf --filename=/dev/ublkb1 --ioengine=libaio --direct=1 \
+		--rw=$rw --bs=$bs --iodepth=32 --numjobs=$FIO_JOBS --group_reporting --time_based \
+		--runtime=$RUNTIME --output-format=json \
+		| jq -r --arg rw "${rw#rand}" '.jobs[0][$rw] | "\(.iops | floor) IOPS, \(.bw / 1024 | floor) MiB/s"'
+}
+
+function run_mode() {
+	local mode=$1 app_args=$2
+	shift 2
+
+	"$SPDK_BIN_DIR/spdk_tgt" -m $CPU_MASK $app_args &
+	spdk_pid=$!
+	trap 'cleanup; exit 1' SIGINT SIGTERM EXIT
+	waitforlisten $spdk_pid
+
+	rpc_cmd ublk_create_target "$@"
+	rpc_cmd bdev_null_create null0 1024 4096
+	rpc_cmd ublk_start_disk null0 1 -q $NUM_QUEUE -d $QUEUE_DEPTH
+	waitforfile /dev/ublkb1
+
+	for rw in randread randwrite; do
+		for bs in 4k 128k; do
+			printf '%-12s %-10s %-5s %s\n' $mode $rw $bs "$(run_fio $rw $bs)"
+		done
+	done
+
+	rpc_cmd ublk_stop_disk 1
+	rpc_cmd ublk_destroy_target
+
+	trap - SIGINT SIGTERM EXIT
+	cleanup
+}
+
+run_mode get_data "" --disable-user-copy
+run_mode user_copy "" --disable-fixed-buffers
+run_mode fixed_bufs ""
+run_mode no_affinity "" --disable-queue-affinity
+run_mode interrupt --interrupt-mode
@@ -10,8 +10,34 @@
 #include "thread/thread_internal.h"
 #include "common/lib/ut_multithread.c"
 #include "common/lib/test_iobuf.c"
+
+static bool g_ut_fail_magazine_alloc;
+static uint32_t g_ut_put_io_channel_count;
+
+static void *
+ut_accel_calloc(size_t nmemb, size_t size)
+{
+	/* The magazines are the only arrays of pointers allocated with a channel */
+	if (g_ut_fail_magazine_alloc && size == sizeof(void *)) {
+		return NULL;
+	}
+
+	return calloc(nmemb, size);
+}
+
+static void
+ut_put_io_channel(struct spdk_io_channel *ch)
+{
+	g_ut_put_io_channel_count++;
+	spdk_put_io_channel(ch);
+}
+
+#define calloc(nmemb, size) ut_accel_calloc(nmemb, size)
+#define spdk_put_io_channel(ch) ut_put_io_channel(ch)
 #include "accel/accel.c"
 #include "accel/accel_sw.c"
+#undef calloc
+#undef spdk_put_io_channel
 #include "unit/lib/json_mock.c"
 
 DEFINE_STUB_V(spdk_memory_domain_destroy, (struct spdk_memory_domain *domain));
@@ -663,6 +689,262 @@ test_spdk_accel_module_register(void)
 	free_cores();
 }
 
+#define UT_BALANCE_MODULES 2
+
+static struct spdk_io_channel *g_ut_balance_ch[UT_BALANCE_MODULES] = {
+	(struct spdk_io_channel *)0xdead0000, (struct spdk_io_channel *)0xdead0001
+};
+static int g_ut_balance_rc[UT_BALANCE_MODULES];
+static int g_ut_balance_submitted[UT_BALANCE_MODULES];
+
+static int
+ut_balance_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *task)
+{
+	int i;
+
+	for (i = 0; i < UT_BALANCE_MODULES; i++) {
+		if (ch == g_ut_balance_ch[i]) {
+			if (g_ut_balance_rc[i] == 0) {
+				g_ut_balance_submitted[i]++;
+			}
+			return g_ut_balance_rc[i];
+		}
+	}
+
+	CU_ASSERT(false);
+	return -EINVAL;
+}
+
+static void
+ut_balance_cb(void *cb_arg, int status)
+{
+	int *completed = cb_arg;
+
+	(*completed)++;
+}
+
+static void
+test_spdk_accel_balance(void)
+{
+	struct spdk_accel_module_if mods[UT_BALANCE_MODULES] = {
+		{ .name = "mod0", .submit_tasks = ut_balance_submit_tasks },
+		{ .name = "mod1", .submit_tasks = ut_balance_submit_tasks },
+	};
+	const char *names[] = { "mod0", "mod1", "mod0" };
+	struct accel_balance_channel bch = {};
+	struct accel_balance *balance = &g_balance[SPDK_ACCEL_OPC_COPY];
+	struct accel_operation_stats *stats = &g_accel_ch->stats.operations[SPDK_ACCEL_OPC_COPY];
+	struct spdk_accel_task tasks[4] = {};
+	bool modules_started = g_modules_started;
+	int i, rc, completed = 0;
+
+	/* The balancing can only be configured before the framework is started */
+	g_modules_started = false;
+
+	/* Check parameter validation */
+	rc = spdk_accel_assign_opc_modules(SPDK_ACCEL_OPC_ENCRYPT, names, 2,
+					   SPDK_ACCEL_BALANCE_SPILLOVER, 2);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	rc = spdk_accel_assign_opc_modules(SPDK_ACCEL_OPC_COPY, names, 1,
+					   SPDK_ACCEL_BALANCE_SPILLOVER, 2);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	rc = spdk_accel_assign_opc_modules(SPDK_ACCEL_OPC_COPY, names, 3,
+					   SPDK_ACCEL_BALANCE_SPILLOVER, 2);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	rc = spdk_accel_assign_opc_modules(SPDK_ACCEL_OPC_COPY, names, 2,
+					   SPDK_ACCEL_BALANCE_SPILLOVER, 0);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	CU_ASSERT_EQUAL(balance->num_modules, 0);
+
+	rc = spdk_accel_assign_opc_modules(SPDK_ACCEL_OPC_COPY, names, 2,
+					   SPDK_ACCEL_BALANCE_SPILLOVER, 2);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(balance->num_modules, 2);
+	CU_ASSERT_STRING_EQUAL(g_modules_opc_override[SPDK_ACCEL_OPC_COPY], "mod0");
+
+	/* Assigning the opcode to a single module disables the balancing */
+	rc = spdk_accel_assign_opc(SPDK_ACCEL_OPC_COPY, "mod1");
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(balance->num_modules, 0);
+
+	rc = spdk_accel_assign_opc_modules(SPDK_ACCEL_OPC_COPY, names, 2,
+					   SPDK_ACCEL_BALANCE_SPILLOVER, 2);
+	CU_ASSERT_EQUAL(rc, 0);
+	for (i = 0; i < UT_BALANCE_MODULES; i++) {
+		balance->modules[i] = &mods[i];
+		bch.modules[i].ch = g_ut_balance_ch[i];
+	}
+	g_accel_ch->balance[SPDK_ACCEL_OPC_COPY] = &bch;
+	memset(stats, 0, sizeof(*stats));
+	STAILQ_INIT(&g_accel_ch->task_pool);
+	for (i = 0; i < (int)SPDK_COUNTOF(tasks); i++) {
+		tasks[i].op_code = SPDK_ACCEL_OPC_COPY;
+		tasks[i].accel_ch = g_accel_ch;
+		tasks[i].cb_fn = ut_balance_cb;
+		tasks[i].cb_arg = &completed;
+	}
+
+	/* Spillover: the first module is used until it has queue_depth outstanding tasks */
+	MOCK_SET(spdk_get_ticks, 1000);
+	for (i = 0; i < 3; i++) {
+		rc = accel_submit_task(g_accel_ch, &tasks[i]);
+		CU_ASSERT_EQUAL(rc, 0);
+	}
+	CU_ASSERT_EQUAL(g_ut_balance_submitted[0], 2);
+	CU_ASSERT_EQUAL(g_ut_balance_submitted[1], 1);
+	CU_ASSERT_EQUAL(tasks[0].balance_idx, 1);
+	CU_ASSERT_EQUAL(tasks[1].balance_idx, 1);
+	CU_ASSERT_EQUAL(tasks[2].balance_idx, 2);
+	CU_ASSERT_EQUAL(bch.modules[0].outstanding, 2);
+	CU_ASSERT_EQUAL(bch.modules[1].outstanding, 1);
+	CU_ASSERT_PTR_EQUAL(bch.modules[0].probe, &tasks[0]);
+	CU_ASSERT_PTR_EQUAL(bch.modules[1].probe, &tasks[2]);
+
+	/* Completing the probes samples the latency */
+	MOCK_SET(spdk_get_ticks, 1100);
+	spdk_accel_task_complete(&tasks[0], 0);
+	MOCK_SET(spdk_get_ticks, 1010);
+	spdk_accel_task_complete(&tasks[2], 0);
+	CU_ASSERT_EQUAL(completed, 2);
+	CU_ASSERT_EQUAL(bch.modules[0].latency, 100);
+	CU_ASSERT_EQUAL(bch.modules[1].latency, 10);
+	CU_ASSERT_EQUAL(bch.modules[0].outstanding, 1);
+	CU_ASSERT_EQUAL(bch.modules[1].outstanding, 0);
+	CU_ASSERT_EQUAL(stats->routed[0], 1);
+	CU_ASSERT_EQUAL(stats->routed[1], 1);
+	CU_ASSERT_EQUAL(tasks[0].balance_idx, 0);
+
+	/* A task rejected due to a lack of resources is resubmitted to the other module */
+	STAILQ_REMOVE_HEAD(&g_accel_ch->task_pool, link);
+	STAILQ_REMOVE_HEAD(&g_accel_ch->task_pool, link);
+	g_ut_balance_rc[0] = -EBUSY;
+	rc = accel_submit_task(g_accel_ch, &tasks[0]);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(tasks[0].balance_idx, 2);
+	CU_ASSERT_EQUAL(bch.modules[0].outstanding, 1);
+	CU_ASSERT_EQUAL(bch.modules[1].outstanding, 1);
+	CU_ASSERT_EQUAL(stats->rerouted, 1);
+
+	/* Other errors are reported to the user */
+	g_ut_balance_rc[0] = -EINVAL;
+	rc = accel_submit_task(g_accel_ch, &tasks[2]);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	CU_ASSERT_EQUAL(tasks[2].balance_idx, 0);
+	CU_ASSERT_EQUAL(bch.modules[0].outstanding, 1);
+	CU_ASSERT_EQUAL(stats->rerouted, 1);
+	CU_ASSERT_EQUAL(stats->failed, 1);
+	g_ut_balance_rc[0] = 0;
+
+	/* Latency: the module with the lowest expected completion time is selected, mod1
+	 * (outstanding: 1, latency: 10) over mod0 (outstanding: 1, latency: 100) */
+	balance->policy = SPDK_ACCEL_BALANCE_LATENCY;
+	rc = accel_submit_task(g_accel_ch, &tasks[2]);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(tasks[2].balance_idx, 2);
+
+	/* mod1 has now reached queue_depth, so mod0 is selected */
+	rc = accel_submit_task(g_accel_ch, &tasks[3]);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(tasks[3].balance_idx, 1);
+	CU_ASSERT_EQUAL(bch.modules[0].outstanding, 2);
+	CU_ASSERT_EQUAL(bch.modules[1].outstanding, 2);
+
+	for (i = 0; i < (int)SPDK_COUNTOF(tasks); i++) {
+		spdk_accel_task_complete(&tasks[i], 0);
+	}
+	CU_ASSERT_EQUAL(bch.modules[0].outstanding, 0);
+	CU_ASSERT_EQUAL(bch.modules[1].outstanding, 0);
+	CU_ASSERT_EQUAL(stats->routed[0], 3);
+	CU_ASSERT_EQUAL(stats->routed[1], 3);
+
+	MOCK_CLEAR(spdk_get_ticks);
+	memset(g_ut_balance_submitted, 0, sizeof(g_ut_balance_submitted));
+	memset(stats, 0, sizeof(*stats));
+	g_accel_ch->balance[SPDK_ACCEL_OPC_COPY] = NULL;
+	accel_balance_clear(SPDK_ACCEL_OPC_COPY);
+	free(g_modules_opc_override[SPDK_ACCEL_OPC_COPY]);
+	g_modules_opc_override[SPDK_ACCEL_OPC_COPY] = NULL;
+	g_modules_started = modules_started;
+	STAILQ_INIT(&g_accel_ch->task_pool);
+}
+
+static void
+test_spdk_accel_compress_sampling(void)
+{
+	struct accel_stats *stats = &g_accel_ch->stats;
+	struct spdk_accel_task task = {};
+	uint8_t buf[8192];
+	struct iovec iovs[2], src_iov;
+	uint32_t output_size;
+	int i, completed = 0;
+
+	memset(&stats->compress, 0, sizeof(stats->compress));
+
+	/* Zeroes are compressible */
+	memset(buf, 0, sizeof(buf));
+	iovs[0].iov_base = buf;
+	iovs[0].iov_len = sizeof(buf);
+	CU_ASSERT(!spdk_accel_compress_is_incompressible(g_ch, iovs, 1));
+	CU_ASSERT_EQUAL(stats->compress.sampled, 1);
+	CU_ASSERT_EQUAL(stats->compress.incompressible, 0);
+
+	/* Random data isn't, also check that buffers split across several iovecs are sampled */
+	for (i = 0; i < (int)sizeof(buf); i++) {
+		buf[i] = rand();
+	}
+	iovs[0].iov_len = 3000;
+	iovs[1].iov_base = &buf[3000];
+	iovs[1].iov_len = sizeof(buf) - 3000;
+	CU_ASSERT(spdk_accel_compress_is_incompressible(g_ch, iovs, 2));
+	CU_ASSERT_EQUAL(stats->compress.sampled, 2);
+	CU_ASSERT_EQUAL(stats->compress.incompressible, 1);
+
+	/* Only half of the samples are random, so the entropy is lower */
+	memset(&buf[4096], 0, 4096);
+	iovs[0].iov_len = sizeof(buf);
+	CU_ASSERT(!spdk_accel_compress_is_incompressible(g_ch, iovs, 1));
+	CU_ASSERT_EQUAL(stats->compress.sampled, 3);
+	CU_ASSERT_EQUAL(stats->compress.incompressible, 1);
+
+	/* Disable the check */
+	g_opts.compress_sample_size = 0;
+	memset(buf, 0xa5, 4096);
+	CU_ASSERT(!spdk_accel_compress_is_incompressible(g_ch, iovs, 1));
+	CU_ASSERT_EQUAL(stats->compress.sampled, 3);
+	g_opts.compress_sample_size = ACCEL_COMPRESS_SAMPLE_SIZE;
+
+	/* Check that completed compress operations are accounted in the ratio histogram */
+	src_iov.iov_base = buf;
+	src_iov.iov_len = 4096;
+	task.op_code = SPDK_ACCEL_OPC_COMPRESS;
+	task.accel_ch = g_accel_ch;
+	task.cb_fn = ut_balance_cb;
+	task.cb_arg = &completed;
+	task.s.iovs = &src_iov;
+	task.s.iovcnt = 1;
+	task.output_size = &output_size;
+	STAILQ_INIT(&g_accel_ch->task_pool);
+
+	output_size = 1024;
+	spdk_accel_task_complete(&task, 0);
+	CU_ASSERT_EQUAL(stats->compress.ratio[2], 1);
+	output_size = 4096;
+	spdk_accel_task_complete(&task, 0);
+	CU_ASSERT_EQUAL(stats->compress.ratio[ACCEL_COMPRESS_RATIO_BUCKETS - 1], 1);
+	output_size = 0;
+	spdk_accel_task_complete(&task, 0);
+	CU_ASSERT_EQUAL(stats->compress.ratio[0], 1);
+
+	/* Failed operations aren't */
+	spdk_accel_task_complete(&task, -ENOSPC);
+	CU_ASSERT_EQUAL(stats->compress.ratio[0], 1);
+	CU_ASSERT_EQUAL(completed, 4);
+
+	memset(&stats->compress, 0, sizeof(stats->compress));
+	memset(&stats->operations[SPDK_ACCEL_OPC_COMPRESS], 0,
+	       sizeof(stats->operations[SPDK_ACCEL_OPC_COMPRESS]));
+}
+
 struct ut_sequence {
 	bool complete;
 	int status;
@@ -958,12 +1240,19 @@ test_sequence_append_error(void)
 	char buf[4096];
 	STAILQ_HEAD(, spdk_accel_task) tasks = STAILQ_HEAD_INITIALIZER(tasks);
 	SLIST_HEAD(, spdk_accel_sequence) seqs = SLIST_HEAD_INITIALIZER(seqs);
-	int rc;
+	struct accel_depot *depots[ACCEL_DEPOT_TYPE_COUNT];
+	int i, rc;
 
 	ioch = spdk_accel_get_io_channel();
 	SPDK_CU_ASSERT_FATAL(ioch != NULL);
 	accel_ch = spdk_io_channel_get_ctx(ioch);
 
+	/* Detach the channel from the depots, so that it doesn't borrow any objects */
+	for (i = 0; i < ACCEL_DEPOT_TYPE_COUNT; i++) {
+		depots[i] = accel_ch->magazines[i].depot;
+		accel_ch->magazines[i].depot = NULL;
+	}
+
 	/* Check that append fails and no sequence object is allocated when there are no more free
 	 * tasks */
 	STAILQ_SWAP(&tasks, &accel_ch->task_pool, spdk_accel_task);
@@ -1020,6 +1309,10 @@ test_sequence_append_error(void)
 
 	STAILQ_SWAP(&tasks, &accel_ch->task_pool, spdk_accel_task);
 
+	for (i = 0; i < ACCEL_DEPOT_TYPE_COUNT; i++) {
+		accel_ch->magazines[i].depot = depots[i];
+	}
+
 	spdk_put_io_channel(ioch);
 	poll_threads();
 }
@@ -4122,6 +4415,254 @@ test_sequence_crc32(void)
 	poll_threads();
 }
 
+static void
+test_sequence_fused(void)
+{
+	struct spdk_accel_sequence *seq = NULL;
+	struct spdk_io_channel *ioch;
+	struct accel_io_channel *accel_ch;
+	struct ut_sequence ut_seq;
+	struct accel_stats stats;
+	char buf[64 * 1024], tmp[64 * 1024];
+	struct iovec src_iovs[2], dst_iovs, crc_iovs;
+	uint32_t crc = 0;
+	int rc, completed = 0;
+
+	ioch = spdk_accel_get_io_channel();
+	SPDK_CU_ASSERT_FATAL(ioch != NULL);
+	accel_ch = spdk_io_channel_get_ctx(ioch);
+	SPDK_CU_ASSERT_FATAL(g_modules_opc[SPDK_ACCEL_OPC_COPY].supports_fusion);
+	SPDK_CU_ASSERT_FATAL(g_modules_opc[SPDK_ACCEL_OPC_CRC32C].supports_fusion);
+	stats = accel_ch->stats;
+
+	/* Copy followed by crc32c of the copied data is executed in a single pass, the source
+	 * consists of two iovecs to cover tiles spanning multiple buffers */
+	memset(buf, 0xa5, sizeof(buf) / 2);
+	memset(&buf[sizeof(buf) / 2], 0x5a, sizeof(buf) / 2);
+	memset(tmp, 0, sizeof(tmp));
+
+	src_iovs[0].iov_base = buf;
+	src_iovs[0].iov_len = 3000;
+	src_iovs[1].iov_base = &buf[3000];
+	src_iovs[1].iov_len = sizeof(buf) - 3000;
+	dst_iovs.iov_base = tmp;
+	dst_iovs.iov_len = sizeof(tmp);
+	rc = spdk_accel_append_copy(&seq, ioch, &dst_iovs, 1, NULL, NULL, src_iovs, 2, NULL, NULL,
+				    ut_sequence_step_cb, &completed);
+	CU_ASSERT_EQUAL(rc, 0);
+
+	crc_iovs.iov_base = tmp;
+	crc_iovs.iov_len = sizeof(tmp);
+	rc = spdk_accel_append_crc32c(&seq, ioch, &crc, &crc_iovs, 1, NULL, NULL, 0,
+				      ut_sequence_step_cb, &completed);
+	CU_ASSERT_EQUAL(rc, 0);
+
+	ut_seq.complete = false;
+	spdk_accel_sequence_finish(seq, ut_sequence_complete_cb, &ut_seq);
+
+	poll_threads();
+	CU_ASSERT_EQUAL(completed, 2);
+	CU_ASSERT(ut_seq.complete);
+	CU_ASSERT_EQUAL(ut_seq.status, 0);
+	CU_ASSERT_EQUAL(memcmp(buf, tmp, sizeof(buf)), 0);
+	CU_ASSERT_EQUAL(crc, spdk_crc32c_update(buf, sizeof(buf), ~0u));
+	CU_ASSERT_EQUAL(accel_ch->stats.fused.executed, stats.fused.executed + 1);
+	CU_ASSERT_EQUAL(accel_ch->stats.fused.tasks, stats.fused.tasks + 2);
+	CU_ASSERT_EQUAL(accel_ch->stats.fused.num_bytes, stats.fused.num_bytes + sizeof(buf));
+	CU_ASSERT_EQUAL(accel_ch->stats.operations[SPDK_ACCEL_OPC_COPY].executed,
+			stats.operations[SPDK_ACCEL_OPC_COPY].executed + 1);
+	CU_ASSERT_EQUAL(accel_ch->stats.operations[SPDK_ACCEL_OPC_CRC32C].executed,
+			stats.operations[SPDK_ACCEL_OPC_CRC32C].executed + 1);
+
+	/* crc32c over a different buffer than the one written by the copy can't be fused */
+	seq = NULL;
+	completed = 0;
+	stats = accel_ch->stats;
+	memset(tmp, 0, sizeof(tmp));
+
+	rc = spdk_accel_append_copy(&seq, ioch, &dst_iovs, 1, NULL, NULL, src_iovs, 2, NULL, NULL,
+				    ut_sequence_step_cb, &completed);
+	CU_ASSERT_EQUAL(rc, 0);
+	crc_iovs.iov_base = buf;
+	crc_iovs.iov_len = sizeof(buf);
+	rc = spdk_accel_append_crc32c(&seq, ioch, &crc, &crc_iovs, 1, NULL, NULL, 0,
+				      ut_sequence_step_cb, &completed);
+	CU_ASSERT_EQUAL(rc, 0);
+
+	ut_seq.complete = false;
+	spdk_accel_sequence_finish(seq, ut_sequence_complete_cb, &ut_seq);
+
+	poll_threads();
+	CU_ASSERT_EQUAL(completed, 2);
+	CU_ASSERT(ut_seq.complete);
+	CU_ASSERT_EQUAL(ut_seq.status, 0);
+	CU_ASSERT_EQUAL(memcmp(buf, tmp, sizeof(buf)), 0);
+	CU_ASSERT_EQUAL(crc, spdk_crc32c_update(buf, sizeof(buf), ~0u));
+	CU_ASSERT_EQUAL(accel_ch->stats.fused.executed, stats.fused.executed);
+
+	spdk_put_io_channel(ioch);
+	poll_threads();
+}
+
+static void
+test_sequence_depot(void)
+{
+	struct spdk_accel_task **tasks;
+	struct spdk_accel_sequence *seq;
+	struct spdk_io_channel *ioch;
+	struct accel_io_channel *accel_ch;
+	struct accel_magazine *mag;
+	struct accel_depot *depot;
+	uint32_t i, num_tasks, depot_count, msize = g_opts.magazine_size;
+
+	ioch = spdk_accel_get_io_channel();
+	SPDK_CU_ASSERT_FATAL(ioch != NULL);
+	accel_ch = spdk_io_channel_get_ctx(ioch);
+	mag = &accel_ch->magazines[ACCEL_DEPOT_TASK];
+	depot = mag->depot;
+	SPDK_CU_ASSERT_FATAL(depot != NULL);
+	memset(&accel_ch->stats.depot, 0, sizeof(accel_ch->stats.depot));
+
+	num_tasks = g_opts.task_count + 3 * msize;
+	tasks = calloc(num_tasks, sizeof(*tasks));
+	SPDK_CU_ASSERT_FATAL(tasks != NULL);
+
+	/* Use up all of the channel's own tasks */
+	for (i = 0; i < g_opts.task_count; i++) {
+		tasks[i] = _get_task(accel_ch, NULL, NULL);
+		SPDK_CU_ASSERT_FATAL(tasks[i] != NULL);
+		CU_ASSERT(!accel_magazine_is_borrowed(mag, tasks[i]));
+	}
+	CU_ASSERT(STAILQ_EMPTY(&accel_ch->task_pool));
+	CU_ASSERT_EQUAL(mag->borrowed, 0);
+
+	/* A sequence reserves a few tasks, so they need to be borrowed from the depot */
+	seq = accel_sequence_get(accel_ch);
+	SPDK_CU_ASSERT_FATAL(seq != NULL);
+	CU_ASSERT_EQUAL(mag->borrowed, msize);
+	CU_ASSERT_EQUAL(mag->count, msize);
+	CU_ASSERT_EQUAL(depot->num_objs, msize);
+	CU_ASSERT_EQUAL(accel_ch->stats.depot.refill, 1);
+	accel_sequence_put(seq);
+
+	/* Next tasks are taken from the magazine, refilled from the depot once it's empty */
+	for (; i < num_tasks; i++) {
+		tasks[i] = _get_task(accel_ch, NULL, NULL);
+		SPDK_CU_ASSERT_FATAL(tasks[i] != NULL);
+		CU_ASSERT(accel_magazine_is_borrowed(mag, tasks[i]));
+		CU_ASSERT_EQUAL(((uintptr_t)tasks[i]) % SPDK_CACHE_LINE_SIZE, 0);
+	}
+	CU_ASSERT_EQUAL(mag->borrowed, 3 * msize);
+	CU_ASSERT_EQUAL(mag->count, 0);
+	CU_ASSERT_EQUAL(depot->num_objs, 3 * msize);
+	CU_ASSERT_EQUAL(accel_ch->stats.depot.refill, 3);
+	CU_ASSERT_EQUAL(accel_ch->stats.task_outstanding, num_tasks);
+
+	/* The depot is limited to depot_count objects */
+	depot_count = g_opts.depot_count;
+	g_opts.depot_count = 3 * msize;
+	CU_ASSERT_PTR_NULL(_get_task(accel_ch, NULL, NULL));
+	CU_ASSERT_EQUAL(accel_ch->stats.depot.exhausted, 1);
+	CU_ASSERT_EQUAL(accel_ch->stats.retry.task, 1);
+
+	/* Once the magazine holds two magazines worth of tasks, one of them is returned to the
+	 * depot */
+	for (i = g_opts.task_count; i < num_tasks; i++) {
+		_put_task(accel_ch, tasks[i]);
+	}
+	CU_ASSERT_EQUAL(accel_ch->stats.depot.release, 1);
+	CU_ASSERT_EQUAL(mag->borrowed, 2 * msize);
+	CU_ASSERT_EQUAL(mag->count, 2 * msize);
+	CU_ASSERT(STAILQ_EMPTY(&accel_ch->task_pool));
+
+	/* Tasks returned to the depot are reused without allocating new ones */
+	for (i = g_opts.task_count; i < num_tasks; i++) {
+		tasks[i] = _get_task(accel_ch, NULL, NULL);
+		SPDK_CU_ASSERT_FATAL(tasks[i] != NULL);
+	}
+	CU_ASSERT_EQUAL(depot->num_objs, 3 * msize);
+	CU_ASSERT_EQUAL(accel_ch->stats.depot.refill, 4);
+	CU_ASSERT_EQUAL(accel_ch->stats.depot.exhausted, 1);
+
+	/* The channel's own tasks go back to its pool */
+	for (i = 0; i < num_tasks; i++) {
+		_put_task(accel_ch, tasks[i]);
+	}
+	CU_ASSERT_EQUAL(accel_ch->stats.task_outstanding, 0);
+	CU_ASSERT_EQUAL(accel_ch->stats.depot.release, 2);
+	CU_ASSERT_EQUAL(mag->borrowed, 2 * msize);
+	CU_ASSERT_EQUAL(mag->count, 2 * msize);
+	CU_ASSERT_PTR_EQUAL(STAILQ_FIRST(&accel_ch->task_pool), tasks[g_opts.task_count - 1]);
+	g_opts.depot_count = depot_count;
+
+	free(tasks);
+	spdk_put_io_channel(ioch);
+	poll_threads();
+}
+
+static void
+test_sequence_depot_grow(void)
+{
+	struct accel_depot depot = {};
+	struct accel_depot_slab *slab;
+	uint32_t depot_count, msize = g_opts.magazine_size;
+	void **objs;
+
+	objs = calloc(msize, sizeof(*objs));
+	SPDK_CU_ASSERT_FATAL(objs != NULL);
+	depot.obj_size = SPDK_CACHE_LINE_SIZE;
+	SLIST_INIT(&depot.slabs);
+	spdk_spin_init(&depot.lock);
+	depot_count = g_opts.depot_count;
+
+	/* The last slab only holds what's left up to depot_count */
+	g_opts.depot_count = msize + 3;
+	CU_ASSERT_EQUAL(accel_depot_grow(&depot, objs), msize);
+	CU_ASSERT_EQUAL(accel_depot_grow(&depot, objs), 3);
+	CU_ASSERT_PTR_NOT_NULL(objs[2]);
+	CU_ASSERT_EQUAL(depot.num_objs, msize + 3);
+	CU_ASSERT_EQUAL(accel_depot_grow(&depot, objs), 0);
+
+	while ((slab = SLIST_FIRST(&depot.slabs)) != NULL) {
+		SLIST_REMOVE_HEAD(&depot.slabs, link);
+		spdk_free(slab);
+	}
+	depot.num_objs = 0;
+
+	/* A depot smaller than a magazine still grows */
+	g_opts.depot_count = msize - 1;
+	CU_ASSERT_EQUAL(accel_depot_grow(&depot, objs), msize - 1);
+	CU_ASSERT_EQUAL(accel_depot_grow(&depot, objs), 0);
+	CU_ASSERT_EQUAL(depot.num_objs, msize - 1);
+
+	while ((slab = SLIST_FIRST(&depot.slabs)) != NULL) {
+		SLIST_REMOVE_HEAD(&depot.slabs, link);
+		spdk_free(slab);
+	}
+	spdk_spin_destroy(&depot.lock);
+	g_opts.depot_count = depot_count;
+	free(objs);
+}
+
+static void
+test_sequence_channel_magazine_failure(void)
+{
+	struct spdk_io_channel *ioch;
+
+	/* The channel fails before getting the modules' channels, so none of them is put */
+	g_ut_put_io_channel_count = 0;
+	g_ut_fail_magazine_alloc = true;
+	ioch = spdk_accel_get_io_channel();
+	g_ut_fail_magazine_alloc = false;
+	CU_ASSERT_PTR_NULL(ioch);
+	CU_ASSERT_EQUAL(g_ut_put_io_channel_count, 0);
+
+	ioch = spdk_accel_get_io_channel();
+	SPDK_CU_ASSERT_FATAL(ioch != NULL);
+	spdk_put_io_channel(ioch);
+	poll_threads();
+}
+
 static void
 test_sequence_dix_generate_verify(void)
 {
@@ -4426,6 +4967,10 @@ main(int argc, char **argv)
 	CU_ADD_TEST(seq_suite, test_sequence_driver);
 	CU_ADD_TEST(seq_suite, test_sequence_same_iovs);
 	CU_ADD_TEST(seq_suite, test_sequence_crc32);
+	CU_ADD_TEST(seq_suite, test_sequence_fused);
+	CU_ADD_TEST(seq_suite, test_sequence_depot);
+	CU_ADD_TEST(seq_suite, test_sequence_depot_grow);
+	CU_ADD_TEST(seq_suite, test_sequence_channel_magazine_failure);
 	CU_ADD_TEST(seq_suite, test_sequence_dix_generate_verify);
 	CU_ADD_TEST(seq_suite, test_sequence_dix);
 
@@ -4442,6 +4987,8 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_spdk_accel_submit_xor);
 	CU_ADD_TEST(suite, test_spdk_accel_module_find_by_name);
 	CU_ADD_TEST(suite, test_spdk_accel_module_register);
+	CU_ADD_TEST(suite, test_spdk_accel_balance);
+	CU_ADD_TEST(suite, test_spdk_accel_compress_sampling);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
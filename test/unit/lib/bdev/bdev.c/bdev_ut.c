@@ -122,6 +122,8 @@ struct bdev_ut_channel {
 };
 
 static bool g_io_done;
+static uint64_t g_submit_io_ctx;
+static uint64_t g_done_io_ctx;
 static struct spdk_bdev_io *g_bdev_io;
 static enum spdk_bdev_io_status g_io_status;
 static enum spdk_bdev_io_status g_io_exp_status = SPDK_BDEV_IO_STATUS_SUCCESS;
@@ -193,6 +195,7 @@ stub_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_io)
 	int i;
 
 	g_bdev_io = bdev_io;
+	g_submit_io_ctx = spdk_trace_io_get_ctx();
 
 	if (g_compare_read_buf && bdev_io->type == SPDK_BDEV_IO_TYPE_READ) {
 		uint32_t len = bdev_io->u.bdev.iovs[0].iov_len;
@@ -7756,6 +7759,114 @@ bdev_io_init_dif_ctx_test(void)
 	free_bdev(bdev);
 }
 
+static void
+io_trace_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	g_done_io_ctx = spdk_trace_io_get_ctx();
+	io_done(bdev_io, success, cb_arg);
+}
+
+static void
+bdev_io_trace_ctx(void)
+{
+	struct spdk_trace_file *trace_file;
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	uint64_t io_id;
+	int i, rc;
+
+	trace_file = calloc(1, sizeof(*trace_file));
+	SPDK_CU_ASSERT_FATAL(trace_file != NULL);
+
+	ut_init_bdev(NULL);
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	/* Nothing is sampled unless the io tpoint group is enabled */
+	CU_ASSERT(spdk_trace_get_io_sample_rate() == SPDK_TRACE_IO_SAMPLE_RATE_DEFAULT);
+	spdk_trace_set_io_sample_rate(1);
+	CU_ASSERT(spdk_trace_io_sample() == 0);
+
+	g_trace_file = trace_file;
+	trace_file->tpoint_mask[TRACE_GROUP_IO] = UINT64_MAX;
+
+	io_id = spdk_trace_io_sample();
+	CU_ASSERT(io_id != 0);
+	CU_ASSERT(spdk_trace_io_sample() == io_id + 1);
+
+	/* One out of every 4 I/Os is sampled */
+	spdk_trace_set_io_sample_rate(4);
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(spdk_trace_io_sample() == 0);
+	}
+	CU_ASSERT(spdk_trace_io_sample() == io_id + 2);
+
+	spdk_trace_set_io_sample_rate(0);
+	for (i = 0; i < 8; i++) {
+		CU_ASSERT(spdk_trace_io_sample() == 0);
+	}
+	spdk_trace_set_io_sample_rate(SPDK_TRACE_IO_SAMPLE_RATE_DEFAULT);
+
+	/* The bdev_io inherits the trace id of the caller and the module sees it while submitting */
+	CU_ASSERT(spdk_trace_io_set_ctx(io_id) == 0);
+	g_io_done = false;
+	rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 0, 1, io_trace_done, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_bdev_io != NULL);
+	CU_ASSERT(g_bdev_io->internal.trace_io_id == io_id);
+	CU_ASSERT(g_submit_io_ctx == io_id);
+	CU_ASSERT(spdk_trace_io_get_ctx() == io_id);
+
+	/* The completion callback runs in the context of the I/O, no matter who completes it */
+	CU_ASSERT(spdk_trace_io_set_ctx(0) == io_id);
+	CU_ASSERT(stub_complete_io(1) == 1);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_done_io_ctx == io_id);
+	CU_ASSERT(spdk_trace_io_get_ctx() == 0);
+
+	/* Children of split I/Os are part of the same sampled I/O */
+	bdev->optimal_io_boundary = 16;
+	bdev->split_on_optimal_io_boundary = true;
+	spdk_trace_io_set_ctx(io_id);
+	g_io_done = false;
+	rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 14, 4, io_trace_done, NULL);
+	CU_ASSERT(rc == 0);
+	spdk_trace_io_set_ctx(0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count > 0);
+	/* The next child may be submitted from the completion of the previous one */
+	while (g_bdev_ut_channel->outstanding_io_count > 0) {
+		CU_ASSERT(g_bdev_io->internal.trace_io_id == io_id);
+		CU_ASSERT(g_submit_io_ctx == io_id);
+		CU_ASSERT(stub_complete_io(1) == 1);
+	}
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_done_io_ctx == io_id);
+	bdev->split_on_optimal_io_boundary = false;
+
+	/* The trace id isn't passed down once the io tpoint group is disabled */
+	trace_file->tpoint_mask[TRACE_GROUP_IO] = 0;
+	spdk_trace_io_set_ctx(io_id);
+	rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_io->internal.trace_io_id == 0);
+	spdk_trace_io_set_ctx(0);
+	CU_ASSERT(stub_complete_io(1) == 1);
+
+	g_trace_file = NULL;
+	free(trace_file);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	ut_fini_bdev();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -7830,6 +7941,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, get_device_stat_with_reset);
 	CU_ADD_TEST(suite, open_ext_v2_test);
 	CU_ADD_TEST(suite, bdev_io_init_dif_ctx_test);
+	CU_ADD_TEST(suite, bdev_io_trace_ctx);
 
 	allocate_cores(1);
 	allocate_threads(1);
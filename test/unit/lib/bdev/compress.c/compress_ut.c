@@ -64,6 +64,8 @@ spdk_reduce_vol_unmap(struct spdk_reduce_vol *vol,
 DEFINE_STUB(spdk_accel_get_opc_module_name, int, (enum spdk_accel_opcode opcode,
 		const char **module_name), 0);
 DEFINE_STUB(spdk_accel_get_io_channel, struct spdk_io_channel *, (void), (void *)0xfeedbeef);
+DEFINE_STUB(spdk_accel_compress_is_incompressible, bool, (struct spdk_io_channel *ch,
+		struct iovec *iovs, size_t iovcnt), false);
 DEFINE_STUB(spdk_bdev_get_aliases, const struct spdk_bdev_aliases_list *,
 	    (const struct spdk_bdev *bdev), NULL);
 DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
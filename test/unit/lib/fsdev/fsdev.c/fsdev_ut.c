@@ -753,7 +753,7 @@ ut_fsdev_test_set_opts(void)
 	rc = spdk_fsdev_get_opts(&old_opts, sizeof(old_opts));
 	CU_ASSERT(rc == 0);
 
-	new_opts.opts_size = sizeof(new_opts);
+	new_opts = old_opts;
 	new_opts.fsdev_io_pool_size = old_opts.fsdev_io_pool_size * 2;
 	new_opts.fsdev_io_cache_size = old_opts.fsdev_io_cache_size * 2;
 	rc = spdk_fsdev_set_opts(&new_opts);
@@ -2049,6 +2049,185 @@ ut_fsdev_test_copy_file_range(void)
 			 ut_fsdev_copy_file_range_check_clb);
 }
 
+static void
+ut_fsdev_cache_lookup(struct spdk_fsdev_desc *fsdev_desc, struct spdk_io_channel *ch,
+		      const char *name, int desired_status, size_t desired_calls)
+{
+	int status = -1;
+	int rc;
+
+	ut_calls_reset();
+	rc = spdk_fsdev_lookup(fsdev_desc, ch, UT_UNIQUE, UT_FOBJECT, name, ut_fsdev_lookup_cpl_cb,
+			       &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == desired_status);
+	CU_ASSERT(ut_calls_get_call_count() == desired_calls);
+}
+
+static void
+ut_fsdev_cache_getattr(struct spdk_fsdev_desc *fsdev_desc, struct spdk_io_channel *ch,
+		       struct spdk_fsdev_file_object *fobject, size_t desired_calls)
+{
+	int status = -1;
+	int rc;
+
+	ut_calls_reset();
+	rc = spdk_fsdev_getattr(fsdev_desc, ch, UT_UNIQUE, fobject, UT_FHANDLE,
+				ut_fsdev_getattr_cpl_cb, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+	CU_ASSERT(ut_calls_get_call_count() == desired_calls);
+}
+
+static void
+ut_fsdev_test_lookup_cache(void)
+{
+	struct spdk_fsdev_opts old_opts, opts;
+	struct ut_fsdev *utfsdev;
+	struct spdk_io_channel *ch;
+	struct spdk_fsdev_desc *fsdev_desc;
+	int rc, status;
+
+	rc = spdk_fsdev_get_opts(&old_opts, sizeof(old_opts));
+	CU_ASSERT(rc == 0);
+	opts = old_opts;
+	opts.lookup_cache_size = 16;
+	opts.lookup_cache_lease_ms = 1000;
+	rc = spdk_fsdev_set_opts(&opts);
+	CU_ASSERT(rc == 0);
+
+	utfsdev = ut_fsdev_create("utfsdev0");
+	SPDK_CU_ASSERT_FATAL(utfsdev != NULL);
+	rc = spdk_fsdev_open("utfsdev0", fsdev_event_cb, NULL, &fsdev_desc);
+	CU_ASSERT(rc == 0);
+	ch = spdk_fsdev_get_io_channel(fsdev_desc);
+	CU_ASSERT(ch != NULL);
+
+	status = -1;
+	rc = ut_fsdev_mount_execute_clb(utfsdev, ch, fsdev_desc, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+
+	/* Only the first lookup reaches the module */
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 1);
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 0);
+
+	/* The attributes came with the lookup */
+	ut_calls_reset();
+	status = -1;
+	rc = spdk_fsdev_getattr(fsdev_desc, ch, UT_UNIQUE, &ut_fsdev_fobject, UT_FHANDLE,
+				ut_fsdev_getattr_cpl_cb, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+	CU_ASSERT(ut_calls_get_call_count() == 0);
+
+	/* Missing names are cached as well */
+	utfsdev->desired_io_status = -ENOENT;
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_LNAME, -ENOENT, 1);
+	utfsdev->desired_io_status = 0;
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_LNAME, -ENOENT, 0);
+
+	/* The lookup served from the cache is forgotten without the module... */
+	ut_calls_reset();
+	status = -1;
+	rc = spdk_fsdev_forget(fsdev_desc, ch, UT_UNIQUE, &ut_fsdev_fobject, 1,
+			       ut_fsdev_forget_cpl_cb, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+	CU_ASSERT(ut_calls_get_call_count() == 0);
+
+	/* ...while the one the module answered is passed on */
+	ut_calls_reset();
+	status = -1;
+	rc = spdk_fsdev_forget(fsdev_desc, ch, UT_UNIQUE, &ut_fsdev_fobject, 1,
+			       ut_fsdev_forget_cpl_cb, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+	CU_ASSERT(ut_calls_get_call_count() == 1);
+	CU_ASSERT(ut_calls_param_get_ptr(0, UT_SUBMIT_IO_NUM_COMMON_PARAMS) == &ut_fsdev_fobject);
+	CU_ASSERT(ut_calls_param_get_int(0, UT_SUBMIT_IO_NUM_COMMON_PARAMS + 1) == 1);
+
+	/* The object is no longer referenced, so it has to be looked up again */
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 1);
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 0);
+
+	/* Unlink drops the entry */
+	ut_calls_reset();
+	status = -1;
+	rc = spdk_fsdev_unlink(fsdev_desc, ch, UT_UNIQUE, UT_FOBJECT, UT_FNAME,
+			       ut_fsdev_unlink_cpl_cb, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+	CU_ASSERT(ut_calls_get_call_count() == 1);
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 1);
+
+	/* So does the lease expiration */
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 0);
+	spdk_delay_us(opts.lookup_cache_lease_ms * 1000);
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 1);
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_LNAME, 0, 1);
+
+	/* Entries invalidated by the module are looked up again */
+	spdk_fsdev_invalidate_entry(&utfsdev->fsdev, UT_FOBJECT, UT_FNAME);
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 1);
+
+	/* Adding a name drops the attributes of the directory, but not of its other objects */
+	ut_fsdev_cache_getattr(fsdev_desc, ch, UT_FOBJECT, 1);
+	ut_fsdev_cache_getattr(fsdev_desc, ch, UT_FOBJECT, 0);
+	ut_fsdev_cache_getattr(fsdev_desc, ch, &ut_fsdev_fobject, 0);
+	status = -1;
+	rc = spdk_fsdev_mkdir(fsdev_desc, ch, UT_UNIQUE, UT_FOBJECT, UT_ANAME, 0x1111, 100, 200,
+			      ut_fsdev_mkdir_cpl_cb, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+	ut_fsdev_cache_getattr(fsdev_desc, ch, UT_FOBJECT, 1);
+	ut_fsdev_cache_getattr(fsdev_desc, ch, &ut_fsdev_fobject, 0);
+
+	/* Removing one drops those of the directory and of the unlinked object */
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_FNAME, 0, 0);
+	status = -1;
+	rc = ut_fsdev_unlink_execute_clb(utfsdev, ch, fsdev_desc, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+	ut_fsdev_cache_getattr(fsdev_desc, ch, UT_FOBJECT, 1);
+	ut_fsdev_cache_getattr(fsdev_desc, ch, &ut_fsdev_fobject, 1);
+
+	/* So does a rename, for the object replaced by it */
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_LNAME, 0, 0);
+	status = -1;
+	rc = spdk_fsdev_rename(fsdev_desc, ch, UT_UNIQUE, UT_FOBJECT, UT_ANAME, UT_FOBJECT, UT_LNAME,
+			       0, ut_fsdev_rename_cpl_cb, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+	ut_fsdev_cache_getattr(fsdev_desc, ch, UT_FOBJECT, 1);
+	ut_fsdev_cache_getattr(fsdev_desc, ch, &ut_fsdev_fobject, 1);
+	ut_fsdev_cache_lookup(fsdev_desc, ch, UT_LNAME, 0, 1);
+
+	status = -1;
+	rc = ut_fsdev_umount_execute_clb(utfsdev, ch, fsdev_desc, &status);
+	CU_ASSERT(rc == 0);
+	poll_thread(0);
+	CU_ASSERT(status == 0);
+
+	spdk_put_io_channel(ch);
+	poll_thread(0);
+	spdk_fsdev_close(fsdev_desc);
+	ut_fsdev_destroy(utfsdev);
+
+	rc = spdk_fsdev_set_opts(&old_opts);
+	CU_ASSERT(rc == 0);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -2099,6 +2278,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, ut_fsdev_test_abort);
 	CU_ADD_TEST(suite, ut_fsdev_test_fallocate);
 	CU_ADD_TEST(suite, ut_fsdev_test_copy_file_range);
+	CU_ADD_TEST(suite, ut_fsdev_test_lookup_cache);
 
 	allocate_cores(1);
 	allocate_threads(1);
@@ -385,6 +385,36 @@ test_next_xfer_addr(void)
 	cleanup_band();
 }
 
+static void
+test_gc_cost_benefit(void)
+{
+	setup_band();
+
+	/* Fully invalidated bands are always worth relocating, fully valid ones never */
+	CU_ASSERT(band_cost_benefit(1.0, 0.0) > 0.0);
+	CU_ASSERT(band_cost_benefit(0.0, 1000.0) == 0.0);
+
+	/* Older data with the same invalidity scores higher */
+	CU_ASSERT(band_cost_benefit(0.5, 100.0) > band_cost_benefit(0.5, 10.0));
+
+	/* Cold, moderately invalidated band wins over hot, more invalidated one */
+	g_dev->gc_cost_benefit = true;
+	CU_ASSERT(band_cmp(g_dev, 0.4, 1.0, 1000.0, 0.6, 1.0, 10.0, 0, 1));
+	CU_ASSERT(!band_cmp(g_dev, 0.6, 1.0, 10.0, 0.4, 1.0, 1000.0, 0, 1));
+
+	/* Similar scores fall back to write count, then to the physical id */
+	CU_ASSERT(band_cmp(g_dev, 0.5, 1.0, 100.0, 0.5, 2.0, 100.0, 1, 0));
+	CU_ASSERT(band_cmp(g_dev, 0.5, 1.0, 100.0, 0.5, 1.0, 100.0, 0, 1));
+	CU_ASSERT(!band_cmp(g_dev, 0.5, 1.0, 100.0, 0.5, 1.0, 100.0, 1, 0));
+
+	/* Invalidity only policy ignores the age */
+	g_dev->gc_cost_benefit = false;
+	CU_ASSERT(!band_cmp(g_dev, 0.4, 1.0, 1000.0, 0.6, 1.0, 10.0, 0, 1));
+	CU_ASSERT(band_cmp(g_dev, 0.6, 1.0, 10.0, 0.4, 1.0, 1000.0, 0, 1));
+
+	cleanup_band();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -402,6 +432,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_band_set_addr);
 	CU_ADD_TEST(suite, test_invalidate_addr);
 	CU_ADD_TEST(suite, test_next_xfer_addr);
+	CU_ADD_TEST(suite, test_gc_cost_benefit);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
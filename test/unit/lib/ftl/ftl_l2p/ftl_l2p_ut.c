@@ -9,11 +9,83 @@
 #include "common/lib/test_env.c"
 
 #include "ftl/ftl_core.h"
+#include "ftl/utils/ftl_l2p_extent.h"
+#include "ftl/ftl_l2p_cache.c"
 
 #define L2P_TABLE_SIZE 1024
 
 static struct spdk_ftl_dev *g_dev;
 
+void *g_ftl_write_buf;
+void *g_ftl_read_buf;
+
+DEFINE_STUB_V(ftl_bitmap_clear, (struct ftl_bitmap *bitmap, uint64_t bit));
+DEFINE_STUB(ftl_bitmap_find_first_set, uint64_t, (struct ftl_bitmap *bitmap, uint64_t start_bit,
+		uint64_t end_bit), UINT64_MAX);
+DEFINE_STUB(ftl_bitmap_get, bool, (const struct ftl_bitmap *bitmap, uint64_t bit), false);
+DEFINE_STUB_V(ftl_invalidate_addr, (struct spdk_ftl_dev *dev, ftl_addr addr));
+DEFINE_STUB_V(ftl_l2p_pin_complete, (struct spdk_ftl_dev *dev, int status,
+				     struct ftl_l2p_pin_ctx *pin_ctx));
+DEFINE_STUB_V(ftl_md_clear, (struct ftl_md *md, int pattern, union ftl_md_vss *vss_pattern));
+DEFINE_STUB(ftl_md_create, struct ftl_md *, (struct spdk_ftl_dev *dev, uint64_t blocks,
+		uint64_t vss_blksz, const char *name, int flags,
+		const struct ftl_layout_region *region), NULL);
+DEFINE_STUB(ftl_md_create_shm_flags, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB_V(ftl_md_destroy, (struct ftl_md *md, int flags));
+DEFINE_STUB(ftl_md_destroy_shm_flags, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB(ftl_md_get_buffer, void *, (struct ftl_md *md), NULL);
+DEFINE_STUB(ftl_md_get_buffer_size, uint64_t, (struct ftl_md *md), 0);
+DEFINE_STUB(ftl_mempool_claim_df, void *, (struct ftl_mempool *mpool, ftl_df_obj_id df_obj_id), NULL);
+DEFINE_STUB(ftl_mempool_create, struct ftl_mempool *, (size_t count, size_t size, size_t alignment,
+		int socket_id), NULL);
+DEFINE_STUB(ftl_mempool_create_ext, struct ftl_mempool *, (void *buffer, size_t count, size_t size,
+		size_t alignment), NULL);
+DEFINE_STUB_V(ftl_mempool_destroy, (struct ftl_mempool *mpool));
+DEFINE_STUB_V(ftl_mempool_destroy_ext, (struct ftl_mempool *mpool));
+DEFINE_STUB(ftl_mempool_get, void *, (struct ftl_mempool *mpool), NULL);
+DEFINE_STUB(ftl_mempool_get_df_obj_id, ftl_df_obj_id, (struct ftl_mempool *mpool, void *df_obj_ptr),
+	    0);
+DEFINE_STUB(ftl_mempool_get_df_obj_index, size_t, (struct ftl_mempool *mpool, void *df_obj_ptr), 0);
+DEFINE_STUB(ftl_mempool_get_df_ptr, void *, (struct ftl_mempool *mpool, ftl_df_obj_id df_obj_id),
+	    NULL);
+DEFINE_STUB_V(ftl_mempool_initialize_ext, (struct ftl_mempool *mpool));
+DEFINE_STUB_V(ftl_mempool_put, (struct ftl_mempool *mpool, void *element));
+DEFINE_STUB_V(ftl_mempool_release_df, (struct ftl_mempool *mpool, ftl_df_obj_id df_obj_id));
+DEFINE_STUB_V(ftl_property_register, (struct spdk_ftl_dev *dev, const char *name, void *value,
+				      size_t size, const char *unit, const char *desc,
+				      ftl_property_dump_fn dump, ftl_property_decode_fn decode,
+				      ftl_property_set_fn set, bool verbose_mode));
+DEFINE_STUB_V(ftl_stats_bdev_io_completed, (struct spdk_ftl_dev *dev, enum ftl_stats_type type,
+		struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_desc_get_bdev, struct spdk_bdev *, (struct spdk_bdev_desc *desc), NULL);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_get_md_size, uint32_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_read_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_read_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, void *buf, void *md, uint64_t offset_blocks,
+		uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_write_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_write_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, void *buf, void *md, uint64_t offset_blocks,
+		uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(ftl_nv_cache_get_min_open_seq_id, uint64_t, (struct ftl_nv_cache *nv_cache), 0);
+
+static int g_l2p_ckpt_persists;
+
+int
+ftl_mngt_l2p_checkpoint(struct spdk_ftl_dev *dev, ftl_mngt_completion cb, void *cb_cntx)
+{
+	g_l2p_ckpt_persists++;
+	cb(dev, cb_cntx, 0);
+	return 0;
+}
+
 static struct spdk_ftl_dev *
 test_alloc_dev(size_t size)
 {
@@ -101,6 +173,105 @@ test_addr_cached(void)
 	clean_l2p();
 }
 
+static void
+test_l2p_extent(void)
+{
+	uint64_t page[L2P_TABLE_SIZE], decoded[L2P_TABLE_SIZE];
+	struct ftl_l2p_extent extents[8];
+	size_t i;
+	int rc;
+
+	/* Unmapped page is a single extent */
+	for (i = 0; i < L2P_TABLE_SIZE; ++i) {
+		ftl_addr_store(g_dev, page, i, FTL_ADDR_INVALID);
+	}
+	rc = ftl_l2p_extent_encode(g_dev, page, L2P_TABLE_SIZE, extents, SPDK_COUNTOF(extents));
+	CU_ASSERT_EQUAL(rc, 1);
+	CU_ASSERT_EQUAL(extents[0].addr, FTL_ADDR_INVALID);
+	CU_ASSERT_EQUAL(extents[0].num_lbas, L2P_TABLE_SIZE);
+
+	/* Two sequential runs separated by an unmapped one */
+	for (i = 0; i < L2P_TABLE_SIZE; ++i) {
+		if (i < 256) {
+			ftl_addr_store(g_dev, page, i, 1000 + i);
+		} else if (i < 512) {
+			ftl_addr_store(g_dev, page, i, FTL_ADDR_INVALID);
+		} else {
+			ftl_addr_store(g_dev, page, i, 5000 + i);
+		}
+	}
+	rc = ftl_l2p_extent_encode(g_dev, page, L2P_TABLE_SIZE, extents, SPDK_COUNTOF(extents));
+	CU_ASSERT_EQUAL(rc, 3);
+	CU_ASSERT_EQUAL(extents[0].addr, 1000);
+	CU_ASSERT_EQUAL(extents[0].num_lbas, 256);
+	CU_ASSERT_EQUAL(extents[1].addr, FTL_ADDR_INVALID);
+	CU_ASSERT_EQUAL(extents[1].num_lbas, 256);
+	CU_ASSERT_EQUAL(extents[2].addr, 5512);
+	CU_ASSERT_EQUAL(extents[2].num_lbas, 512);
+
+	memset(decoded, 0, sizeof(decoded));
+	ftl_l2p_extent_decode(g_dev, decoded, extents, rc);
+	CU_ASSERT_EQUAL(memcmp(page, decoded, sizeof(page)), 0);
+
+	/* Random page doesn't fit */
+	for (i = 0; i < L2P_TABLE_SIZE; ++i) {
+		ftl_addr_store(g_dev, page, i, (i * 7919) % L2P_TABLE_SIZE);
+	}
+	rc = ftl_l2p_extent_encode(g_dev, page, L2P_TABLE_SIZE, extents, SPDK_COUNTOF(extents));
+	CU_ASSERT_EQUAL(rc, -ENOSPC);
+}
+
+static void
+test_l2p_ckpt_open_chunk(void)
+{
+	struct spdk_ftl_dev dev = {};
+	struct ftl_superblock sb = {};
+	struct ftl_l2p_cache cache = {};
+	int i;
+
+	/* No pages, so that checkpoints complete right away */
+	cache.dev = &dev;
+	dev.sb = &sb;
+	dev.nv_cache.chunk_count = 4;
+
+	/* Nothing written yet */
+	ftl_l2p_cache_process_ckpt(&dev, &cache);
+	CU_ASSERT_EQUAL(g_l2p_ckpt_persists, 0);
+
+	/* The first checkpoint stops before the oldest open chunk */
+	sb.seq_id = 20;
+	MOCK_SET(ftl_nv_cache_get_min_open_seq_id, 10);
+	ftl_l2p_cache_process_ckpt(&dev, &cache);
+	CU_ASSERT_EQUAL(g_l2p_ckpt_persists, 1);
+	CU_ASSERT_EQUAL(sb.ckpt_seq_id, 9);
+	CU_ASSERT_EQUAL(cache.ckpt.count, 1);
+
+	/* While that chunk stays open, no checkpoint can get further */
+	for (i = 0; i < 100; i++) {
+		sb.seq_id++;
+		ftl_l2p_cache_process_ckpt(&dev, &cache);
+	}
+	CU_ASSERT_EQUAL(g_l2p_ckpt_persists, 1);
+	CU_ASSERT_EQUAL(sb.ckpt_seq_id, 9);
+
+	/* Once it's closed, the next one does */
+	MOCK_SET(ftl_nv_cache_get_min_open_seq_id, 115);
+	ftl_l2p_cache_process_ckpt(&dev, &cache);
+	CU_ASSERT_EQUAL(g_l2p_ckpt_persists, 2);
+	CU_ASSERT_EQUAL(sb.ckpt_seq_id, 114);
+
+	/* No open chunk, the checkpoint covers everything written */
+	sb.seq_id = 130;
+	MOCK_SET(ftl_nv_cache_get_min_open_seq_id, 0);
+	ftl_l2p_cache_process_ckpt(&dev, &cache);
+	CU_ASSERT_EQUAL(g_l2p_ckpt_persists, 3);
+	CU_ASSERT_EQUAL(sb.ckpt_seq_id, 130);
+	ftl_l2p_cache_process_ckpt(&dev, &cache);
+	CU_ASSERT_EQUAL(g_l2p_ckpt_persists, 3);
+
+	MOCK_CLEAR(ftl_nv_cache_get_min_open_seq_id);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -112,6 +283,8 @@ main(int argc, char **argv)
 	suite64 = CU_add_suite("ftl_addr64_suite", setup_l2p_64bit, cleanup);
 
 	CU_ADD_TEST(suite64, test_addr_cached);
+	CU_ADD_TEST(suite64, test_l2p_extent);
+	CU_ADD_TEST(suite64, test_l2p_ckpt_open_chunk);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -704,6 +704,364 @@ iobuf_priority(void)
 	free_cores();
 }
 
+static struct spdk_iobuf_module_stats g_ut_module_stats;
+
+static void
+ut_iobuf_get_stats_cb(struct spdk_iobuf_module_stats *modules, uint32_t num_modules, void *cb_arg)
+{
+	CU_ASSERT_EQUAL(num_modules, 1);
+	g_ut_module_stats = modules[0];
+	*(int *)cb_arg = 1;
+}
+
+static bool
+ut_iobuf_in_pool(void *buf, uint32_t class)
+{
+	struct iobuf_pool *pool = &g_iobuf.node[0].pools[class];
+	uint32_t i;
+
+	for (i = 0; i < pool->num_slabs; ++i) {
+		if ((char *)buf >= (char *)pool->slabs[i] &&
+		    (char *)buf < (char *)pool->slabs[i] + pool->bufs_per_slab * pool->bufsize) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+iobuf_size_classes(void)
+{
+	struct spdk_iobuf_opts opts = {
+		.small_pool_count = 2,
+		.large_pool_count = 2,
+		.small_bufsize = SMALL_BUFSIZE,
+		.large_bufsize = 4 * LARGE_BUFSIZE,
+		.mid_pool_count = { 2, 2 },
+		.mid_bufsize = { LARGE_BUFSIZE, 2 * LARGE_BUFSIZE },
+	};
+	struct spdk_iobuf_opts valid_opts = {
+		.small_pool_count = IOBUF_DEFAULT_SMALL_POOL_SIZE,
+		.large_pool_count = IOBUF_DEFAULT_LARGE_POOL_SIZE,
+		.small_bufsize = 4 * 1024,
+		.large_bufsize = 1024 * 1024,
+		.opts_size = sizeof(valid_opts),
+		.mid_pool_count = { 64, 64 },
+		.mid_bufsize = { 16 * 1024, 64 * 1024 },
+	};
+	struct spdk_iobuf_opts invalid_opts;
+	struct ut_iobuf_entry entries[4] = {};
+	struct spdk_iobuf_channel iobuf_ch;
+	void *small, *mid1, *large;
+	int rc, done, finish = 0;
+
+	allocate_cores(1);
+	allocate_threads(1);
+
+	set_thread(0);
+
+	/* Check the validation of the additional pools */
+	rc = spdk_iobuf_set_opts(&valid_opts);
+	CU_ASSERT_EQUAL(rc, 0);
+	/* Sizes must be increasing */
+	invalid_opts = valid_opts;
+	invalid_opts.mid_bufsize[1] = 16 * 1024;
+	rc = spdk_iobuf_set_opts(&invalid_opts);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	/* and between the small and large sizes */
+	invalid_opts = valid_opts;
+	invalid_opts.mid_bufsize[1] = invalid_opts.large_bufsize;
+	rc = spdk_iobuf_set_opts(&invalid_opts);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	invalid_opts = valid_opts;
+	invalid_opts.mid_bufsize[0] = invalid_opts.small_bufsize - 1;
+	rc = spdk_iobuf_set_opts(&invalid_opts);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	/* Each pool needs a minimum number of buffers */
+	invalid_opts = valid_opts;
+	invalid_opts.mid_pool_count[1] = 0;
+	rc = spdk_iobuf_set_opts(&invalid_opts);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	/* Used entries must be consecutive */
+	invalid_opts = valid_opts;
+	invalid_opts.mid_bufsize[3] = 256 * 1024;
+	rc = spdk_iobuf_set_opts(&invalid_opts);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+
+	/* We cannot use spdk_iobuf_set_opts(), as it won't allow us to use such small pools */
+	g_iobuf.opts = opts;
+	rc = spdk_iobuf_initialize();
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(g_iobuf.num_mid_classes, 2);
+
+	rc = spdk_iobuf_register_module("ut_module");
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = spdk_iobuf_channel_init(&iobuf_ch, "ut_module", 0, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+
+	/* Each request is served by the pool with the smallest buffers able to hold it */
+	small = spdk_iobuf_get(&iobuf_ch, SMALL_BUFSIZE, NULL, NULL);
+	CU_ASSERT(ut_iobuf_in_pool(small, 0));
+	entries[0].buf = spdk_iobuf_get(&iobuf_ch, SMALL_BUFSIZE + 1, NULL, NULL);
+	CU_ASSERT(ut_iobuf_in_pool(entries[0].buf, 1));
+	entries[1].buf = spdk_iobuf_get(&iobuf_ch, LARGE_BUFSIZE, NULL, NULL);
+	CU_ASSERT(ut_iobuf_in_pool(entries[1].buf, 1));
+	mid1 = spdk_iobuf_get(&iobuf_ch, 2 * LARGE_BUFSIZE, NULL, NULL);
+	CU_ASSERT(ut_iobuf_in_pool(mid1, 2));
+	large = spdk_iobuf_get(&iobuf_ch, 2 * LARGE_BUFSIZE + 1, NULL, NULL);
+	CU_ASSERT(ut_iobuf_in_pool(large, 3));
+
+	/* Exhausting one of the pools doesn't affect the others */
+	entries[2].buf = spdk_iobuf_get(&iobuf_ch, LARGE_BUFSIZE, &entries[2].iobuf,
+					ut_iobuf_get_buf_cb);
+	CU_ASSERT_PTR_NULL(entries[2].buf);
+	entries[3].buf = spdk_iobuf_get(&iobuf_ch, 2 * LARGE_BUFSIZE, NULL, NULL);
+	CU_ASSERT(ut_iobuf_in_pool(entries[3].buf, 2));
+
+	/* Releasing a buffer of the exhausted pool hands it to the waiting entry */
+	spdk_iobuf_put(&iobuf_ch, entries[0].buf, SMALL_BUFSIZE + 1);
+	CU_ASSERT(ut_iobuf_in_pool(entries[2].buf, 1));
+
+	/* Check that the statistics are reported per pool */
+	done = 0;
+	rc = spdk_iobuf_get_stats(ut_iobuf_get_stats_cb, &done);
+	CU_ASSERT_EQUAL(rc, 0);
+	poll_threads();
+	CU_ASSERT_EQUAL(done, 1);
+	CU_ASSERT_EQUAL(g_ut_module_stats.small_pool.main, 1);
+	CU_ASSERT_EQUAL(g_ut_module_stats.large_pool.main, 1);
+	CU_ASSERT_EQUAL(g_ut_module_stats.mid_pool[0].main, 2);
+	CU_ASSERT_EQUAL(g_ut_module_stats.mid_pool[0].retry, 1);
+	CU_ASSERT_EQUAL(g_ut_module_stats.mid_pool[1].main, 2);
+	CU_ASSERT_EQUAL(g_ut_module_stats.mid_pool[1].retry, 0);
+
+	spdk_iobuf_put(&iobuf_ch, small, SMALL_BUFSIZE);
+	spdk_iobuf_put(&iobuf_ch, entries[1].buf, LARGE_BUFSIZE);
+	spdk_iobuf_put(&iobuf_ch, entries[2].buf, LARGE_BUFSIZE);
+	spdk_iobuf_put(&iobuf_ch, mid1, 2 * LARGE_BUFSIZE);
+	spdk_iobuf_put(&iobuf_ch, entries[3].buf, 2 * LARGE_BUFSIZE);
+	spdk_iobuf_put(&iobuf_ch, large, 2 * LARGE_BUFSIZE + 1);
+
+	spdk_iobuf_channel_fini(&iobuf_ch);
+	poll_threads();
+
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.node[0].pools[1].ring), 2);
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.node[0].pools[2].ring), 2);
+
+	spdk_iobuf_finish(ut_iobuf_finish_cb, &finish);
+	poll_threads();
+
+	CU_ASSERT_EQUAL(finish, 1);
+
+	free_threads();
+	free_cores();
+}
+
+static void
+iobuf_grow(void)
+{
+	struct spdk_iobuf_opts opts = {
+		.small_pool_count = 8,
+		.large_pool_count = 3,
+		.small_bufsize = SMALL_BUFSIZE,
+		.large_bufsize = LARGE_BUFSIZE,
+		.slab_size = 2 * SMALL_BUFSIZE,
+	};
+	struct iobuf_pool *small_pool, *large_pool;
+	struct ut_iobuf_entry entry = {};
+	struct spdk_iobuf_channel iobuf_ch;
+	void *bufs[8];
+	int rc, finish = 0;
+	uint32_t i;
+
+	allocate_cores(1);
+	allocate_threads(1);
+
+	set_thread(0);
+
+	g_iobuf.opts = opts;
+	rc = spdk_iobuf_initialize();
+	CU_ASSERT_EQUAL(rc, 0);
+
+	/* The pools start with a single slab */
+	small_pool = &g_iobuf.node[0].pools[0];
+	large_pool = &g_iobuf.node[0].pools[1];
+	CU_ASSERT_EQUAL(small_pool->bufs_per_slab, 2);
+	CU_ASSERT_EQUAL(small_pool->max_slabs, 4);
+	CU_ASSERT_EQUAL(small_pool->num_slabs, 1);
+	CU_ASSERT_EQUAL(small_pool->count, 2);
+	CU_ASSERT_EQUAL(large_pool->bufs_per_slab, 1);
+	CU_ASSERT_EQUAL(large_pool->max_slabs, 3);
+	CU_ASSERT_EQUAL(large_pool->count, 1);
+
+	/* Filling the cache of a channel grows the pools */
+	rc = spdk_iobuf_register_module("ut_module");
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = spdk_iobuf_channel_init(&iobuf_ch, "ut_module", 5, 2);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(small_pool->num_slabs, 3);
+	CU_ASSERT_EQUAL(small_pool->count, 6);
+	CU_ASSERT_EQUAL(spdk_ring_count(small_pool->ring), 1);
+	CU_ASSERT_EQUAL(large_pool->count, 2);
+
+	/* Running low on buffers grows the pools from the app thread, instead of the data path */
+	for (i = 0; i < 6; ++i) {
+		bufs[i] = spdk_iobuf_get(&iobuf_ch, SMALL_BUFSIZE, NULL, NULL);
+		CU_ASSERT_PTR_NOT_NULL(bufs[i]);
+	}
+	CU_ASSERT_EQUAL(small_pool->num_slabs, 3);
+	CU_ASSERT(small_pool->grow_pending);
+	CU_ASSERT_PTR_NULL(spdk_iobuf_get(&iobuf_ch, SMALL_BUFSIZE, NULL, NULL));
+
+	/* The pools grow up to their maximum size */
+	poll_threads();
+	CU_ASSERT(!small_pool->grow_pending);
+	CU_ASSERT_EQUAL(small_pool->num_slabs, 4);
+	CU_ASSERT_EQUAL(small_pool->count, 8);
+	for (i = 6; i < SPDK_COUNTOF(bufs); ++i) {
+		bufs[i] = spdk_iobuf_get(&iobuf_ch, SMALL_BUFSIZE, NULL, NULL);
+		CU_ASSERT_PTR_NOT_NULL(bufs[i]);
+	}
+	CU_ASSERT(!small_pool->grow_pending);
+
+	entry.buf = spdk_iobuf_get(&iobuf_ch, SMALL_BUFSIZE, &entry.iobuf, ut_iobuf_get_buf_cb);
+	CU_ASSERT_PTR_NULL(entry.buf);
+	CU_ASSERT_EQUAL(small_pool->num_slabs, 4);
+
+	spdk_iobuf_put(&iobuf_ch, bufs[0], SMALL_BUFSIZE);
+	CU_ASSERT_PTR_EQUAL(entry.buf, bufs[0]);
+	for (i = 0; i < SPDK_COUNTOF(bufs); ++i) {
+		spdk_iobuf_put(&iobuf_ch, bufs[i], SMALL_BUFSIZE);
+	}
+
+	spdk_iobuf_channel_fini(&iobuf_ch);
+	poll_threads();
+
+	/* All the buffers of the slabs are back in the pools */
+	CU_ASSERT_EQUAL(spdk_ring_count(small_pool->ring), 8);
+	CU_ASSERT_EQUAL(spdk_ring_count(large_pool->ring), 2);
+
+	spdk_iobuf_finish(ut_iobuf_finish_cb, &finish);
+	poll_threads();
+
+	CU_ASSERT_EQUAL(finish, 1);
+	CU_ASSERT_PTR_NULL(small_pool->ring);
+
+	free_threads();
+	free_cores();
+}
+
+static void
+iobuf_wait_rebalance(void)
+{
+	struct spdk_iobuf_opts opts = {
+		.small_pool_count = 4,
+		.large_pool_count = 2,
+		.small_bufsize = SMALL_BUFSIZE,
+		.large_bufsize = LARGE_BUFSIZE,
+	};
+	struct ut_iobuf_entry entry = { .thread_id = 1, .module = "ut_module" };
+	struct spdk_iobuf_channel iobuf_ch[2];
+	uint64_t num_waits;
+	void *bufs[4];
+	int rc, done, finish = 0;
+	uint32_t i;
+
+	allocate_cores(2);
+	allocate_threads(2);
+
+	set_thread(0);
+
+	g_iobuf.opts = opts;
+	rc = spdk_iobuf_initialize();
+	CU_ASSERT_EQUAL(rc, 0);
+
+	rc = spdk_iobuf_register_module("ut_module");
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = spdk_iobuf_channel_init(&iobuf_ch[0], "ut_module", 2, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+	set_thread(1);
+	rc = spdk_iobuf_channel_init(&iobuf_ch[1], "ut_module", 0, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+	entry.ioch = &iobuf_ch[1];
+
+	/* Let the first thread take all the buffers */
+	set_thread(0);
+	for (i = 0; i < SPDK_COUNTOF(bufs); ++i) {
+		bufs[i] = spdk_iobuf_get(&iobuf_ch[0], SMALL_BUFSIZE, NULL, NULL);
+		CU_ASSERT_PTR_NOT_NULL(bufs[i]);
+	}
+
+	/* The second thread has to wait */
+	set_thread(1);
+	entry.buf = spdk_iobuf_get(&iobuf_ch[1], SMALL_BUFSIZE, &entry.iobuf, ut_iobuf_get_buf_cb);
+	CU_ASSERT_PTR_NULL(entry.buf);
+	CU_ASSERT_EQUAL(g_iobuf.node[0].pools[0].waiting_threads, 1);
+
+	/* The first thread keeps the buffers guaranteed by its cache size, but returns the others
+	 * to the pool instead of caching them while the second one is waiting.
+	 */
+	set_thread(0);
+	spdk_iobuf_put(&iobuf_ch[0], bufs[0], SMALL_BUFSIZE);
+	spdk_iobuf_put(&iobuf_ch[0], bufs[1], SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(iobuf_ch[0].cache[0].small.cache_count, 2);
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.node[0].pools[0].ring), 0);
+	spdk_iobuf_put(&iobuf_ch[0], bufs[2], SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(iobuf_ch[0].cache[0].small.cache_count, 2);
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.node[0].pools[0].ring), 1);
+	CU_ASSERT_PTR_NULL(entry.buf);
+
+	/* The second thread picks it up from the pool */
+	spdk_delay_us(100);
+	poll_threads();
+	CU_ASSERT_PTR_EQUAL(entry.buf, bufs[2]);
+	CU_ASSERT_EQUAL(g_iobuf.node[0].pools[0].waiting_threads, 0);
+
+	/* Once nobody is waiting, the buffers are cached again */
+	spdk_iobuf_put(&iobuf_ch[0], bufs[3], SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(iobuf_ch[0].cache[0].small.cache_count, 3);
+
+	/* The wait is recorded in the histogram of the module */
+	done = 0;
+	rc = spdk_iobuf_get_stats(ut_iobuf_get_stats_cb, &done);
+	CU_ASSERT_EQUAL(rc, 0);
+	poll_threads();
+	CU_ASSERT_EQUAL(done, 1);
+	num_waits = 0;
+	for (i = 0; i < SPDK_IOBUF_WAIT_HIST_BUCKETS; ++i) {
+		num_waits += g_ut_module_stats.wait_hist[i];
+	}
+	CU_ASSERT_EQUAL(num_waits, 1);
+	/* 100us fall in the [64, 128) bucket */
+	CU_ASSERT_EQUAL(g_ut_module_stats.wait_hist[7], 1);
+
+	/* Aborting the last waiting entry stops the polling */
+	set_thread(1);
+	bufs[0] = entry.buf;
+	entry.buf = spdk_iobuf_get(&iobuf_ch[1], SMALL_BUFSIZE, &entry.iobuf, ut_iobuf_get_buf_cb);
+	CU_ASSERT_PTR_NULL(entry.buf);
+	CU_ASSERT_EQUAL(g_iobuf.node[0].pools[0].waiting_threads, 1);
+	spdk_iobuf_entry_abort(&iobuf_ch[1], &entry.iobuf, SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(g_iobuf.node[0].pools[0].waiting_threads, 0);
+	spdk_iobuf_put(&iobuf_ch[1], bufs[0], SMALL_BUFSIZE);
+
+	set_thread(0);
+	spdk_iobuf_channel_fini(&iobuf_ch[0]);
+	set_thread(1);
+	spdk_iobuf_channel_fini(&iobuf_ch[1]);
+	poll_threads();
+
+	set_thread(0);
+	spdk_iobuf_finish(ut_iobuf_finish_cb, &finish);
+	poll_threads();
+
+	CU_ASSERT_EQUAL(finish, 1);
+
+	free_threads();
+	free_cores();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -716,6 +1074,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, iobuf);
 	CU_ADD_TEST(suite, iobuf_cache);
 	CU_ADD_TEST(suite, iobuf_priority);
+	CU_ADD_TEST(suite, iobuf_size_classes);
+	CU_ADD_TEST(suite, iobuf_grow);
+	CU_ADD_TEST(suite, iobuf_wait_rebalance);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -146,6 +146,141 @@ thread_send_msg(void)
 	free_threads();
 }
 
+static uintptr_t g_msg_order[128];
+static uint32_t g_msg_count;
+
+static void
+record_msg_cb(void *ctx)
+{
+	SPDK_CU_ASSERT_FATAL(g_msg_count < SPDK_COUNTOF(g_msg_order));
+	g_msg_order[g_msg_count++] = (uintptr_t)ctx;
+}
+
+static void
+thread_send_msg_bulk_and_post(void)
+{
+	struct spdk_thread *thread0, *thread1;
+	void *ctx[SPDK_THREAD_MAX_BULK_MSGS + 1];
+	bool done = false;
+	uintptr_t i;
+
+	allocate_threads(5);
+	set_thread(0);
+	thread0 = spdk_get_thread();
+	set_thread(1);
+	thread1 = spdk_get_thread();
+	g_msg_count = 0;
+
+	for (i = 0; i < SPDK_COUNTOF(ctx); i++) {
+		ctx[i] = (void *)i;
+	}
+
+	/* Bulk messages are all enqueued at once, oversized bulks are rejected */
+	CU_ASSERT(spdk_thread_send_msg_bulk(thread0, record_msg_cb, ctx, 3) == 0);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 3);
+	CU_ASSERT(spdk_thread_send_msg_bulk(thread0, record_msg_cb, ctx, 0) == 0);
+	CU_ASSERT(spdk_thread_send_msg_bulk(thread0, record_msg_cb, ctx,
+					    SPDK_THREAD_MAX_BULK_MSGS + 1) == -EINVAL);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 3);
+
+	/* Posted messages are held in the outbox of the sender */
+	for (i = 3; i < 7; i++) {
+		CU_ASSERT(spdk_thread_post_msg(thread0, record_msg_cb, (void *)i) == 0);
+	}
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 3);
+	CU_ASSERT(thread1->outbox_count == 1);
+	CU_ASSERT(thread0->outbox_pending == 1);
+
+	/* A message sent directly flushes the outbox first to preserve the order */
+	CU_ASSERT(spdk_thread_send_msg(thread0, record_msg_cb, (void *)7) == 0);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 8);
+	CU_ASSERT(thread1->outbox_count == 0);
+	CU_ASSERT(thread0->outbox_pending == 0);
+
+	/* The outbox is flushed at the end of the poll of the sender */
+	CU_ASSERT(spdk_thread_post_msg(thread0, record_msg_cb, (void *)8) == 0);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 8);
+	poll_thread(1);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 9);
+	CU_ASSERT(thread1->outbox_count == 0);
+
+	poll_thread(0);
+	CU_ASSERT(g_msg_count == 9);
+	for (i = 0; i < g_msg_count; i++) {
+		CU_ASSERT(g_msg_order[i] == i);
+	}
+
+	/* A full outbox is flushed right away */
+	set_thread(1);
+	g_msg_count = 0;
+	for (i = 0; i < SPDK_MSG_OUTBOX_DEPTH; i++) {
+		CU_ASSERT(spdk_thread_post_msg(thread0, record_msg_cb, (void *)i) == 0);
+	}
+	CU_ASSERT(spdk_ring_count(thread0->messages) == SPDK_MSG_OUTBOX_DEPTH);
+	CU_ASSERT(thread1->outbox_count == 0);
+	poll_thread(0);
+	CU_ASSERT(g_msg_count == SPDK_MSG_OUTBOX_DEPTH);
+
+	/* Once all of the outboxes are taken, the fullest one is flushed to make room */
+	SPDK_CU_ASSERT_FATAL(SPDK_MSG_OUTBOX_COUNT == 4);
+	set_thread(1);
+	g_msg_count = 0;
+	CU_ASSERT(spdk_thread_post_msg(thread0, record_msg_cb, (void *)0) == 0);
+	CU_ASSERT(spdk_thread_post_msg(thread0, record_msg_cb, (void *)1) == 0);
+	for (i = 2; i < 5; i++) {
+		CU_ASSERT(spdk_thread_post_msg(g_ut_threads[i].thread, record_msg_cb, (void *)i) == 0);
+	}
+	CU_ASSERT(thread1->outbox_count == 4);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 0);
+	CU_ASSERT(spdk_thread_post_msg(thread1, record_msg_cb, (void *)5) == 0);
+	CU_ASSERT(thread1->outbox_count == 4);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 2);
+	poll_threads();
+	CU_ASSERT(g_msg_count == 6);
+	CU_ASSERT(thread1->outbox_count == 0);
+
+	/* Messages that don't fit in the queue of the target are kept and retried */
+	set_thread(1);
+	g_msg_count = 0;
+	MOCK_SET(spdk_ring_enqueue, 0);
+	for (i = 0; i < SPDK_MSG_OUTBOX_DEPTH; i++) {
+		CU_ASSERT(spdk_thread_post_msg(thread0, record_msg_cb, (void *)i) == 0);
+	}
+	poll_thread(1);
+	CU_ASSERT(thread1->outbox_count == 1);
+	CU_ASSERT(thread0->outbox_pending == 1);
+	/* Nothing overtakes them, and the full outbox rejects new messages */
+	set_thread(1);
+	CU_ASSERT(spdk_thread_post_msg(thread0, record_msg_cb, (void *)i) == -EIO);
+	CU_ASSERT(spdk_thread_send_msg(thread0, record_msg_cb, (void *)i) == -EIO);
+	MOCK_CLEAR(spdk_ring_enqueue);
+	CU_ASSERT(spdk_thread_post_msg(thread0, record_msg_cb, (void *)i) == 0);
+	CU_ASSERT(thread1->outbox_count == 1);
+	poll_thread(1);
+	CU_ASSERT(thread1->outbox_count == 0);
+	CU_ASSERT(thread0->outbox_pending == 0);
+	poll_thread(0);
+	CU_ASSERT(g_msg_count == SPDK_MSG_OUTBOX_DEPTH + 1);
+	for (i = 0; i < g_msg_count; i++) {
+		CU_ASSERT(g_msg_order[i] == i);
+	}
+
+	/* A thread doesn't exit while messages are posted to it */
+	set_thread(1);
+	CU_ASSERT(spdk_thread_post_msg(thread0, send_msg_cb, &done) == 0);
+	set_thread(0);
+	spdk_thread_exit(thread0);
+	poll_thread(0);
+	CU_ASSERT(!spdk_thread_is_exited(thread0));
+	CU_ASSERT(!done);
+	poll_thread(1);
+	poll_thread(0);
+	CU_ASSERT(done);
+	CU_ASSERT(spdk_thread_is_exited(thread0));
+
+	free_threads();
+}
+
 static int
 poller_run_done(void *ctx)
 {
@@ -1792,6 +1927,87 @@ io_device_lookup(void)
 	free_threads();
 }
 
+static void
+io_channel_hash_test(void)
+{
+	struct spdk_io_channel *chs[1000], *ch;
+	struct spdk_thread *thread;
+	struct io_device *dev;
+	uint8_t devs[SPDK_COUNTOF(chs)];
+	uint32_t i, count;
+
+	allocate_threads(2);
+	set_thread(0);
+	thread = spdk_get_thread();
+	CU_ASSERT_EQUAL(thread->io_channel_hash_size, SPDK_IO_CHANNEL_HASH_SIZE);
+
+	for (i = 0; i < SPDK_COUNTOF(chs); i++) {
+		spdk_io_device_register(&devs[i], dummy_create_cb, dummy_destroy_cb, 0, NULL);
+		chs[i] = spdk_get_io_channel(&devs[i]);
+		SPDK_CU_ASSERT_FATAL(chs[i] != NULL);
+		CU_ASSERT(chs[i]->dev->io_device == &devs[i]);
+	}
+
+	/* The hash table grows along with the number of channels */
+	CU_ASSERT_EQUAL(thread->io_channel_count, SPDK_COUNTOF(chs));
+	CU_ASSERT_EQUAL(thread->io_channel_hash_size, 1024);
+
+	/* Existing channels are found after the table grew */
+	for (i = 0; i < SPDK_COUNTOF(chs); i++) {
+		ch = spdk_get_io_channel(&devs[i]);
+		CU_ASSERT(ch == chs[i]);
+		CU_ASSERT_EQUAL(ch->ref, 2);
+		CU_ASSERT_EQUAL(ch->dev->refcnt, 1);
+		spdk_put_io_channel(ch);
+	}
+
+	/* Channels are iterated in the order they were created */
+	count = 0;
+	for (ch = spdk_thread_get_first_io_channel(thread); ch != NULL;
+	     ch = spdk_thread_get_next_io_channel(ch)) {
+		CU_ASSERT(ch == chs[count]);
+		count++;
+	}
+	CU_ASSERT_EQUAL(count, SPDK_COUNTOF(chs));
+
+	/* Other threads look the channels up through the lock */
+	set_thread(1);
+	CU_ASSERT(thread_get_io_channel(thread, chs[500]->dev) == chs[500]);
+	CU_ASSERT(thread_get_io_channel(spdk_get_thread(), chs[500]->dev) == NULL);
+	set_thread(0);
+
+	/* An unregistered device keeps its channels, but no new references can be taken */
+	dev = chs[0]->dev;
+	spdk_io_device_unregister(&devs[0], NULL);
+	CU_ASSERT(RB_MIN(io_device_tree, &g_io_devices) != dev);
+	CU_ASSERT_EQUAL(dev->refcnt, IO_DEVICE_UNREGISTERED | 1);
+	CU_ASSERT(spdk_get_io_channel(&devs[0]) == NULL);
+
+	/* A new device registered at the same address gets its own channel */
+	spdk_io_device_register(&devs[0], dummy_create_cb, dummy_destroy_cb, 0, NULL);
+	ch = spdk_get_io_channel(&devs[0]);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	CU_ASSERT(ch != chs[0]);
+	CU_ASSERT(ch->dev != dev);
+	CU_ASSERT_EQUAL(thread->io_channel_count, SPDK_COUNTOF(chs) + 1);
+	spdk_put_io_channel(ch);
+
+	for (i = 0; i < SPDK_COUNTOF(chs); i++) {
+		spdk_put_io_channel(chs[i]);
+	}
+	poll_threads();
+	CU_ASSERT_EQUAL(thread->io_channel_count, 0);
+	CU_ASSERT(TAILQ_EMPTY(&thread->io_channels));
+
+	for (i = 0; i < SPDK_COUNTOF(chs); i++) {
+		spdk_io_device_unregister(&devs[i], NULL);
+	}
+	poll_threads();
+	CU_ASSERT(RB_EMPTY(&g_io_devices));
+
+	free_threads();
+}
+
 static enum spin_error g_spin_err;
 static uint32_t g_spin_err_count = 0;
 
@@ -2169,6 +2385,192 @@ poller_get_stats(void)
 	free_threads();
 }
 
+static int
+ut_slow_poll(void *ctx)
+{
+	spdk_delay_us(10);
+
+	return SPDK_POLLER_IDLE;
+}
+
+static void
+ut_slow_msg(void *ctx)
+{
+	spdk_delay_us((uintptr_t)ctx);
+}
+
+static void
+ut_other_slow_msg(void *ctx)
+{
+	spdk_delay_us((uintptr_t)ctx);
+}
+
+static void
+ut_collect_msg_stats(void *ctx, const struct spdk_thread_msg_stats *stats)
+{
+	struct spdk_thread_msg_stats *all = ctx;
+
+	if (stats->fn == ut_slow_msg) {
+		all[0] = *stats;
+	} else if (stats->fn == ut_other_slow_msg) {
+		all[1] = *stats;
+	}
+}
+
+static void
+cycles_accounting(void)
+{
+	struct spdk_thread_msg_stats msg_stats[2] = {};
+	struct spdk_poller *poller;
+	struct spdk_poller_stats stats;
+	struct spdk_thread *thread;
+	int i;
+
+	spdk_thread_lib_set_cycle_sample_rate(1);
+	allocate_threads(1);
+	set_thread(0);
+	thread = spdk_get_thread();
+
+	/* Every run is measured */
+	poller = spdk_poller_register(ut_slow_poll, NULL, 0);
+	SPDK_CU_ASSERT_FATAL(poller != NULL);
+	for (i = 0; i < 3; i++) {
+		poll_thread(0);
+	}
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT_EQUAL(stats.run_count, 3);
+	CU_ASSERT_EQUAL(stats.tsc, 30);
+
+	/* A sampled run accounts for the runs until the next sample */
+	spdk_thread_lib_set_cycle_sample_rate(4);
+	for (i = 0; i < 8; i++) {
+		poll_thread(0);
+	}
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT_EQUAL(stats.run_count, 11);
+	CU_ASSERT_EQUAL(stats.tsc, 110);
+
+	/* Message functions are accounted separately */
+	spdk_thread_lib_set_cycle_sample_rate(1);
+	spdk_poller_unregister(&poller);
+	spdk_thread_send_msg(thread, ut_slow_msg, (void *)5);
+	spdk_thread_send_msg(thread, ut_other_slow_msg, (void *)7);
+	spdk_thread_send_msg(thread, ut_slow_msg, (void *)5);
+	poll_thread(0);
+	spdk_thread_get_msg_stats(thread, ut_collect_msg_stats, msg_stats);
+	CU_ASSERT_EQUAL(msg_stats[0].count, 2);
+	CU_ASSERT_EQUAL(msg_stats[0].tsc, 10);
+	CU_ASSERT_EQUAL(msg_stats[1].count, 1);
+	CU_ASSERT_EQUAL(msg_stats[1].tsc, 7);
+
+	/* Nothing is measured once the accounting is disabled */
+	spdk_thread_lib_set_cycle_sample_rate(0);
+	spdk_thread_send_msg(thread, ut_slow_msg, (void *)5);
+	poll_thread(0);
+	memset(msg_stats, 0, sizeof(msg_stats));
+	spdk_thread_get_msg_stats(thread, ut_collect_msg_stats, msg_stats);
+	CU_ASSERT_EQUAL(msg_stats[0].count, 2);
+	CU_ASSERT_EQUAL(msg_stats[0].tsc, 10);
+
+	free_threads();
+	spdk_thread_lib_set_cycle_sample_rate(16);
+}
+
+static void
+timer_wheel(void)
+{
+	/* Periods hitting each level of the wheel, the boundaries between them, and the overflow */
+	const uint64_t periods[] = { 1, 2, 63, 64, 65, 100, 4095, 4096, 4097, 5000, 262143,
+				     262144, 300000, 1ULL << 36, (1ULL << 36) + 5
+				   };
+	struct spdk_poller *pollers[SPDK_COUNTOF(periods)], *poller;
+	struct spdk_poller_stats stats;
+	struct spdk_thread *thread;
+	uint64_t step = 7, num_steps = 100000, period, expected;
+	uint32_t i, count;
+
+	/* Check the existing poller tests with the timing wheel, thread_poller() resets the ticks */
+	MOCK_SET(spdk_get_ticks, 0);
+	CU_ASSERT_EQUAL(spdk_thread_lib_set_timer_type(SPDK_THREAD_TIMER_WHEEL), 0);
+	thread_poller();
+	CU_ASSERT_EQUAL(spdk_thread_lib_set_timer_type(SPDK_THREAD_TIMER_WHEEL), 0);
+	poller_pause();
+	CU_ASSERT_EQUAL(spdk_thread_lib_set_timer_type(SPDK_THREAD_TIMER_WHEEL), 0);
+	poller_get_stats();
+
+	CU_ASSERT_EQUAL(spdk_thread_lib_set_timer_type(SPDK_THREAD_TIMER_WHEEL), 0);
+	allocate_threads(1);
+	set_thread(0);
+	thread = spdk_get_thread();
+	SPDK_CU_ASSERT_FATAL(thread->timer_wheel != NULL);
+	CU_ASSERT_EQUAL(thread->timer_wheel->shift, 0);
+
+	/* The type can't be changed once threads exist */
+	CU_ASSERT_EQUAL(spdk_thread_lib_set_timer_type(SPDK_THREAD_TIMER_RBTREE), -EBUSY);
+	CU_ASSERT_EQUAL(spdk_thread_lib_set_timer_type((enum spdk_thread_timer_type)42), -EINVAL);
+
+	CU_ASSERT_EQUAL(spdk_thread_next_poller_expiration(thread), 0);
+	for (i = 0; i < SPDK_COUNTOF(periods); i++) {
+		pollers[i] = spdk_poller_register(ut_null_poll, NULL, periods[i]);
+		SPDK_CU_ASSERT_FATAL(pollers[i] != NULL);
+	}
+	CU_ASSERT_EQUAL(thread->timer_wheel->count, SPDK_COUNTOF(periods));
+	CU_ASSERT_EQUAL(spdk_thread_next_poller_expiration(thread), spdk_get_ticks() + 1);
+
+	/* All of the pollers are reported by the iterators */
+	count = 0;
+	for (poller = spdk_thread_get_first_timed_poller(thread); poller != NULL;
+	     poller = spdk_thread_get_next_timed_poller(poller)) {
+		count++;
+	}
+	CU_ASSERT_EQUAL(count, SPDK_COUNTOF(periods));
+
+	/* Pollers run once their period elapsed, rounded up to the next poll */
+	for (i = 0; i < num_steps; i++) {
+		spdk_delay_us(step);
+		poll_thread(0);
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(periods); i++) {
+		period = spdk_divide_round_up(periods[i], step) * step;
+		expected = num_steps * step / period;
+		spdk_poller_get_stats(pollers[i], &stats);
+		CU_ASSERT_EQUAL(stats.run_count, expected);
+	}
+
+	/* A poller never runs more than once per poll, even if several periods elapsed */
+	for (i = 0; i < 33; i++) {
+		spdk_delay_us(UINT32_MAX);
+	}
+	poll_thread(0);
+	for (i = 0; i < SPDK_COUNTOF(periods); i++) {
+		period = spdk_divide_round_up(periods[i], step) * step;
+		expected = num_steps * step / period + 1;
+		spdk_poller_get_stats(pollers[i], &stats);
+		CU_ASSERT_EQUAL(stats.run_count, expected);
+	}
+
+	/* Paused pollers are taken off the wheel, resumed ones are put back */
+	spdk_poller_pause(pollers[0]);
+	spdk_delay_us(1);
+	poll_thread(0);
+	CU_ASSERT_EQUAL(thread->timer_wheel->count, SPDK_COUNTOF(periods) - 1);
+	spdk_poller_resume(pollers[0]);
+	CU_ASSERT_EQUAL(thread->timer_wheel->count, SPDK_COUNTOF(periods));
+
+	/* Unregistered pollers are released once they expire */
+	for (i = 0; i < SPDK_COUNTOF(periods); i++) {
+		spdk_poller_unregister(&pollers[i]);
+	}
+	for (i = 0; i < 33; i++) {
+		spdk_delay_us(UINT32_MAX);
+	}
+	poll_thread(0);
+	CU_ASSERT_EQUAL(thread->timer_wheel->count, 0);
+	CU_ASSERT(!spdk_thread_has_pollers(thread));
+
+	free_threads();
+}
 
 int
 main(int argc, char **argv)
@@ -2182,6 +2584,7 @@ main(int argc, char **argv)
 
 	CU_ADD_TEST(suite, thread_alloc);
 	CU_ADD_TEST(suite, thread_send_msg);
+	CU_ADD_TEST(suite, thread_send_msg_bulk_and_post);
 	CU_ADD_TEST(suite, thread_poller);
 	CU_ADD_TEST(suite, poller_pause);
 	CU_ADD_TEST(suite, thread_for_each);
@@ -2197,6 +2600,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, cache_closest_timed_poller);
 	CU_ADD_TEST(suite, multi_timed_pollers_have_same_expiration);
 	CU_ADD_TEST(suite, io_device_lookup);
+	CU_ADD_TEST(suite, io_channel_hash_test);
 	CU_ADD_TEST(suite, spdk_spin);
 	CU_ADD_TEST(suite, for_each_channel_and_thread_exit_race);
 	CU_ADD_TEST(suite, for_each_thread_and_thread_exit_race);
@@ -2205,6 +2609,8 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, poller_get_state_str);
 	CU_ADD_TEST(suite, poller_get_period_ticks);
 	CU_ADD_TEST(suite, poller_get_stats);
+	CU_ADD_TEST(suite, cycles_accounting);
+	CU_ADD_TEST(suite, timer_wheel);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -50,6 +50,44 @@ test_crc16_t10dif_copy(void)
 	free(buf3);
 }
 
+static void
+test_crc16_t10dif_fold(void)
+{
+#ifndef SPDK_CONFIG_ISAL
+	bool use_fold = g_crc16_use_fold, wide = g_crc16_fold.wide;
+	uint8_t buf[4096 + 8], dst[4096];
+	uint16_t crc, expected;
+	size_t offset, len;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(buf); i++) {
+		buf[i] = rand();
+	}
+
+	/* Compare the folding kernel, if this CPU supports it, with the table-driven one */
+	for (offset = 0; offset < 8; offset++) {
+		for (len = 0; len <= 4096; len += len < 600 ? 1 : 61) {
+			g_crc16_use_fold = false;
+			expected = spdk_crc16_t10dif(0x1234, buf + offset, len);
+
+			g_crc16_use_fold = use_fold;
+			crc = spdk_crc16_t10dif(0x1234, buf + offset, len);
+			CU_ASSERT(crc == expected);
+
+			/* 128-bit kernel, on CPUs also supporting the 256-bit one */
+			g_crc16_fold.wide = false;
+			crc = spdk_crc16_t10dif(0x1234, buf + offset, len);
+			CU_ASSERT(crc == expected);
+			g_crc16_fold.wide = wide;
+
+			crc = spdk_crc16_t10dif_copy(0x1234, dst, buf + offset, len);
+			CU_ASSERT(crc == expected);
+			CU_ASSERT(memcmp(dst, buf + offset, len) == 0);
+		}
+	}
+#endif
+}
+
 int
 main(int argc, char **argv)
 {
@@ -63,6 +101,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_crc16_t10dif);
 	CU_ADD_TEST(suite, test_crc16_t10dif_seed);
 	CU_ADD_TEST(suite, test_crc16_t10dif_copy);
+	CU_ADD_TEST(suite, test_crc16_t10dif_fold);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
@@ -22,6 +22,37 @@ test_crc32_ieee(void)
 	CU_ASSERT(crc == 0x1b851995);
 }
 
+static void
+test_crc32_ieee_kernels(void)
+{
+	bool use_fold = g_crc32_ieee_use_fold, wide = g_crc32_ieee_fold.wide;
+	uint8_t buf[4096 + 8];
+	uint32_t crc, expected;
+	size_t offset, len;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(buf); i++) {
+		buf[i] = rand();
+	}
+
+	/* Compare the kernels selected for this CPU against the table-driven implementation */
+	for (offset = 0; offset < 8; offset++) {
+		for (len = 0; len <= 4096; len += len < 600 ? 1 : 61) {
+			expected = crc32_update(&g_crc32_ieee_table, buf + offset, len, 0xa5a5a5a5u);
+
+			g_crc32_ieee_use_fold = use_fold;
+			crc = spdk_crc32_ieee_update(buf + offset, len, 0xa5a5a5a5u);
+			CU_ASSERT(crc == expected);
+
+			/* 128-bit kernel, on CPUs also supporting the 256-bit one */
+			g_crc32_ieee_fold.wide = false;
+			crc = spdk_crc32_ieee_update(buf + offset, len, 0xa5a5a5a5u);
+			CU_ASSERT(crc == expected);
+			g_crc32_ieee_fold.wide = wide;
+		}
+	}
+}
+
 int
 main(int argc, char **argv)
 {
@@ -33,6 +64,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("crc32_ieee", NULL, NULL);
 
 	CU_ADD_TEST(suite, test_crc32_ieee);
+	CU_ADD_TEST(suite, test_crc32_ieee_kernels);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
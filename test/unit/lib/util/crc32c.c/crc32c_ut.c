@@ -114,6 +114,40 @@ test_crc32c(void)
 	CU_ASSERT(crc == 0x6087809A);
 }
 
+static void
+test_crc32c_kernels(void)
+{
+#ifndef SPDK_HAVE_ISAL
+	bool use_fold = g_crc32c_use_fold;
+	uint8_t buf[4096 + 8];
+	uint32_t crc, expected;
+	size_t offset, len;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(buf); i++) {
+		buf[i] = rand();
+	}
+
+	/*
+	 * Compare the kernels selected for this CPU against the table-driven implementation,
+	 * with lengths and alignments hitting all their head and tail paths.
+	 */
+	for (offset = 0; offset < 8; offset++) {
+		for (len = 0; len <= 4096; len += len < 1300 ? 1 : 61) {
+			expected = crc32_update(&g_crc32c_table, buf + offset, len, 0xa5a5a5a5u);
+
+			g_crc32c_use_fold = false;
+			crc = spdk_crc32c_update(buf + offset, len, 0xa5a5a5a5u);
+			CU_ASSERT(crc == expected);
+
+			g_crc32c_use_fold = use_fold;
+			crc = spdk_crc32c_update(buf + offset, len, 0xa5a5a5a5u);
+			CU_ASSERT(crc == expected);
+		}
+	}
+#endif
+}
+
 static void
 test_crc32c_nvme(void)
 {
@@ -176,6 +210,7 @@ main(int argc, char **argv)
 
 	CU_ADD_TEST(suite, test_crc32c);
 	CU_ADD_TEST(suite, test_crc32c_nvme);
+	CU_ADD_TEST(suite, test_crc32c_kernels);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
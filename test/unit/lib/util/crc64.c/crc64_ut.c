@@ -58,6 +58,40 @@ test_crc64_nvme(void)
 	CU_ASSERT(crc == 0x9A2DF64B8E9E517E);
 }
 
+static void
+test_crc64_nvme_fold(void)
+{
+#ifndef SPDK_CONFIG_ISAL
+	bool use_fold = g_crc64_use_fold, wide = g_crc64_fold.wide;
+	uint8_t buf[4096 + 8];
+	uint64_t crc, expected;
+	size_t offset, len;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(buf); i++) {
+		buf[i] = rand();
+	}
+
+	/* Compare the folding kernel, if this CPU supports it, with the table-driven one */
+	for (offset = 0; offset < 8; offset++) {
+		for (len = 0; len <= 4096; len += len < 600 ? 1 : 61) {
+			g_crc64_use_fold = false;
+			expected = spdk_crc64_nvme(buf + offset, len, 0x0123456789abcdefULL);
+
+			g_crc64_use_fold = use_fold;
+			crc = spdk_crc64_nvme(buf + offset, len, 0x0123456789abcdefULL);
+			CU_ASSERT(crc == expected);
+
+			/* 128-bit kernel, on CPUs also supporting the 256-bit one */
+			g_crc64_fold.wide = false;
+			crc = spdk_crc64_nvme(buf + offset, len, 0x0123456789abcdefULL);
+			CU_ASSERT(crc == expected);
+			g_crc64_fold.wide = wide;
+		}
+	}
+#endif
+}
+
 int
 main(int argc, char **argv)
 {
@@ -70,6 +104,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("crc64", NULL, NULL);
 
 	CU_ADD_TEST(suite, test_crc64_nvme);
+	CU_ADD_TEST(suite, test_crc64_nvme_fold);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 
@@ -4505,6 +4505,134 @@ dif_generate_and_verify_unmap_test(void)
 	_iov_free_buf(&iov);
 }
 
+static void
+_dif_dix_multi_blocks(struct iovec *iovs, int iovcnt, struct iovec *md_iov,
+		      uint32_t block_size, uint32_t md_size, uint32_t num_blocks,
+		      enum spdk_dif_pi_format dif_pi_format)
+{
+	struct spdk_dif_ctx ctx = {};
+	struct spdk_dif_error err_blk = {};
+	struct spdk_dif_ctx_init_ext_opts dif_opts;
+	struct spdk_dif *dif;
+	uint32_t dif_flags, i;
+	uint64_t guard;
+	uint8_t *data, *md;
+	int rc;
+
+	dif_flags = SPDK_DIF_FLAGS_GUARD_CHECK | SPDK_DIF_FLAGS_APPTAG_CHECK |
+		    SPDK_DIF_FLAGS_REFTAG_CHECK;
+	dif_opts.size = SPDK_SIZEOF(&dif_opts, dif_pi_format);
+	dif_opts.dif_pi_format = dif_pi_format;
+
+	rc = spdk_dif_ctx_init(&ctx, block_size, md_size, md_iov == NULL, true, SPDK_DIF_TYPE1,
+			       dif_flags, 88, 0xFFFF, 0x88, 0, GUARD_SEED, &dif_opts);
+	CU_ASSERT(rc == 0);
+
+	rc = ut_data_pattern_generate(iovs, iovcnt, block_size, md_iov == NULL ? md_size : 0,
+				      num_blocks);
+	CU_ASSERT(rc == 0);
+
+	if (md_iov == NULL) {
+		rc = spdk_dif_generate(iovs, iovcnt, num_blocks, &ctx);
+	} else {
+		rc = spdk_dix_generate(iovs, iovcnt, md_iov, num_blocks, &ctx);
+	}
+	CU_ASSERT(rc == 0);
+
+	/* Check each block against a guard calculated on its own */
+	for (i = 0; i < num_blocks; i++) {
+		data = (uint8_t *)iovs[0].iov_base + i * block_size;
+		if (md_iov == NULL) {
+			guard = _generate_guard(GUARD_SEED, data, ctx.guard_interval, dif_pi_format);
+			dif = (struct spdk_dif *)(data + ctx.guard_interval);
+		} else {
+			md = (uint8_t *)md_iov->iov_base + i * md_size;
+			guard = _generate_guard(GUARD_SEED, data, block_size, dif_pi_format);
+			guard = _generate_guard(guard, md, ctx.guard_interval, dif_pi_format);
+			dif = (struct spdk_dif *)(md + ctx.guard_interval);
+		}
+		CU_ASSERT(_dif_get_guard(dif, dif_pi_format) == guard);
+		CU_ASSERT(_dif_get_reftag(dif, dif_pi_format) == 88 + i);
+	}
+
+	if (md_iov == NULL) {
+		rc = spdk_dif_verify(iovs, iovcnt, num_blocks, &ctx, &err_blk);
+	} else {
+		rc = spdk_dix_verify(iovs, iovcnt, md_iov, num_blocks, &ctx, &err_blk);
+	}
+	CU_ASSERT(rc == 0);
+
+	/* Corrupt the last block, the error must be reported for it */
+	data = (uint8_t *)iovs[0].iov_base + (num_blocks - 1) * block_size;
+	data[0] ^= 0x1;
+
+	if (md_iov == NULL) {
+		rc = spdk_dif_verify(iovs, iovcnt, num_blocks, &ctx, &err_blk);
+	} else {
+		rc = spdk_dix_verify(iovs, iovcnt, md_iov, num_blocks, &ctx, &err_blk);
+	}
+	CU_ASSERT(rc != 0);
+	CU_ASSERT(err_blk.err_type == SPDK_DIF_GUARD_ERROR);
+	CU_ASSERT(err_blk.err_offset == num_blocks - 1);
+}
+
+/* Check requests of various numbers of blocks, either in a single iovec or in two
+ * iovecs holding whole blocks, against guards calculated block by block.  The block sizes
+ * cover the different lengths handled by the folding CRC kernels.
+ */
+static void
+dif_dix_multi_blocks_test(void)
+{
+	struct {
+		enum spdk_dif_pi_format dif_pi_format;
+		uint32_t data_size;
+		uint32_t md_size;
+	} formats[] = {
+		{ SPDK_DIF_PI_FORMAT_16, 512, 8 },
+		{ SPDK_DIF_PI_FORMAT_16, 4096, 8 },
+		{ SPDK_DIF_PI_FORMAT_32, 4096, 16 },
+		{ SPDK_DIF_PI_FORMAT_64, 4096, 16 },
+		{ SPDK_DIF_PI_FORMAT_64, 4096, 128 },
+	};
+	struct iovec iov, split_iovs[2], md_iov;
+	uint32_t f, num_blocks, block_size, md_size;
+
+	for (f = 0; f < SPDK_COUNTOF(formats); f++) {
+		md_size = formats[f].md_size;
+		for (num_blocks = 1; num_blocks <= 9; num_blocks++) {
+			/* DIF */
+			block_size = formats[f].data_size + md_size;
+			_iov_alloc_buf(&iov, block_size * num_blocks);
+			_dif_dix_multi_blocks(&iov, 1, NULL, block_size, md_size, num_blocks,
+					      formats[f].dif_pi_format);
+			if (num_blocks > 1) {
+				_iov_set_buf(&split_iovs[0], iov.iov_base, block_size);
+				_iov_set_buf(&split_iovs[1], (uint8_t *)iov.iov_base + block_size,
+					     block_size * (num_blocks - 1));
+				_dif_dix_multi_blocks(split_iovs, 2, NULL, block_size, md_size, num_blocks,
+						      formats[f].dif_pi_format);
+			}
+			_iov_free_buf(&iov);
+
+			/* DIX */
+			block_size = formats[f].data_size;
+			_iov_alloc_buf(&iov, block_size * num_blocks);
+			_iov_alloc_buf(&md_iov, md_size * num_blocks);
+			_dif_dix_multi_blocks(&iov, 1, &md_iov, block_size, md_size, num_blocks,
+					      formats[f].dif_pi_format);
+			if (num_blocks > 1) {
+				_iov_set_buf(&split_iovs[0], iov.iov_base, block_size);
+				_iov_set_buf(&split_iovs[1], (uint8_t *)iov.iov_base + block_size,
+					     block_size * (num_blocks - 1));
+				_dif_dix_multi_blocks(split_iovs, 2, &md_iov, block_size, md_size, num_blocks,
+						      formats[f].dif_pi_format);
+			}
+			_iov_free_buf(&iov);
+			_iov_free_buf(&md_iov);
+		}
+	}
+}
+
 static void
 dif_pi_format_check_test(void)
 {
@@ -4624,6 +4752,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, dix_sec_512_md_8_prchk_7_multi_iovs_complex_splits_remap_pi_16_test);
 	CU_ADD_TEST(suite, dix_sec_4096_md_128_prchk_7_multi_iovs_complex_splits_remap_test);
 	CU_ADD_TEST(suite, dif_generate_and_verify_unmap_test);
+	CU_ADD_TEST(suite, dif_dix_multi_blocks_test);
 	CU_ADD_TEST(suite, dif_pi_format_check_test);
 	CU_ADD_TEST(suite, dif_type_check_test);
 